@@ -0,0 +1,158 @@
+/**
+ * DedupBackend：一批几乎相同的镜像共享一个 DedupStore 时的磁盘与内存占用。
+ *
+ * 用法: bench_dedup_backend [镜像 MiB=64] [镜像数=100] [差异 %=1]
+ *
+ * 生成一个随机内容（不可压缩、内部无重复）的基础 raw 镜像并导入存储，
+ * 然后克隆出 N 个镜像，每个随机改写 差异% 的 4 KiB chunk。报告：
+ *   逻辑容量（N 份 raw 镜像需要的空间） vs 存储实际占用的磁盘块 + 映射文件
+ *   存储索引与映射的内存占用、打开全部镜像后的 RSS 增量
+ *   依次顺序读完所有镜像的吞吐：共享 chunk 读的是同一份页缓存
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/stat.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "usbipdcpp/virtual_device/storage_backends/DedupBackend.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+
+namespace {
+
+constexpr std::uint32_t CHUNK_SIZE = 4096;
+
+/// 文件实际占用的磁盘空间（稀疏空洞不计），非 Linux 退化为文件大小
+std::uint64_t allocated_bytes(const std::string &path) {
+#ifdef __linux__
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0)
+        return 0;
+    return static_cast<std::uint64_t>(st.st_blocks) * 512;
+#else
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : size;
+#endif
+}
+
+void generate_random_image(const std::string &path, std::uint64_t bytes) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    std::mt19937_64 rng(42);
+    std::vector<std::uint64_t> seg(1024 * 1024 / 8);
+    for (std::uint64_t done = 0; done < bytes; done += seg.size() * 8) {
+        for (auto &v: seg)
+            v = rng();
+        f.write(reinterpret_cast<const char *>(seg.data()), static_cast<std::streamsize>(seg.size() * 8));
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::uint64_t image_mib = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    int image_count = argc > 2 ? std::atoi(argv[2]) : 100;
+    double diff_percent = argc > 3 ? std::atof(argv[3]) : 1.0;
+    spdlog::set_level(spdlog::level::warn);
+
+    ScratchDir dir("dedup");
+    auto image_bytes = image_mib * 1024 * 1024;
+    auto chunks = image_bytes / CHUNK_SIZE;
+    auto diff_chunks = static_cast<std::uint64_t>(static_cast<double>(chunks) * diff_percent / 100.0);
+    std::printf("%d images x %llu MiB, %.2f%% (%llu) chunks of 4 KiB differ per image\n", image_count,
+                static_cast<unsigned long long>(image_mib), diff_percent, static_cast<unsigned long long>(diff_chunks));
+
+    generate_random_image(dir.file("base.img"), image_bytes);
+    auto rss_before = current_rss_bytes();
+    auto store = std::make_shared<DedupStore>(dir.file("store"), CHUNK_SIZE);
+    if (!store->is_valid()) {
+        std::printf("store open failed\n");
+        return 1;
+    }
+
+    Stopwatch import_sw;
+    if (!DedupBackend::import_raw_image(store, dir.file("base.img"), dir.file("base.map"))) {
+        std::printf("import failed\n");
+        return 1;
+    }
+    auto import_secs = import_sw.seconds();
+    std::filesystem::remove(dir.file("base.img"));
+
+    // 克隆并各自改写 1% 的 chunk
+    std::vector<std::unique_ptr<DedupBackend>> images;
+    {
+        DedupBackend base(store, dir.file("base.map"));
+        Stopwatch clone_sw;
+        std::mt19937_64 rng(7);
+        std::vector<std::uint8_t> chunk(CHUNK_SIZE);
+        constexpr std::uint16_t blocks_per_chunk = CHUNK_SIZE / 512;
+        for (int i = 0; i < image_count; ++i) {
+            auto path = dir.file("image" + std::to_string(i) + ".map");
+            if (!base.clone_to(path)) {
+                std::printf("clone failed\n");
+                return 1;
+            }
+            auto image = std::make_unique<DedupBackend>(store, path);
+            for (std::uint64_t j = 0; j < diff_chunks; ++j) {
+                for (std::size_t k = 0; k < chunk.size(); k += 8) {
+                    auto v = rng();
+                    std::memcpy(chunk.data() + k, &v, 8);
+                }
+                image->write(rng() % chunks * blocks_per_chunk, blocks_per_chunk, chunk.data());
+            }
+            image->flush(0, image->block_count());
+            images.push_back(std::move(image));
+        }
+        std::printf("import %.1f MiB/s, clone + modify %.2f s for %d images\n", mib_per_sec(image_bytes, import_secs),
+                    clone_sw.seconds(), image_count);
+    }
+    std::filesystem::remove(dir.file("base.map"));
+
+    auto stats = store->stats();
+    auto rss_after = current_rss_bytes();
+    std::uint64_t map_disk = 0;
+    for (auto &image: images)
+        map_disk += allocated_bytes(image->map_path());
+    auto store_disk =
+            allocated_bytes(dir.file("store/chunks.dat")) + allocated_bytes(dir.file("store/chunks.ref"));
+    auto logical = image_bytes * static_cast<std::uint64_t>(image_count);
+    auto map_memory = chunks * sizeof(std::uint64_t) * static_cast<std::uint64_t>(image_count);
+
+    std::printf("\n%-34s %12s\n", "", "MiB");
+    std::printf("%-34s %12.1f\n", "logical (raw copies)", mib(logical));
+    std::printf("%-34s %12.1f\n", "store chunks + refcounts on disk", mib(store_disk));
+    std::printf("%-34s %12.1f\n", "block maps on disk", mib(map_disk));
+    std::printf("%-34s %12.1f  (%.1fx)\n", "total on disk", mib(store_disk + map_disk),
+                static_cast<double>(logical) / static_cast<double>(store_disk + map_disk));
+    std::printf("%-34s %12.1f\n", "store index memory (estimated)", mib(stats.index_bytes));
+    std::printf("%-34s %12.1f\n", "block maps memory", mib(map_memory));
+    std::printf("%-34s %12.1f\n", "RSS delta (all images open)", mib(rss_after - rss_before));
+    std::printf("live chunks %llu, references %llu, dedup hits %llu\n",
+                static_cast<unsigned long long>(stats.live_chunks), static_cast<unsigned long long>(stats.references),
+                static_cast<unsigned long long>(stats.dedup_hits));
+
+    // 顺序读完所有镜像：第一个镜像把共享 chunk 读进页缓存，后面的镜像基本只命中缓存
+    constexpr std::uint16_t read_blocks = 128; // 64 KiB
+    std::vector<std::uint8_t> buf(read_blocks * 512u);
+    Stopwatch read_sw;
+    std::uint64_t read_bytes = 0;
+    for (auto &image: images) {
+        for (std::uint64_t lba = 0; lba < image->block_count(); lba += read_blocks)
+            read_bytes += image->read(lba, read_blocks, buf.data());
+    }
+    std::printf("\nsequential 64 KiB reads over all images: %.1f MiB/s (%.1f MiB read)\n",
+                mib_per_sec(read_bytes, read_sw.seconds()), mib(read_bytes));
+    return 0;
+}
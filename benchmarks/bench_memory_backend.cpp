@@ -0,0 +1,116 @@
+/**
+ * MemoryBackend（按需提交的匿名映射）vs 旧的 std::vector 实现：构造耗时与 RSS。
+ *
+ * 用法: bench_memory_backend [盘大小 MiB=4096] [写入比例 %=1]
+ *
+ * 每种实现依次测量：
+ *   构造耗时、构造后 RSS 增量
+ *   随机写入 N% 的 64 KiB 区域后的 RSS 增量与写吞吐（首次写入含缺页开销）
+ *   全盘 punch_hole 后的 RSS 增量
+ * 旧实现在构造时清零整盘，盘大小超过空闲内存时会被 OOM，注意参数。
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "usbipdcpp/virtual_device/storage_backends/MemoryBackend.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+
+namespace {
+
+/// 改造前的 MemoryBackend：构造时 std::vector 分配并清零整盘
+class VectorMemoryBackend : public StorageBackend {
+public:
+    explicit VectorMemoryBackend(std::uint64_t blocks, std::uint32_t block_size = 512) :
+        block_count_(blocks), block_size_(block_size), data_(static_cast<std::size_t>(blocks) * block_size) {
+    }
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override {
+        auto total = static_cast<std::size_t>(count) * block_size_;
+        std::memcpy(buffer, data_.data() + lba * block_size_, total);
+        return total;
+    }
+
+    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override {
+        auto total = static_cast<std::size_t>(count) * block_size_;
+        std::memcpy(data_.data() + lba * block_size_, data, total);
+        return total;
+    }
+
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override {
+        std::memset(data_.data() + lba * block_size_, 0, static_cast<std::size_t>(count) * block_size_);
+    }
+
+    std::uint64_t block_count() const override {
+        return block_count_;
+    }
+
+private:
+    std::uint64_t block_count_;
+    std::uint32_t block_size_;
+    std::vector<std::uint8_t> data_;
+};
+
+template<typename Factory>
+void run(const char *name, std::uint64_t blocks, double write_percent, Factory &&factory) {
+    auto rss0 = current_rss_bytes();
+    auto rss_delta = [rss0] {
+        auto now = current_rss_bytes();
+        return now > rss0 ? now - rss0 : 0;
+    };
+    Stopwatch sw;
+    std::unique_ptr<StorageBackend> backend = factory();
+    auto construct_ms = sw.microseconds() / 1000.0;
+    auto rss_construct = rss_delta();
+
+    // 随机写 write_percent% 的 64 KiB 区域（128 块）
+    std::vector<std::uint8_t> data(128 * 512, 0x5A);
+    auto regions = blocks / 128;
+    auto writes = static_cast<std::uint64_t>(static_cast<double>(regions) * write_percent / 100.0);
+    std::mt19937_64 rng(3);
+    sw.reset();
+    for (std::uint64_t i = 0; i < writes; ++i) {
+        backend->write((rng() % regions) * 128, 128, data.data());
+    }
+    auto write_mibs = mib_per_sec(writes * data.size(), sw.seconds());
+    auto rss_written = rss_delta();
+
+    sw.reset();
+    for (std::uint64_t lba = 0; lba < blocks; lba += 1u << 20) {
+        backend->punch_hole(lba, std::min<std::uint64_t>(1u << 20, blocks - lba));
+    }
+    auto punch_ms = sw.microseconds() / 1000.0;
+    auto rss_punched = rss_delta();
+
+    std::printf("%-10s %12.2f %12.1f %12.1f %12.1f %12.2f %12.1f\n", name, construct_ms, mib(rss_construct), write_mibs,
+                mib(rss_written), punch_ms, mib(rss_punched));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::uint64_t disk_mib = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4096;
+    double write_percent = argc > 2 ? std::atof(argv[2]) : 1.0;
+    spdlog::set_level(spdlog::level::warn);
+    auto blocks = disk_mib * 1024 * 1024 / 512;
+
+    std::printf("disk %llu MiB, write %.1f%%\n", static_cast<unsigned long long>(disk_mib), write_percent);
+    std::printf("%-10s %12s %12s %12s %12s %12s %12s\n", "impl", "construct ms", "RSS MiB", "write MiB/s",
+                "RSS MiB", "punch ms", "RSS MiB");
+    std::printf("%-10s %12s %12s %12s %12s %12s %12s\n", "", "", "(empty)", "", "(written)", "", "(punched)");
+
+    run("lazy", blocks, write_percent, [&] { return std::make_unique<MemoryBackend>(blocks); });
+    run("lazy-thp", blocks, write_percent,
+        [&] { return std::make_unique<MemoryBackend>(blocks, 512, MemoryBackend::HugePages::Transparent); });
+    run("vector", blocks, write_percent, [&] { return std::make_unique<VectorMemoryBackend>(blocks); });
+    return 0;
+}
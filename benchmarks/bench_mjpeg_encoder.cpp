@@ -0,0 +1,179 @@
+/**
+ * MJPEG 编码阶段：条带并行与流水线对帧率和端到端延迟的影响。
+ *
+ * 用法: bench_mjpeg_encoder [每项秒数=1] [质量=80]
+ *
+ * 内层是预先生成的 YUY2 帧序列（渐变 + 低幅噪声 + 移动方块，压缩比接近真实画面），
+ * MjpegEncoderSource 以不同线程 / 条带数、流水线开关编码：
+ *   max fps  ：不限速连续 get_frame，编码能力上限
+ *   @30fps   ：按 30 fps 节奏 get_frame（handler 的取帧方式），报告取到原始帧到交给 handler 的
+ *              平均 / 最大延迟（流水线多等一个帧间隔，换来整帧编码时间不占用取帧时刻）
+ * 另报告单帧编码耗时与压缩后码率。
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "usbipdcpp/virtual_device/UvcConstants.h"
+#include "usbipdcpp/virtual_device/video_sources/MjpegEncoderSource.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+
+namespace {
+
+constexpr std::uint32_t INTERVAL_30FPS = 333333;
+
+/// 循环播放预生成的 YUY2 帧
+class SyntheticSource : public VideoSource {
+public:
+    SyntheticSource(std::uint16_t width, std::uint16_t height) : width_(width), height_(height) {
+        std::mt19937 rng(42);
+        for (int f = 0; f < 8; ++f) {
+            std::vector<std::uint8_t> frame(static_cast<std::size_t>(width) * height * 2);
+            int box_x = f * width / 16;
+            for (int y = 0; y < height; ++y)
+                for (int x = 0; x < width; ++x) {
+                    int luma = 16 + (x * 160 / width) + (y * 50 / height) + static_cast<int>(rng() % 9);
+                    if (x >= box_x && x < box_x + width / 8 && y >= height / 3 && y < height / 3 + height / 4)
+                        luma = 200 + static_cast<int>(rng() % 9);
+                    auto *p = &frame[(static_cast<std::size_t>(y) * width + x) * 2];
+                    p[0] = static_cast<std::uint8_t>(std::min(luma, 235));
+                    p[1] = static_cast<std::uint8_t>(x % 2 == 0 ? 128 + (x * 40 / width) : 128 - (y * 40 / height));
+                }
+            frames_.push_back(std::move(frame));
+        }
+    }
+
+    std::vector<VideoFormatInfo> supported_formats() const override {
+        return {current_format()};
+    }
+
+    VideoFormatInfo current_format() const override {
+        return {UvcFourCC::YUY2, width_, height_, static_cast<std::uint32_t>(frames_[0].size()), INTERVAL_30FPS,
+                INTERVAL_30FPS,  INTERVAL_30FPS, 16};
+    }
+
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height, std::uint32_t) override {
+        return fourcc == UvcFourCC::YUY2 && width == width_ && height == height_;
+    }
+
+    bool get_frame(VideoFrame &frame) override {
+        const auto &data = frames_[next_++ % frames_.size()];
+        frame = {data.data(), data.size(), true, nullptr};
+        return true;
+    }
+
+    std::size_t max_frame_size() const override {
+        return frames_[0].size();
+    }
+
+    std::uint32_t frame_interval() const override {
+        return INTERVAL_30FPS;
+    }
+
+private:
+    std::uint16_t width_;
+    std::uint16_t height_;
+    std::vector<std::vector<std::uint8_t>> frames_;
+    std::size_t next_ = 0;
+};
+
+struct RunResult {
+    double fps;
+    double encode_ms;
+    double avg_latency_ms;
+    double max_latency_ms;
+    double mbps; // 压缩后 Mbit/s（按实际帧率）
+    double ratio; // 原始 / 压缩
+};
+
+RunResult run(std::uint16_t width, std::uint16_t height, std::size_t threads, bool pipeline, bool paced, int quality,
+              double seconds) {
+    MjpegEncoderOptions options;
+    options.quality = quality;
+    options.threads = threads;
+    options.pipeline = pipeline;
+    MjpegEncoderSource source(std::make_unique<SyntheticSource>(width, height), options);
+    source.set_format(UvcFourCC::MJPEG, width, height, INTERVAL_30FPS);
+
+    VideoFrame frame{};
+    // 热身：填满缓冲池、建立流水线
+    for (int i = 0; i < 3; ++i)
+        source.get_frame(frame);
+    frame = {};
+    auto before = source.encode_stats();
+
+    const auto period = std::chrono::microseconds(INTERVAL_30FPS / 10);
+    auto next = std::chrono::steady_clock::now();
+    Stopwatch sw;
+    while (sw.seconds() < seconds) {
+        if (paced) {
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+        if (!source.get_frame(frame))
+            break;
+        frame = {};
+    }
+    auto secs = sw.seconds();
+    auto after = source.encode_stats();
+
+    auto frames = static_cast<double>(after.frames - before.frames);
+    RunResult result{};
+    if (frames == 0)
+        return result;
+    result.fps = frames / secs;
+    result.encode_ms = static_cast<double>(after.encode_us - before.encode_us) / frames / 1000.0;
+    result.avg_latency_ms = static_cast<double>(after.latency_us - before.latency_us) / frames / 1000.0;
+    result.max_latency_ms = static_cast<double>(after.max_latency_us) / 1000.0;
+    auto out = static_cast<double>(after.output_bytes - before.output_bytes);
+    result.mbps = out * 8 / secs / 1e6;
+    result.ratio = static_cast<double>(after.input_bytes - before.input_bytes) / out;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+    int quality = argc > 2 ? std::atoi(argv[2]) : 80;
+    spdlog::set_level(spdlog::level::warn);
+    if (!MjpegEncoderSource::available()) {
+        std::printf("built without libjpeg, nothing to measure\n");
+        return 0;
+    }
+
+    struct Resolution {
+        const char *name;
+        std::uint16_t width;
+        std::uint16_t height;
+    };
+    const Resolution resolutions[] = {{"720p", 1280, 720}, {"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+    std::vector<std::size_t> thread_counts{1, 2, 4};
+    auto hw = static_cast<std::size_t>(std::max(1u, std::thread::hardware_concurrency()));
+    if (hw > 4)
+        thread_counts.push_back(hw);
+
+    std::printf("quality %d, %.1f s per case, %zu hardware threads\n", quality, seconds, hw);
+    std::printf("%-6s %7s %-8s %9s %10s %12s %12s %10s %7s\n", "size", "threads", "pipeline", "max fps",
+                "encode ms", "@30 avg ms", "@30 max ms", "@30 Mbps", "ratio");
+    for (const auto &res: resolutions)
+        for (auto threads: thread_counts)
+            for (bool pipeline: {false, true}) {
+                auto unpaced = run(res.width, res.height, threads, pipeline, false, quality, seconds);
+                auto paced = run(res.width, res.height, threads, pipeline, true, quality, seconds);
+                std::printf("%-6s %7zu %-8s %9.1f %10.2f %12.2f %12.2f %10.1f %6.1fx\n", res.name, threads,
+                            pipeline ? "on" : "off", unpaced.fps, unpaced.encode_ms, paced.avg_latency_ms,
+                            paced.max_latency_ms, paced.mbps, paced.ratio);
+            }
+    return 0;
+}
@@ -0,0 +1,303 @@
+/**
+ * MSC 设备端到端负载：经真实的 Server / Session / 协议解析 / MscBulkOnlyHandler 驱动各存储后端。
+ *
+ * 用法: bench_msc_workload [每项秒数=1] [磁盘 MiB=256] [队列深度列表=1,8]
+ *
+ * 进程内起一个只导出 MSC 设备的 Server，客户端经环回 TCP import 后直接按线格式发 URB，
+ * 不需要 vhci 和内核。每条 SCSI 命令是一组 CBW / 数据 / CSW 三个 URB。
+ *
+ * 队列深度：BOT 协议本身一次只执行一条命令，但 USB/IP 上 URB 可以连续提交、按序处理，
+ * 客户端保持最多 qd 条命令的 URB 在途，相当于隐藏了主机侧往返时间，测的是设备侧处理能力。
+ * qd=1 时逐条命令同步等待，对应 usb-storage 的串行行为。
+ *
+ * 负载仿照 fio：seq/rand × read/write/70-30 混合，以及 4K/64K/256K 混合块大小的随机读。
+ * 延迟为每条命令从发出 CBW 到收到 CSW 的时间（含排队）。
+ * dedup+cache 为 DedupBackend 外套 CachedBackend（缓存为磁盘的 1/4），hit % 为该项负载的缓存页命中率。
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "msc_test_device.h"
+#include "usbip_test_client.h"
+#include "usbipdcpp/Server.h"
+#include "usbipdcpp/virtual_device/storage_backends/CachedBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/DedupBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/MemoryBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/RawImageBackend.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+using namespace usbipdcpp::test;
+
+namespace {
+
+constexpr std::uint32_t BLOCK_SIZE = 512;
+constexpr std::uint8_t EP_IN = 1;
+constexpr std::uint8_t EP_OUT = 2;
+
+struct Workload {
+    const char *name;
+    bool random;
+    int read_percent;
+    std::vector<std::pair<std::uint32_t, int>> bssplit; // 块字节数, 权重
+};
+
+struct RunStats {
+    std::uint64_t ops = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t errors = 0;
+    double seconds = 0; // 含最后排空在途命令的时间
+    std::vector<double> latencies_us;
+};
+
+/**
+ * 流水线式 BOT 客户端：命令按 CBW / 数据 / CSW 三个 URB 连续写出，
+ * 回复按提交顺序逐条读回，最多 depth 条命令在途
+ */
+class PipelinedBot {
+public:
+    explicit PipelinedBot(UsbIpTestClient &client) : sock_(client.socket()), devid_(client.devid()) {
+        write_data_.resize(1024 * 1024);
+        std::mt19937_64 rng(3);
+        for (std::size_t i = 0; i < write_data_.size(); i += 8) {
+            auto v = rng();
+            std::memcpy(write_data_.data() + i, &v, 8);
+        }
+        read_scratch_.resize(1024 * 1024);
+    }
+
+    RunStats run(const Workload &w, std::uint64_t disk_blocks, std::size_t depth, double seconds) {
+        struct InFlight {
+            Stopwatch started;
+            std::uint32_t bytes;
+            bool read;
+            std::uint32_t tag;
+        };
+        std::deque<InFlight> inflight;
+        RunStats stats;
+        std::mt19937_64 rng(11);
+        std::vector<double> weights;
+        for (auto &[bs, weight]: w.bssplit)
+            weights.push_back(weight);
+        std::discrete_distribution<std::size_t> pick_bs(weights.begin(), weights.end());
+        std::uint64_t next_lba = 0;
+        std::vector<std::uint8_t> pkt;
+        Stopwatch total;
+
+        for (;;) {
+            pkt.clear();
+            while (total.seconds() < seconds && inflight.size() < depth) {
+                auto bytes = w.bssplit[pick_bs(rng)].first;
+                auto blocks = bytes / BLOCK_SIZE;
+                std::uint64_t lba;
+                if (w.random) {
+                    lba = rng() % (disk_blocks / blocks) * blocks;
+                }
+                else {
+                    if (next_lba + blocks > disk_blocks)
+                        next_lba = 0;
+                    lba = next_lba;
+                    next_lba += blocks;
+                }
+                bool read = static_cast<int>(rng() % 100) < w.read_percent;
+                auto lba32 = static_cast<std::uint32_t>(lba);
+                auto count = static_cast<std::uint16_t>(blocks);
+                auto cdb = read ? BotTestClient::read10(lba32, count) : BotTestClient::write10(lba32, count);
+                auto cbw = BotTestClient::make_cbw(++tag_, 0, cdb, bytes, read);
+                UsbIpTestClient::append_submit(pkt, ++seqnum_, devid_, EP_OUT, false, sizeof(CBW), cbw.data());
+                if (read)
+                    UsbIpTestClient::append_submit(pkt, ++seqnum_, devid_, EP_IN, true, bytes);
+                else
+                    UsbIpTestClient::append_submit(pkt, ++seqnum_, devid_, EP_OUT, false, bytes, write_data_.data());
+                UsbIpTestClient::append_submit(pkt, ++seqnum_, devid_, EP_IN, true, sizeof(CSW));
+                inflight.push_back({Stopwatch(), bytes, read, tag_});
+            }
+            if (!pkt.empty())
+                asio::write(sock_, asio::buffer(pkt));
+            if (inflight.empty())
+                break;
+
+            // 完成最老的一条命令
+            auto &cmd = inflight.front();
+            if (!read_reply(false) || !read_reply(cmd.read)) {
+                ++stats.errors;
+                break;
+            }
+            CSW csw{};
+            if (!read_reply(true, &csw) || csw.dCSWTag != cmd.tag || csw.bCSWStatus != 0)
+                ++stats.errors;
+            stats.latencies_us.push_back(cmd.started.microseconds());
+            ++stats.ops;
+            stats.bytes += cmd.bytes;
+            inflight.pop_front();
+        }
+        stats.seconds = total.seconds();
+        return stats;
+    }
+
+private:
+    /** 读一个 RET_SUBMIT，IN 方向连同数据一起读掉；csw 非空时把数据当 CSW 解析 */
+    bool read_reply(bool in, CSW *csw = nullptr) {
+        std::array<std::uint8_t, 48> head{};
+        std::error_code ec;
+        asio::read(sock_, asio::buffer(head), ec);
+        if (ec || UsbIpTestClient::be32(&head[0]) != USBIP_RET_SUBMIT)
+            return false;
+        auto status = UsbIpTestClient::be32(&head[20]);
+        auto actual = UsbIpTestClient::be32(&head[24]);
+        if (in && actual > 0) {
+            if (actual > read_scratch_.size())
+                read_scratch_.resize(actual);
+            asio::read(sock_, asio::buffer(read_scratch_.data(), actual), ec);
+            if (ec)
+                return false;
+            if (csw && actual == sizeof(CSW))
+                std::memcpy(csw, read_scratch_.data(), sizeof(CSW));
+        }
+        return status == 0;
+    }
+
+    asio::ip::tcp::socket &sock_;
+    std::uint32_t devid_;
+    std::uint32_t seqnum_ = 0;
+    std::uint32_t tag_ = 0;
+    std::vector<std::uint8_t> write_data_;
+    std::vector<std::uint8_t> read_scratch_;
+};
+
+/** 预先写满随机数据，避免读到未分配区域走全零捷径 */
+void prefill(StorageBackend &backend) {
+    constexpr std::uint16_t step = 2048;
+    std::vector<std::uint8_t> buf(step * BLOCK_SIZE);
+    std::mt19937_64 rng(5);
+    for (std::uint64_t lba = 0; lba < backend.block_count(); lba += step) {
+        for (std::size_t i = 0; i < buf.size(); i += 8) {
+            auto v = rng();
+            std::memcpy(buf.data() + i, &v, 8);
+        }
+        auto n = static_cast<std::uint16_t>(std::min<std::uint64_t>(step, backend.block_count() - lba));
+        backend.write(lba, n, buf.data());
+    }
+    backend.flush(0, backend.block_count());
+}
+
+void run_backend(const char *name, std::unique_ptr<StorageBackend> backend, const std::vector<Workload> &workloads,
+                 const std::vector<std::size_t> &depths, double seconds) {
+    prefill(*backend);
+    auto disk_blocks = backend->block_count();
+    // 预填充写穿进缓存的页清掉，从冷缓存开始
+    auto *cache = dynamic_cast<CachedBackend *>(backend.get());
+    if (cache)
+        cache->clear();
+
+    StringPool string_pool;
+    Server server;
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::move(backend), MscConfig{}, false});
+    server.add_device(make_msc_device(string_pool, std::move(luns)));
+    asio::ip::tcp::endpoint ep{asio::ip::address_v4::loopback(), 0};
+    if (server.start(ep)) {
+        std::printf("%s: server start failed\n", name);
+        return;
+    }
+    {
+        asio::io_context io;
+        UsbIpTestClient client(io);
+        std::error_code ec;
+        client.socket().connect(ep, ec);
+        if (ec || !client.import("1-1")) {
+            std::printf("%s: import failed\n", name);
+            server.stop();
+            return;
+        }
+        client.socket().set_option(asio::ip::tcp::no_delay(true));
+        PipelinedBot bot(client);
+        for (auto &w: workloads) {
+            for (auto depth: depths) {
+                auto before = cache ? cache->cache_stats() : CachedBackend::CacheStats{};
+                auto stats = bot.run(w, disk_blocks, depth, seconds);
+                auto secs = stats.seconds;
+                char hit[16] = "-";
+                if (cache) {
+                    auto after = cache->cache_stats();
+                    auto hits = after.hits - before.hits;
+                    auto lookups = hits + after.misses - before.misses;
+                    if (lookups > 0)
+                        std::snprintf(hit, sizeof(hit), "%.1f",
+                                      100.0 * static_cast<double>(hits) / static_cast<double>(lookups));
+                }
+                std::printf("%-11s %-18s %4zu %10.1f %10.0f %9.1f %9.1f %9.1f %6s %6llu\n", name, w.name, depth,
+                            mib_per_sec(stats.bytes, secs), static_cast<double>(stats.ops) / secs,
+                            percentile(stats.latencies_us, 50), percentile(stats.latencies_us, 99),
+                            percentile(stats.latencies_us, 99.9), hit, static_cast<unsigned long long>(stats.errors));
+            }
+        }
+        client.socket().close();
+    }
+    server.stop();
+}
+
+std::vector<std::size_t> parse_depths(const char *arg) {
+    std::vector<std::size_t> depths;
+    for (const char *p = arg; *p;) {
+        char *end;
+        auto v = std::strtoull(p, &end, 10);
+        if (end == p)
+            break;
+        if (v > 0)
+            depths.push_back(v);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return depths;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+    std::uint64_t disk_mib = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+    auto depths = parse_depths(argc > 3 ? argv[3] : "1,8");
+    spdlog::set_level(spdlog::level::warn);
+
+    const std::vector<Workload> workloads = {
+            {"seq-read 128K", false, 100, {{128 * 1024, 1}}},
+            {"seq-write 128K", false, 0, {{128 * 1024, 1}}},
+            {"rand-read 4K", true, 100, {{4096, 1}}},
+            {"rand-write 4K", true, 0, {{4096, 1}}},
+            {"rand-rw70 4K", true, 70, {{4096, 1}}},
+            {"rand-read mixed", true, 100, {{4096, 50}, {64 * 1024, 30}, {256 * 1024, 20}}},
+    };
+    auto disk_blocks = disk_mib * 1024 * 1024 / BLOCK_SIZE;
+
+    std::printf("%.1f s per workload, %llu MiB disk, mixed = 4K 50%% / 64K 30%% / 256K 20%%\n", seconds,
+                static_cast<unsigned long long>(disk_mib));
+    std::printf("%-11s %-18s %4s %10s %10s %9s %9s %9s %6s %6s\n", "backend", "workload", "qd", "MiB/s", "IOPS",
+                "p50 us", "p99 us", "p99.9 us", "hit %", "errors");
+
+    ScratchDir dir("msc_workload");
+    run_backend("memory", std::make_unique<MemoryBackend>(disk_blocks), workloads, depths, seconds);
+    run_backend("raw", std::make_unique<RawImageBackend>(dir.file("disk.img"), disk_blocks), workloads, depths,
+                seconds);
+    auto store = std::make_shared<DedupStore>(dir.file("store"));
+    run_backend("dedup", std::make_unique<DedupBackend>(store, dir.file("disk.map"), disk_blocks), workloads, depths,
+                seconds);
+    CachedBackendOptions cache_options;
+    cache_options.cache_bytes = disk_mib * 1024 * 1024 / 4;
+    auto cached_store = std::make_shared<DedupStore>(dir.file("cached_store"));
+    run_backend("dedup+cache",
+                std::make_unique<CachedBackend>(
+                        std::make_unique<DedupBackend>(cached_store, dir.file("cached.map"), disk_blocks),
+                        cache_options),
+                workloads, depths, seconds);
+    return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * NbdBackend 在环回连接 + 注入延迟下的吞吐：请求流水线（在途上限）的效果。
+ *
+ * 用法: bench_nbd_backend [顺序读 MiB=64] [每线程随机读次数=2000] [随机读线程数=4]
+ *
+ * 服务器为 tests/nbd_mock_server.h 的内存 NBD 服务器，每个请求在收到后固定延迟再回复，
+ * 延迟可以重叠，模拟远端存储的 RTT + 服务时间。对每组 (延迟, 在途上限)：
+ *   seq：单线程按 1 MiB 调用 read()（拆成 128 KiB 的 NBD 请求）
+ *   rand：多线程各自随机 4 KiB read()
+ * 在途上限 1 相当于一问一答，吞吐受 RTT 限制。
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "nbd_mock_server.h"
+#include "usbipdcpp/virtual_device/storage_backends/NbdBackend.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+
+namespace {
+
+constexpr std::uint64_t DISK_BYTES = 256ull * 1024 * 1024;
+
+void run(std::chrono::microseconds latency, std::size_t in_flight, std::uint64_t seq_mib, std::uint64_t rand_ops,
+         int rand_threads) {
+    test::NbdMockServer::Options server_options;
+    server_options.size = DISK_BYTES;
+    server_options.latency = latency;
+    test::NbdMockServer server(server_options);
+
+    NbdOptions options;
+    options.max_request_bytes = 128 * 1024;
+    options.max_in_flight = in_flight;
+    NbdBackend backend(server.listen_tcp(), options);
+    if (!backend.is_valid()) {
+        std::printf("connect failed\n");
+        return;
+    }
+
+    // 顺序读
+    constexpr std::uint16_t seq_blocks = 2048; // 1 MiB
+    std::vector<std::uint8_t> buf(seq_blocks * 512u);
+    Stopwatch seq_sw;
+    std::uint64_t seq_bytes = 0;
+    for (std::uint64_t i = 0; i < seq_mib; ++i) {
+        auto lba = (i * seq_blocks) % backend.block_count();
+        seq_bytes += backend.read(lba, seq_blocks, buf.data());
+    }
+    auto seq_secs = seq_sw.seconds();
+
+    // 多线程随机 4 KiB 读
+    std::vector<std::thread> threads;
+    std::vector<std::vector<double>> latencies(rand_threads);
+    Stopwatch rand_sw;
+    for (int t = 0; t < rand_threads; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            std::vector<std::uint8_t> block(4096);
+            auto slots = backend.block_count() / 8;
+            latencies[t].reserve(rand_ops);
+            for (std::uint64_t i = 0; i < rand_ops; ++i) {
+                Stopwatch sw;
+                backend.read(rng() % slots * 8, 8, block.data());
+                latencies[t].push_back(sw.microseconds());
+            }
+        });
+    }
+    for (auto &t: threads)
+        t.join();
+    auto rand_secs = rand_sw.seconds();
+    std::vector<double> all;
+    for (auto &l: latencies)
+        all.insert(all.end(), l.begin(), l.end());
+
+    std::printf("%10lld %9zu %12.1f %12.0f %10.1f %10.1f %10zu\n", static_cast<long long>(latency.count()), in_flight,
+                mib_per_sec(seq_bytes, seq_secs), static_cast<double>(rand_ops * rand_threads) / rand_secs,
+                percentile(all, 50), percentile(all, 99), server.max_in_flight());
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::uint64_t seq_mib = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    std::uint64_t rand_ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000;
+    int rand_threads = argc > 3 ? std::atoi(argv[3]) : 4;
+    spdlog::set_level(spdlog::level::warn);
+
+    std::printf("seq %llu MiB (1 MiB reads, 128 KiB NBD requests), rand %llu x %d threads x 4 KiB\n",
+                static_cast<unsigned long long>(seq_mib), static_cast<unsigned long long>(rand_ops), rand_threads);
+    std::printf("%10s %9s %12s %12s %10s %10s %10s\n", "latency us", "in-flight", "seq MiB/s", "rand IOPS",
+                "p50 us", "p99 us", "srv peak");
+    for (auto latency: {0, 100, 500, 2000}) {
+        for (std::size_t in_flight: {1, 4, 16, 64}) {
+            run(std::chrono::microseconds(latency), in_flight, seq_mib, rand_ops, rand_threads);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * 多会话共享同一光盘镜像：SharedImageBackend（进程内一份只读映射）vs 每会话一个 RawImageBackend。
+ *
+ * 用法: bench_shared_image [秒数=3] [镜像 MiB=512] [读者数=50]
+ *
+ * 进程内 Server 导出 N 个光驱设备（busid 1-1 .. 1-N），N 个客户端线程各 import 一个，
+ * 经真实的 Session / MscBulkOnlyHandler 发随机 64 KiB READ(12)。镜像先整体读一遍进页缓存，
+ * 两组测的都是热缓存下的读路径：raw 每个后端各有一份映射、一把读锁；shared 共用一份映射、读路径无锁。
+ * 报告聚合吞吐、延迟分位数，以及运行结束时镜像在 /proc/self/maps 中的映射数与进程页表大小（VmPTE）。
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "msc_test_device.h"
+#include "usbip_test_client.h"
+#include "usbipdcpp/Server.h"
+#include "usbipdcpp/virtual_device/storage_backends/RawImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/SharedImageBackend.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+using namespace usbipdcpp::test;
+
+namespace {
+
+constexpr std::uint32_t SECTOR = 2048;
+constexpr std::uint32_t READ_SECTORS = 32; // 64 KiB
+
+/** /proc/self/maps 中映射了 path 的区域数，非 Linux 返回 0 */
+std::size_t count_mappings(const std::string &path) {
+    std::size_t n = 0;
+#ifdef __linux__
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+        if (line.size() >= path.size() && line.compare(line.size() - path.size(), path.size(), path) == 0)
+            ++n;
+    }
+#else
+    (void) path;
+#endif
+    return n;
+}
+
+/** /proc/self/status 的 VmPTE（KiB），非 Linux 返回 0 */
+std::size_t page_table_kib() {
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmPTE:", 0) == 0)
+            return std::strtoull(line.c_str() + 6, nullptr, 10);
+    }
+#endif
+    return 0;
+}
+
+void make_image(const std::string &path, std::uint64_t bytes) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    std::vector<std::uint8_t> buf(1024 * 1024);
+    std::mt19937_64 rng(7);
+    for (std::uint64_t done = 0; done < bytes; done += buf.size()) {
+        for (std::size_t i = 0; i < buf.size(); i += 8) {
+            auto v = rng();
+            std::memcpy(buf.data() + i, &v, 8);
+        }
+        f.write(reinterpret_cast<const char *>(buf.data()), static_cast<std::streamsize>(buf.size()));
+    }
+}
+
+/** 顺序读一遍，把镜像放进页缓存 */
+void warm_page_cache(const std::string &path) {
+    std::ifstream f(path, std::ios::binary);
+    std::vector<char> buf(1024 * 1024);
+    while (f.read(buf.data(), static_cast<std::streamsize>(buf.size())) || f.gcount() > 0) {
+    }
+}
+
+struct ReaderStats {
+    std::uint64_t ops = 0;
+    std::uint64_t errors = 0;
+    std::vector<double> latencies_us;
+};
+
+template<typename MakeBackend>
+void run(const char *name, const std::string &path, std::size_t readers, double seconds, MakeBackend make_backend) {
+    StringPool string_pool;
+    Server server;
+    std::uint64_t blocks = 0;
+    for (std::size_t i = 0; i < readers; ++i) {
+        std::unique_ptr<StorageBackend> backend = make_backend();
+        blocks = backend->block_count();
+        MscConfig config;
+        config.device_type = MscDeviceType::CdRom;
+        config.readahead.enabled = false; // 随机读，预读只会干扰
+        std::vector<MscLun> luns;
+        luns.push_back(MscLun{std::move(backend), config, true});
+        auto device = make_msc_device(string_pool, std::move(luns));
+        device->busid = "1-" + std::to_string(i + 1);
+        server.add_device(std::move(device));
+    }
+    asio::ip::tcp::endpoint ep{asio::ip::address_v4::loopback(), 0};
+    if (server.start(ep)) {
+        std::printf("%s: server start failed\n", name);
+        return;
+    }
+
+    std::vector<ReaderStats> stats(readers);
+    std::atomic<std::size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < readers; ++i) {
+        threads.emplace_back([&, i] {
+            asio::io_context io;
+            UsbIpTestClient client(io);
+            std::error_code ec;
+            client.socket().connect(ep, ec);
+            bool imported = !ec && client.import("1-" + std::to_string(i + 1));
+            if (imported)
+                client.socket().set_option(asio::ip::tcp::no_delay(true));
+            ready.fetch_add(1);
+            while (!go.load())
+                std::this_thread::yield();
+            if (!imported) {
+                stats[i].errors = 1;
+                return;
+            }
+            BotTestClient bot(client);
+            std::mt19937_64 rng(i + 1);
+            std::vector<std::uint8_t> cdb(12, 0);
+            cdb[0] = ScsiCmd::Read12;
+            put_be32(cdb.data() + 6, READ_SECTORS);
+            Stopwatch total;
+            while (total.seconds() < seconds) {
+                put_be32(cdb.data() + 2, static_cast<std::uint32_t>(rng() % (blocks - READ_SECTORS)));
+                Stopwatch sw;
+                auto r = bot.command(0, cdb, READ_SECTORS * SECTOR);
+                stats[i].latencies_us.push_back(sw.microseconds());
+                if (r.csw.bCSWStatus != 0 || r.data.size() != READ_SECTORS * SECTOR)
+                    ++stats[i].errors;
+                ++stats[i].ops;
+            }
+            client.socket().close();
+        });
+    }
+    while (ready.load() < readers)
+        std::this_thread::yield();
+    Stopwatch wall;
+    go.store(true);
+    for (auto &t: threads)
+        t.join();
+    auto secs = wall.seconds();
+
+    ReaderStats all;
+    for (auto &s: stats) {
+        all.ops += s.ops;
+        all.errors += s.errors;
+        all.latencies_us.insert(all.latencies_us.end(), s.latencies_us.begin(), s.latencies_us.end());
+    }
+    // 设备（及其后端）仍在 Server 里，此时的映射数与页表反映稳态占用
+    std::printf("%-7s %7zu %10.1f %10.0f %9.1f %9.1f %9zu %10zu %8.1f %6llu\n", name, readers,
+                mib_per_sec(all.ops * READ_SECTORS * SECTOR, secs), static_cast<double>(all.ops) / secs,
+                percentile(all.latencies_us, 50), percentile(all.latencies_us, 99), count_mappings(path),
+                page_table_kib(), mib(current_rss_bytes()), static_cast<unsigned long long>(all.errors));
+    server.stop();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3.0;
+    std::uint64_t image_mib = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 512;
+    std::size_t readers = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 50;
+    spdlog::set_level(spdlog::level::warn);
+
+    ScratchDir dir("shared_image");
+    auto path = std::filesystem::weakly_canonical(dir.file("disc.iso")).string();
+    make_image(path, image_mib * 1024 * 1024);
+    warm_page_cache(path);
+
+    std::printf("%llu MiB image, %zu readers, random 64K READ(12), %.1f s each\n",
+                static_cast<unsigned long long>(image_mib), readers, seconds);
+    std::printf("%-7s %7s %10s %10s %9s %9s %9s %10s %8s %6s\n", "backend", "readers", "MiB/s", "IOPS", "p50 us",
+                "p99 us", "mappings", "VmPTE KiB", "RSS MiB", "errors");
+
+    run("raw", path, readers, seconds,
+        [&] { return std::make_unique<RawImageBackend>(path, 0, SECTOR, DurabilityConfig{WriteDurability::Unsafe}); });
+    run("shared", path, readers, seconds, [&] { return std::make_unique<SharedImageBackend>(path); });
+    return 0;
+}
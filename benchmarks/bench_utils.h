@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace usbipdcpp {
+namespace bench {
+
+/// 单调时钟计时器
+class Stopwatch {
+public:
+    Stopwatch() : start_(std::chrono::steady_clock::now()) {
+    }
+
+    void reset() {
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    [[nodiscard]] double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+    [[nodiscard]] double microseconds() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+/// 当前进程常驻内存（RSS），非 Linux 平台返回 0
+inline std::size_t current_rss_bytes() {
+#ifdef __linux__
+    // /proc/self/statm 第二列为常驻页数
+    std::FILE *f = std::fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+    unsigned long size = 0, resident = 0;
+    int n = std::fscanf(f, "%lu %lu", &size, &resident);
+    std::fclose(f);
+    if (n != 2)
+        return 0;
+    return static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+/// 百分位数（p 取 0..100），会对 samples 排序
+inline double percentile(std::vector<double> &samples, double p) {
+    if (samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    auto idx = static_cast<std::size_t>(p / 100.0 * static_cast<double>(samples.size() - 1) + 0.5);
+    return samples[std::min(idx, samples.size() - 1)];
+}
+
+inline double mib_per_sec(std::uint64_t bytes, double seconds) {
+    return seconds > 0 ? static_cast<double>(bytes) / 1024.0 / 1024.0 / seconds : 0;
+}
+
+inline double mib(std::uint64_t bytes) {
+    return static_cast<double>(bytes) / 1024.0 / 1024.0;
+}
+
+/// 基准用临时目录（构造时清空，析构时删除）
+class ScratchDir {
+public:
+    explicit ScratchDir(const std::string &name) :
+        path_(std::filesystem::temp_directory_path() / ("usbipdcpp_bench_" + name)) {
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+    }
+
+    ~ScratchDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+
+    [[nodiscard]] std::string file(const std::string &name) const {
+        return (path_ / name).string();
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+} // namespace bench
+} // namespace usbipdcpp
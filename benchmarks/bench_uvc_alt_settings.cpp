@@ -0,0 +1,211 @@
+/**
+ * UVC 等时带宽档位：小分辨率 vs 大分辨率每秒实际传输与占用的字节数。
+ *
+ * 用法: bench_uvc_alt_settings [秒数=3] [在途 URB 数=5]
+ *
+ * 进程内 Server 导出一个 30 fps 多分辨率彩条 UVC 设备，客户端按主机驱动的方式 PROBE/COMMIT，
+ * 取设备报告的 dwMaxPayloadTransferSize，选每微帧字节数不小于它的最小 alt（uvcvideo 的规则），
+ * 再按总线节奏提交等时 URB：每 URB 32 个包 = 32 个微帧 = 4 ms，收到回复后等到该 URB 的总线时刻
+ * 才补交下一个。两种端点布局：
+ *   graded：128 B 到 3×1024 B 六档 alt（mock_uvc 的布局）
+ *   fixed ：只有一档 3×1024 B 的 alt，任何分辨率都占满最大带宽
+ * 报告所选 alt 的包长、预留带宽（包长 × 8000 微帧/秒）、主机 URB 缓冲字节/秒、
+ * 线上实际字节/秒（USB/IP 头 + 数据 + 等时描述符）、视频字节/秒、缓冲填充率与帧率。
+ */
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "usbip_test_client.h"
+#include "uvc_test_device.h"
+#include "usbipdcpp/Server.h"
+#include "usbipdcpp/virtual_device/video_sources/ColorBarSource.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+using namespace usbipdcpp::test;
+
+namespace {
+
+constexpr std::uint32_t PACKETS_PER_URB = 32;
+constexpr auto URB_PERIOD = std::chrono::microseconds(125 * PACKETS_PER_URB);
+constexpr std::uint8_t FPS = 30;
+
+const std::vector<std::pair<std::uint16_t, std::uint16_t>> SIZES = {
+        {160, 120}, {320, 240}, {640, 480}, {1280, 720}};
+
+struct Layout {
+    const char *name;
+    std::vector<std::uint16_t> packet_sizes;
+};
+
+/// uvcvideo 的选法：每微帧字节数不小于 payload 的最小 alt，都不够时取最大的
+std::pair<std::uint8_t, std::uint32_t> choose_alt(const std::vector<std::uint16_t> &sizes, std::uint32_t payload) {
+    std::uint8_t best = 0;
+    std::uint32_t best_capacity = 0;
+    std::uint8_t largest = 0;
+    std::uint32_t largest_capacity = 0;
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        auto capacity = UvcVideoStreamingHandler::iso_packet_capacity(sizes[i]);
+        if (capacity >= payload && (best == 0 || capacity < best_capacity)) {
+            best = static_cast<std::uint8_t>(i + 1);
+            best_capacity = capacity;
+        }
+        if (capacity > largest_capacity) {
+            largest = static_cast<std::uint8_t>(i + 1);
+            largest_capacity = capacity;
+        }
+    }
+    return best != 0 ? std::make_pair(best, best_capacity) : std::make_pair(largest, largest_capacity);
+}
+
+void submit(UsbIpTestClient &client, std::uint32_t seqnum, std::uint32_t packet_size) {
+    std::vector<std::uint8_t> pkt;
+    UsbIpTestClient::append_submit(pkt, seqnum, client.devid(), UVC_STREAM_EP, true, PACKETS_PER_URB * packet_size,
+                                   nullptr, {}, PACKETS_PER_URB);
+    for (std::uint32_t i = 0; i < PACKETS_PER_URB; ++i) {
+        std::uint32_t desc[4] = {i * packet_size, packet_size, 0, 0};
+        for (auto v: desc) {
+            pkt.push_back(static_cast<std::uint8_t>(v >> 24));
+            pkt.push_back(static_cast<std::uint8_t>(v >> 16));
+            pkt.push_back(static_cast<std::uint8_t>(v >> 8));
+            pkt.push_back(static_cast<std::uint8_t>(v));
+        }
+    }
+    asio::write(client.socket(), asio::buffer(pkt));
+}
+
+void run(const Layout &layout, std::uint8_t frame_index, double seconds, std::size_t depth) {
+    auto [width, height] = SIZES[frame_index - 1];
+    StringPool string_pool;
+    Server server;
+    server.add_device(
+            make_uvc_device(string_pool, std::make_unique<ColorBarSource>(SIZES, FPS), false, layout.packet_sizes));
+    asio::ip::tcp::endpoint ep{asio::ip::address_v4::loopback(), 0};
+    if (server.start(ep)) {
+        std::printf("%s: server start failed\n", layout.name);
+        return;
+    }
+
+    asio::io_context io;
+    UsbIpTestClient client(io);
+    std::error_code ec;
+    client.socket().connect(ep, ec);
+    if (ec || !client.import("1-1")) {
+        std::printf("%s: import failed\n", layout.name);
+        server.stop();
+        return;
+    }
+    client.socket().set_option(asio::ip::tcp::no_delay(true));
+
+    auto ctrl = uvc_negotiate(client, 1, frame_index);
+    auto [alt, packet_size] = choose_alt(layout.packet_sizes, ctrl.dwMaxPayloadTransferSize);
+    client.control(0x01, static_cast<std::uint8_t>(StandardRequest::SetInterface), alt, UVC_VS_INTERFACE, 0);
+
+    UvcFrameAssembler assembler;
+    std::uint32_t seqnum = 1000;
+    for (std::size_t i = 0; i < depth; ++i)
+        submit(client, ++seqnum, packet_size);
+
+    std::uint64_t completed = 0;
+    std::uint64_t wire_bytes = 0;
+    std::uint64_t video_bytes = 0;
+    std::uint64_t first_frames = 0;
+    std::vector<std::uint8_t> data;
+    std::vector<std::uint8_t> descs;
+    bool warm = false;
+    Stopwatch measured;
+    auto start = std::chrono::steady_clock::now();
+    auto total = static_cast<std::uint64_t>((seconds + 0.5) / 0.004);
+    auto warmup = static_cast<std::uint64_t>(0.5 / 0.004);
+    for (std::uint64_t urb = 0; urb < total; ++urb) {
+        // 前 0.5 秒热身，之后开始计数
+        if (!warm && urb == warmup) {
+            warm = true;
+            first_frames = assembler.frames();
+            measured.reset();
+        }
+        std::array<std::uint8_t, 48> head{};
+        asio::read(client.socket(), asio::buffer(head));
+        auto actual = UsbIpTestClient::be32(&head[24]);
+        auto packets = UsbIpTestClient::be32(&head[32]);
+        data.resize(actual);
+        if (actual > 0)
+            asio::read(client.socket(), asio::buffer(data));
+        std::uint64_t urb_wire = head.size() + actual;
+        if (packets != 0 && packets != 0xFFFFFFFF) {
+            descs.resize(packets * 16);
+            asio::read(client.socket(), asio::buffer(descs));
+            urb_wire += descs.size();
+            std::size_t offset = 0;
+            for (std::uint32_t i = 0; i < packets; ++i) {
+                auto len = UsbIpTestClient::be32(&descs[i * 16 + 8]);
+                assembler.push_iso_packet(data.data() + offset, len);
+                if (warm && len > UVC_PAYLOAD_HEADER_SIZE)
+                    video_bytes += len - UVC_PAYLOAD_HEADER_SIZE;
+                offset += len;
+            }
+        }
+        if (warm) {
+            ++completed;
+            wire_bytes += urb_wire;
+        }
+        // 总线节奏：这个 URB 的 32 个微帧过完才补交下一个
+        std::this_thread::sleep_until(start + URB_PERIOD * (urb + 1));
+        submit(client, ++seqnum, packet_size);
+    }
+    auto secs = measured.seconds();
+    // 排空在途 URB 再断开
+    for (std::size_t i = 0; i < depth; ++i) {
+        std::array<std::uint8_t, 48> head{};
+        asio::read(client.socket(), asio::buffer(head), ec);
+        if (ec)
+            break;
+        auto actual = UsbIpTestClient::be32(&head[24]);
+        auto packets = UsbIpTestClient::be32(&head[32]);
+        data.resize(actual + ((packets != 0 && packets != 0xFFFFFFFF) ? packets * 16 : 0));
+        asio::read(client.socket(), asio::buffer(data), ec);
+    }
+    client.socket().close();
+
+    auto frames = assembler.frames() - first_frames;
+    auto buffer_bytes = completed * PACKETS_PER_URB * packet_size;
+    char format[16];
+    std::snprintf(format, sizeof(format), "%ux%u", width, height);
+    std::printf("%-7s %-10s %4u %5u %10.2f %10.2f %10.2f %10.2f %6.1f%% %6.1f\n", layout.name, format, alt,
+                packet_size, static_cast<double>(packet_size) * 8000 / 1024 / 1024, mib_per_sec(buffer_bytes, secs),
+                mib_per_sec(wire_bytes, secs), mib_per_sec(video_bytes, secs),
+                buffer_bytes ? 100.0 * static_cast<double>(video_bytes) / static_cast<double>(buffer_bytes) : 0.0,
+                static_cast<double>(frames) / secs);
+    server.stop();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3.0;
+    std::size_t depth = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+    spdlog::set_level(spdlog::level::warn);
+
+    std::printf("YUY2 color bars @ %u fps, %u packets per URB paced at %lld us, %zu URBs in flight, %.1f s each\n",
+                FPS, PACKETS_PER_URB, static_cast<long long>(URB_PERIOD.count()), depth, seconds);
+    std::printf("%-7s %-10s %4s %5s %10s %10s %10s %10s %7s %6s\n", "layout", "format", "alt", "psize", "rsv MiB/s",
+                "buf MiB/s", "wire MiB/s", "video MiB/s", "fill", "fps");
+
+    const Layout layouts[] = {
+            {"graded", {128, 256, 512, 1024, 0x0C00, 0x1400}},
+            {"fixed", {0x1400}},
+    };
+    for (std::uint8_t frame_index = 1; frame_index <= SIZES.size(); ++frame_index)
+        for (const auto &layout: layouts)
+            run(layout, frame_index, seconds, depth);
+    return 0;
+}
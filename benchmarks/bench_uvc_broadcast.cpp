@@ -0,0 +1,230 @@
+/**
+ * 一路视频分发给多个 UVC 设备：VideoBroadcaster vs 每个设备各跑一条源流水线的 CPU 开销。
+ *
+ * 用法: bench_uvc_broadcast [每项秒数=2] [宽=1280] [高=720]
+ *
+ * 源流水线模拟 "解码 → 格式转换 → 编码"：预生成的 RGB24 帧每帧转成 YUY2（yuy2），
+ * 有 libjpeg 时再经 MjpegEncoderSource 编码（mjpeg）。每个订阅者一个线程按 30 fps 取帧并读遍帧数据
+ * （相当于 handler 发送时读帧内存），N = 1 / 4 / 16：
+ *   independent：每个订阅者各自一条流水线（包在 AsyncVideoSource 里），源工作量 × N
+ *   broadcast  ：一条流水线进 VideoBroadcaster，N 个 BroadcastVideoSource 共享每一帧
+ * 报告进程 CPU 占用（100% = 一个核）、每订阅者平均帧率、订阅者侧丢帧率；
+ * 最后一行在 16 个订阅者之外加一个每 200ms 才取一帧的慢订阅者，看其余订阅者的帧率是否受影响。
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "usbipdcpp/virtual_device/UvcConstants.h"
+#include "usbipdcpp/virtual_device/video_sources/AsyncVideoSource.h"
+#include "usbipdcpp/virtual_device/video_sources/MjpegEncoderSource.h"
+#include "usbipdcpp/virtual_device/video_sources/PixelConvert.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoBroadcaster.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+
+namespace {
+
+constexpr std::uint32_t INTERVAL_30FPS = 333333;
+
+/// 循环播放预生成的 RGB24 帧，每次 get_frame 转成 YUY2（代替解码后的格式转换）
+class RgbConvertingSource : public VideoSource {
+public:
+    RgbConvertingSource(std::uint16_t width, std::uint16_t height) : width_(width), height_(height) {
+        for (int f = 0; f < 4; ++f) {
+            std::vector<std::uint8_t> frame(pixel_image_size(PixelFormat::RGB24, width, height));
+            for (int y = 0; y < height; ++y)
+                for (int x = 0; x < width; ++x) {
+                    auto *p = &frame[(static_cast<std::size_t>(y) * width + x) * 3];
+                    p[0] = static_cast<std::uint8_t>(x + f * 16);
+                    p[1] = static_cast<std::uint8_t>(y * 255 / height);
+                    p[2] = static_cast<std::uint8_t>((x ^ y) + f);
+                }
+            rgb_.push_back(std::move(frame));
+        }
+        yuy2_.resize(pixel_image_size(PixelFormat::YUY2, width, height));
+    }
+
+    std::vector<VideoFormatInfo> supported_formats() const override {
+        return {current_format()};
+    }
+
+    VideoFormatInfo current_format() const override {
+        return {UvcFourCC::YUY2, width_, height_, static_cast<std::uint32_t>(yuy2_.size()), INTERVAL_30FPS,
+                INTERVAL_30FPS,  INTERVAL_30FPS, 16};
+    }
+
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height, std::uint32_t) override {
+        return fourcc == UvcFourCC::YUY2 && width == width_ && height == height_;
+    }
+
+    bool get_frame(VideoFrame &frame) override {
+        auto &rgb = rgb_[next_++ % rgb_.size()];
+        convert_pixels(PixelFormat::RGB24, pixel_image_planes(PixelFormat::RGB24, rgb.data(), width_, height_),
+                       PixelFormat::YUY2, pixel_image_planes(PixelFormat::YUY2, yuy2_.data(), width_, height_), width_,
+                       height_);
+        frame = {yuy2_.data(), yuy2_.size(), true, nullptr};
+        return true;
+    }
+
+    std::size_t max_frame_size() const override {
+        return yuy2_.size();
+    }
+
+    std::uint32_t frame_interval() const override {
+        return INTERVAL_30FPS;
+    }
+
+private:
+    std::uint16_t width_;
+    std::uint16_t height_;
+    std::vector<std::vector<std::uint8_t>> rgb_;
+    std::vector<std::uint8_t> yuy2_;
+    std::size_t next_ = 0;
+};
+
+std::unique_ptr<VideoSource> make_pipeline(bool mjpeg, std::uint16_t width, std::uint16_t height) {
+    std::unique_ptr<VideoSource> source = std::make_unique<RgbConvertingSource>(width, height);
+    if (mjpeg) {
+        MjpegEncoderOptions options;
+        options.threads = 1;
+        auto encoder = std::make_unique<MjpegEncoderSource>(std::move(source), options);
+        encoder->set_format(UvcFourCC::MJPEG, width, height, INTERVAL_30FPS);
+        source = std::move(encoder);
+    }
+    return source;
+}
+
+/// 进程 CPU 时间（所有线程，秒）
+double process_cpu_seconds() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+struct RunResult {
+    double cpu_percent;
+    double fps; // 按时取帧的订阅者平均新帧率
+    double drop_percent; // 订阅者没取到的源帧占比（broadcast）
+    double slow_fps; // 慢订阅者的新帧率（没有时为 0）
+};
+
+/// 订阅者线程：每 period 取一帧，读遍帧数据，统计新帧数（数据指针换了才算新帧）
+void consume(VideoSource &source, std::chrono::microseconds period, double seconds, std::uint64_t &new_frames,
+             std::atomic<std::uint64_t> &checksum) {
+    VideoFrame frame{};
+    const std::uint8_t *last = nullptr;
+    std::uint64_t sum = 0;
+    auto next = std::chrono::steady_clock::now();
+    Stopwatch sw;
+    while (sw.seconds() < seconds) {
+        next += period;
+        std::this_thread::sleep_until(next);
+        if (!source.get_frame(frame) || frame.size == 0)
+            continue;
+        if (frame.data != last) {
+            ++new_frames;
+            last = frame.data;
+            for (std::size_t i = 0; i < frame.size; i += 64)
+                sum += frame.data[i];
+        }
+    }
+    checksum += sum;
+}
+
+RunResult run(bool broadcast, bool mjpeg, int subscribers, bool with_slow, std::uint16_t width, std::uint16_t height,
+              double seconds) {
+    const auto period = std::chrono::microseconds(INTERVAL_30FPS / 10);
+    std::vector<std::unique_ptr<VideoSource>> sources;
+    std::shared_ptr<VideoBroadcaster> broadcaster;
+    int total = subscribers + (with_slow ? 1 : 0);
+    if (broadcast) {
+        broadcaster = VideoBroadcaster::create(make_pipeline(mjpeg, width, height));
+        for (int i = 0; i < total; ++i)
+            sources.push_back(broadcaster->subscribe());
+    }
+    else {
+        for (int i = 0; i < total; ++i)
+            sources.push_back(std::make_unique<AsyncVideoSource>(make_pipeline(mjpeg, width, height)));
+    }
+
+    // 热身：流水线出第一帧、缓冲池填满
+    VideoFrame frame{};
+    for (auto &source: sources) {
+        for (int i = 0; i < 200 && (!source->get_frame(frame) || frame.size == 0); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    frame = {};
+    auto produced_before = broadcaster ? broadcaster->stats().produced : 0;
+
+    std::vector<std::uint64_t> new_frames(total, 0);
+    std::atomic<std::uint64_t> checksum{0};
+    std::vector<std::thread> threads;
+    auto cpu_before = process_cpu_seconds();
+    Stopwatch sw;
+    for (int i = 0; i < total; ++i) {
+        auto p = with_slow && i == subscribers ? std::chrono::microseconds(200000) : period;
+        threads.emplace_back(consume, std::ref(*sources[i]), p, seconds, std::ref(new_frames[i]), std::ref(checksum));
+    }
+    for (auto &t: threads)
+        t.join();
+    auto wall = sw.seconds();
+    auto cpu = process_cpu_seconds() - cpu_before;
+
+    RunResult result{};
+    result.cpu_percent = cpu / wall * 100;
+    std::uint64_t on_time = 0;
+    for (int i = 0; i < subscribers; ++i)
+        on_time += new_frames[i];
+    result.fps = static_cast<double>(on_time) / subscribers / wall;
+    if (with_slow)
+        result.slow_fps = static_cast<double>(new_frames[subscribers]) / wall;
+    if (broadcaster) {
+        auto produced = static_cast<double>(broadcaster->stats().produced - produced_before);
+        if (produced > 0)
+            result.drop_percent = std::max(0.0, 100.0 - static_cast<double>(on_time) / subscribers / produced * 100);
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    auto width = static_cast<std::uint16_t>(argc > 2 ? std::atoi(argv[2]) : 1280);
+    auto height = static_cast<std::uint16_t>(argc > 3 ? std::atoi(argv[3]) : 720);
+    spdlog::set_level(spdlog::level::warn);
+
+    std::vector<bool> pipelines{false};
+    if (MjpegEncoderSource::available())
+        pipelines.push_back(true);
+
+    std::printf("%ux%u @ 30 fps, %.1f s per case, %u hardware threads\n", width, height, seconds,
+                std::max(1u, std::thread::hardware_concurrency()));
+    std::printf("%-6s %-12s %5s %8s %12s %8s %10s\n", "source", "mode", "subs", "CPU %", "fps/sub", "drop %",
+                "slow fps");
+    for (bool mjpeg: pipelines) {
+        for (int subscribers: {1, 4, 16})
+            for (bool broadcast: {false, true}) {
+                auto r = run(broadcast, mjpeg, subscribers, false, width, height, seconds);
+                char drop[16] = "-";
+                if (broadcast)
+                    std::snprintf(drop, sizeof(drop), "%.1f", r.drop_percent);
+                std::printf("%-6s %-12s %5d %8.1f %12.1f %8s %10s\n", mjpeg ? "mjpeg" : "yuy2",
+                            broadcast ? "broadcast" : "independent", subscribers, r.cpu_percent, r.fps, drop, "-");
+            }
+        auto r = run(true, mjpeg, 16, true, width, height, seconds);
+        std::printf("%-6s %-12s %5s %8.1f %12.1f %8.1f %10.1f\n", mjpeg ? "mjpeg" : "yuy2", "broadcast", "16+1",
+                    r.cpu_percent, r.fps, r.drop_percent, r.slow_fps);
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+/**
+ * UVC 帧交付的拷贝量：旧接口（handler 整帧拷贝）vs 池化引用计数帧（handler 直接持有）。
+ *
+ * 用法: bench_uvc_frame_copy [秒数=3] [在途 URB 数=5]
+ *
+ * 进程内 Server 导出批量模式 UVC 设备，源每帧重新生成画面（模拟摄像头 / 解码器这类实时源）：
+ *   legacy：写进源自己的 vector，不给 owner —— handler 先整帧拷到自己的缓冲
+ *   pooled：写进 VideoFramePool 借出的缓冲并交出 owner —— handler 直接持有
+ * 客户端 URB = payload = 整帧，一个 URB 拿完一帧。报告帧率、每帧 handler 侧拷贝字节数
+ * （整帧拷贝 / 拷进 URB 缓冲，取自 UvcVideoStreamingHandler::stream_stats）与池的分配次数。
+ * URB 默认从帧内存 gather write，后者为 0；gather 与拷贝发送的 CPU 开销对比见 bench_uvc_gather。
+ */
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "usbip_test_client.h"
+#include "uvc_test_device.h"
+#include "usbipdcpp/Server.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+using namespace usbipdcpp::test;
+
+namespace {
+
+/// 每帧重画的 YUY2 源（亮度随帧号变化），不限帧率；pooled 决定走哪种交付方式
+class LiveSource : public VideoSource {
+public:
+    LiveSource(std::uint16_t width, std::uint16_t height, bool pooled) :
+        width_(width), height_(height), pooled_(pooled) {
+        if (pooled_)
+            pool_ = VideoFramePool::create(max_frame_size());
+        else
+            buffer_.resize(max_frame_size());
+    }
+
+    std::vector<VideoFormatInfo> supported_formats() const override {
+        auto size = static_cast<std::uint32_t>(max_frame_size());
+        return {{UvcFourCC::YUY2, width_, height_, size, 333333u, 333333u, 333333u, 16}};
+    }
+
+    VideoFormatInfo current_format() const override {
+        return supported_formats().front();
+    }
+
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height, std::uint32_t) override {
+        return fourcc == UvcFourCC::YUY2 && width == width_ && height == height_;
+    }
+
+    bool get_frame(VideoFrame &frame) override {
+        auto luma = static_cast<std::uint8_t>(16 + (counter_++ % 220));
+        if (pooled_) {
+            auto buffer = pool_->acquire();
+            std::memset(buffer->data(), luma, max_frame_size());
+            buffer->set_size(max_frame_size());
+            frame = make_video_frame(std::move(buffer));
+        }
+        else {
+            std::memset(buffer_.data(), luma, buffer_.size());
+            frame.data = buffer_.data();
+            frame.size = buffer_.size();
+            frame.is_keyframe = true;
+            frame.owner.reset();
+        }
+        return true;
+    }
+
+    std::size_t max_frame_size() const override {
+        return static_cast<std::size_t>(width_) * height_ * 2;
+    }
+
+    std::uint32_t frame_interval() const override {
+        return 0;
+    }
+
+    std::uint64_t pool_allocations() const {
+        return pool_ ? pool_->stats().allocations : 0;
+    }
+
+private:
+    std::uint16_t width_;
+    std::uint16_t height_;
+    bool pooled_;
+    std::uint64_t counter_ = 0;
+    std::vector<std::uint8_t> buffer_;
+    std::shared_ptr<VideoFramePool> pool_;
+};
+
+void run(const char *name, std::uint16_t width, std::uint16_t height, bool pooled, double seconds,
+         std::size_t depth) {
+    const auto frame_size = static_cast<std::size_t>(width) * height * 2;
+    const auto urb_length = static_cast<std::uint32_t>(frame_size + UVC_PAYLOAD_HEADER_SIZE);
+
+    StringPool string_pool;
+    Server server;
+    auto source = std::make_unique<LiveSource>(width, height, pooled);
+    auto *live = source.get();
+    auto device = make_uvc_device(string_pool, std::move(source), true);
+    auto &handler = uvc_streaming_handler(*device);
+    handler.set_bulk_payload_size(urb_length);
+    server.add_device(std::move(device));
+    asio::ip::tcp::endpoint ep{asio::ip::address_v4::loopback(), 0};
+    if (server.start(ep)) {
+        std::printf("%s: server start failed\n", name);
+        return;
+    }
+
+    asio::io_context io;
+    UsbIpTestClient client(io);
+    std::error_code ec;
+    client.socket().connect(ep, ec);
+    if (ec || !client.import("1-1")) {
+        std::printf("%s: import failed\n", name);
+        server.stop();
+        return;
+    }
+    client.socket().set_option(asio::ip::tcp::no_delay(true));
+    auto ctrl = uvc_negotiate(client);
+
+    UvcFrameAssembler assembler(ctrl.dwMaxPayloadTransferSize);
+    std::uint32_t seqnum = 1000;
+    auto submit = [&] {
+        std::vector<std::uint8_t> pkt;
+        UsbIpTestClient::append_submit(pkt, ++seqnum, client.devid(), UVC_STREAM_EP, true, urb_length);
+        asio::write(client.socket(), asio::buffer(pkt));
+    };
+    for (std::size_t i = 0; i < depth; ++i)
+        submit();
+
+    std::vector<std::uint8_t> data;
+    UvcVideoStreamingHandler::StreamStats first{};
+    std::uint64_t first_frames = 0;
+    Stopwatch total;
+    Stopwatch measured;
+    bool warm = false;
+    while (total.seconds() < seconds + 0.5) {
+        if (!warm && total.seconds() >= 0.5) {
+            warm = true;
+            first = handler.stream_stats();
+            first_frames = assembler.frames();
+            measured.reset();
+        }
+        std::array<std::uint8_t, 48> head{};
+        asio::read(client.socket(), asio::buffer(head));
+        auto actual = UsbIpTestClient::be32(&head[24]);
+        data.resize(actual);
+        if (actual > 0)
+            asio::read(client.socket(), asio::buffer(data));
+        assembler.push_bulk(data.data(), actual, urb_length);
+        submit();
+    }
+    auto secs = measured.seconds();
+    auto last = handler.stream_stats();
+    for (std::size_t i = 0; i < depth; ++i) {
+        std::array<std::uint8_t, 48> head{};
+        asio::read(client.socket(), asio::buffer(head), ec);
+        if (ec)
+            break;
+        data.resize(UsbIpTestClient::be32(&head[24]));
+        asio::read(client.socket(), asio::buffer(data), ec);
+    }
+    client.socket().close();
+
+    auto frames = assembler.frames() - first_frames;
+    auto src_frames = last.frames - first.frames;
+    auto per_frame = [&](std::uint64_t bytes) {
+        return src_frames ? mib(bytes) / static_cast<double>(src_frames) : 0.0;
+    };
+    std::printf("%-16s %8.1f %10.1f %14.2f %12.2f %8llu %7llu\n", name, static_cast<double>(frames) / secs,
+                mib_per_sec(frames * frame_size, secs), per_frame(last.frame_copy_bytes - first.frame_copy_bytes),
+                per_frame(last.payload_copy_bytes - first.payload_copy_bytes),
+                static_cast<unsigned long long>(live->pool_allocations()),
+                static_cast<unsigned long long>(assembler.errors()));
+    server.stop();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3.0;
+    std::size_t depth = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+    spdlog::set_level(spdlog::level::warn);
+
+    std::printf("bulk YUY2, one URB per frame, %zu URBs in flight, %.1f s each\n", depth, seconds);
+    std::printf("%-16s %8s %10s %14s %12s %8s %7s\n", "source", "fps", "MiB/s", "frame MiB/frm", "URB MiB/frm",
+                "allocs", "errors");
+    run("1080p legacy", 1920, 1080, false, seconds, depth);
+    run("1080p pooled", 1920, 1080, true, seconds, depth);
+    run("4K legacy", 3840, 2160, false, seconds, depth);
+    run("4K pooled", 3840, 2160, true, seconds, depth);
+    return 0;
+}
@@ -0,0 +1,249 @@
+/**
+ * UVC 流 URB 的发送路径：从帧内存 gather write vs 先拷成连续缓冲再发，每 MiB 视频数据的设备侧 CPU。
+ *
+ * 用法: bench_uvc_gather [秒数=3] [在途 URB 数=5]
+ *
+ * 进程内 Server 导出 1080p YUY2 UVC 设备（不限帧率彩条，帧由源共享、handler 不整帧拷贝），
+ * 客户端保持 N 个 URB 在途、读完即丢。gather / copy 由 UvcVideoStreamingHandler::set_gather_send 切换。
+ * 设备侧 = 整个进程减去客户端所在主线程：
+ *   CPU ms/MiB：CLOCK_PROCESS_CPUTIME_ID − CLOCK_THREAD_CPUTIME_ID
+ *   cycles/MiB：perf_event_open 计数（inherit 覆盖之后创建的 Server 线程，减去只计主线程的计数器）；
+ *               内核不允许时（容器、perf_event_paranoid）显示 n/a
+ * 仅 Linux。
+ */
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "usbip_test_client.h"
+#include "uvc_test_device.h"
+#include "usbipdcpp/Server.h"
+#include "usbipdcpp/virtual_device/video_sources/ColorBarSource.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+using namespace usbipdcpp::test;
+
+#ifdef __linux__
+namespace {
+
+constexpr std::uint16_t WIDTH = 1920;
+constexpr std::uint16_t HEIGHT = 1080;
+
+class UnthrottledColorBars : public ColorBarSource {
+public:
+    UnthrottledColorBars() : ColorBarSource(WIDTH, HEIGHT, 30) {
+    }
+
+    std::uint32_t frame_interval() const override {
+        return 0;
+    }
+};
+
+double cpu_seconds(clockid_t clock) {
+    timespec ts{};
+    clock_gettime(clock, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+/// 本线程（inherit 时连同之后创建的线程）的 CPU 周期数，打不开时 valid() 为 false
+class CycleCounter {
+public:
+    explicit CycleCounter(bool inherit) {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.disabled = 1;
+        attr.inherit = inherit ? 1 : 0;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    ~CycleCounter() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    CycleCounter(const CycleCounter &) = delete;
+    CycleCounter &operator=(const CycleCounter &) = delete;
+
+    [[nodiscard]] bool valid() const {
+        return fd_ >= 0;
+    }
+
+    /// inherit 的计数在子线程退出后才并入，须在线程全部结束后读
+    std::uint64_t read_value() const {
+        std::uint64_t value = 0;
+        if (fd_ < 0 || ::read(fd_, &value, sizeof(value)) != sizeof(value))
+            return 0;
+        return value;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+struct Mode {
+    const char *name;
+    bool bulk;
+    std::uint32_t packets; // 等时：每 URB 包数
+    std::uint32_t packet_size; // 等时：每包字节数
+    std::uint32_t urb_length; // 批量：每 URB 字节数（= payload 大小）
+};
+
+void submit(UsbIpTestClient &client, std::uint32_t seqnum, const Mode &mode) {
+    std::vector<std::uint8_t> pkt;
+    if (mode.bulk) {
+        UsbIpTestClient::append_submit(pkt, seqnum, client.devid(), UVC_STREAM_EP, true, mode.urb_length);
+    }
+    else {
+        UsbIpTestClient::append_submit(pkt, seqnum, client.devid(), UVC_STREAM_EP, true,
+                                       mode.packets * mode.packet_size, nullptr, {}, mode.packets);
+        for (std::uint32_t i = 0; i < mode.packets; ++i) {
+            std::uint32_t desc[4] = {i * mode.packet_size, mode.packet_size, 0, 0};
+            for (auto v: desc) {
+                pkt.push_back(static_cast<std::uint8_t>(v >> 24));
+                pkt.push_back(static_cast<std::uint8_t>(v >> 16));
+                pkt.push_back(static_cast<std::uint8_t>(v >> 8));
+                pkt.push_back(static_cast<std::uint8_t>(v));
+            }
+        }
+    }
+    asio::write(client.socket(), asio::buffer(pkt));
+}
+
+void run(const Mode &mode, bool gather, double seconds, std::size_t depth) {
+    // 计数器先于 Server 打开：inherit 才能覆盖 Server 之后创建的全部线程
+    CycleCounter all_cycles(true);
+    CycleCounter main_cycles(false);
+    auto process0 = cpu_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    auto main0 = cpu_seconds(CLOCK_THREAD_CPUTIME_ID);
+
+    std::uint64_t video_bytes = 0;
+    double secs = 0;
+    {
+        StringPool string_pool;
+        Server server;
+        auto device = make_uvc_device(string_pool, std::make_unique<UnthrottledColorBars>(), mode.bulk,
+                                      {static_cast<std::uint16_t>(mode.packet_size)});
+        auto &handler = uvc_streaming_handler(*device);
+        handler.set_gather_send(gather);
+        if (mode.bulk)
+            handler.set_bulk_payload_size(mode.urb_length);
+        server.add_device(std::move(device));
+        asio::ip::tcp::endpoint ep{asio::ip::address_v4::loopback(), 0};
+        if (server.start(ep)) {
+            std::printf("%s: server start failed\n", mode.name);
+            return;
+        }
+
+        asio::io_context io;
+        UsbIpTestClient client(io);
+        std::error_code ec;
+        client.socket().connect(ep, ec);
+        if (ec || !client.import("1-1")) {
+            std::printf("%s: import failed\n", mode.name);
+            server.stop();
+            return;
+        }
+        client.socket().set_option(asio::ip::tcp::no_delay(true));
+        uvc_negotiate(client);
+        if (!mode.bulk)
+            client.control(0x01, static_cast<std::uint8_t>(StandardRequest::SetInterface), 1, UVC_VS_INTERFACE, 0);
+
+        std::uint32_t seqnum = 1000;
+        for (std::size_t i = 0; i < depth; ++i)
+            submit(client, ++seqnum, mode);
+        std::vector<std::uint8_t> data;
+        Stopwatch watch;
+        while (watch.seconds() < seconds) {
+            std::array<std::uint8_t, 48> head{};
+            asio::read(client.socket(), asio::buffer(head));
+            auto actual = UsbIpTestClient::be32(&head[24]);
+            auto packets = UsbIpTestClient::be32(&head[32]);
+            std::size_t rest = actual + ((packets != 0 && packets != 0xFFFFFFFF) ? packets * 16 : 0);
+            data.resize(rest);
+            if (rest > 0)
+                asio::read(client.socket(), asio::buffer(data));
+            // 扣掉每个 payload 的 2 字节头，只算视频数据
+            auto payloads = mode.bulk ? 1u : packets;
+            if (actual > payloads * UVC_PAYLOAD_HEADER_SIZE)
+                video_bytes += actual - payloads * UVC_PAYLOAD_HEADER_SIZE;
+            submit(client, ++seqnum, mode);
+        }
+        secs = watch.seconds();
+        for (std::size_t i = 0; i < depth; ++i) {
+            std::array<std::uint8_t, 48> head{};
+            asio::read(client.socket(), asio::buffer(head), ec);
+            if (ec)
+                break;
+            auto actual = UsbIpTestClient::be32(&head[24]);
+            auto packets = UsbIpTestClient::be32(&head[32]);
+            data.resize(actual + ((packets != 0 && packets != 0xFFFFFFFF) ? packets * 16 : 0));
+            asio::read(client.socket(), asio::buffer(data), ec);
+        }
+        client.socket().close();
+        server.stop();
+    }
+
+    auto device_cpu =
+            (cpu_seconds(CLOCK_PROCESS_CPUTIME_ID) - process0) - (cpu_seconds(CLOCK_THREAD_CPUTIME_ID) - main0);
+    auto mib_sent = mib(video_bytes);
+    char cycles[32] = "n/a";
+    if (all_cycles.valid() && main_cycles.valid() && mib_sent > 0) {
+        auto device_cycles = all_cycles.read_value() - main_cycles.read_value();
+        std::snprintf(cycles, sizeof(cycles), "%.0f", static_cast<double>(device_cycles) / mib_sent);
+    }
+    std::printf("%-12s %-7s %10.1f %12.3f %14s\n", mode.name, gather ? "gather" : "copy",
+                mib_per_sec(video_bytes, secs), mib_sent > 0 ? device_cpu * 1000.0 / mib_sent : 0.0, cycles);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3.0;
+    std::size_t depth = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+    spdlog::set_level(spdlog::level::warn);
+
+    std::printf("%dx%d YUY2, unthrottled source, %zu URBs in flight, %.1f s each\n", WIDTH, HEIGHT, depth, seconds);
+    std::printf("device side = whole process minus the client thread\n");
+    std::printf("%-12s %-7s %10s %12s %14s\n", "mode", "send", "MiB/s", "CPU ms/MiB", "cycles/MiB");
+
+    constexpr std::uint32_t KiB = 1024;
+    const Mode modes[] = {
+            {"iso 32x512", false, 32, 512, 0},
+            {"iso 32x1024", false, 32, 1024, 0},
+            {"bulk 16K", true, 0, 512, 16 * KiB},
+            {"bulk 512K", true, 0, 512, 512 * KiB},
+    };
+    for (const auto &mode: modes) {
+        run(mode, false, seconds, depth);
+        run(mode, true, seconds, depth);
+    }
+    return 0;
+}
+#else
+int main() {
+    std::printf("bench_uvc_gather: Linux only\n");
+    return 0;
+}
+#endif
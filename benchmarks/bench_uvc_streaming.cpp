@@ -0,0 +1,204 @@
+/**
+ * UVC 等时 vs 批量流：环回下 1080p YUY2 能跑到的帧率。
+ *
+ * 用法: bench_uvc_streaming [秒数=3] [在途 URB 数=5]
+ *
+ * 进程内 Server 导出一个 UVC 设备（源为不限帧率的 1920x1080 YUY2 彩条，帧时钟不起作用），
+ * 客户端像主机驱动一样完成 PROBE/COMMIT 开流后保持 N 个 URB 在途（uvcvideo 为 5），
+ * 按 uvcvideo 的规则重组 payload、数完整帧。几组配置：
+ *   iso 32x512 / 32x1024：每 URB 32 个等时包，每包 2 字节头（mock_uvc 的 alt 1 为 512）
+ *   bulk 16K：URB 16 KiB（Linux uvcvideo 批量 URB 上限 32 x wMaxPacketSize），payload 512 KiB
+ *   bulk 512K：URB = payload = 512 KiB（Windows usbvideo 按 dwMaxPayloadTransferSize 提交）
+ *   bulk frame：payload 覆盖整帧，一个 URB 拿完一帧
+ * 报告帧率、有效视频数据吞吐、每帧 URB / payload 数与重组错误数。
+ */
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "usbip_test_client.h"
+#include "uvc_test_device.h"
+#include "usbipdcpp/Server.h"
+#include "usbipdcpp/virtual_device/video_sources/ColorBarSource.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+using namespace usbipdcpp::test;
+
+namespace {
+
+constexpr std::uint16_t WIDTH = 1920;
+constexpr std::uint16_t HEIGHT = 1080;
+constexpr std::size_t FRAME_SIZE = static_cast<std::size_t>(WIDTH) * HEIGHT * 2;
+
+/// 不限帧率的彩条：frame_interval 为 0，handler 的帧时钟不等待，测的是传输上限
+class UnthrottledColorBars : public ColorBarSource {
+public:
+    UnthrottledColorBars() : ColorBarSource(WIDTH, HEIGHT, 30) {
+    }
+
+    std::uint32_t frame_interval() const override {
+        return 0;
+    }
+};
+
+struct Mode {
+    const char *name;
+    bool bulk;
+    std::uint32_t packets; // 等时：每 URB 包数
+    std::uint32_t packet_size; // 等时：每包字节数（端点 wMaxPacketSize）
+    std::uint32_t urb_length; // 批量：每 URB 字节数
+    std::uint32_t payload_size; // 批量：dwMaxPayloadTransferSize
+};
+
+void submit(UsbIpTestClient &client, std::uint32_t seqnum, const Mode &mode) {
+    std::vector<std::uint8_t> pkt;
+    if (mode.bulk) {
+        UsbIpTestClient::append_submit(pkt, seqnum, client.devid(), UVC_STREAM_EP, true, mode.urb_length);
+    }
+    else {
+        UsbIpTestClient::append_submit(pkt, seqnum, client.devid(), UVC_STREAM_EP, true,
+                                       mode.packets * mode.packet_size, nullptr, {}, mode.packets);
+        for (std::uint32_t i = 0; i < mode.packets; ++i) {
+            std::uint32_t desc[4] = {i * mode.packet_size, mode.packet_size, 0, 0};
+            for (auto v: desc) {
+                pkt.push_back(static_cast<std::uint8_t>(v >> 24));
+                pkt.push_back(static_cast<std::uint8_t>(v >> 16));
+                pkt.push_back(static_cast<std::uint8_t>(v >> 8));
+                pkt.push_back(static_cast<std::uint8_t>(v));
+            }
+        }
+    }
+    asio::write(client.socket(), asio::buffer(pkt));
+}
+
+void run(const Mode &mode, double seconds, std::size_t depth) {
+    StringPool string_pool;
+    Server server;
+    auto device = make_uvc_device(string_pool, std::make_unique<UnthrottledColorBars>(), mode.bulk,
+                                  {static_cast<std::uint16_t>(mode.packet_size)});
+    if (mode.bulk)
+        uvc_streaming_handler(*device).set_bulk_payload_size(mode.payload_size);
+    server.add_device(std::move(device));
+    asio::ip::tcp::endpoint ep{asio::ip::address_v4::loopback(), 0};
+    if (server.start(ep)) {
+        std::printf("%s: server start failed\n", mode.name);
+        return;
+    }
+
+    asio::io_context io;
+    UsbIpTestClient client(io);
+    std::error_code ec;
+    client.socket().connect(ep, ec);
+    if (ec || !client.import("1-1")) {
+        std::printf("%s: import failed\n", mode.name);
+        server.stop();
+        return;
+    }
+    client.socket().set_option(asio::ip::tcp::no_delay(true));
+
+    auto ctrl = uvc_negotiate(client);
+    if (!mode.bulk)
+        client.control(0x01, static_cast<std::uint8_t>(StandardRequest::SetInterface), 1, UVC_VS_INTERFACE, 0);
+
+    UvcFrameAssembler assembler(mode.bulk ? ctrl.dwMaxPayloadTransferSize : 0);
+    std::uint32_t seqnum = 1000;
+    for (std::size_t i = 0; i < depth; ++i)
+        submit(client, ++seqnum, mode);
+
+    std::uint64_t urbs = 0;
+    std::uint64_t failed_urbs = 0;
+    std::uint64_t first_frames = 0;
+    std::vector<std::uint8_t> data;
+    std::vector<std::uint8_t> descs;
+    Stopwatch total;
+    Stopwatch measured;
+    bool warm = false;
+    while (total.seconds() < seconds + 0.5) {
+        // 前 0.5 秒热身（建立连接缓冲、首帧），之后开始计数
+        if (!warm && total.seconds() >= 0.5) {
+            warm = true;
+            first_frames = assembler.frames();
+            measured.reset();
+        }
+        std::array<std::uint8_t, 48> head{};
+        asio::read(client.socket(), asio::buffer(head));
+        auto status = UsbIpTestClient::be32(&head[20]);
+        auto actual = UsbIpTestClient::be32(&head[24]);
+        auto packets = UsbIpTestClient::be32(&head[32]);
+        data.resize(actual);
+        if (actual > 0)
+            asio::read(client.socket(), asio::buffer(data));
+        if (status != 0)
+            ++failed_urbs;
+        if (mode.bulk) {
+            assembler.push_bulk(data.data(), actual, mode.urb_length);
+        }
+        else if (packets != 0 && packets != 0xFFFFFFFF) {
+            descs.resize(packets * 16);
+            asio::read(client.socket(), asio::buffer(descs));
+            std::size_t offset = 0;
+            for (std::uint32_t i = 0; i < packets; ++i) {
+                auto len = UsbIpTestClient::be32(&descs[i * 16 + 8]);
+                assembler.push_iso_packet(data.data() + offset, len);
+                offset += len;
+            }
+        }
+        if (warm)
+            ++urbs;
+        submit(client, ++seqnum, mode);
+    }
+    auto secs = measured.seconds();
+    // 排空在途 URB 再断开
+    for (std::size_t i = 0; i < depth; ++i) {
+        std::array<std::uint8_t, 48> head{};
+        asio::read(client.socket(), asio::buffer(head), ec);
+        if (ec)
+            break;
+        auto actual = UsbIpTestClient::be32(&head[24]);
+        auto packets = UsbIpTestClient::be32(&head[32]);
+        std::size_t rest = actual + ((packets != 0 && packets != 0xFFFFFFFF) ? packets * 16 : 0);
+        data.resize(rest);
+        asio::read(client.socket(), asio::buffer(data), ec);
+    }
+    client.socket().close();
+
+    auto frames = assembler.frames() - first_frames;
+    bool intact = assembler.last_frame().size() == FRAME_SIZE;
+    std::printf("%-12s %9.1f %10.1f %11.1f %13.1f %7llu %6s\n", mode.name, static_cast<double>(frames) / secs,
+                mib_per_sec(frames * FRAME_SIZE, secs), frames ? static_cast<double>(urbs) / frames : 0.0,
+                assembler.frames() ? static_cast<double>(assembler.payloads()) / assembler.frames() : 0.0,
+                static_cast<unsigned long long>(assembler.errors() + failed_urbs), intact ? "yes" : "no");
+    server.stop();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 3.0;
+    std::size_t depth = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+    spdlog::set_level(spdlog::level::warn);
+
+    std::printf("%dx%d YUY2 (%.1f MiB/frame), unthrottled source, %zu URBs in flight, %.1f s each\n", WIDTH, HEIGHT,
+                mib(FRAME_SIZE), depth, seconds);
+    std::printf("%-12s %9s %10s %11s %13s %7s %6s\n", "mode", "fps", "MiB/s", "URBs/frame", "payloads/frm",
+                "errors", "intact");
+
+    constexpr std::uint32_t KiB = 1024;
+    const Mode modes[] = {
+            {"iso 32x512", false, 32, 512, 0, 0},
+            {"iso 32x1024", false, 32, 1024, 0, 0},
+            {"bulk 16K", true, 0, 512, 16 * KiB, 512 * KiB},
+            {"bulk 512K", true, 0, 512, 512 * KiB, 512 * KiB},
+            {"bulk frame", true, 0, 512, static_cast<std::uint32_t>(FRAME_SIZE + UVC_PAYLOAD_HEADER_SIZE),
+             static_cast<std::uint32_t>(FRAME_SIZE + UVC_PAYLOAD_HEADER_SIZE)},
+    };
+    for (const auto &mode: modes)
+        run(mode, seconds, depth);
+    return 0;
+}
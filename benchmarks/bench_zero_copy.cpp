@@ -0,0 +1,230 @@
+/**
+ * 零拷贝 socket 收发：每 GiB 数据消耗的设备侧 CPU 时间。
+ *
+ * 用法: bench_zero_copy [每项 MiB=512]
+ *
+ * 经 TCP 环回模拟 StorageTransferOperator 的数据阶段，对不同 URB 大小比较：
+ *   READ(10)：raw 镜像 write 拷贝 vs sendfile，内存盘 write 拷贝 vs vmsplice
+ *   WRITE(10)：raw 镜像 read 进映射区 vs splice（sock → pipe → 文件）
+ * 只统计设备侧线程的 CPU（CLOCK_THREAD_CPUTIME_ID），对端收发数据的线程不计入。
+ * 仅 Linux。
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "bench_utils.h"
+#include "usbipdcpp/virtual_device/storage_backends/MemoryBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/RawImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/SplicePipePool.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::bench;
+
+#ifdef __linux__
+namespace {
+
+constexpr std::uint64_t DISK_BYTES = 64 * 1024 * 1024;
+
+double thread_cpu_seconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+/// TCP 环回连接，fds[0] 为设备侧
+struct TcpPair {
+    int fds[2] = {-1, -1};
+
+    TcpPair() {
+        int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        ::bind(listener, reinterpret_cast<sockaddr *>(&addr), len);
+        ::listen(listener, 1);
+        ::getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len);
+        fds[1] = ::socket(AF_INET, SOCK_STREAM, 0);
+        ::connect(fds[1], reinterpret_cast<sockaddr *>(&addr), len);
+        fds[0] = ::accept(listener, nullptr, nullptr);
+        ::close(listener);
+        int one = 1;
+        ::setsockopt(fds[0], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    ~TcpPair() {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+};
+
+bool write_all(int fd, const std::uint8_t *p, std::size_t n) {
+    while (n > 0) {
+        auto w = ::write(fd, p, n);
+        if (w <= 0)
+            return false;
+        p += w;
+        n -= static_cast<std::size_t>(w);
+    }
+    return true;
+}
+
+bool read_all(int fd, std::uint8_t *p, std::size_t n) {
+    while (n > 0) {
+        auto r = ::read(fd, p, n);
+        if (r <= 0)
+            return false;
+        p += r;
+        n -= static_cast<std::size_t>(r);
+    }
+    return true;
+}
+
+struct Result {
+    double cpu_seconds = 0;
+    double wall_seconds = 0;
+    std::uint64_t fallbacks = 0;
+};
+
+/** READ：设备侧按 urb 大小把 total 字节发给对端，direct 时走 send_direct，否则从映射区 write */
+Result run_read(StorageBackend &backend, std::size_t urb, std::uint64_t total, bool direct) {
+    TcpPair tcp;
+    std::thread sink([&] {
+        std::vector<std::uint8_t> buf(1024 * 1024);
+        for (std::uint64_t got = 0; got < total;) {
+            auto r = ::read(tcp.fds[1], buf.data(), buf.size());
+            if (r <= 0)
+                break;
+            got += static_cast<std::uint64_t>(r);
+        }
+    });
+    SplicePipePool pool;
+    Result result;
+    Stopwatch wall;
+    auto cpu0 = thread_cpu_seconds();
+    std::uint64_t offset = 0;
+    for (std::uint64_t sent = 0; sent < total; sent += urb) {
+        if (offset + urb > DISK_BYTES)
+            offset = 0;
+        auto lba = offset / backend.block_size();
+        auto in_block = static_cast<std::size_t>(offset % backend.block_size());
+        std::error_code ec;
+        bool done = false;
+        if (direct) {
+            done = backend.send_direct(lba, in_block, urb, tcp.fds[0], pool, ec);
+            if (ec)
+                break;
+            if (!done)
+                ++result.fallbacks;
+        }
+        if (!done)
+            write_all(tcp.fds[0], static_cast<std::uint8_t *>(backend.get_direct_buffer(lba)) + in_block, urb);
+        offset += urb;
+    }
+    result.cpu_seconds = thread_cpu_seconds() - cpu0;
+    ::shutdown(tcp.fds[0], SHUT_WR);
+    sink.join();
+    result.wall_seconds = wall.seconds();
+    return result;
+}
+
+/** WRITE：对端灌入 total 字节，设备侧按 urb 大小 recv_direct 或 read 进映射区 */
+Result run_write(StorageBackend &backend, std::size_t urb, std::uint64_t total, bool direct) {
+    TcpPair tcp;
+    std::thread source([&] {
+        std::vector<std::uint8_t> buf(1024 * 1024, 0x5A);
+        for (std::uint64_t sent = 0; sent < total;) {
+            auto n = static_cast<std::size_t>(std::min<std::uint64_t>(buf.size(), total - sent));
+            if (!write_all(tcp.fds[1], buf.data(), n))
+                break;
+            sent += n;
+        }
+    });
+    SplicePipePool pool;
+    Result result;
+    Stopwatch wall;
+    auto cpu0 = thread_cpu_seconds();
+    std::uint64_t offset = 0;
+    for (std::uint64_t got = 0; got < total; got += urb) {
+        if (offset + urb > DISK_BYTES)
+            offset = 0;
+        auto lba = offset / backend.block_size();
+        auto in_block = static_cast<std::size_t>(offset % backend.block_size());
+        std::error_code ec;
+        bool done = false;
+        if (direct) {
+            done = backend.recv_direct(lba, in_block, urb, tcp.fds[0], pool, ec);
+            if (ec)
+                break;
+            if (!done)
+                ++result.fallbacks;
+        }
+        if (!done)
+            read_all(tcp.fds[0], static_cast<std::uint8_t *>(backend.get_direct_buffer(lba)) + in_block, urb);
+        offset += urb;
+    }
+    result.cpu_seconds = thread_cpu_seconds() - cpu0;
+    source.join();
+    result.wall_seconds = wall.seconds();
+    return result;
+}
+
+void print_row(const char *op, const char *backend, const char *path, std::size_t urb, std::uint64_t total,
+               const Result &r) {
+    auto gib = static_cast<double>(total) / (1024.0 * 1024 * 1024);
+    std::printf("%-6s %-7s %-9s %8zu %10.1f %12.1f %10llu\n", op, backend, path, urb, mib_per_sec(total, r.wall_seconds),
+                r.cpu_seconds * 1000.0 / gib, static_cast<unsigned long long>(r.fallbacks));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::uint64_t total_mib = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 512;
+    auto total = total_mib * 1024 * 1024;
+    spdlog::set_level(spdlog::level::warn);
+
+    ScratchDir dir("zero_copy");
+    RawImageBackend raw(dir.file("disk.img"), DISK_BYTES / 512);
+    raw.set_splice_receive(true);
+    MemoryBackend memory(DISK_BYTES / 512);
+    // 预先写满：raw 进页缓存，内存盘不读共享零页
+    std::vector<std::uint8_t> fill(2048 * 512, 0xA5);
+    for (std::uint64_t lba = 0; lba < DISK_BYTES / 512; lba += 2048) {
+        raw.write(lba, 2048, fill.data());
+        memory.write(lba, 2048, fill.data());
+    }
+
+    std::printf("%llu MiB per row over TCP loopback; CPU = device-side thread time\n",
+                static_cast<unsigned long long>(total_mib));
+    std::printf("%-6s %-7s %-9s %8s %10s %12s %10s\n", "op", "backend", "path", "urb", "MiB/s", "CPU ms/GiB",
+                "fallbacks");
+    for (std::size_t urb: {4096u, 16384u, 65536u, 262144u, 1048576u}) {
+        print_row("READ", "raw", "copy", urb, total, run_read(raw, urb, total, false));
+        print_row("READ", "raw", "sendfile", urb, total, run_read(raw, urb, total, true));
+        print_row("READ", "memory", "copy", urb, total, run_read(memory, urb, total, false));
+        print_row("READ", "memory", "vmsplice", urb, total, run_read(memory, urb, total, true));
+        print_row("WRITE", "raw", "copy", urb, total, run_write(raw, urb, total, false));
+        print_row("WRITE", "raw", "splice", urb, total, run_write(raw, urb, total, true));
+    }
+    return 0;
+}
+#else
+int main() {
+    std::printf("bench_zero_copy: Linux only\n");
+    return 0;
+}
+#endif
@@ -3,6 +3,7 @@
 #include "../example_utils.h"
 
 #include "usbipdcpp/virtual_device/devices/MscBulkOnlyHandler.h"
+#include "usbipdcpp/virtual_device/storage_backends/NbdBackend.h"
 #include "usbipdcpp/virtual_device/storage_backends/RawImageBackend.h"
 #include "usbipdcpp/virtual_device/SimpleVirtualDeviceHandler.h"
 #include "usbipdcpp/usbipdcpp_core.h"
@@ -11,7 +12,9 @@ using namespace usbipdcpp;
 
 int main(int argc, char **argv) {
     auto opts = make_example_options("mock_msc", "USB/IP virtual USB flash drive");
-    opts.add_options()("i,image", "Disk image path", cxxopts::value<std::string>()->default_value("disk.img"));
+    opts.add_options()("i,image",
+                       "Disk image path, or an NBD URI (nbd://host[:port]/export, nbd+unix:///export?socket=path)",
+                       cxxopts::value<std::string>()->default_value("disk.img"));
     auto result = parse_example_args(opts, argc, argv);
     auto port = result["port"].as<std::uint16_t>();
     auto busid = result["busid"].as<std::string>();
@@ -35,7 +38,16 @@ int main(int argc, char **argv) {
                                                                                     .max_packet_size = 512,
                                                                                     .interval = 0}}}}};
 
-    auto backend = std::unique_ptr<StorageBackend>(std::make_unique<RawImageBackend>(image_path, 4096));
+    std::unique_ptr<StorageBackend> backend;
+    if (image_path.starts_with("nbd://") || image_path.starts_with("nbd+unix://")) {
+        auto nbd = std::make_unique<NbdBackend>(image_path);
+        if (!nbd->is_valid())
+            return 1;
+        backend = std::move(nbd);
+    }
+    else {
+        backend = std::make_unique<RawImageBackend>(image_path, 4096);
+    }
     interfaces[0].with_handler<MscBulkOnlyHandler>(string_pool, std::move(backend));
 
     auto device = std::make_shared<UsbDevice>(UsbDevice{
@@ -1,4 +1,6 @@
+#include <cstdio>
 #include <iostream>
+#include <sstream>
 
 #include "../example_utils.h"
 #include "usbipdcpp/Device.h"
@@ -7,6 +9,8 @@
 #include "usbipdcpp/virtual_device/UvcConstants.h"
 #include "usbipdcpp/virtual_device/UvcVirtualInterfaceHandler.h"
 #include "usbipdcpp/virtual_device/video_sources/ColorBarSource.h"
+#include "usbipdcpp/virtual_device/video_sources/ShmVideoSource.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoBroadcaster.h"
 
 using namespace usbipdcpp;
 
@@ -15,13 +19,42 @@ int main(int argc, char **argv) {
     opts.add_options()
         ("width", "Video width", cxxopts::value<int>()->default_value("320"))
         ("height", "Video height", cxxopts::value<int>()->default_value("240"))
-        ("fps", "Frame rate", cxxopts::value<int>()->default_value("15"));
+        ("fps", "Frame rate", cxxopts::value<int>()->default_value("15"))
+        ("sizes", "Extra resolutions offered to the host, e.g. 640x480,1280x720",
+         cxxopts::value<std::string>()->default_value(""))
+        ("bulk", "Stream over a bulk endpoint instead of isochronous alt settings")
+        ("shm", "Stream YUY2 frames written by an external process into this POSIX shared memory ring "
+                "(e.g. /usbipdcpp-cam0, see shm_video_producer) instead of color bars",
+         cxxopts::value<std::string>()->default_value(""))
+        ("copies", "Export this many cameras (busid, busid.2, ...) sharing one video source, so several "
+                   "machines can import the same feed",
+         cxxopts::value<int>()->default_value("1"));
     auto result = parse_example_args(opts, argc, argv);
     auto port = result["port"].as<std::uint16_t>();
     auto busid = result["busid"].as<std::string>();
     auto width = result["width"].as<int>();
     auto height = result["height"].as<int>();
     auto fps = result["fps"].as<int>();
+    auto bulk = result.count("bulk") > 0;
+    auto shm_name = result["shm"].as<std::string>();
+    auto copies = result["copies"].as<int>();
+    if (copies < 1) {
+        SPDLOG_ERROR("--copies 至少为 1");
+        return 1;
+    }
+
+    // 第一个分辨率为默认（width x height），--sizes 追加的各成一个 Frame 描述符
+    std::vector<std::pair<std::uint16_t, std::uint16_t>> sizes = {
+            {static_cast<std::uint16_t>(width), static_cast<std::uint16_t>(height)}};
+    std::istringstream sizes_stream(result["sizes"].as<std::string>());
+    for (std::string item; std::getline(sizes_stream, item, ',');) {
+        unsigned w = 0, h = 0;
+        if (std::sscanf(item.c_str(), "%ux%u", &w, &h) != 2 || w == 0 || h == 0 || w > 0xFFFF || h > 0xFFFF) {
+            SPDLOG_ERROR("无效的分辨率：{}", item);
+            return 1;
+        }
+        sizes.emplace_back(static_cast<std::uint16_t>(w), static_cast<std::uint16_t>(h));
+    }
 
     spdlog::set_level(spdlog::level::trace);
 
@@ -41,47 +74,81 @@ int main(int argc, char **argv) {
                             .interval = 8,
                     }}},
             },
-            // Interface 1: VideoStreaming（alt 0 空端点，alt 1 ISO IN 端点）
+            // Interface 1: VideoStreaming（alt 0 空端点，alt 1..6 为 128 B 到 3×1024 B 各档带宽的 ISO IN 端点 0x81，
+            // 主机按 PROBE 报告的 dwMaxPayloadTransferSize 选最小够用的一档）
             UsbInterface{
                     .interface_class = CC_VIDEO,
                     .interface_subclass = SC_VIDEOSTREAMING,
                     .interface_protocol = PC_PROTOCOL_15,
-                    .endpoints = {{}, // alt 0: zero bandwidth
-                                  {UsbEndpoint{
-                                          .address = 0x81, // IN, endpoint 1
-                                          .attributes = static_cast<std::uint8_t>(EndpointAttributes::Isochronous) |
-                                                        static_cast<std::uint8_t>(IsoSyncType::Async),
-                                          .max_packet_size = 512,
-                                          .interval = 1,
-                                  }}},
+                    .endpoints = UvcDeviceHelper::iso_alt_settings(0x81),
             },
     };
+    if (bulk) {
+        // 批量模式：VS 接口只有 alt 0，直接含 Bulk IN 端点
+        interfaces[1].endpoints = {{UsbEndpoint{
+                .address = 0x81, // IN, endpoint 1
+                .attributes = static_cast<std::uint8_t>(EndpointAttributes::Bulk),
+                .max_packet_size = 512,
+                .interval = 0,
+        }}};
+    }
 
-    auto device = std::make_shared<UsbDevice>(UsbDevice{
-            .path = "/usbipdcpp/mock_uvc",
-            .busid = busid,
-            .bus_num = 1,
-            .dev_num = 1,
-            .speed = static_cast<std::uint32_t>(UsbSpeed::High),
-            .vendor_id = 0x1234,
-            .product_id = 0x5681,
-            .device_bcd = 0x0100,
-            .device_class = 0xEF, // Miscellaneous (IAD)
-            .device_subclass = 0x02, // Common Class
-            .device_protocol = 0x01, // Interface Association Descriptor
-            .configuration_value = 1,
-            .num_configurations = 1,
-            .interfaces = interfaces,
-            .ep0_in = UsbEndpoint::get_ep0_in(UsbSpeed::High),
-            .ep0_out = UsbEndpoint::get_ep0_out(UsbSpeed::High),
-    });
+    auto make_device = [&](const std::string &device_busid, std::uint32_t dev_num) {
+        return std::make_shared<UsbDevice>(UsbDevice{
+                .path = "/usbipdcpp/mock_uvc" + (dev_num == 1 ? std::string() : std::to_string(dev_num)),
+                .busid = device_busid,
+                .bus_num = 1,
+                .dev_num = dev_num,
+                .speed = static_cast<std::uint32_t>(UsbSpeed::High),
+                .vendor_id = 0x1234,
+                .product_id = 0x5681,
+                .device_bcd = 0x0100,
+                .device_class = 0xEF, // Miscellaneous (IAD)
+                .device_subclass = 0x02, // Common Class
+                .device_protocol = 0x01, // Interface Association Descriptor
+                .configuration_value = 1,
+                .num_configurations = 1,
+                .interfaces = interfaces,
+                .ep0_in = UsbEndpoint::get_ep0_in(UsbSpeed::High),
+                .ep0_out = UsbEndpoint::get_ep0_out(UsbSpeed::High),
+        });
+    };
 
     // UvcDeviceHelper 创建 VC/VS handler 并注册 + 设置描述符
-    auto source = std::make_unique<ColorBarSource>(width, height, fps);
-    UvcDeviceHelper::setup(device, string_pool, std::move(source));
+    std::unique_ptr<VideoSource> source;
+    if (shm_name.empty()) {
+        source = std::make_unique<ColorBarSource>(std::move(sizes), fps);
+    }
+    else {
+        // 外部进程写帧：只提供 width x height 一种格式，帧直接从共享内存发送
+        auto interval = static_cast<std::uint32_t>(10000000 / fps);
+        auto shm = std::make_unique<ShmVideoSource>(
+                VideoFormatInfo{UvcFourCC::YUY2, static_cast<std::uint16_t>(width), static_cast<std::uint16_t>(height),
+                                static_cast<std::uint32_t>(width * height * 2), interval, interval, interval, 16},
+                ShmVideoSourceOptions{shm_name});
+        if (!shm->is_valid())
+            return 1;
+        SPDLOG_INFO("Producer: shm_video_producer {}", shm_name);
+        source = std::move(shm);
+    }
 
     Server server;
-    server.add_device(std::move(device));
+    if (copies == 1) {
+        auto device = make_device(busid, 1);
+        UvcDeviceHelper::setup(device, string_pool, std::move(source));
+        server.add_device(std::move(device));
+    }
+    else {
+        // 多个摄像头共享一个源：源只跑一遍，每个设备按自己协商的帧率取最新帧，慢的会话丢帧不拖累其他会话。
+        // 广播的格式固定为源的当前格式，--sizes 追加的分辨率不再提供
+        auto broadcaster = VideoBroadcaster::create(std::move(source));
+        for (int i = 1; i <= copies; ++i) {
+            auto device_busid = i == 1 ? busid : busid + "." + std::to_string(i);
+            auto device = make_device(device_busid, static_cast<std::uint32_t>(i));
+            UvcDeviceHelper::setup(device, string_pool, broadcaster->subscribe());
+            server.add_device(std::move(device));
+        }
+    }
 
     asio::ip::tcp::endpoint endpoint{asio::ip::tcp::v4(), port};
 
@@ -90,8 +157,13 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    SPDLOG_INFO("Mock UVC camera started on port {}, busid {}, {}x{}@{}fps", port, busid, width, height, fps);
+    SPDLOG_INFO("Mock UVC camera started on port {}, busid {}, {}x{}@{}fps ({})", port, busid, width, height, fps,
+                bulk ? "bulk" : "isochronous");
+    if (!result["sizes"].as<std::string>().empty())
+        SPDLOG_INFO("Extra resolutions: {}", result["sizes"].as<std::string>());
     SPDLOG_INFO("Connect: usbip attach -r <host> -b {}", busid);
+    if (copies > 1)
+        SPDLOG_INFO("{} cameras share one source: {}, {}.2 ... {}.{}", copies, busid, busid, busid, copies);
     SPDLOG_INFO("Press Enter to stop...");
 
     std::cin.get();
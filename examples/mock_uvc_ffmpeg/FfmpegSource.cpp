@@ -23,7 +23,6 @@ FfmpegSource::FfmpegSource(std::string video_path, bool passthrough) :
 
 FfmpegSource::~FfmpegSource() {
     sws_freeContext(sws_ctx_);
-    av_frame_free(&yuy2_frame_);
     av_frame_free(&av_frame_);
     avcodec_free_context(&codec_ctx_);
     avformat_close_input(&fmt_ctx_);
@@ -76,7 +75,6 @@ bool FfmpegSource::init() {
             fourcc_ = UvcFourCC::MJPEG;
             out_fmt = "MJPEG (passthrough)";
             max_frame_size_ = static_cast<std::size_t>(width_) * height_ * 2;
-            buffer_.resize(max_frame_size_);
             SPDLOG_INFO("FFmpeg: {} — input: {} ({}) {}x{} @ {:.2f}fps → output: {}",
                         video_path_, codec_name, pix_fmt_name, width_, height_, fps_, out_fmt);
             init_ok_ = true;
@@ -85,7 +83,6 @@ bool FfmpegSource::init() {
             fourcc_ = UvcFourCC::H264;
             out_fmt = "H264 (passthrough)";
             max_frame_size_ = static_cast<std::size_t>(width_) * height_ * 2;
-            buffer_.resize(max_frame_size_);
             SPDLOG_INFO("FFmpeg: {} — input: {} ({}) {}x{} @ {:.2f}fps → output: {}",
                         video_path_, codec_name, pix_fmt_name, width_, height_, fps_, out_fmt);
             init_ok_ = true;
@@ -119,15 +116,9 @@ bool FfmpegSource::init() {
     }
 
     av_frame_ = av_frame_alloc();
-    yuy2_frame_ = av_frame_alloc();
-    if (!av_frame_ || !yuy2_frame_)
+    if (!av_frame_)
         return false;
 
-    yuy2_frame_->format = AV_PIX_FMT_YUYV422;
-    yuy2_frame_->width = width_;
-    yuy2_frame_->height = height_;
-    av_image_alloc(yuy2_frame_->data, yuy2_frame_->linesize, width_, height_, AV_PIX_FMT_YUYV422, 1);
-
     sws_ctx_ = sws_getContext(width_, height_, codec_ctx_->pix_fmt, width_, height_, AV_PIX_FMT_YUYV422,
                               SWS_BILINEAR, nullptr, nullptr, nullptr);
     if (!sws_ctx_) {
@@ -136,7 +127,7 @@ bool FfmpegSource::init() {
     }
 
     max_frame_size_ = static_cast<std::size_t>(width_) * height_ * 2;
-    buffer_.resize(max_frame_size_);
+    pool_ = VideoFramePool::create(max_frame_size_);
 
     init_ok_ = true;
     return true;
@@ -194,18 +185,20 @@ bool FfmpegSource::get_frame_passthrough(VideoFrame &frame) {
             continue;
         }
 
-        if (static_cast<std::size_t>(packet_->size) > buffer_.size()) {
-            buffer_.resize(packet_->size);
-            if (packet_->size > static_cast<int>(max_frame_size_))
-                max_frame_size_ = packet_->size;
-        }
-        std::memcpy(buffer_.data(), packet_->data, packet_->size);
-
-        frame.data = buffer_.data();
-        frame.size = static_cast<std::size_t>(packet_->size);
-        frame.is_keyframe = (packet_->flags & AV_PKT_FLAG_KEY) != 0;
+        if (static_cast<std::size_t>(packet_->size) > max_frame_size_)
+            max_frame_size_ = packet_->size;
 
-        av_packet_unref(packet_);
+        // 把包的引用移交给帧：handler 发完最后一个 payload 时释放，省掉一次整帧拷贝
+        AVPacket *owned = av_packet_alloc();
+        if (!owned) {
+            av_packet_unref(packet_);
+            return false;
+        }
+        av_packet_move_ref(owned, packet_);
+        frame.data = owned->data;
+        frame.size = static_cast<std::size_t>(owned->size);
+        frame.is_keyframe = (owned->flags & AV_PKT_FLAG_KEY) != 0;
+        frame.owner = std::shared_ptr<AVPacket>(owned, [](AVPacket *p) { av_packet_free(&p); });
         return true;
     }
 }
@@ -240,21 +233,16 @@ bool FfmpegSource::get_frame_yuy2(VideoFrame &frame) {
         if (ret < 0)
             return false;
 
-        sws_scale(sws_ctx_, av_frame_->data, av_frame_->linesize, 0, height_,
-                  yuy2_frame_->data, yuy2_frame_->linesize);
+        // swscale 直接写进池化缓冲（行距 = 宽 × 2，无填充），不再经中间帧逐行拷贝
+        auto buffer = pool_->acquire();
+        auto line_sz = static_cast<std::size_t>(width_) * 2;
+        std::uint8_t *dst_data[4] = {buffer->data(), nullptr, nullptr, nullptr};
+        int dst_linesize[4] = {static_cast<int>(line_sz), 0, 0, 0};
+        sws_scale(sws_ctx_, av_frame_->data, av_frame_->linesize, 0, height_, dst_data, dst_linesize);
         av_frame_unref(av_frame_);
 
-        auto *src = yuy2_frame_->data[0];
-        auto *dst = buffer_.data();
-        auto line_sz = static_cast<std::size_t>(width_) * 2;
-        for (int y = 0; y < height_; ++y) {
-            std::memcpy(dst, src, line_sz);
-            src += yuy2_frame_->linesize[0];
-            dst += line_sz;
-        }
-        frame.data = buffer_.data();
-        frame.size = line_sz * height_;
-        frame.is_keyframe = true;
+        buffer->set_size(line_sz * height_);
+        frame = make_video_frame(std::move(buffer));
         return true;
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -11,6 +12,7 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
 #include "usbipdcpp/virtual_device/video_sources/VideoSource.h"
 
 namespace usbipdcpp {
@@ -18,6 +20,8 @@ namespace usbipdcpp {
 /// 基于 FFmpeg 的视频源。
 /// passthrough=false（默认）：全部解码为 YUY2，兼容所有 UVC 驱动。
 /// passthrough=true：MJPEG/H264 直接透传，其他解码为 YUY2。
+/// 交出的帧都带 owner，handler 不再整帧拷贝：YUY2 由 swscale 直接写进池化缓冲，
+/// 透传帧直接持有 demuxer 的 AVPacket。
 class FfmpegSource : public VideoSource {
 public:
     explicit FfmpegSource(std::string video_path, bool passthrough = false);
@@ -38,7 +42,7 @@ private:
     void seek_to_start();
 
     std::string video_path_;
-    std::vector<std::uint8_t> buffer_;
+    std::shared_ptr<VideoFramePool> pool_;
     std::size_t max_frame_size_{};
 
     bool init_ok_ = false;
@@ -54,7 +58,6 @@ private:
     AVCodecContext *codec_ctx_ = nullptr;
     const AVCodec *codec_ = nullptr;
     AVFrame *av_frame_ = nullptr;
-    AVFrame *yuy2_frame_ = nullptr;
     SwsContext *sws_ctx_ = nullptr;
     AVPacket *packet_ = nullptr;
     int stream_idx_ = -1;
@@ -7,6 +7,7 @@
 #include "usbipdcpp/usbipdcpp_core.h"
 #include "usbipdcpp/virtual_device/UvcConstants.h"
 #include "usbipdcpp/virtual_device/UvcVirtualInterfaceHandler.h"
+#include "usbipdcpp/virtual_device/video_sources/AsyncVideoSource.h"
 
 using namespace usbipdcpp;
 
@@ -71,7 +72,8 @@ int main(int argc, char **argv) {
             .ep0_out = UsbEndpoint::get_ep0_out(UsbSpeed::High),
     });
 
-    auto source = std::make_unique<FfmpegSource>(video_path, passthrough);
+    // 解码放到独立线程：解码慢于帧间隔时重发上一帧，不拖慢 ISO 完成
+    auto source = std::make_unique<AsyncVideoSource>(std::make_unique<FfmpegSource>(video_path, passthrough));
     UvcDeviceHelper::setup(device, string_pool, std::move(source));
 
     Server server;
@@ -0,0 +1,113 @@
+/*
+ * ShmVideoSource 的外部生产者示例：映射服务端建好的帧环，按环头里的分辨率与帧间隔写入滚动的彩条（YUY2）。
+ *
+ * 用法: shm_video_producer <共享内存名> [帧数=0 一直写] [eventfd 编号=-1]
+ *   先启动服务端：mock_uvc --shm /usbipdcpp-cam0，再运行 shm_video_producer /usbipdcpp-cam0
+ *   由服务端 fork 出来、继承了 eventfd 时可以把编号传进来，服务端的 wait_frame 不必轮询
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "usbipdcpp/virtual_device/video_sources/shm_video_ring.h"
+
+#define FOURCC_YUY2 0x32595559u
+
+/* BT.601 有限范围的 75% 彩条：白 黄 青 绿 品 红 蓝 */
+static const uint8_t BARS[7][3] = {
+        {180, 128, 128}, {162, 44, 142}, {131, 156, 44}, {112, 72, 58},
+        {84, 184, 198},  {65, 100, 212}, {35, 212, 114},
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static void draw(uint8_t *frame, uint16_t width, uint16_t height, uint32_t shift) {
+    for (uint32_t y = 0; y < height; ++y) {
+        uint8_t *row = frame + (size_t) y * width * 2;
+        for (uint32_t x = 0; x < width; x += 2) {
+            const uint8_t *bar = BARS[((x + shift) % width) * 7 / width];
+            row[x * 2] = bar[0];
+            row[x * 2 + 1] = bar[1];
+            row[x * 2 + 2] = bar[0];
+            row[x * 2 + 3] = bar[2];
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <shm name> [frames] [eventfd]\n", argv[0]);
+        return 1;
+    }
+    long frames = argc > 2 ? atol(argv[2]) : 0;
+    int event_fd = argc > 3 ? atoi(argv[3]) : -1;
+
+    int fd = shm_open(argv[1], O_RDWR, 0);
+    if (fd < 0) {
+        perror("shm_open");
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("fstat");
+        return 1;
+    }
+    void *ring = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    if (usbipdcpp_shm_video_check(ring, (uint64_t) st.st_size) != 0) {
+        fprintf(stderr, "%s is not a usbipdcpp video ring\n", argv[1]);
+        return 1;
+    }
+
+    const usbipdcpp_shm_video_header *header = (const usbipdcpp_shm_video_header *) ring;
+    uint32_t frame_size = (uint32_t) header->width * header->height * 2;
+    if (header->fourcc != FOURCC_YUY2 || frame_size > header->slot_capacity) {
+        fprintf(stderr, "ring format is not YUY2 %ux%u\n", header->width, header->height);
+        return 1;
+    }
+    uint64_t interval_ns = (uint64_t) header->frame_interval * 100;
+    printf("writing %ux%u YUY2 every %.1f ms into %s\n", header->width, header->height, interval_ns / 1e6, argv[1]);
+
+    uint64_t next = now_ns();
+    unsigned long dropped = 0;
+    for (long n = 0; frames == 0 || n < frames; ++n) {
+        uint32_t slot;
+        uint8_t *data = usbipdcpp_shm_video_begin(ring, &slot);
+        if (data) {
+            draw(data, header->width, header->height, (uint32_t) n * 4);
+            usbipdcpp_shm_video_commit(ring, slot, frame_size, USBIPDCPP_SHM_VIDEO_KEYFRAME, now_ns());
+            usbipdcpp_shm_video_notify(event_fd);
+        }
+        else {
+            /* 服务端钉住了所有槽位（发送卡住）：这一帧丢掉，不等 */
+            ++dropped;
+        }
+
+        next += interval_ns;
+        uint64_t now = now_ns();
+        if (next > now) {
+            struct timespec ts = {(time_t) ((next - now) / 1000000000u), (long) ((next - now) % 1000000000u)};
+            nanosleep(&ts, NULL);
+        }
+        else {
+            next = now;
+        }
+    }
+    printf("done, %lu frames dropped\n", dropped);
+    munmap(ring, (size_t) st.st_size);
+    return 0;
+}
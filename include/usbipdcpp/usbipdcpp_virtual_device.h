@@ -33,5 +33,12 @@
 // UVC
 #include "usbipdcpp/virtual_device/UvcConstants.h"
 #include "usbipdcpp/virtual_device/UvcVirtualInterfaceHandler.h"
+#include "usbipdcpp/virtual_device/UvcTransferOperator.h"
 #include "usbipdcpp/virtual_device/video_sources/VideoSource.h"
 #include "usbipdcpp/virtual_device/video_sources/ColorBarSource.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
+#include "usbipdcpp/virtual_device/video_sources/PixelConvert.h"
+#include "usbipdcpp/virtual_device/video_sources/MjpegEncoderSource.h"
+#include "usbipdcpp/virtual_device/video_sources/AsyncVideoSource.h"
+#include "usbipdcpp/virtual_device/video_sources/ShmVideoSource.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoBroadcaster.h"
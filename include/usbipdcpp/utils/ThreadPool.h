@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace usbipdcpp {
+
+/**
+ * @brief 固定线程数的简单任务池
+ *
+ * 供存储后端 / 视频源做 CPU 密集的并行计算（解压、编码等），
+ * 任务按 FIFO 顺序执行，submit 返回 std::future 供调用者等待结果。
+ *
+ * 析构时会执行完队列中剩余任务再退出线程，已经拿到的 future 不会悬空。
+ */
+class ThreadPool {
+public:
+    /** @param thread_count 工作线程数，0 表示使用 std::thread::hardware_concurrency() */
+    explicit ThreadPool(std::size_t thread_count = 0) {
+        if (thread_count == 0) {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        workers_.reserve(thread_count);
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            workers_.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto &t: workers_) {
+            if (t.joinable())
+                t.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /** 提交任务，返回其结果的 future（任务抛出的异常会在 future.get() 时重新抛出） */
+    template<typename F>
+    auto submit(F &&f) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using R = std::invoke_result_t<std::decay_t<F>>;
+        // std::function 要求可拷贝，packaged_task 只能移动，因此用 shared_ptr 包一层
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        auto fut = task->get_future();
+        {
+            std::lock_guard lock(mutex_);
+            tasks_.emplace_back([task] { (*task)(); });
+        }
+        cv_.notify_one();
+        return fut;
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return workers_.size();
+    }
+
+private:
+    void worker_loop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                    return; // stopping_ 且队列已清空
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+} // namespace usbipdcpp
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace usbipdcpp {
@@ -34,6 +35,31 @@ enum class BotState : std::uint8_t {
 inline constexpr std::uint32_t CBW_SIGNATURE = 0x43425355; // "USBC"
 inline constexpr std::uint32_t CSW_SIGNATURE = 0x53425355; // "USBS"
 
+/// Bulk-Only Transport 类请求（bmRequestType 0xA1 / 0x21，wIndex = 接口号）
+namespace BotRequest {
+    inline constexpr std::uint8_t GetMaxLun = 0xFE;
+    inline constexpr std::uint8_t Reset = 0xFF;
+} // namespace BotRequest
+
+/// bCBWLUN 只有低 4 位，BOT 最多 16 个逻辑单元
+inline constexpr std::size_t MSC_MAX_LUNS = 16;
+
+/// REQUEST SENSE 用到的 sense key / 附加感测码
+namespace SenseKey {
+    inline constexpr std::uint8_t NoSense = 0x00;
+    inline constexpr std::uint8_t MediumError = 0x03;
+    inline constexpr std::uint8_t IllegalRequest = 0x05;
+    inline constexpr std::uint8_t DataProtect = 0x07;
+    inline constexpr std::uint8_t Miscompare = 0x0E;
+} // namespace SenseKey
+
+namespace Asc {
+    inline constexpr std::uint8_t UnrecoveredReadError = 0x11;
+    inline constexpr std::uint8_t MiscompareDuringVerify = 0x1D;
+    inline constexpr std::uint8_t LogicalUnitNotSupported = 0x25;
+    inline constexpr std::uint8_t WriteProtected = 0x27;
+} // namespace Asc
+
 /// SCSI 命令码
 namespace ScsiCmd {
     inline constexpr std::uint8_t TestUnitReady = 0x00;
@@ -54,6 +80,11 @@ namespace ScsiCmd {
     inline constexpr std::uint8_t ModeSense10 = 0x5A;
     inline constexpr std::uint8_t AtaPassThrough = 0x85;
     inline constexpr std::uint8_t WriteSame16 = 0x93;
+    // MMC（光驱）命令
+    inline constexpr std::uint8_t ReadToc = 0x43;
+    inline constexpr std::uint8_t GetConfiguration = 0x46;
+    inline constexpr std::uint8_t GetEventStatusNotification = 0x4A;
+    inline constexpr std::uint8_t Read12 = 0xA8;
 } // namespace ScsiCmd
 
 /// SCSI 数据都是大端序，统一用字节数组字段 + 以下辅助读写，
@@ -238,6 +269,16 @@ struct ReadWrite10Cdb {
     std::uint8_t control;      // byte 9
 };
 
+/// READ (12) CDB（0xA8）
+struct Read12Cdb {
+    std::uint8_t opcode;         // 0xA8
+    std::uint8_t flags;          // byte 1
+    std::uint8_t lba[4];         // byte 2-5（大端）
+    std::uint8_t block_count[4]; // byte 6-9（大端，0 = 不传输）
+    std::uint8_t group;          // byte 10
+    std::uint8_t control;        // byte 11
+};
+
 /// WRITE SAME (10) CDB（0x41）
 struct WriteSame10Cdb {
     std::uint8_t opcode;       // 0x41
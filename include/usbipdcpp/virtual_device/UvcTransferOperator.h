@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "usbipdcpp/DeviceHandler/TransferOperator.h"
+#include "usbipdcpp/utils/ObjectPool.h"
+
+namespace usbipdcpp {
+
+/**
+ * @brief UVC 视频流端点专用 Transfer，配合 UvcTransferOperator 使用
+ *
+ * 不分配 URB 大小的数据缓冲：UvcVideoStreamingHandler 把 payload 头写进 headers，
+ * 再把「头 + 帧切片」按线上顺序登记到 buffers，帧切片直接指向源的帧内存，
+ * keepalive 持有帧的 owner 直到 sender 线程发完。
+ * 关闭 gather 发送时（对比 / 排查用）handler 调 flatten 把各段拷进 staging，与旧路径等价。
+ */
+struct UvcPayloadTransfer {
+    /// 等时包描述符（批量传输为空）
+    std::vector<UsbIpIsoPacketDescriptor> iso_descriptors;
+
+    /// IN 方向待发送的字节数，等于 buffers（或 staging）的总长
+    std::size_t actual_length = 0;
+
+    /// payload 头存放区：每个等时包一个头，批量 URB 至多一个。alloc 时定长，buffers 里的头指针指向这里
+    std::vector<std::uint8_t> headers;
+
+    /// 待发送的数据段（头与帧切片交替），send_transfer_data 之后再追加等时描述符
+    std::vector<asio::const_buffer> buffers;
+
+    /// 帧切片所在帧的 owner，保证 sender 线程发送期间帧内存有效
+    std::shared_ptr<const void> keepalive;
+
+    /// flatten 后的连续数据；OUT 方向（流端点不应收到）也读进这里以保持协议对齐
+    std::vector<std::uint8_t> staging;
+
+    /// 发送时序列化的等时描述符
+    std::vector<decltype(UsbIpIsoPacketDescriptor{}.to_bytes())> descriptor_bytes;
+
+    /// 把 buffers 拷成一段连续数据并放掉 keepalive，返回拷贝字节数
+    std::size_t flatten();
+
+    /** 重置所有字段以供对象池复用（保留各 vector 的容量） */
+    void reset() {
+        iso_descriptors.clear();
+        actual_length = 0;
+        headers.clear();
+        buffers.clear();
+        keepalive.reset();
+        staging.clear();
+        descriptor_bytes.clear();
+    }
+
+    static UvcPayloadTransfer *from_handle(void *handle) {
+        return static_cast<UvcPayloadTransfer *>(handle);
+    }
+};
+
+/**
+ * @brief UVC 视频流传输操作器
+ *
+ * send_transfer_data 把 UvcPayloadTransfer 登记的数据段与等时描述符一次 gather write 出去，
+ * 视频数据从源的帧内存直接写入 socket，不经 URB 缓冲中转。
+ * transfer 对象池化复用，稳态下每个 URB 不再分配、清零 transfer_buffer_length 大小的缓冲。
+ */
+class USBIPDCPP_API UvcTransferOperator : public TransferOperator {
+public:
+    void *alloc_transfer_handle(std::size_t buffer_length, int num_iso_packets, const UsbIpHeaderBasic &header,
+                                const SetupPacket &setup_packet) override;
+    void free_transfer_handle(void *handle) override;
+
+    std::size_t get_actual_length(void *handle) override;
+
+    UsbIpIsoPacketDescriptor get_iso_descriptor(void *handle, int index) override;
+    void set_iso_descriptor(void *handle, int index, const UsbIpIsoPacketDescriptor &desc) override;
+
+    void send_transfer_data(void *handle, asio::ip::tcp::socket &sock, std::size_t length,
+                            std::error_code &ec) override;
+    void recv_transfer_data(void *handle, asio::ip::tcp::socket &sock, std::size_t length,
+                            std::error_code &ec) override;
+
+private:
+    /// uvcvideo 同时在途 5 个 URB，Windows usbvideo 更多；16 个槽，超出时临时 new
+    ObjectPool<UvcPayloadTransfer, 16, true> pool_;
+};
+
+} // namespace usbipdcpp
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <vector>
@@ -8,12 +9,15 @@
 #include "usbipdcpp/virtual_device/UvcConstants.h"
 #include "usbipdcpp/virtual_device/VirtualDeviceHandler.h"
 #include "usbipdcpp/virtual_device/VirtualInterfaceHandler.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
 #include "usbipdcpp/virtual_device/video_sources/VideoSource.h"
 
 namespace usbipdcpp {
 
+struct UvcPayloadTransfer;
+
 /// PROBE/COMMIT 协商结构体（UVC 1.5, 48 字节）
-struct UvcStreamingControl {
+struct USBIPDCPP_API UvcStreamingControl {
     std::uint16_t bmHint = 0;
     std::uint8_t bFormatIndex = 1;
     std::uint8_t bFrameIndex = 1;
@@ -81,7 +85,20 @@ public:
     }
 
 private:
+    /// 一个 Format 描述符：同一 fourcc 的若干分辨率，frames[i] 对应 bFrameIndex i + 1
+    struct FormatGroup {
+        std::uint32_t fourcc;
+        std::vector<VideoFormatInfo> frames;
+        std::uint8_t default_frame_index; // bDefaultFrameIndex
+    };
+
     void build_class_descriptor();
+    /// 按 bFormatIndex / bFrameIndex（从 1 起）查描述符中的帧，越界返回 nullptr
+    [[nodiscard]] const VideoFormatInfo *find_frame(std::uint8_t format_index, std::uint8_t frame_index) const;
+    /// 把主机给的 PROBE/COMMIT 规整为设备能接受的值：越界索引回默认，帧间隔取最近的合法值，覆写设备决定的字段
+    void normalize_control(UvcStreamingControl &ctrl) const;
+    /// frame 支持的帧间隔中最接近 requested 的一个（0 取默认帧间隔）
+    static std::uint32_t nearest_frame_interval(const VideoFormatInfo &frame, std::uint32_t requested);
     void send_vc_status(data_type status);
 
     data_type class_desc_;
@@ -93,9 +110,16 @@ private:
     mutable std::mutex status_mutex_;
 };
 
-/// VideoStreaming 接口处理器 — PROBE/COMMIT + ISO 流推送
+/// VideoStreaming 接口处理器 — PROBE/COMMIT + ISO / Bulk 流推送
+///
+/// 传输方式由 VS 接口的端点布局决定（UVC 1.5 §2.4.3）：
+/// - 等时：alt 0 零带宽，alt 1 含 ISO IN 端点，SET_INTERFACE(1) 开流、SET_INTERFACE(0) 停流
+/// - 批量：alt 0 直接含 Bulk IN 端点，COMMIT 即开流，主机对该端点 CLEAR_FEATURE(ENDPOINT_HALT) 停流
 class USBIPDCPP_API UvcVideoStreamingHandler : public VirtualInterfaceHandler {
 public:
+    /// 批量模式默认的 dwMaxPayloadTransferSize：一个 payload（含头）可跨多个 URB
+    static constexpr std::uint32_t DEFAULT_BULK_PAYLOAD_SIZE = 512 * 1024;
+
     UvcVideoStreamingHandler(UsbInterface &handle_interface, StringPool &string_pool,
                              std::unique_ptr<VideoSource> source);
 
@@ -110,6 +134,9 @@ public:
     void handle_isochronous_transfer(std::uint32_t seqnum, const UsbEndpoint &ep, std::uint32_t transfer_flags,
                                      std::uint32_t transfer_buffer_length, TransferHandle transfer, int num_iso_packets,
                                      std::error_code &ec) override;
+    void handle_bulk_transfer(std::uint32_t seqnum, const UsbEndpoint &ep, std::uint32_t transfer_flags,
+                              std::uint32_t transfer_buffer_length, TransferHandle transfer,
+                              std::error_code &ec) override;
     void on_new_connection(Session &current_session, error_code &ec) override;
     void on_disconnection(error_code &ec) override;
     void request_set_interface(std::uint16_t alternate_setting, std::uint32_t *p_status) override;
@@ -137,22 +164,106 @@ public:
         streaming_ = false;
     }
 
+    /// VS 接口 alt 0 含 Bulk IN 端点（在 on_setup_interface_handlers 中判定）
+    [[nodiscard]] bool is_bulk_mode() const {
+        return bulk_mode_;
+    }
+
+    /// 批量模式下报告给主机的 dwMaxPayloadTransferSize（下次 PROBE 生效），至少为头长 + 1
+    void set_bulk_payload_size(std::uint32_t size);
+
+    /// 当前 alt setting（等时模式下主机按 PROBE 报告的 payload 大小选中的带宽档位）
+    [[nodiscard]] std::uint8_t alt_setting() const {
+        return alt_setting_;
+    }
+
+    /// 等时端点 wMaxPacketSize 对应的每微帧字节数：包长 × (1 + 额外事务数)
+    static std::uint32_t iso_packet_capacity(std::uint16_t max_packet_size);
+
+    struct StreamStats {
+        std::uint64_t frames; // 从源取到的帧数
+        std::uint64_t frame_bytes; // 这些帧的总字节数
+        std::uint64_t frame_copy_bytes; // 源没给 owner、整帧拷进 handler 的字节数
+        std::uint64_t gathered_bytes; // 以「头 + 帧切片」数据段直接 gather write 的字节数
+        std::uint64_t payload_copy_bytes; // 关闭 gather 发送时拷进 URB 缓冲的字节数
+    };
+
+    /// 累计统计，可在其他线程读取
+    [[nodiscard]] StreamStats stream_stats() const;
+
+    /// 流 URB 是否从帧内存直接 gather write（默认开启）。关闭后每个 URB 先拷成连续缓冲再发，供对比与排查
+    void set_gather_send(bool enable) {
+        gather_send_ = enable;
+    }
+
 private:
+    enum class FrameFetch {
+        Ready, // 取到新帧，已翻转 FID
+        Idle, // 帧时钟未到，或源暂时没有新帧
+        Error, // 源取帧失败
+    };
+
+    /// 一个 Format 描述符：同一 fourcc 的若干分辨率，frames[i] 对应 bFrameIndex i + 1
+    struct FormatGroup {
+        std::uint32_t fourcc;
+        std::vector<VideoFormatInfo> frames;
+        std::uint8_t default_frame_index; // bDefaultFrameIndex
+    };
+
     void build_class_descriptor();
+    /// 按 bFormatIndex / bFrameIndex（从 1 起）查描述符中的帧，越界返回 nullptr
+    [[nodiscard]] const VideoFormatInfo *find_frame(std::uint8_t format_index, std::uint8_t frame_index) const;
+    /// 把主机给的 PROBE/COMMIT 规整为设备能接受的值：越界索引回默认，帧间隔取最近的合法值，覆写设备决定的字段
+    void normalize_control(UvcStreamingControl &ctrl) const;
+    /// frame 支持的帧间隔中最接近 requested 的一个（0 取默认帧间隔）
+    static std::uint32_t nearest_frame_interval(const VideoFormatInfo &frame, std::uint32_t requested);
+    /// 帧时钟到点时从源取下一帧到 frame_
+    FrameFetch fetch_next_frame(std::chrono::steady_clock::time_point now);
+    /// COMMIT / 开流时重置帧与 payload 状态
+    void reset_stream_state();
+    /// URB 的数据段登记完毕：gather 模式持有帧 owner，否则拷成连续缓冲
+    void finish_payload_transfer(UvcPayloadTransfer &trx);
+    /// PROBE 中设备侧决定的 dwMaxPayloadTransferSize：批量为配置的 payload 上限，
+    /// 等时为能在帧间隔内发完一帧的最小 alt 的每服务周期字节数
+    [[nodiscard]] std::uint32_t device_payload_size(const VideoFormatInfo &frame, std::uint32_t interval) const;
+    /// 各等时 alt 中最大的每服务周期字节数（没有等时 alt 时为 512）
+    [[nodiscard]] std::uint32_t max_iso_capacity() const;
 
     UvcVideoControlHandler *vc_handler_ = nullptr;
 
     std::unique_ptr<VideoSource> source_;
     data_type class_desc_;
+    std::vector<FormatGroup> formats_; // 描述符中的格式与帧，build_class_descriptor 生成
+    std::uint8_t default_format_index_ = 1;
     UvcStreamingControl probe_data_{};
+    UvcStreamingControl commit_data_{}; // 最近一次 COMMIT 的值，流推送按它切 payload
     bool committed_ = false;
     bool streaming_ = false;
 
-    // 帧缓冲
-    std::vector<std::uint8_t> frame_buffer_;
+    // 正在发送的帧（owner 总是非空）：源给了 owner 就直接持有，否则拷进 copy_pool_ 的缓冲。
+    // 流 URB 只登记帧切片，发送前由 transfer 一并持有 owner
+    VideoFrame frame_{};
+    std::shared_ptr<VideoFramePool> copy_pool_;
+    bool gather_send_ = true;
     std::size_t frame_offset_ = 0;
     bool current_fid_ = false;
 
+    // 批量模式：一个 payload = 头 + 帧的一段，长度不超过协商的 dwMaxPayloadTransferSize，
+    // 可跨多个 URB；每个 URB 只装一个 payload 的字节，payload 以短 URB 结束。
+    // payload 恰好填满 URB 又短于上限时主机无从判断结束，下一个 URB 回零长度包
+    bool bulk_mode_ = false;
+    std::uint8_t stream_ep_address_ = 0x81;
+    // 等时带宽档位：下标为 alt，值为该 alt 每服务周期字节数（alt 0 与不含流端点的 alt 为 0）
+    std::vector<std::uint32_t> iso_alt_capacity_;
+    std::uint32_t iso_service_interval_ = 1; // 微帧数，2^(bInterval-1)
+    std::uint8_t alt_setting_ = 0;
+    std::uint32_t bulk_payload_size_ = DEFAULT_BULK_PAYLOAD_SIZE;
+    std::size_t payload_length_ = 0; // 当前 payload 总长（含头），0 表示没有进行中的 payload
+    std::size_t payload_sent_ = 0;
+    std::size_t payload_frame_offset_ = 0; // 当前 payload 数据部分在帧中的起点
+    std::uint8_t payload_header_info_ = 0;
+    bool zlp_pending_ = false;
+
     // 帧时钟：本帧开始时刻 + 协商帧间隔。对齐真实摄像头语义——帧率由帧时钟
     // 决定，不随主机消费速度漂移：
     // - 带宽不足（一帧传不完一个帧间隔）：丢帧切最新帧，画面实时只是帧率低
@@ -160,14 +271,27 @@ private:
     // 首帧前为 epoch（now 恒 ≥ 它 + 间隔），保证开流第一帧立即开始
     std::chrono::steady_clock::time_point frame_started_at_{};
     std::chrono::microseconds frame_interval_{};
+
+    std::atomic<std::uint64_t> frames_{0};
+    std::atomic<std::uint64_t> frame_bytes_{0};
+    std::atomic<std::uint64_t> frame_copy_bytes_{0};
+    std::atomic<std::uint64_t> gathered_bytes_{0};
+    std::atomic<std::uint64_t> payload_copy_bytes_{0};
 };
 
 /// UVC 设备辅助类 — 在 device 上注册 VC/VS 接口 handler 并设置描述符
 class USBIPDCPP_API UvcDeviceHelper {
 public:
     /// 向 device 注入 UVC 接口 handler。
-    /// device 必须已有两个接口（VC + VS），且第二个接口需含 ISO IN 端点
+    /// device 必须已有两个接口（VC + VS），第二个接口 alt 1 含 ISO IN 端点（等时模式），
+    /// 或 alt 0 含 Bulk IN 端点（批量模式）
     static void setup(std::shared_ptr<UsbDevice> device, StringPool &string_pool, std::unique_ptr<VideoSource> source);
+
+    /// 等时模式 VS 接口的端点布局：alt 0 零带宽，alt 1..N 依次为各档 wMaxPacketSize 的 ISO IN 端点（须升序）。
+    /// 高速端点 wMaxPacketSize 的 D12..11 为每微帧额外事务数，如 0x1400 = 3 × 1024 字节
+    static std::vector<std::vector<UsbEndpoint>> iso_alt_settings(
+            std::uint8_t address, const std::vector<std::uint16_t> &max_packet_sizes = {128, 256, 512, 1024, 0x0C00,
+                                                                                        0x1400});
 };
 
 } // namespace usbipdcpp
@@ -1,42 +1,73 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include "usbipdcpp/virtual_device/MscConstants.h"
 #include "usbipdcpp/virtual_device/VirtualInterfaceHandler.h"
+#include "usbipdcpp/virtual_device/devices/MscStats.h"
+#include "usbipdcpp/virtual_device/storage_backends/ReadaheadDetector.h"
 #include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
 #include "usbipdcpp/virtual_device/storage_backends/StorageIoTransfer.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageTransferOperator.h"
 
 namespace usbipdcpp {
 
-class StorageTransferOperator;
+/** LUN 的设备类型，取值即 INQUIRY 的外设类型（PDT） */
+enum class MscDeviceType : std::uint8_t {
+    /** 直接访问块设备（U 盘 / 硬盘），SBC 命令集 */
+    DirectAccess = 0x00,
+    /** 只读 CD/DVD 光驱，额外支持 MMC 的 READ(12) / READ TOC / GET CONFIGURATION /
+     *  GET EVENT STATUS NOTIFICATION，LUN 强制只读，后端应为 2048 字节扇区 */
+    CdRom = 0x05,
+};
 
-/** SCSI INQUIRY / VPD 返回的标识字符串。
+/** SCSI INQUIRY / VPD 返回的标识字符串及存储层参数。
  *  空字符串表示从 VirtualDeviceHandler 的 USB 描述符自动读取。 */
 struct MscConfig {
     std::string vendor; // INQUIRY 8 字节厂商名
     std::string product; // INQUIRY 16 字节产品名
     std::string revision; // INQUIRY 4 字节版本号
     std::string serial; // VPD 0x80 序列号
+    ReadaheadDetector::Config readahead; // 顺序读预读参数，enabled=false 关闭
+    MscDeviceType device_type = MscDeviceType::DirectAccess;
+};
+
+/** 一个逻辑单元（LUN）：独立的存储后端、INQUIRY 标识与只读属性。
+ *  后端 is_read_only() 或 device_type 为 CdRom 时无论 read_only 取值都按只读处理 */
+struct MscLun {
+    std::unique_ptr<StorageBackend> backend; // 为空表示未挂载介质
+    MscConfig config;
+    bool read_only = false;
 };
 
 /** MSC Bulk-Only Transport 协议处理器。
  *
  * BOT 是同步协议（CBW→Data→CSW），所有 IN 数据在收到 CBW 时已就绪，
  * 主机 IN 请求立即可响应，因此无需 EndpointRequestQueue（对比 HID/CDC ACM
- * 等异步产生数据的设备，需要队列暂存 IN 请求等待数据就绪）。 */
+ * 等异步产生数据的设备，需要队列暂存 IN 请求等待数据就绪）。
+ *
+ * 支持多 LUN：GET MAX LUN 报告 LUN 表大小，每个 CBW 按 bCBWLUN 路由到对应后端，
+ * 一个导入的设备（一条连接、一组 session 线程）即可承载多个磁盘镜像。 */
 class USBIPDCPP_API MscBulkOnlyHandler : public VirtualInterfaceHandler {
 public:
+    /** 单 LUN */
     MscBulkOnlyHandler(UsbInterface &handle_interface, StringPool &string_pool, std::unique_ptr<StorageBackend> backend,
                        MscConfig config = {}, bool read_only = false);
+    /** 多 LUN，luns[i] 即 LUN i，最多 MSC_MAX_LUNS 个 */
+    MscBulkOnlyHandler(UsbInterface &handle_interface, StringPool &string_pool, std::vector<MscLun> luns);
 
     /** Bulk-Only Transport 核心：IN 数据发送（DataIn/Status），OUT 仅 ack（数据已在 on_out_data_received 处理） */
     void handle_bulk_transfer(std::uint32_t seqnum, const UsbEndpoint &ep, std::uint32_t transfer_flags,
                               std::uint32_t transfer_buffer_length, TransferHandle transfer,
                               std::error_code &ec) override;
 
+    /** BOT 类请求：GET MAX LUN、Bulk-Only Mass Storage Reset，其余 STALL */
     void handle_non_standard_request_type_control_urb(std::uint32_t seqnum, const UsbEndpoint &ep,
                                                       std::uint32_t transfer_flags,
                                                       std::uint32_t transfer_buffer_length,
@@ -48,8 +79,29 @@ public:
     /** OUT 数据收完后回调，驱动 BOT 状态机：CBW 解析 or 写盘 or UNMAP */
     void on_out_data_received(StorageIoTransfer *trx, std::size_t length);
 
-    StorageBackend *get_backend() const {
-        return backend_.get();
+    StorageBackend *get_backend(std::size_t lun = 0) const {
+        return lun < luns_.size() ? luns_[lun].backend.get() : nullptr;
+    }
+
+    std::size_t lun_count() const {
+        return luns_.size();
+    }
+
+    /** READ/WRITE 数据经 staging 中转（后端与 socket 之间多一次用户态拷贝）的累计字节数 */
+    std::uint64_t staged_bytes() const {
+        return staged_bytes_.load(std::memory_order_relaxed);
+    }
+
+    /** sendfile / splice / vmsplice 零拷贝路径的成功与回退次数 */
+    ZeroCopyStats zero_copy_stats();
+
+    /** 按 SCSI 操作码统计的命令数、字节数、数据路径与各阶段延迟（所有 LUN 合计） */
+    const MscStats &stats() const {
+        return stats_;
+    }
+
+    MscStats &stats() {
+        return stats_;
     }
 
     /** device_handler 已设置后回调，从 USB 字符串补全 MscConfig 空字段 */
@@ -60,9 +112,20 @@ public:
     void on_disconnection(error_code &ec) override;
 
 private:
-    std::unique_ptr<StorageBackend> backend_;
-    bool read_only_ = false;
-    MscConfig config_; // on_setup_interface_handlers 中补全空字段
+    struct LogicalUnit {
+        std::unique_ptr<StorageBackend> backend;
+        MscConfig config; // on_setup_interface_handlers 中补全空字段
+        bool read_only = false;
+        /** 上一条命令失败的感测数据（sense key / ASC），REQUEST SENSE 读出，下一条其他命令清零 */
+        std::uint8_t sense_key = 0;
+        std::uint8_t asc = 0;
+        /** READ(10) 顺序流检测，命中时调用 backend->prefetch 预读后续窗口 */
+        ReadaheadDetector readahead;
+    };
+
+    std::vector<LogicalUnit> luns_;
+    /** 当前 CBW 的目标 LUN，数据阶段与 CSW 沿用；CBW 指向不存在的 LUN 时为 nullptr */
+    LogicalUnit *lun_ = nullptr;
 
     /** BOT 状态机：Idle → DataIn/DataOut → Status → Idle */
     BotState state_ = BotState::Idle;
@@ -91,15 +154,78 @@ private:
     /** true 时 DataOut 走 WRITE SAME 填充模式（收 1 块数据写满整个范围） */
     bool data_out_write_same_ = false;
 
+    /** VERIFY(10) BYTCHK：目标范围、比较模式（1 = 逐块比较完整数据，3 = 用 1 块数据比较每一块） */
+    std::uint64_t verify_lba_ = 0;
+    std::uint16_t verify_count_ = 0;
+    std::uint8_t verify_bytchk_ = 0;
+    /** true 时 DataOut 收齐后与介质比较，不写盘 */
+    bool data_out_verify_ = false;
+    /** 后端不提供映射区时，比较前读出介质数据的缓冲 */
+    std::vector<std::uint8_t> verify_buffer_;
+
     /** READ 零拷贝：mmap 首地址、起始 LBA、总字节数 */
     std::uint64_t read_lba_ = 0;
     void *read_mmap_base_ = nullptr;
     std::size_t read_total_size_ = 0;
     /** WRITE 零拷贝：mmap 首地址、已收字节数 */
     void *write_mmap_base_ = nullptr;
-    std::size_t write_accumulated_ = 0;
+    std::size_t write_accumulated_ = 0; // mmap / 借出段 WRITE 共用
+    /** 后端借出的内存段：READ 时直接发送，WRITE 时 socket 直接读入（不支持时为空） */
+    StorageSegments read_segments_;
+    StorageSegments write_segments_;
+    std::atomic<std::uint64_t> staged_bytes_{0};
+
+    MscStats stats_;
+    /** 当前命令的计时状态：只有签名正确的 CBW 才计入统计 */
+    bool cmd_tracked_ = false;
+    std::uint8_t cmd_opcode_ = 0;
+    std::chrono::steady_clock::time_point cmd_start_;
+    std::chrono::steady_clock::time_point phase_start_;
+    std::chrono::nanoseconds cmd_backend_{0}; // 本命令后端调用耗时之和
+    std::chrono::nanoseconds phase_backend_mark_{0}; // 当前阶段开始时的 cmd_backend_
+    bool cmd_backend_called_ = false;
+    std::uint64_t cmd_bytes_in_ = 0;
+    std::uint64_t cmd_bytes_out_ = 0;
+
+    /** 计时调用后端，耗时计入 BackendIo 并从所在阶段中扣除 */
+    template<typename F>
+    auto timed_io(F &&f) {
+        auto start = std::chrono::steady_clock::now();
+        cmd_backend_called_ = true;
+        if constexpr (std::is_void_v<std::invoke_result_t<F>>) {
+            f();
+            cmd_backend_ += std::chrono::steady_clock::now() - start;
+        }
+        else {
+            auto r = f();
+            cmd_backend_ += std::chrono::steady_clock::now() - start;
+            return r;
+        }
+    }
+
+    void begin_command(std::uint8_t opcode, std::chrono::steady_clock::time_point start);
+    /** 记录自上一阶段结束以来（扣除后端耗时）的时间 */
+    void end_phase(MscPhase phase);
+    /** CSW 入队：记录 Csw / BackendIo / Total 与命令计数 */
+    void finish_command(bool failed);
+    void record_path(MscDataPath path) {
+        if (cmd_tracked_)
+            stats_.record_path(cmd_opcode_, path);
+    }
+
+    enum class VerifyResult {
+        Match,
+        Miscompare, // 数据不一致：MISCOMPARE
+        ReadError, // 读介质失败：MEDIUM ERROR
+    };
+    /** VERIFY BYTCHK：把 expected 与介质 [lba, lba + count) 比较 */
+    VerifyResult verify_medium(StorageBackend &backend, std::uint64_t lba, std::uint16_t count,
+                               const std::uint8_t *expected, bool same_block);
 
     void send_stall(std::uint32_t seqnum);
+    void handle_unsupported_lun_command(std::uint8_t cmd, std::uint32_t transfer_len);
+    /** 只读 LUN 上的写类命令：DATA PROTECT / WRITE PROTECTED 失败 */
+    void fail_write_protected();
 
 public:
     // ========== 标准请求默认实现 ==========
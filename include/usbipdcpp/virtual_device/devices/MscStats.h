@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+
+namespace usbipdcpp {
+
+/**
+ * @brief 无锁延迟直方图：按 2 的幂划分微秒桶
+ *
+ * 桶 0 为 [0, 1) us，桶 i 为 [2^(i-1), 2^i) us，最后一个桶收容所有更长的耗时。
+ * record 只做几次 relaxed 原子加，可在任意线程调用。
+ */
+class USBIPDCPP_API LatencyHistogram {
+public:
+    static constexpr std::size_t BUCKETS = 24; // 最后一桶起点 2^22 us ≈ 4.2 s
+
+    struct Snapshot {
+        std::uint64_t count = 0;
+        std::uint64_t total_ns = 0;
+        std::uint64_t max_ns = 0;
+        std::array<std::uint64_t, BUCKETS> buckets{};
+
+        [[nodiscard]] double mean_us() const {
+            return count ? static_cast<double>(total_ns) / static_cast<double>(count) / 1000.0 : 0.0;
+        }
+
+        /** 第 p 百分位所在桶的上界（us），无样本返回 0 */
+        [[nodiscard]] double percentile_us(double p) const;
+    };
+
+    void record(std::chrono::nanoseconds elapsed);
+    [[nodiscard]] Snapshot snapshot() const;
+    void reset();
+
+    /** 桶 i 的上界（us，不含） */
+    static double bucket_upper_us(std::size_t i) {
+        return static_cast<double>(std::uint64_t{1} << i);
+    }
+
+private:
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> total_ns_{0};
+    std::atomic<std::uint64_t> max_ns_{0};
+    std::array<std::atomic<std::uint64_t>, BUCKETS> buckets_{};
+};
+
+/**
+ * MSC 命令的处理阶段：
+ *   CbwParse      收到 CBW 到解析完成（不含其中的后端调用）
+ *   BackendIo     本命令内所有后端调用（read / write / flush / punch_hole / 提交）的耗时之和
+ *   DataTransfer  数据阶段：解析完成到最后一个数据 URB 处理完（不含后端调用，含主机往返）
+ *   Csw           进入 Status 到 CSW 入队，即等待主机来取状态的时间
+ *   Total         收到 CBW 到 CSW 入队
+ */
+enum class MscPhase : std::uint8_t {
+    CbwParse,
+    BackendIo,
+    DataTransfer,
+    Csw,
+    Total,
+};
+
+inline constexpr std::size_t MSC_PHASE_COUNT = 5;
+
+/** READ / WRITE 数据走的路径 */
+enum class MscDataPath : std::uint8_t {
+    /** 后端映射区（sendfile / splice 或直接读写映射内存） */
+    Direct,
+    /** 后端借出的内存段 */
+    Segments,
+    /** 经 staging 缓冲拷贝 */
+    Staged,
+};
+
+/**
+ * @brief MscBulkOnlyHandler 按 SCSI 操作码统计的命令数、字节数、数据路径与各阶段延迟
+ *
+ * 全部为 relaxed 原子计数，不依赖 USBIPDCPP_TRACK_PACKAGE 构建，可在运行中随时 snapshot。
+ * 本项目处理的操作码各占一个槽，其余操作码合并到 opcode = OTHER_OPCODE 的槽里。
+ */
+class USBIPDCPP_API MscStats {
+public:
+    /** 未单独统计的操作码在快照中的 opcode 值（0xFF 不是合法的 SCSI 操作码） */
+    static constexpr std::uint8_t OTHER_OPCODE = 0xFF;
+
+    struct OpcodeSnapshot {
+        std::uint8_t opcode;
+        std::uint64_t commands;
+        std::uint64_t failed;
+        /** 发给主机 / 从主机收到的数据阶段字节数 */
+        std::uint64_t bytes_in;
+        std::uint64_t bytes_out;
+        /** 按 MscDataPath 计的命令数，只有 READ / WRITE 有 */
+        std::array<std::uint64_t, 3> paths;
+        /** 按 MscPhase 索引 */
+        std::array<LatencyHistogram::Snapshot, MSC_PHASE_COUNT> phases;
+
+        [[nodiscard]] const LatencyHistogram::Snapshot &phase(MscPhase p) const {
+            return phases[static_cast<std::size_t>(p)];
+        }
+    };
+
+    MscStats();
+
+    /** 一条命令结束（CSW 入队）时调用 */
+    void record_command(std::uint8_t opcode, bool failed, std::uint64_t bytes_in, std::uint64_t bytes_out);
+    void record_phase(std::uint8_t opcode, MscPhase phase, std::chrono::nanoseconds elapsed);
+    void record_path(std::uint8_t opcode, MscDataPath path);
+
+    /** 有过命令的操作码，按操作码升序 */
+    [[nodiscard]] std::vector<OpcodeSnapshot> snapshot() const;
+    /** 单个操作码，没有命令时 commands 为 0 */
+    [[nodiscard]] OpcodeSnapshot snapshot(std::uint8_t opcode) const;
+    void reset();
+
+    static const char *opcode_name(std::uint8_t opcode);
+    static const char *phase_name(MscPhase phase);
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> commands{0};
+        std::atomic<std::uint64_t> failed{0};
+        std::atomic<std::uint64_t> bytes_in{0};
+        std::atomic<std::uint64_t> bytes_out{0};
+        std::array<std::atomic<std::uint64_t>, 3> paths{};
+        std::array<LatencyHistogram, MSC_PHASE_COUNT> phases;
+    };
+
+    /** 单独统计的操作码个数（另加一个 OTHER 槽） */
+    static constexpr std::size_t TRACKED_OPCODES = 22;
+
+    Slot &slot(std::uint8_t opcode) {
+        return slots_[slot_index_[opcode]];
+    }
+
+    OpcodeSnapshot snapshot_slot(std::size_t index) const;
+
+    std::array<std::uint8_t, 256> slot_index_{};
+    std::array<Slot, TRACKED_OPCODES + 1> slots_;
+};
+
+} // namespace usbipdcpp
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/WriteDurability.h"
+
+namespace usbipdcpp {
+
+/**
+ * @brief 把 punch_hole 放到后台线程执行的装饰器
+ *
+ * UNMAP / WRITE SAME(UNMAP=1) 经 punch_hole 进来时只记录范围（相邻、重叠的合并）即返回，
+ * BOT 状态机马上回 CSW；后台线程按 max_discard_blocks 分批调用底层 punch_hole。
+ * 语义上范围在记录时就已经丢弃：
+ *   read   尚未执行的范围（含正在执行的一批）按全零返回
+ *   write  覆盖的块从待执行集合中移除，与正在执行的一批重叠时先等它完成
+ *   flush  屏障：等全部待执行范围落到底层后再转发，SYNCHRONIZE CACHE 之后不会再有打洞
+ * 有待执行范围时 get_direct_buffer / read_segments / write_segments 不借出底层内存，
+ * 统一走 read / write 以便屏蔽；队列空闲时全部转发，零拷贝路径不受影响。
+ * 析构时执行完所有待执行范围。
+ */
+class USBIPDCPP_API AsyncDiscardBackend : public StorageBackend {
+public:
+    /** 每次底层 punch_hole 的最大块数，限制写入等待正在执行的一批的时间 */
+    static constexpr std::uint64_t DEFAULT_MAX_DISCARD_BLOCKS = 1u << 21;
+
+    explicit AsyncDiscardBackend(std::unique_ptr<StorageBackend> inner,
+                                 std::uint64_t max_discard_blocks = DEFAULT_MAX_DISCARD_BLOCKS);
+    ~AsyncDiscardBackend() override;
+
+    AsyncDiscardBackend(const AsyncDiscardBackend &) = delete;
+    AsyncDiscardBackend &operator=(const AsyncDiscardBackend &) = delete;
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override;
+    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override;
+    bool read_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) override;
+    bool write_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) override;
+    bool commit_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &segments) override;
+    /** 只记录范围，立即返回 */
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override;
+    void prefetch(std::uint64_t lba, std::uint64_t count) override;
+    /** 先等待所有待执行的打洞完成，再转发 */
+    bool flush(std::uint64_t lba, std::uint64_t count) override;
+    bool commit_direct_write(std::uint64_t lba, std::uint64_t count) override;
+    void *get_direct_buffer(std::uint64_t lba) override;
+    bool send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     std::error_code &ec) override;
+    bool send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     SplicePipePool &pipes, std::error_code &ec) override;
+    bool recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     std::error_code &ec) override;
+    bool recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     SplicePipePool &pipes, std::error_code &ec) override;
+
+    bool is_read_only() const override {
+        return inner_->is_read_only();
+    }
+
+    std::uint64_t block_count() const override {
+        return inner_->block_count();
+    }
+
+    std::uint32_t block_size() const override {
+        return inner_->block_size();
+    }
+
+    StorageBackend &inner() {
+        return *inner_;
+    }
+
+    /** 等待所有待执行的打洞完成 */
+    void drain();
+
+    /** 尚未执行（含正在执行）的块数 */
+    std::uint64_t pending_blocks() const;
+
+    /** 已交给底层 punch_hole 的批次数与块数 */
+    struct DiscardStats {
+        std::uint64_t queued_ranges;
+        std::uint64_t applied_batches;
+        std::uint64_t applied_blocks;
+    };
+    DiscardStats discard_stats() const;
+
+private:
+    struct Batch {
+        std::uint64_t lba;
+        std::uint64_t count;
+    };
+
+    void worker_loop();
+    /** 有待执行或正在执行的范围（调用方持有 mutex_） */
+    bool busy_locked() const {
+        return inflight_.has_value() || !pending_.empty();
+    }
+    /** 等正在执行的一批不再与 [lba, lba + count) 重叠，然后把该范围移出待执行集合 */
+    void claim_locked(std::unique_lock<std::mutex> &lock, std::uint64_t lba, std::uint64_t count);
+
+    std::unique_ptr<StorageBackend> inner_;
+    std::uint64_t max_discard_blocks_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable worker_cv_; // 有新范围或要求退出
+    std::condition_variable done_cv_; // 一批执行完毕
+    /** 待执行范围，复用 WriteBack 的区间表做合并与按范围移除 */
+    DirtyRangeTracker pending_;
+    std::optional<Batch> inflight_;
+    bool stop_ = false;
+    std::thread worker_;
+
+    std::atomic<std::uint64_t> queued_ranges_{0};
+    std::atomic<std::uint64_t> applied_batches_{0};
+    std::atomic<std::uint64_t> applied_blocks_{0};
+};
+
+} // namespace usbipdcpp
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
+
+namespace usbipdcpp {
+
+/** CachedBackend 的写策略 */
+enum class CacheWriteMode {
+    /** 写穿：写入底层后同时更新缓存，整页覆盖的页直接进缓存 */
+    WriteThrough,
+    /** 绕写：只写底层，缓存中重叠的页作废（写多读少时避免挤掉读热点） */
+    WriteAround,
+};
+
+struct CachedBackendOptions {
+    /** 缓存总字节数，按分片均分 */
+    std::size_t cache_bytes = 64 * 1024 * 1024;
+    /** 缓存页大小（字节，须为块大小的整数倍），未命中时按整页读底层 */
+    std::size_t page_size = 64 * 1024;
+    /** 缓存分片数，多线程访问不同页时减少锁竞争 */
+    std::size_t shards = 16;
+    CacheWriteMode write_mode = CacheWriteMode::WriteThrough;
+};
+
+/**
+ * @brief 给任意后端加一层内存读缓存的装饰器
+ *
+ * 面向单次请求代价高的后端（压缩镜像、NBD、网络文件系统上的镜像）。
+ * 替换策略为 2Q（Johnson & Shasha 1994）：
+ *   A1in  首次访问的页，FIFO，占容量约 1/4，命中不调整位置
+ *   A1out A1in 淘汰页的页号（幽灵项，不占数据内存），容量为缓存页数的一半
+ *   Am    在 A1out 中被再次访问的页，LRU
+ * 一次性的顺序扫描只流经 A1in，不会冲掉 Am 中的热点数据。
+ *
+ * 缓存页不可变（写穿时整页拷贝替换），READ 范围全部命中时通过 read_segments
+ * 直接借出缓存页；数据可能不在底层后端的内存里，因此不提供 get_direct_buffer。
+ * punch_hole 作废重叠的页；flush / prefetch 转发给底层后端。
+ */
+class USBIPDCPP_API CachedBackend : public StorageBackend {
+public:
+    explicit CachedBackend(std::unique_ptr<StorageBackend> inner, CachedBackendOptions options = {});
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override;
+    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override;
+    /** 范围内的页全部在缓存中时借出，否则返回 false */
+    bool read_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) override;
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override;
+    void prefetch(std::uint64_t lba, std::uint64_t count) override;
+    bool flush(std::uint64_t lba, std::uint64_t count) override;
+
+    bool is_read_only() const override {
+        return inner_->is_read_only();
+    }
+
+    std::uint64_t block_count() const override {
+        return inner_->block_count();
+    }
+
+    std::uint32_t block_size() const override {
+        return inner_->block_size();
+    }
+
+    StorageBackend &inner() {
+        return *inner_;
+    }
+
+    /** 按页计数 */
+    struct CacheStats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        /** 未命中但页号在 A1out 中（进入 Am） */
+        std::uint64_t ghost_hits;
+        std::uint64_t evictions;
+        std::size_t cached_bytes;
+    };
+    CacheStats cache_stats() const;
+
+    /** 清空缓存（不影响统计） */
+    void clear();
+
+private:
+    using PageData = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+    enum class Queue : std::uint8_t { A1in, Am };
+
+    struct Entry {
+        PageData data;
+        Queue queue;
+        std::list<std::uint64_t>::iterator pos;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::uint64_t, Entry> map;
+        std::list<std::uint64_t> a1in; // 头部最新
+        std::list<std::uint64_t> am; // 头部最近使用
+        std::list<std::uint64_t> a1out; // 头部最新
+        std::unordered_map<std::uint64_t, std::list<std::uint64_t>::iterator> ghosts;
+        std::size_t a1in_bytes = 0;
+        std::size_t bytes = 0;
+        /** 写入 / 打洞计数：未命中读期间若有变化，读到的数据可能已过期，不放进缓存 */
+        std::uint64_t generation = 0;
+    };
+
+    Shard &shard_of(std::uint64_t page) {
+        return *shards_[page % shards_.size()];
+    }
+
+    PageData lookup(std::uint64_t page);
+    /** 放入缓存：A1out 命中进 Am，否则进 A1in；generation 已变化时放弃 */
+    void insert(std::uint64_t page, PageData data, std::uint64_t generation);
+    void insert_locked(Shard &shard, std::uint64_t page, PageData data);
+    /** 作废页，同时推进 generation */
+    void invalidate(std::uint64_t page);
+    /** 写穿：已缓存的页替换为合并了新数据的副本，replace_whole 时无论是否缓存都放入 */
+    void update(std::uint64_t page, std::size_t page_offset, const std::uint8_t *data, std::size_t length,
+                bool replace_whole);
+    void evict_locked(Shard &shard);
+    void remove_locked(Shard &shard, std::unordered_map<std::uint64_t, Entry>::iterator it);
+    std::uint64_t generation_of(std::uint64_t page);
+    /** 第 page 页的字节数（最后一页可能不满） */
+    std::size_t page_bytes(std::uint64_t page) const;
+
+    std::unique_ptr<StorageBackend> inner_;
+    CachedBackendOptions options_;
+    std::size_t blocks_per_page_;
+    std::size_t shard_capacity_;
+    std::size_t a1in_capacity_; // 每分片
+    std::size_t ghost_capacity_; // 每分片，页数
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> ghost_hits_{0};
+    std::atomic<std::uint64_t> evictions_{0};
+};
+
+} // namespace usbipdcpp
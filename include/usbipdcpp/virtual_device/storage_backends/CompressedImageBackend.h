@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/utils/ThreadPool.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageFileIo.h"
+
+namespace usbipdcpp {
+
+/** 压缩镜像中每个 chunk 的编码方式 */
+enum class ChunkCodec : std::uint32_t {
+    None = 0, // 不压缩（压缩后反而变大的 chunk 也按此存储）
+    Lz4 = 1,
+    Zstd = 2,
+};
+
+struct CompressedImageOptions {
+    /** 解压缓存总字节数，按分片均分 */
+    std::size_t cache_bytes = 64 * 1024 * 1024;
+    /** 缓存分片数，多线程读不同 chunk 时减少锁竞争 */
+    std::size_t cache_shards = 16;
+    /** 并行解压线程数，0 = hardware_concurrency，1 = 只在调用线程内解压 */
+    std::size_t decompress_threads = 0;
+    /** 写覆盖层文件路径，空则为 "<镜像路径>.overlay"，位图为 "<overlay>.map" */
+    std::string overlay_path;
+};
+
+/**
+ * @brief 分块压缩镜像后端（只读底层 + 稀疏写覆盖层）
+ *
+ * 镜像文件由固定大小的 chunk 独立压缩而成（LZ4 或 zstd），文件尾部是
+ * chunk 索引，可通过 convert_raw_image() 从 raw 镜像生成。
+ *
+ * 读：按 chunk 查分片 LRU 缓存，未命中的 chunk 在 ThreadPool 上并行解压，
+ * 大范围 READ(10) 跨多个 chunk 时解压可并行进行。
+ * 写：落到同大小的稀疏覆盖层文件，按块记录在位图侧车文件中，
+ * 读时被覆盖的块从覆盖层取，压缩镜像本身永不修改。块第一次写入时先同步覆盖层数据再写位图，
+ * 掉电后位图里的块一定有数据；改写已覆盖的块不额外同步。
+ *
+ * 数据需要合并解压缓存和覆盖层，因此不提供 get_direct_buffer / send_direct；
+ * 范围内没有覆盖块的 READ 通过 read_segments 直接借出缓存中的 chunk，
+ * 由 socket 从缓存发送，其余 READ/WRITE 走 staging 中转。
+ */
+class USBIPDCPP_API CompressedImageBackend : public StorageBackend {
+public:
+    explicit CompressedImageBackend(std::string path, CompressedImageOptions options = {});
+    ~CompressedImageBackend() override;
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override;
+    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override;
+    /** 借出缓存中的解压 chunk（范围内有覆盖块时返回 false） */
+    bool read_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) override;
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override;
+    /** 同步覆盖层和位图文件（整文件 fdatasync，写入量通常很小） */
+    bool flush(std::uint64_t lba, std::uint64_t count) override;
+    /** 在线程池上后台解压范围内未缓存的 chunk（decompress_threads == 1 时忽略） */
+    void prefetch(std::uint64_t lba, std::uint64_t count) override;
+
+    std::uint64_t block_count() const override {
+        return block_count_;
+    }
+
+    std::uint32_t block_size() const override {
+        return block_size_;
+    }
+
+    bool is_valid() const {
+        return image_fd_ != invalid_fd && overlay_fd_ != invalid_fd;
+    }
+
+    std::uint32_t chunk_size() const {
+        return chunk_size_;
+    }
+
+    ChunkCodec codec() const {
+        return codec_;
+    }
+
+    /** 缓存统计，用于 benchmark 和调优 cache_bytes */
+    struct CacheStats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::size_t cached_bytes;
+    };
+    CacheStats cache_stats() const;
+
+    /** 编译时是否链接了该编解码器（None 总是支持） */
+    static bool codec_supported(ChunkCodec codec);
+
+    /**
+     * @brief 将 raw 镜像转换为分块压缩镜像
+     * @param raw_path    输入 raw 镜像
+     * @param out_path    输出压缩镜像
+     * @param codec       压缩算法
+     * @param chunk_size  每个 chunk 的解压后字节数，必须是 block_size 的整数倍
+     * @param level       压缩级别（zstd: 1..22；LZ4: <=1 为快速模式，>=2 使用 LZ4HC 对应级别）
+     * @param block_size  逻辑块大小
+     * @return 成功返回 true，失败已记录日志
+     */
+    static bool convert_raw_image(const std::string &raw_path, const std::string &out_path,
+                                  ChunkCodec codec = ChunkCodec::Zstd, std::uint32_t chunk_size = 64 * 1024,
+                                  int level = 3, std::uint32_t block_size = 512);
+
+private:
+    using native_fd = detail::native_fd;
+    static inline native_fd const invalid_fd = detail::invalid_fd;
+
+    /** 磁盘上的 chunk 索引项 */
+    struct ChunkEntry {
+        std::uint64_t offset; // chunk 压缩数据在镜像文件中的偏移
+        std::uint32_t stored_size; // 压缩后字节数（全零 chunk 为 0）
+        std::uint32_t flags; // CHUNK_FLAG_*
+    };
+
+    using ChunkData = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+    /** LRU 缓存分片：每片独立加锁，shared_ptr 保证拷贝期间被淘汰也不会悬空 */
+    struct CacheShard {
+        std::mutex mutex;
+        std::list<std::uint64_t> lru; // 头部最近使用
+        std::unordered_map<std::uint64_t, std::pair<ChunkData, std::list<std::uint64_t>::iterator>> map;
+        std::size_t bytes = 0;
+    };
+
+    ChunkData cache_lookup(std::uint64_t chunk);
+    /** 只判断是否已缓存，不调整 LRU 顺序 */
+    bool cache_contains(std::uint64_t chunk);
+    void cache_insert(std::uint64_t chunk, const ChunkData &data);
+    CacheShard &shard_of(std::uint64_t chunk) {
+        return *shards_[chunk % shards_.size()];
+    }
+
+    /** 取 first_chunk 起 chunks.size() 个 chunk（跳过整块被覆盖的），未命中的并行解压，失败的项为 nullptr */
+    void collect_chunks(std::uint64_t first_chunk, std::vector<ChunkData> &chunks);
+
+    /** 读文件并解压单个 chunk，失败返回 nullptr */
+    ChunkData load_chunk(std::uint64_t chunk);
+
+    bool open_overlay(const std::string &overlay_path);
+    bool block_in_overlay(std::uint64_t lba) const {
+        return (overlay_bitmap_[lba / 64] >> (lba % 64)) & 1;
+    }
+    /** 设置位图并写回侧车文件，调用者持有 overlay_mutex_ 写锁。
+     *  有新置位的块时先同步覆盖层数据，保证位图不会先于数据落盘；同步失败返回 false 且不置位 */
+    bool mark_overlay(std::uint64_t lba, std::uint64_t count);
+
+    std::string path_;
+    CompressedImageOptions options_;
+    std::uint64_t block_count_ = 0;
+    std::uint32_t block_size_ = 512;
+    std::uint32_t chunk_size_ = 0;
+    std::uint64_t image_size_ = 0;
+    ChunkCodec codec_ = ChunkCodec::None;
+    std::vector<ChunkEntry> index_;
+
+    native_fd image_fd_ = invalid_fd;
+    native_fd overlay_fd_ = invalid_fd;
+    native_fd bitmap_fd_ = invalid_fd;
+
+    std::vector<std::unique_ptr<CacheShard>> shards_;
+    std::size_t shard_capacity_ = 0; // 每个分片的字节预算
+    std::atomic<std::uint64_t> cache_hits_{0};
+    std::atomic<std::uint64_t> cache_misses_{0};
+    ChunkData zero_chunk_; // 全零 chunk 共用，不进缓存
+
+    /** 覆盖层位图（每块一位）与每个 chunk 中被覆盖的块数（为 0 时整 chunk 直接走缓存） */
+    mutable std::shared_mutex overlay_mutex_;
+    std::vector<std::uint64_t> overlay_bitmap_;
+    std::vector<std::uint32_t> overlay_blocks_per_chunk_;
+
+    std::unique_ptr<ThreadPool> pool_; // decompress_threads == 1 时为空
+    /** 正在后台解压的预读 chunk 数，限制预读占满线程池 */
+    std::atomic<std::size_t> prefetch_inflight_{0};
+};
+
+} // namespace usbipdcpp
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/storage_backends/DedupStore.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageFileIo.h"
+
+namespace usbipdcpp {
+
+/**
+ * @brief 块级去重后端：镜像内容放在共享的 DedupStore 中，本对象只持有 chunk 映射
+ *
+ * 映射文件 = 32 字节头 + 每个 chunk 一个 uint64 id。几百个几乎相同的镜像共享同一份
+ * chunk，磁盘上只存一份，读共享 chunk 时命中的也是同一份页缓存。
+ *
+ * 写时复制：写入（含不满一个 chunk 的写，先读出旧 chunk 再修改）产生新内容后 put 进存储，
+ * 映射指向新 id，再释放旧 id 的引用；其他镜像引用的旧 chunk 不受影响。
+ * punch_hole 把整 chunk 映射回全零 chunk。
+ *
+ * flush 先同步存储再写回映射，映射里不会出现未落盘的 id。
+ */
+class USBIPDCPP_API DedupBackend : public StorageBackend {
+public:
+    /**
+     * @param store          共享存储
+     * @param map_path       映射文件路径，不存在时按 initial_blocks 新建全零镜像
+     * @param initial_blocks 新建时的块数，打开已有映射时忽略
+     * @param block_size     每块字节数，须整除 store 的 chunk_size
+     */
+    DedupBackend(std::shared_ptr<DedupStore> store, std::string map_path, std::uint64_t initial_blocks = 2048,
+                 std::uint32_t block_size = 512);
+    ~DedupBackend() override;
+
+    DedupBackend(const DedupBackend &) = delete;
+    DedupBackend &operator=(const DedupBackend &) = delete;
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override;
+    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override;
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override;
+    bool flush(std::uint64_t lba, std::uint64_t count) override;
+
+    std::uint64_t block_count() const override {
+        return block_count_;
+    }
+
+    std::uint32_t block_size() const override {
+        return block_size_;
+    }
+
+    bool is_valid() const {
+        return map_fd_ != detail::invalid_fd;
+    }
+
+    const std::string &map_path() const {
+        return map_path_;
+    }
+
+    /** 映射中指向非零 chunk 的数量 */
+    std::uint64_t mapped_chunks() const;
+
+    /** 把当前内容克隆为新镜像：只复制映射并增加引用计数，不复制数据。map_path 已存在时失败 */
+    bool clone_to(const std::string &map_path) const;
+
+    /** 把 raw 镜像导入存储并生成映射文件。map_path 已存在时失败 */
+    static bool import_raw_image(const std::shared_ptr<DedupStore> &store, const std::string &raw_path,
+                                 const std::string &map_path, std::uint32_t block_size = 512);
+
+private:
+    /** 在已持有写锁的情况下写入 [offset, offset + len)，src 为 nullptr 表示写零 */
+    bool write_locked(std::uint64_t offset, std::uint64_t len, const std::uint8_t *src);
+    void mark_dirty(std::uint64_t chunk);
+    bool write_header(detail::native_fd fd) const;
+    /** 写回映射中改动过的 id 范围 */
+    bool write_dirty_map();
+
+    std::shared_ptr<DedupStore> store_;
+    std::string map_path_;
+    std::uint32_t block_size_;
+    std::uint32_t chunk_size_;
+    std::uint64_t block_count_ = 0;
+    detail::native_fd map_fd_ = detail::invalid_fd;
+
+    mutable std::shared_mutex mutex_; // 保护 map_
+    std::vector<std::uint64_t> map_; // chunk 下标 → store id
+    std::uint64_t dirty_begin_ = UINT64_MAX;
+    std::uint64_t dirty_end_ = 0;
+};
+
+} // namespace usbipdcpp
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageFileIo.h"
+
+namespace usbipdcpp {
+
+/**
+ * @brief 内容寻址的 chunk 存储，供多个 DedupBackend 共享
+ *
+ * 目录下两个文件：
+ *   chunks.dat  按 id 排列的定长 chunk（id × chunk_size 处），释放的 chunk 打洞归还磁盘
+ *   chunks.ref  16 字节头 + 每个 id 一个 uint32 引用计数
+ *
+ * 内容哈希（有 libxxhash 时用 XXH3-128，否则用内置的 4 路 64 位乘法哈希）只用于查找候选，
+ * 命中后逐字节比较确认，因此哈希碰撞只会少去重一块，不会读错数据。
+ * 哈希索引不落盘，打开时扫描所有存活 chunk 重建。
+ *
+ * id 0 固定表示全零 chunk，不占存储也不计引用。
+ * put / ref / unref 在一把锁下串行；read 直接 pread，可并发。
+ */
+class USBIPDCPP_API DedupStore {
+public:
+    static constexpr std::uint64_t ZERO_CHUNK = 0;
+    static constexpr std::uint64_t INVALID_CHUNK = UINT64_MAX;
+
+    struct Stats {
+        std::uint64_t live_chunks; // 引用计数 > 0 的 chunk 数
+        std::uint64_t free_chunks; // 已释放、等待复用的 id 数
+        std::uint64_t references; // 所有映射对 chunk 的引用总数（不含全零 chunk）
+        std::uint64_t dedup_hits; // put 命中已有 chunk 的次数
+        std::uint64_t stored_bytes; // live_chunks × chunk_size
+        std::uint64_t index_bytes; // 哈希索引、引用计数等内存占用估计
+    };
+
+    /**
+     * @param dir        存储目录，不存在时创建
+     * @param chunk_size 去重粒度（512 的整数倍的 2 的幂），打开已有存储时须与创建时一致
+     */
+    explicit DedupStore(std::string dir, std::uint32_t chunk_size = 4096);
+    ~DedupStore();
+
+    DedupStore(const DedupStore &) = delete;
+    DedupStore &operator=(const DedupStore &) = delete;
+
+    bool is_valid() const {
+        return data_fd_ != detail::invalid_fd && ref_fd_ != detail::invalid_fd;
+    }
+
+    std::uint32_t chunk_size() const {
+        return chunk_size_;
+    }
+
+    const std::string &dir() const {
+        return dir_;
+    }
+
+    /** 已分配过的 id 数（含 ZERO_CHUNK），有效 id 都小于它 */
+    std::uint64_t chunk_count() const;
+
+    /**
+     * 存入一个 chunk 的内容，返回持有一个引用的 id。
+     * 内容已存在时只加引用，全零返回 ZERO_CHUNK，写盘失败返回 INVALID_CHUNK
+     */
+    std::uint64_t put(const void *data);
+    /** 给一批 id 各加一个引用（克隆映射时用），ZERO_CHUNK 被忽略 */
+    void ref(const std::uint64_t *ids, std::size_t count);
+    /** 释放一个引用，计数归零的 chunk 从索引移除并打洞 */
+    void unref(std::uint64_t id);
+
+    /** 读一个 chunk，ZERO_CHUNK 填零 */
+    bool read(std::uint64_t id, void *out) const;
+    /** 读 id 连续的 count 个 chunk（一次 pread） */
+    bool read_run(std::uint64_t first_id, std::size_t count, void *out) const;
+
+    /** 写回引用计数并同步两个文件 */
+    bool sync();
+
+    Stats stats() const;
+
+    struct Hash128 {
+        std::uint64_t lo;
+        std::uint64_t hi;
+
+        bool operator==(const Hash128 &) const = default;
+    };
+    static Hash128 hash_chunk(const void *data, std::size_t len);
+
+private:
+    struct HashHasher {
+        std::size_t operator()(const Hash128 &h) const {
+            return static_cast<std::size_t>(h.lo);
+        }
+    };
+
+    bool open();
+    void mark_dirty(std::uint64_t id);
+
+    std::string dir_;
+    std::uint32_t chunk_size_;
+    detail::native_fd data_fd_ = detail::invalid_fd;
+    detail::native_fd ref_fd_ = detail::invalid_fd;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Hash128, std::uint64_t, HashHasher> index_;
+    std::vector<std::uint32_t> refcounts_; // 下标即 id，[0] 不用
+    std::vector<Hash128> hashes_; // 每个 id 的内容哈希，释放时用来删索引
+    std::vector<std::uint64_t> free_; // 可复用的 id
+    std::uint64_t references_ = 0;
+    // 引用计数文件中待写回的 id 范围 [dirty_begin_, dirty_end_)
+    std::uint64_t dirty_begin_ = UINT64_MAX;
+    std::uint64_t dirty_end_ = 0;
+    std::atomic<std::uint64_t> dedup_hits_{0};
+};
+
+} // namespace usbipdcpp
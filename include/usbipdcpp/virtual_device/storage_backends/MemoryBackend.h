@@ -1,45 +1,57 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <cstring>
-#include <vector>
 
 #include "usbipdcpp/Export.h"
 #include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
 
 namespace usbipdcpp {
 
-/** 纯内存块存储后端，不落盘，无平台依赖。主要用于测试或临时数据。
- *  get_direct_buffer 返回内部缓冲区指针，READ/WRITE 零拷贝均可用。 */
+/**
+ * @brief 纯内存块存储后端，不落盘。主要用于测试或临时数据（RAM 盘）。
+ *
+ * 构造时只用匿名 mmap（MAP_NORESERVE）/ VirtualAlloc 保留地址空间，不清零也不占物理内存：
+ * 未写过的块读出来是内核共享零页，首次写入时才按页分配。punch_hole 用
+ * MADV_DONTNEED / MEM_DECOMMIT 把整页归还给系统，因此 32 GiB 的 RAM 盘启动是瞬时的，
+ * RSS 只随实际写入的数据增长。
+ *
+ * get_direct_buffer 返回映射区指针，READ/WRITE 零拷贝均可用。
+ * Linux 上较大的 READ 用 vmsplice 把映射区的页挂进管道再 splice 到 socket，省掉 write 的一次拷贝。
+ * 页在 TCP 发送队列里被引用期间若被改写，发出的是新内容；BOT 命令串行执行，
+ * host 收到 CSW（排在数据之后）之前不会发出覆盖同一范围的 WRITE，因此不会出现这种情况。
+ */
 class USBIPDCPP_API MemoryBackend : public StorageBackend {
 public:
-    explicit MemoryBackend(std::uint64_t blocks, std::uint32_t block_size = 512) :
-        block_count_(blocks), block_size_(block_size), data_(static_cast<std::size_t>(blocks) * block_size) {
-    }
+    /** 大页策略（仅 Linux 生效，其他平台忽略） */
+    enum class HugePages {
+        None,
+        /** madvise(MADV_HUGEPAGE)，由透明大页在写入时按 2 MiB 分配。
+         *  顺序大块写 TLB 命中更好，但稀疏随机写会把 RSS 放大到 2 MiB 粒度 */
+        Transparent,
+        /** MAP_HUGETLB，需预先配置 vm.nr_hugepages 且池中有足够大页覆盖整盘（构造时预留）；
+         *  失败时回退为普通页 */
+        Explicit,
+    };
 
-    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override {
-        auto total = static_cast<std::size_t>(count) * block_size_;
-        auto offset = static_cast<std::size_t>(lba) * block_size_;
-        std::memcpy(buffer, data_.data() + offset, total);
-        return total;
-    }
+    explicit MemoryBackend(std::uint64_t blocks, std::uint32_t block_size = 512, HugePages huge_pages = HugePages::None);
+    ~MemoryBackend() override;
 
-    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override {
-        auto total = static_cast<std::size_t>(count) * block_size_;
-        auto offset = static_cast<std::size_t>(lba) * block_size_;
-        std::memcpy(data_.data() + offset, data, total);
-        return total;
-    }
+    MemoryBackend(const MemoryBackend &) = delete;
+    MemoryBackend &operator=(const MemoryBackend &) = delete;
 
-    void punch_hole(std::uint64_t lba, std::uint64_t count) override {
-        auto offset = static_cast<std::size_t>(lba) * block_size_;
-        auto length = static_cast<std::size_t>(count) * block_size_;
-        std::memset(data_.data() + offset, 0, length);
-    }
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override;
+    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override;
+    /** 整页部分 MADV_DONTNEED 归还物理内存，首尾不满一页的部分清零 */
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override;
+    void *get_direct_buffer(std::uint64_t lba) override;
+    using StorageBackend::send_direct;
+    /** vmsplice 零拷贝发送（仅 Linux，且长度不小于 VMSPLICE_MIN_BYTES），管道从 pipes 租用 */
+    bool send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     SplicePipePool &pipes, std::error_code &ec) override;
 
-    void *get_direct_buffer(std::uint64_t lba) override {
-        return data_.data() + static_cast<std::size_t>(lba) * block_size_;
-    }
+    /** 短于此长度的 READ 直接 write 拷贝更便宜 */
+    static constexpr std::size_t VMSPLICE_MIN_BYTES = 16 * 1024;
 
     std::uint64_t block_count() const override {
         return block_count_;
@@ -48,10 +60,22 @@ public:
         return block_size_;
     }
 
+    bool is_valid() const {
+        return data_ != nullptr;
+    }
+
+    /** 实际生效的大页策略（Explicit 分配失败时为 None） */
+    HugePages huge_pages() const {
+        return huge_pages_;
+    }
+
 private:
     std::uint64_t block_count_;
     std::uint32_t block_size_;
-    std::vector<std::uint8_t> data_;
+    HugePages huge_pages_;
+    std::uint8_t *data_ = nullptr; // 映射区首地址
+    std::size_t mapped_size_ = 0; // 映射字节数（向上取整到 page_size_）
+    std::size_t page_size_ = 4096; // 释放内存的粒度：普通页或 hugetlb 页
 };
 
 } // namespace usbipdcpp
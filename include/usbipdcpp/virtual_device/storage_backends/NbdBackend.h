@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
+
+namespace usbipdcpp {
+
+struct NbdOptions {
+    /** 单个 NBD 请求的最大字节数，更大的 READ/WRITE 拆成多个请求流水线发出。
+     *  服务器在 NBD_INFO_BLOCK_SIZE 中给出更小的上限时取较小值 */
+    std::size_t max_request_bytes = 256 * 1024;
+    /** 同时在途的请求数上限（所有调用线程共享），1 = 严格一问一答 */
+    std::size_t max_in_flight = 16;
+    /** 协商结构化回复（NBD_OPT_STRUCTURED_REPLY），服务器可分块、乱序返回 READ 数据并用 hole 表示全零 */
+    bool structured_replies = true;
+};
+
+/** NBD URI 解析结果 */
+struct NbdAddress {
+    std::string host; // TCP 主机名 / 地址，unix socket 时为空
+    std::uint16_t port = 0;
+    std::string socket_path; // unix socket 路径，TCP 时为空
+    std::string export_name;
+};
+
+/**
+ * @brief NBD 客户端后端：块设备放在远端 NBD 服务器（nbdkit / qemu-nbd / nbd-server）上
+ *
+ * 省去"内核 nbd 挂载 + RawImageBackend"的两层页缓存。连接地址用标准 NBD URI：
+ *   nbd://host[:port][/export]
+ *   nbd+unix:///export?socket=/path/to/sock
+ *
+ * 握手走 fixed newstyle，优先 NBD_OPT_GO（失败回退 EXPORT_NAME），可选结构化回复。
+ * 传输阶段一条连接上多个请求同时在途：调用线程发出请求后在 cookie 表上等待，
+ * 独立的接收线程按 cookie 把回复直接写入调用者的缓冲区。大块 READ/WRITE
+ * 按 max_request_bytes 拆分，所有分片先全部发出再统一等待。
+ *
+ * punch_hole 映射为 NBD_CMD_TRIM，flush 映射为 NBD_CMD_FLUSH，prefetch 映射为
+ * NBD_CMD_CACHE（均仅在服务器声明支持时发送）。
+ * 连接断开后所有在途与后续请求失败，不自动重连。
+ */
+class USBIPDCPP_API NbdBackend : public StorageBackend {
+public:
+    /**
+     * @param uri        NBD URI
+     * @param options    流水线参数
+     * @param block_size 向主机报告的块大小，导出大小须为其整数倍（多余部分不可见）
+     */
+    explicit NbdBackend(const std::string &uri, NbdOptions options = {}, std::uint32_t block_size = 512);
+    ~NbdBackend() override;
+
+    NbdBackend(const NbdBackend &) = delete;
+    NbdBackend &operator=(const NbdBackend &) = delete;
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override;
+    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override;
+    /** NBD_CMD_TRIM，等待服务器确认 */
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override;
+    /** NBD_CMD_CACHE，不等待回复 */
+    void prefetch(std::uint64_t lba, std::uint64_t count) override;
+    /** NBD_CMD_FLUSH（协议只有整盘 flush，范围参数被忽略） */
+    bool flush(std::uint64_t lba, std::uint64_t count) override;
+
+    std::uint64_t block_count() const override {
+        return block_count_;
+    }
+
+    std::uint32_t block_size() const override {
+        return block_size_;
+    }
+
+    /** 握手成功且连接未断开 */
+    bool is_valid() const {
+        return connected_.load(std::memory_order_acquire);
+    }
+
+    /** 导出被服务器标记为只读（NBD_FLAG_READ_ONLY），此时 write 一律失败 */
+    bool is_read_only() const override {
+        return read_only_;
+    }
+
+    bool structured_replies() const {
+        return structured_;
+    }
+
+    /** 服务器支持的可选命令 */
+    bool can_trim() const;
+    bool can_flush() const;
+    bool can_cache() const;
+
+    /** 实际使用的单请求上限（与服务器 NBD_INFO_BLOCK_SIZE 协商后） */
+    std::size_t max_request_bytes() const {
+        return max_request_bytes_;
+    }
+
+    /**
+     * 解析 NBD URI，失败返回 false
+     * nbd:// 默认端口 10809，未给出 export 时为空名（默认导出）
+     */
+    static bool parse_uri(const std::string &uri, NbdAddress &address);
+
+private:
+    struct Connection; // asio socket，放在 .cpp 中避免头文件依赖 asio
+    /** 一个在途请求，由 cookie 索引 */
+    struct Pending {
+        std::uint16_t type = 0;
+        std::uint64_t offset = 0;
+        std::uint32_t length = 0;
+        std::uint8_t *dst = nullptr; // READ 的目标缓冲区
+        std::uint32_t error = 0; // 非 0 = 服务器返回的错误码或连接失败
+        bool done = false;
+        bool detached = false; // 无人等待（CACHE），完成后由接收线程删除
+    };
+
+    bool connect(const NbdAddress &address);
+    bool handshake(const std::string &export_name);
+
+    /** 占用一个在途名额并发出请求，返回 cookie；连接已断开返回 0 */
+    std::uint64_t submit(std::uint16_t type, std::uint64_t offset, std::uint32_t length, const void *payload,
+                         void *dst, bool detached = false);
+    /** 等待请求完成并移出 cookie 表，返回错误码（0 = 成功） */
+    std::uint32_t wait(std::uint64_t cookie);
+    /** 按 max_request_bytes 拆分后流水线发出，全部成功返回 true */
+    bool transfer(std::uint16_t type, std::uint64_t offset, std::uint64_t length, const void *payload, void *dst);
+
+    void receive_loop();
+    /** 接收线程：请求完成（或失败）时调用，需持有 mutex_ */
+    void complete(std::unordered_map<std::uint64_t, Pending>::iterator it, std::uint32_t error);
+    /** 连接出错：标记断开并让所有在途请求失败 */
+    void fail_all();
+
+    std::unique_ptr<Connection> conn_;
+    NbdOptions options_;
+    std::uint32_t block_size_;
+    std::uint64_t block_count_ = 0;
+    std::uint64_t export_size_ = 0;
+    std::uint16_t transmission_flags_ = 0;
+    bool read_only_ = false;
+    bool structured_ = false;
+    std::size_t max_request_bytes_ = 0;
+    std::atomic<bool> connected_{false};
+
+    std::mutex send_mutex_; // 请求头和数据须连续写入 socket
+    std::mutex mutex_; // 保护 pending_ / in_flight_
+    std::condition_variable cv_;
+    std::unordered_map<std::uint64_t, Pending> pending_;
+    std::uint64_t next_cookie_ = 1;
+    std::size_t in_flight_ = 0;
+
+    std::thread receiver_;
+};
+
+} // namespace usbipdcpp
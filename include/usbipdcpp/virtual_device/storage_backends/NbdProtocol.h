@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace usbipdcpp {
+
+/// NBD 协议常量（https://github.com/NetworkBlockDevice/nbd/blob/master/doc/proto.md）
+/// 线上全部大端序。NbdBackend 与 tests 中的模拟服务器共用
+namespace nbd {
+
+    inline constexpr std::uint16_t DEFAULT_PORT = 10809;
+
+    /// 握手阶段
+    inline constexpr std::uint64_t NBDMAGIC = 0x4e42444d41474943; // "NBDMAGIC"
+    inline constexpr std::uint64_t IHAVEOPT = 0x49484156454f5054; // "IHAVEOPT"，fixed newstyle
+    inline constexpr std::uint64_t OLDSTYLE_MAGIC = 0x0000420281861253;
+    inline constexpr std::uint64_t OPTION_REPLY_MAGIC = 0x0003e889045565a9;
+
+    /// 服务器握手标志
+    inline constexpr std::uint16_t FLAG_FIXED_NEWSTYLE = 1 << 0;
+    inline constexpr std::uint16_t FLAG_NO_ZEROES = 1 << 1;
+    /// 客户端标志
+    inline constexpr std::uint32_t FLAG_C_FIXED_NEWSTYLE = 1 << 0;
+    inline constexpr std::uint32_t FLAG_C_NO_ZEROES = 1 << 1;
+
+    namespace Opt {
+        inline constexpr std::uint32_t ExportName = 1;
+        inline constexpr std::uint32_t Abort = 2;
+        inline constexpr std::uint32_t Go = 7;
+        inline constexpr std::uint32_t StructuredReply = 8;
+    } // namespace Opt
+
+    namespace Rep {
+        inline constexpr std::uint32_t Ack = 1;
+        inline constexpr std::uint32_t Info = 3;
+        inline constexpr std::uint32_t ErrBit = 1u << 31;
+        inline constexpr std::uint32_t ErrUnsup = ErrBit | 1;
+        inline constexpr std::uint32_t ErrUnknown = ErrBit | 6;
+    } // namespace Rep
+
+    namespace Info {
+        inline constexpr std::uint16_t Export = 0;
+        inline constexpr std::uint16_t BlockSize = 3;
+    } // namespace Info
+
+    /// 传输标志（NBD_INFO_EXPORT / EXPORT_NAME 回复中）
+    inline constexpr std::uint16_t FLAG_HAS_FLAGS = 1 << 0;
+    inline constexpr std::uint16_t FLAG_READ_ONLY = 1 << 1;
+    inline constexpr std::uint16_t FLAG_SEND_FLUSH = 1 << 2;
+    inline constexpr std::uint16_t FLAG_SEND_FUA = 1 << 3;
+    inline constexpr std::uint16_t FLAG_SEND_TRIM = 1 << 5;
+    inline constexpr std::uint16_t FLAG_SEND_WRITE_ZEROES = 1 << 6;
+    inline constexpr std::uint16_t FLAG_CAN_MULTI_CONN = 1 << 8;
+    inline constexpr std::uint16_t FLAG_SEND_CACHE = 1 << 10;
+
+    /// 传输阶段
+    inline constexpr std::uint32_t REQUEST_MAGIC = 0x25609513;
+    inline constexpr std::uint32_t SIMPLE_REPLY_MAGIC = 0x67446698;
+    inline constexpr std::uint32_t STRUCTURED_REPLY_MAGIC = 0x668e33ef;
+
+    namespace Cmd {
+        inline constexpr std::uint16_t Read = 0;
+        inline constexpr std::uint16_t Write = 1;
+        inline constexpr std::uint16_t Disc = 2;
+        inline constexpr std::uint16_t Flush = 3;
+        inline constexpr std::uint16_t Trim = 4;
+        inline constexpr std::uint16_t Cache = 5;
+    } // namespace Cmd
+
+    inline constexpr std::uint16_t CMD_FLAG_FUA = 1 << 0;
+
+    namespace ReplyType {
+        inline constexpr std::uint16_t None = 0;
+        inline constexpr std::uint16_t OffsetData = 1;
+        inline constexpr std::uint16_t OffsetHole = 2;
+        inline constexpr std::uint16_t Error = (1 << 15) | 1;
+        inline constexpr std::uint16_t ErrorOffset = (1 << 15) | 2;
+    } // namespace ReplyType
+
+    inline constexpr std::uint16_t REPLY_FLAG_DONE = 1 << 0;
+
+    /// 请求头 28 字节：magic, flags, type, cookie, offset, length
+    inline constexpr std::size_t REQUEST_HEADER_SIZE = 28;
+    /// 简单回复头 16 字节：magic, error, cookie
+    inline constexpr std::size_t SIMPLE_REPLY_SIZE = 16;
+    /// 结构化回复头 20 字节：magic, flags, type, cookie, length
+    inline constexpr std::size_t STRUCTURED_REPLY_SIZE = 20;
+
+    /// 线上的错误码（数值取自 Linux errno，协议规定与平台无关）
+    namespace Err {
+        inline constexpr std::uint32_t Perm = 1;
+        inline constexpr std::uint32_t Io = 5;
+        inline constexpr std::uint32_t NoMem = 12;
+        inline constexpr std::uint32_t Inval = 22;
+        inline constexpr std::uint32_t NoSpc = 28;
+        inline constexpr std::uint32_t Overflow = 75;
+        inline constexpr std::uint32_t NotSup = 95;
+        inline constexpr std::uint32_t Shutdown = 108;
+    } // namespace Err
+
+    inline void put_be16(std::uint8_t *p, std::uint16_t v) {
+        p[0] = static_cast<std::uint8_t>(v >> 8);
+        p[1] = static_cast<std::uint8_t>(v);
+    }
+
+    inline void put_be32(std::uint8_t *p, std::uint32_t v) {
+        put_be16(p, static_cast<std::uint16_t>(v >> 16));
+        put_be16(p + 2, static_cast<std::uint16_t>(v));
+    }
+
+    inline void put_be64(std::uint8_t *p, std::uint64_t v) {
+        put_be32(p, static_cast<std::uint32_t>(v >> 32));
+        put_be32(p + 4, static_cast<std::uint32_t>(v));
+    }
+
+    inline std::uint16_t get_be16(const std::uint8_t *p) {
+        return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    inline std::uint32_t get_be32(const std::uint8_t *p) {
+        return (std::uint32_t(get_be16(p)) << 16) | get_be16(p + 2);
+    }
+
+    inline std::uint64_t get_be64(const std::uint8_t *p) {
+        return (std::uint64_t(get_be32(p)) << 32) | get_be32(p + 4);
+    }
+
+} // namespace nbd
+
+} // namespace usbipdcpp
@@ -1,20 +1,31 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "usbipdcpp/Export.h"
+#include "usbipdcpp/utils/ThreadPool.h"
 #include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/WriteDurability.h"
 
 namespace usbipdcpp {
 
 /**
  * @brief 原始磁盘镜像文件后端（内存映射实现，跨平台）
  *
- * 将整个镜像文件通过 mmap / MapViewOfFile 映射到进程地址空间，
- * 读写在映射内存上直接 memcpy，由 OS 负责异步写回磁盘。
+ * 将整个镜像文件通过 mmap / MapViewOfFile 映射到进程地址空间，读在映射内存上直接 memcpy。
+ * 写入何时落盘由 DurabilityConfig 决定：
+ *   WriteThrough：pwrite + fdatasync 同步写穿
+ *   WriteBack（默认）：写映射区并记录脏范围，后台线程按周期或脏数据量批量
+ *                      sync_file_range + msync 刷盘，flush() 只同步请求覆盖的脏范围
+ *   Unsafe：写映射区后交给 OS 异步写回
  *
  * 文件不存在时自动创建并填零到 initial_blocks 大小。
  * 文件已存在时根据实际大小估算块数（文件大小 / 512）。
@@ -25,18 +36,32 @@ public:
      * @param path           镜像文件路径
      * @param initial_blocks 新建文件时的块数，打开已有文件时忽略
      * @param block_size     每块字节数（默认 512）
+     * @param durability     写入持久化策略
      */
-    explicit RawImageBackend(std::string path, std::uint64_t initial_blocks = 2048, std::uint32_t block_size = 512);
+    explicit RawImageBackend(std::string path, std::uint64_t initial_blocks = 2048, std::uint32_t block_size = 512,
+                             DurabilityConfig durability = {});
     ~RawImageBackend() override;
 
     std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override;
     std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override;
     void punch_hole(std::uint64_t lba, std::uint64_t count) override;
+    /** 在后台线程上 madvise(MADV_POPULATE_READ，不支持时 MADV_WILLNEED) / PrefetchVirtualMemory，
+     *  调用者不等待 I/O */
+    void prefetch(std::uint64_t lba, std::uint64_t count) override;
+    /** WriteBack：同步范围内的脏区间并等待完成；其他模式无事可做 */
+    bool flush(std::uint64_t lba, std::uint64_t count) override;
+    /** 零拷贝写入收齐后调用：WriteThrough 立即同步，WriteBack 记录脏范围 */
+    bool commit_direct_write(std::uint64_t lba, std::uint64_t count) override;
     void *get_direct_buffer(std::uint64_t lba) override;
+    using StorageBackend::send_direct;
+    using StorageBackend::recv_direct;
+    /** Linux sendfile / macOS sendfile / Windows TransmitFile，不需要管道 */
     bool send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
                      std::error_code &ec) override;
+    /** Linux：sock → pipe → file 两次 splice，管道从 pipes 租用（每个线程独占）。
+     *  仅在 set_splice_receive(true) 后启用 */
     bool recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
-                     std::error_code &ec) override;
+                     SplicePipePool &pipes, std::error_code &ec) override;
 
     std::uint64_t block_count() const override {
         return block_count_;
@@ -54,6 +79,23 @@ public:
         return mapped_data_ != nullptr;
     }
 
+    WriteDurability durability() const {
+        return durability_.mode;
+    }
+
+    /**
+     * WRITE 是否用 splice 接收。TCP 的 splice_read 仍要把数据拷进页缓存，
+     * 实测（bench_zero_copy）每 GiB CPU 比直接 read 进映射区还高，默认关闭
+     */
+    void set_splice_receive(bool enable) {
+        splice_receive_.store(enable, std::memory_order_relaxed);
+    }
+
+    /** 尚未落盘的块数（仅 WriteBack 跟踪，其他模式恒为 0） */
+    std::uint64_t dirty_blocks() const {
+        return dirty_.dirty_blocks();
+    }
+
 private:
     std::string path_; // 文件路径
     std::uint64_t block_count_; // 总块数
@@ -61,6 +103,27 @@ private:
     void *mapped_data_ = nullptr; // 映射后的内存首地址
     std::size_t mapped_size_ = 0; // 映射的总字节数
     mutable std::mutex mutex_; // 保护并发读写
+    std::atomic<bool> splice_receive_{false};
+
+    DurabilityConfig durability_;
+    DirtyRangeTracker dirty_; // WriteBack 脏范围
+    /** WriteBack 后台刷盘线程：周期到达或脏数据超过 dirty_limit_bytes 时批量同步 */
+    std::thread flusher_;
+    std::mutex flusher_mutex_;
+    std::condition_variable flusher_cv_;
+    bool flusher_stop_ = false;
+    bool flusher_kick_ = false; // 脏数据超限，提前刷盘
+
+    void flusher_loop();
+    /** 写入后按策略处理：WriteThrough 同步，WriteBack 记录脏范围并视情况唤醒刷盘线程 */
+    bool after_write(std::uint64_t lba, std::uint64_t count);
+    /** 同步一批脏区间，全部成功返回 true */
+    bool sync_ranges(const std::vector<DirtyRangeTracker::Range> &ranges);
+
+    /** 预读线程：WILLNEED 会同步分配页并提交 bio，大窗口耗时可达数百 us，
+     *  放到后台避免拖慢当前命令。首次 prefetch 时创建 */
+    std::unique_ptr<ThreadPool> prefetch_worker_;
+    std::atomic<int> prefetch_inflight_{0};
 
 #ifdef _WIN32
     void *file_handle_ = nullptr; // CreateFile 返回的 HANDLE
@@ -68,9 +131,6 @@ private:
 #else
     int fd_ = -1; // open 返回的文件描述符
     int fs_block_size_ = 4096; // 文件系统块大小，punch_hole 对齐用
-#ifdef __linux__
-    int splice_pipe_[2] = {-1, -1}; // splice 用管道
-#endif
 #endif
 };
 
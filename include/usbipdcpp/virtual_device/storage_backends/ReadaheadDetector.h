@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+namespace usbipdcpp {
+
+/**
+ * @brief 顺序读检测 + 自适应预读窗口（每个 LUN 一个实例）
+ *
+ * 仿照内核 page cache readahead：连续命中 min_sequential 次相邻 READ 后认为是顺序流，
+ * 发出第一个预读窗口；读者推进到已预读区域后半段时（异步标记）再发下一个窗口，
+ * 窗口每次翻倍直到 max_window。任何不相邻的读都会把状态清零，随机访问不产生预读。
+ *
+ * 检测器只给出要预读的范围，由调用者交给 StorageBackend::prefetch 执行。
+ * 非线程安全：BOT 每个 LUN 同时只有一个命令。
+ */
+class ReadaheadDetector {
+public:
+    struct Config {
+        bool enabled = true;
+        /** 连续多少次相邻读后开始预读 */
+        std::uint32_t min_sequential = 2;
+        /** 首个预读窗口块数（512B 块时 128 = 64 KiB） */
+        std::uint32_t initial_window = 128;
+        /** 预读窗口上限块数（512B 块时 8192 = 4 MiB） */
+        std::uint32_t max_window = 8192;
+    };
+
+    struct Range {
+        std::uint64_t lba;
+        std::uint64_t count;
+    };
+
+    ReadaheadDetector() = default;
+
+    explicit ReadaheadDetector(Config config) : config_(config) {
+    }
+
+    /**
+     * 记录一次读，返回需要发起的预读范围
+     * @param block_count 介质总块数，预读范围会被截断到介质末尾
+     */
+    std::optional<Range> on_read(std::uint64_t lba, std::uint64_t count, std::uint64_t block_count) {
+        if (!config_.enabled || count == 0) {
+            return std::nullopt;
+        }
+        auto end = lba + count;
+        if (lba == next_lba_) {
+            ++streak_;
+        }
+        else {
+            // 随机访问：放弃当前流
+            streak_ = 0;
+            window_ = 0;
+            prefetched_end_ = 0;
+        }
+        next_lba_ = end;
+        if (streak_ < config_.min_sequential) {
+            return std::nullopt;
+        }
+        // 已预读区域还剩超过半个窗口，暂不发新的
+        if (prefetched_end_ > end && prefetched_end_ - end > window_ / 2) {
+            return std::nullopt;
+        }
+        window_ = window_ == 0 ? config_.initial_window : std::min(window_ * 2, config_.max_window);
+        auto start = std::max(end, prefetched_end_);
+        if (start >= block_count) {
+            return std::nullopt;
+        }
+        auto len = std::min<std::uint64_t>(window_, block_count - start);
+        prefetched_end_ = start + len;
+        ++issued_;
+        return Range{start, len};
+    }
+
+    /** 清空状态（新连接 / 设备复位） */
+    void reset() {
+        next_lba_ = UINT64_MAX;
+        streak_ = 0;
+        window_ = 0;
+        prefetched_end_ = 0;
+    }
+
+    [[nodiscard]] std::uint32_t window() const {
+        return window_;
+    }
+
+    [[nodiscard]] std::uint64_t issued() const {
+        return issued_;
+    }
+
+    [[nodiscard]] const Config &config() const {
+        return config_;
+    }
+
+private:
+    Config config_;
+    std::uint64_t next_lba_ = UINT64_MAX; // 下一个顺序读期望的起始 LBA
+    std::uint32_t streak_ = 0; // 连续相邻读次数
+    std::uint32_t window_ = 0; // 当前预读窗口块数，0 = 未进入顺序流
+    std::uint64_t prefetched_end_ = 0; // 已发出预读的末尾 LBA（不含）
+    std::uint64_t issued_ = 0; // 累计发出的预读次数
+};
+
+} // namespace usbipdcpp
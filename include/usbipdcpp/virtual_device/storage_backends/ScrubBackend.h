@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageFileIo.h"
+
+namespace usbipdcpp {
+
+struct ScrubOptions {
+    /** 每个校验和覆盖的块数 */
+    std::uint32_t chunk_blocks = 128;
+    /** 后台读取速率上限，0 表示不限速 */
+    std::uint64_t bytes_per_second = 16ull * 1024 * 1024;
+    /** 最近这段时间内有前台 I/O 时暂停，让出磁盘 */
+    std::chrono::milliseconds idle_after_io{20};
+    /** 一轮扫完后到下一轮开始的间隔 */
+    std::chrono::milliseconds pass_interval{std::chrono::hours(1)};
+    /** 校验不一致的 chunk 隔多久复查，复查仍不一致才报告（排除尚未提交的直写） */
+    std::chrono::milliseconds confirm_delay{1000};
+    /** 确认不一致时回调（在后台线程中），范围为整个 chunk */
+    std::function<void(std::uint64_t lba, std::uint64_t count)> on_mismatch;
+};
+
+/**
+ * @brief 后台完整性巡检装饰器
+ *
+ * 后台线程按 chunk 循环读取底层数据并计算校验和（有 libxxhash 时用 XXH3-64，
+ * 否则用 CRC32C，x86-64 SSE4.2 / ARMv8 CRC 指令可用时走硬件），与 sidecar 文件中记录的值比较：
+ *   首次扫描或 chunk 被前台写过：记录新校验和
+ *   未被写过但校验和变了：镜像在本进程之外被改动或介质损坏，复查确认后报告
+ * 前台 write / commit_* / punch_hole 只给对应 chunk 的代号加一，不做任何计算。
+ * 读取按 bytes_per_second 限速，并在前台 I/O 活跃时暂停，尽量不影响前台延迟。
+ *
+ * sidecar 每轮结束与析构时整体写回。加载后的第一次写入会先把文件头标记为未同步，
+ * 进程异常退出后下次打开发现该标记即丢弃旧校验和重建，避免误报。
+ */
+class USBIPDCPP_API ScrubBackend : public StorageBackend {
+public:
+    struct Range {
+        std::uint64_t lba;
+        std::uint64_t count;
+    };
+
+    struct ScrubStats {
+        std::uint64_t passes; // 完整扫完的轮数
+        std::uint64_t bytes_read;
+        std::uint64_t verified_chunks; // 校验一致
+        std::uint64_t recorded_chunks; // 首次或写入后重新记录
+        std::uint64_t skipped_chunks; // 读取期间被前台写入，留待下轮
+        std::uint64_t mismatches; // 已确认的不一致
+        std::uint64_t paused_ms; // 为前台 I/O 让路的累计时间
+    };
+
+    ScrubBackend(std::unique_ptr<StorageBackend> inner, std::string sidecar_path, ScrubOptions options = {});
+    ~ScrubBackend() override;
+
+    ScrubBackend(const ScrubBackend &) = delete;
+    ScrubBackend &operator=(const ScrubBackend &) = delete;
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override;
+    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override;
+    bool read_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) override;
+    bool write_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) override;
+    bool commit_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &segments) override;
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override;
+    void prefetch(std::uint64_t lba, std::uint64_t count) override;
+    bool flush(std::uint64_t lba, std::uint64_t count) override;
+    bool commit_direct_write(std::uint64_t lba, std::uint64_t count) override;
+    void *get_direct_buffer(std::uint64_t lba) override;
+    bool send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     std::error_code &ec) override;
+    bool send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     SplicePipePool &pipes, std::error_code &ec) override;
+    bool recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     std::error_code &ec) override;
+    bool recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     SplicePipePool &pipes, std::error_code &ec) override;
+
+    bool is_read_only() const override {
+        return inner_->is_read_only();
+    }
+
+    std::uint64_t block_count() const override {
+        return inner_->block_count();
+    }
+
+    std::uint32_t block_size() const override {
+        return inner_->block_size();
+    }
+
+    StorageBackend &inner() {
+        return *inner_;
+    }
+
+    /** 立即开始下一轮（跳过 pass_interval 等待） */
+    void scrub_now();
+
+    ScrubStats scrub_stats() const;
+    /** 已确认不一致、且之后未被重写的 chunk */
+    std::vector<Range> mismatched_ranges() const;
+
+    /** 当前使用的校验算法："xxh3" / "crc32c-hw" / "crc32c" */
+    static const char *checksum_name();
+    static std::uint64_t checksum(const void *data, std::size_t len);
+
+private:
+    enum class ChunkState : std::uint8_t {
+        Unknown = 0,
+        Valid = 1,
+        Bad = 2,
+    };
+
+    struct Suspect {
+        std::uint64_t chunk;
+        std::uint32_t generation;
+        std::uint64_t checksum;
+        std::chrono::steady_clock::time_point recheck_at;
+    };
+
+    void worker_loop();
+    /** 读取并处理一个 chunk，返回读取的字节数 */
+    std::size_t scrub_chunk(std::uint64_t chunk, std::vector<std::uint8_t> &buf);
+    /** 复查到期的可疑 chunk，代号未变且仍不一致才报告 */
+    void recheck_suspects(std::vector<std::uint8_t> &buf);
+    /** 读 chunk 并计算校验和；读取期间 chunk 被写入返回 false */
+    bool read_checksum(std::uint64_t chunk, std::vector<std::uint8_t> &buf, std::uint32_t &generation,
+                       std::uint64_t &sum, std::size_t &bytes);
+    /** 前台 I/O 活跃时等待，返回 false 表示要求退出 */
+    bool wait_foreground_idle(std::unique_lock<std::mutex> &lock);
+
+    /** 前台修改了 [lba, lba + count)：chunk 代号加一，必要时先把 sidecar 标记为未同步 */
+    void touch(std::uint64_t lba, std::uint64_t count);
+    void note_io() {
+        last_io_ns_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+    void mark_sidecar_unclean();
+    bool load_sidecar();
+    void save_sidecar();
+
+    std::uint64_t chunk_blocks_of(std::uint64_t chunk) const;
+
+    std::unique_ptr<StorageBackend> inner_;
+    std::string sidecar_path_;
+    ScrubOptions options_;
+    std::uint64_t chunk_count_ = 0;
+
+    /** 前台写入时递增，后台据此判断 chunk 是否被改过 */
+    std::unique_ptr<std::atomic<std::uint32_t>[]> generations_;
+    std::atomic<std::int64_t> last_io_ns_{0};
+
+    /** 以下由后台线程独占（保存 sidecar 时持有 sidecar_mutex_） */
+    std::vector<std::uint64_t> checksums_;
+    std::vector<ChunkState> states_;
+    std::vector<std::uint32_t> seen_generations_; // 记录校验和时的代号
+    std::vector<Suspect> suspects_;
+
+    std::mutex sidecar_mutex_;
+    detail::native_fd sidecar_fd_ = detail::invalid_fd;
+    /** sidecar 文件头当前标记为已同步 */
+    std::atomic<bool> sidecar_clean_{false};
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    bool kick_ = false;
+    std::vector<Range> mismatched_;
+    std::thread worker_;
+
+    std::atomic<std::uint64_t> passes_{0};
+    std::atomic<std::uint64_t> bytes_read_{0};
+    std::atomic<std::uint64_t> verified_{0};
+    std::atomic<std::uint64_t> recorded_{0};
+    std::atomic<std::uint64_t> skipped_{0};
+    std::atomic<std::uint64_t> mismatches_{0};
+    std::atomic<std::uint64_t> paused_ms_{0};
+};
+
+} // namespace usbipdcpp
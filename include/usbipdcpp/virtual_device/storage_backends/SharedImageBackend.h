@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
+
+namespace usbipdcpp {
+
+/**
+ * @brief 进程内共享的只读镜像映射
+ *
+ * 文件以只读方式打开并整体映射（PROT_READ / FILE_MAP_READ），之后不再修改任何状态，
+ * 多个线程可以不加锁地同时读映射区或 sendfile。只能经 SharedImageRegistry 创建。
+ */
+class USBIPDCPP_API SharedImage {
+public:
+    ~SharedImage();
+
+    SharedImage(const SharedImage &) = delete;
+    SharedImage &operator=(const SharedImage &) = delete;
+
+    [[nodiscard]] const std::uint8_t *data() const {
+        return static_cast<const std::uint8_t *>(mapped_data_);
+    }
+
+    [[nodiscard]] std::uint64_t size() const {
+        return mapped_size_;
+    }
+
+    /** 规范化后的绝对路径，即注册表的键 */
+    [[nodiscard]] const std::string &path() const {
+        return path_;
+    }
+
+    /**
+     * 从文件偏移 offset 起把 length 字节零拷贝发到 socket（Linux / macOS sendfile，显式偏移，
+     * 不动共享的文件位置）。约定同 StorageBackend::send_direct
+     */
+    bool send_file(std::uint64_t offset, std::size_t length, intptr_t sock_fd, std::error_code &ec) const;
+
+private:
+    friend class SharedImageRegistry;
+    explicit SharedImage(std::string path);
+
+    [[nodiscard]] bool is_valid() const {
+        return mapped_data_ != nullptr;
+    }
+
+    std::string path_;
+    void *mapped_data_ = nullptr;
+    std::uint64_t mapped_size_ = 0;
+#ifdef _WIN32
+    void *file_handle_ = nullptr;
+    void *mapping_handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+/**
+ * @brief 进程级只读镜像注册表：同一文件只打开、映射一次
+ *
+ * 向多台机器导出同一个安装 ISO 时，每个会话的后端都从这里取同一个 SharedImage，
+ * 整个进程只有一份映射和一份页表，页缓存自然也只有一份。
+ * 注册表只持有 weak_ptr，最后一个使用者释放后映射随之解除。
+ */
+class USBIPDCPP_API SharedImageRegistry {
+public:
+    static SharedImageRegistry &instance();
+
+    /** 打开或复用 path 对应的映射，路径按 weakly_canonical 归一；失败返回 nullptr */
+    std::shared_ptr<const SharedImage> open(const std::string &path);
+
+    /** 当前仍被使用的镜像数 */
+    std::size_t open_images();
+
+private:
+    SharedImageRegistry() = default;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::weak_ptr<const SharedImage>> images_;
+};
+
+/**
+ * @brief 基于 SharedImage 的只读后端，默认 2048 字节扇区（光盘）
+ *
+ * 每个会话一个实例，全部指向同一个 SharedImage。读路径无锁：read 直接从映射区 memcpy，
+ * READ 命令经 get_direct_buffer 走 sendfile。is_read_only() 为 true，handler 据此
+ * 拒绝所有写命令，不会写到只读映射上。
+ */
+class USBIPDCPP_API SharedImageBackend : public StorageBackend {
+public:
+    static constexpr std::uint32_t CD_SECTOR_SIZE = 2048;
+
+    explicit SharedImageBackend(std::shared_ptr<const SharedImage> image, std::uint32_t block_size = CD_SECTOR_SIZE);
+    /** 经 SharedImageRegistry::instance() 打开 path */
+    explicit SharedImageBackend(const std::string &path, std::uint32_t block_size = CD_SECTOR_SIZE);
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override;
+    /** 只读，始终返回 0 */
+    std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) override;
+    /** madvise(MADV_WILLNEED)：只发起异步预读，不阻塞调用者 */
+    void prefetch(std::uint64_t lba, std::uint64_t count) override;
+    void *get_direct_buffer(std::uint64_t lba) override;
+    using StorageBackend::send_direct;
+    bool send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                     std::error_code &ec) override;
+
+    bool is_read_only() const override {
+        return true;
+    }
+
+    std::uint64_t block_count() const override {
+        return block_count_;
+    }
+
+    std::uint32_t block_size() const override {
+        return block_size_;
+    }
+
+    bool is_valid() const {
+        return image_ != nullptr;
+    }
+
+    const std::shared_ptr<const SharedImage> &image() const {
+        return image_;
+    }
+
+private:
+    std::shared_ptr<const SharedImage> image_;
+    std::uint32_t block_size_;
+    std::uint64_t block_count_ = 0;
+};
+
+} // namespace usbipdcpp
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+
+namespace usbipdcpp {
+
+/** splice / vmsplice 中转用的一对管道 fd，无效时（非 Linux 或创建失败）均为 -1 */
+struct SplicePipe {
+    int read_fd = -1;
+    int write_fd = -1;
+    std::size_t capacity = 0; // 管道缓冲区字节数，一次 splice 最多搬这么多
+
+    [[nodiscard]] bool valid() const {
+        return read_fd >= 0;
+    }
+};
+
+/**
+ * @brief 零拷贝收发用的管道池，每个 StorageTransferOperator（即每个会话）一个
+ *
+ * sender 线程（READ 发送）和接收线程（WRITE 接收）各租各的管道，互不串数据；
+ * 管道用完归还复用，不必每次传输都 pipe() / close()。
+ * 租用时按本次传输长度用 F_SETPIPE_SZ 扩容（上限 max_pipe_size，且受
+ * /proc/sys/fs/pipe-max-size 限制，超限逐级减半），整个 URB 通常一次 splice 搬完。
+ * 出错时管道里可能残留半截数据，租约 discard() 后关闭而不是归还。
+ * 非 Linux 平台 acquire 返回无效管道。
+ */
+class USBIPDCPP_API SplicePipePool {
+public:
+    static constexpr std::size_t DEFAULT_MAX_PIPE_SIZE = 1024 * 1024;
+
+    /** RAII 租约：析构时归还管道（discard 过则关闭） */
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease &&other) noexcept;
+        Lease &operator=(Lease &&other) noexcept;
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        ~Lease();
+
+        [[nodiscard]] const SplicePipe &pipe() const {
+            return pipe_;
+        }
+
+        /** 管道状态未知（出错时可能有残留数据），归还时直接关闭 */
+        void discard() {
+            discard_ = true;
+        }
+
+    private:
+        friend class SplicePipePool;
+        Lease(SplicePipePool *pool, SplicePipe pipe) : pool_(pool), pipe_(pipe) {
+        }
+
+        SplicePipePool *pool_ = nullptr;
+        SplicePipe pipe_;
+        bool discard_ = false;
+    };
+
+    explicit SplicePipePool(std::size_t max_pipe_size = DEFAULT_MAX_PIPE_SIZE);
+    ~SplicePipePool();
+
+    SplicePipePool(const SplicePipePool &) = delete;
+    SplicePipePool &operator=(const SplicePipePool &) = delete;
+
+    /** 租一个管道，容量尽量扩到 want 字节；不支持或创建失败时 pipe().valid() 为 false */
+    Lease acquire(std::size_t want);
+
+    /** 累计创建的管道数（复用正常时等于并发使用的线程数） */
+    [[nodiscard]] std::uint64_t pipes_created() const {
+        return created_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::size_t max_pipe_size() const {
+        return max_pipe_size_;
+    }
+
+private:
+    void release(SplicePipe pipe, bool discard);
+    /** 扩容到不小于 want（取 2 的幂，不超过上限），失败保持原容量 */
+    void grow(SplicePipe &pipe, std::size_t want) const;
+
+    std::size_t max_pipe_size_;
+    std::mutex mutex_;
+    std::vector<SplicePipe> free_;
+    std::atomic<std::uint64_t> created_{0};
+    bool unsupported_ = false; // pipe() 失败过（如 fd 耗尽），此后不再尝试
+};
+
+namespace detail {
+/** 等待非阻塞 fd 可读 / 可写（EAGAIN 后调用），出错返回 false */
+bool wait_fd_ready(int fd, bool writable);
+} // namespace detail
+
+} // namespace usbipdcpp
@@ -1,11 +1,62 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <system_error>
 #include <vector>
 
 namespace usbipdcpp {
 
+class SplicePipePool;
+
+/** 一段连续内存，同 POSIX iovec */
+struct StorageIoVec {
+    void *base;
+    std::size_t length;
+};
+
+/**
+ * @brief 后端借出的自有内存段（解压缓存、NBD 请求缓冲、io_uring 注册缓冲等）
+ *
+ * segments 按顺序覆盖请求的 LBA 范围；keepalive 持有这些内存的所有权，
+ * 只要本对象（或其 keepalive 的拷贝）还在，段指针就保持有效。
+ * 读借出的段只读，调用方不得写入。
+ */
+struct StorageSegments {
+    std::vector<StorageIoVec> segments;
+    std::shared_ptr<void> keepalive;
+
+    [[nodiscard]] std::size_t total_length() const {
+        std::size_t total = 0;
+        for (auto &seg: segments)
+            total += seg.length;
+        return total;
+    }
+
+    /** 取 [offset, offset + length) 对应的子段，追加到 out */
+    void slice(std::size_t offset, std::size_t length, std::vector<StorageIoVec> &out) const {
+        for (auto &seg: segments) {
+            if (length == 0)
+                break;
+            if (offset >= seg.length) {
+                offset -= seg.length;
+                continue;
+            }
+            auto n = std::min(seg.length - offset, length);
+            out.push_back({static_cast<std::uint8_t *>(seg.base) + offset, n});
+            offset = 0;
+            length -= n;
+        }
+    }
+
+    void clear() {
+        segments.clear();
+        keepalive.reset();
+    }
+};
+
 /**
  * @brief 块存储后端抽象基类。
  *
@@ -21,32 +72,174 @@ public:
     /** @return 实际写入的字节数 */
     virtual std::size_t write(std::uint64_t lba, std::uint16_t count, const void *data) = 0;
 
+    /**
+     * 分散读：[lba, lba + count) 按顺序填入 iov 各段，段长之和须为 count 块。
+     * 默认实现对每段内的整块直接调用 read()，只有跨段的块经一个块大小的中转缓冲
+     * @return 实际读取的字节数
+     */
+    virtual std::size_t readv(std::uint64_t lba, std::uint16_t count, const StorageIoVec *iov, std::size_t iovcnt) {
+        return scatter_blocks(lba, count, iov, iovcnt, [this](std::uint64_t l, std::uint16_t c, void *buf) {
+            return read(l, c, buf) == static_cast<std::size_t>(c) * block_size();
+        }, true);
+    }
+
+    /** 聚集写：iov 各段按顺序拼成 [lba, lba + count) 的数据，默认实现同 readv */
+    virtual std::size_t writev(std::uint64_t lba, std::uint16_t count, const StorageIoVec *iov, std::size_t iovcnt) {
+        return scatter_blocks(lba, count, iov, iovcnt, [this](std::uint64_t l, std::uint16_t c, void *buf) {
+            return write(l, c, buf) == static_cast<std::size_t>(c) * block_size();
+        }, false);
+    }
+
+    /**
+     * 借出 [lba, lba + count) 的数据所在的后端内存，调用方直接从这些段发送，
+     * 省掉拷贝到 staging 的一次。数据不在内存中（或与未借出的数据交错）时返回 false，
+     * 调用方回退 read()（可选，默认不支持）
+     */
+    virtual bool read_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) {
+        return false;
+    }
+
+    /**
+     * 借出可直接写入的后端内存，调用方把 [lba, lba + count) 的数据收进这些段后
+     * 调用 commit_segments 提交；不支持时返回 false，调用方回退 write()（可选）
+     */
+    virtual bool write_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) {
+        return false;
+    }
+
+    /** 提交 write_segments 借出且已填满的段，默认按 writev 写入 */
+    virtual bool commit_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &segments) {
+        return writev(lba, count, segments.segments.data(), segments.segments.size()) ==
+               static_cast<std::size_t>(count) * block_size();
+    }
+
     // 释放 LBA 范围的物理存储（可选，默认空实现）
     virtual void punch_hole(std::uint64_t lba, std::uint64_t count) {
     }
 
+    // 预读提示：顺序读检测到流后调用，后端应异步把该范围读入页缓存 / 自身缓存，
+    // 不得阻塞调用线程（可选，默认空实现）
+    virtual void prefetch(std::uint64_t lba, std::uint64_t count) {
+    }
+
+    // 把 [lba, lba + count) 范围内已写入的数据同步到持久存储，SYNCHRONIZE CACHE 调用。
+    // 返回 false 表示同步失败（可选，默认无写缓存直接成功）
+    virtual bool flush(std::uint64_t lba, std::uint64_t count) {
+        return true;
+    }
+
+    // 零拷贝 WRITE（get_direct_buffer / recv_direct）绕过了 write()，
+    // 数据收齐后由调用者通知后端，以便按持久化策略记录脏范围或同步（可选，默认空实现）
+    virtual bool commit_direct_write(std::uint64_t lba, std::uint64_t count) {
+        return true;
+    }
+
     // 返回 LBA 处映射内存的直读指针（nullptr 表示无 mmap，需走 staging_data_ 中转）
     virtual void *get_direct_buffer(std::uint64_t lba) {
         return nullptr;
     }
 
-    // 零拷贝发送（sendfile / TransmitFile），默认 false → 回退 asio::write
+    // 零拷贝发送（sendfile / TransmitFile），offset 为 lba 内的字节偏移，不要求块对齐。
+    // 返回 false 且 ec 为空表示一个字节都没发，调用者回退 asio::write；
+    // ec 非空表示已发出部分数据、流已损坏，不得回退。默认 false
     virtual bool send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
                              std::error_code &ec) {
         return false;
     }
 
-    // 零拷贝接收（splice sock→pipe→file），默认 false → 回退 asio::read
+    // 同上，pipes 为会话的中转管道池，需要管道的后端（vmsplice / splice）从中租用，出错时丢弃租约。
+    // StorageTransferOperator 调用这个版本；默认不用管道，转调上面的版本
+    virtual bool send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                             SplicePipePool &pipes, std::error_code &ec) {
+        return send_direct(lba, offset, length, sock_fd, ec);
+    }
+
+    // 零拷贝接收（splice sock→pipe→file），约定同 send_direct：未读 socket 时返回 false 且 ec 为空，
+    // 调用者回退 asio::read。默认 false
     virtual bool recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
                              std::error_code &ec) {
         return false;
     }
 
+    // 带管道池的版本，约定同 send_direct 的管道池版本；默认转调上面的版本
+    virtual bool recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                             SplicePipePool &pipes, std::error_code &ec) {
+        return recv_direct(lba, offset, length, sock_fd, ec);
+    }
+
+    // 后端本身不可写（只读映射的共享镜像等），handler 据此把 LUN 当作只读，
+    // 不再为 WRITE 取映射区指针（可选，默认可写）
+    [[nodiscard]] virtual bool is_read_only() const {
+        return false;
+    }
+
     [[nodiscard]] virtual std::uint64_t block_count() const = 0;
 
     [[nodiscard]] virtual std::uint32_t block_size() const {
         return 512;
     }
+
+protected:
+    /**
+     * readv / writev 默认实现：按块遍历 iov，段内连续的整块合并成一次 io(lba, count, ptr)，
+     * 跨段的单个块经中转缓冲（read 时读出后分散，write 时先聚集再写）
+     */
+    template<typename Io>
+    std::size_t scatter_blocks(std::uint64_t lba, std::uint16_t count, const StorageIoVec *iov, std::size_t iovcnt,
+                               Io &&io, bool is_read) {
+        const auto bs = block_size();
+        std::vector<std::uint8_t> bounce;
+        std::size_t seg = 0;
+        std::size_t seg_off = 0;
+        std::uint16_t done = 0;
+        while (done < count) {
+            while (seg < iovcnt && seg_off == iov[seg].length) {
+                ++seg;
+                seg_off = 0;
+            }
+            if (seg == iovcnt)
+                return 0; // 段长之和不足 count 块
+            auto *base = static_cast<std::uint8_t *>(iov[seg].base);
+            auto whole = (iov[seg].length - seg_off) / bs;
+            if (whole > 0) {
+                auto n = static_cast<std::uint16_t>(std::min<std::size_t>(whole, count - done));
+                if (!io(lba + done, n, base + seg_off))
+                    return 0;
+                seg_off += static_cast<std::size_t>(n) * bs;
+                done += n;
+                continue;
+            }
+            // 块跨段：中转一个块
+            bounce.resize(bs);
+            if (is_read && !io(lba + done, 1, bounce.data()))
+                return 0;
+            std::size_t copied = 0;
+            auto s = seg;
+            auto off = seg_off;
+            while (copied < bs && s < iovcnt) {
+                auto n = std::min<std::size_t>(iov[s].length - off, bs - copied);
+                auto *p = static_cast<std::uint8_t *>(iov[s].base) + off;
+                if (is_read)
+                    std::memcpy(p, bounce.data() + copied, n);
+                else
+                    std::memcpy(bounce.data() + copied, p, n);
+                copied += n;
+                off += n;
+                if (off == iov[s].length) {
+                    ++s;
+                    off = 0;
+                }
+            }
+            if (copied < bs)
+                return 0;
+            if (!is_read && !io(lba + done, 1, bounce.data()))
+                return 0;
+            seg = s;
+            seg_off = off;
+            ++done;
+        }
+        return static_cast<std::size_t>(count) * bs;
+    }
 };
 
 } // namespace usbipdcpp
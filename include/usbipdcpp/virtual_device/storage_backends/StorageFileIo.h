@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace usbipdcpp {
+namespace detail {
+
+// ---- 存储后端共用的平台文件 I/O（库内部使用）：按偏移读写，多线程并发读无需共享文件指针 ----
+
+#ifdef _WIN32
+using native_fd = void *;
+inline native_fd const invalid_fd = reinterpret_cast<void *>(-1); // INVALID_HANDLE_VALUE
+#else
+using native_fd = int;
+inline constexpr native_fd invalid_fd = -1;
+#endif
+
+/** writable 时读写打开，create 时不存在则创建 */
+native_fd open_file(const std::string &path, bool writable, bool create);
+void close_file(native_fd fd);
+/** 失败返回 0 */
+std::uint64_t file_size(native_fd fd);
+/** 截断或扩展，扩展出来的部分是稀疏空洞 */
+bool resize_file(native_fd fd, std::uint64_t size);
+/** 读满 len 字节，遇到 EOF 或错误返回 false */
+bool pread_all(native_fd fd, void *buf, std::size_t len, std::uint64_t off);
+bool pwrite_all(native_fd fd, const void *buf, std::size_t len, std::uint64_t off);
+/** 数据落盘（fdatasync / FlushFileBuffers） */
+bool sync_file(native_fd fd);
+/** 将区间清零，中间的部分交给文件系统释放 */
+bool zero_range(native_fd fd, std::uint64_t off, std::uint64_t len);
+
+} // namespace detail
+} // namespace usbipdcpp
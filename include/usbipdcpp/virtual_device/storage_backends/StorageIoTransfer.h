@@ -2,20 +2,24 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "usbipdcpp/virtual_device/storage_backends/StorageBackend.h"
+
 namespace usbipdcpp {
 
 /**
  * @brief MSC 存储 I/O 专用 Transfer，配合 StorageTransferOperator 使用
  *
  * 不分配内部 GenericTransfer::data，所有 I/O 通过本结构体的成员直达目标地址。
- * 支持两种数据路径：零拷贝（mmap 文件内存）和回退（staging_data_ / fallback_data）。
+ * 支持三种数据路径：零拷贝（mmap 文件内存）、后端借出的内存段（segments）和回退（staging_data_ / fallback_data）。
  *
  * === IN 方向（设备 → host，READ / CSW） ===
  * handle_bulk_transfer 中设置 external_buf 和 actual_length，sender 线程通过
  * send_transfer_data 发送。优先走 sendfile / TransmitFile（direct_io），回退 asio::write。
  * - READ mmap：external_buf 指向 RawImageBackend 映射的文件内存，direct_io = true
+ * - READ 借出段：segments 为 read_segments 借出内存的切片，一次 gather write 发出
  * - READ 回退：external_buf 指向 staging_data_ 内部
  * - CSW：external_buf 指向本结构体 fallback_data，direct_io = false
  *
@@ -25,6 +29,7 @@ namespace usbipdcpp {
  * 随后 on_out_data_received 解析 CBW 或累积写数据。
  * - CBW：external_buf 为 nullptr，走 fallback_data，direct_io = false
  * - WRITE mmap：external_buf 指向 mmap 文件内存，direct_io = true
+ * - WRITE 借出段：segments 为 write_segments 借出内存的切片，socket 直接 scatter read 进去
  * - WRITE 回退 / UNMAP：external_buf 指向 staging_data_ 尾部预留空间
  */
 struct StorageIoTransfer {
@@ -81,6 +86,23 @@ struct StorageIoTransfer {
      */
     bool direct_io = false;
 
+    /**
+     * @brief direct_io 时执行 send_direct / recv_direct 的后端
+     *
+     * 多 LUN 时每个命令的目标后端不同，由设置 direct_io 的一方一并记录，
+     * sender 线程发送时不再回头查询 handler 的当前 LUN。
+     */
+    StorageBackend *backend = nullptr;
+
+    /**
+     * @brief 后端借出的内存段（本 URB 对应的切片）
+     *
+     * 非空时 send_transfer_data / recv_transfer_data 直接对这些段做 gather / scatter I/O，
+     * 不经 external_buf。keepalive 保证 sender 线程发送期间段内存不被后端回收。
+     */
+    std::vector<StorageIoVec> segments;
+    std::shared_ptr<void> keepalive;
+
     // ===== 本结构体自用缓冲区 =====
 
     /**
@@ -99,6 +121,9 @@ struct StorageIoTransfer {
         file_lba = 0;
         file_offset = 0;
         direct_io = false;
+        backend = nullptr;
+        segments.clear();
+        keepalive.reset();
         fallback_data.clear();
     }
 
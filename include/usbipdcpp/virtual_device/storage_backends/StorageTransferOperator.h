@@ -1,18 +1,40 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+
 #include "usbipdcpp/DeviceHandler/TransferOperator.h"
 #include "usbipdcpp/utils/ObjectPool.h"
+#include "usbipdcpp/virtual_device/storage_backends/SplicePipePool.h"
 #include "usbipdcpp/virtual_device/storage_backends/StorageIoTransfer.h"
 
 namespace usbipdcpp {
 
 class MscBulkOnlyHandler;
 
+/** 零拷贝路径统计：direct_io 传输中走 send_direct / recv_direct 成功的，与后端不支持而回退拷贝的 */
+struct ZeroCopyStats {
+    std::uint64_t direct_sends = 0;
+    std::uint64_t direct_send_bytes = 0;
+    std::uint64_t fallback_sends = 0;
+    std::uint64_t fallback_send_bytes = 0;
+    std::uint64_t direct_recvs = 0;
+    std::uint64_t direct_recv_bytes = 0;
+    std::uint64_t fallback_recvs = 0;
+    std::uint64_t fallback_recv_bytes = 0;
+    /** 零拷贝传输中途出错（连接随之断开） */
+    std::uint64_t errors = 0;
+    std::uint64_t pipes_created = 0;
+};
+
 /**
  * @brief MSC 零拷贝传输操作器
  *
- * IN：send_transfer_data 从 external_buf（mmap）直接发送
- * OUT：recv_transfer_data 直读入 CBW/staging 并解析
+ * IN：send_transfer_data 从 external_buf（mmap）或后端借出的内存段直接发送
+ * OUT：recv_transfer_data 直读入 CBW/staging/借出段并解析
+ *
+ * send_direct / recv_direct 需要中转管道的后端从本对象的 SplicePipePool 租用：sender 线程与
+ * 接收线程各租一个，传输之间复用。
  */
 class StorageTransferOperator : public TransferOperator {
 public:
@@ -32,8 +54,23 @@ public:
     void recv_transfer_data(void *handle, asio::ip::tcp::socket &sock, std::size_t length,
                             std::error_code &ec) override;
 
+    ZeroCopyStats zero_copy_stats() const;
+
 private:
+    struct Counter {
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> bytes{0};
+
+        void add(std::size_t n) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(n, std::memory_order_relaxed);
+        }
+    };
+
     MscBulkOnlyHandler *handler_;
+    SplicePipePool pipes_;
+    Counter direct_send_, fallback_send_, direct_recv_, fallback_recv_;
+    std::atomic<std::uint64_t> errors_{0};
     /// BOT 最多 2-3 个传输在途，8 个槽足够
     ObjectPool<StorageIoTransfer, 8> pool_;
 };
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace usbipdcpp {
+
+/** 写入持久化策略 */
+enum class WriteDurability {
+    /** 每次写入同步落盘后才返回（pwrite + fdatasync），SYNCHRONIZE CACHE 无需再做事 */
+    WriteThrough,
+    /** 写入只进页缓存并记录脏范围，后台线程定期批量刷盘；
+     *  SYNCHRONIZE CACHE 只同步它覆盖的脏范围 */
+    WriteBack,
+    /** 不跟踪也不刷盘，由 OS 决定何时写回，SYNCHRONIZE CACHE 直接成功。
+     *  进程崩溃不丢数据，掉电可能丢失任意数量的写入 */
+    Unsafe,
+};
+
+struct DurabilityConfig {
+    WriteDurability mode = WriteDurability::WriteBack;
+    /** WriteBack 后台刷盘周期 */
+    std::uint32_t flush_interval_ms = 1000;
+    /** WriteBack 脏数据超过此字节数时提前唤醒后台刷盘，避免一次积攒过多 */
+    std::uint64_t dirty_limit_bytes = 64ull * 1024 * 1024;
+};
+
+/**
+ * @brief 脏块范围跟踪（WriteBack 用，线程安全）
+ *
+ * 以 LBA 区间记录尚未落盘的写入，相邻/重叠区间合并，刷盘时按区间批量同步。
+ * 每次 mark 给区间分配递增的代号：刷盘前 collect 取快照，同步完成后 clear
+ * 只清除代号不大于快照的部分，刷盘期间被再次写脏的区间会保留下来等下一轮。
+ */
+class DirtyRangeTracker {
+public:
+    struct Range {
+        std::uint64_t lba;
+        std::uint64_t count;
+        std::uint64_t generation;
+    };
+
+    void mark(std::uint64_t lba, std::uint64_t count) {
+        if (count == 0)
+            return;
+        std::lock_guard lock(mutex_);
+        auto begin = lba;
+        auto end = lba + count;
+        auto it = ranges_.upper_bound(begin);
+        if (it != ranges_.begin() && std::prev(it)->second.end >= begin) {
+            --it;
+        }
+        // 吸收所有重叠或相邻的区间
+        while (it != ranges_.end() && it->first <= end) {
+            begin = std::min(begin, it->first);
+            end = std::max(end, it->second.end);
+            dirty_blocks_ -= it->second.end - it->first;
+            it = ranges_.erase(it);
+        }
+        ranges_.emplace(begin, Entry{end, ++generation_});
+        dirty_blocks_ += end - begin;
+    }
+
+    /** 取与 [lba, lba + count) 相交的脏区间快照（裁剪到该范围内） */
+    std::vector<Range> collect(std::uint64_t lba = 0, std::uint64_t count = UINT64_MAX) const {
+        std::lock_guard lock(mutex_);
+        auto end = count > UINT64_MAX - lba ? UINT64_MAX : lba + count;
+        std::vector<Range> out;
+        auto it = ranges_.upper_bound(lba);
+        if (it != ranges_.begin() && std::prev(it)->second.end > lba) {
+            --it;
+        }
+        for (; it != ranges_.end() && it->first < end; ++it) {
+            auto b = std::max(it->first, lba);
+            auto e = std::min(it->second.end, end);
+            out.push_back({b, e - b, it->second.generation});
+        }
+        return out;
+    }
+
+    /** 同步完成后清除快照中的区间，之后又被写脏（代号更新）的部分保留 */
+    void clear(const std::vector<Range> &synced) {
+        std::lock_guard lock(mutex_);
+        for (const auto &r: synced) {
+            auto rb = r.lba;
+            auto re = r.lba + r.count;
+            auto it = ranges_.upper_bound(rb);
+            if (it != ranges_.begin() && std::prev(it)->second.end > rb) {
+                --it;
+            }
+            while (it != ranges_.end() && it->first < re) {
+                auto b = it->first;
+                auto entry = it->second;
+                if (entry.generation > r.generation) {
+                    ++it;
+                    continue;
+                }
+                it = ranges_.erase(it);
+                dirty_blocks_ -= entry.end - b;
+                // 快照区间之外的部分放回
+                if (b < rb) {
+                    ranges_.emplace(b, Entry{rb, entry.generation});
+                    dirty_blocks_ += rb - b;
+                }
+                if (entry.end > re) {
+                    it = ranges_.emplace(re, Entry{entry.end, entry.generation}).first;
+                    dirty_blocks_ += entry.end - re;
+                    ++it;
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] std::uint64_t dirty_blocks() const {
+        std::lock_guard lock(mutex_);
+        return dirty_blocks_;
+    }
+
+    [[nodiscard]] bool empty() const {
+        std::lock_guard lock(mutex_);
+        return ranges_.empty();
+    }
+
+private:
+    struct Entry {
+        std::uint64_t end; // 区间末尾 LBA（不含）
+        std::uint64_t generation; // 最近一次写入的代号
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::uint64_t, Entry> ranges_; // 起始 LBA → 区间，互不重叠且不相邻
+    std::uint64_t dirty_blocks_ = 0;
+    std::uint64_t generation_ = 0;
+};
+
+} // namespace usbipdcpp
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoSource.h"
+
+namespace usbipdcpp {
+
+/// 生产线程还没交出新帧时 get_frame 的做法
+enum class FrameUnderrunPolicy {
+    Repeat, // 重发上一帧，主机看到的帧率不变
+    Skip, // 交出空帧，handler 这次不发帧、下个 URB 再取
+};
+
+struct AsyncVideoSourceOptions {
+    FrameUnderrunPolicy underrun = FrameUnderrunPolicy::Repeat;
+    /// 生产线程按当前帧间隔取帧；内层自己会阻塞等帧（摄像头、按时间戳限速的解码器）时关掉
+    bool pace = true;
+    /// 超过这么久没有 get_frame（停流）生产线程就挂起并放掉缓冲，下次 get_frame 再唤醒；0 = 一直运行
+    std::chrono::milliseconds idle_timeout{1000};
+};
+
+/**
+ * @brief 把视频源放到独立线程上运行的装饰器
+ *
+ * 内层的 get_frame 在生产线程上按帧间隔调用，UVC 流路径上的 get_frame 不再等内层：
+ * 三缓冲——生产线程正在填的一帧、最新的完整帧、交给 handler 的上一帧——
+ * get_frame 只在锁内交换一次指针，总是拿到最新的完整帧。
+ * 内层比 handler 快时没被取走的旧帧被新帧顶掉（dropped），慢时按 FrameUnderrunPolicy 重发或跳过。
+ *
+ * 内层交出的帧带 owner 时直接转交；不带 owner 的帧在生产线程上拷进池化缓冲
+ * （data 只在内层下次 get_frame 前有效）。
+ * 生产线程在第一次 get_frame 时启动；set_format 先停下生产线程（等内层当前这次 get_frame 返回）再切换。
+ */
+class USBIPDCPP_API AsyncVideoSource : public VideoSource {
+public:
+    explicit AsyncVideoSource(std::unique_ptr<VideoSource> inner, AsyncVideoSourceOptions options = {});
+    ~AsyncVideoSource() override;
+
+    AsyncVideoSource(const AsyncVideoSource &) = delete;
+    AsyncVideoSource &operator=(const AsyncVideoSource &) = delete;
+
+    std::vector<VideoFormatInfo> supported_formats() const override;
+    VideoFormatInfo current_format() const override;
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                    std::uint32_t frame_interval) override;
+    /// 不阻塞：有新帧交新帧，否则按策略重发上一帧或交出空帧（size == 0）
+    bool get_frame(VideoFrame &frame) override;
+    std::size_t max_frame_size() const override;
+    std::uint32_t frame_interval() const override;
+
+    VideoSource &inner() {
+        return *inner_;
+    }
+
+    struct Stats {
+        std::uint64_t produced; // 内层交出的帧数
+        std::uint64_t delivered; // 作为新帧交给 handler 的帧数
+        std::uint64_t dropped; // 没被取走就被更新的帧顶掉
+        std::uint64_t repeated; // 没有新帧时重发上一帧的次数
+        std::uint64_t skipped; // 没有新帧时交出空帧的次数（含首帧就绪前）
+        std::uint64_t source_errors; // 内层 get_frame 失败次数
+    };
+    Stats stats() const;
+
+private:
+    void start_locked();
+    void stop_producer();
+    void producer_loop();
+    /// 取内层一帧，必要时拷进池化缓冲（生产线程，不持锁）
+    bool capture(VideoFrame &frame);
+
+    std::unique_ptr<VideoSource> inner_;
+    AsyncVideoSourceOptions options_;
+    std::shared_ptr<VideoFramePool> pool_; // 拷贝不带 owner 的帧
+
+    // 下面三项只在生产线程停下时改
+    VideoFormatInfo format_;
+    std::size_t max_frame_size_;
+    std::uint32_t frame_interval_; // 100ns 单位
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_; // 要求退出、或挂起的生产线程被 get_frame 唤醒
+    std::thread producer_;
+    bool stop_ = false;
+    bool parked_ = false;
+    std::chrono::steady_clock::time_point last_request_;
+    VideoFrame latest_{}; // 最新的完整帧
+    bool fresh_ = false; // latest_ 还没交出过
+    VideoFrame front_{}; // 上一次交给 handler 的帧，Repeat 时重发
+
+    std::uint64_t produced_ = 0;
+    std::uint64_t delivered_ = 0;
+    std::uint64_t dropped_ = 0;
+    std::uint64_t repeated_ = 0;
+    std::uint64_t skipped_ = 0;
+    std::uint64_t source_errors_ = 0;
+};
+
+} // namespace usbipdcpp
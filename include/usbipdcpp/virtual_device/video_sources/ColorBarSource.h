@@ -1,14 +1,18 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
 #include "usbipdcpp/virtual_device/video_sources/VideoSource.h"
 
 namespace usbipdcpp {
 
-/// SMPTE 彩条测试图生成器（YUY2 未压缩格式）
+/// SMPTE 彩条测试图生成器（YUY2 未压缩格式）。
+/// 画面静止：每种格式只生成一次，各帧共享同一块只读缓冲（VideoFrame::owner），handler 不拷贝
 class USBIPDCPP_API ColorBarSource : public VideoSource {
 public:
     /// @param width  帧宽度（默认 640）
@@ -16,6 +20,11 @@ public:
     /// @param fps    帧率（默认 30）
     ColorBarSource(std::uint16_t width = 640, std::uint16_t height = 480, std::uint8_t fps = 30);
 
+    /// 多分辨率：每个 (宽, 高) 对应一个 Frame 描述符，初始为第一个，主机 COMMIT 时切换
+    /// @param sizes 支持的分辨率（不能为空）
+    /// @param fps   最高帧率
+    explicit ColorBarSource(std::vector<std::pair<std::uint16_t, std::uint16_t>> sizes, std::uint8_t fps = 30);
+
     std::vector<VideoFormatInfo> supported_formats() const override;
     VideoFormatInfo current_format() const override;
     bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
@@ -27,10 +36,12 @@ public:
 private:
     void generate_color_bars();
 
+    std::vector<std::pair<std::uint16_t, std::uint16_t>> sizes_;
+    std::uint32_t min_interval_; // 100ns units，构造时的帧率，描述符声明的最短帧间隔
     std::uint16_t width_;
     std::uint16_t height_;
     std::uint32_t frame_interval_; // 100ns units
-    std::vector<std::uint8_t> buffer_;
+    std::shared_ptr<const VideoFrameBuffer> frame_;
 };
 
 } // namespace usbipdcpp
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/utils/ThreadPool.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoSource.h"
+
+namespace usbipdcpp {
+
+struct MjpegEncoderOptions {
+    /// JPEG 质量 1..100
+    int quality = 80;
+    /// 目标码率（kbit/s），0 = 固定质量；非 0 时每帧按上一帧大小在 [min_quality, max_quality] 内调整质量
+    std::uint32_t target_kbps = 0;
+    int min_quality = 20;
+    int max_quality = 95;
+    /// 编码线程数，0 = hardware_concurrency，1 = 只在流水线线程内编码
+    std::size_t threads = 0;
+    /// 每帧切成的水平条带数，0 = 与编码线程数相同；条带并行编码后用 RST 标记拼接成一张 JPEG
+    std::size_t slices = 0;
+    /// 交出第 N 帧后立即开始取、编码第 N+1 帧（多一帧延迟换整帧编码时间的吞吐）
+    bool pipeline = true;
+    /// 同时列出内层的原始格式，主机仍可选择不压缩传输
+    bool keep_uncompressed = true;
+};
+
+/**
+ * @brief 把原始像素视频源压缩为 MJPEG 的装饰器
+ *
+ * 内层每个 YUY2 / NV12 / I420 分辨率对应一个 MJPEG 格式（列在最前面，成为默认格式），
+ * 主机 COMMIT 到 MJPEG 时内层切到对应的原始格式，取到的帧在这里编码；
+ * COMMIT 到其他格式则原样转发，不做任何处理。
+ *
+ * 编码：帧按 MCU 行切成若干条带，在 ThreadPool 上用 libjpeg 并行编码（YUY2 为 4:2:2，
+ * NV12 / I420 为 4:2:0，有限范围 BT.601 先扩展到 JFIF 全范围），restart interval 取一个条带的
+ * MCU 数，各条带的熵编码段之间插入 RST 标记拼接为一张标准 baseline JPEG。
+ * 输出放在池化缓冲里交给 handler，不再拷贝。
+ *
+ * 编译时没有找到 libjpeg 时 available() 为 false，不列出 MJPEG 格式，全部转发。
+ */
+class USBIPDCPP_API MjpegEncoderSource : public VideoSource {
+public:
+    explicit MjpegEncoderSource(std::unique_ptr<VideoSource> inner, MjpegEncoderOptions options = {});
+    ~MjpegEncoderSource() override;
+
+    MjpegEncoderSource(const MjpegEncoderSource &) = delete;
+    MjpegEncoderSource &operator=(const MjpegEncoderSource &) = delete;
+
+    std::vector<VideoFormatInfo> supported_formats() const override;
+    VideoFormatInfo current_format() const override;
+    /// 等在途的预编码结束并丢弃结果，再切换内层格式
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                    std::uint32_t frame_interval) override;
+    bool get_frame(VideoFrame &frame) override;
+    std::size_t max_frame_size() const override;
+    std::uint32_t frame_interval() const override;
+
+    VideoSource &inner() {
+        return *inner_;
+    }
+
+    /// 固定质量（清除 target_kbps）
+    void set_quality(int quality);
+    /// 目标码率，0 = 回到固定质量
+    void set_target_bitrate(std::uint32_t kbps);
+
+    /// 编译时是否链接了 libjpeg
+    static bool available();
+
+    struct EncodeStats {
+        // 均只统计已交给 handler 的帧，流水线里预编码的一帧不算
+        std::uint64_t frames; // 交出的 MJPEG 帧数
+        std::uint64_t input_bytes; // 内层原始帧字节数
+        std::uint64_t output_bytes; // JPEG 字节数
+        std::uint64_t encode_us; // 编码耗时累计（取到原始帧到拼接完成）
+        std::uint64_t latency_us; // 取到原始帧到交给 handler 的耗时累计
+        std::uint64_t max_latency_us;
+        int quality; // 当前质量
+        std::size_t slices; // 当前格式每帧条带数
+    };
+    EncodeStats encode_stats() const;
+
+private:
+    /// 一个条带的 libjpeg 编码器与工作缓冲，跨帧复用
+    struct SliceEncoder;
+
+    /// 一帧编码结果
+    struct Encoded {
+        bool ok = false;
+        std::shared_ptr<VideoFrameBuffer> buffer;
+        std::chrono::steady_clock::time_point captured_at;
+        std::size_t input_size = 0;
+        std::uint64_t encode_us = 0;
+    };
+
+    /// 内层一种原始格式对应的 MJPEG 格式
+    struct EncodedFormat {
+        VideoFormatInfo mjpeg;
+        std::uint32_t raw_fourcc;
+    };
+
+    const EncodedFormat *find_encoded(std::uint16_t width, std::uint16_t height) const;
+    /// 按当前原始格式重建条带划分与各条带编码器（调用方持有 mutex_，流水线空闲）
+    void configure_slices_locked(const EncodedFormat &format);
+    void pipeline_loop();
+    /// 取一帧原始帧并编码（流水线线程，不持锁）
+    Encoded produce();
+    /// 编码到 out；拼接后超过 out 容量时 too_large = true
+    bool encode(const VideoFrame &raw, int quality, VideoFrameBuffer &out, bool &too_large);
+    /// 等流水线空闲并丢弃已完成的预编码结果（调用方持有 mutex_）
+    void quiesce_locked(std::unique_lock<std::mutex> &lock);
+    void update_quality(std::size_t encoded_size);
+
+    std::unique_ptr<VideoSource> inner_;
+    MjpegEncoderOptions options_;
+    std::vector<EncodedFormat> encoded_formats_;
+    std::unique_ptr<ThreadPool> pool_; // threads == 1 时为空
+    std::shared_ptr<VideoFramePool> frame_pool_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable request_cv_; // 有新的编码请求或要求退出
+    std::condition_variable ready_cv_; // 一帧编码完成
+    const EncodedFormat *active_ = nullptr; // 当前 COMMIT 到的 MJPEG 格式，nullptr 为转发
+    std::vector<std::unique_ptr<SliceEncoder>> slices_;
+    std::uint32_t restart_interval_ = 0; // 一个条带的 MCU 数，单条带时为 0
+    int quality_;
+    bool requested_ = false;
+    bool in_flight_ = false;
+    bool ready_ = false;
+    bool stop_ = false;
+    Encoded result_;
+    std::thread pipeline_;
+
+    std::uint64_t frames_ = 0;
+    std::uint64_t input_bytes_ = 0;
+    std::uint64_t output_bytes_ = 0;
+    std::uint64_t encode_us_ = 0;
+    std::uint64_t latency_us_ = 0;
+    std::uint64_t max_latency_us_ = 0;
+};
+
+} // namespace usbipdcpp
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "usbipdcpp/Export.h"
+
+namespace usbipdcpp {
+
+/// 像素格式转换支持的格式（8 bit；YUV 为 BT.601 有限范围，与 ColorBarSource 一致）
+enum class PixelFormat : std::uint8_t {
+    RGB24, // R G B 打包
+    RGBA, // R G B A 打包
+    BGRA, // B G R A 打包（Windows / Cairo / Skia 常见的 32 位帧缓冲）
+    NV12, // Y 平面 + UV 交错平面（2x2 下采样）
+    I420, // Y / U / V 三平面（2x2 下采样）
+    YUY2, // Y0 U Y1 V 打包（UVC 未压缩格式）
+};
+
+/// 一帧图像的各平面（只读）：打包格式只用 data[0]；NV12 用 0（Y）、1（UV）；I420 用 0（Y）、1（U）、2（V）
+struct ImagePlanes {
+    std::array<const std::uint8_t *, 3> data{};
+    std::array<std::size_t, 3> stride{}; // 每行字节数
+};
+
+/// 一帧图像的各平面（可写），布局同 ImagePlanes
+struct MutableImagePlanes {
+    std::array<std::uint8_t *, 3> data{};
+    std::array<std::size_t, 3> stride{};
+
+    operator ImagePlanes() const {
+        return {{data[0], data[1], data[2]}, stride};
+    }
+};
+
+/// 转换内核使用的指令集档位
+enum class SimdLevel : std::uint8_t {
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON,
+};
+
+/// 紧密排列（无行填充）时一帧的字节数
+USBIPDCPP_API std::size_t pixel_image_size(PixelFormat format, int width, int height);
+
+/// 紧密排列的一块内存按格式切成各平面
+USBIPDCPP_API MutableImagePlanes pixel_image_planes(PixelFormat format, std::uint8_t *base, int width, int height);
+
+/**
+ * @brief 像素格式转换：src / dst 之一必须是 YUY2（两者都是 YUY2 时逐行拷贝）
+ *
+ * RGB → YUY2 的色度取水平相邻两像素的平均；YUY2 → NV12 / I420 的色度取上下两行的平均，
+ * 奇数高度的最后一行单独成行；NV12 / I420 → YUY2 每两行共用一行色度。
+ * 按 pixel_convert_simd_level() 选内核，各档输出逐字节一致。线程安全。
+ * @return width 为奇数 / 非正、尺寸非正或格式组合不支持时返回 false
+ */
+USBIPDCPP_API bool convert_pixels(PixelFormat src_format, const ImagePlanes &src, PixelFormat dst_format,
+                                  const MutableImagePlanes &dst, int width, int height);
+
+/// 当前 CPU 支持的最高档位：x86-64 为 SSE2 / AVX2，AArch64 为 NEON，其余平台为 Scalar
+USBIPDCPP_API SimdLevel detect_simd_level();
+
+/// convert_pixels 当前使用的档位（默认 detect_simd_level()）
+USBIPDCPP_API SimdLevel pixel_convert_simd_level();
+
+/// 限制 convert_pixels 使用的档位（测试 / 基准对比用）。CPU 不支持的档位退回支持的最高档，返回实际生效的档位
+USBIPDCPP_API SimdLevel set_pixel_convert_simd_level(SimdLevel level);
+
+USBIPDCPP_API const char *simd_level_name(SimdLevel level);
+
+} // namespace usbipdcpp
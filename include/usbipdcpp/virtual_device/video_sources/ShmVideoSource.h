@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoSource.h"
+
+namespace usbipdcpp {
+
+struct ShmVideoSourceOptions {
+    /// 空：memfd，把 fd() / event_fd() 交给生产者进程（fork 继承或 SCM_RIGHTS）；
+    /// 非空：POSIX 共享内存名（如 "/usbipdcpp-cam0"），生产者 shm_open 同名映射，拿不到 eventfd 时不通知也能工作
+    std::string name;
+    /// 槽位数：handler 正在发的帧、sender 队列里的上一帧、最新帧各占一个，再留一个给生产者写
+    std::uint32_t slot_count = 4;
+};
+
+/**
+ * @brief 从外部进程写入的共享内存帧环取帧的视频源
+ *
+ * 建环时格式即确定（format.max_frame_size 为每槽位容量），外部生产者按
+ * shm_video_ring.h 的序列锁协议写帧；get_frame 把最新完整帧所在的槽位钉住，
+ * 直接以槽位内存交给 handler（VideoFrame::owner 释放时放开），整条路径不拷贝。
+ * 生产者还没出新帧时重发最新一帧，从未出过帧时交出空帧。
+ *
+ * 仅 Linux（不含 Android）；其他平台构造失败（is_valid() 为 false）。
+ */
+class USBIPDCPP_API ShmVideoSource : public VideoSource {
+public:
+    explicit ShmVideoSource(VideoFormatInfo format, ShmVideoSourceOptions options = {});
+    ~ShmVideoSource() override;
+
+    ShmVideoSource(const ShmVideoSource &) = delete;
+    ShmVideoSource &operator=(const ShmVideoSource &) = delete;
+
+    [[nodiscard]] bool is_valid() const {
+        return mapping_ != nullptr;
+    }
+
+    /// 共享内存 fd（memfd 或 shm_open 得到的），无效时 -1
+    [[nodiscard]] int fd() const;
+    /// 生产者发布新帧后写入的 eventfd，无效时 -1
+    [[nodiscard]] int event_fd() const;
+    /// 映射起点，供同进程内的生产者使用
+    [[nodiscard]] void *ring() const;
+    /// 映射字节数（生产者 mmap 的长度）
+    [[nodiscard]] std::size_t ring_size() const;
+
+    /// 等到有比上次交出的更新的帧（有 eventfd 通知时立即返回，否则轮询），超时返回 false
+    bool wait_frame(std::chrono::milliseconds timeout);
+
+    std::vector<VideoFormatInfo> supported_formats() const override;
+    VideoFormatInfo current_format() const override;
+    /// 只接受建环时的格式与分辨率，帧间隔随主机选择
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                    std::uint32_t frame_interval) override;
+    bool get_frame(VideoFrame &frame) override;
+    std::size_t max_frame_size() const override;
+    std::uint32_t frame_interval() const override;
+
+    struct Stats {
+        std::uint64_t frames; // 交出的新帧数
+        std::uint64_t repeated; // 生产者没有新帧时重发的次数
+        std::uint64_t missed; // 生产者发布了但没被取到就被更新帧覆盖的帧数
+        std::uint64_t retries; // 钉住后发现槽位已换帧、重读 latest 的次数
+    };
+    Stats stats() const;
+
+private:
+    /// 映射与 fd，最后一个钉住的帧释放后才 munmap
+    struct Mapping;
+
+    /// 最新帧的帧号（0 = 无帧）
+    std::uint64_t latest_frame_number() const;
+
+    VideoFormatInfo format_;
+    ShmVideoSourceOptions options_;
+    std::shared_ptr<Mapping> mapping_;
+
+    mutable std::mutex mutex_;
+    std::uint32_t frame_interval_; // 100ns 单位
+    std::uint64_t last_frame_number_ = 0;
+    std::uint64_t frames_ = 0;
+    std::uint64_t repeated_ = 0;
+    std::uint64_t missed_ = 0;
+    std::uint64_t retries_ = 0;
+};
+
+} // namespace usbipdcpp
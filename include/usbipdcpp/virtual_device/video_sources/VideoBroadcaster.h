@@ -0,0 +1,148 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/video_sources/AsyncVideoSource.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoSource.h"
+
+namespace usbipdcpp {
+
+class BroadcastVideoSource;
+
+struct VideoBroadcasterOptions {
+    /// 某个订阅者取帧时还没有它没拿过的新帧：重发上一帧或交出空帧
+    FrameUnderrunPolicy underrun = FrameUnderrunPolicy::Repeat;
+    /// 生产线程按订阅者中最短的帧间隔取帧；源自己会阻塞等帧时关掉
+    bool pace = true;
+    /// 订阅者超过这么久没有 get_frame 就不算在播；全都不在播时生产线程挂起并放掉缓冲。0 = 一直运行
+    std::chrono::milliseconds idle_timeout{1000};
+};
+
+/**
+ * @brief 一个视频源分发给多个 UVC 设备
+ *
+ * 一个 UVC 虚拟设备同一时间只能被一个会话导入；同一路画面要给多台机器看时，
+ * 每台各建一个 UvcVideoStreamingHandler，源用 subscribe() 得到的 BroadcastVideoSource。
+ * 源（含其中的解码、格式转换、MJPEG 编码）只在一个生产线程上跑一遍，
+ * 每帧放进引用计数的缓冲后交给所有订阅者共享，各 handler 直接从这块内存发送，不按订阅者拷贝。
+ *
+ * 每个订阅者按自己 handler 协商的帧间隔取帧，拿到的总是最新的完整帧：
+ * 发得慢的订阅者（带宽小、帧率低、网络卡）跳过它没来得及取的帧（计入它的 dropped），
+ * 生产线程从不等订阅者，也就不会拖慢其他订阅者。
+ *
+ * 格式在创建时固定为源的当前格式（各会话共享同一路流），订阅者只能选帧间隔；
+ * 之后不要再直接调用源，它只在生产线程上被调用。
+ */
+class USBIPDCPP_API VideoBroadcaster : public std::enable_shared_from_this<VideoBroadcaster> {
+public:
+    static std::shared_ptr<VideoBroadcaster> create(std::unique_ptr<VideoSource> source,
+                                                    VideoBroadcasterOptions options = {});
+    ~VideoBroadcaster();
+
+    VideoBroadcaster(const VideoBroadcaster &) = delete;
+    VideoBroadcaster &operator=(const VideoBroadcaster &) = delete;
+
+    /// 新建一个订阅者，交给 UvcDeviceHelper::setup；订阅者持有广播器的引用
+    std::unique_ptr<BroadcastVideoSource> subscribe();
+
+    std::size_t subscriber_count() const;
+
+    struct Stats {
+        std::uint64_t produced; // 源交出的帧数（每帧只取一次，与订阅者数无关）
+        std::uint64_t source_errors; // 源 get_frame 失败次数
+    };
+    Stats stats() const;
+
+private:
+    friend class BroadcastVideoSource;
+
+    VideoBroadcaster(std::unique_ptr<VideoSource> source, VideoBroadcasterOptions options);
+
+    void stop_producer();
+    void producer_loop();
+    /// 取源的一帧，必要时拷进池化缓冲（生产线程，不持锁）
+    bool capture(VideoFrame &frame);
+    /// 在播订阅者中最短的帧间隔，没有在播的返回 0（持锁调用）
+    std::uint32_t active_interval_locked(std::chrono::steady_clock::time_point now) const;
+
+    std::unique_ptr<VideoSource> source_;
+    VideoBroadcasterOptions options_;
+    std::shared_ptr<VideoFramePool> pool_; // 拷贝不带 owner 的帧
+
+    // 创建时取自源，之后不变
+    VideoFormatInfo format_;
+    std::vector<VideoFormatInfo> formats_;
+    std::size_t max_frame_size_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_; // 要求退出、或挂起的生产线程被订阅者唤醒
+    std::thread producer_;
+    bool stop_ = false;
+    bool parked_ = false;
+    std::vector<BroadcastVideoSource *> subscribers_;
+    VideoFrame latest_{}; // 最新的完整帧，所有订阅者共享
+    std::uint64_t generation_ = 0; // latest_ 的序号，0 = 还没有帧
+
+    std::uint64_t produced_ = 0;
+    std::uint64_t source_errors_ = 0;
+};
+
+/**
+ * @brief VideoBroadcaster 的一个订阅者
+ *
+ * get_frame 不阻塞：有它没拿过的新帧就交出最新的一帧（与其他订阅者共享同一块缓冲），
+ * 否则按 VideoBroadcasterOptions::underrun 重发上一帧或交出空帧。
+ * set_format 只接受广播的格式与分辨率，帧间隔各订阅者独立。
+ */
+class USBIPDCPP_API BroadcastVideoSource : public VideoSource {
+public:
+    ~BroadcastVideoSource() override;
+
+    BroadcastVideoSource(const BroadcastVideoSource &) = delete;
+    BroadcastVideoSource &operator=(const BroadcastVideoSource &) = delete;
+
+    std::vector<VideoFormatInfo> supported_formats() const override;
+    VideoFormatInfo current_format() const override;
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                    std::uint32_t frame_interval) override;
+    bool get_frame(VideoFrame &frame) override;
+    std::size_t max_frame_size() const override;
+    std::uint32_t frame_interval() const override;
+
+    struct Stats {
+        std::uint64_t delivered; // 交出的新帧数
+        std::uint64_t dropped; // 在播期间源出了、但它没来得及取就被更新帧顶掉的帧数
+        std::uint64_t repeated; // 没有新帧时重发上一帧的次数
+        std::uint64_t skipped; // 没有新帧时交出空帧的次数（含首帧就绪前）
+    };
+    Stats stats() const;
+
+private:
+    friend class VideoBroadcaster;
+
+    explicit BroadcastVideoSource(std::shared_ptr<VideoBroadcaster> broadcaster);
+
+    std::shared_ptr<VideoBroadcaster> broadcaster_;
+
+    // 以下由 broadcaster_->mutex_ 保护
+    std::uint32_t frame_interval_; // 100ns 单位
+    std::chrono::steady_clock::time_point last_request_{};
+    std::uint64_t generation_ = 0; // 上次交出的帧的序号
+    VideoFrame front_{}; // 上次交出的帧，Repeat 时重发
+
+    std::uint64_t delivered_ = 0;
+    std::uint64_t dropped_ = 0;
+    std::uint64_t repeated_ = 0;
+    std::uint64_t skipped_ = 0;
+};
+
+} // namespace usbipdcpp
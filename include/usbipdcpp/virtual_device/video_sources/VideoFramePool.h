@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "usbipdcpp/Export.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoSource.h"
+
+namespace usbipdcpp {
+
+/// 一块帧缓冲：源写满后以 shared_ptr<const VideoFrameBuffer> 交出，之后只读
+class USBIPDCPP_API VideoFrameBuffer {
+public:
+    explicit VideoFrameBuffer(std::size_t capacity);
+
+    std::uint8_t *data() {
+        return storage_.get();
+    }
+
+    const std::uint8_t *data() const {
+        return storage_.get();
+    }
+
+    /// 有效字节数
+    std::size_t size() const {
+        return size_;
+    }
+
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+    /// 设置有效字节数（不超过 capacity）
+    void set_size(std::size_t size);
+
+private:
+    std::unique_ptr<std::uint8_t[]> storage_; // 不清零：源总会整帧覆盖
+    std::size_t capacity_;
+    std::size_t size_ = 0;
+};
+
+/// 把填好的缓冲包装成 VideoFrame（owner 即该缓冲）
+USBIPDCPP_API VideoFrame make_video_frame(std::shared_ptr<const VideoFrameBuffer> buffer, bool is_keyframe = true);
+
+/**
+ * @brief 帧缓冲池
+ *
+ * acquire() 借出一块可写缓冲，源填好帧后把它（转成 const）放进 VideoFrame::owner 交给 handler；
+ * handler 发完最后一个 payload 释放引用时缓冲自动回到池里，稳态下不再分配。
+ * 池先于缓冲销毁也没关系：归还时发现池已不在就直接释放。线程安全。
+ */
+class USBIPDCPP_API VideoFramePool : public std::enable_shared_from_this<VideoFramePool> {
+public:
+    struct Stats {
+        std::uint64_t allocations; // 新分配的缓冲数
+        std::uint64_t reuses; // 从空闲列表取出的次数
+        std::size_t in_use; // 当前借出未还
+        std::size_t idle; // 空闲列表长度
+    };
+
+    /// @param buffer_size 每块缓冲的容量（通常为当前格式的 max_frame_size）
+    /// @param max_idle    最多保留的空闲缓冲数，多出的归还时直接释放
+    static std::shared_ptr<VideoFramePool> create(std::size_t buffer_size, std::size_t max_idle = 4);
+
+    VideoFramePool(const VideoFramePool &) = delete;
+    VideoFramePool &operator=(const VideoFramePool &) = delete;
+
+    /// 借一块容量不小于 buffer_size() 的缓冲，没有空闲时新分配
+    std::shared_ptr<VideoFrameBuffer> acquire();
+
+    /// 格式切换后改变容量：丢弃现有空闲缓冲，之后归还的旧尺寸缓冲直接释放
+    void set_buffer_size(std::size_t buffer_size);
+
+    std::size_t buffer_size() const;
+    Stats stats() const;
+
+private:
+    VideoFramePool(std::size_t buffer_size, std::size_t max_idle);
+
+    void release(VideoFrameBuffer *buffer);
+
+    mutable std::mutex mutex_;
+    std::size_t buffer_size_;
+    std::size_t max_idle_;
+    std::vector<std::unique_ptr<VideoFrameBuffer>> idle_;
+    std::uint64_t allocations_ = 0;
+    std::uint64_t reuses_ = 0;
+    std::size_t in_use_ = 0;
+};
+
+} // namespace usbipdcpp
@@ -2,6 +2,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace usbipdcpp {
@@ -21,6 +22,9 @@ struct VideoFormatInfo {
     /// 约束：(max - min) % min == 0（usbvideo.sys 整除检查）。
     std::uint32_t max_frame_interval;
     std::uint8_t bits_per_pixel; // 每像素位数
+    /// 非空：离散帧间隔列表（100ns 单位，升序，须含 default），Frame 描述符 bFrameIntervalType = 个数；
+    /// 为空：连续范围 [min, max]，步长 min（bFrameIntervalType = 0）
+    std::vector<std::uint32_t> frame_intervals{};
 };
 
 /// 视频帧
@@ -28,6 +32,10 @@ struct VideoFrame {
     const std::uint8_t *data; // 帧数据指针（由 VideoSource 管理生命周期）
     std::size_t size; // 帧数据字节数
     bool is_keyframe; // 是否为关键帧
+    /// 帧数据的持有者（通常是 VideoFramePool 借出的缓冲）。
+    /// 非空：持有期间 data 一直有效且内容不再改变，UvcHandler 直接持有它发送，不拷贝；
+    /// 为空：data 只在下次 get_frame 前有效，UvcHandler 先拷贝一份
+    std::shared_ptr<const void> owner;
 };
 
 /// 视频帧源抽象接口
@@ -36,17 +44,20 @@ class VideoSource {
 public:
     virtual ~VideoSource() = default;
 
-    /// 返回源支持的所有格式列表
+    /// 返回源支持的所有格式列表：每项是一种（格式, 分辨率）组合，
+    /// UvcHandler 按 fourcc 首次出现的顺序分组成 Format 描述符，组内按列表顺序编 bFrameIndex
     virtual std::vector<VideoFormatInfo> supported_formats() const = 0;
 
     /// 当前协商的格式
     virtual VideoFormatInfo current_format() const = 0;
 
-    /// 切换格式。仅切换描述符索引，UvcHandler 会在 COMMIT 后调用
+    /// 切换格式。UvcHandler 在 COMMIT 时以主机选中的（格式, 分辨率, 帧间隔）调用，返回 false 则 COMMIT 失败
     virtual bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
                             std::uint32_t frame_interval) = 0;
 
-    /// 获取下一帧。data 指针由源管理，在下次 get_frame 调用前有效
+    /// 获取下一帧。未设置 frame.owner 时 data 指针由源管理，在下次 get_frame 调用前有效；
+    /// 设置了 owner 则在 owner 释放前有效（源不得再改写这块内存）。
+    /// 返回 true 但 size == 0 表示暂时没有新帧：UvcHandler 这次不发帧，下个 URB 再取；返回 false 则让端点 STALL
     virtual bool get_frame(VideoFrame &frame) = 0;
 
     /// 当前格式下的最大帧大小（用于分配 ISO 传输缓冲区）
@@ -0,0 +1,179 @@
+/*
+ * ShmVideoSource 的共享内存帧环布局与生产者接口（C 头文件，C99 / C++ 均可包含，仅依赖 GCC / Clang 原子内建）。
+ *
+ * 服务端（ShmVideoSource）建环：memfd 或 POSIX 共享内存，格式在建环时确定；
+ * 外部进程（渲染器、采集工具……）映射同一块内存，按下面的协议写帧，服务端直接从槽位发送，不拷贝。
+ *
+ * 布局：页首是 usbipdcpp_shm_video_header（含各槽位的描述），帧数据从 data_offset 起，
+ * 每槽位 slot_stride 字节（容量 slot_capacity）。
+ *
+ * 协议（单生产者、单消费者）：
+ *   slot.seq   —— 序列锁：奇数 = 生产者正在写；写完后为 2 × 帧号（帧号从 1 递增，不会回到旧值）
+ *   slot.readers —— 消费者钉住该槽位的引用数（handler 发送期间），生产者跳过 readers != 0 的槽位
+ *   header.latest —— 最新完整帧：(帧号 << 8) | 槽位号，0 = 还没有帧
+ * 生产者：选一个不是 latest、readers == 0 的槽位 → seq 置奇数 → 再检查 readers（消费者可能刚钉住，
+ *   是则恢复 seq 换下一个槽位）→ 写数据 → seq = 2 × 帧号 → 更新 latest → 可选地写 eventfd 通知。
+ * 消费者：读 latest → 钉住槽位（readers + 1）→ 确认 seq == 2 × 帧号，否则放开重读。
+ * 两边的 "写标记再读对方标记" 都用 seq_cst，保证至少一方看到另一方。
+ *
+ * 所有槽位都被钉住（消费者持有的帧超过 slot_count - 1 个）时 begin 返回 NULL，生产者丢掉这一帧即可。
+ */
+#ifndef USBIPDCPP_SHM_VIDEO_RING_H
+#define USBIPDCPP_SHM_VIDEO_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#define USBIPDCPP_SHM_VIDEO_MAGIC 0x48535655u /* "UVSH" */
+#define USBIPDCPP_SHM_VIDEO_VERSION 1u
+#define USBIPDCPP_SHM_VIDEO_MAX_SLOTS 16u
+#define USBIPDCPP_SHM_VIDEO_ALIGN 4096u
+
+/* 一个槽位的描述，40 字节 */
+typedef struct usbipdcpp_shm_video_slot {
+    uint64_t seq; /* 序列锁，见文件头 */
+    uint64_t frame_number;
+    uint64_t timestamp_ns; /* 生产者给的时间戳，服务端不解释 */
+    uint32_t readers; /* 消费者钉住次数 */
+    uint32_t size; /* 帧有效字节数 */
+    uint32_t flags; /* USBIPDCPP_SHM_VIDEO_KEYFRAME */
+    uint32_t reserved;
+} usbipdcpp_shm_video_slot;
+
+#define USBIPDCPP_SHM_VIDEO_KEYFRAME 1u
+
+typedef struct usbipdcpp_shm_video_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_capacity; /* 每槽位最多可写字节数 */
+    uint64_t slot_stride; /* 槽位间距，页对齐 */
+    uint64_t data_offset; /* 第一个槽位的帧数据相对映射起点的偏移 */
+    uint64_t total_size; /* 整个映射的字节数 */
+    uint32_t fourcc; /* UVC FOURCC，与服务端声明的格式一致 */
+    uint16_t width;
+    uint16_t height;
+    uint32_t frame_interval; /* 100ns 单位 */
+    uint32_t reserved;
+    uint64_t latest; /* (帧号 << 8) | 槽位号，0 = 无帧 */
+    uint64_t next_frame_number; /* 生产者私有：下一个帧号 */
+    usbipdcpp_shm_video_slot slots[USBIPDCPP_SHM_VIDEO_MAX_SLOTS];
+} usbipdcpp_shm_video_header;
+
+static inline uint64_t usbipdcpp_shm_video_align(uint64_t value) {
+    return (value + USBIPDCPP_SHM_VIDEO_ALIGN - 1) / USBIPDCPP_SHM_VIDEO_ALIGN * USBIPDCPP_SHM_VIDEO_ALIGN;
+}
+
+/* 建环所需的映射大小 */
+static inline uint64_t usbipdcpp_shm_video_ring_size(uint32_t slot_count, uint32_t slot_capacity) {
+    return usbipdcpp_shm_video_align(sizeof(usbipdcpp_shm_video_header)) +
+           (uint64_t) slot_count * usbipdcpp_shm_video_align(slot_capacity);
+}
+
+/* 在 size 字节的映射上初始化空环（服务端调用）。成功返回 0 */
+static inline int usbipdcpp_shm_video_init(void *base, uint64_t size, uint32_t fourcc, uint16_t width, uint16_t height,
+                                           uint32_t frame_interval, uint32_t slot_count, uint32_t slot_capacity) {
+    usbipdcpp_shm_video_header *header = (usbipdcpp_shm_video_header *) base;
+    if (slot_count < 2 || slot_count > USBIPDCPP_SHM_VIDEO_MAX_SLOTS || slot_capacity == 0 ||
+        size < usbipdcpp_shm_video_ring_size(slot_count, slot_capacity))
+        return -1;
+    memset(header, 0, sizeof(*header));
+    header->version = USBIPDCPP_SHM_VIDEO_VERSION;
+    header->slot_count = slot_count;
+    header->slot_capacity = slot_capacity;
+    header->slot_stride = usbipdcpp_shm_video_align(slot_capacity);
+    header->data_offset = usbipdcpp_shm_video_align(sizeof(usbipdcpp_shm_video_header));
+    header->total_size = size;
+    header->fourcc = fourcc;
+    header->width = width;
+    header->height = height;
+    header->frame_interval = frame_interval;
+    header->next_frame_number = 1;
+    /* magic 最后写：生产者看到 magic 时其余字段已就绪 */
+    __atomic_store_n(&header->magic, USBIPDCPP_SHM_VIDEO_MAGIC, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* 校验映射上的环头（生产者映射后调用）。可用返回 0 */
+static inline int usbipdcpp_shm_video_check(const void *base, uint64_t size) {
+    const usbipdcpp_shm_video_header *header = (const usbipdcpp_shm_video_header *) base;
+    if (size < sizeof(*header) || __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != USBIPDCPP_SHM_VIDEO_MAGIC ||
+        header->version != USBIPDCPP_SHM_VIDEO_VERSION)
+        return -1;
+    if (header->slot_count < 2 || header->slot_count > USBIPDCPP_SHM_VIDEO_MAX_SLOTS ||
+        header->slot_stride < header->slot_capacity || header->total_size > size ||
+        header->data_offset + header->slot_count * header->slot_stride > header->total_size)
+        return -1;
+    return 0;
+}
+
+static inline uint8_t *usbipdcpp_shm_video_slot_data(void *base, uint32_t slot) {
+    const usbipdcpp_shm_video_header *header = (const usbipdcpp_shm_video_header *) base;
+    return (uint8_t *) base + header->data_offset + (uint64_t) slot * header->slot_stride;
+}
+
+/*
+ * 取一个可写槽位，返回其帧数据指针（容量 slot_capacity），*slot_out 为槽位号；
+ * 所有可用槽位都被消费者钉住时返回 NULL
+ */
+static inline uint8_t *usbipdcpp_shm_video_begin(void *base, uint32_t *slot_out) {
+    usbipdcpp_shm_video_header *header = (usbipdcpp_shm_video_header *) base;
+    uint64_t latest = __atomic_load_n(&header->latest, __ATOMIC_ACQUIRE);
+    uint32_t start = latest ? (uint32_t) (latest & 0xFF) + 1 : 0;
+    for (uint32_t i = 0; i < header->slot_count; ++i) {
+        uint32_t slot = (start + i) % header->slot_count;
+        usbipdcpp_shm_video_slot *s = &header->slots[slot];
+        if (latest && slot == (uint32_t) (latest & 0xFF))
+            continue;
+        if (__atomic_load_n(&s->readers, __ATOMIC_SEQ_CST) != 0)
+            continue;
+        uint64_t seq = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+        /* 上一个生产者写到一半退出时 seq 已是奇数，直接接着用 */
+        uint64_t writing = seq | 1u;
+        __atomic_store_n(&s->seq, writing, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&s->readers, __ATOMIC_SEQ_CST) != 0) {
+            __atomic_store_n(&s->seq, seq, __ATOMIC_RELEASE);
+            continue;
+        }
+        *slot_out = slot;
+        return usbipdcpp_shm_video_slot_data(base, slot);
+    }
+    return NULL;
+}
+
+/* 发布 begin 取得的槽位中 size 字节的帧，返回帧号（size 超出容量返回 0 并放弃该槽位） */
+static inline uint64_t usbipdcpp_shm_video_commit(void *base, uint32_t slot, uint32_t size, uint32_t flags,
+                                                  uint64_t timestamp_ns) {
+    usbipdcpp_shm_video_header *header = (usbipdcpp_shm_video_header *) base;
+    usbipdcpp_shm_video_slot *s = &header->slots[slot];
+    if (size > header->slot_capacity)
+        return 0;
+    uint64_t frame_number = header->next_frame_number++;
+    s->size = size;
+    s->flags = flags;
+    s->frame_number = frame_number;
+    s->timestamp_ns = timestamp_ns;
+    __atomic_store_n(&s->seq, frame_number * 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->latest, (frame_number << 8) | slot, __ATOMIC_RELEASE);
+    return frame_number;
+}
+
+/* 通知服务端有新帧（event_fd 为服务端提供的 eventfd，< 0 时什么也不做） */
+static inline void usbipdcpp_shm_video_notify(int event_fd) {
+#ifdef __linux__
+    if (event_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(event_fd, &one, sizeof(one));
+        (void) ignored;
+    }
+#else
+    (void) event_fd;
+#endif
+}
+
+#endif /* USBIPDCPP_SHM_VIDEO_RING_H */
@@ -0,0 +1,90 @@
+#include "usbipdcpp/virtual_device/UvcTransferOperator.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "usbipdcpp/virtual_device/UvcConstants.h"
+
+namespace usbipdcpp {
+
+// ==================== UvcPayloadTransfer ====================
+
+std::size_t UvcPayloadTransfer::flatten() {
+    staging.resize(actual_length);
+    std::size_t pos = 0;
+    for (auto &buf: buffers) {
+        std::memcpy(staging.data() + pos, buf.data(), buf.size());
+        pos += buf.size();
+    }
+    buffers.clear();
+    keepalive.reset();
+    return pos;
+}
+
+// ==================== UvcTransferOperator ====================
+
+void *UvcTransferOperator::alloc_transfer_handle(std::size_t, int num_iso_packets, const UsbIpHeaderBasic &,
+                                                 const SetupPacket &) {
+    auto *trx = pool_.alloc();
+    if (!trx)
+        trx = new UvcPayloadTransfer{};
+    trx->reset();
+    trx->iso_descriptors.resize(num_iso_packets);
+    // 头区定长：buffers 保存的是指向它的指针，之后不能再扩容
+    trx->headers.resize(static_cast<std::size_t>(std::max(num_iso_packets, 1)) * UVC_PAYLOAD_HEADER_SIZE);
+    trx->buffers.reserve(static_cast<std::size_t>(num_iso_packets) * 3 + 2);
+    return trx;
+}
+
+void UvcTransferOperator::free_transfer_handle(void *handle) {
+    auto *trx = UvcPayloadTransfer::from_handle(handle);
+    // 归还前先放掉帧引用，帧缓冲尽早回到源的池里（对象池的 reset 要到下次 alloc 才发生）
+    trx->keepalive.reset();
+    trx->buffers.clear();
+    if (!pool_.free(trx))
+        delete trx;
+}
+
+std::size_t UvcTransferOperator::get_actual_length(void *handle) {
+    return UvcPayloadTransfer::from_handle(handle)->actual_length;
+}
+
+UsbIpIsoPacketDescriptor UvcTransferOperator::get_iso_descriptor(void *handle, int index) {
+    return UvcPayloadTransfer::from_handle(handle)->iso_descriptors[index];
+}
+
+void UvcTransferOperator::set_iso_descriptor(void *handle, int index, const UsbIpIsoPacketDescriptor &desc) {
+    UvcPayloadTransfer::from_handle(handle)->iso_descriptors[index] = desc;
+}
+
+void UvcTransferOperator::send_transfer_data(void *handle, asio::ip::tcp::socket &sock, std::size_t length,
+                                             std::error_code &ec) {
+    auto *trx = UvcPayloadTransfer::from_handle(handle);
+    auto &buffers = trx->buffers;
+    if (length == 0)
+        buffers.clear();
+    else if (!trx->staging.empty())
+        buffers.assign(1, asio::buffer(trx->staging.data(), length));
+    // 描述符原样透传（offset/length 保持主机的 buffer 布局），追加在数据段之后一起 gather write
+    for (auto &iso: trx->iso_descriptors)
+        trx->descriptor_bytes.push_back(iso.to_bytes());
+    for (auto &bytes: trx->descriptor_bytes)
+        buffers.push_back(asio::buffer(bytes));
+    if (!buffers.empty())
+        asio::write(sock, buffers, ec);
+}
+
+void UvcTransferOperator::recv_transfer_data(void *handle, asio::ip::tcp::socket &sock, std::size_t length,
+                                             std::error_code &ec) {
+    auto *trx = UvcPayloadTransfer::from_handle(handle);
+    if (length > 0) {
+        trx->staging.resize(length);
+        asio::read(sock, asio::buffer(trx->staging), ec);
+        if (ec)
+            return;
+    }
+    for (auto &iso: trx->iso_descriptors)
+        iso.from_socket(sock);
+}
+
+} // namespace usbipdcpp
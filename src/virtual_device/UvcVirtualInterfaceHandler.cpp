@@ -8,6 +8,7 @@
 #include "usbipdcpp/protocol.h"
 #include "spdlog/spdlog.h"
 #include "usbipdcpp/virtual_device/SimpleVirtualDeviceHandler.h"
+#include "usbipdcpp/virtual_device/UvcTransferOperator.h"
 
 namespace usbipdcpp {
 
@@ -452,7 +453,8 @@ data_type UvcVideoControlHandler::request_get_descriptor(std::uint8_t type, std:
 
 UvcVideoStreamingHandler::UvcVideoStreamingHandler(UsbInterface &handle_interface, StringPool &string_pool,
                                                    std::unique_ptr<VideoSource> source) :
-    VirtualInterfaceHandler(handle_interface, string_pool), source_(std::move(source)) {
+    VirtualInterfaceHandler(handle_interface, string_pool, std::make_unique<UvcTransferOperator>()),
+    source_(std::move(source)) {
     probe_data_.dwMaxVideoFrameSize = static_cast<std::uint32_t>(source_->max_frame_size());
     probe_data_.dwMaxPayloadTransferSize = 512; // wMaxPacketSize of ISO endpoint
     probe_data_.dwFrameInterval = source_->frame_interval();
@@ -460,148 +462,114 @@ UvcVideoStreamingHandler::UvcVideoStreamingHandler(UsbInterface &handle_interfac
 }
 
 void UvcVideoStreamingHandler::on_setup_interface_handlers() {
+    // alt 0 含 Bulk IN 端点即为批量模式（等时模式的 alt 0 必须是零带宽）
+    bulk_mode_ = false;
+    if (!handle_interface.endpoints.empty()) {
+        for (const auto &ep: handle_interface.endpoints[0]) {
+            if (ep.is_in() && (ep.attributes & 0x03) == static_cast<std::uint8_t>(EndpointAttributes::Bulk)) {
+                bulk_mode_ = true;
+                stream_ep_address_ = ep.address;
+                break;
+            }
+        }
+    }
+    // 等时模式从 streaming alt (alt 1) 获取端点地址
+    if (!bulk_mode_) {
+        if (handle_interface.endpoints.size() > 1 && !handle_interface.endpoints[1].empty())
+            stream_ep_address_ = handle_interface.endpoints[1][0].address;
+        else if (!handle_interface.endpoints.empty() && !handle_interface.endpoints[0].empty())
+            stream_ep_address_ = handle_interface.endpoints[0][0].address;
+    }
+    // 等时各 alt 每个服务周期能带的字节数（alt 0 零带宽），PROBE 据此报告 dwMaxPayloadTransferSize
+    iso_alt_capacity_.assign(handle_interface.endpoints.size(), 0);
+    iso_service_interval_ = 1;
+    if (!bulk_mode_) {
+        for (std::size_t alt = 1; alt < handle_interface.endpoints.size(); ++alt) {
+            for (const auto &ep: handle_interface.endpoints[alt]) {
+                if (ep.address != stream_ep_address_ ||
+                    (ep.attributes & 0x03) != static_cast<std::uint8_t>(EndpointAttributes::Isochronous))
+                    continue;
+                iso_alt_capacity_[alt] = iso_packet_capacity(ep.max_packet_size);
+                // 高速等时 bInterval：每 2^(bInterval-1) 个微帧服务一次
+                iso_service_interval_ = 1u << (std::clamp<std::uint8_t>(ep.interval, 1, 16) - 1);
+            }
+        }
+    }
     build_class_descriptor();
+    normalize_control(probe_data_);
+}
+
+void UvcVideoStreamingHandler::set_bulk_payload_size(std::uint32_t size) {
+    bulk_payload_size_ = std::max<std::uint32_t>(size, UVC_PAYLOAD_HEADER_SIZE + 1);
+    if (bulk_mode_ && !committed_)
+        probe_data_.dwMaxPayloadTransferSize = bulk_payload_size_;
+}
+
+std::uint32_t UvcVideoStreamingHandler::iso_packet_capacity(std::uint16_t max_packet_size) {
+    // USB 2.0 §9.6.6: D10..0 为包长，D12..11 为每微帧额外事务数（高带宽端点最多 3 个事务）
+    auto transactions = 1u + std::min((max_packet_size >> 11) & 0x03u, 2u);
+    return (max_packet_size & 0x7FFu) * transactions;
+}
+
+std::uint32_t UvcVideoStreamingHandler::max_iso_capacity() const {
+    auto it = std::max_element(iso_alt_capacity_.begin(), iso_alt_capacity_.end());
+    return (it == iso_alt_capacity_.end() || *it == 0) ? 512 : *it;
+}
+
+std::uint32_t UvcVideoStreamingHandler::device_payload_size(const VideoFormatInfo &frame,
+                                                           std::uint32_t interval) const {
+    // 批量：一个 payload 的上限，主机按它切分 payload
+    if (bulk_mode_)
+        return bulk_payload_size_;
+    // 等时：一帧要在一个帧间隔内发完。帧间隔里有 interval / (1250 × 服务周期) 次服务机会
+    // （高速 125µs 微帧 = 1250 个 100ns），每次须带 ceil(帧大小 / 次数) + 头。
+    // 报告能装下它的最小 alt 的容量：主机就选这个 alt，小帧不再占满最大带宽；都装不下时报告最大 alt
+    std::uint64_t services = interval / (1250ull * iso_service_interval_);
+    std::uint64_t need = (services == 0 ? frame.max_frame_size : (frame.max_frame_size + services - 1) / services) +
+                         UVC_PAYLOAD_HEADER_SIZE;
+    std::uint32_t best = 0;
+    for (auto capacity: iso_alt_capacity_) {
+        if (capacity >= need && (best == 0 || capacity < best))
+            best = capacity;
+    }
+    return best != 0 ? best : max_iso_capacity();
 }
 
 void UvcVideoStreamingHandler::build_class_descriptor() {
-    auto fmt = source_->current_format();
-
-    std::uint8_t ep_addr = 0x81;
-    // 从 streaming alt (alt 1) 获取端点地址
-    if (handle_interface.endpoints.size() > 1 && !handle_interface.endpoints[1].empty())
-        ep_addr = handle_interface.endpoints[1][0].address;
-    else if (!handle_interface.endpoints.empty() && !handle_interface.endpoints[0].empty())
-        ep_addr = handle_interface.endpoints[0][0].address;
-
-    auto cat = uvc_format_category(fmt.fourcc);
-    auto guid = UvcGuid::from_fourcc(fmt.fourcc);
-    auto bpp = static_cast<std::uint8_t>(fmt.bits_per_pixel);
-
-    std::uint8_t format_subtype{};
-    std::uint8_t frame_subtype{};
-    data_type format;
-
-    if (cat == UvcFormatCategory::Uncompressed) {
-        format_subtype = VS_DESC_FORMAT_UNCOMPRESSED;
-        frame_subtype = VS_DESC_FRAME_UNCOMPRESSED;
-        // Format descriptor: 27 bytes（保持与修复前完全一致的布局）
-        format.resize(27, 0);
-        format[0] = 27;
-        format[1] = 0x24;
-        format[2] = format_subtype;
-        format[3] = 0x01;
-        format[4] = 0x01;
-        std::memcpy(&format[5], guid.data, 16);
-        format[21] = bpp;
-        format[22] = 0x01;
-        format[23] = 0x00;
-        format[24] = 0x00;
-    } else if (cat == UvcFormatCategory::Mjpeg) {
-        format_subtype = VS_DESC_FORMAT_MJPEG;
-        frame_subtype = VS_DESC_FRAME_MJPEG;
-        // MJPEG Format descriptor: 11 bytes（UVC 1.5 MJPEG Payload Table 3-1）
-        format.resize(11, 0);
-        format[0] = 11;
-        format[1] = 0x24;
-        format[2] = format_subtype;
-        format[3] = 0x01;
-        format[4] = 0x01;
-        format[5] = 0x01; // bmFlags
-        format[6] = 0x01; // bDefaultFrameIndex
-    } else if (cat == UvcFormatCategory::FrameBased) {
-        format_subtype = VS_DESC_FORMAT_FRAME_BASED;
-        frame_subtype = VS_DESC_FRAME_FRAME_BASED;
-        // Frame-Based Format: 28 bytes（UVC 1.5 Frame-Based Payload Table 3-1）
-        format.resize(28, 0);
-        format[0] = 28;
-        format[1] = 0x24;
-        format[2] = format_subtype;
-        format[3] = 0x01;
-        format[4] = 0x01;
-        std::memcpy(&format[5], guid.data, 16);
-        format[21] = bpp;
-        format[22] = 0x01;
-        format[23] = 0x00;
-        format[24] = 0x00;
-        format[27] = 0x01; // bVariableSize
-    } else { // H264
-        format_subtype = VS_DESC_FORMAT_H264;
-        frame_subtype = VS_DESC_FRAME_H264;
-        // H.264 Format: 52 bytes（UVC 1.5 H.264 Payload Table 3-1）
-        format.resize(52, 0);
-        format[0] = 52;
-        format[1] = 0x24;
-        format[2] = format_subtype;
-        format[3] = 0x01;
-        format[4] = 0x01;
-        format[5] = 0x01; // bDefaultFrameIndex
-        std::memcpy(&format[21], guid.data, 16);
-        format[37] = bpp;
-        format[38] = 0x01;
-        format[39] = 0x01;
-    }
-
-    // Frame descriptor（Uncompressed/MJPEG/FrameBased: 26基础+12间隔=38; H264: 44基础+12间隔=56）
-    auto fps_val = 10'000'000ULL / fmt.default_frame_interval;
-    auto bit_rate = static_cast<std::uint32_t>(fmt.max_frame_size * 8 * fps_val);
-    auto min_iv = fmt.min_frame_interval;
-    auto max_iv = fmt.max_frame_interval;
-    auto step_iv = min_iv;
-
-    auto frame_base = (cat == UvcFormatCategory::H264) ? VS_FRM_H264_BASE_LEN : 26u;
-    auto frame_len = frame_base + 12;
-    data_type frame(frame_len, 0);
-    frame[0] = static_cast<std::uint8_t>(frame_len);
-    frame[1] = 0x24;
-    frame[2] = frame_subtype;
-    frame[3] = 0x01; // bFrameIndex
-    frame[4] = 0x00; // bmCapabilities
-    frame[5] = static_cast<std::uint8_t>(fmt.width & 0xFF);
-    frame[6] = static_cast<std::uint8_t>((fmt.width >> 8) & 0xFF);
-    frame[7] = static_cast<std::uint8_t>(fmt.height & 0xFF);
-    frame[8] = static_cast<std::uint8_t>((fmt.height >> 8) & 0xFF);
-    for (int i = 0; i < 4; ++i) {
-        frame[9 + i] = static_cast<std::uint8_t>((bit_rate >> (i * 8)) & 0xFF);
-        frame[13 + i] = static_cast<std::uint8_t>((bit_rate >> (i * 8)) & 0xFF);
-    }
-    frame[17] = static_cast<std::uint8_t>(fmt.max_frame_size & 0xFF);
-    frame[18] = static_cast<std::uint8_t>((fmt.max_frame_size >> 8) & 0xFF);
-    frame[19] = static_cast<std::uint8_t>((fmt.max_frame_size >> 16) & 0xFF);
-    frame[20] = static_cast<std::uint8_t>((fmt.max_frame_size >> 24) & 0xFF);
-    frame[21] = static_cast<std::uint8_t>(fmt.default_frame_interval & 0xFF);
-    frame[22] = static_cast<std::uint8_t>((fmt.default_frame_interval >> 8) & 0xFF);
-    frame[23] = static_cast<std::uint8_t>((fmt.default_frame_interval >> 16) & 0xFF);
-    frame[24] = static_cast<std::uint8_t>((fmt.default_frame_interval >> 24) & 0xFF);
-    frame[25] = 0x00; // bFrameIntervalType = 0 (continuous)
-    // usbvideo.sys!DumpAndValidateFrameUncompressed 对连续帧间隔有三项整除检查：
-    //   if (step != 0) {
-    //       if (max <= min)                → STATUS_INVALID_PARAMETER
-    //       if ((max - min) % step != 0)   → STATUS_INVALID_PARAMETER
-    //   }
-    // 因此 max 必须是 min + N*step（N 为正整数），否则 Windows 直接 Code 10。
-    // min/max/step 均取自 VideoSource，step=min 保证 (max-min) 是 min 的整数倍。
-    for (int i = 0; i < 4; ++i)
-        frame[frame_base + i] = static_cast<std::uint8_t>((min_iv >> (i * 8)) & 0xFF);
-    for (int i = 0; i < 4; ++i)
-        frame[frame_base + 4 + i] = static_cast<std::uint8_t>((max_iv >> (i * 8)) & 0xFF);
-    for (int i = 0; i < 4; ++i)
-        frame[frame_base + 8 + i] = static_cast<std::uint8_t>((step_iv >> (i * 8)) & 0xFF);
-
-    // Color Matching: Uncompressed 和 MJPEG 强制（各自 payload spec §3）
-    bool has_color = (cat == UvcFormatCategory::Uncompressed || cat == UvcFormatCategory::Mjpeg);
-    data_type color;
-    if (has_color) {
-        VsColorMatchingDesc{VS_COLOR_MATCHING_LEN, CS_INTERFACE, VS_DESC_COLORFORMAT,
-                            VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M}
-                .append_to(color);
+    // 按 fourcc 首次出现的顺序分组：每组一个 Format 描述符，组内每种分辨率一个 Frame 描述符
+    formats_.clear();
+    auto supported = source_->supported_formats();
+    if (supported.empty())
+        supported.push_back(source_->current_format());
+    for (auto &info: supported) {
+        auto it = std::find_if(formats_.begin(), formats_.end(),
+                               [&](const FormatGroup &g) { return g.fourcc == info.fourcc; });
+        if (it == formats_.end())
+            it = formats_.insert(formats_.end(), FormatGroup{info.fourcc, {}, 1});
+        it->frames.push_back(info);
+    }
+    // 默认格式 / 帧取源的当前格式，不在列表里时退回第一个
+    auto current = source_->current_format();
+    default_format_index_ = 1;
+    for (std::size_t f = 0; f < formats_.size(); ++f) {
+        auto &frames = formats_[f].frames;
+        auto it = std::find_if(frames.begin(), frames.end(), [&](const VideoFormatInfo &info) {
+            return info.width == current.width && info.height == current.height;
+        });
+        if (it != frames.end())
+            formats_[f].default_frame_index = static_cast<std::uint8_t>(it - frames.begin() + 1);
+        if (formats_[f].fourcc == current.fourcc)
+            default_format_index_ = static_cast<std::uint8_t>(f + 1);
     }
 
+    std::uint8_t ep_addr = stream_ep_address_;
+
     // VS Input Header（wTotalLength 占位，拼接完成后回填实际总长）
     static constexpr std::uint8_t bControlSize = 1;
 
-    data_type header;
+    data_type d;
     VsInputHeaderDesc{VS_INPUT_HEADER_LEN, CS_INTERFACE, VS_DESC_INPUT_HEADER,
-                      0x01, // bNumFormats
+                      static_cast<std::uint8_t>(formats_.size()), // bNumFormats
                       0x00,
                       ep_addr,
                       0x00, // bmInfo
@@ -611,13 +579,149 @@ void UvcVideoStreamingHandler::build_class_descriptor() {
                       0x00, // bTriggerUsage
                       bControlSize,
                       0x00} // bmaControls[0]
-            .append_to(header);
+            .append_to(d);
 
-    data_type d;
-    d.insert(d.end(), header.begin(), header.end());
-    d.insert(d.end(), format.begin(), format.end());
-    d.insert(d.end(), frame.begin(), frame.end());
-    d.insert(d.end(), color.begin(), color.end());
+    for (std::size_t f = 0; f < formats_.size(); ++f) {
+        auto &group = formats_[f];
+        auto &first = group.frames.front();
+        auto cat = uvc_format_category(group.fourcc);
+        auto guid = UvcGuid::from_fourcc(group.fourcc);
+        auto bpp = static_cast<std::uint8_t>(first.bits_per_pixel);
+        auto format_index = static_cast<std::uint8_t>(f + 1);
+        auto num_frames = static_cast<std::uint8_t>(group.frames.size());
+
+        std::uint8_t format_subtype{};
+        std::uint8_t frame_subtype{};
+        data_type format;
+
+        if (cat == UvcFormatCategory::Uncompressed) {
+            format_subtype = VS_DESC_FORMAT_UNCOMPRESSED;
+            frame_subtype = VS_DESC_FRAME_UNCOMPRESSED;
+            // Format descriptor: 27 bytes（保持与修复前完全一致的布局）
+            format.resize(27, 0);
+            format[0] = 27;
+            format[1] = 0x24;
+            format[2] = format_subtype;
+            format[3] = format_index;
+            format[4] = num_frames;
+            std::memcpy(&format[5], guid.data, 16);
+            format[21] = bpp;
+            format[22] = group.default_frame_index;
+            format[23] = 0x00;
+            format[24] = 0x00;
+        } else if (cat == UvcFormatCategory::Mjpeg) {
+            format_subtype = VS_DESC_FORMAT_MJPEG;
+            frame_subtype = VS_DESC_FRAME_MJPEG;
+            // MJPEG Format descriptor: 11 bytes（UVC 1.5 MJPEG Payload Table 3-1）
+            format.resize(11, 0);
+            format[0] = 11;
+            format[1] = 0x24;
+            format[2] = format_subtype;
+            format[3] = format_index;
+            format[4] = num_frames;
+            format[5] = 0x01; // bmFlags
+            format[6] = group.default_frame_index; // bDefaultFrameIndex
+        } else if (cat == UvcFormatCategory::FrameBased) {
+            format_subtype = VS_DESC_FORMAT_FRAME_BASED;
+            frame_subtype = VS_DESC_FRAME_FRAME_BASED;
+            // Frame-Based Format: 28 bytes（UVC 1.5 Frame-Based Payload Table 3-1）
+            format.resize(28, 0);
+            format[0] = 28;
+            format[1] = 0x24;
+            format[2] = format_subtype;
+            format[3] = format_index;
+            format[4] = num_frames;
+            std::memcpy(&format[5], guid.data, 16);
+            format[21] = bpp;
+            format[22] = group.default_frame_index;
+            format[23] = 0x00;
+            format[24] = 0x00;
+            format[27] = 0x01; // bVariableSize
+        } else { // H264
+            format_subtype = VS_DESC_FORMAT_H264;
+            frame_subtype = VS_DESC_FRAME_H264;
+            // H.264 Format: 52 bytes（UVC 1.5 H.264 Payload Table 3-1）
+            format.resize(52, 0);
+            format[0] = 52;
+            format[1] = 0x24;
+            format[2] = format_subtype;
+            format[3] = format_index;
+            format[4] = num_frames;
+            format[5] = group.default_frame_index; // bDefaultFrameIndex
+            std::memcpy(&format[21], guid.data, 16);
+            format[37] = bpp;
+            format[38] = 0x01;
+            format[39] = 0x01;
+        }
+        d.insert(d.end(), format.begin(), format.end());
+
+        for (std::size_t i = 0; i < group.frames.size(); ++i) {
+            auto &fmt = group.frames[i];
+            // Frame descriptor（Uncompressed/MJPEG/FrameBased: 26基础; H264: 44基础）
+            // + 连续 12 字节 min/max/step，或离散 4 字节 × 间隔个数
+            auto fps_val = 10'000'000ULL / fmt.default_frame_interval;
+            auto bit_rate = static_cast<std::uint32_t>(fmt.max_frame_size * 8 * fps_val);
+            auto &discrete = fmt.frame_intervals;
+
+            auto frame_base = (cat == UvcFormatCategory::H264) ? VS_FRM_H264_BASE_LEN : 26u;
+            auto frame_len = frame_base + (discrete.empty() ? 12 : 4 * static_cast<std::uint32_t>(discrete.size()));
+            data_type frame(frame_len, 0);
+            frame[0] = static_cast<std::uint8_t>(frame_len);
+            frame[1] = 0x24;
+            frame[2] = frame_subtype;
+            frame[3] = static_cast<std::uint8_t>(i + 1); // bFrameIndex
+            frame[4] = 0x00; // bmCapabilities
+            frame[5] = static_cast<std::uint8_t>(fmt.width & 0xFF);
+            frame[6] = static_cast<std::uint8_t>((fmt.width >> 8) & 0xFF);
+            frame[7] = static_cast<std::uint8_t>(fmt.height & 0xFF);
+            frame[8] = static_cast<std::uint8_t>((fmt.height >> 8) & 0xFF);
+            for (int b = 0; b < 4; ++b) {
+                frame[9 + b] = static_cast<std::uint8_t>((bit_rate >> (b * 8)) & 0xFF);
+                frame[13 + b] = static_cast<std::uint8_t>((bit_rate >> (b * 8)) & 0xFF);
+            }
+            frame[17] = static_cast<std::uint8_t>(fmt.max_frame_size & 0xFF);
+            frame[18] = static_cast<std::uint8_t>((fmt.max_frame_size >> 8) & 0xFF);
+            frame[19] = static_cast<std::uint8_t>((fmt.max_frame_size >> 16) & 0xFF);
+            frame[20] = static_cast<std::uint8_t>((fmt.max_frame_size >> 24) & 0xFF);
+            frame[21] = static_cast<std::uint8_t>(fmt.default_frame_interval & 0xFF);
+            frame[22] = static_cast<std::uint8_t>((fmt.default_frame_interval >> 8) & 0xFF);
+            frame[23] = static_cast<std::uint8_t>((fmt.default_frame_interval >> 16) & 0xFF);
+            frame[24] = static_cast<std::uint8_t>((fmt.default_frame_interval >> 24) & 0xFF);
+            if (discrete.empty()) {
+                frame[25] = 0x00; // bFrameIntervalType = 0 (continuous)
+                // usbvideo.sys!DumpAndValidateFrameUncompressed 对连续帧间隔有三项整除检查：
+                //   if (step != 0) {
+                //       if (max <= min)                → STATUS_INVALID_PARAMETER
+                //       if ((max - min) % step != 0)   → STATUS_INVALID_PARAMETER
+                //   }
+                // 因此 max 必须是 min + N*step（N 为正整数），否则 Windows 直接 Code 10。
+                // min/max/step 均取自 VideoSource，step=min 保证 (max-min) 是 min 的整数倍。
+                auto min_iv = fmt.min_frame_interval;
+                auto max_iv = fmt.max_frame_interval;
+                auto step_iv = min_iv;
+                for (int b = 0; b < 4; ++b)
+                    frame[frame_base + b] = static_cast<std::uint8_t>((min_iv >> (b * 8)) & 0xFF);
+                for (int b = 0; b < 4; ++b)
+                    frame[frame_base + 4 + b] = static_cast<std::uint8_t>((max_iv >> (b * 8)) & 0xFF);
+                for (int b = 0; b < 4; ++b)
+                    frame[frame_base + 8 + b] = static_cast<std::uint8_t>((step_iv >> (b * 8)) & 0xFF);
+            }
+            else {
+                frame[25] = static_cast<std::uint8_t>(discrete.size()); // bFrameIntervalType = 离散个数
+                for (std::size_t n = 0; n < discrete.size(); ++n)
+                    for (int b = 0; b < 4; ++b)
+                        frame[frame_base + n * 4 + b] = static_cast<std::uint8_t>((discrete[n] >> (b * 8)) & 0xFF);
+            }
+            d.insert(d.end(), frame.begin(), frame.end());
+        }
+
+        // Color Matching: Uncompressed 和 MJPEG 强制（各自 payload spec §3），跟在该格式的 Frame 描述符之后
+        if (cat == UvcFormatCategory::Uncompressed || cat == UvcFormatCategory::Mjpeg) {
+            VsColorMatchingDesc{VS_COLOR_MATCHING_LEN, CS_INTERFACE, VS_DESC_COLORFORMAT,
+                                VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709, VIDEO_COLOR_COEF_SMPTE170M}
+                    .append_to(d);
+        }
+    }
 
     // 回填 VS Input Header 的 wTotalLength（offset 4-5）为描述符实际总长
     d[4] = static_cast<std::uint8_t>(d.size() & 0xFF);
@@ -626,6 +730,69 @@ void UvcVideoStreamingHandler::build_class_descriptor() {
     class_desc_ = std::move(d);
 }
 
+const VideoFormatInfo *UvcVideoStreamingHandler::find_frame(std::uint8_t format_index,
+                                                           std::uint8_t frame_index) const {
+    if (format_index == 0 || format_index > formats_.size())
+        return nullptr;
+    auto &frames = formats_[format_index - 1].frames;
+    if (frame_index == 0 || frame_index > frames.size())
+        return nullptr;
+    return &frames[frame_index - 1];
+}
+
+std::uint32_t UvcVideoStreamingHandler::nearest_frame_interval(const VideoFormatInfo &frame,
+                                                               std::uint32_t requested) {
+    if (requested == 0)
+        return frame.default_frame_interval;
+    auto &discrete = frame.frame_intervals;
+    if (!discrete.empty()) {
+        return *std::min_element(discrete.begin(), discrete.end(), [&](std::uint32_t a, std::uint32_t b) {
+            auto da = a > requested ? a - requested : requested - a;
+            auto db = b > requested ? b - requested : requested - b;
+            return da < db;
+        });
+    }
+    // 连续范围：夹到 [min, max] 后对齐到 min + k*step（step = min），与描述符一致
+    auto min_iv = frame.min_frame_interval;
+    auto max_iv = std::max(frame.max_frame_interval, min_iv);
+    auto clamped = std::clamp(requested, min_iv, max_iv);
+    if (min_iv == 0)
+        return clamped;
+    auto k = (clamped - min_iv + min_iv / 2) / min_iv;
+    return std::min(min_iv + k * min_iv, max_iv);
+}
+
+void UvcVideoStreamingHandler::normalize_control(UvcStreamingControl &ctrl) const {
+    // 索引越界（含未设置的 0）：格式退回默认格式，帧退回该格式的默认帧
+    if (ctrl.bFormatIndex == 0 || ctrl.bFormatIndex > formats_.size())
+        ctrl.bFormatIndex = default_format_index_;
+    auto &group = formats_[ctrl.bFormatIndex - 1];
+    if (ctrl.bFrameIndex == 0 || ctrl.bFrameIndex > group.frames.size())
+        ctrl.bFrameIndex = group.default_frame_index;
+    auto &frame = group.frames[ctrl.bFrameIndex - 1];
+    ctrl.dwFrameInterval = nearest_frame_interval(frame, ctrl.dwFrameInterval);
+    // UVC 1.5 §4.3.1.1 offset 18: 由设备按选中的帧设置
+    ctrl.dwMaxVideoFrameSize = frame.max_frame_size;
+    // UVC 1.5 §4.3.1.1 Table 4-75: 设备能力字段，host 不可修改
+    ctrl.bmFramingInfo = 0x03;          // offset 30: FID+EOF
+    ctrl.bPreferredVersion = 1;          // offset 31
+    ctrl.bMinVersion = 1;                // offset 32
+    ctrl.bMaxVersion = 1;                // offset 33
+    ctrl.dwClockFrequency = 27000000;    // offset 26: 27MHz
+    // UVC 1.5 Table 4-75 offset 34–47: 时域编码字段仅 H.264 有效，其余清零
+    if (uvc_format_category(group.fourcc) != UvcFormatCategory::H264) {
+        ctrl.bUsage = 0;
+        ctrl.bBitDepthLuma = 0;
+        ctrl.bmSettings = 0;
+        ctrl.bMaxNumberOfRefFramesPlus1 = 0;
+        ctrl.bmRateControlModes = 0;
+        ctrl.bmLayoutPerStream = 0;
+    }
+    // UVC 1.5 §4.3.1.1 offset 22: payload 长度由设备决定。
+    // 批量：主机按它判断 payload 边界，必须与实际发送一致；等时：主机选每服务周期字节数不小于它的最小 alt
+    ctrl.dwMaxPayloadTransferSize = device_payload_size(frame, ctrl.dwFrameInterval);
+}
+
 data_type UvcVideoStreamingHandler::get_class_specific_descriptor() {
     return class_desc_;
 }
@@ -690,27 +857,33 @@ void UvcVideoStreamingHandler::handle_non_standard_request_type_control_urb(
         return;
     }
 
+    // 描述符在 on_setup_interface_handlers 中生成，之前没有可协商的格式
+    if (formats_.empty()) {
+        session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_epipe_without_data(seqnum, 0));
+        return;
+    }
+
     bool is_commit = (ctrl_code == VS_COMMIT_CONTROL);
 
     if (request == GET_CUR || request == GET_MIN || request == GET_MAX || request == GET_DEF) {
-        auto fmt = source_->current_format();
-        auto max_frame_size = static_cast<std::uint32_t>(source_->max_frame_size());
-        auto ctrl = probe_data_;
-        // UVC 1.5 §4.3.1.1 Table 4-75: 以下字段为设备能力，host 不可修改
-        ctrl.bmFramingInfo = 0x03; // D0: FID 必须, D1: EOF 可选
-        ctrl.bPreferredVersion = 1; // 首选 payload 格式版本（UVC 1.5 offset 31）
-        ctrl.bMinVersion = 1;       // 最小支持版本（offset 32）
-        ctrl.bMaxVersion = 1;       // 最大支持版本（offset 33）
-        ctrl.dwClockFrequency = 27000000; // 27MHz, offset 26
+        // GET_CUR/MIN/MAX 针对当前选中的帧（COMMIT 选择子取已提交的值），未协商过时为默认帧
+        auto ctrl = is_commit ? commit_data_ : probe_data_;
+        if (request == GET_DEF) {
+            ctrl.bFormatIndex = default_format_index_;
+            ctrl.bFrameIndex = formats_[default_format_index_ - 1].default_frame_index;
+            ctrl.dwFrameInterval = 0;
+        }
+        normalize_control(ctrl);
+        auto &frame = *find_frame(ctrl.bFormatIndex, ctrl.bFrameIndex);
+        auto max_frame_size = frame.max_frame_size;
         // 不压缩视频：压缩相关字段必须为 0，否则与 VS Input Header bmaControls=0 矛盾
         ctrl.wKeyFrameRate = 0;
         ctrl.wPFrameRate = 0;
         ctrl.wCompQuality = 0;
         ctrl.wCompWindowSize = 0;
         ctrl.wDelay = 0;
-        auto interval = fmt.default_frame_interval;
-        auto min_iv = fmt.min_frame_interval;
-        auto max_iv = fmt.max_frame_interval;
+        auto min_iv = frame.frame_intervals.empty() ? frame.min_frame_interval : frame.frame_intervals.front();
+        auto max_iv = frame.frame_intervals.empty() ? frame.max_frame_interval : frame.frame_intervals.back();
         // UVC 1.5 Table 4-76: GET_MIN 返回各协商字段的最小值
         if (request == GET_MIN) {
             // 非零避免 host 误判为"字段未设置"触发 fix-up（libuvc stream.c:273）
@@ -720,23 +893,10 @@ void UvcVideoStreamingHandler::handle_non_standard_request_type_control_urb(
             ctrl.dwFrameInterval = max_iv; // 最长帧间隔 = 最低数据速率
         } else if (request == GET_MAX) {
             ctrl.dwMaxVideoFrameSize = max_frame_size;
-            ctrl.dwMaxPayloadTransferSize = max_frame_size;
+            ctrl.dwMaxPayloadTransferSize = bulk_mode_ ? bulk_payload_size_ : max_iso_capacity();
             ctrl.dwFrameInterval = min_iv; // 最短帧间隔 = 最高帧率
-        } else if (request == GET_DEF) {
-            ctrl.bFormatIndex = 1;
-            ctrl.bFrameIndex = 1;
-            ctrl.dwFrameInterval = interval;
-            ctrl.dwMaxVideoFrameSize = max_frame_size;
-            // UVC 1.5 §4.3.1.1 Table 4-75 offset 22: 设备设定，host 只读，必须支持。
-            // 取 ISO 端点 wMaxPacketSize（512），不对齐 max_frame_size
-            ctrl.dwMaxPayloadTransferSize = 512;
-        } else {
-            // GET_CUR: 用上次协商的值，未协商过时用默认值
-            if (ctrl.dwMaxVideoFrameSize == 0)
-                ctrl.dwMaxVideoFrameSize = max_frame_size;
-            if (ctrl.dwFrameInterval == 0)
-                ctrl.dwFrameInterval = interval;
         }
+        // GET_DEF / GET_CUR 的 dwMaxPayloadTransferSize 已由 normalize_control 按选中的帧与帧间隔算出
         auto resp = ctrl.serialize();
         auto act_len = std::min(resp.size(), static_cast<std::size_t>(transfer_buffer_length));
         trx->data.assign(resp.begin(), resp.begin() + act_len);
@@ -763,52 +923,35 @@ void UvcVideoStreamingHandler::handle_non_standard_request_type_control_urb(
     else if (request == SET_CUR && !is_commit) {
         if (trx->data.size() >= 26) {
             probe_data_.deserialize(trx->data.data(), trx->data.size());
-            // UVC 1.5 §4.3.1.1 Table 4-75: 设备能力字段，host 不可修改
-            probe_data_.bmFramingInfo = 0x03;          // offset 30: FID+EOF
-            probe_data_.bPreferredVersion = 1;          // offset 31
-            probe_data_.bMinVersion = 1;                // offset 32
-            probe_data_.bMaxVersion = 1;                // offset 33
-            probe_data_.dwClockFrequency = 27000000;    // offset 26: 27MHz
-            // UVC 1.5 Table 4-75 offset 34–47: 时域编码字段仅 H.264 有效，其余清零
-            if (uvc_format_category(source_->current_format().fourcc) != UvcFormatCategory::H264) {
-                probe_data_.bUsage = 0;
-                probe_data_.bBitDepthLuma = 0;
-                probe_data_.bmSettings = 0;
-                probe_data_.bMaxNumberOfRefFramesPlus1 = 0;
-                probe_data_.bmRateControlModes = 0;
-                probe_data_.bmLayoutPerStream = 0;
-            }
+            // 索引 / 帧间隔规整到描述符里声明过的值，主机随后 GET_CUR 读回协商结果
+            normalize_control(probe_data_);
         }
         session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_with_status_and_no_data(
                 seqnum, static_cast<std::uint32_t>(UrbStatusType::StatusOK), transfer_buffer_length));
     }
     else if (request == SET_CUR && is_commit) {
-        if (trx->data.size() >= 26) {
-            probe_data_.deserialize(trx->data.data(), trx->data.size());
-            // UVC 1.5 §4.3.1.1 Table 4-75: 同 PROBE SET_CUR，写入设备状态
-            probe_data_.bmFramingInfo = 0x03;
-            probe_data_.bPreferredVersion = 1;
-            probe_data_.bMinVersion = 1;
-            probe_data_.bMaxVersion = 1;
-            probe_data_.dwClockFrequency = 27000000;
-            if (uvc_format_category(source_->current_format().fourcc) != UvcFormatCategory::H264) {
-                probe_data_.bUsage = 0;
-                probe_data_.bBitDepthLuma = 0;
-                probe_data_.bmSettings = 0;
-                probe_data_.bMaxNumberOfRefFramesPlus1 = 0;
-                probe_data_.bmRateControlModes = 0;
-                probe_data_.bmLayoutPerStream = 0;
-            }
+        auto ctrl = probe_data_;
+        if (trx->data.size() >= 26)
+            ctrl.deserialize(trx->data.data(), trx->data.size());
+        normalize_control(ctrl);
+        auto &group = formats_[ctrl.bFormatIndex - 1];
+        auto &frame = group.frames[ctrl.bFrameIndex - 1];
+        if (!source_->set_format(group.fourcc, frame.width, frame.height, ctrl.dwFrameInterval)) {
+            SPDLOG_WARN("UVC COMMIT: 视频源拒绝格式 {} / 帧 {}（{}x{}，帧间隔 {}）", ctrl.bFormatIndex,
+                        ctrl.bFrameIndex, frame.width, frame.height, ctrl.dwFrameInterval);
+            session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_epipe_without_data(seqnum, 0));
+            return;
         }
-        auto fmt = source_->current_format();
-        source_->set_format(fmt.fourcc, fmt.width, fmt.height, probe_data_.dwFrameInterval);
+        // 提交值同时作为 PROBE 的当前值，流推送只读 commit_data_
+        commit_data_ = ctrl;
+        probe_data_ = ctrl;
         committed_ = true;
-        frame_buffer_.resize(source_->max_frame_size());
-        frame_offset_ = 0;
-        current_fid_ = false;
         // 重新开播：帧时钟重置，set_format 后帧间隔可能已变
-        frame_started_at_ = {};
+        reset_stream_state();
         frame_interval_ = std::chrono::microseconds(source_->frame_interval() / 10);
+        // 批量端点没有 alt setting 可切：UVC 1.5 §2.4.3.2 规定 COMMIT 即开流
+        if (bulk_mode_)
+            streaming_ = true;
         session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_with_status_and_no_data(
                 seqnum, static_cast<std::uint32_t>(UrbStatusType::StatusOK), transfer_buffer_length));
     }
@@ -827,8 +970,7 @@ void UvcVideoStreamingHandler::handle_isochronous_transfer(std::uint32_t seqnum,
         return;
     }
 
-    auto *trx = GenericTransfer::from_handle(transfer.get());
-    auto &data = trx->data;
+    auto *trx = UvcPayloadTransfer::from_handle(transfer.get());
     auto &iso_descs = trx->iso_descriptors;
 
     // 内核 usb_submit_urb 会把 iso_frame_desc[n].status 初始化为 -EXDEV，
@@ -846,27 +988,22 @@ void UvcVideoStreamingHandler::handle_isochronous_transfer(std::uint32_t seqnum,
     // 响应不会失控。
     // 帧传不完帧间隔（主机消费慢）时：不切帧，完整传完当前帧再拉下一帧
     // （半截帧会被主机驱动标记 corrupted 整帧丢弃，宁慢勿碎）
-    const auto now = std::chrono::steady_clock::now();
-    if (frame_interval_.count() > 0 && frame_offset_ == 0 && now < frame_started_at_ + frame_interval_) {
-        session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit(
-                seqnum, static_cast<std::uint32_t>(UrbStatusType::StatusOK), 0, 0,
-                static_cast<std::uint32_t>(iso_descs.size()), std::move(transfer)));
-        return;
-    }
-
     if (frame_offset_ == 0) {
-        VideoFrame vf{};
-        if (!source_->get_frame(vf)) {
+        auto fetched = fetch_next_frame(std::chrono::steady_clock::now());
+        if (fetched == FrameFetch::Idle) {
+            session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit(
+                    seqnum, static_cast<std::uint32_t>(UrbStatusType::StatusOK), 0, 0,
+                    static_cast<std::uint32_t>(iso_descs.size()), std::move(transfer)));
+            return;
+        }
+        if (fetched == FrameFetch::Error) {
             session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_epipe_without_data(seqnum, 0));
             return;
         }
-        frame_buffer_.assign(vf.data, vf.data + vf.size);
-        current_fid_ = !current_fid_;
-        frame_started_at_ = now;
     }
 
     std::uint32_t total_sent = 0;
-    std::size_t frame_remaining = frame_buffer_.size() - frame_offset_;
+    std::size_t frame_remaining = frame_.size - frame_offset_;
 
     for (int i = 0; i < num_iso_packets && frame_remaining > 0; ++i) {
         auto &iso = iso_descs[i];
@@ -880,13 +1017,15 @@ void UvcVideoStreamingHandler::handle_isochronous_transfer(std::uint32_t seqnum,
         std::uint8_t header_info = current_fid_ ? UVC_PAYLOAD_HEADER_FID : 0;
         // EOF 位（D7）按 UVC 1.5 Table 2-5 规范位发：Windows usbvideo.sys 据此切帧。
         // Linux uvcvideo 用自定义位（EOF=0x40）解释不到，但缓冲满强制切帧兜底，行为不变
-        if (frame_offset_ + chunk >= frame_buffer_.size())
+        if (frame_offset_ + chunk >= frame_.size)
             header_info |= UVC_PAYLOAD_HEADER_EOF; // EOF
 
-        auto *dst = &data[iso.offset];
-        dst[0] = UVC_PAYLOAD_HEADER_SIZE;
-        dst[1] = header_info;
-        std::memcpy(dst + UVC_PAYLOAD_HEADER_SIZE, frame_buffer_.data() + frame_offset_, chunk);
+        // 头写进 transfer 自己的头区，帧数据只登记切片，由 sender 线程直接从帧内存 gather write
+        auto *header = &trx->headers[static_cast<std::size_t>(i) * UVC_PAYLOAD_HEADER_SIZE];
+        header[0] = UVC_PAYLOAD_HEADER_SIZE;
+        header[1] = header_info;
+        trx->buffers.emplace_back(header, UVC_PAYLOAD_HEADER_SIZE);
+        trx->buffers.emplace_back(frame_.data + frame_offset_, chunk);
 
         iso.actual_length = static_cast<std::uint32_t>(UVC_PAYLOAD_HEADER_SIZE + chunk);
         total_sent += iso.actual_length;
@@ -894,8 +1033,10 @@ void UvcVideoStreamingHandler::handle_isochronous_transfer(std::uint32_t seqnum,
         frame_remaining -= chunk;
     }
 
-    if (frame_offset_ >= frame_buffer_.size())
+    if (frame_offset_ >= frame_.size)
         frame_offset_ = 0;
+    trx->actual_length = total_sent;
+    finish_payload_transfer(*trx);
 
     // 立即响应（不走 TransferScheduler 的 125µs×包 等时节流）：虚拟设备
     // 没有真实总线，主机拉多快数据就传多快——大帧在帧间隔内传得完才能
@@ -905,32 +1046,173 @@ void UvcVideoStreamingHandler::handle_isochronous_transfer(std::uint32_t seqnum,
             static_cast<std::uint32_t>(iso_descs.size()), std::move(transfer)));
 }
 
+void UvcVideoStreamingHandler::handle_bulk_transfer(std::uint32_t seqnum, const UsbEndpoint &ep,
+                                                    std::uint32_t transfer_flags, std::uint32_t transfer_buffer_length,
+                                                    TransferHandle transfer, std::error_code &ec) {
+    if (!bulk_mode_ || !ep.is_in() || !streaming_ || !committed_) {
+        session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_epipe_without_data(seqnum, 0));
+        return;
+    }
+
+    auto *trx = UvcPayloadTransfer::from_handle(transfer.get());
+
+    // 上一个 payload 恰好填满上一个 URB 且短于 dwMaxPayloadTransferSize：
+    // 主机还在等后续字节，用零长度包结束它
+    if (zlp_pending_) {
+        zlp_pending_ = false;
+        trx->actual_length = 0;
+        session->submit_ret_submit(
+                UsbIpResponse::UsbIpRetSubmit::create_ret_submit_ok_with_no_iso(seqnum, 0, std::move(transfer)));
+        return;
+    }
+
+    if (payload_length_ == 0) {
+        // 帧时钟语义与等时模式相同：未到帧间隔回零长度包，主机驱动丢弃空 payload 后重新提交
+        if (frame_offset_ == 0) {
+            auto fetched = fetch_next_frame(std::chrono::steady_clock::now());
+            if (fetched == FrameFetch::Idle) {
+                trx->actual_length = 0;
+                session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_ok_with_no_iso(
+                        seqnum, 0, std::move(transfer)));
+                return;
+            }
+            if (fetched == FrameFetch::Error) {
+                session->submit_ret_submit(
+                        UsbIpResponse::UsbIpRetSubmit::create_ret_submit_epipe_without_data(seqnum, 0));
+                return;
+            }
+        }
+        // 开始新 payload：头 + 帧的下一段，最后一段带 EOF
+        auto max_payload = std::max<std::size_t>(commit_data_.dwMaxPayloadTransferSize, UVC_PAYLOAD_HEADER_SIZE + 1);
+        auto chunk = std::min(max_payload - UVC_PAYLOAD_HEADER_SIZE, frame_.size - frame_offset_);
+        payload_length_ = UVC_PAYLOAD_HEADER_SIZE + chunk;
+        payload_sent_ = 0;
+        payload_frame_offset_ = frame_offset_;
+        payload_header_info_ = current_fid_ ? UVC_PAYLOAD_HEADER_FID : 0;
+        frame_offset_ += chunk;
+        if (frame_offset_ >= frame_.size) {
+            payload_header_info_ |= UVC_PAYLOAD_HEADER_EOF;
+            frame_offset_ = 0;
+        }
+    }
+
+    // 一个 URB 只装当前 payload 的字节，不与下一个 payload 拼接
+    auto n = std::min<std::size_t>(transfer_buffer_length, payload_length_ - payload_sent_);
+    auto *header = trx->headers.data();
+    std::size_t pos = 0;
+    // 头按 payload 内偏移逐字节写，URB 再小也不会把头拆错
+    for (; pos < n && payload_sent_ < UVC_PAYLOAD_HEADER_SIZE; ++pos, ++payload_sent_)
+        header[pos] = payload_sent_ == 0 ? UVC_PAYLOAD_HEADER_SIZE : payload_header_info_;
+    if (pos > 0)
+        trx->buffers.emplace_back(header, pos);
+    if (pos < n) {
+        trx->buffers.emplace_back(frame_.data + payload_frame_offset_ + (payload_sent_ - UVC_PAYLOAD_HEADER_SIZE),
+                                  n - pos);
+        payload_sent_ += n - pos;
+    }
+    if (payload_sent_ == payload_length_) {
+        // URB 短于请求长度主机即知 payload 结束；填满了 URB 又没到上限才需要补零长度包
+        zlp_pending_ = n == transfer_buffer_length && payload_length_ < commit_data_.dwMaxPayloadTransferSize;
+        payload_length_ = 0;
+    }
+
+    trx->actual_length = n;
+    finish_payload_transfer(*trx);
+    session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_ok_with_no_iso(
+            seqnum, static_cast<std::uint32_t>(n), std::move(transfer)));
+}
+
+void UvcVideoStreamingHandler::finish_payload_transfer(UvcPayloadTransfer &trx) {
+    if (trx.buffers.empty())
+        return;
+    if (gather_send_) {
+        // 帧切片引用着帧内存：随 transfer 持有帧的 owner，发完 free 时释放
+        trx.keepalive = frame_.owner;
+        gathered_bytes_.fetch_add(trx.actual_length, std::memory_order_relaxed);
+    }
+    else {
+        payload_copy_bytes_.fetch_add(trx.flatten(), std::memory_order_relaxed);
+    }
+}
+
+UvcVideoStreamingHandler::FrameFetch UvcVideoStreamingHandler::fetch_next_frame(
+        std::chrono::steady_clock::time_point now) {
+    if (frame_interval_.count() > 0 && now < frame_started_at_ + frame_interval_)
+        return FrameFetch::Idle;
+    VideoFrame vf{};
+    if (!source_->get_frame(vf))
+        return FrameFetch::Error;
+    // 源还没有新帧：这次不发，帧时钟不动，下个 URB 再取
+    if (vf.size == 0)
+        return FrameFetch::Idle;
+    if (vf.owner) {
+        // 源交出了只读的引用计数缓冲：直接持有到最后一个 payload 发完，换帧时旧帧自动还给源
+        frame_ = std::move(vf);
+    }
+    else {
+        // 旧接口：data 只在下次 get_frame 前有效，拷进池化缓冲。
+        // 还在 sender 队列里的 URB 引用着上一帧，不能原地覆盖
+        if (!copy_pool_)
+            copy_pool_ = VideoFramePool::create(std::max(vf.size, source_->max_frame_size()));
+        else if (copy_pool_->buffer_size() < vf.size)
+            copy_pool_->set_buffer_size(vf.size);
+        auto buffer = copy_pool_->acquire();
+        std::memcpy(buffer->data(), vf.data, vf.size);
+        buffer->set_size(vf.size);
+        frame_ = make_video_frame(std::move(buffer), vf.is_keyframe);
+        frame_copy_bytes_.fetch_add(vf.size, std::memory_order_relaxed);
+    }
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    frame_bytes_.fetch_add(frame_.size, std::memory_order_relaxed);
+    current_fid_ = !current_fid_;
+    frame_started_at_ = now;
+    return FrameFetch::Ready;
+}
+
+void UvcVideoStreamingHandler::reset_stream_state() {
+    frame_offset_ = 0;
+    current_fid_ = false;
+    payload_length_ = 0;
+    payload_sent_ = 0;
+    zlp_pending_ = false;
+    frame_ = {}; // 放掉没发完的帧，缓冲尽早回到源的池里
+    frame_started_at_ = {}; // 帧时钟重置：开播后首帧立即开始
+}
+
+UvcVideoStreamingHandler::StreamStats UvcVideoStreamingHandler::stream_stats() const {
+    return {frames_.load(std::memory_order_relaxed), frame_bytes_.load(std::memory_order_relaxed),
+            frame_copy_bytes_.load(std::memory_order_relaxed), gathered_bytes_.load(std::memory_order_relaxed),
+            payload_copy_bytes_.load(std::memory_order_relaxed)};
+}
+
 void UvcVideoStreamingHandler::on_new_connection(Session &current_session, error_code &ec) {
     VirtualInterfaceHandler::on_new_connection(current_session, ec);
     committed_ = false;
     streaming_ = false;
-    frame_offset_ = 0;
-    current_fid_ = false;
-    frame_started_at_ = {}; // 帧时钟重置：重连开播后首帧立即开始
+    alt_setting_ = 0;
+    reset_stream_state();
 }
 
 void UvcVideoStreamingHandler::on_disconnection(error_code &ec) {
     streaming_ = false;
     committed_ = false;
-    frame_started_at_ = {};
+    alt_setting_ = 0;
+    reset_stream_state();
     VirtualInterfaceHandler::on_disconnection(ec);
 }
 
 void UvcVideoStreamingHandler::request_set_interface(std::uint16_t alternate_setting, std::uint32_t *p_status) {
     if (alternate_setting == 0) {
         streaming_ = false;
+        alt_setting_ = 0;
         *p_status = 0;
     }
-    else if (alternate_setting == 1) {
+    else if (!bulk_mode_ && alternate_setting < iso_alt_capacity_.size() && iso_alt_capacity_[alternate_setting] != 0) {
+        // 任一带宽档位都可开流：包长由主机按所选 alt 的 wMaxPacketSize 给出，payload 按包长切
+        alt_setting_ = static_cast<std::uint8_t>(alternate_setting);
         if (committed_) {
             streaming_ = true;
-            frame_offset_ = 0;
-            current_fid_ = false;
+            reset_stream_state();
         }
         *p_status = 0;
     }
@@ -940,7 +1222,7 @@ void UvcVideoStreamingHandler::request_set_interface(std::uint16_t alternate_set
 }
 
 std::uint8_t UvcVideoStreamingHandler::request_get_interface(std::uint32_t *p_status) {
-    return streaming_ ? 1 : 0;
+    return bulk_mode_ ? 0 : alt_setting_;
 }
 
 void UvcVideoStreamingHandler::request_set_feature(std::uint16_t feature_selector, std::uint32_t *p_status) {
@@ -955,6 +1237,13 @@ void UvcVideoStreamingHandler::request_clear_feature(std::uint16_t feature_selec
 }
 void UvcVideoStreamingHandler::request_endpoint_clear_feature(std::uint16_t feature_selector, std::uint8_t ep_address,
                                                               std::uint32_t *p_status) {
+    // 批量模式停流：主机对流端点发 CLEAR_FEATURE(ENDPOINT_HALT)（UVC 1.5 §2.4.3.2.4）
+    if (bulk_mode_ && feature_selector == SetupPacket::USB_ENDPOINT_HALT && ep_address == stream_ep_address_ &&
+        streaming_) {
+        SPDLOG_INFO("UVC 批量端点 {:#04x} 清除 HALT，停止视频流", ep_address);
+        streaming_ = false;
+        reset_stream_state();
+    }
     *p_status = 0;
 }
 std::uint16_t UvcVideoStreamingHandler::request_get_status(std::uint32_t *p_status) {
@@ -997,4 +1286,19 @@ void UvcDeviceHelper::setup(std::shared_ptr<UsbDevice> device, StringPool &strin
     dh->setup_interface_handlers();
 }
 
+std::vector<std::vector<UsbEndpoint>> UvcDeviceHelper::iso_alt_settings(
+        std::uint8_t address, const std::vector<std::uint16_t> &max_packet_sizes) {
+    std::vector<std::vector<UsbEndpoint>> alts = {{}}; // alt 0: zero bandwidth
+    for (auto size: max_packet_sizes) {
+        alts.push_back({UsbEndpoint{
+                .address = address,
+                .attributes = static_cast<std::uint8_t>(EndpointAttributes::Isochronous) |
+                              static_cast<std::uint8_t>(IsoSyncType::Async),
+                .max_packet_size = size,
+                .interval = 1,
+        }});
+    }
+    return alts;
+}
+
 } // namespace usbipdcpp
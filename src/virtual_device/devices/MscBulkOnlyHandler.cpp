@@ -23,27 +23,262 @@ static std::string wstr_to_ascii(const std::wstring &ws, const std::string &fall
     return result.empty() ? fallback : result;
 }
 
+/** CD-ROM 与 DVD-ROM 的分界：超过 99 分钟 CD 的最大数据容量即按 DVD 报告 */
+static constexpr std::uint64_t MMC_CD_MAX_BYTES = 900ull * 1024 * 1024;
+
+/** MMC 地址：LBA 或 MSF（00 M S F，含 2 秒 / 150 帧的引导区偏移） */
+static void put_mmc_address(std::uint8_t *p, std::uint32_t lba, bool msf) {
+    if (!msf) {
+        put_be32(p, lba);
+        return;
+    }
+    auto frames = lba + 150;
+    p[0] = 0;
+    p[1] = static_cast<std::uint8_t>(frames / (60 * 75));
+    p[2] = static_cast<std::uint8_t>(frames / 75 % 60);
+    p[3] = static_cast<std::uint8_t>(frames % 75);
+}
+
+/** READ TOC：单会话、单数据轨（轨道 1 从 LBA 0 开始，引出区 0xAA 在介质末尾）。
+ *  支持格式 0（TOC）与 1（会话信息），其余格式或起始轨道越界返回空 */
+static std::vector<std::uint8_t> build_read_toc(const std::uint8_t *cdb, std::uint64_t block_count) {
+    bool msf = (cdb[1] & 0x02) != 0;
+    // 旧式主机把格式放在 byte 9 高两位
+    std::uint8_t format = cdb[2] & 0x0F;
+    if (format == 0)
+        format = cdb[9] >> 6;
+    std::uint8_t start_track = cdb[6];
+    auto leadout = static_cast<std::uint32_t>(std::min<std::uint64_t>(block_count, 0xFFFFFFFF));
+
+    std::vector<std::uint8_t> out(4);
+    out[2] = 1; // 第一轨道 / 第一会话
+    out[3] = 1; // 最后轨道 / 最后会话
+    auto add_descriptor = [&](std::uint8_t track, std::uint32_t lba) {
+        std::uint8_t desc[8]{};
+        desc[1] = 0x14; // ADR=1（Q 子码位置），CONTROL=4（数据轨，不可复制）
+        desc[2] = track;
+        put_mmc_address(desc + 4, lba, msf);
+        out.insert(out.end(), desc, desc + 8);
+    };
+    if (format == 0) {
+        if (start_track > 1 && start_track != 0xAA)
+            return {};
+        if (start_track <= 1)
+            add_descriptor(1, 0);
+        add_descriptor(0xAA, leadout);
+    }
+    else if (format == 1) {
+        // 最后一个完整会话的第一条轨道
+        add_descriptor(1, 0);
+    }
+    else {
+        return {};
+    }
+    put_be16(out.data(), static_cast<std::uint16_t>(out.size() - 2));
+    return out;
+}
+
+/** GET CONFIGURATION：按 RT 与起始特性码返回特性描述符。
+ *  当前 profile 按镜像大小取 CD-ROM (0x0008) 或 DVD-ROM (0x0010) */
+static std::vector<std::uint8_t> build_configuration(const std::uint8_t *cdb, const StorageBackend &backend) {
+    std::uint8_t rt = cdb[1] & 0x03;
+    auto start_feature = get_be16(cdb + 2);
+    bool dvd = backend.block_count() * backend.block_size() > MMC_CD_MAX_BYTES;
+    std::uint16_t profile = dvd ? 0x0010 : 0x0008;
+
+    std::vector<std::uint8_t> out(8);
+    put_be16(out.data() + 6, profile);
+    // flags: bit5-2 版本，bit1 Persistent，bit0 Current
+    auto add_feature = [&](std::uint16_t code, std::uint8_t flags, std::initializer_list<std::uint8_t> data) {
+        if (rt == 2 ? code != start_feature : code < start_feature)
+            return;
+        if (rt == 1 && !(flags & 0x01))
+            return;
+        std::uint8_t head[4];
+        put_be16(head, code);
+        head[2] = flags;
+        head[3] = static_cast<std::uint8_t>(data.size());
+        out.insert(out.end(), head, head + 4);
+        out.insert(out.end(), data.begin(), data.end());
+    };
+    // Profile List：两个 profile 都列出，当前的置 CurrentP
+    add_feature(0x0000, 0x03, {0x00, 0x10, static_cast<std::uint8_t>(dvd ? 0x01 : 0x00), 0x00, //
+                               0x00, 0x08, static_cast<std::uint8_t>(dvd ? 0x00 : 0x01), 0x00});
+    // Core：物理接口 8 = USB，DBE=1
+    add_feature(0x0001, 0x07, {0x00, 0x00, 0x00, 0x08, 0x01, 0x00, 0x00, 0x00});
+    // Removable Medium：托盘式，可弹出、可锁定
+    add_feature(0x0003, 0x03, {0x29, 0x00, 0x00, 0x00});
+    // Random Readable：逻辑块 2048，blocking = CD 1 / DVD 16
+    std::uint8_t rr[8]{};
+    put_be32(rr, backend.block_size());
+    put_be16(rr + 4, dvd ? 16 : 1);
+    add_feature(0x0010, 0x01, {rr[0], rr[1], rr[2], rr[3], rr[4], rr[5], 0x00, 0x00});
+    if (dvd)
+        add_feature(0x001F, 0x01, {});
+    else
+        add_feature(0x001E, 0x09, {0x00, 0x00, 0x00, 0x00}); // CD Read 版本 2
+    put_be32(out.data(), static_cast<std::uint32_t>(out.size() - 4));
+    return out;
+}
+
+/** GET EVENT STATUS NOTIFICATION：只支持轮询模式，只报告介质类事件（介质始终在位、无变化） */
+static std::vector<std::uint8_t> build_event_status(const std::uint8_t *cdb) {
+    constexpr std::uint8_t MEDIA_CLASS = 0x10;
+    std::vector<std::uint8_t> out(4);
+    out[3] = MEDIA_CLASS; // 支持的事件类
+    if (cdb[4] & MEDIA_CLASS) {
+        out[2] = 0x04; // 通知类 = 介质
+        out.insert(out.end(), {0x00, 0x02, 0x00, 0x00}); // NoChg，Media Present
+    }
+    else {
+        out[2] = 0x80; // NEA：请求的类都不支持
+    }
+    put_be16(out.data(), static_cast<std::uint16_t>(out.size() - 2));
+    return out;
+}
+
+static std::vector<MscLun> single_lun(std::unique_ptr<StorageBackend> backend, MscConfig config, bool read_only) {
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::move(backend), std::move(config), read_only});
+    return luns;
+}
+
 MscBulkOnlyHandler::MscBulkOnlyHandler(UsbInterface &handle_interface, StringPool &string_pool,
                                        std::unique_ptr<StorageBackend> backend, MscConfig config, bool read_only) :
-    VirtualInterfaceHandler(handle_interface, string_pool, std::make_unique<StorageTransferOperator>(this)),
-    backend_(std::move(backend)), read_only_(read_only), config_(std::move(config)) {
+    MscBulkOnlyHandler(handle_interface, string_pool, single_lun(std::move(backend), std::move(config), read_only)) {
+}
+
+MscBulkOnlyHandler::MscBulkOnlyHandler(UsbInterface &handle_interface, StringPool &string_pool,
+                                       std::vector<MscLun> luns) :
+    VirtualInterfaceHandler(handle_interface, string_pool, std::make_unique<StorageTransferOperator>(this)) {
+    if (luns.empty()) {
+        SPDLOG_ERROR("MSC 至少需要一个 LUN");
+    }
+    if (luns.size() > MSC_MAX_LUNS) {
+        SPDLOG_ERROR("MSC 最多 {} 个 LUN，多出的 {} 个被忽略", MSC_MAX_LUNS, luns.size() - MSC_MAX_LUNS);
+        luns.resize(MSC_MAX_LUNS);
+    }
+    luns_.reserve(luns.size());
+    for (auto &lun: luns) {
+        // 光驱与只读后端（如共享映射的镜像）一律只读，WRITE 不会取到只读映射区的指针
+        bool read_only = lun.read_only || lun.config.device_type == MscDeviceType::CdRom ||
+                         (lun.backend && lun.backend->is_read_only());
+        if (read_only && !lun.read_only)
+            SPDLOG_INFO("LUN {} 按只读挂载", luns_.size());
+        luns_.push_back(LogicalUnit{std::move(lun.backend), std::move(lun.config), read_only, 0, 0, {}});
+        luns_.back().readahead = ReadaheadDetector(luns_.back().config.readahead);
+    }
+}
+
+ZeroCopyStats MscBulkOnlyHandler::zero_copy_stats() {
+    return static_cast<StorageTransferOperator *>(get_transfer_operator())->zero_copy_stats();
+}
+
+void MscBulkOnlyHandler::begin_command(std::uint8_t opcode, std::chrono::steady_clock::time_point start) {
+    cmd_tracked_ = true;
+    cmd_opcode_ = opcode;
+    cmd_start_ = start;
+    phase_start_ = start;
+    cmd_backend_ = {};
+    phase_backend_mark_ = {};
+    cmd_backend_called_ = false;
+    cmd_bytes_in_ = 0;
+    cmd_bytes_out_ = 0;
+}
+
+void MscBulkOnlyHandler::end_phase(MscPhase phase) {
+    if (!cmd_tracked_)
+        return;
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = now - phase_start_ - (cmd_backend_ - phase_backend_mark_);
+    stats_.record_phase(cmd_opcode_, phase, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+    phase_start_ = now;
+    phase_backend_mark_ = cmd_backend_;
+}
+
+void MscBulkOnlyHandler::finish_command(bool failed) {
+    if (!cmd_tracked_)
+        return;
+    end_phase(MscPhase::Csw);
+    if (cmd_backend_called_)
+        stats_.record_phase(cmd_opcode_, MscPhase::BackendIo, cmd_backend_);
+    stats_.record_phase(cmd_opcode_, MscPhase::Total, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                              phase_start_ - cmd_start_));
+    stats_.record_command(cmd_opcode_, failed, cmd_bytes_in_, cmd_bytes_out_);
+    cmd_tracked_ = false;
+}
+
+MscBulkOnlyHandler::VerifyResult MscBulkOnlyHandler::verify_medium(StorageBackend &backend, std::uint64_t lba,
+                                                                   std::uint16_t count, const std::uint8_t *expected,
+                                                                   bool same_block) {
+    auto bs = backend.block_size();
+    // memcmp 由 libc 按 SSE2 / AVX2 / NEON 向量化，一次比较一整段比逐字节循环快一个数量级
+    auto compare = [&](const std::uint8_t *medium, std::uint64_t first, std::uint16_t n) {
+        for (std::uint16_t i = 0; i < n; i = same_block ? i + 1 : n) {
+            auto *want = same_block ? expected : expected + (first - lba) * bs;
+            auto len = static_cast<std::size_t>(same_block ? 1 : n) * bs;
+            auto *got = medium + static_cast<std::size_t>(i) * bs;
+            if (std::memcmp(got, want, len) != 0) {
+                // 出错时才逐块定位第一个不一致的 LBA
+                std::uint64_t at = first + i;
+                for (std::size_t b = 0; b * bs < len; ++b) {
+                    if (std::memcmp(got + b * bs, want + b * bs, bs) != 0) {
+                        at = first + i + b;
+                        break;
+                    }
+                }
+                SPDLOG_WARN("VERIFY 数据不一致: LBA={}", at);
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // 映射区直接比较，不拷贝
+    if (auto *mapped = static_cast<const std::uint8_t *>(backend.get_direct_buffer(lba)))
+        return compare(mapped, lba, count) ? VerifyResult::Match : VerifyResult::Miscompare;
+
+    constexpr std::uint16_t step = 256;
+    verify_buffer_.resize(static_cast<std::size_t>(std::min(count, step)) * bs);
+    for (std::uint16_t done = 0; done < count;) {
+        auto n = std::min<std::uint16_t>(step, count - done);
+        if (backend.read(lba + done, n, verify_buffer_.data()) != static_cast<std::size_t>(n) * bs) {
+            SPDLOG_ERROR("VERIFY 读介质失败: LBA={} count={}", lba + done, n);
+            return VerifyResult::ReadError;
+        }
+        if (!compare(verify_buffer_.data(), lba + done, n))
+            return VerifyResult::Miscompare;
+        done += n;
+    }
+    return VerifyResult::Match;
 }
 
 void MscBulkOnlyHandler::on_setup_interface_handlers() {
-    if (config_.vendor.empty())
-        config_.vendor = wstr_to_ascii(device_handler->get_string_manufacturer(), "USBIPDC ");
-    if (config_.product.empty())
-        config_.product = wstr_to_ascii(device_handler->get_string_product(), "USB Flash Drive ");
-    if (config_.serial.empty())
-        config_.serial = wstr_to_ascii(device_handler->get_string_serial(), "USBIPDCPSN");
-    if (config_.revision.empty())
-        config_.revision = "1.00";
-
-    // 容量 > 2^32-1 块（2TB @ 512B）时 READ/WRITE/READ CAPACITY (10) 的 32 位 LBA
-    // 无法寻址。本项目只提供 10 字节 CDB 的读写，超限只能报错提示用户缩容
-    if (backend_ && backend_->block_count() > 0xFFFFFFFFull) {
-        SPDLOG_ERROR("存储容量 {} 块（{} 字节）超过 2TB，10 字节 CDB 无法寻址，请缩小镜像",
-                     backend_->block_count(), backend_->block_count() * backend_->block_size());
+    auto vendor = wstr_to_ascii(device_handler->get_string_manufacturer(), "USBIPDC ");
+    auto product = wstr_to_ascii(device_handler->get_string_product(), "USB Flash Drive ");
+    auto serial = wstr_to_ascii(device_handler->get_string_serial(), "USBIPDCPSN");
+    for (std::size_t i = 0; i < luns_.size(); ++i) {
+        auto &config = luns_[i].config;
+        if (config.vendor.empty())
+            config.vendor = vendor;
+        if (config.product.empty())
+            config.product = product;
+        // VPD 0x80 序列号要求每个逻辑单元唯一，非 0 号 LUN 追加编号
+        if (config.serial.empty())
+            config.serial = i == 0 ? serial : serial + "-" + std::to_string(i);
+        if (config.revision.empty())
+            config.revision = "1.00";
+
+        // 容量 > 2^32-1 块（2TB @ 512B）时 READ/WRITE/READ CAPACITY (10) 的 32 位 LBA
+        // 无法寻址。本项目只提供 10 字节 CDB 的读写，超限只能报错提示用户缩容
+        auto *backend = luns_[i].backend.get();
+        if (backend && config.device_type == MscDeviceType::CdRom && backend->block_size() != 2048) {
+            SPDLOG_WARN("LUN {} 为光驱，但后端块大小为 {}（应为 2048）", i, backend->block_size());
+        }
+        if (backend && backend->block_count() > 0xFFFFFFFFull) {
+            SPDLOG_ERROR("LUN {} 存储容量 {} 块（{} 字节）超过 2TB，10 字节 CDB 无法寻址，请缩小镜像", i,
+                         backend->block_count(), backend->block_count() * backend->block_size());
+        }
     }
 }
 
@@ -57,10 +292,17 @@ void MscBulkOnlyHandler::on_new_connection(Session &current_session, error_code
     command_failed_ = false;
     data_out_unmap_ = false;
     data_out_write_same_ = false;
+    data_out_verify_ = false;
     read_mmap_base_ = nullptr;
     read_total_size_ = 0;
     write_mmap_base_ = nullptr;
     write_accumulated_ = 0;
+    read_segments_.clear();
+    write_segments_.clear();
+    lun_ = nullptr;
+    cmd_tracked_ = false;
+    for (auto &lun: luns_)
+        lun.readahead.reset();
 }
 
 void MscBulkOnlyHandler::on_disconnection(error_code &ec) {
@@ -72,10 +314,17 @@ void MscBulkOnlyHandler::on_disconnection(error_code &ec) {
     command_failed_ = false;
     data_out_unmap_ = false;
     data_out_write_same_ = false;
+    data_out_verify_ = false;
     read_mmap_base_ = nullptr;
     read_total_size_ = 0;
     write_mmap_base_ = nullptr;
     write_accumulated_ = 0;
+    read_segments_.clear();
+    write_segments_.clear();
+    lun_ = nullptr;
+    cmd_tracked_ = false;
+    for (auto &lun: luns_)
+        lun.readahead.reset();
     VirtualInterfaceHandler::on_disconnection(ec);
 }
 
@@ -84,9 +333,81 @@ void MscBulkOnlyHandler::handle_non_standard_request_type_control_urb(std::uint3
                                                                       std::uint32_t transfer_buffer_length,
                                                                       const SetupPacket &setup_packet,
                                                                       TransferHandle transfer, std::error_code &ec) {
+    if (setup_packet.calc_request_type() != static_cast<std::uint8_t>(RequestType::Class)) {
+        session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_epipe_without_data(seqnum, 0));
+        return;
+    }
+    switch (setup_packet.request) {
+        case BotRequest::GetMaxLun: {
+            // 返回最大 LUN 编号（LUN 数 - 1），单 LUN 时为 0
+            if (setup_packet.is_out() || setup_packet.length < 1) {
+                break;
+            }
+            auto *trx = GenericTransfer::from_handle(transfer.get());
+            trx->data = {static_cast<std::uint8_t>(luns_.empty() ? 0 : luns_.size() - 1)};
+            trx->actual_length = trx->data.size();
+            trx->data_offset = 0;
+            session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_ok_with_no_iso(
+                    seqnum, static_cast<std::uint32_t>(trx->actual_length), std::move(transfer)));
+            return;
+        }
+        case BotRequest::Reset: {
+            // Bulk-Only Mass Storage Reset：放弃当前命令，等待下一个 CBW
+            SPDLOG_DEBUG("MSC Bulk-Only Reset");
+            state_ = BotState::Idle;
+            command_failed_ = false;
+            data_out_unmap_ = false;
+            data_out_write_same_ = false;
+            data_out_verify_ = false;
+            data_residue_ = 0;
+            cmd_tracked_ = false;
+            session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_ok_without_data(seqnum, 0));
+            return;
+        }
+        default:
+            break;
+    }
     session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_epipe_without_data(seqnum, 0));
 }
 
+void MscBulkOnlyHandler::fail_write_protected() {
+    lun_->sense_key = SenseKey::DataProtect;
+    lun_->asc = Asc::WriteProtected;
+    command_failed_ = true;
+    state_ = BotState::Status;
+}
+
+/** CBW 指向不存在的 LUN：INQUIRY 返回"不支持的逻辑单元"（外设限定符 011b），
+ *  REQUEST SENSE 返回 ILLEGAL REQUEST / LOGICAL UNIT NOT SUPPORTED，其余命令失败（对齐内核 fsg） */
+void MscBulkOnlyHandler::handle_unsupported_lun_command(std::uint8_t cmd, std::uint32_t transfer_len) {
+    SPDLOG_WARN("CBW 指向不存在的 LUN {}（共 {} 个），cmd=0x{:02X}", current_cbw_.bCBWLUN, luns_.size(), cmd);
+    staging_offset_ = 0;
+    if (cmd == ScsiCmd::Inquiry) {
+        InquiryData inquiry{};
+        inquiry.device_type = 0x7F;
+        inquiry.additional_length = sizeof(InquiryData) - 5;
+        auto len = std::min(transfer_len, std::uint32_t(sizeof(InquiryData)));
+        staging_data_.assign(reinterpret_cast<const std::uint8_t *>(&inquiry),
+                             reinterpret_cast<const std::uint8_t *>(&inquiry) + len);
+        state_ = BotState::DataIn;
+    }
+    else if (cmd == ScsiCmd::RequestSense) {
+        SenseData sense{};
+        sense.valid_response_code = 0x70;
+        sense.sense_key = SenseKey::IllegalRequest;
+        sense.additional_length = 10;
+        sense.asc = Asc::LogicalUnitNotSupported;
+        auto len = std::min(transfer_len, std::uint32_t(sizeof(SenseData)));
+        staging_data_.assign(reinterpret_cast<const std::uint8_t *>(&sense),
+                             reinterpret_cast<const std::uint8_t *>(&sense) + len);
+        state_ = BotState::DataIn;
+    }
+    else {
+        command_failed_ = true;
+        state_ = BotState::Status;
+    }
+}
+
 /** 为 OUT 传输提供目标缓冲区，由 StorageTransferOperator::alloc_transfer_handle 调用。
  *  Idle: CBW 走 fallback_data（返回 nullptr）
  *  DataOut: 写数据直入 mmap 或累积到 staging
@@ -102,11 +423,27 @@ void *MscBulkOnlyHandler::prepare_out_buffer(std::size_t length, StorageIoTransf
             if (write_mmap_base_) {
                 // 零拷贝 WRITE：socket 用 splice 直写入文件，仅回退时用 mmap 指针
                 trx->direct_io = true;
+                trx->backend = lun_->backend.get();
                 trx->file_lba = write_lba_;
                 trx->file_offset = write_accumulated_;
                 SPDLOG_DEBUG("MSC::prepare_out WRITE mmap lba={} offset={}", write_lba_, write_accumulated_);
                 return static_cast<char *>(write_mmap_base_) + write_accumulated_;
             }
+            if (!write_segments_.segments.empty()) {
+                // 借出段 WRITE：socket 直接 scatter read 进后端内存
+                write_segments_.slice(write_accumulated_, length, trx->segments);
+                std::size_t sliced = 0;
+                for (auto &seg: trx->segments)
+                    sliced += seg.length;
+                if (sliced != length) {
+                    SPDLOG_WARN("MSC::prepare_out WRITE 数据超出 CBW 声明长度: offset={} len={}", write_accumulated_,
+                                length);
+                    trx->segments.clear();
+                    return nullptr;
+                }
+                trx->keepalive = write_segments_.keepalive;
+                return nullptr;
+            }
             // 非 mmap WRITE / UNMAP：socket 直读到 staging 尾部
             {
                 auto old_size = staging_data_.size();
@@ -128,12 +465,17 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
     SPDLOG_DEBUG("MSC::on_out_data_recv len={} state={}", length, static_cast<int>(state_));
     switch (state_) {
         case BotState::Idle: {
+            auto cbw_received = std::chrono::steady_clock::now();
+            cmd_tracked_ = false;
             // 上一个命令的 sender 线程已全部发完（否则 host 不会发新的 CBW），安全清空旧 staging
             staging_data_.clear();
             read_mmap_base_ = nullptr;
             read_total_size_ = 0;
             write_mmap_base_ = nullptr;
             write_accumulated_ = 0;
+            // 借出段的所有权已由各 IN 传输的 keepalive 分担，这里只放掉自己的引用
+            read_segments_.clear();
+            write_segments_.clear();
 
             // CBW 在 fallback_data 中
             if (trx->fallback_data.size() < sizeof(CBW)) {
@@ -154,20 +496,47 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
             std::uint8_t cmd = current_cbw_.CBWCB[0];
             bool is_data_in = (current_cbw_.bmCBWFlags & 0x80) != 0;
             auto transfer_len = current_cbw_.dCBWDataTransferLength;
+            begin_command(cmd, cbw_received);
 
-            SPDLOG_DEBUG("CBW cmd=0x{:02X} dir={} len={}", cmd, is_data_in ? "IN" : "OUT", transfer_len);
+            SPDLOG_DEBUG("CBW lun={} cmd=0x{:02X} dir={} len={}", current_cbw_.bCBWLUN, cmd, is_data_in ? "IN" : "OUT",
+                         transfer_len);
+
+            // 按 bCBWLUN 路由到逻辑单元，本命令的数据阶段与 CSW 都作用于该 LUN
+            auto lun_index = static_cast<std::size_t>(current_cbw_.bCBWLUN & 0x0F);
+            lun_ = lun_index < luns_.size() ? &luns_[lun_index] : nullptr;
+            if (!lun_) {
+                handle_unsupported_lun_command(cmd, transfer_len);
+                end_phase(MscPhase::CbwParse);
+                return;
+            }
+            if (cmd != ScsiCmd::RequestSense) {
+                lun_->sense_key = 0;
+                lun_->asc = 0;
+            }
+            auto *backend = lun_->backend.get();
+            if (!backend && cmd != ScsiCmd::Inquiry && cmd != ScsiCmd::RequestSense) {
+                // 空 LUN（未挂载介质）：除识别类命令外一律失败
+                command_failed_ = true;
+                state_ = BotState::Status;
+                end_phase(MscPhase::CbwParse);
+                return;
+            }
 
             switch (cmd) {
                 case ScsiCmd::TestUnitReady:
-                    command_failed_ = !(backend_ != nullptr);
+                    command_failed_ = !(backend != nullptr);
                     state_ = BotState::Status;
                     break;
 
                 case ScsiCmd::RequestSense: {
-                    // REQUEST SENSE：固定格式，无错误时为 0x70 + 附加长度 10
+                    // REQUEST SENSE：固定格式 0x70 + 附加长度 10，带出上一条失败命令的感测数据
                     SenseData sense{};
                     sense.valid_response_code = 0x70;
+                    sense.sense_key = lun_->sense_key;
                     sense.additional_length = 10;
+                    sense.asc = lun_->asc;
+                    lun_->sense_key = 0;
+                    lun_->asc = 0;
                     auto len = std::min(transfer_len, std::uint32_t(sizeof(SenseData)));
                     staging_offset_ = 0;
                     staging_data_.assign(reinterpret_cast<const std::uint8_t *>(&sense),
@@ -181,21 +550,22 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                     std::uint8_t page = current_cbw_.CBWCB[2];
                     SPDLOG_DEBUG("INQUIRY evpd={} page=0x{:02X} len={}", evpd, page, transfer_len);
                     if (!evpd) {
-                        // 标准 INQUIRY：vendor(8) + product(16) + revision(4) 来自 config_
+                        // 标准 INQUIRY：vendor(8) + product(16) + revision(4) 来自该 LUN 的 MscConfig
                         auto pad = [](const std::string &s, std::size_t n) {
                             std::string r = s;
                             r.resize(n, ' '); // 不足补空格，超出截断
                             return r;
                         };
                         InquiryData inquiry{};
+                        inquiry.device_type = static_cast<std::uint8_t>(lun_->config.device_type);
                         inquiry.rmb = 0x80; // 可移动介质
                         inquiry.version = 0x07; // SPC-4
                         inquiry.hisup_format = 0x12; // HiSup=1, Response Format=2
                         inquiry.additional_length = sizeof(InquiryData) - 5;
                         inquiry.cmdque = 0x02; // CmdQue=1（byte 7 bit1）
-                        std::memcpy(inquiry.vendor_id, pad(config_.vendor, 8).c_str(), 8);
-                        std::memcpy(inquiry.product_id, pad(config_.product, 16).c_str(), 16);
-                        std::memcpy(inquiry.product_revision, pad(config_.revision, 4).c_str(), 4);
+                        std::memcpy(inquiry.vendor_id, pad(lun_->config.vendor, 8).c_str(), 8);
+                        std::memcpy(inquiry.product_id, pad(lun_->config.product, 16).c_str(), 16);
+                        std::memcpy(inquiry.product_revision, pad(lun_->config.revision, 4).c_str(), 4);
                         auto len = std::min(transfer_len, std::uint32_t(sizeof(InquiryData)));
                         staging_offset_ = 0;
                         staging_data_.assign(reinterpret_cast<const std::uint8_t *>(&inquiry),
@@ -216,12 +586,12 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                                              reinterpret_cast<const std::uint8_t *>(&vpd) + len);
                     }
                     else if (page == 0x80) {
-                        // Unit Serial Number，来自 config_.serial
+                        // Unit Serial Number，来自该 LUN 的 MscConfig::serial
                         VpdUnitSerialNumber vpd{};
                         vpd.page_code = 0x80;
-                        auto sn_len = std::min<std::size_t>(config_.serial.size(), sizeof(vpd.serial));
+                        auto sn_len = std::min<std::size_t>(lun_->config.serial.size(), sizeof(vpd.serial));
                         vpd.page_length = static_cast<std::uint8_t>(sn_len);
-                        std::memcpy(vpd.serial, config_.serial.data(), sn_len);
+                        std::memcpy(vpd.serial, lun_->config.serial.data(), sn_len);
                         auto len = std::min(transfer_len, std::uint32_t(4 + sn_len));
                         staging_offset_ = 0;
                         staging_data_.assign(reinterpret_cast<const std::uint8_t *>(&vpd),
@@ -271,6 +641,9 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                         staging_offset_ = 0;
                         staging_data_.clear();
                     }
+                    // VPD 页 byte 0 同样是外设类型
+                    if (evpd && !staging_data_.empty())
+                        staging_data_[0] = static_cast<std::uint8_t>(lun_->config.device_type);
                     state_ = BotState::DataIn;
                     break;
                 }
@@ -278,7 +651,7 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                     // MODE SENSE (6)：4 字节模式头，无块描述符/页面
                     ModeSense6Data mode{};
                     mode.mode_data_length = sizeof(ModeSense6Data) - 1;
-                    if (read_only_)
+                    if (lun_->read_only)
                         mode.wp = 0x80;
                     auto len = std::min(transfer_len, std::uint32_t(sizeof(ModeSense6Data)));
                     staging_offset_ = 0;
@@ -294,8 +667,8 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                 case ScsiCmd::ReadFormatCapacities: {
                     // READ FORMAT CAPACITIES（Windows 客户端会发）
                     ReadFormatCapacitiesData buf{};
-                    auto blocks = backend_ ? backend_->block_count() : 0;
-                    std::uint32_t bs = backend_ ? backend_->block_size() : 512;
+                    auto blocks = backend ? backend->block_count() : 0;
+                    std::uint32_t bs = backend ? backend->block_size() : 512;
                     put_be16(buf.list_length, 8); // 一个 8 字节描述符
                     put_be32(buf.capacity, static_cast<std::uint32_t>(blocks));
                     buf.format_type = 0x02; // formatted media
@@ -312,8 +685,8 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                     // READ CAPACITY (16)
                     SPDLOG_DEBUG("READ CAPACITY (16)");
                     ReadCapacity16Data buf{};
-                    put_be64(buf.last_lba, backend_ ? backend_->block_count() - 1 : 0);
-                    put_be32(buf.block_size, backend_->block_size());
+                    put_be64(buf.last_lba, backend ? backend->block_count() - 1 : 0);
+                    put_be32(buf.block_size, backend->block_size());
                     auto len = std::min(transfer_len, std::uint32_t(12)); // 低 12 字节即可（LBA+块大小）
                     staging_offset_ = 0;
                     staging_data_.assign(reinterpret_cast<const std::uint8_t *>(&buf),
@@ -324,8 +697,8 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                 case ScsiCmd::ReadCapacity10: {
                     // READ CAPACITY (10)
                     ReadCapacity10Data buf{};
-                    put_be32(buf.last_lba, static_cast<std::uint32_t>(backend_ ? backend_->block_count() - 1 : 0));
-                    put_be32(buf.block_size, backend_->block_size());
+                    put_be32(buf.last_lba, static_cast<std::uint32_t>(backend ? backend->block_count() - 1 : 0));
+                    put_be32(buf.block_size, backend->block_size());
                     auto len = std::min(transfer_len, std::uint32_t(sizeof(ReadCapacity10Data)));
                     staging_offset_ = 0;
                     staging_data_.assign(reinterpret_cast<const std::uint8_t *>(&buf),
@@ -334,61 +707,158 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                     break;
                 }
                 case ScsiCmd::Read10:
+                case ScsiCmd::Read12:
                 case ScsiCmd::Write10: {
-                    const auto *cdb = reinterpret_cast<const ReadWrite10Cdb *>(current_cbw_.CBWCB);
-                    auto lba = get_be32(cdb->lba);
-                    auto count = get_be16(cdb->block_count);
-                    if (count == 0)
-                        count = 256;
+                    std::uint64_t lba;
+                    std::uint16_t count;
+                    if (cmd == ScsiCmd::Read12) {
+                        // READ(12)：32 位块数，但后端读接口一次最多 0xFFFF 块
+                        const auto *cdb = reinterpret_cast<const Read12Cdb *>(current_cbw_.CBWCB);
+                        lba = get_be32(cdb->lba);
+                        auto count32 = get_be32(cdb->block_count);
+                        if (count32 == 0) {
+                            state_ = BotState::Status;
+                            break;
+                        }
+                        if (count32 > 0xFFFF) {
+                            SPDLOG_WARN("READ(12) count={} 超过单次上限", count32);
+                            command_failed_ = true;
+                            state_ = BotState::Status;
+                            break;
+                        }
+                        count = static_cast<std::uint16_t>(count32);
+                    }
+                    else {
+                        const auto *cdb = reinterpret_cast<const ReadWrite10Cdb *>(current_cbw_.CBWCB);
+                        lba = get_be32(cdb->lba);
+                        count = get_be16(cdb->block_count);
+                        if (count == 0)
+                            count = 256;
+                    }
 
-                    if (lba + count > (backend_ ? backend_->block_count() : 0)) {
+                    if (lba + count > (backend ? backend->block_count() : 0)) {
                         SPDLOG_WARN("SCSI cmd 0x{:02X} LBA={} count={} 超出范围", cmd, lba, count);
                         command_failed_ = true;
                         state_ = BotState::Status;
                         break;
                     }
 
-                    if (cmd == ScsiCmd::Read10) {
-                        // READ：优先 mmap 直发（sendfile 路径），否则回退 staging
+                    if (cmd != ScsiCmd::Write10) {
+                        // READ：优先 mmap 直发（sendfile 路径），其次直接发送后端借出的内存段，
+                        // 都不支持时回退 staging
                         staging_offset_ = 0;
                         read_lba_ = lba;
-                        read_mmap_base_ = backend_->get_direct_buffer(lba);
+                        read_total_size_ = static_cast<std::size_t>(count) * backend->block_size();
+                        read_mmap_base_ = backend->get_direct_buffer(lba);
                         if (read_mmap_base_) {
-                            read_total_size_ = static_cast<std::size_t>(count) * backend_->block_size();
                             staging_data_.clear();
+                            record_path(MscDataPath::Direct);
+                        }
+                        else if (timed_io([&] { return backend->read_segments(lba, count, read_segments_); }) &&
+                                 read_segments_.total_length() == read_total_size_) {
+                            staging_data_.clear();
+                            record_path(MscDataPath::Segments);
                         }
                         else {
-                            staging_data_.resize(read_total_size_ =
-                                                         static_cast<std::size_t>(count) * backend_->block_size());
-                            backend_->read(lba, count, staging_data_.data());
+                            read_segments_.clear();
+                            staging_data_.resize(read_total_size_);
+                            timed_io([&] { return backend->read(lba, count, staging_data_.data()); });
+                            staged_bytes_.fetch_add(read_total_size_, std::memory_order_relaxed);
+                            record_path(MscDataPath::Staged);
+                        }
+                        // 顺序流：当前命令已就绪，再异步预读后续窗口，随机读不触发
+                        if (auto ra = lun_->readahead.on_read(lba, count, backend->block_count())) {
+                            backend->prefetch(ra->lba, ra->count);
                         }
                         state_ = BotState::DataIn;
                     }
-                    else if (read_only_) {
-                        command_failed_ = true;
-                        state_ = BotState::Status;
+                    else if (lun_->read_only) {
+                        fail_write_protected();
                     }
                     else {
                         // WRITE：优先 mmap 直写（socket 直读入 mmap），否则回退 staging
                         write_lba_ = lba;
                         write_count_ = count;
                         write_accumulated_ = 0;
-                        write_mmap_base_ = backend_->get_direct_buffer(lba);
-                        if (!write_mmap_base_) {
+                        write_mmap_base_ = backend->get_direct_buffer(lba);
+                        auto total = static_cast<std::size_t>(count) * backend->block_size();
+                        if (write_mmap_base_) {
+                            record_path(MscDataPath::Direct);
+                        }
+                        else if (timed_io([&] { return backend->write_segments(lba, count, write_segments_); }) &&
+                                 write_segments_.total_length() == total) {
+                            record_path(MscDataPath::Segments);
+                        }
+                        else {
+                            write_segments_.clear();
                             staging_data_.clear();
-                            staging_data_.reserve(static_cast<std::size_t>(count) * backend_->block_size());
+                            staging_data_.reserve(total);
+                            record_path(MscDataPath::Staged);
                         }
                         state_ = BotState::DataOut;
                     }
                     break;
                 }
                 case ScsiCmd::StartStopUnit:
-                case ScsiCmd::Verify10:
                     state_ = BotState::Status;
                     break;
+                case ScsiCmd::Verify10: {
+                    // VERIFY(10)：CDB[1] bit2-1 = BYTCHK。
+                    //   0：只校验介质可读，本项目的后端没有介质错误，直接成功
+                    //   1：DATA-OUT 收 count 块，与介质逐字节比较
+                    //   3：DATA-OUT 收 1 块，与范围内每一块比较
+                    // 块数 0 表示不校验任何块
+                    const auto *cdb = reinterpret_cast<const ReadWrite10Cdb *>(current_cbw_.CBWCB);
+                    std::uint64_t lba = get_be32(cdb->lba);
+                    auto count = get_be16(cdb->block_count);
+                    auto bytchk = static_cast<std::uint8_t>((cdb->flags >> 1) & 0x03);
+                    if (lba + count > backend->block_count() || bytchk == 2) {
+                        SPDLOG_WARN("VERIFY LBA={} count={} bytchk={} 无效", lba, count, bytchk);
+                        command_failed_ = true;
+                        state_ = BotState::Status;
+                        break;
+                    }
+                    if (bytchk == 0 || count == 0) {
+                        state_ = BotState::Status;
+                        break;
+                    }
+                    auto expected = static_cast<std::size_t>(bytchk == 1 ? count : 1) * backend->block_size();
+                    if (transfer_len < expected) {
+                        SPDLOG_WARN("VERIFY 数据长度 {} 小于 {}", transfer_len, expected);
+                        command_failed_ = true;
+                        state_ = BotState::Status;
+                        break;
+                    }
+                    verify_lba_ = lba;
+                    verify_count_ = count;
+                    verify_bytchk_ = bytchk;
+                    data_out_verify_ = true;
+                    staging_offset_ = 0;
+                    staging_data_.clear();
+                    staging_data_.reserve(transfer_len);
+                    data_residue_ = static_cast<std::uint32_t>(transfer_len - expected);
+                    state_ = BotState::DataOut;
+                    break;
+                }
                 case ScsiCmd::SynchronizeCache: {
-                    // SYNCHRONIZE CACHE：虚拟设备没有写缓存，数据早已落盘，
-                    // 直接成功（对齐内核 do_synchronize_cache）
+                    // SYNCHRONIZE CACHE (10)：LBA/块数布局同 READ(10)，块数 0 表示到介质末尾。
+                    // 只等待覆盖范围内的脏数据落盘，写缓存策略由后端的持久化模式决定
+                    const auto *cdb = reinterpret_cast<const ReadWrite10Cdb *>(current_cbw_.CBWCB);
+                    std::uint64_t lba = get_be32(cdb->lba);
+                    std::uint64_t count = get_be16(cdb->block_count);
+                    auto block_count = backend ? backend->block_count() : 0;
+                    if (lba > block_count || lba + count > block_count) {
+                        SPDLOG_WARN("SYNCHRONIZE CACHE LBA={} count={} 超出范围", lba, count);
+                        command_failed_ = true;
+                        state_ = BotState::Status;
+                        break;
+                    }
+                    if (count == 0)
+                        count = block_count - lba;
+                    if (!timed_io([&] { return backend->flush(lba, count); })) {
+                        SPDLOG_ERROR("SYNCHRONIZE CACHE 刷盘失败: LBA={} count={}", lba, count);
+                        command_failed_ = true;
+                    }
                     state_ = BotState::Status;
                     break;
                 }
@@ -397,7 +867,7 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                     // WP 位位置与 6 字节版不同（对齐内核 do_mode_sense）
                     ModeSense10Data mode{};
                     put_be16(mode.mode_data_length, sizeof(ModeSense10Data) - 2);
-                    if (read_only_)
+                    if (lun_->read_only)
                         mode.wp = 0x80;
                     auto len = std::min(transfer_len, std::uint32_t(sizeof(ModeSense10Data)));
                     staging_offset_ = 0;
@@ -427,7 +897,7 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                         lba = get_be64(cdb->lba);
                         cnt = get_be32(cdb->block_count);
                     }
-                    auto blocks = backend_ ? backend_->block_count() : 0;
+                    auto blocks = backend ? backend->block_count() : 0;
                     if (lba >= blocks) {
                         SPDLOG_WARN("WRITE SAME LBA={} 超出范围", lba);
                         command_failed_ = true;
@@ -436,15 +906,19 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                     }
                     if (cnt == 0)
                         cnt = blocks - lba; // 0 = 直到介质末尾
-                    if (read_only_ || cnt > blocks - lba) {
-                        SPDLOG_WARN("WRITE SAME LBA={} cnt={} 超出范围或只读", lba, cnt);
+                    if (lun_->read_only) {
+                        fail_write_protected();
+                        break;
+                    }
+                    if (cnt > blocks - lba) {
+                        SPDLOG_WARN("WRITE SAME LBA={} cnt={} 超出范围", lba, cnt);
                         command_failed_ = true;
                         state_ = BotState::Status;
                         break;
                     }
                     SPDLOG_DEBUG("WRITE SAME cmd=0x{:02X} unmap={} lba={} cnt={}", cmd, unmap, lba, cnt);
                     if (unmap) {
-                        backend_->punch_hole(lba, cnt);
+                        timed_io([&] { backend->punch_hole(lba, cnt); });
                         state_ = BotState::Status;
                     }
                     else {
@@ -454,7 +928,7 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                         staging_offset_ = 0;
                         staging_data_.clear();
                         // 主机应传 1 个逻辑块，多余字节视为协议偏差丢弃
-                        data_residue_ = transfer_len > backend_->block_size() ? transfer_len - backend_->block_size() : 0;
+                        data_residue_ = transfer_len > backend->block_size() ? transfer_len - backend->block_size() : 0;
                         state_ = BotState::DataOut;
                     }
                     break;
@@ -463,13 +937,37 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                     command_failed_ = true;
                     state_ = BotState::Status;
                     break;
+                case ScsiCmd::ReadToc:
+                case ScsiCmd::GetConfiguration:
+                case ScsiCmd::GetEventStatusNotification: {
+                    // MMC 命令只对光驱 LUN 开放；GESN 的异步模式（Polled=0）不支持
+                    bool ok = lun_->config.device_type == MscDeviceType::CdRom;
+                    if (ok && cmd == ScsiCmd::ReadToc)
+                        staging_data_ = build_read_toc(current_cbw_.CBWCB, backend->block_count());
+                    else if (ok && cmd == ScsiCmd::GetConfiguration)
+                        staging_data_ = build_configuration(current_cbw_.CBWCB, *backend);
+                    else if (ok && (current_cbw_.CBWCB[1] & 0x01))
+                        staging_data_ = build_event_status(current_cbw_.CBWCB);
+                    else
+                        staging_data_.clear();
+                    if (staging_data_.empty()) {
+                        SPDLOG_DEBUG("MMC cmd=0x{:02X} 不支持或参数无效", cmd);
+                        command_failed_ = true;
+                        state_ = BotState::Status;
+                        break;
+                    }
+                    if (staging_data_.size() > transfer_len)
+                        staging_data_.resize(transfer_len);
+                    staging_offset_ = 0;
+                    state_ = BotState::DataIn;
+                    break;
+                }
                 case ScsiCmd::Unmap: {
                     // UNMAP，数据长度以 CBW.dCBWDataTransferLength 为准（某些内核 CDB 参数长度为 0）
                     auto data_len = current_cbw_.dCBWDataTransferLength;
                     SPDLOG_DEBUG("UNMAP CBW tag=0x{:08X} dataLen={}", current_cbw_.dCBWTag, data_len);
-                    if (read_only_) {
-                        command_failed_ = true;
-                        state_ = BotState::Status;
+                    if (lun_->read_only) {
+                        fail_write_protected();
                         break;
                     }
                     if (data_len == 0) {
@@ -489,10 +987,13 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                     state_ = BotState::Status;
                     break;
             }
+            end_phase(MscPhase::CbwParse);
             break;
         }
 
         case BotState::DataOut: {
+            auto *backend = lun_->backend.get();
+            cmd_bytes_out_ += length;
             if (data_out_unmap_) {
                 if (staging_data_.size() >= write_count_) {
                     auto &d = staging_data_;
@@ -501,7 +1002,7 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                         auto lba = get_be64(desc->lba);
                         auto cnt = get_be32(desc->block_count);
                         SPDLOG_DEBUG("UNMAP punch lba={} cnt={}", lba, cnt);
-                        backend_->punch_hole(lba, cnt);
+                        timed_io([&] { backend->punch_hole(lba, cnt); });
                     }
                     staging_data_.clear();
                     data_out_unmap_ = false;
@@ -509,19 +1010,44 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
                     state_ = BotState::Status;
                 }
             }
+            else if (data_out_verify_) {
+                auto bs = backend->block_size();
+                auto expected = static_cast<std::size_t>(verify_bytchk_ == 1 ? verify_count_ : 1) * bs;
+                if (staging_data_.size() >= expected) {
+                    auto result = timed_io([&] {
+                        return verify_medium(*backend, verify_lba_, verify_count_, staging_data_.data(),
+                                             verify_bytchk_ == 3);
+                    });
+                    if (result == VerifyResult::Miscompare) {
+                        lun_->sense_key = SenseKey::Miscompare;
+                        lun_->asc = Asc::MiscompareDuringVerify;
+                        command_failed_ = true;
+                    }
+                    else if (result == VerifyResult::ReadError) {
+                        lun_->sense_key = SenseKey::MediumError;
+                        lun_->asc = Asc::UnrecoveredReadError;
+                        command_failed_ = true;
+                    }
+                    staging_data_.clear();
+                    data_out_verify_ = false;
+                    state_ = BotState::Status;
+                }
+            }
             else if (data_out_write_same_) {
                 // WRITE SAME 填充：收满 1 个逻辑块后逐块写入整个范围。
                 // 填充数据只有 1 块，而 write() 的 data 缓冲需完整 count 块，
                 // 故每次只写 1 块（不可批量，否则越界读）
-                auto bs = backend_->block_size();
+                auto bs = backend->block_size();
                 if (staging_data_.size() >= bs) {
                     auto lba = write_same_lba_;
                     auto cnt = write_same_count_;
-                    while (cnt > 0) {
-                        backend_->write(lba, 1, staging_data_.data());
-                        lba += 1;
-                        cnt -= 1;
-                    }
+                    timed_io([&] {
+                        while (cnt > 0) {
+                            backend->write(lba, 1, staging_data_.data());
+                            lba += 1;
+                            cnt -= 1;
+                        }
+                    });
                     staging_data_.clear();
                     data_out_write_same_ = false;
                     state_ = BotState::Status;
@@ -530,24 +1056,53 @@ void MscBulkOnlyHandler::on_out_data_received(StorageIoTransfer *trx, std::size_
             else if (write_mmap_base_) {
                 // 零拷贝 WRITE：数据已直读入 mmap，叠加偏移
                 write_accumulated_ += length;
-                if (write_accumulated_ >= static_cast<std::size_t>(write_count_) * backend_->block_size()) {
+                if (write_accumulated_ >= static_cast<std::size_t>(write_count_) * backend->block_size()) {
+                    // 数据绕过 write() 直接进了映射区/页缓存，通知后端按持久化策略处理
+                    if (!timed_io([&] { return backend->commit_direct_write(write_lba_, write_count_); })) {
+                        SPDLOG_ERROR("WRITE 提交失败: LBA={} count={}", write_lba_, write_count_);
+                        command_failed_ = true;
+                    }
                     write_mmap_base_ = nullptr;
                     write_accumulated_ = 0;
                     data_residue_ = 0;
                     state_ = BotState::Status;
                 }
             }
+            else if (!write_segments_.segments.empty()) {
+                // 借出段 WRITE：数据已直读入后端内存，收齐后提交
+                if (trx->segments.empty())
+                    command_failed_ = true; // 超出 CBW 声明长度的数据没有可放的段
+                write_accumulated_ += length;
+                if (write_accumulated_ >= static_cast<std::size_t>(write_count_) * backend->block_size()) {
+                    if (!command_failed_ &&
+                        !timed_io([&] { return backend->commit_segments(write_lba_, write_count_, write_segments_); })) {
+                        SPDLOG_ERROR("WRITE 提交失败: LBA={} count={}", write_lba_, write_count_);
+                        command_failed_ = true;
+                    }
+                    write_segments_.clear();
+                    write_accumulated_ = 0;
+                    data_residue_ = 0;
+                    state_ = BotState::Status;
+                }
+            }
             else {
                 // 非 mmap WRITE 回退：累积 staging 后写盘
-                if (write_lba_ + write_count_ <= backend_->block_count()) {
-                    if (staging_data_.size() >= static_cast<std::size_t>(write_count_) * backend_->block_size()) {
-                        backend_->write(write_lba_, write_count_, staging_data_.data());
+                if (write_lba_ + write_count_ <= backend->block_count()) {
+                    if (staging_data_.size() >= static_cast<std::size_t>(write_count_) * backend->block_size()) {
+                        if (timed_io([&] { return backend->write(write_lba_, write_count_, staging_data_.data()); }) ==
+                            0) {
+                            SPDLOG_ERROR("WRITE 写盘失败: LBA={} count={}", write_lba_, write_count_);
+                            command_failed_ = true;
+                        }
+                        staged_bytes_.fetch_add(staging_data_.size(), std::memory_order_relaxed);
                         staging_data_.clear();
                         data_residue_ = 0;
                         state_ = BotState::Status;
                     }
                 }
             }
+            if (state_ == BotState::Status)
+                end_phase(MscPhase::DataTransfer);
             break;
         }
 
@@ -565,7 +1120,8 @@ void MscBulkOnlyHandler::handle_bulk_transfer(std::uint32_t seqnum, const UsbEnd
     if (ep.is_in()) {
         switch (state_) {
             case BotState::DataIn: {
-                auto total = read_mmap_base_ ? read_total_size_ : staging_data_.size();
+                bool lent = read_mmap_base_ || !read_segments_.segments.empty();
+                auto total = lent ? read_total_size_ : staging_data_.size();
                 auto remaining = total - staging_offset_;
                 auto len = std::min(static_cast<std::size_t>(transfer_buffer_length), remaining);
                 if (len > 0) {
@@ -573,12 +1129,18 @@ void MscBulkOnlyHandler::handle_bulk_transfer(std::uint32_t seqnum, const UsbEnd
                     if (read_mmap_base_) {
                         // 零拷贝发送：external_buf 直指 mmap，file_lba/file_offset 供 send_direct
                         trx->direct_io = true;
+                        trx->backend = lun_->backend.get();
                         trx->external_buf = static_cast<char *>(read_mmap_base_) + staging_offset_;
                         trx->file_lba = read_lba_;
                         trx->file_offset = staging_offset_;
                         SPDLOG_DEBUG("MSC::hb IN mmap handle={:p} lba={} offset={} len={}",
                                      static_cast<const void *>(transfer.get()), read_lba_, staging_offset_, len);
                     }
+                    else if (!read_segments_.segments.empty()) {
+                        // 借出段：取本 URB 对应的切片，keepalive 保证发送期间内存有效
+                        read_segments_.slice(staging_offset_, len, trx->segments);
+                        trx->keepalive = read_segments_.keepalive;
+                    }
                     else {
                         trx->external_buf = staging_data_.data() + staging_offset_;
                         SPDLOG_DEBUG("MSC::hb IN staging handle={:p} offset={} len={}",
@@ -586,6 +1148,7 @@ void MscBulkOnlyHandler::handle_bulk_transfer(std::uint32_t seqnum, const UsbEnd
                     }
                     trx->actual_length = len;
                     staging_offset_ += len;
+                    cmd_bytes_in_ += len;
                     session->submit_ret_submit(UsbIpResponse::UsbIpRetSubmit::create_ret_submit_with_status_and_no_iso(
                             seqnum, static_cast<std::uint32_t>(UrbStatusType::StatusOK),
                             static_cast<std::uint32_t>(len), std::move(transfer)));
@@ -599,6 +1162,7 @@ void MscBulkOnlyHandler::handle_bulk_transfer(std::uint32_t seqnum, const UsbEnd
                     staging_offset_ = 0;
                     data_residue_ = 0;
                     state_ = BotState::Status;
+                    end_phase(MscPhase::DataTransfer);
                 }
                 break;
             }
@@ -607,9 +1171,11 @@ void MscBulkOnlyHandler::handle_bulk_transfer(std::uint32_t seqnum, const UsbEnd
                 CSW csw{};
                 csw.dCSWSignature = CSW_SIGNATURE;
                 csw.dCSWTag = current_cbw_.dCBWTag;
+                finish_command(command_failed_);
                 if (command_failed_) {
                     // 对齐内核 fsg：失败时 residue = 应传未传字节数。本项目失败
-                    // 均发生在数据阶段前（实际传了 0 字节），故 = dCBWDataTransferLength
+                    // 多发生在数据阶段前（实际传了 0 字节），故 = dCBWDataTransferLength；
+                    // WRITE 落盘失败时数据虽已收下但未写成，同样按全部未传报告
                     csw.dCSWDataResidue = current_cbw_.dCBWDataTransferLength;
                     csw.bCSWStatus = 1;
                     command_failed_ = false;
@@ -0,0 +1,189 @@
+#include "usbipdcpp/virtual_device/devices/MscStats.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "usbipdcpp/virtual_device/MscConstants.h"
+
+using namespace usbipdcpp;
+
+namespace {
+
+struct OpcodeInfo {
+    std::uint8_t opcode;
+    const char *name;
+};
+
+/** 单独统计的操作码，顺序即槽位 */
+constexpr OpcodeInfo TRACKED[] = {
+        {ScsiCmd::TestUnitReady, "TEST UNIT READY"},
+        {ScsiCmd::RequestSense, "REQUEST SENSE"},
+        {ScsiCmd::Inquiry, "INQUIRY"},
+        {ScsiCmd::ModeSense6, "MODE SENSE(6)"},
+        {ScsiCmd::StartStopUnit, "START STOP UNIT"},
+        {ScsiCmd::PreventAllowMediumRemoval, "PREVENT ALLOW MEDIUM REMOVAL"},
+        {ScsiCmd::ReadFormatCapacities, "READ FORMAT CAPACITIES"},
+        {ScsiCmd::ReadCapacity10, "READ CAPACITY(10)"},
+        {ScsiCmd::ReadCapacity16, "READ CAPACITY(16)"},
+        {ScsiCmd::Read10, "READ(10)"},
+        {ScsiCmd::Write10, "WRITE(10)"},
+        {ScsiCmd::Verify10, "VERIFY(10)"},
+        {ScsiCmd::SynchronizeCache, "SYNCHRONIZE CACHE(10)"},
+        {ScsiCmd::WriteSame10, "WRITE SAME(10)"},
+        {ScsiCmd::Unmap, "UNMAP"},
+        {ScsiCmd::ModeSense10, "MODE SENSE(10)"},
+        {ScsiCmd::AtaPassThrough, "ATA PASS-THROUGH(12)"},
+        {ScsiCmd::WriteSame16, "WRITE SAME(16)"},
+        {ScsiCmd::ReadToc, "READ TOC"},
+        {ScsiCmd::GetConfiguration, "GET CONFIGURATION"},
+        {ScsiCmd::GetEventStatusNotification, "GET EVENT STATUS NOTIFICATION"},
+        {ScsiCmd::Read12, "READ(12)"},
+};
+
+void atomic_max(std::atomic<std::uint64_t> &target, std::uint64_t value) {
+    auto cur = target.load(std::memory_order_relaxed);
+    while (value > cur && !target.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+// ============== LatencyHistogram ==============
+
+void LatencyHistogram::record(std::chrono::nanoseconds elapsed) {
+    auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(0, elapsed.count()));
+    auto us = ns / 1000;
+    // us = 0 → 桶 0；[2^(i-1), 2^i) → 桶 i
+    auto bucket = std::min<std::size_t>(BUCKETS - 1, static_cast<std::size_t>(std::bit_width(us)));
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(ns, std::memory_order_relaxed);
+    atomic_max(max_ns_, ns);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot s;
+    s.count = count_.load(std::memory_order_relaxed);
+    s.total_ns = total_ns_.load(std::memory_order_relaxed);
+    s.max_ns = max_ns_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < BUCKETS; ++i)
+        s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    return s;
+}
+
+void LatencyHistogram::reset() {
+    count_.store(0, std::memory_order_relaxed);
+    total_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+    for (auto &b: buckets_)
+        b.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::Snapshot::percentile_us(double p) const {
+    // 各桶与 count 分别读取，并发 record 时两者可能差几个样本，按桶的合计算
+    std::uint64_t total = 0;
+    for (auto b: buckets)
+        total += b;
+    if (total == 0)
+        return 0.0;
+    auto rank = static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(total));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen > rank)
+            return i + 1 == BUCKETS ? static_cast<double>(max_ns) / 1000.0 : bucket_upper_us(i);
+    }
+    return static_cast<double>(max_ns) / 1000.0;
+}
+
+// ============== MscStats ==============
+
+MscStats::MscStats() {
+    static_assert(std::size(TRACKED) == TRACKED_OPCODES);
+    slot_index_.fill(static_cast<std::uint8_t>(TRACKED_OPCODES));
+    for (std::size_t i = 0; i < TRACKED_OPCODES; ++i)
+        slot_index_[TRACKED[i].opcode] = static_cast<std::uint8_t>(i);
+}
+
+void MscStats::record_command(std::uint8_t opcode, bool failed, std::uint64_t bytes_in, std::uint64_t bytes_out) {
+    auto &s = slot(opcode);
+    s.commands.fetch_add(1, std::memory_order_relaxed);
+    if (failed)
+        s.failed.fetch_add(1, std::memory_order_relaxed);
+    s.bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+    s.bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+}
+
+void MscStats::record_phase(std::uint8_t opcode, MscPhase phase, std::chrono::nanoseconds elapsed) {
+    slot(opcode).phases[static_cast<std::size_t>(phase)].record(elapsed);
+}
+
+void MscStats::record_path(std::uint8_t opcode, MscDataPath path) {
+    slot(opcode).paths[static_cast<std::size_t>(path)].fetch_add(1, std::memory_order_relaxed);
+}
+
+MscStats::OpcodeSnapshot MscStats::snapshot_slot(std::size_t index) const {
+    const auto &s = slots_[index];
+    OpcodeSnapshot out{};
+    out.opcode = index < TRACKED_OPCODES ? TRACKED[index].opcode : OTHER_OPCODE;
+    out.commands = s.commands.load(std::memory_order_relaxed);
+    out.failed = s.failed.load(std::memory_order_relaxed);
+    out.bytes_in = s.bytes_in.load(std::memory_order_relaxed);
+    out.bytes_out = s.bytes_out.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < out.paths.size(); ++i)
+        out.paths[i] = s.paths[i].load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < MSC_PHASE_COUNT; ++i)
+        out.phases[i] = s.phases[i].snapshot();
+    return out;
+}
+
+std::vector<MscStats::OpcodeSnapshot> MscStats::snapshot() const {
+    std::vector<OpcodeSnapshot> out;
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].commands.load(std::memory_order_relaxed) > 0)
+            out.push_back(snapshot_slot(i));
+    }
+    std::sort(out.begin(), out.end(), [](const auto &a, const auto &b) { return a.opcode < b.opcode; });
+    return out;
+}
+
+MscStats::OpcodeSnapshot MscStats::snapshot(std::uint8_t opcode) const {
+    return snapshot_slot(slot_index_[opcode]);
+}
+
+void MscStats::reset() {
+    for (auto &s: slots_) {
+        s.commands.store(0, std::memory_order_relaxed);
+        s.failed.store(0, std::memory_order_relaxed);
+        s.bytes_in.store(0, std::memory_order_relaxed);
+        s.bytes_out.store(0, std::memory_order_relaxed);
+        for (auto &p: s.paths)
+            p.store(0, std::memory_order_relaxed);
+        for (auto &h: s.phases)
+            h.reset();
+    }
+}
+
+const char *MscStats::opcode_name(std::uint8_t opcode) {
+    for (const auto &info: TRACKED) {
+        if (info.opcode == opcode)
+            return info.name;
+    }
+    return "OTHER";
+}
+
+const char *MscStats::phase_name(MscPhase phase) {
+    switch (phase) {
+        case MscPhase::CbwParse:
+            return "cbw";
+        case MscPhase::BackendIo:
+            return "backend";
+        case MscPhase::DataTransfer:
+            return "data";
+        case MscPhase::Csw:
+            return "csw";
+        case MscPhase::Total:
+            return "total";
+    }
+    return "?";
+}
@@ -0,0 +1,200 @@
+#include "usbipdcpp/virtual_device/storage_backends/AsyncDiscardBackend.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace usbipdcpp {
+
+namespace {
+    bool overlaps(std::uint64_t a, std::uint64_t a_count, std::uint64_t b, std::uint64_t b_count) {
+        return a < b + b_count && b < a + a_count;
+    }
+} // namespace
+
+AsyncDiscardBackend::AsyncDiscardBackend(std::unique_ptr<StorageBackend> inner, std::uint64_t max_discard_blocks) :
+    inner_(std::move(inner)), max_discard_blocks_(std::max<std::uint64_t>(1, max_discard_blocks)) {
+    worker_ = std::thread([this] { worker_loop(); });
+}
+
+AsyncDiscardBackend::~AsyncDiscardBackend() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    worker_cv_.notify_one();
+    worker_.join();
+}
+
+void AsyncDiscardBackend::worker_loop() {
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        worker_cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+        // 退出前执行完剩余范围，丢弃不能因为进程退出而丢失
+        if (pending_.empty())
+            break;
+        auto first = pending_.collect().front();
+        Batch batch{first.lba, std::min(first.count, max_discard_blocks_)};
+        pending_.clear({{batch.lba, batch.count, first.generation}});
+        inflight_ = batch;
+        lock.unlock();
+
+        SPDLOG_DEBUG("后台打洞 LBA={} count={}", batch.lba, batch.count);
+        inner_->punch_hole(batch.lba, batch.count);
+
+        lock.lock();
+        inflight_.reset();
+        applied_batches_.fetch_add(1, std::memory_order_relaxed);
+        applied_blocks_.fetch_add(batch.count, std::memory_order_relaxed);
+        done_cv_.notify_all();
+    }
+}
+
+void AsyncDiscardBackend::claim_locked(std::unique_lock<std::mutex> &lock, std::uint64_t lba, std::uint64_t count) {
+    done_cv_.wait(lock, [&] { return !inflight_ || !overlaps(inflight_->lba, inflight_->count, lba, count); });
+    // 新写入的块不再需要打洞
+    pending_.clear({{lba, count, UINT64_MAX}});
+}
+
+void AsyncDiscardBackend::punch_hole(std::uint64_t lba, std::uint64_t count) {
+    auto blocks = inner_->block_count();
+    if (count == 0 || lba >= blocks)
+        return;
+    count = std::min(count, blocks - lba);
+    {
+        std::lock_guard lock(mutex_);
+        pending_.mark(lba, count);
+    }
+    queued_ranges_.fetch_add(1, std::memory_order_relaxed);
+    worker_cv_.notify_one();
+}
+
+std::size_t AsyncDiscardBackend::read(std::uint64_t lba, std::uint16_t count, void *buffer) {
+    // 读之前取快照：读底层期间后台可能刚好执行完某一批，之后才取就漏掉了旧数据
+    std::vector<Batch> zeros;
+    {
+        std::lock_guard lock(mutex_);
+        if (inflight_ && overlaps(inflight_->lba, inflight_->count, lba, count))
+            zeros.push_back(*inflight_);
+        for (auto &r: pending_.collect(lba, count))
+            zeros.push_back({r.lba, r.count});
+    }
+    auto bs = inner_->block_size();
+    auto *out = static_cast<std::uint8_t *>(buffer);
+    bool covered = std::any_of(zeros.begin(), zeros.end(), [&](const Batch &z) {
+        return z.lba <= lba && z.lba + z.count >= lba + count;
+    });
+    if (covered) {
+        if (lba + count > inner_->block_count())
+            return 0;
+        std::memset(out, 0, static_cast<std::size_t>(count) * bs);
+        return static_cast<std::size_t>(count) * bs;
+    }
+
+    auto n = inner_->read(lba, count, buffer);
+    if (n != static_cast<std::size_t>(count) * bs)
+        return n;
+    for (auto &z: zeros) {
+        auto b = std::max(z.lba, lba);
+        auto e = std::min(z.lba + z.count, lba + count);
+        if (b < e)
+            std::memset(out + (b - lba) * bs, 0, static_cast<std::size_t>(e - b) * bs);
+    }
+    return n;
+}
+
+std::size_t AsyncDiscardBackend::write(std::uint64_t lba, std::uint16_t count, const void *data) {
+    {
+        std::unique_lock lock(mutex_);
+        claim_locked(lock, lba, count);
+    }
+    return inner_->write(lba, count, data);
+}
+
+bool AsyncDiscardBackend::read_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) {
+    {
+        std::lock_guard lock(mutex_);
+        if (busy_locked())
+            return false;
+    }
+    return inner_->read_segments(lba, count, out);
+}
+
+bool AsyncDiscardBackend::write_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) {
+    {
+        std::lock_guard lock(mutex_);
+        if (busy_locked())
+            return false;
+    }
+    return inner_->write_segments(lba, count, out);
+}
+
+bool AsyncDiscardBackend::commit_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &segments) {
+    {
+        std::unique_lock lock(mutex_);
+        claim_locked(lock, lba, count);
+    }
+    return inner_->commit_segments(lba, count, segments);
+}
+
+void AsyncDiscardBackend::prefetch(std::uint64_t lba, std::uint64_t count) {
+    inner_->prefetch(lba, count);
+}
+
+bool AsyncDiscardBackend::flush(std::uint64_t lba, std::uint64_t count) {
+    drain();
+    return inner_->flush(lba, count);
+}
+
+bool AsyncDiscardBackend::commit_direct_write(std::uint64_t lba, std::uint64_t count) {
+    return inner_->commit_direct_write(lba, count);
+}
+
+void *AsyncDiscardBackend::get_direct_buffer(std::uint64_t lba) {
+    // 映射区里可能还是未打洞的旧数据，有待执行范围时一律走 read / write
+    {
+        std::lock_guard lock(mutex_);
+        if (busy_locked())
+            return nullptr;
+    }
+    return inner_->get_direct_buffer(lba);
+}
+
+bool AsyncDiscardBackend::send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                                      std::error_code &ec) {
+    return inner_->send_direct(lba, offset, length, sock_fd, ec);
+}
+
+bool AsyncDiscardBackend::send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                                      SplicePipePool &pipes, std::error_code &ec) {
+    return inner_->send_direct(lba, offset, length, sock_fd, pipes, ec);
+}
+
+bool AsyncDiscardBackend::recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                                      std::error_code &ec) {
+    return inner_->recv_direct(lba, offset, length, sock_fd, ec);
+}
+
+bool AsyncDiscardBackend::recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                                      SplicePipePool &pipes, std::error_code &ec) {
+    return inner_->recv_direct(lba, offset, length, sock_fd, pipes, ec);
+}
+
+void AsyncDiscardBackend::drain() {
+    std::unique_lock lock(mutex_);
+    done_cv_.wait(lock, [this] { return !busy_locked(); });
+}
+
+std::uint64_t AsyncDiscardBackend::pending_blocks() const {
+    std::lock_guard lock(mutex_);
+    return pending_.dirty_blocks() + (inflight_ ? inflight_->count : 0);
+}
+
+AsyncDiscardBackend::DiscardStats AsyncDiscardBackend::discard_stats() const {
+    return {queued_ranges_.load(std::memory_order_relaxed), applied_batches_.load(std::memory_order_relaxed),
+            applied_blocks_.load(std::memory_order_relaxed)};
+}
+
+} // namespace usbipdcpp
@@ -0,0 +1,323 @@
+#include "usbipdcpp/virtual_device/storage_backends/CachedBackend.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+namespace usbipdcpp {
+
+namespace {
+    /** 超过这么多页的作废改为扫描各分片，避免对 TB 级 TRIM 逐页加锁 */
+    constexpr std::uint64_t INVALIDATE_SCAN_THRESHOLD = 4096;
+} // namespace
+
+CachedBackend::CachedBackend(std::unique_ptr<StorageBackend> inner, CachedBackendOptions options) :
+    inner_(std::move(inner)), options_(options) {
+    auto bs = inner_->block_size();
+    if (options_.page_size < bs || options_.page_size % bs != 0) {
+        auto fixed = std::max<std::size_t>(bs, options_.page_size / bs * bs);
+        SPDLOG_WARN("缓存页大小 {} 不是块大小 {} 的整数倍，改为 {}", options_.page_size, bs, fixed);
+        options_.page_size = fixed;
+    }
+    blocks_per_page_ = options_.page_size / bs;
+
+    auto shard_num = std::max<std::size_t>(1, options_.shards);
+    shard_capacity_ = std::max(options_.cache_bytes / shard_num, options_.page_size);
+    a1in_capacity_ = shard_capacity_ / 4;
+    ghost_capacity_ = std::max<std::size_t>(1, shard_capacity_ / options_.page_size / 2);
+    shards_.reserve(shard_num);
+    for (std::size_t i = 0; i < shard_num; ++i)
+        shards_.push_back(std::make_unique<Shard>());
+}
+
+std::size_t CachedBackend::page_bytes(std::uint64_t page) const {
+    auto blocks = std::min<std::uint64_t>(blocks_per_page_, inner_->block_count() - page * blocks_per_page_);
+    return static_cast<std::size_t>(blocks) * inner_->block_size();
+}
+
+CachedBackend::PageData CachedBackend::lookup(std::uint64_t page) {
+    auto &shard = shard_of(page);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.map.find(page);
+    if (it == shard.map.end())
+        return nullptr;
+    // A1in 命中不调整位置（2Q 只让 A1out 的再次访问晋升）
+    if (it->second.queue == Queue::Am)
+        shard.am.splice(shard.am.begin(), shard.am, it->second.pos);
+    return it->second.data;
+}
+
+std::uint64_t CachedBackend::generation_of(std::uint64_t page) {
+    auto &shard = shard_of(page);
+    std::lock_guard lock(shard.mutex);
+    return shard.generation;
+}
+
+void CachedBackend::insert(std::uint64_t page, PageData data, std::uint64_t generation) {
+    auto &shard = shard_of(page);
+    std::lock_guard lock(shard.mutex);
+    // 读底层期间有写入或打洞，读到的可能是旧数据
+    if (shard.generation != generation)
+        return;
+    insert_locked(shard, page, std::move(data));
+}
+
+void CachedBackend::insert_locked(Shard &shard, std::uint64_t page, PageData data) {
+    // 两个线程同时未命中同一页时，后插入者直接丢弃
+    if (shard.map.contains(page))
+        return;
+    auto size = data->size();
+    if (auto ghost = shard.ghosts.find(page); ghost != shard.ghosts.end()) {
+        shard.a1out.erase(ghost->second);
+        shard.ghosts.erase(ghost);
+        ghost_hits_.fetch_add(1, std::memory_order_relaxed);
+        shard.am.push_front(page);
+        shard.map.emplace(page, Entry{std::move(data), Queue::Am, shard.am.begin()});
+    }
+    else {
+        shard.a1in.push_front(page);
+        shard.map.emplace(page, Entry{std::move(data), Queue::A1in, shard.a1in.begin()});
+        shard.a1in_bytes += size;
+    }
+    shard.bytes += size;
+    evict_locked(shard);
+}
+
+void CachedBackend::remove_locked(Shard &shard, std::unordered_map<std::uint64_t, Entry>::iterator it) {
+    auto size = it->second.data->size();
+    if (it->second.queue == Queue::A1in) {
+        shard.a1in.erase(it->second.pos);
+        shard.a1in_bytes -= size;
+    }
+    else {
+        shard.am.erase(it->second.pos);
+    }
+    shard.bytes -= size;
+    shard.map.erase(it);
+}
+
+void CachedBackend::evict_locked(Shard &shard) {
+    while (shard.bytes > shard_capacity_ && !shard.map.empty()) {
+        std::uint64_t victim;
+        if (!shard.a1in.empty() && (shard.a1in_bytes > a1in_capacity_ || shard.am.empty())) {
+            // A1in 超额：FIFO 尾部淘汰，页号记入 A1out
+            victim = shard.a1in.back();
+            shard.a1out.push_front(victim);
+            shard.ghosts[victim] = shard.a1out.begin();
+            if (shard.ghosts.size() > ghost_capacity_) {
+                shard.ghosts.erase(shard.a1out.back());
+                shard.a1out.pop_back();
+            }
+        }
+        else {
+            victim = shard.am.back();
+        }
+        remove_locked(shard, shard.map.find(victim));
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void CachedBackend::invalidate(std::uint64_t page) {
+    auto &shard = shard_of(page);
+    std::lock_guard lock(shard.mutex);
+    ++shard.generation;
+    if (auto it = shard.map.find(page); it != shard.map.end())
+        remove_locked(shard, it);
+}
+
+void CachedBackend::update(std::uint64_t page, std::size_t page_offset, const std::uint8_t *data, std::size_t length,
+                           bool replace_whole) {
+    auto &shard = shard_of(page);
+    std::lock_guard lock(shard.mutex);
+    ++shard.generation;
+    if (auto it = shard.map.find(page); it != shard.map.end()) {
+        // 缓存页可能正被借出发送，不原地修改
+        auto copy = std::make_shared<std::vector<std::uint8_t>>(*it->second.data);
+        std::memcpy(copy->data() + page_offset, data, length);
+        it->second.data = std::move(copy);
+        return;
+    }
+    // 整页写入按一次访问走 2Q 准入，与读未命中相同
+    if (replace_whole)
+        insert_locked(shard, page, std::make_shared<const std::vector<std::uint8_t>>(data, data + length));
+}
+
+std::size_t CachedBackend::read(std::uint64_t lba, std::uint16_t count, void *buffer) {
+    if (count == 0 || lba + count > inner_->block_count())
+        return 0;
+    auto bs = inner_->block_size();
+    auto begin = lba * bs;
+    auto end = begin + static_cast<std::uint64_t>(count) * bs;
+    auto first_page = begin / options_.page_size;
+    auto last_page = (end - 1) / options_.page_size;
+    auto page_num = static_cast<std::size_t>(last_page - first_page + 1);
+
+    std::vector<PageData> pages(page_num);
+    std::uint64_t hit = 0;
+    for (std::size_t i = 0; i < page_num; ++i) {
+        pages[i] = lookup(first_page + i);
+        hit += pages[i] ? 1 : 0;
+    }
+    hits_.fetch_add(hit, std::memory_order_relaxed);
+    misses_.fetch_add(page_num - hit, std::memory_order_relaxed);
+
+    // 连续未命中的页合并成一次底层读，按整页读入
+    const auto max_pages_per_read = std::max<std::size_t>(1, 0xFFFF / blocks_per_page_);
+    for (std::size_t i = 0; i < page_num;) {
+        if (pages[i]) {
+            ++i;
+            continue;
+        }
+        auto run = std::size_t{1};
+        while (i + run < page_num && !pages[i + run] && run < max_pages_per_read)
+            ++run;
+        std::vector<std::uint64_t> generations(run);
+        for (std::size_t k = 0; k < run; ++k)
+            generations[k] = generation_of(first_page + i + k);
+
+        auto run_lba = (first_page + i) * blocks_per_page_;
+        auto run_blocks = std::min<std::uint64_t>(run * blocks_per_page_, inner_->block_count() - run_lba);
+        std::vector<std::uint8_t> tmp(static_cast<std::size_t>(run_blocks) * bs);
+        if (inner_->read(run_lba, static_cast<std::uint16_t>(run_blocks), tmp.data()) != tmp.size()) {
+            SPDLOG_ERROR("缓存未命中读取底层失败: LBA={} count={}", run_lba, run_blocks);
+            return 0;
+        }
+        std::size_t off = 0;
+        for (std::size_t k = 0; k < run; ++k) {
+            auto page = first_page + i + k;
+            auto size = page_bytes(page);
+            auto data = std::make_shared<const std::vector<std::uint8_t>>(tmp.begin() + off, tmp.begin() + off + size);
+            off += size;
+            pages[i + k] = data;
+            insert(page, std::move(data), generations[k]);
+        }
+        i += run;
+    }
+
+    auto *out = static_cast<std::uint8_t *>(buffer);
+    for (std::size_t i = 0; i < page_num; ++i) {
+        auto page_begin = (first_page + i) * options_.page_size;
+        auto s = std::max(begin, page_begin);
+        auto e = std::min(end, page_begin + pages[i]->size());
+        std::memcpy(out + (s - begin), pages[i]->data() + (s - page_begin), static_cast<std::size_t>(e - s));
+    }
+    return static_cast<std::size_t>(count) * bs;
+}
+
+bool CachedBackend::read_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) {
+    if (count == 0 || lba + count > inner_->block_count())
+        return false;
+    auto bs = inner_->block_size();
+    auto begin = lba * bs;
+    auto end = begin + static_cast<std::uint64_t>(count) * bs;
+    auto first_page = begin / options_.page_size;
+    auto last_page = (end - 1) / options_.page_size;
+    auto page_num = static_cast<std::size_t>(last_page - first_page + 1);
+
+    auto pages = std::make_shared<std::vector<PageData>>(page_num);
+    for (std::size_t i = 0; i < page_num; ++i) {
+        (*pages)[i] = lookup(first_page + i);
+        if (!(*pages)[i])
+            return false; // 由 read() 读底层并计入未命中
+    }
+    hits_.fetch_add(page_num, std::memory_order_relaxed);
+
+    out.segments.clear();
+    for (std::size_t i = 0; i < page_num; ++i) {
+        auto page_begin = (first_page + i) * options_.page_size;
+        auto s = std::max(begin, page_begin);
+        auto e = std::min(end, page_begin + (*pages)[i]->size());
+        // 缓存页不可变，借出的段只读
+        auto *data = const_cast<std::uint8_t *>((*pages)[i]->data());
+        out.segments.push_back({data + (s - page_begin), static_cast<std::size_t>(e - s)});
+    }
+    out.keepalive = std::move(pages);
+    return true;
+}
+
+std::size_t CachedBackend::write(std::uint64_t lba, std::uint16_t count, const void *data) {
+    if (count == 0 || lba + count > inner_->block_count())
+        return 0;
+    auto bs = inner_->block_size();
+    auto begin = lba * bs;
+    auto end = begin + static_cast<std::uint64_t>(count) * bs;
+    auto first_page = begin / options_.page_size;
+    auto last_page = (end - 1) / options_.page_size;
+
+    auto written = inner_->write(lba, count, data);
+    // 底层写失败时内容不确定，一律作废
+    bool around = options_.write_mode == CacheWriteMode::WriteAround ||
+                  written != static_cast<std::size_t>(count) * bs;
+    auto *src = static_cast<const std::uint8_t *>(data);
+    for (auto page = first_page; page <= last_page; ++page) {
+        if (around) {
+            invalidate(page);
+            continue;
+        }
+        auto page_begin = page * options_.page_size;
+        auto s = std::max(begin, page_begin);
+        auto e = std::min(end, page_begin + page_bytes(page));
+        bool whole = s == page_begin && e == page_begin + page_bytes(page);
+        update(page, static_cast<std::size_t>(s - page_begin), src + (s - begin), static_cast<std::size_t>(e - s),
+               whole);
+    }
+    return written;
+}
+
+void CachedBackend::punch_hole(std::uint64_t lba, std::uint64_t count) {
+    inner_->punch_hole(lba, count);
+    if (count == 0 || lba >= inner_->block_count())
+        return;
+    auto first_page = lba / blocks_per_page_;
+    auto last_page = (std::min(lba + count, inner_->block_count()) - 1) / blocks_per_page_;
+    if (last_page - first_page < INVALIDATE_SCAN_THRESHOLD) {
+        for (auto page = first_page; page <= last_page; ++page)
+            invalidate(page);
+        return;
+    }
+    for (auto &shard: shards_) {
+        std::lock_guard lock(shard->mutex);
+        ++shard->generation;
+        for (auto it = shard->map.begin(); it != shard->map.end();) {
+            auto next = std::next(it);
+            if (it->first >= first_page && it->first <= last_page)
+                remove_locked(*shard, it);
+            it = next;
+        }
+    }
+}
+
+void CachedBackend::prefetch(std::uint64_t lba, std::uint64_t count) {
+    inner_->prefetch(lba, count);
+}
+
+bool CachedBackend::flush(std::uint64_t lba, std::uint64_t count) {
+    return inner_->flush(lba, count);
+}
+
+void CachedBackend::clear() {
+    for (auto &shard: shards_) {
+        std::lock_guard lock(shard->mutex);
+        ++shard->generation;
+        shard->map.clear();
+        shard->a1in.clear();
+        shard->am.clear();
+        shard->a1out.clear();
+        shard->ghosts.clear();
+        shard->a1in_bytes = 0;
+        shard->bytes = 0;
+    }
+}
+
+CachedBackend::CacheStats CachedBackend::cache_stats() const {
+    std::size_t bytes = 0;
+    for (auto &shard: shards_) {
+        std::lock_guard lock(shard->mutex);
+        bytes += shard->bytes;
+    }
+    return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+            ghost_hits_.load(std::memory_order_relaxed), evictions_.load(std::memory_order_relaxed), bytes};
+}
+
+} // namespace usbipdcpp
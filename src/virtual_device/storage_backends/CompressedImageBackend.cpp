@@ -0,0 +1,729 @@
+// clang-format off
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+// clang-format on
+
+#include "usbipdcpp/virtual_device/storage_backends/CompressedImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/StorageFileIo.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <optional>
+#include <spdlog/spdlog.h>
+
+#ifdef USBIPDCPP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef USBIPDCPP_HAVE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+namespace usbipdcpp {
+
+using namespace detail;
+
+namespace {
+
+    /**
+     * 压缩镜像文件格式（小端）：
+     *   [ImageHeader 48 字节][chunk 0 数据][chunk 1 数据]...[ChunkEntry × chunk_count]
+     * 索引放在文件尾部，转换时可以边压缩边顺序写出。
+     */
+    constexpr char IMAGE_MAGIC[8] = {'U', 'S', 'B', 'I', 'P', 'C', 'I', 'M'};
+    constexpr std::uint32_t IMAGE_VERSION = 1;
+
+    struct ImageHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t codec; // ChunkCodec
+        std::uint32_t block_size;
+        std::uint32_t chunk_size;
+        std::uint64_t image_size; // 解压后镜像总字节数
+        std::uint64_t chunk_count;
+        std::uint64_t index_offset;
+    };
+    static_assert(sizeof(ImageHeader) == 48);
+
+    struct DiskChunkEntry {
+        std::uint64_t offset;
+        std::uint32_t stored_size;
+        std::uint32_t flags;
+    };
+    static_assert(sizeof(DiskChunkEntry) == 16);
+
+    constexpr std::uint32_t CHUNK_FLAG_RAW = 1u << 0; // 未压缩存储
+    constexpr std::uint32_t CHUNK_FLAG_ZERO = 1u << 1; // 全零，不占文件空间
+
+    // ---- 编解码 ----
+
+#ifdef USBIPDCPP_HAVE_ZSTD
+    /** 每线程复用解压上下文，避免 ZSTD_decompress 每次内部分配 */
+    ZSTD_DCtx *thread_zstd_dctx() {
+        thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+        return ctx.get();
+    }
+#endif
+
+    bool decompress_chunk(ChunkCodec codec, const std::uint8_t *src, std::size_t src_size, std::uint8_t *dst,
+                          std::size_t dst_size) {
+        switch (codec) {
+#ifdef USBIPDCPP_HAVE_ZSTD
+            case ChunkCodec::Zstd: {
+                auto n = ZSTD_decompressDCtx(thread_zstd_dctx(), dst, dst_size, src, src_size);
+                return !ZSTD_isError(n) && n == dst_size;
+            }
+#endif
+#ifdef USBIPDCPP_HAVE_LZ4
+            case ChunkCodec::Lz4: {
+                auto n = LZ4_decompress_safe(reinterpret_cast<const char *>(src), reinterpret_cast<char *>(dst),
+                                             static_cast<int>(src_size), static_cast<int>(dst_size));
+                return n >= 0 && static_cast<std::size_t>(n) == dst_size;
+            }
+#endif
+            default:
+                return false;
+        }
+    }
+
+    /** @return 压缩后字节数，0 表示失败或不值得压缩（调用者按 RAW 存储） */
+    std::size_t compress_chunk(ChunkCodec codec, int level, const std::uint8_t *src, std::size_t src_size,
+                               std::vector<std::uint8_t> &dst) {
+        switch (codec) {
+#ifdef USBIPDCPP_HAVE_ZSTD
+            case ChunkCodec::Zstd: {
+                dst.resize(ZSTD_compressBound(src_size));
+                auto n = ZSTD_compress(dst.data(), dst.size(), src, src_size, level);
+                return ZSTD_isError(n) ? 0 : n;
+            }
+#endif
+#ifdef USBIPDCPP_HAVE_LZ4
+            case ChunkCodec::Lz4: {
+                dst.resize(static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(src_size))));
+                auto *in = reinterpret_cast<const char *>(src);
+                auto *out = reinterpret_cast<char *>(dst.data());
+                int n = level >= 2
+                                ? LZ4_compress_HC(in, out, static_cast<int>(src_size), static_cast<int>(dst.size()),
+                                                  level)
+                                : LZ4_compress_default(in, out, static_cast<int>(src_size),
+                                                       static_cast<int>(dst.size()));
+                return n > 0 ? static_cast<std::size_t>(n) : 0;
+            }
+#endif
+            default:
+                return 0;
+        }
+    }
+
+} // namespace
+
+bool CompressedImageBackend::codec_supported(ChunkCodec codec) {
+    switch (codec) {
+        case ChunkCodec::None:
+            return true;
+        case ChunkCodec::Lz4:
+#ifdef USBIPDCPP_HAVE_LZ4
+            return true;
+#else
+            return false;
+#endif
+        case ChunkCodec::Zstd:
+#ifdef USBIPDCPP_HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+CompressedImageBackend::CompressedImageBackend(std::string path, CompressedImageOptions options) :
+    path_(std::move(path)), options_(std::move(options)) {
+
+    SPDLOG_INFO("压缩镜像路径: {}", std::filesystem::absolute(path_).string());
+
+    native_fd fd = open_file(path_, false, false);
+    if (fd == invalid_fd) {
+        SPDLOG_ERROR("无法打开压缩镜像: {}", path_);
+        return;
+    }
+
+    ImageHeader header{};
+    if (!pread_all(fd, &header, sizeof(header), 0) || std::memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 ||
+        header.version != IMAGE_VERSION) {
+        SPDLOG_ERROR("不是有效的压缩镜像: {}", path_);
+        close_file(fd);
+        return;
+    }
+    codec_ = static_cast<ChunkCodec>(header.codec);
+    if (!codec_supported(codec_)) {
+        SPDLOG_ERROR("压缩镜像使用的编解码器 {} 未编译进本库", header.codec);
+        close_file(fd);
+        return;
+    }
+    if (header.block_size == 0 || header.chunk_size == 0 || header.chunk_size % header.block_size != 0 ||
+        header.chunk_count != (header.image_size + header.chunk_size - 1) / header.chunk_size) {
+        SPDLOG_ERROR("压缩镜像头部参数非法: block_size={} chunk_size={} chunk_count={}", header.block_size,
+                     header.chunk_size, header.chunk_count);
+        close_file(fd);
+        return;
+    }
+
+    // 索引和每个 chunk 都必须落在文件内：截断或损坏的镜像在打开时拒绝，而不是读到一半才失败
+    auto image_file_size = file_size(fd);
+    if (header.index_offset > image_file_size ||
+        header.chunk_count > (image_file_size - header.index_offset) / sizeof(DiskChunkEntry)) {
+        SPDLOG_ERROR("压缩镜像索引超出文件范围: {}", path_);
+        close_file(fd);
+        return;
+    }
+    std::vector<DiskChunkEntry> disk_index(header.chunk_count);
+    if (!pread_all(fd, disk_index.data(), disk_index.size() * sizeof(DiskChunkEntry), header.index_offset)) {
+        SPDLOG_ERROR("读取压缩镜像索引失败: {}", path_);
+        close_file(fd);
+        return;
+    }
+    index_.reserve(disk_index.size());
+    for (std::size_t i = 0; i < disk_index.size(); ++i) {
+        auto &e = disk_index[i];
+        if (!(e.flags & CHUNK_FLAG_ZERO) &&
+            (e.offset < sizeof(ImageHeader) || e.offset > image_file_size ||
+             e.stored_size > image_file_size - e.offset)) {
+            SPDLOG_ERROR("压缩镜像 chunk {} 超出文件范围: offset={} size={}，文件 {} 字节", i, e.offset,
+                         e.stored_size, image_file_size);
+            index_.clear();
+            close_file(fd);
+            return;
+        }
+        index_.push_back({e.offset, e.stored_size, e.flags});
+    }
+
+    block_size_ = header.block_size;
+    chunk_size_ = header.chunk_size;
+    image_size_ = header.image_size;
+    block_count_ = image_size_ / block_size_;
+
+    auto shard_count = std::max<std::size_t>(1, options_.cache_shards);
+    shards_.reserve(shard_count);
+    for (std::size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<CacheShard>());
+    }
+    // 每片至少能放下一个 chunk，否则缓存形同虚设
+    shard_capacity_ = std::max<std::size_t>(options_.cache_bytes / shard_count, chunk_size_);
+    zero_chunk_ = std::make_shared<const std::vector<std::uint8_t>>(chunk_size_, 0);
+
+    if (options_.decompress_threads != 1) {
+        pool_ = std::make_unique<ThreadPool>(options_.decompress_threads);
+    }
+
+    auto overlay_path = options_.overlay_path.empty() ? path_ + ".overlay" : options_.overlay_path;
+    if (!open_overlay(overlay_path)) {
+        close_file(fd);
+        return;
+    }
+    image_fd_ = fd;
+
+    SPDLOG_INFO("打开压缩镜像: {} ({} 块, {} MiB, {} 个 chunk × {} KiB)", path_, block_count_,
+                image_size_ / 1024 / 1024, index_.size(), chunk_size_ / 1024);
+}
+
+CompressedImageBackend::~CompressedImageBackend() {
+    // 先停线程池，保证没有解压任务还在访问文件
+    pool_.reset();
+    if (image_fd_ != invalid_fd)
+        close_file(image_fd_);
+    if (overlay_fd_ != invalid_fd)
+        close_file(overlay_fd_);
+    if (bitmap_fd_ != invalid_fd)
+        close_file(bitmap_fd_);
+}
+
+bool CompressedImageBackend::open_overlay(const std::string &overlay_path) {
+    overlay_fd_ = open_file(overlay_path, true, true);
+    if (overlay_fd_ == invalid_fd) {
+        SPDLOG_ERROR("无法打开/创建覆盖层文件: {}", overlay_path);
+        return false;
+    }
+    auto existing = file_size(overlay_fd_);
+    if (existing != image_size_ && !resize_file(overlay_fd_, image_size_)) {
+        SPDLOG_ERROR("覆盖层文件扩展失败: {}", overlay_path);
+        close_file(overlay_fd_);
+        overlay_fd_ = invalid_fd;
+        return false;
+    }
+
+    auto bitmap_path = overlay_path + ".map";
+    bitmap_fd_ = open_file(bitmap_path, true, true);
+    if (bitmap_fd_ == invalid_fd) {
+        SPDLOG_ERROR("无法打开/创建覆盖层位图: {}", bitmap_path);
+        close_file(overlay_fd_);
+        overlay_fd_ = invalid_fd;
+        return false;
+    }
+
+    overlay_bitmap_.assign((block_count_ + 63) / 64, 0);
+    overlay_blocks_per_chunk_.assign(index_.size(), 0);
+    auto bitmap_bytes = overlay_bitmap_.size() * sizeof(std::uint64_t);
+    // 覆盖层尺寸与位图不匹配说明是旧镜像遗留，两者一起重置
+    if (existing == image_size_ && file_size(bitmap_fd_) == bitmap_bytes) {
+        if (!pread_all(bitmap_fd_, overlay_bitmap_.data(), bitmap_bytes, 0)) {
+            SPDLOG_WARN("读取覆盖层位图失败，视为空覆盖层");
+            overlay_bitmap_.assign(overlay_bitmap_.size(), 0);
+        }
+    }
+    else {
+        resize_file(bitmap_fd_, bitmap_bytes);
+        zero_range(overlay_fd_, 0, image_size_);
+    }
+
+    auto blocks_per_chunk = chunk_size_ / block_size_;
+    std::uint64_t overlaid = 0;
+    for (std::uint64_t lba = 0; lba < block_count_; ++lba) {
+        if (block_in_overlay(lba)) {
+            ++overlay_blocks_per_chunk_[lba / blocks_per_chunk];
+            ++overlaid;
+        }
+    }
+    if (overlaid > 0) {
+        SPDLOG_INFO("覆盖层已有 {} 块写入数据", overlaid);
+    }
+    return true;
+}
+
+bool CompressedImageBackend::mark_overlay(std::uint64_t lba, std::uint64_t count) {
+    auto blocks_per_chunk = chunk_size_ / block_size_;
+    // 只改写已在覆盖层中的块时位图不变，不必同步
+    auto fresh = lba;
+    while (fresh < lba + count && block_in_overlay(fresh)) {
+        ++fresh;
+    }
+    if (fresh == lba + count) {
+        return true;
+    }
+    // 位图先于数据落盘的话，掉电后这些块会从覆盖层读出零或旧内容：数据同步后才置位
+    if (!sync_file(overlay_fd_)) {
+        SPDLOG_ERROR("覆盖层同步失败，不标记新写入的块: LBA={} count={}", lba, count);
+        return false;
+    }
+    for (auto b = fresh; b < lba + count; ++b) {
+        auto &word = overlay_bitmap_[b / 64];
+        auto bit = std::uint64_t{1} << (b % 64);
+        if (!(word & bit)) {
+            word |= bit;
+            ++overlay_blocks_per_chunk_[b / blocks_per_chunk];
+        }
+    }
+    // 只写回被改动的位图字
+    auto first = lba / 64;
+    auto last = (lba + count - 1) / 64;
+    if (!pwrite_all(bitmap_fd_, &overlay_bitmap_[first], (last - first + 1) * sizeof(std::uint64_t),
+                    first * sizeof(std::uint64_t))) {
+        SPDLOG_WARN("覆盖层位图写回失败: LBA={} count={}", lba, count);
+    }
+    return true;
+}
+
+CompressedImageBackend::ChunkData CompressedImageBackend::cache_lookup(std::uint64_t chunk) {
+    auto &shard = shard_of(chunk);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.map.find(chunk);
+    if (it == shard.map.end()) {
+        return nullptr;
+    }
+    // 移到 LRU 头部
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+    return it->second.first;
+}
+
+bool CompressedImageBackend::cache_contains(std::uint64_t chunk) {
+    auto &shard = shard_of(chunk);
+    std::lock_guard lock(shard.mutex);
+    return shard.map.contains(chunk);
+}
+
+void CompressedImageBackend::cache_insert(std::uint64_t chunk, const ChunkData &data) {
+    auto &shard = shard_of(chunk);
+    std::lock_guard lock(shard.mutex);
+    // 两个线程同时未命中同一 chunk 时，后插入者直接丢弃
+    if (shard.map.contains(chunk)) {
+        return;
+    }
+    shard.lru.push_front(chunk);
+    shard.map.emplace(chunk, std::make_pair(data, shard.lru.begin()));
+    shard.bytes += data->size();
+    while (shard.bytes > shard_capacity_ && shard.lru.size() > 1) {
+        auto victim = shard.lru.back();
+        auto it = shard.map.find(victim);
+        shard.bytes -= it->second.first->size();
+        shard.map.erase(it);
+        shard.lru.pop_back();
+    }
+}
+
+CompressedImageBackend::CacheStats CompressedImageBackend::cache_stats() const {
+    std::size_t bytes = 0;
+    for (auto &shard: shards_) {
+        std::lock_guard lock(shard->mutex);
+        bytes += shard->bytes;
+    }
+    return {cache_hits_.load(std::memory_order_relaxed), cache_misses_.load(std::memory_order_relaxed), bytes};
+}
+
+CompressedImageBackend::ChunkData CompressedImageBackend::load_chunk(std::uint64_t chunk) {
+    auto &entry = index_[chunk];
+    if (entry.flags & CHUNK_FLAG_ZERO) {
+        return zero_chunk_;
+    }
+    if (auto cached = cache_lookup(chunk)) {
+        cache_hits_.fetch_add(1, std::memory_order_relaxed);
+        return cached;
+    }
+    cache_misses_.fetch_add(1, std::memory_order_relaxed);
+
+    // 最后一个 chunk 可能不满
+    auto raw_size = static_cast<std::size_t>(std::min<std::uint64_t>(chunk_size_, image_size_ - chunk * chunk_size_));
+    auto data = std::make_shared<std::vector<std::uint8_t>>(raw_size);
+    if (entry.flags & CHUNK_FLAG_RAW) {
+        if (entry.stored_size != raw_size || !pread_all(image_fd_, data->data(), raw_size, entry.offset)) {
+            SPDLOG_ERROR("读取 chunk {} 失败", chunk);
+            return nullptr;
+        }
+    }
+    else {
+        thread_local std::vector<std::uint8_t> compressed;
+        compressed.resize(entry.stored_size);
+        if (!pread_all(image_fd_, compressed.data(), compressed.size(), entry.offset) ||
+            !decompress_chunk(codec_, compressed.data(), compressed.size(), data->data(), raw_size)) {
+            SPDLOG_ERROR("解压 chunk {} 失败", chunk);
+            return nullptr;
+        }
+    }
+    ChunkData result = std::move(data);
+    cache_insert(chunk, result);
+    return result;
+}
+
+std::size_t CompressedImageBackend::read(std::uint64_t lba, std::uint16_t count, void *buffer) {
+    if (!is_valid() || lba + count > block_count_) {
+        return 0;
+    }
+    auto *out = static_cast<std::uint8_t *>(buffer);
+    auto total = static_cast<std::size_t>(count) * block_size_;
+    auto begin = lba * block_size_;
+    auto end = begin + total;
+    auto first_chunk = begin / chunk_size_;
+    auto last_chunk = (end - 1) / chunk_size_;
+    auto chunk_num = static_cast<std::size_t>(last_chunk - first_chunk + 1);
+    auto blocks_per_chunk = chunk_size_ / block_size_;
+
+    // 读期间持共享锁：覆盖层位图与内容不会被并发写改变
+    std::shared_lock lock(overlay_mutex_);
+
+    // 1. 收集需要的 chunk，未命中的并行解压（整块被覆盖的 chunk 不必解压）
+    std::vector<ChunkData> chunks(chunk_num);
+    collect_chunks(first_chunk, chunks);
+    bool failed = false;
+
+    // 2. 按 chunk 拷贝，再用覆盖层中的块覆盖
+    for (std::size_t i = 0; i < chunk_num; ++i) {
+        auto c = first_chunk + i;
+        auto chunk_begin = c * chunk_size_;
+        auto copy_begin = std::max(begin, chunk_begin);
+        auto copy_end = std::min(end, chunk_begin + chunk_size_);
+        auto *dst = out + (copy_begin - begin);
+
+        if (overlay_blocks_per_chunk_[c] != blocks_per_chunk) {
+            if (!chunks[i]) {
+                failed = true;
+                break;
+            }
+            std::memcpy(dst, chunks[i]->data() + (copy_begin - chunk_begin), copy_end - copy_begin);
+        }
+        if (overlay_blocks_per_chunk_[c] == 0) {
+            continue;
+        }
+        // 合并连续的覆盖块为一次 pread
+        auto b = copy_begin / block_size_;
+        auto b_end = copy_end / block_size_;
+        while (b < b_end) {
+            if (!block_in_overlay(b)) {
+                ++b;
+                continue;
+            }
+            auto run_end = b + 1;
+            while (run_end < b_end && block_in_overlay(run_end)) {
+                ++run_end;
+            }
+            if (!pread_all(overlay_fd_, out + (b * block_size_ - begin), (run_end - b) * block_size_,
+                           b * block_size_)) {
+                failed = true;
+                break;
+            }
+            b = run_end;
+        }
+        if (failed)
+            break;
+    }
+    if (failed) {
+        SPDLOG_ERROR("压缩镜像读取失败: LBA={} count={}", lba, count);
+        return 0;
+    }
+    return total;
+}
+
+void CompressedImageBackend::collect_chunks(std::uint64_t first_chunk, std::vector<ChunkData> &chunks) {
+    auto blocks_per_chunk = chunk_size_ / block_size_;
+    std::vector<std::pair<std::size_t, std::future<ChunkData>>> pending;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        auto c = first_chunk + i;
+        if (overlay_blocks_per_chunk_[c] == blocks_per_chunk) {
+            continue;
+        }
+        if (pool_ && chunks.size() > 1) {
+            if (index_[c].flags & CHUNK_FLAG_ZERO) {
+                chunks[i] = zero_chunk_;
+            }
+            else if (auto cached = cache_lookup(c)) {
+                cache_hits_.fetch_add(1, std::memory_order_relaxed);
+                chunks[i] = std::move(cached);
+            }
+            else {
+                pending.emplace_back(i, pool_->submit([this, c] { return load_chunk(c); }));
+            }
+        }
+        else {
+            chunks[i] = load_chunk(c);
+        }
+    }
+    for (auto &[i, fut]: pending) {
+        chunks[i] = fut.get();
+    }
+}
+
+bool CompressedImageBackend::read_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) {
+    if (!is_valid() || lba + count > block_count_ || count == 0) {
+        return false;
+    }
+    auto begin = lba * block_size_;
+    auto end = begin + static_cast<std::uint64_t>(count) * block_size_;
+    auto first_chunk = begin / chunk_size_;
+    auto last_chunk = (end - 1) / chunk_size_;
+    auto chunk_num = static_cast<std::size_t>(last_chunk - first_chunk + 1);
+
+    std::shared_lock lock(overlay_mutex_);
+    // 范围内有覆盖块时数据要和覆盖层合并，不能直接借出缓存
+    for (auto c = first_chunk; c <= last_chunk; ++c) {
+        if (overlay_blocks_per_chunk_[c] != 0) {
+            return false;
+        }
+    }
+    auto chunks = std::make_shared<std::vector<ChunkData>>(chunk_num);
+    collect_chunks(first_chunk, *chunks);
+
+    out.segments.clear();
+    for (std::size_t i = 0; i < chunk_num; ++i) {
+        if (!(*chunks)[i]) {
+            SPDLOG_ERROR("压缩镜像读取失败: LBA={} count={}", lba, count);
+            out.clear();
+            return false;
+        }
+        auto chunk_begin = (first_chunk + i) * chunk_size_;
+        auto seg_begin = std::max(begin, chunk_begin);
+        auto seg_end = std::min(end, chunk_begin + chunk_size_);
+        // 缓存中的 chunk 不可变，借出的段只读
+        auto *data = const_cast<std::uint8_t *>((*chunks)[i]->data());
+        out.segments.push_back({data + (seg_begin - chunk_begin), static_cast<std::size_t>(seg_end - seg_begin)});
+    }
+    // 持有这些 chunk 的引用：发送期间被 LRU 淘汰也不会释放
+    out.keepalive = std::move(chunks);
+    return true;
+}
+
+std::size_t CompressedImageBackend::write(std::uint64_t lba, std::uint16_t count, const void *data) {
+    if (!is_valid() || lba + count > block_count_ || count == 0) {
+        return 0;
+    }
+    auto total = static_cast<std::size_t>(count) * block_size_;
+    std::unique_lock lock(overlay_mutex_);
+    if (!pwrite_all(overlay_fd_, data, total, lba * block_size_)) {
+        SPDLOG_ERROR("覆盖层写入失败: LBA={} count={}", lba, count);
+        return 0;
+    }
+    if (!mark_overlay(lba, count)) {
+        return 0;
+    }
+    return total;
+}
+
+void CompressedImageBackend::punch_hole(std::uint64_t lba, std::uint64_t count) {
+    if (!is_valid() || lba + count > block_count_ || count == 0) {
+        return;
+    }
+    // 覆盖层中打洞即为零，标记后读这些块返回零，底层压缩数据不变
+    std::unique_lock lock(overlay_mutex_);
+    if (!zero_range(overlay_fd_, lba * block_size_, count * block_size_)) {
+        SPDLOG_WARN("punch_hole 失败: LBA={} count={}", lba, count);
+        return;
+    }
+    mark_overlay(lba, count);
+}
+
+bool CompressedImageBackend::flush(std::uint64_t lba, std::uint64_t count) {
+    if (!is_valid()) {
+        return false;
+    }
+    // 新置位的块数据在 mark_overlay 中已先于位图同步；这里把改写的数据和位图一起落盘，
+    // 否则重启后已写块会读回压缩镜像的旧数据
+    std::shared_lock lock(overlay_mutex_);
+    if (!sync_file(overlay_fd_) || !sync_file(bitmap_fd_)) {
+        SPDLOG_ERROR("覆盖层同步失败: {}", path_);
+        return false;
+    }
+    return true;
+}
+
+void CompressedImageBackend::prefetch(std::uint64_t lba, std::uint64_t count) {
+    if (!is_valid() || !pool_ || count == 0 || lba >= block_count_) {
+        return;
+    }
+    count = std::min(count, block_count_ - lba);
+    auto first_chunk = lba * block_size_ / chunk_size_;
+    auto last_chunk = ((lba + count) * block_size_ - 1) / chunk_size_;
+    auto blocks_per_chunk = chunk_size_ / block_size_;
+    // 预读最多占用两倍线程数的排队任务，避免挤占前台读的并行解压
+    auto inflight_limit = pool_->size() * 2;
+
+    std::shared_lock lock(overlay_mutex_);
+    for (auto c = first_chunk; c <= last_chunk; ++c) {
+        if ((index_[c].flags & CHUNK_FLAG_ZERO) || overlay_blocks_per_chunk_[c] == blocks_per_chunk ||
+            cache_contains(c)) {
+            continue;
+        }
+        if (prefetch_inflight_.fetch_add(1, std::memory_order_relaxed) >= inflight_limit) {
+            prefetch_inflight_.fetch_sub(1, std::memory_order_relaxed);
+            break;
+        }
+        // 不等待 future：解压结果进缓存即可，析构时线程池会先跑完剩余任务
+        pool_->submit([this, c] {
+            load_chunk(c);
+            prefetch_inflight_.fetch_sub(1, std::memory_order_relaxed);
+        });
+    }
+}
+
+bool CompressedImageBackend::convert_raw_image(const std::string &raw_path, const std::string &out_path,
+                                               ChunkCodec codec, std::uint32_t chunk_size, int level,
+                                               std::uint32_t block_size) {
+    if (!codec_supported(codec)) {
+        SPDLOG_ERROR("编解码器 {} 未编译进本库", static_cast<std::uint32_t>(codec));
+        return false;
+    }
+    if (block_size == 0 || chunk_size == 0 || chunk_size % block_size != 0) {
+        SPDLOG_ERROR("chunk_size {} 必须是 block_size {} 的整数倍", chunk_size, block_size);
+        return false;
+    }
+
+    native_fd in = open_file(raw_path, false, false);
+    if (in == invalid_fd) {
+        SPDLOG_ERROR("无法打开 raw 镜像: {}", raw_path);
+        return false;
+    }
+    native_fd out = open_file(out_path, true, true);
+    if (out == invalid_fd) {
+        SPDLOG_ERROR("无法创建压缩镜像: {}", out_path);
+        close_file(in);
+        return false;
+    }
+    resize_file(out, 0);
+
+    ImageHeader header{};
+    std::memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.version = IMAGE_VERSION;
+    header.codec = static_cast<std::uint32_t>(codec);
+    header.block_size = block_size;
+    header.chunk_size = chunk_size;
+    // 不满一块的尾部丢弃，与 RawImageBackend 的块数估算一致
+    header.image_size = file_size(in) / block_size * block_size;
+    header.chunk_count = (header.image_size + chunk_size - 1) / chunk_size;
+
+    struct Compressed {
+        std::vector<std::uint8_t> data;
+        std::uint32_t flags = 0;
+    };
+    auto compress_one = [&](std::uint64_t chunk) -> std::optional<Compressed> {
+        auto raw_size = static_cast<std::size_t>(
+                std::min<std::uint64_t>(chunk_size, header.image_size - chunk * chunk_size));
+        std::vector<std::uint8_t> raw(raw_size);
+        if (!pread_all(in, raw.data(), raw_size, chunk * chunk_size)) {
+            return std::nullopt;
+        }
+        Compressed result;
+        if (std::all_of(raw.begin(), raw.end(), [](std::uint8_t b) { return b == 0; })) {
+            result.flags = CHUNK_FLAG_ZERO;
+            return result;
+        }
+        if (codec != ChunkCodec::None) {
+            auto n = compress_chunk(codec, level, raw.data(), raw_size, result.data);
+            if (n > 0 && n < raw_size) {
+                result.data.resize(n);
+                return result;
+            }
+        }
+        result.data = std::move(raw);
+        result.flags = CHUNK_FLAG_RAW;
+        return result;
+    };
+
+    // 按批并行压缩，按 chunk 顺序写出
+    ThreadPool pool;
+    std::vector<DiskChunkEntry> index(header.chunk_count);
+    std::uint64_t write_offset = sizeof(ImageHeader);
+    bool ok = true;
+    auto batch = pool.size() * 4;
+    for (std::uint64_t first = 0; ok && first < header.chunk_count; first += batch) {
+        auto last = std::min<std::uint64_t>(first + batch, header.chunk_count);
+        std::vector<std::future<std::optional<Compressed>>> futures;
+        for (auto c = first; c < last; ++c) {
+            futures.push_back(pool.submit([&compress_one, c] { return compress_one(c); }));
+        }
+        for (auto c = first; c < last; ++c) {
+            auto result = futures[c - first].get();
+            if (!ok)
+                continue;
+            if (!result) {
+                SPDLOG_ERROR("读取 raw 镜像失败: chunk {}", c);
+                ok = false;
+                continue;
+            }
+            index[c] = {write_offset, static_cast<std::uint32_t>(result->data.size()), result->flags};
+            if (!result->data.empty() && !pwrite_all(out, result->data.data(), result->data.size(), write_offset)) {
+                SPDLOG_ERROR("写入压缩镜像失败: {}", out_path);
+                ok = false;
+                continue;
+            }
+            write_offset += result->data.size();
+        }
+    }
+
+    if (ok) {
+        header.index_offset = write_offset;
+        ok = pwrite_all(out, index.data(), index.size() * sizeof(DiskChunkEntry), write_offset) &&
+             pwrite_all(out, &header, sizeof(header), 0);
+        if (ok) {
+            SPDLOG_INFO("压缩完成: {} → {} ({} MiB → {} MiB)", raw_path, out_path, header.image_size / 1024 / 1024,
+                        (write_offset + index.size() * sizeof(DiskChunkEntry)) / 1024 / 1024);
+        }
+    }
+    close_file(in);
+    close_file(out);
+    return ok;
+}
+
+} // namespace usbipdcpp
@@ -0,0 +1,332 @@
+#include "usbipdcpp/virtual_device/storage_backends/DedupBackend.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <spdlog/spdlog.h>
+
+namespace usbipdcpp {
+
+using namespace detail;
+
+namespace {
+
+    /**
+     * 映射文件格式（小端）：
+     *   [MapHeader 32 字节][uint64 store id × chunk 数]
+     * 新建时 id 区是稀疏空洞，读出来全是 0，即全零 chunk。
+     */
+    constexpr char MAP_MAGIC[8] = {'U', 'S', 'B', 'I', 'P', 'D', 'D', 'M'};
+    constexpr std::uint32_t MAP_VERSION = 1;
+
+    struct MapHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t block_size;
+        std::uint32_t chunk_size;
+        std::uint32_t reserved;
+        std::uint64_t block_count;
+    };
+    static_assert(sizeof(MapHeader) == 32);
+
+} // namespace
+
+DedupBackend::DedupBackend(std::shared_ptr<DedupStore> store, std::string map_path, std::uint64_t initial_blocks,
+                           std::uint32_t block_size) :
+    store_(std::move(store)), map_path_(std::move(map_path)), block_size_(block_size),
+    chunk_size_(store_ ? store_->chunk_size() : 0) {
+    if (!store_ || !store_->is_valid()) {
+        SPDLOG_ERROR("去重镜像 {} 的存储无效", map_path_);
+        return;
+    }
+    if (block_size_ == 0 || chunk_size_ % block_size_ != 0) {
+        SPDLOG_ERROR("去重镜像 {}: 块大小 {} 不能整除 chunk 大小 {}", map_path_, block_size_, chunk_size_);
+        return;
+    }
+
+    bool exists = std::filesystem::exists(map_path_);
+    auto fd = open_file(map_path_, true, !exists);
+    if (fd == invalid_fd) {
+        SPDLOG_ERROR("无法打开去重镜像 {}", map_path_);
+        return;
+    }
+
+    if (!exists) {
+        block_count_ = initial_blocks;
+        auto chunks = (block_count_ * block_size_ + chunk_size_ - 1) / chunk_size_;
+        if (!write_header(fd) || !resize_file(fd, sizeof(MapHeader) + chunks * 8)) {
+            SPDLOG_ERROR("无法创建去重镜像 {}", map_path_);
+            close_file(fd);
+            return;
+        }
+        map_.assign(chunks, DedupStore::ZERO_CHUNK);
+    }
+    else {
+        MapHeader header{};
+        if (!pread_all(fd, &header, sizeof(header), 0) ||
+            std::memcmp(header.magic, MAP_MAGIC, sizeof(MAP_MAGIC)) != 0 || header.version != MAP_VERSION) {
+            SPDLOG_ERROR("{} 不是有效的去重镜像", map_path_);
+            close_file(fd);
+            return;
+        }
+        if (header.block_size != block_size_ || header.chunk_size != chunk_size_) {
+            SPDLOG_ERROR("去重镜像 {} 的块/chunk 大小为 {}/{}，与当前的 {}/{} 不一致", map_path_, header.block_size,
+                         header.chunk_size, block_size_, chunk_size_);
+            close_file(fd);
+            return;
+        }
+        block_count_ = header.block_count;
+        auto chunks = (block_count_ * block_size_ + chunk_size_ - 1) / chunk_size_;
+        if (file_size(fd) < sizeof(MapHeader) + chunks * 8) {
+            SPDLOG_ERROR("去重镜像 {} 被截断：{} 块需要 {} 个 chunk 的映射", map_path_, block_count_, chunks);
+            close_file(fd);
+            return;
+        }
+        map_.resize(chunks);
+        if (!pread_all(fd, map_.data(), chunks * 8, sizeof(MapHeader))) {
+            SPDLOG_ERROR("读取去重镜像 {} 的映射失败", map_path_);
+            close_file(fd);
+            map_.clear();
+            return;
+        }
+        // 映射与存储不配套（换了存储目录、存储被截断或映射损坏）时 id 会越界，读写都会落到不存在的 chunk
+        auto store_chunks = store_->chunk_count();
+        auto bad = std::find_if(map_.begin(), map_.end(), [&](std::uint64_t id) { return id >= store_chunks; });
+        if (bad != map_.end()) {
+            SPDLOG_ERROR("去重镜像 {}: chunk {} 指向 id {}，存储 {} 只有 {} 个 chunk", map_path_, bad - map_.begin(),
+                         *bad, store_->dir(), store_chunks);
+            close_file(fd);
+            map_.clear();
+            return;
+        }
+    }
+    map_fd_ = fd;
+    SPDLOG_INFO("去重镜像 {}: {} 块 × {} 字节，{} 个 chunk", map_path_, block_count_, block_size_, map_.size());
+}
+
+DedupBackend::~DedupBackend() {
+    if (is_valid()) {
+        flush(0, block_count_);
+        close_file(map_fd_);
+    }
+}
+
+bool DedupBackend::write_header(native_fd fd) const {
+    MapHeader header{};
+    std::memcpy(header.magic, MAP_MAGIC, sizeof(MAP_MAGIC));
+    header.version = MAP_VERSION;
+    header.block_size = block_size_;
+    header.chunk_size = chunk_size_;
+    header.block_count = block_count_;
+    return pwrite_all(fd, &header, sizeof(header), 0);
+}
+
+void DedupBackend::mark_dirty(std::uint64_t chunk) {
+    dirty_begin_ = std::min(dirty_begin_, chunk);
+    dirty_end_ = std::max(dirty_end_, chunk + 1);
+}
+
+std::size_t DedupBackend::read(std::uint64_t lba, std::uint16_t count, void *buffer) {
+    if (!is_valid() || lba + count > block_count_)
+        return 0;
+    auto *dst = static_cast<std::uint8_t *>(buffer);
+    std::uint64_t offset = lba * block_size_;
+    std::uint64_t remaining = static_cast<std::uint64_t>(count) * block_size_;
+
+    std::shared_lock lock(mutex_);
+    while (remaining > 0) {
+        auto chunk = offset / chunk_size_;
+        auto in_chunk = offset % chunk_size_;
+        auto id = map_[chunk];
+        if (in_chunk == 0 && remaining >= chunk_size_) {
+            // 整 chunk：把 id 连续（或都是全零）的相邻 chunk 合并成一次读
+            std::size_t run = 1;
+            while ((run + 1) * chunk_size_ <= remaining &&
+                   map_[chunk + run] == (id == DedupStore::ZERO_CHUNK ? id : id + run))
+                ++run;
+            if (!store_->read_run(id, run, dst))
+                return 0;
+            dst += run * chunk_size_;
+            offset += run * chunk_size_;
+            remaining -= run * chunk_size_;
+            continue;
+        }
+        auto n = std::min<std::uint64_t>(chunk_size_ - in_chunk, remaining);
+        thread_local std::vector<std::uint8_t> tmp;
+        tmp.resize(chunk_size_);
+        if (!store_->read(id, tmp.data()))
+            return 0;
+        std::memcpy(dst, tmp.data() + in_chunk, n);
+        dst += n;
+        offset += n;
+        remaining -= n;
+    }
+    return static_cast<std::size_t>(count) * block_size_;
+}
+
+bool DedupBackend::write_locked(std::uint64_t offset, std::uint64_t len, const std::uint8_t *src) {
+    thread_local std::vector<std::uint8_t> tmp;
+    tmp.resize(chunk_size_);
+    while (len > 0) {
+        auto chunk = offset / chunk_size_;
+        auto in_chunk = offset % chunk_size_;
+        auto n = std::min<std::uint64_t>(chunk_size_ - in_chunk, len);
+        auto old_id = map_[chunk];
+
+        const std::uint8_t *content;
+        if (n == chunk_size_ && src) {
+            content = src;
+        }
+        else {
+            // 不满一个 chunk（或写零）：在旧内容上修改出新 chunk
+            if (n == chunk_size_)
+                std::memset(tmp.data(), 0, chunk_size_);
+            else if (!store_->read(old_id, tmp.data()))
+                return false;
+            if (src)
+                std::memcpy(tmp.data() + in_chunk, src, n);
+            else
+                std::memset(tmp.data() + in_chunk, 0, n);
+            content = tmp.data();
+        }
+
+        // 先 put 再 unref：内容未变时 put 命中同一个 id，不会先把它释放掉
+        auto new_id = store_->put(content);
+        if (new_id == DedupStore::INVALID_CHUNK)
+            return false;
+        map_[chunk] = new_id;
+        store_->unref(old_id);
+        if (new_id != old_id)
+            mark_dirty(chunk);
+
+        if (src)
+            src += n;
+        offset += n;
+        len -= n;
+    }
+    return true;
+}
+
+std::size_t DedupBackend::write(std::uint64_t lba, std::uint16_t count, const void *data) {
+    if (!is_valid() || lba + count > block_count_)
+        return 0;
+    std::unique_lock lock(mutex_);
+    if (!write_locked(lba * block_size_, static_cast<std::uint64_t>(count) * block_size_,
+                      static_cast<const std::uint8_t *>(data)))
+        return 0;
+    return static_cast<std::size_t>(count) * block_size_;
+}
+
+void DedupBackend::punch_hole(std::uint64_t lba, std::uint64_t count) {
+    if (!is_valid() || lba >= block_count_)
+        return;
+    count = std::min(count, block_count_ - lba);
+    std::unique_lock lock(mutex_);
+    write_locked(lba * block_size_, count * block_size_, nullptr);
+}
+
+bool DedupBackend::write_dirty_map() {
+    if (dirty_begin_ >= dirty_end_)
+        return true;
+    if (!pwrite_all(map_fd_, map_.data() + dirty_begin_, (dirty_end_ - dirty_begin_) * 8,
+                    sizeof(MapHeader) + dirty_begin_ * 8)) {
+        SPDLOG_ERROR("写回去重镜像 {} 的映射失败", map_path_);
+        return false;
+    }
+    dirty_begin_ = UINT64_MAX;
+    dirty_end_ = 0;
+    return true;
+}
+
+bool DedupBackend::flush(std::uint64_t, std::uint64_t) {
+    if (!is_valid())
+        return false;
+    // 独占锁：写回期间 map_ 不能变，也保证映射引用的 chunk 都已在 store 同步之前写入
+    std::unique_lock lock(mutex_);
+    if (!store_->sync())
+        return false;
+    return write_dirty_map() && sync_file(map_fd_);
+}
+
+std::uint64_t DedupBackend::mapped_chunks() const {
+    std::shared_lock lock(mutex_);
+    return static_cast<std::uint64_t>(
+            std::count_if(map_.begin(), map_.end(), [](std::uint64_t id) { return id != DedupStore::ZERO_CHUNK; }));
+}
+
+bool DedupBackend::clone_to(const std::string &map_path) const {
+    if (!is_valid())
+        return false;
+    if (std::filesystem::exists(map_path)) {
+        SPDLOG_ERROR("克隆目标 {} 已存在", map_path);
+        return false;
+    }
+    auto fd = open_file(map_path, true, true);
+    if (fd == invalid_fd) {
+        SPDLOG_ERROR("无法创建去重镜像 {}", map_path);
+        return false;
+    }
+    std::shared_lock lock(mutex_);
+    // 先加引用再写映射，新映射落盘前它引用的 chunk 不会被释放
+    store_->ref(map_.data(), map_.size());
+    bool ok = write_header(fd) && pwrite_all(fd, map_.data(), map_.size() * 8, sizeof(MapHeader)) && sync_file(fd);
+    close_file(fd);
+    if (!ok) {
+        SPDLOG_ERROR("写入克隆镜像 {} 失败", map_path);
+        for (auto id: map_)
+            store_->unref(id);
+        std::error_code ec;
+        std::filesystem::remove(map_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool DedupBackend::import_raw_image(const std::shared_ptr<DedupStore> &store, const std::string &raw_path,
+                                    const std::string &map_path, std::uint32_t block_size) {
+    if (!store || !store->is_valid())
+        return false;
+    if (std::filesystem::exists(map_path)) {
+        SPDLOG_ERROR("导入目标 {} 已存在", map_path);
+        return false;
+    }
+    auto raw = open_file(raw_path, false, false);
+    if (raw == invalid_fd) {
+        SPDLOG_ERROR("无法打开 raw 镜像 {}", raw_path);
+        return false;
+    }
+    auto size = file_size(raw);
+    if (size == 0 || size % block_size != 0) {
+        SPDLOG_ERROR("raw 镜像 {} 的大小 {} 不是块大小 {} 的整数倍", raw_path, size, block_size);
+        close_file(raw);
+        return false;
+    }
+
+    bool ok;
+    {
+        DedupBackend backend(store, map_path, size / block_size, block_size);
+        ok = backend.is_valid();
+        // 按 chunk 对齐的大段读入，write 内部逐 chunk 去重
+        constexpr std::uint16_t step_blocks = 1024;
+        std::vector<std::uint8_t> buf(static_cast<std::size_t>(step_blocks) * block_size);
+        for (std::uint64_t lba = 0; ok && lba < backend.block_count(); lba += step_blocks) {
+            auto n = static_cast<std::uint16_t>(std::min<std::uint64_t>(step_blocks, backend.block_count() - lba));
+            auto bytes = static_cast<std::size_t>(n) * block_size;
+            ok = pread_all(raw, buf.data(), bytes, lba * block_size) && backend.write(lba, n, buf.data()) == bytes;
+        }
+        ok = ok && backend.flush(0, backend.block_count());
+        // 失败时归还已导入 chunk 的引用，映射文件随后删除
+        if (!ok && backend.is_valid())
+            backend.punch_hole(0, backend.block_count());
+    }
+    close_file(raw);
+    if (!ok) {
+        SPDLOG_ERROR("导入 raw 镜像 {} 失败", raw_path);
+        std::error_code ec;
+        std::filesystem::remove(map_path, ec);
+    }
+    return ok;
+}
+
+} // namespace usbipdcpp
@@ -0,0 +1,322 @@
+#include "usbipdcpp/virtual_device/storage_backends/DedupStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+
+#ifdef USBIPDCPP_HAVE_XXHASH
+#include <xxhash.h>
+#endif
+
+namespace usbipdcpp {
+
+using namespace detail;
+
+namespace {
+
+    /**
+     * 引用计数文件格式（小端）：
+     *   [RefHeader 16 字节][uint32 × id 数]
+     */
+    constexpr char REF_MAGIC[8] = {'U', 'S', 'B', 'I', 'P', 'D', 'D', 'S'};
+    constexpr std::uint32_t REF_VERSION = 1;
+
+    struct RefHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t chunk_size;
+    };
+    static_assert(sizeof(RefHeader) == 16);
+
+    bool is_zero(const void *data, std::size_t len) {
+        auto *p = static_cast<const std::uint8_t *>(data);
+        std::uint64_t acc = 0;
+        for (std::size_t i = 0; i < len; i += 8) {
+            std::uint64_t v;
+            std::memcpy(&v, p + i, 8);
+            acc |= v;
+        }
+        return acc == 0;
+    }
+
+#ifndef USBIPDCPP_HAVE_XXHASH
+    constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ull;
+    constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr std::uint64_t P3 = 0x165667B19E3779F9ull;
+    constexpr std::uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+
+    inline std::uint64_t rotl(std::uint64_t v, int r) {
+        return (v << r) | (v >> (64 - r));
+    }
+
+    inline std::uint64_t round64(std::uint64_t acc, std::uint64_t input) {
+        acc += input * P2;
+        acc = rotl(acc, 31);
+        return acc * P1;
+    }
+
+    inline std::uint64_t avalanche(std::uint64_t h) {
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+#endif
+
+} // namespace
+
+DedupStore::Hash128 DedupStore::hash_chunk(const void *data, std::size_t len) {
+#ifdef USBIPDCPP_HAVE_XXHASH
+    auto h = XXH3_128bits(data, len);
+    return {h.low64, h.high64};
+#else
+    // xxh64 的 4 路累加：4 条独立依赖链，乘法可以流水。len 为 32 的整数倍（chunk_size 保证）
+    auto *p = static_cast<const std::uint8_t *>(data);
+    std::uint64_t v1 = P1 + P2, v2 = P2, v3 = 0, v4 = 0 - P1;
+    for (std::size_t i = 0; i + 32 <= len; i += 32) {
+        std::uint64_t w[4];
+        std::memcpy(w, p + i, 32);
+        v1 = round64(v1, w[0]);
+        v2 = round64(v2, w[1]);
+        v3 = round64(v3, w[2]);
+        v4 = round64(v4, w[3]);
+    }
+    std::uint64_t lo = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    std::uint64_t hi = (v1 ^ rotl(v3, 29)) + (v2 ^ rotl(v4, 41)) * P4;
+    return {avalanche(lo + len), avalanche(hi ^ (len * P3))};
+#endif
+}
+
+DedupStore::DedupStore(std::string dir, std::uint32_t chunk_size) : dir_(std::move(dir)), chunk_size_(chunk_size) {
+    if (chunk_size_ < 512 || (chunk_size_ & (chunk_size_ - 1)) != 0) {
+        SPDLOG_ERROR("去重存储 chunk 大小 {} 无效，须为不小于 512 的 2 的幂", chunk_size_);
+        return;
+    }
+    if (!open()) {
+        close_file(data_fd_);
+        close_file(ref_fd_);
+        data_fd_ = invalid_fd;
+        ref_fd_ = invalid_fd;
+    }
+}
+
+DedupStore::~DedupStore() {
+    if (is_valid())
+        sync();
+    close_file(data_fd_);
+    close_file(ref_fd_);
+}
+
+bool DedupStore::open() {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) {
+        SPDLOG_ERROR("无法创建去重存储目录 {}: {}", dir_, ec.message());
+        return false;
+    }
+    auto base = std::filesystem::path(dir_);
+    data_fd_ = open_file((base / "chunks.dat").string(), true, true);
+    ref_fd_ = open_file((base / "chunks.ref").string(), true, true);
+    if (data_fd_ == invalid_fd || ref_fd_ == invalid_fd) {
+        SPDLOG_ERROR("无法打开去重存储 {}", dir_);
+        return false;
+    }
+
+    auto ref_bytes = file_size(ref_fd_);
+    RefHeader header{};
+    if (ref_bytes == 0) {
+        std::memcpy(header.magic, REF_MAGIC, sizeof(REF_MAGIC));
+        header.version = REF_VERSION;
+        header.chunk_size = chunk_size_;
+        std::uint32_t zero_slot = 0;
+        if (!pwrite_all(ref_fd_, &header, sizeof(header), 0) || !pwrite_all(ref_fd_, &zero_slot, 4, sizeof(header))) {
+            SPDLOG_ERROR("无法初始化去重存储 {}", dir_);
+            return false;
+        }
+        refcounts_.assign(1, 0);
+        hashes_.assign(1, Hash128{});
+        return true;
+    }
+
+    if (ref_bytes < sizeof(header) + 4 || !pread_all(ref_fd_, &header, sizeof(header), 0) ||
+        std::memcmp(header.magic, REF_MAGIC, sizeof(REF_MAGIC)) != 0 || header.version != REF_VERSION) {
+        SPDLOG_ERROR("{} 不是有效的去重存储", dir_);
+        return false;
+    }
+    if (header.chunk_size != chunk_size_) {
+        SPDLOG_ERROR("去重存储 {} 的 chunk 大小为 {}，与请求的 {} 不一致", dir_, header.chunk_size, chunk_size_);
+        return false;
+    }
+    auto ids = (ref_bytes - sizeof(header)) / 4;
+    refcounts_.resize(ids);
+    if (!pread_all(ref_fd_, refcounts_.data(), ids * 4, sizeof(header))) {
+        SPDLOG_ERROR("读取去重存储 {} 的引用计数失败", dir_);
+        return false;
+    }
+
+    // 重建哈希索引
+    auto start = std::chrono::steady_clock::now();
+    hashes_.assign(ids, Hash128{});
+    std::vector<std::uint8_t> buf(chunk_size_);
+    refcounts_[0] = 0;
+    for (std::uint64_t id = 1; id < ids; ++id) {
+        if (refcounts_[id] == 0) {
+            free_.push_back(id);
+            continue;
+        }
+        if (!pread_all(data_fd_, buf.data(), chunk_size_, id * chunk_size_)) {
+            SPDLOG_ERROR("读取去重存储 {} 的 chunk {} 失败", dir_, id);
+            return false;
+        }
+        hashes_[id] = hash_chunk(buf.data(), chunk_size_);
+        index_.emplace(hashes_[id], id);
+        references_ += refcounts_[id];
+    }
+    // 低 id 先被复用，数据文件尽量保持紧凑
+    std::reverse(free_.begin(), free_.end());
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    SPDLOG_INFO("去重存储 {}: {} 个 chunk（空闲 {}），索引重建耗时 {} ms", dir_, ids - 1 - free_.size(), free_.size(),
+                ms);
+    return true;
+}
+
+void DedupStore::mark_dirty(std::uint64_t id) {
+    dirty_begin_ = std::min(dirty_begin_, id);
+    dirty_end_ = std::max(dirty_end_, id + 1);
+}
+
+std::uint64_t DedupStore::put(const void *data) {
+    if (is_zero(data, chunk_size_))
+        return ZERO_CHUNK;
+    auto hash = hash_chunk(data, chunk_size_);
+
+    std::lock_guard lock(mutex_);
+    auto it = index_.find(hash);
+    if (it != index_.end()) {
+        thread_local std::vector<std::uint8_t> existing;
+        existing.resize(chunk_size_);
+        if (pread_all(data_fd_, existing.data(), chunk_size_, it->second * chunk_size_) &&
+            std::memcmp(existing.data(), data, chunk_size_) == 0) {
+            ++refcounts_[it->second];
+            ++references_;
+            mark_dirty(it->second);
+            dedup_hits_.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+        // 哈希相同内容不同：作为不进索引的独立 chunk 存下
+    }
+
+    std::uint64_t id;
+    if (!free_.empty()) {
+        id = free_.back();
+        free_.pop_back();
+    }
+    else {
+        id = refcounts_.size();
+        refcounts_.push_back(0);
+        hashes_.push_back(Hash128{});
+    }
+    if (!pwrite_all(data_fd_, data, chunk_size_, id * chunk_size_)) {
+        SPDLOG_ERROR("写入去重存储 {} 的 chunk {} 失败", dir_, id);
+        free_.push_back(id);
+        return INVALID_CHUNK;
+    }
+    refcounts_[id] = 1;
+    ++references_;
+    hashes_[id] = hash;
+    if (it == index_.end())
+        index_.emplace(hash, id);
+    mark_dirty(id);
+    return id;
+}
+
+void DedupStore::ref(const std::uint64_t *ids, std::size_t count) {
+    std::lock_guard lock(mutex_);
+    for (std::size_t i = 0; i < count; ++i) {
+        auto id = ids[i];
+        if (id == ZERO_CHUNK || id >= refcounts_.size())
+            continue;
+        ++refcounts_[id];
+        ++references_;
+        mark_dirty(id);
+    }
+}
+
+void DedupStore::unref(std::uint64_t id) {
+    if (id == ZERO_CHUNK)
+        return;
+    std::lock_guard lock(mutex_);
+    if (id >= refcounts_.size() || refcounts_[id] == 0) {
+        SPDLOG_ERROR("去重存储 {}: 释放未被引用的 chunk {}", dir_, id);
+        return;
+    }
+    --references_;
+    mark_dirty(id);
+    if (--refcounts_[id] != 0)
+        return;
+    auto it = index_.find(hashes_[id]);
+    if (it != index_.end() && it->second == id)
+        index_.erase(it);
+    free_.push_back(id);
+    zero_range(data_fd_, id * chunk_size_, chunk_size_);
+}
+
+bool DedupStore::read(std::uint64_t id, void *out) const {
+    if (id == ZERO_CHUNK) {
+        std::memset(out, 0, chunk_size_);
+        return true;
+    }
+    return pread_all(data_fd_, out, chunk_size_, id * chunk_size_);
+}
+
+bool DedupStore::read_run(std::uint64_t first_id, std::size_t count, void *out) const {
+    if (first_id == ZERO_CHUNK) {
+        std::memset(out, 0, count * chunk_size_);
+        return true;
+    }
+    return pread_all(data_fd_, out, count * chunk_size_, first_id * chunk_size_);
+}
+
+bool DedupStore::sync() {
+    std::lock_guard lock(mutex_);
+    // 先让 chunk 数据落盘，再写引用计数
+    if (!sync_file(data_fd_))
+        return false;
+    if (dirty_begin_ < dirty_end_) {
+        auto end = std::min<std::uint64_t>(dirty_end_, refcounts_.size());
+        if (!pwrite_all(ref_fd_, refcounts_.data() + dirty_begin_, (end - dirty_begin_) * 4,
+                        sizeof(RefHeader) + dirty_begin_ * 4)) {
+            SPDLOG_ERROR("写回去重存储 {} 的引用计数失败", dir_);
+            return false;
+        }
+        dirty_begin_ = UINT64_MAX;
+        dirty_end_ = 0;
+    }
+    return sync_file(ref_fd_);
+}
+
+std::uint64_t DedupStore::chunk_count() const {
+    std::lock_guard lock(mutex_);
+    return refcounts_.size();
+}
+
+DedupStore::Stats DedupStore::stats() const {
+    std::lock_guard lock(mutex_);
+    Stats s{};
+    s.free_chunks = free_.size();
+    s.live_chunks = refcounts_.size() - 1 - free_.size();
+    s.references = references_;
+    s.dedup_hits = dedup_hits_.load(std::memory_order_relaxed);
+    s.stored_bytes = s.live_chunks * chunk_size_;
+    // unordered_map 节点约为键值 + next 指针 + 缓存的哈希值，再加桶数组
+    s.index_bytes = index_.size() * (sizeof(Hash128) + sizeof(std::uint64_t) + 2 * sizeof(void *)) +
+                    index_.bucket_count() * sizeof(void *) + refcounts_.capacity() * sizeof(std::uint32_t) +
+                    hashes_.capacity() * sizeof(Hash128) + free_.capacity() * sizeof(std::uint64_t);
+    return s;
+}
+
+} // namespace usbipdcpp
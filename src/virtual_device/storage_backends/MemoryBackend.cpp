@@ -0,0 +1,229 @@
+// clang-format off
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/uio.h>
+#endif
+// clang-format on
+
+#include "usbipdcpp/virtual_device/storage_backends/MemoryBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/SplicePipePool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+namespace usbipdcpp {
+
+namespace {
+    constexpr std::size_t HUGETLB_PAGE_SIZE = 2 * 1024 * 1024;
+
+    std::size_t round_up(std::size_t v, std::size_t align) {
+        return (v + align - 1) / align * align;
+    }
+
+#ifdef __linux__
+    /** base 起 length 字节经 pipe 发到 sock；一个字节都没发时返回 false 且 ec 为空 */
+    bool vmsplice_to_socket(const std::uint8_t *base, std::size_t length, int sock, const SplicePipe &pipe,
+                            std::error_code &ec) {
+        std::size_t done = 0;
+        while (done < length) {
+            // 用户页 → 管道：只挂页引用不拷贝（不带 SPLICE_F_GIFT，页仍归映射区所有）
+            iovec iov{const_cast<std::uint8_t *>(base) + done, std::min(length - done, pipe.capacity)};
+            ssize_t n = ::vmsplice(pipe.write_fd, &iov, 1, 0);
+            if (n <= 0) {
+                if (done == 0)
+                    return false; // 还没发任何数据，回退 write
+                ec.assign(n == 0 ? EIO : errno, std::generic_category());
+                return false;
+            }
+            // 管道 → socket，必须排空
+            for (ssize_t left = n; left > 0;) {
+                ssize_t m = ::splice(pipe.read_fd, nullptr, sock, nullptr, static_cast<std::size_t>(left),
+                                     SPLICE_F_MOVE);
+                if (m < 0 && errno == EAGAIN) {
+                    if (!detail::wait_fd_ready(sock, true)) {
+                        ec.assign(EIO, std::generic_category());
+                        return false;
+                    }
+                    continue;
+                }
+                if (m <= 0) {
+                    ec.assign(m == 0 ? EIO : errno, std::generic_category());
+                    return false;
+                }
+                left -= m;
+            }
+            done += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+#endif
+} // namespace
+
+MemoryBackend::MemoryBackend(std::uint64_t blocks, std::uint32_t block_size, HugePages huge_pages) :
+    block_count_(blocks), block_size_(block_size), huge_pages_(huge_pages) {
+    auto size = static_cast<std::size_t>(blocks) * block_size;
+    if (size == 0) {
+        SPDLOG_ERROR("内存盘大小为 0");
+        block_count_ = 0;
+        return;
+    }
+
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    page_size_ = si.dwPageSize;
+    huge_pages_ = HugePages::None;
+    mapped_size_ = round_up(size, page_size_);
+    // MEM_COMMIT 的页在首次访问前不占物理内存，首次访问时由系统按页清零分配
+    data_ = static_cast<std::uint8_t *>(VirtualAlloc(nullptr, mapped_size_, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (!data_) {
+        SPDLOG_ERROR("VirtualAlloc {} 字节失败，内存盘不可用", mapped_size_);
+        mapped_size_ = 0;
+        block_count_ = 0;
+        return;
+    }
+#else
+    page_size_ = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    // 不预占 swap / overcommit 配额：内存只在写入时才计入
+    flags |= MAP_NORESERVE;
+#endif
+    void *addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (huge_pages_ == HugePages::Explicit) {
+        mapped_size_ = round_up(size, HUGETLB_PAGE_SIZE);
+        // hugetlb 不能带 MAP_NORESERVE：否则大页池不足时 mmap 成功、首次写入才 SIGBUS。
+        // 预留只占大页池配额，页仍在首次写入时才清零分配
+        addr = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (addr == MAP_FAILED) {
+            SPDLOG_WARN("MAP_HUGETLB 映射失败（vm.nr_hugepages 不足？），回退为普通页");
+            huge_pages_ = HugePages::None;
+        }
+        else {
+            page_size_ = HUGETLB_PAGE_SIZE;
+        }
+    }
+#else
+    if (huge_pages_ == HugePages::Explicit)
+        huge_pages_ = HugePages::None;
+#endif
+    if (addr == MAP_FAILED) {
+        mapped_size_ = round_up(size, page_size_);
+        addr = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, flags, -1, 0);
+    }
+    if (addr == MAP_FAILED) {
+        SPDLOG_ERROR("mmap {} 字节失败，内存盘不可用: {}", mapped_size_, std::strerror(errno));
+        mapped_size_ = 0;
+        // 容量报 0：READ CAPACITY 不会把不存在的块报给主机
+        block_count_ = 0;
+        return;
+    }
+    data_ = static_cast<std::uint8_t *>(addr);
+
+    if (huge_pages_ == HugePages::Transparent) {
+#ifdef MADV_HUGEPAGE
+        if (madvise(data_, mapped_size_, MADV_HUGEPAGE) != 0) {
+            SPDLOG_WARN("MADV_HUGEPAGE 失败，透明大页不可用");
+            huge_pages_ = HugePages::None;
+        }
+#else
+        huge_pages_ = HugePages::None;
+#endif
+    }
+#endif
+
+    SPDLOG_INFO("内存盘: {} 块, {} MiB（按需分配）", block_count_, size / 1024 / 1024);
+}
+
+MemoryBackend::~MemoryBackend() {
+    if (!data_)
+        return;
+#ifdef _WIN32
+    VirtualFree(data_, 0, MEM_RELEASE);
+#else
+    munmap(data_, mapped_size_);
+#endif
+}
+
+std::size_t MemoryBackend::read(std::uint64_t lba, std::uint16_t count, void *buffer) {
+    if (!data_)
+        return 0;
+    auto total = static_cast<std::size_t>(count) * block_size_;
+    auto offset = static_cast<std::size_t>(lba) * block_size_;
+    std::memcpy(buffer, data_ + offset, total);
+    return total;
+}
+
+std::size_t MemoryBackend::write(std::uint64_t lba, std::uint16_t count, const void *data) {
+    if (!data_)
+        return 0;
+    auto total = static_cast<std::size_t>(count) * block_size_;
+    auto offset = static_cast<std::size_t>(lba) * block_size_;
+    std::memcpy(data_ + offset, data, total);
+    return total;
+}
+
+void MemoryBackend::punch_hole(std::uint64_t lba, std::uint64_t count) {
+    if (!data_)
+        return;
+    auto offset = static_cast<std::size_t>(lba) * block_size_;
+    auto length = static_cast<std::size_t>(count) * block_size_;
+    auto end = offset + length;
+    auto page_begin = round_up(offset, page_size_);
+    auto page_end = end / page_size_ * page_size_;
+    if (page_begin >= page_end) {
+        // 范围不含完整页，只能清零
+        std::memset(data_ + offset, 0, length);
+        return;
+    }
+    std::memset(data_ + offset, 0, page_begin - offset);
+    std::memset(data_ + page_end, 0, end - page_end);
+#ifdef _WIN32
+    // 取消提交再重新提交：物理页归还，下次访问时重新清零分配
+    VirtualFree(data_ + page_begin, page_end - page_begin, MEM_DECOMMIT);
+    VirtualAlloc(data_ + page_begin, page_end - page_begin, MEM_COMMIT, PAGE_READWRITE);
+#else
+    // 私有匿名映射 DONTNEED 后再读得到零页（MADV_REMOVE 只用于共享映射）
+    if (madvise(data_ + page_begin, page_end - page_begin, MADV_DONTNEED) != 0) {
+        SPDLOG_WARN("MADV_DONTNEED 失败，回退清零: LBA={} count={}", lba, count);
+        std::memset(data_ + page_begin, 0, page_end - page_begin);
+    }
+#endif
+}
+
+void *MemoryBackend::get_direct_buffer(std::uint64_t lba) {
+    if (!data_)
+        return nullptr;
+    return data_ + static_cast<std::size_t>(lba) * block_size_;
+}
+
+bool MemoryBackend::send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                                SplicePipePool &pipes, std::error_code &ec) {
+#ifdef __linux__
+    // 小传输 vmsplice + splice 两次系统调用反而比一次 write 拷贝贵
+    if (!data_ || length < VMSPLICE_MIN_BYTES)
+        return false;
+    auto lease = pipes.acquire(length);
+    if (!lease.pipe().valid())
+        return false;
+    auto *base = data_ + static_cast<std::size_t>(lba) * block_size_ + offset;
+    if (vmsplice_to_socket(base, length, static_cast<int>(sock_fd), lease.pipe(), ec))
+        return true;
+    if (ec)
+        lease.discard(); // 管道里可能残留半截数据
+    return false;
+#else
+    return false;
+#endif
+}
+
+} // namespace usbipdcpp
@@ -0,0 +1,610 @@
+#include "usbipdcpp/virtual_device/storage_backends/NbdBackend.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <vector>
+
+#include <asio.hpp>
+#include <spdlog/spdlog.h>
+
+#include "usbipdcpp/virtual_device/storage_backends/NbdProtocol.h"
+
+namespace usbipdcpp {
+
+struct NbdBackend::Connection {
+    asio::io_context io;
+    // TCP 和 unix socket 统一用 generic 流 socket，收发代码不区分传输方式
+    asio::generic::stream_protocol::socket sock{io};
+
+    bool read_exact(void *buf, std::size_t len) {
+        asio::error_code ec;
+        asio::read(sock, asio::buffer(buf, len), ec);
+        return !ec;
+    }
+
+    bool write_all(const void *buf, std::size_t len) {
+        asio::error_code ec;
+        asio::write(sock, asio::buffer(buf, len), ec);
+        return !ec;
+    }
+
+    void shutdown() {
+        asio::error_code ec;
+        sock.shutdown(asio::socket_base::shutdown_both, ec);
+    }
+};
+
+bool NbdBackend::parse_uri(const std::string &uri, NbdAddress &address) {
+    address = {};
+    constexpr std::string_view tcp_scheme = "nbd://";
+    constexpr std::string_view unix_scheme = "nbd+unix://";
+    std::string_view rest = uri;
+
+    if (rest.starts_with(unix_scheme)) {
+        rest.remove_prefix(unix_scheme.size());
+        // nbd+unix 没有 authority 部分：nbd+unix:///export?socket=/path
+        if (!rest.starts_with('/'))
+            return false;
+        rest.remove_prefix(1);
+        auto query = rest.find('?');
+        if (query == std::string_view::npos)
+            return false;
+        address.export_name = std::string(rest.substr(0, query));
+        auto params = rest.substr(query + 1);
+        while (!params.empty()) {
+            auto amp = params.find('&');
+            auto param = params.substr(0, amp);
+            if (param.starts_with("socket="))
+                address.socket_path = std::string(param.substr(7));
+            params = amp == std::string_view::npos ? std::string_view{} : params.substr(amp + 1);
+        }
+        return !address.socket_path.empty();
+    }
+
+    if (!rest.starts_with(tcp_scheme))
+        return false;
+    rest.remove_prefix(tcp_scheme.size());
+    auto slash = rest.find('/');
+    auto authority = rest.substr(0, slash);
+    if (slash != std::string_view::npos)
+        address.export_name = std::string(rest.substr(slash + 1));
+
+    std::string_view port_str;
+    if (authority.starts_with('[')) {
+        // IPv6 字面量：[::1]:10809
+        auto close = authority.find(']');
+        if (close == std::string_view::npos)
+            return false;
+        address.host = std::string(authority.substr(1, close - 1));
+        auto after = authority.substr(close + 1);
+        if (!after.empty()) {
+            if (after[0] != ':')
+                return false;
+            port_str = after.substr(1);
+        }
+    }
+    else {
+        auto colon = authority.rfind(':');
+        address.host = std::string(authority.substr(0, colon));
+        if (colon != std::string_view::npos)
+            port_str = authority.substr(colon + 1);
+    }
+    if (address.host.empty())
+        return false;
+
+    address.port = nbd::DEFAULT_PORT;
+    if (!port_str.empty()) {
+        auto [ptr, ec] = std::from_chars(port_str.data(), port_str.data() + port_str.size(), address.port);
+        if (ec != std::errc{} || ptr != port_str.data() + port_str.size() || address.port == 0)
+            return false;
+    }
+    return true;
+}
+
+NbdBackend::NbdBackend(const std::string &uri, NbdOptions options, std::uint32_t block_size) :
+    conn_(std::make_unique<Connection>()), options_(options), block_size_(block_size) {
+    NbdAddress address;
+    if (!parse_uri(uri, address)) {
+        SPDLOG_ERROR("无效的 NBD URI: {}", uri);
+        return;
+    }
+    if (options_.max_in_flight == 0)
+        options_.max_in_flight = 1;
+    if (!connect(address))
+        return;
+    if (!handshake(address.export_name)) {
+        conn_->shutdown();
+        return;
+    }
+
+    SPDLOG_INFO("NBD 已连接 {}: 导出 '{}' ({} 块, {} MiB), 只读={}, 结构化回复={}, 单请求上限 {} KiB, 在途上限 {}",
+                uri, address.export_name, block_count_, export_size_ / (1024 * 1024), read_only_, structured_,
+                max_request_bytes_ / 1024, options_.max_in_flight);
+    connected_.store(true, std::memory_order_release);
+    receiver_ = std::thread([this] { receive_loop(); });
+}
+
+NbdBackend::~NbdBackend() {
+    if (connected_.exchange(false, std::memory_order_acq_rel)) {
+        // NBD_CMD_DISC 无回复，发完即可关闭
+        std::array<std::uint8_t, nbd::REQUEST_HEADER_SIZE> req{};
+        nbd::put_be32(&req[0], nbd::REQUEST_MAGIC);
+        nbd::put_be16(&req[6], nbd::Cmd::Disc);
+        std::lock_guard lock(send_mutex_);
+        conn_->write_all(req.data(), req.size());
+    }
+    conn_->shutdown();
+    if (receiver_.joinable())
+        receiver_.join();
+    asio::error_code ec;
+    conn_->sock.close(ec);
+}
+
+bool NbdBackend::connect(const NbdAddress &address) {
+    asio::error_code ec;
+    if (!address.socket_path.empty()) {
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+        conn_->sock.connect(asio::local::stream_protocol::endpoint(address.socket_path), ec);
+        if (ec) {
+            SPDLOG_ERROR("连接 NBD unix socket {} 失败: {}", address.socket_path, ec.message());
+            return false;
+        }
+        return true;
+#else
+        SPDLOG_ERROR("当前平台不支持 unix socket: {}", address.socket_path);
+        return false;
+#endif
+    }
+
+    asio::ip::tcp::resolver resolver(conn_->io);
+    auto results = resolver.resolve(address.host, std::to_string(address.port), ec);
+    if (ec) {
+        SPDLOG_ERROR("解析 NBD 服务器地址 {} 失败: {}", address.host, ec.message());
+        return false;
+    }
+    for (const auto &entry: results) {
+        conn_->sock.close(ec);
+        conn_->sock.connect(entry.endpoint(), ec);
+        if (!ec)
+            break;
+    }
+    if (ec) {
+        SPDLOG_ERROR("连接 NBD 服务器 {}:{} 失败: {}", address.host, address.port, ec.message());
+        return false;
+    }
+    // 请求头与数据分两次小写，关掉 Nagle 避免每个请求多等一个 RTT
+    conn_->sock.set_option(asio::ip::tcp::no_delay(true), ec);
+    return true;
+}
+
+bool NbdBackend::handshake(const std::string &export_name) {
+    auto &c = *conn_;
+    std::array<std::uint8_t, 18> hello{};
+    if (!c.read_exact(hello.data(), hello.size())) {
+        SPDLOG_ERROR("NBD 握手: 读取服务器问候失败");
+        return false;
+    }
+    if (nbd::get_be64(&hello[0]) != nbd::NBDMAGIC) {
+        SPDLOG_ERROR("NBD 握手: 不是 NBD 服务器");
+        return false;
+    }
+    auto second = nbd::get_be64(&hello[8]);
+    if (second == nbd::OLDSTYLE_MAGIC) {
+        SPDLOG_ERROR("NBD 握手: 不支持 oldstyle 协议");
+        return false;
+    }
+    auto handshake_flags = nbd::get_be16(&hello[16]);
+    if (second != nbd::IHAVEOPT || !(handshake_flags & nbd::FLAG_FIXED_NEWSTYLE)) {
+        SPDLOG_ERROR("NBD 握手: 服务器不支持 fixed newstyle");
+        return false;
+    }
+    bool no_zeroes = handshake_flags & nbd::FLAG_NO_ZEROES;
+    std::array<std::uint8_t, 4> client_flags{};
+    nbd::put_be32(client_flags.data(), nbd::FLAG_C_FIXED_NEWSTYLE | (no_zeroes ? nbd::FLAG_C_NO_ZEROES : 0));
+    if (!c.write_all(client_flags.data(), client_flags.size()))
+        return false;
+
+    auto send_option = [&](std::uint32_t option, const std::vector<std::uint8_t> &data) {
+        std::vector<std::uint8_t> msg(16 + data.size());
+        nbd::put_be64(&msg[0], nbd::IHAVEOPT);
+        nbd::put_be32(&msg[8], option);
+        nbd::put_be32(&msg[12], static_cast<std::uint32_t>(data.size()));
+        std::ranges::copy(data, msg.begin() + 16);
+        return c.write_all(msg.data(), msg.size());
+    };
+    // 选项回复：magic(8) option(4) type(4) length(4) data
+    auto read_reply = [&](std::uint32_t &type, std::vector<std::uint8_t> &data) {
+        std::array<std::uint8_t, 20> head{};
+        if (!c.read_exact(head.data(), head.size()) || nbd::get_be64(&head[0]) != nbd::OPTION_REPLY_MAGIC)
+            return false;
+        type = nbd::get_be32(&head[12]);
+        auto len = nbd::get_be32(&head[16]);
+        if (len > 64 * 1024)
+            return false;
+        data.resize(len);
+        return len == 0 || c.read_exact(data.data(), len);
+    };
+
+    std::uint32_t type = 0;
+    std::vector<std::uint8_t> data;
+    if (options_.structured_replies) {
+        if (!send_option(nbd::Opt::StructuredReply, {}) || !read_reply(type, data)) {
+            SPDLOG_ERROR("NBD 握手: 协商结构化回复时连接出错");
+            return false;
+        }
+        structured_ = type == nbd::Rep::Ack;
+        if (!structured_)
+            SPDLOG_INFO("NBD 服务器不支持结构化回复，使用简单回复");
+    }
+
+    // NBD_OPT_GO：导出名 + 请求 NBD_INFO_BLOCK_SIZE
+    std::vector<std::uint8_t> go(4 + export_name.size() + 4);
+    nbd::put_be32(&go[0], static_cast<std::uint32_t>(export_name.size()));
+    std::memcpy(&go[4], export_name.data(), export_name.size());
+    nbd::put_be16(&go[4 + export_name.size()], 1);
+    nbd::put_be16(&go[6 + export_name.size()], nbd::Info::BlockSize);
+    if (!send_option(nbd::Opt::Go, go))
+        return false;
+
+    bool have_export = false;
+    std::uint32_t server_max_block = 0;
+    std::uint32_t server_min_block = 1;
+    bool fallback = false;
+    while (true) {
+        if (!read_reply(type, data)) {
+            SPDLOG_ERROR("NBD 握手: 读取 NBD_OPT_GO 回复失败");
+            return false;
+        }
+        if (type == nbd::Rep::Ack)
+            break;
+        if (type == nbd::Rep::Info && data.size() >= 2) {
+            auto info = nbd::get_be16(&data[0]);
+            if (info == nbd::Info::Export && data.size() >= 12) {
+                export_size_ = nbd::get_be64(&data[2]);
+                transmission_flags_ = nbd::get_be16(&data[10]);
+                have_export = true;
+            }
+            else if (info == nbd::Info::BlockSize && data.size() >= 14) {
+                server_min_block = std::max<std::uint32_t>(1, nbd::get_be32(&data[2]));
+                server_max_block = nbd::get_be32(&data[10]);
+            }
+            continue;
+        }
+        if (type == nbd::Rep::ErrUnsup) {
+            fallback = true;
+            break;
+        }
+        if (type & nbd::Rep::ErrBit) {
+            SPDLOG_ERROR("NBD 服务器拒绝导出 '{}': 错误 0x{:x} {}", export_name, type,
+                         std::string(data.begin(), data.end()));
+            return false;
+        }
+        // 其余未请求的回复类型按协议忽略
+    }
+
+    if (fallback) {
+        // 老服务器没有 NBD_OPT_GO：EXPORT_NAME 直接进入传输阶段，拒绝时服务器断开连接
+        if (!send_option(nbd::Opt::ExportName, std::vector<std::uint8_t>(export_name.begin(), export_name.end())))
+            return false;
+        std::array<std::uint8_t, 10 + 124> reply{};
+        if (!c.read_exact(reply.data(), no_zeroes ? 10 : reply.size())) {
+            SPDLOG_ERROR("NBD 服务器拒绝导出 '{}'", export_name);
+            return false;
+        }
+        export_size_ = nbd::get_be64(&reply[0]);
+        transmission_flags_ = nbd::get_be16(&reply[8]);
+        have_export = true;
+    }
+    if (!have_export) {
+        SPDLOG_ERROR("NBD 握手: 服务器未返回导出信息");
+        return false;
+    }
+
+    read_only_ = transmission_flags_ & nbd::FLAG_READ_ONLY;
+    block_count_ = export_size_ / block_size_;
+    if (export_size_ % block_size_ != 0)
+        SPDLOG_WARN("NBD 导出大小 {} 不是块大小 {} 的整数倍，尾部 {} 字节不可见", export_size_, block_size_,
+                    export_size_ % block_size_);
+    if (block_size_ % server_min_block != 0)
+        SPDLOG_WARN("NBD 服务器最小块 {} 与块大小 {} 不对齐，请求可能被拒绝", server_min_block, block_size_);
+
+    max_request_bytes_ = options_.max_request_bytes;
+    if (server_max_block != 0)
+        max_request_bytes_ = std::min<std::size_t>(max_request_bytes_, server_max_block);
+    max_request_bytes_ = std::max<std::size_t>(max_request_bytes_ / block_size_ * block_size_, block_size_);
+    return true;
+}
+
+bool NbdBackend::can_trim() const {
+    return transmission_flags_ & nbd::FLAG_SEND_TRIM;
+}
+
+bool NbdBackend::can_flush() const {
+    return transmission_flags_ & nbd::FLAG_SEND_FLUSH;
+}
+
+bool NbdBackend::can_cache() const {
+    return transmission_flags_ & nbd::FLAG_SEND_CACHE;
+}
+
+std::uint64_t NbdBackend::submit(std::uint16_t type, std::uint64_t offset, std::uint32_t length,
+                                 const void *payload, void *dst, bool detached) {
+    std::uint64_t cookie;
+    {
+        std::unique_lock lock(mutex_);
+        if (detached) {
+            // 提示类请求不排队等名额
+            if (in_flight_ >= options_.max_in_flight || !connected_.load(std::memory_order_relaxed))
+                return 0;
+        }
+        else {
+            cv_.wait(lock, [&] {
+                return in_flight_ < options_.max_in_flight || !connected_.load(std::memory_order_relaxed);
+            });
+            if (!connected_.load(std::memory_order_relaxed))
+                return 0;
+        }
+        cookie = next_cookie_++;
+        pending_.emplace(cookie, Pending{.type = type,
+                                         .offset = offset,
+                                         .length = length,
+                                         .dst = static_cast<std::uint8_t *>(dst),
+                                         .detached = detached});
+        ++in_flight_;
+    }
+
+    std::array<std::uint8_t, nbd::REQUEST_HEADER_SIZE> req{};
+    nbd::put_be32(&req[0], nbd::REQUEST_MAGIC);
+    nbd::put_be16(&req[4], 0);
+    nbd::put_be16(&req[6], type);
+    nbd::put_be64(&req[8], cookie);
+    nbd::put_be64(&req[16], offset);
+    nbd::put_be32(&req[24], length);
+    std::array<asio::const_buffer, 2> buffers = {asio::buffer(req),
+                                                 asio::buffer(payload, payload ? length : 0)};
+    asio::error_code ec;
+    {
+        std::lock_guard lock(send_mutex_);
+        asio::write(conn_->sock, buffers, ec);
+    }
+    if (ec) {
+        SPDLOG_ERROR("NBD 发送请求失败: {}", ec.message());
+        // 让接收线程退出，并把包括本请求在内的在途请求全部置为失败
+        conn_->shutdown();
+        fail_all();
+    }
+    return cookie;
+}
+
+std::uint32_t NbdBackend::wait(std::uint64_t cookie) {
+    if (cookie == 0)
+        return nbd::Err::Shutdown;
+    std::unique_lock lock(mutex_);
+    auto it = pending_.find(cookie);
+    cv_.wait(lock, [&] { return it->second.done; });
+    auto error = it->second.error;
+    pending_.erase(it);
+    return error;
+}
+
+bool NbdBackend::transfer(std::uint16_t type, std::uint64_t offset, std::uint64_t length, const void *payload,
+                          void *dst) {
+    // Trim 无数据，单请求可以覆盖很大的范围（长度字段 32 位）
+    std::uint64_t chunk = type == nbd::Cmd::Trim ? (1ull << 30) : max_request_bytes_;
+    std::vector<std::uint64_t> cookies;
+    cookies.reserve((length + chunk - 1) / chunk);
+    bool ok = true;
+    for (std::uint64_t done = 0; done < length; done += chunk) {
+        auto n = static_cast<std::uint32_t>(std::min(chunk, length - done));
+        auto cookie = submit(type, offset + done, n, payload ? static_cast<const std::uint8_t *>(payload) + done : nullptr,
+                             dst ? static_cast<std::uint8_t *>(dst) + done : nullptr);
+        if (cookie == 0) {
+            ok = false;
+            break;
+        }
+        cookies.push_back(cookie);
+    }
+    // 即使中途失败，也必须等已发出的请求结束：接收线程可能仍在写 dst
+    for (auto cookie: cookies) {
+        if (auto error = wait(cookie); error != 0) {
+            if (ok)
+                SPDLOG_ERROR("NBD 请求失败: type={} offset={} length={} error={}", type, offset, length, error);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+std::size_t NbdBackend::read(std::uint64_t lba, std::uint16_t count, void *buffer) {
+    if (lba + count > block_count_)
+        return 0;
+    std::uint64_t bytes = std::uint64_t(count) * block_size_;
+    if (!transfer(nbd::Cmd::Read, lba * block_size_, bytes, nullptr, buffer))
+        return 0;
+    return bytes;
+}
+
+std::size_t NbdBackend::write(std::uint64_t lba, std::uint16_t count, const void *data) {
+    if (read_only_ || lba + count > block_count_)
+        return 0;
+    std::uint64_t bytes = std::uint64_t(count) * block_size_;
+    if (!transfer(nbd::Cmd::Write, lba * block_size_, bytes, data, nullptr))
+        return 0;
+    return bytes;
+}
+
+void NbdBackend::punch_hole(std::uint64_t lba, std::uint64_t count) {
+    if (!can_trim() || read_only_ || lba >= block_count_)
+        return;
+    count = std::min(count, block_count_ - lba);
+    transfer(nbd::Cmd::Trim, lba * block_size_, count * block_size_, nullptr, nullptr);
+}
+
+void NbdBackend::prefetch(std::uint64_t lba, std::uint64_t count) {
+    if (!can_cache() || lba >= block_count_)
+        return;
+    count = std::min({count, block_count_ - lba, std::uint64_t(UINT32_MAX / block_size_)});
+    submit(nbd::Cmd::Cache, lba * block_size_, static_cast<std::uint32_t>(count * block_size_), nullptr, nullptr,
+           true);
+}
+
+bool NbdBackend::flush(std::uint64_t lba, std::uint64_t count) {
+    if (!can_flush())
+        return is_valid();
+    return wait(submit(nbd::Cmd::Flush, 0, 0, nullptr, nullptr)) == 0;
+}
+
+void NbdBackend::complete(std::unordered_map<std::uint64_t, Pending>::iterator it, std::uint32_t error) {
+    auto &p = it->second;
+    if (p.error == 0)
+        p.error = error;
+    p.done = true;
+    --in_flight_;
+    if (p.detached)
+        pending_.erase(it);
+    cv_.notify_all();
+}
+
+void NbdBackend::fail_all() {
+    std::lock_guard lock(mutex_);
+    connected_.store(false, std::memory_order_release);
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        auto next = std::next(it);
+        if (!it->second.done)
+            complete(it, nbd::Err::Shutdown);
+        it = next;
+    }
+    cv_.notify_all();
+}
+
+void NbdBackend::receive_loop() {
+    auto &c = *conn_;
+    // 按 cookie 找在途请求。unordered_map 插入不会使已有元素的引用失效，请求完成前也没人删除它，
+    // 因此读数据时不持锁，直接写入调用者缓冲区
+    auto find = [&](std::uint64_t cookie) -> Pending * {
+        std::lock_guard lock(mutex_);
+        auto it = pending_.find(cookie);
+        return it != pending_.end() && !it->second.done ? &it->second : nullptr;
+    };
+    auto finish = [&](std::uint64_t cookie, std::uint32_t error) {
+        std::lock_guard lock(mutex_);
+        complete(pending_.find(cookie), error);
+    };
+    auto record_error = [&](Pending &p, std::uint32_t error) {
+        std::lock_guard lock(mutex_);
+        if (p.error == 0)
+            p.error = error != 0 ? error : nbd::Err::Io;
+    };
+
+    std::array<std::uint8_t, nbd::STRUCTURED_REPLY_SIZE> head{};
+    std::vector<std::uint8_t> scratch;
+    bool ok = true;
+    while (ok && c.read_exact(head.data(), 4)) {
+        auto magic = nbd::get_be32(&head[0]);
+        if (magic == nbd::SIMPLE_REPLY_MAGIC) {
+            if (!c.read_exact(&head[4], nbd::SIMPLE_REPLY_SIZE - 4))
+                break;
+            auto error = nbd::get_be32(&head[4]);
+            auto cookie = nbd::get_be64(&head[8]);
+            auto *pending = find(cookie);
+            if (!pending) {
+                SPDLOG_ERROR("NBD 回复了未知的 cookie {}", cookie);
+                break;
+            }
+            auto &p = *pending;
+            if (p.type == nbd::Cmd::Read && error == 0) {
+                // 协商了结构化回复时 READ 必须用结构化回复，否则无法判断后续是否有数据
+                if (structured_ || !c.read_exact(p.dst, p.length)) {
+                    ok = false;
+                    break;
+                }
+            }
+            finish(cookie, error);
+            continue;
+        }
+        if (magic != nbd::STRUCTURED_REPLY_MAGIC || !structured_) {
+            SPDLOG_ERROR("NBD 回复 magic 错误: 0x{:08x}", magic);
+            break;
+        }
+
+        if (!c.read_exact(&head[4], nbd::STRUCTURED_REPLY_SIZE - 4))
+            break;
+        auto flags = nbd::get_be16(&head[4]);
+        auto type = nbd::get_be16(&head[6]);
+        auto cookie = nbd::get_be64(&head[8]);
+        auto length = nbd::get_be32(&head[16]);
+        auto *pending = find(cookie);
+        if (!pending) {
+            SPDLOG_ERROR("NBD 结构化回复了未知的 cookie {}", cookie);
+            break;
+        }
+        auto &p = *pending;
+        switch (type) {
+            case nbd::ReplyType::None:
+                ok = length == 0;
+                break;
+            case nbd::ReplyType::OffsetData: {
+                std::array<std::uint8_t, 8> off{};
+                if (p.type != nbd::Cmd::Read || length < 8 || !c.read_exact(off.data(), 8)) {
+                    ok = false;
+                    break;
+                }
+                auto offset = nbd::get_be64(off.data());
+                auto data_len = length - 8;
+                if (offset < p.offset || offset + data_len > p.offset + p.length) {
+                    SPDLOG_ERROR("NBD 数据块超出请求范围: offset={} length={}", offset, data_len);
+                    ok = false;
+                    break;
+                }
+                ok = c.read_exact(p.dst + (offset - p.offset), data_len);
+                break;
+            }
+            case nbd::ReplyType::OffsetHole: {
+                std::array<std::uint8_t, 12> hole{};
+                if (p.type != nbd::Cmd::Read || length != 12 || !c.read_exact(hole.data(), 12)) {
+                    ok = false;
+                    break;
+                }
+                auto offset = nbd::get_be64(&hole[0]);
+                auto size = nbd::get_be32(&hole[8]);
+                if (offset < p.offset || offset + size > p.offset + p.length) {
+                    ok = false;
+                    break;
+                }
+                std::memset(p.dst + (offset - p.offset), 0, size);
+                break;
+            }
+            default:
+                // 未知类型一律读掉负载；带错误位的是错误块：error(4) msg_len(2) msg ...
+                scratch.resize(length);
+                if (length > 0 && !c.read_exact(scratch.data(), length)) {
+                    ok = false;
+                    break;
+                }
+                if (type & 0x8000) {
+                    auto error = length >= 4 ? nbd::get_be32(&scratch[0]) : nbd::Err::Io;
+                    std::string message;
+                    if (length >= 6)
+                        message.assign(scratch.begin() + 6,
+                                       scratch.begin() + std::min<std::size_t>(length, 6 + nbd::get_be16(&scratch[4])));
+                    SPDLOG_WARN("NBD 请求错误: type={} offset={} error={} {}", p.type, p.offset, error, message);
+                    record_error(p, error);
+                }
+                break;
+        }
+        if (!ok) {
+            SPDLOG_ERROR("NBD 结构化回复格式错误: type={} length={}", type, length);
+            break;
+        }
+        if (flags & nbd::REPLY_FLAG_DONE)
+            finish(cookie, 0);
+    }
+
+    if (connected_.load(std::memory_order_acquire))
+        SPDLOG_WARN("NBD 连接断开，在途请求全部失败");
+    fail_all();
+}
+
+} // namespace usbipdcpp
@@ -7,21 +7,69 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/socket.h> // macOS sendfile
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include <sys/stat.h>
 #include <unistd.h>
 #endif
 // clang-format on
 
 #include "usbipdcpp/virtual_device/storage_backends/RawImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/SplicePipePool.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <filesystem>
 #include <spdlog/spdlog.h>
 
 namespace usbipdcpp {
 
-RawImageBackend::RawImageBackend(std::string path, std::uint64_t initial_blocks, std::uint32_t block_size) :
-    path_(std::move(path)), block_count_(initial_blocks), block_size_(block_size) {
+#ifdef __linux__
+namespace {
+    /** sock → pipe → fd 的 file_offset 处，两次 splice；一个字节都没读时返回 false 且 ec 为空 */
+    bool splice_to_file(int sock, int fd, off64_t file_offset, std::size_t length, const SplicePipe &pipe,
+                        std::error_code &ec) {
+        std::size_t done = 0;
+        while (done < length) {
+            // sock → pipe：一次最多一个管道容量
+            auto want = std::min(length - done, pipe.capacity);
+            ssize_t n = splice(sock, nullptr, pipe.write_fd, nullptr, want, SPLICE_F_MOVE);
+            if (n < 0 && errno == EAGAIN) {
+                if (!detail::wait_fd_ready(sock, false)) {
+                    ec.assign(EIO, std::generic_category());
+                    return false;
+                }
+                continue;
+            }
+            if (n <= 0) {
+                if (done == 0 && n < 0 && errno == EINVAL)
+                    return false; // socket 不支持 splice，一个字节都没读，可以回退
+                ec.assign(n == 0 ? ECONNRESET : errno, std::generic_category());
+                return false;
+            }
+            // pipe → file（页缓存），必须把管道排空，否则下次租用会读到残留数据
+            for (ssize_t left = n; left > 0;) {
+                off64_t off = file_offset + static_cast<off64_t>(done);
+                ssize_t m = splice(pipe.read_fd, nullptr, fd, &off, static_cast<std::size_t>(left), SPLICE_F_MOVE);
+                if (m <= 0) {
+                    ec.assign(m == 0 ? EIO : errno, std::generic_category());
+                    return false;
+                }
+                left -= m;
+                done += static_cast<std::size_t>(m);
+            }
+        }
+        return true;
+    }
+} // namespace
+#endif
+
+RawImageBackend::RawImageBackend(std::string path, std::uint64_t initial_blocks, std::uint32_t block_size,
+                                 DurabilityConfig durability) :
+    path_(std::move(path)), block_count_(initial_blocks), block_size_(block_size), durability_(durability) {
 
     SPDLOG_INFO("磁盘镜像路径: {}", std::filesystem::absolute(path_).string());
 
@@ -125,17 +173,29 @@ RawImageBackend::RawImageBackend(std::string path, std::uint64_t initial_blocks,
     mapped_size_ = file_size;
 #endif
 
-#ifdef __linux__
-    if (pipe(splice_pipe_) < 0) {
-        SPDLOG_WARN("pipe 创建失败，splice 零拷贝接收不可用");
+    if (durability_.mode == WriteDurability::WriteBack) {
+        flusher_ = std::thread([this] { flusher_loop(); });
     }
-#endif
 
     SPDLOG_INFO("{}镜像: {} ({} 块, {} MiB)", is_new_file ? "创建" : "打开", path_, block_count_,
                 block_count_ * block_size_ / 1024 / 1024);
 }
 
 RawImageBackend::~RawImageBackend() {
+    if (flusher_.joinable()) {
+        {
+            std::lock_guard lock(flusher_mutex_);
+            flusher_stop_ = true;
+        }
+        flusher_cv_.notify_one();
+        flusher_.join();
+    }
+    // 关闭前把剩余脏数据刷完，WriteBack 在正常退出时不丢写入
+    if (auto ranges = dirty_.collect(); !ranges.empty() && !sync_ranges(ranges)) {
+        SPDLOG_WARN("关闭镜像时刷盘失败: {}", path_);
+    }
+    // 先等预读任务结束，它们还在访问映射区
+    prefetch_worker_.reset();
     if (mapped_data_) {
 #ifdef _WIN32
         UnmapViewOfFile(mapped_data_);
@@ -144,10 +204,6 @@ RawImageBackend::~RawImageBackend() {
 #else
         munmap(mapped_data_, mapped_size_);
         close(fd_);
-#ifdef __linux__
-        close(splice_pipe_[0]);
-        close(splice_pipe_[1]);
-#endif
 #endif
     }
 }
@@ -161,13 +217,150 @@ std::size_t RawImageBackend::read(std::uint64_t lba, std::uint16_t count, void *
 }
 
 std::size_t RawImageBackend::write(std::uint64_t lba, std::uint16_t count, const void *data) {
-    std::lock_guard lock(mutex_);
     auto total = static_cast<std::size_t>(count) * block_size_;
     auto offset = static_cast<std::size_t>(lba) * block_size_;
-    std::memcpy(static_cast<char *>(mapped_data_) + offset, data, total);
+    {
+        std::lock_guard lock(mutex_);
+#ifndef _WIN32
+        if (durability_.mode == WriteDurability::WriteThrough) {
+            // 走文件接口写入：与 MAP_SHARED 映射共享页缓存，映射区随即可见新数据
+            auto *p = static_cast<const char *>(data);
+            std::size_t done = 0;
+            while (done < total) {
+                ssize_t n = ::pwrite(fd_, p + done, total - done, static_cast<off_t>(offset + done));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0) {
+                    SPDLOG_ERROR("pwrite 失败: LBA={} count={}: {}", lba, count, std::strerror(errno));
+                    return 0;
+                }
+                done += static_cast<std::size_t>(n);
+            }
+        }
+        else
+#endif
+        {
+            std::memcpy(static_cast<char *>(mapped_data_) + offset, data, total);
+        }
+    }
+    if (!after_write(lba, count)) {
+        return 0;
+    }
     return total;
 }
 
+bool RawImageBackend::after_write(std::uint64_t lba, std::uint64_t count) {
+    switch (durability_.mode) {
+        case WriteDurability::WriteThrough:
+#ifdef _WIN32
+            return sync_ranges({{lba, count, 0}});
+#else
+            // 写穿模式下文件里没有其他脏数据，整文件同步的代价只是本次写入
+#ifdef __APPLE__
+            if (fsync(fd_) != 0) {
+#else
+            if (fdatasync(fd_) != 0) {
+#endif
+                SPDLOG_ERROR("fdatasync 失败: {}", std::strerror(errno));
+                return false;
+            }
+            return true;
+#endif
+        case WriteDurability::WriteBack:
+            dirty_.mark(lba, count);
+            if (dirty_.dirty_blocks() * block_size_ >= durability_.dirty_limit_bytes) {
+                {
+                    std::lock_guard lock(flusher_mutex_);
+                    flusher_kick_ = true;
+                }
+                flusher_cv_.notify_one();
+            }
+            return true;
+        case WriteDurability::Unsafe:
+            break;
+    }
+    return true;
+}
+
+bool RawImageBackend::commit_direct_write(std::uint64_t lba, std::uint64_t count) {
+    if (!mapped_data_ || lba + count > block_count_)
+        return false;
+    return after_write(lba, count);
+}
+
+bool RawImageBackend::flush(std::uint64_t lba, std::uint64_t count) {
+    if (durability_.mode != WriteDurability::WriteBack)
+        return true;
+    auto ranges = dirty_.collect(lba, count);
+    if (ranges.empty())
+        return true;
+    if (!sync_ranges(ranges))
+        return false;
+    dirty_.clear(ranges);
+    return true;
+}
+
+bool RawImageBackend::sync_ranges(const std::vector<DirtyRangeTracker::Range> &ranges) {
+    if (!mapped_data_)
+        return false;
+    bool ok = true;
+#ifdef _WIN32
+    for (const auto &r: ranges) {
+        auto *addr = static_cast<char *>(mapped_data_) + r.lba * block_size_;
+        if (!FlushViewOfFile(addr, static_cast<SIZE_T>(r.count * block_size_))) {
+            SPDLOG_ERROR("FlushViewOfFile 失败: LBA={} count={}", r.lba, r.count);
+            ok = false;
+        }
+    }
+    if (ok && !FlushFileBuffers(file_handle_)) {
+        SPDLOG_ERROR("FlushFileBuffers 失败: {}", path_);
+        ok = false;
+    }
+#else
+#ifdef __linux__
+    // 先对所有区间发起异步写回，让块层一次看到整批请求去合并排序，再逐个等待
+    for (const auto &r: ranges) {
+        sync_file_range(fd_, static_cast<off64_t>(r.lba * block_size_), static_cast<off64_t>(r.count * block_size_),
+                        SYNC_FILE_RANGE_WRITE);
+    }
+#endif
+    // msync(MS_SYNC) 等待范围内数据落盘并刷设备缓存，相当于只针对该范围的 fdatasync
+    static const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    for (const auto &r: ranges) {
+        auto offset = static_cast<std::size_t>(r.lba) * block_size_;
+        auto aligned = offset / page_size * page_size;
+        auto length = static_cast<std::size_t>(r.count) * block_size_ + (offset - aligned);
+        if (msync(static_cast<char *>(mapped_data_) + aligned, length, MS_SYNC) != 0) {
+            SPDLOG_ERROR("msync 失败: LBA={} count={}: {}", r.lba, r.count, std::strerror(errno));
+            ok = false;
+        }
+    }
+#endif
+    return ok;
+}
+
+void RawImageBackend::flusher_loop() {
+    std::unique_lock lock(flusher_mutex_);
+    while (!flusher_stop_) {
+        flusher_cv_.wait_for(lock, std::chrono::milliseconds(durability_.flush_interval_ms),
+                             [this] { return flusher_stop_ || flusher_kick_; });
+        if (flusher_stop_)
+            break;
+        flusher_kick_ = false;
+        lock.unlock();
+        auto ranges = dirty_.collect();
+        if (!ranges.empty()) {
+            if (sync_ranges(ranges)) {
+                dirty_.clear(ranges);
+            }
+            else {
+                SPDLOG_WARN("后台刷盘失败，{} 个脏区间留待下次重试", ranges.size());
+            }
+        }
+        lock.lock();
+    }
+}
+
 void RawImageBackend::punch_hole(std::uint64_t lba, std::uint64_t count) {
     std::lock_guard lock(mutex_);
     auto offset = static_cast<std::size_t>(lba) * block_size_;
@@ -191,36 +384,66 @@ void RawImageBackend::punch_hole(std::uint64_t lba, std::uint64_t count) {
 #endif
 }
 
-bool RawImageBackend::recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
-                                  std::error_code &ec) {
+void RawImageBackend::prefetch(std::uint64_t lba, std::uint64_t count) {
+    if (!mapped_data_)
+        return;
+    auto offset = static_cast<std::size_t>(lba) * block_size_;
+    if (offset >= mapped_size_)
+        return;
+    auto length = std::min(static_cast<std::size_t>(count) * block_size_, mapped_size_ - offset);
+
+    // 后台已有两个窗口在排队说明磁盘跟不上，丢弃本次提示
+    if (prefetch_inflight_.fetch_add(1, std::memory_order_relaxed) >= 2) {
+        prefetch_inflight_.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+    if (!prefetch_worker_) {
+        prefetch_worker_ = std::make_unique<ThreadPool>(1);
+    }
+    auto *addr = static_cast<char *>(mapped_data_) + offset;
+    prefetch_worker_->submit([this, addr, length] {
 #ifdef _WIN32
-    return false; // Windows 无 splice，回退 asio::read
-#elif defined(__linux__)
-    if (splice_pipe_[0] < 0)
-        return false;
-    auto file_offset = static_cast<off64_t>(lba) * block_size_ + offset;
-    size_t remaining = length;
-    while (remaining > 0) {
-        // sock → pipe
-        ssize_t n = splice(static_cast<int>(sock_fd), nullptr, splice_pipe_[1], nullptr, remaining, SPLICE_F_MOVE);
-        if (n <= 0) {
-            if (n == 0)
-                break;
-            ec.assign(errno, std::generic_category());
-            return false;
+#if _WIN32_WINNT >= 0x0602
+        WIN32_MEMORY_RANGE_ENTRY range{addr, length};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+        // madvise 要求起始地址页对齐
+        static const auto page_size = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+        auto misalign = reinterpret_cast<std::uintptr_t>(addr) % page_size;
+        auto *start = addr - misalign;
+        auto len = length + misalign;
+#ifdef MADV_POPULATE_READ
+        // Linux 5.14+：在后台线程把页读入并建好页表，前台 memcpy 连缺页都不再触发
+        if (madvise(start, len, MADV_POPULATE_READ) == 0) {
+            prefetch_inflight_.fetch_sub(1, std::memory_order_relaxed);
+            return;
         }
-        // pipe → file（DMA 到页缓存，零用户态拷贝）
-        off64_t off = static_cast<off64_t>(file_offset + (length - remaining));
-        ssize_t m = splice(splice_pipe_[0], nullptr, fd_, &off, n, SPLICE_F_MOVE);
-        if (m < 0) {
-            ec.assign(errno, std::generic_category());
-            return false;
+#endif
+        if (madvise(start, len, MADV_WILLNEED) != 0) {
+            SPDLOG_DEBUG("madvise WILLNEED 失败: addr={} length={}", static_cast<void *>(addr), length);
         }
-        remaining -= m;
-    }
-    return true;
+#endif
+        prefetch_inflight_.fetch_sub(1, std::memory_order_relaxed);
+    });
+}
+
+bool RawImageBackend::recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                                  SplicePipePool &pipes, std::error_code &ec) {
+#ifdef __linux__
+    if (!splice_receive_.load(std::memory_order_relaxed) || fd_ < 0)
+        return false;
+    auto lease = pipes.acquire(length);
+    if (!lease.pipe().valid())
+        return false;
+    auto file_offset = static_cast<off64_t>(lba) * block_size_ + static_cast<off64_t>(offset);
+    if (splice_to_file(static_cast<int>(sock_fd), fd_, file_offset, length, lease.pipe(), ec))
+        return true;
+    if (ec)
+        lease.discard(); // 管道里可能残留半截数据
+    return false;
 #else
-    return false; // macOS 等无 splice，回退 asio::read
+    return false; // 无 splice，回退 asio::read 到映射区
 #endif
 }
 
@@ -252,25 +475,26 @@ bool RawImageBackend::send_direct(std::uint64_t lba, std::size_t offset, std::si
     }
     return true;
 #elif defined(__linux__)
-    // splice: file → pipe → sock（与 recv 共用 splice_pipe_）
-    if (splice_pipe_[0] < 0)
-        return false;
-    off64_t off = static_cast<off64_t>(file_offset);
-    size_t remaining = length;
-    while (remaining > 0) {
-        ssize_t n = splice(fd_, &off, splice_pipe_[1], nullptr, remaining, SPLICE_F_MOVE);
-        if (n <= 0) {
-            if (n == 0)
-                break;
-            ec.assign(errno, std::generic_category());
-            return false;
+    // sendfile: 页缓存 → socket，内核内部就是 splice，不占用调用者的管道
+    auto sock = static_cast<int>(sock_fd);
+    off_t off = static_cast<off_t>(file_offset);
+    std::size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::sendfile(sock, fd_, &off, length - done);
+        if (n < 0 && errno == EAGAIN) {
+            if (!detail::wait_fd_ready(sock, true)) {
+                ec.assign(EIO, std::generic_category());
+                return false;
+            }
+            continue;
         }
-        ssize_t m = splice(splice_pipe_[0], nullptr, static_cast<int>(sock_fd), nullptr, n, SPLICE_F_MOVE);
-        if (m < 0) {
-            ec.assign(errno, std::generic_category());
+        if (n <= 0) {
+            if (done == 0 && n < 0 && (errno == EINVAL || errno == ENOSYS))
+                return false; // 不支持 sendfile 的 socket，回退
+            ec.assign(n == 0 ? EIO : errno, std::generic_category());
             return false;
         }
-        remaining -= m;
+        done += static_cast<std::size_t>(n);
     }
     return true;
 #elif defined(__APPLE__)
@@ -0,0 +1,516 @@
+#include "usbipdcpp/virtual_device/storage_backends/ScrubBackend.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+#ifdef USBIPDCPP_HAVE_XXHASH
+#include <xxhash.h>
+#elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define USBIPDCPP_CRC32C_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define USBIPDCPP_CRC32C_ARM 1
+#endif
+
+namespace usbipdcpp {
+
+using namespace detail;
+
+namespace {
+
+    /**
+     * sidecar 文件格式（小端）：
+     *   [SidecarHeader 40 字节][uint64 校验和 × chunk 数][uint8 状态 × chunk 数]
+     */
+    constexpr char SIDECAR_MAGIC[8] = {'U', 'S', 'B', 'I', 'P', 'S', 'C', 'R'};
+    constexpr std::uint32_t SIDECAR_VERSION = 1;
+
+    struct SidecarHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t algorithm; // 1 = XXH3-64，2 = CRC32C
+        std::uint32_t block_size;
+        std::uint32_t chunk_blocks;
+        std::uint64_t chunk_count;
+        std::uint32_t clean; // 0 = 写入后尚未保存，校验和不可信
+        std::uint32_t reserved;
+    };
+    static_assert(sizeof(SidecarHeader) == 40);
+
+#ifdef USBIPDCPP_HAVE_XXHASH
+    constexpr std::uint32_t CHECKSUM_ALGORITHM = 1;
+#else
+    constexpr std::uint32_t CHECKSUM_ALGORITHM = 2;
+
+    constexpr std::array<std::uint32_t, 256> make_crc32c_table() {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            auto c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1; // Castagnoli 多项式（反射）
+            table[i] = c;
+        }
+        return table;
+    }
+
+    constexpr auto CRC32C_TABLE = make_crc32c_table();
+
+    std::uint32_t crc32c_sw(std::uint32_t crc, const std::uint8_t *p, std::size_t n) {
+        while (n--)
+            crc = CRC32C_TABLE[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+#if defined(USBIPDCPP_CRC32C_X86)
+    __attribute__((target("sse4.2"))) std::uint32_t crc32c_hw(std::uint32_t crc, const std::uint8_t *p,
+                                                              std::size_t n) {
+        std::uint64_t c = crc;
+        for (; n >= 8; p += 8, n -= 8) {
+            std::uint64_t v;
+            std::memcpy(&v, p, 8);
+            c = _mm_crc32_u64(c, v);
+        }
+        auto c32 = static_cast<std::uint32_t>(c);
+        while (n--)
+            c32 = _mm_crc32_u8(c32, *p++);
+        return c32;
+    }
+
+    bool has_hw_crc32c() {
+        static const bool supported = __builtin_cpu_supports("sse4.2");
+        return supported;
+    }
+#elif defined(USBIPDCPP_CRC32C_ARM)
+    std::uint32_t crc32c_hw(std::uint32_t crc, const std::uint8_t *p, std::size_t n) {
+        for (; n >= 8; p += 8, n -= 8) {
+            std::uint64_t v;
+            std::memcpy(&v, p, 8);
+            crc = __crc32cd(crc, v);
+        }
+        while (n--)
+            crc = __crc32cb(crc, *p++);
+        return crc;
+    }
+
+    bool has_hw_crc32c() {
+        return true;
+    }
+#else
+    bool has_hw_crc32c() {
+        return false;
+    }
+#endif
+#endif
+
+} // namespace
+
+const char *ScrubBackend::checksum_name() {
+#ifdef USBIPDCPP_HAVE_XXHASH
+    return "xxh3";
+#else
+    return has_hw_crc32c() ? "crc32c-hw" : "crc32c";
+#endif
+}
+
+std::uint64_t ScrubBackend::checksum(const void *data, std::size_t len) {
+#ifdef USBIPDCPP_HAVE_XXHASH
+    return XXH3_64bits(data, len);
+#else
+    auto *p = static_cast<const std::uint8_t *>(data);
+#if defined(USBIPDCPP_CRC32C_X86) || defined(USBIPDCPP_CRC32C_ARM)
+    if (has_hw_crc32c())
+        return ~crc32c_hw(~0u, p, len);
+#endif
+    return ~crc32c_sw(~0u, p, len);
+#endif
+}
+
+ScrubBackend::ScrubBackend(std::unique_ptr<StorageBackend> inner, std::string sidecar_path, ScrubOptions options) :
+    inner_(std::move(inner)), sidecar_path_(std::move(sidecar_path)), options_(std::move(options)) {
+    // read 接口一次最多 0xFFFF 块
+    options_.chunk_blocks = std::clamp<std::uint32_t>(options_.chunk_blocks, 1, 0xFFFF);
+    auto blocks = inner_->block_count();
+    chunk_count_ = (blocks + options_.chunk_blocks - 1) / options_.chunk_blocks;
+    generations_ = std::make_unique<std::atomic<std::uint32_t>[]>(chunk_count_);
+    checksums_.assign(chunk_count_, 0);
+    states_.assign(chunk_count_, ChunkState::Unknown);
+    seen_generations_.assign(chunk_count_, 0);
+
+    sidecar_fd_ = open_file(sidecar_path_, true, true);
+    if (sidecar_fd_ == invalid_fd) {
+        SPDLOG_ERROR("无法打开校验和文件 {}，巡检结果不会保存", sidecar_path_);
+    }
+    else if (!load_sidecar()) {
+        SPDLOG_INFO("校验和文件 {} 无可用记录，首轮巡检重新计算（{}）", sidecar_path_, checksum_name());
+    }
+    worker_ = std::thread([this] { worker_loop(); });
+}
+
+ScrubBackend::~ScrubBackend() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+    save_sidecar();
+    close_file(sidecar_fd_);
+}
+
+std::uint64_t ScrubBackend::chunk_blocks_of(std::uint64_t chunk) const {
+    auto first = chunk * options_.chunk_blocks;
+    return std::min<std::uint64_t>(options_.chunk_blocks, inner_->block_count() - first);
+}
+
+// ============== 前台路径 ==============
+
+void ScrubBackend::mark_sidecar_unclean() {
+    // 快路径：已标记过，只是一次原子读
+    if (!sidecar_clean_.load())
+        return;
+    std::lock_guard lock(sidecar_mutex_);
+    if (!sidecar_clean_.load())
+        return;
+    std::uint32_t clean = 0;
+    if (!pwrite_all(sidecar_fd_, &clean, sizeof(clean), offsetof(SidecarHeader, clean)) || !sync_file(sidecar_fd_)) {
+        SPDLOG_WARN("校验和文件 {} 标记失败", sidecar_path_);
+    }
+    sidecar_clean_.store(false);
+}
+
+void ScrubBackend::touch(std::uint64_t lba, std::uint64_t count) {
+    if (count == 0 || lba >= inner_->block_count())
+        return;
+    auto first = lba / options_.chunk_blocks;
+    auto last = std::min(chunk_count_ - 1, (lba + count - 1) / options_.chunk_blocks);
+    for (auto c = first; c <= last; ++c)
+        generations_[c].fetch_add(1);
+    // 先改代号再查 sidecar 标记，与 save_sidecar 的"先置标记再读代号"配对，
+    // 保证每次写入要么被保存时的快照看到，要么把文件重新标记为未同步
+    mark_sidecar_unclean();
+}
+
+std::size_t ScrubBackend::read(std::uint64_t lba, std::uint16_t count, void *buffer) {
+    note_io();
+    return inner_->read(lba, count, buffer);
+}
+
+std::size_t ScrubBackend::write(std::uint64_t lba, std::uint16_t count, const void *data) {
+    note_io();
+    // 写前写后各改一次代号：后台读取与写入重叠时，前后两次读到的代号必然不同
+    touch(lba, count);
+    auto n = inner_->write(lba, count, data);
+    touch(lba, count);
+    return n;
+}
+
+bool ScrubBackend::read_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) {
+    note_io();
+    return inner_->read_segments(lba, count, out);
+}
+
+bool ScrubBackend::write_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) {
+    note_io();
+    mark_sidecar_unclean();
+    return inner_->write_segments(lba, count, out);
+}
+
+bool ScrubBackend::commit_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &segments) {
+    note_io();
+    touch(lba, count);
+    auto ok = inner_->commit_segments(lba, count, segments);
+    touch(lba, count);
+    return ok;
+}
+
+void ScrubBackend::punch_hole(std::uint64_t lba, std::uint64_t count) {
+    note_io();
+    touch(lba, count);
+    inner_->punch_hole(lba, count);
+    touch(lba, count);
+}
+
+void ScrubBackend::prefetch(std::uint64_t lba, std::uint64_t count) {
+    inner_->prefetch(lba, count);
+}
+
+bool ScrubBackend::flush(std::uint64_t lba, std::uint64_t count) {
+    return inner_->flush(lba, count);
+}
+
+bool ScrubBackend::commit_direct_write(std::uint64_t lba, std::uint64_t count) {
+    // 数据此前已直接进了映射区；提交之前读到新数据的后台校验会进入复查，复查时代号已变
+    auto ok = inner_->commit_direct_write(lba, count);
+    touch(lba, count);
+    return ok;
+}
+
+void *ScrubBackend::get_direct_buffer(std::uint64_t lba) {
+    note_io();
+    // READ 与 WRITE 都经这里取映射区，无法区分，一律先把 sidecar 标记为未同步
+    mark_sidecar_unclean();
+    return inner_->get_direct_buffer(lba);
+}
+
+bool ScrubBackend::send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                               std::error_code &ec) {
+    note_io();
+    return inner_->send_direct(lba, offset, length, sock_fd, ec);
+}
+
+bool ScrubBackend::send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                               SplicePipePool &pipes, std::error_code &ec) {
+    note_io();
+    return inner_->send_direct(lba, offset, length, sock_fd, pipes, ec);
+}
+
+bool ScrubBackend::recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                               std::error_code &ec) {
+    note_io();
+    return inner_->recv_direct(lba, offset, length, sock_fd, ec);
+}
+
+bool ScrubBackend::recv_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                               SplicePipePool &pipes, std::error_code &ec) {
+    note_io();
+    return inner_->recv_direct(lba, offset, length, sock_fd, pipes, ec);
+}
+
+// ============== 后台巡检 ==============
+
+bool ScrubBackend::wait_foreground_idle(std::unique_lock<std::mutex> &lock) {
+    auto idle = std::chrono::duration_cast<std::chrono::nanoseconds>(options_.idle_after_io);
+    while (!stop_) {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        auto since = now - std::chrono::nanoseconds(last_io_ns_.load(std::memory_order_relaxed));
+        if (since >= idle)
+            return true;
+        auto pause = idle - since;
+        cv_.wait_for(lock, pause, [this] { return stop_; });
+        paused_ms_.fetch_add(static_cast<std::uint64_t>(
+                                     std::chrono::duration_cast<std::chrono::milliseconds>(pause).count()),
+                             std::memory_order_relaxed);
+    }
+    return false;
+}
+
+void ScrubBackend::worker_loop() {
+    std::vector<std::uint8_t> buf;
+    std::unique_lock lock(mutex_);
+    while (!stop_) {
+        for (std::uint64_t chunk = 0; chunk < chunk_count_; ++chunk) {
+            if (!wait_foreground_idle(lock))
+                return;
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            recheck_suspects(buf);
+            auto bytes = scrub_chunk(chunk, buf);
+            lock.lock();
+            // 限速：这一块按速率应占用的时间减去实际耗时
+            if (options_.bytes_per_second > 0) {
+                auto budget = std::chrono::nanoseconds(static_cast<std::int64_t>(
+                        static_cast<double>(bytes) * 1e9 / static_cast<double>(options_.bytes_per_second)));
+                auto spent = std::chrono::steady_clock::now() - start;
+                if (budget > spent)
+                    cv_.wait_for(lock, budget - spent, [this] { return stop_; });
+            }
+            if (stop_)
+                return;
+        }
+        lock.unlock();
+        save_sidecar();
+        passes_.fetch_add(1, std::memory_order_relaxed);
+        SPDLOG_DEBUG("完成一轮巡检: {}", sidecar_path_);
+        lock.lock();
+
+        // 等下一轮，期间到期的可疑 chunk 照常复查
+        auto next_pass = std::chrono::steady_clock::now() + options_.pass_interval;
+        while (!stop_ && !kick_ && std::chrono::steady_clock::now() < next_pass) {
+            auto until = next_pass;
+            for (auto &s: suspects_)
+                until = std::min(until, s.recheck_at);
+            cv_.wait_until(lock, until, [this] { return stop_ || kick_; });
+            lock.unlock();
+            recheck_suspects(buf);
+            lock.lock();
+        }
+        kick_ = false;
+    }
+}
+
+bool ScrubBackend::read_checksum(std::uint64_t chunk, std::vector<std::uint8_t> &buf, std::uint32_t &generation,
+                                 std::uint64_t &sum, std::size_t &bytes) {
+    auto lba = chunk * options_.chunk_blocks;
+    auto count = static_cast<std::uint16_t>(chunk_blocks_of(chunk));
+    bytes = static_cast<std::size_t>(count) * inner_->block_size();
+    buf.resize(bytes);
+    auto before = generations_[chunk].load();
+    if (inner_->read(lba, count, buf.data()) != bytes) {
+        SPDLOG_WARN("巡检读取失败: LBA={} count={}", lba, count);
+        return false;
+    }
+    sum = checksum(buf.data(), bytes);
+    generation = before;
+    bytes_read_.fetch_add(bytes, std::memory_order_relaxed);
+    return generations_[chunk].load() == before;
+}
+
+std::size_t ScrubBackend::scrub_chunk(std::uint64_t chunk, std::vector<std::uint8_t> &buf) {
+    std::uint32_t generation = 0;
+    std::uint64_t sum = 0;
+    std::size_t bytes = 0;
+    if (!read_checksum(chunk, buf, generation, sum, bytes)) {
+        skipped_.fetch_add(1, std::memory_order_relaxed);
+        return bytes;
+    }
+    if (states_[chunk] == ChunkState::Unknown || seen_generations_[chunk] != generation) {
+        // 首次巡检或被前台写过：当前内容即为基准
+        if (states_[chunk] == ChunkState::Bad) {
+            std::lock_guard lock(mutex_);
+            auto lba = chunk * options_.chunk_blocks;
+            std::erase_if(mismatched_, [&](const Range &r) { return r.lba == lba; });
+        }
+        checksums_[chunk] = sum;
+        states_[chunk] = ChunkState::Valid;
+        seen_generations_[chunk] = generation;
+        recorded_.fetch_add(1, std::memory_order_relaxed);
+        return bytes;
+    }
+    if (states_[chunk] == ChunkState::Bad)
+        return bytes; // 已报告过，重写之前不再重复报告
+    if (sum == checksums_[chunk]) {
+        verified_.fetch_add(1, std::memory_order_relaxed);
+        return bytes;
+    }
+    bool pending = std::any_of(suspects_.begin(), suspects_.end(), [&](const Suspect &s) { return s.chunk == chunk; });
+    if (!pending)
+        suspects_.push_back({chunk, generation, sum, std::chrono::steady_clock::now() + options_.confirm_delay});
+    return bytes;
+}
+
+void ScrubBackend::recheck_suspects(std::vector<std::uint8_t> &buf) {
+    auto now = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < suspects_.size();) {
+        auto s = suspects_[i];
+        if (s.recheck_at > now) {
+            ++i;
+            continue;
+        }
+        suspects_.erase(suspects_.begin() + static_cast<std::ptrdiff_t>(i));
+        std::uint32_t generation = 0;
+        std::uint64_t sum = 0;
+        std::size_t bytes = 0;
+        // 期间被写过（含尚未提交的直写已提交）或内容恢复：都不算损坏，交给下一轮处理
+        if (!read_checksum(s.chunk, buf, generation, sum, bytes) || generation != s.generation ||
+            sum == checksums_[s.chunk])
+            continue;
+        states_[s.chunk] = ChunkState::Bad;
+        Range range{s.chunk * options_.chunk_blocks, chunk_blocks_of(s.chunk)};
+        {
+            std::lock_guard lock(mutex_);
+            mismatched_.push_back(range);
+        }
+        SPDLOG_ERROR("巡检发现数据与校验和不一致: LBA={} count={} ({} 记录 {:016X}，实际 {:016X})", range.lba,
+                     range.count, checksum_name(), checksums_[s.chunk], sum);
+        if (options_.on_mismatch)
+            options_.on_mismatch(range.lba, range.count);
+        mismatches_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ScrubBackend::scrub_now() {
+    {
+        std::lock_guard lock(mutex_);
+        kick_ = true;
+    }
+    cv_.notify_all();
+}
+
+ScrubBackend::ScrubStats ScrubBackend::scrub_stats() const {
+    return {passes_.load(std::memory_order_relaxed),   bytes_read_.load(std::memory_order_relaxed),
+            verified_.load(std::memory_order_relaxed), recorded_.load(std::memory_order_relaxed),
+            skipped_.load(std::memory_order_relaxed),  mismatches_.load(std::memory_order_relaxed),
+            paused_ms_.load(std::memory_order_relaxed)};
+}
+
+std::vector<ScrubBackend::Range> ScrubBackend::mismatched_ranges() const {
+    std::lock_guard lock(mutex_);
+    return mismatched_;
+}
+
+// ============== sidecar ==============
+
+bool ScrubBackend::load_sidecar() {
+    SidecarHeader header{};
+    if (file_size(sidecar_fd_) < sizeof(header) || !pread_all(sidecar_fd_, &header, sizeof(header), 0))
+        return false;
+    if (std::memcmp(header.magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC)) != 0 || header.version != SIDECAR_VERSION ||
+        header.algorithm != CHECKSUM_ALGORITHM || header.block_size != inner_->block_size() ||
+        header.chunk_blocks != options_.chunk_blocks || header.chunk_count != chunk_count_) {
+        SPDLOG_WARN("校验和文件 {} 与当前镜像或参数不匹配，丢弃", sidecar_path_);
+        return false;
+    }
+    if (!header.clean) {
+        SPDLOG_WARN("校验和文件 {} 上次未正常保存，丢弃", sidecar_path_);
+        return false;
+    }
+    std::vector<std::uint8_t> states(chunk_count_);
+    if (!pread_all(sidecar_fd_, checksums_.data(), chunk_count_ * sizeof(std::uint64_t), sizeof(header)) ||
+        !pread_all(sidecar_fd_, states.data(), chunk_count_, sizeof(header) + chunk_count_ * sizeof(std::uint64_t))) {
+        checksums_.assign(chunk_count_, 0);
+        return false;
+    }
+    std::size_t valid = 0;
+    for (std::uint64_t c = 0; c < chunk_count_; ++c) {
+        states_[c] = states[c] <= static_cast<std::uint8_t>(ChunkState::Bad) ? static_cast<ChunkState>(states[c])
+                                                                             : ChunkState::Unknown;
+        if (states_[c] == ChunkState::Valid)
+            ++valid;
+        else if (states_[c] == ChunkState::Bad)
+            mismatched_.push_back({c * options_.chunk_blocks, chunk_blocks_of(c)});
+    }
+    // 文件内容与内存一致，直到第一次写入
+    sidecar_clean_.store(true);
+    SPDLOG_INFO("载入校验和文件 {}: {}/{} 个 chunk 有记录, {} 个已知不一致", sidecar_path_, valid, chunk_count_,
+                mismatched_.size());
+    return true;
+}
+
+void ScrubBackend::save_sidecar() {
+    if (sidecar_fd_ == invalid_fd)
+        return;
+    std::lock_guard lock(sidecar_mutex_);
+    // 先置标记再读代号（见 touch）：之后的写入会把文件重新标记为未同步
+    sidecar_clean_.store(true);
+    std::vector<std::uint8_t> states(chunk_count_);
+    for (std::uint64_t c = 0; c < chunk_count_; ++c) {
+        auto state = states_[c];
+        // 记录之后又被写过的 chunk，保存的校验和已过时
+        if (state != ChunkState::Unknown && generations_[c].load() != seen_generations_[c])
+            state = ChunkState::Unknown;
+        states[c] = static_cast<std::uint8_t>(state);
+    }
+    SidecarHeader header{};
+    std::memcpy(header.magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+    header.version = SIDECAR_VERSION;
+    header.algorithm = CHECKSUM_ALGORITHM;
+    header.block_size = inner_->block_size();
+    header.chunk_blocks = options_.chunk_blocks;
+    header.chunk_count = chunk_count_;
+    header.clean = 1;
+    auto states_off = sizeof(header) + chunk_count_ * sizeof(std::uint64_t);
+    if (!pwrite_all(sidecar_fd_, &header, sizeof(header), 0) ||
+        !pwrite_all(sidecar_fd_, checksums_.data(), chunk_count_ * sizeof(std::uint64_t), sizeof(header)) ||
+        !pwrite_all(sidecar_fd_, states.data(), chunk_count_, states_off) ||
+        !resize_file(sidecar_fd_, states_off + chunk_count_) || !sync_file(sidecar_fd_)) {
+        SPDLOG_ERROR("保存校验和文件 {} 失败", sidecar_path_);
+        sidecar_clean_.store(false);
+    }
+}
+
+} // namespace usbipdcpp
@@ -0,0 +1,247 @@
+// clang-format off
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h> // macOS sendfile
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+// clang-format on
+
+#include "usbipdcpp/virtual_device/storage_backends/SharedImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/SplicePipePool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+
+namespace usbipdcpp {
+
+// ============== SharedImage ==============
+
+SharedImage::SharedImage(std::string path) :
+    path_(std::move(path)) {
+#ifdef _WIN32
+    HANDLE fh = CreateFileA(path_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fh == INVALID_HANDLE_VALUE) {
+        SPDLOG_ERROR("无法打开镜像: {}", path_);
+        return;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fh, &size) || size.QuadPart == 0) {
+        SPDLOG_ERROR("镜像为空或无法获取大小: {}", path_);
+        CloseHandle(fh);
+        return;
+    }
+    HANDLE mh = CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mh) {
+        SPDLOG_ERROR("CreateFileMapping 失败: {}", path_);
+        CloseHandle(fh);
+        return;
+    }
+    void *addr = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+    if (!addr) {
+        SPDLOG_ERROR("MapViewOfFile 失败: {}", path_);
+        CloseHandle(mh);
+        CloseHandle(fh);
+        return;
+    }
+    file_handle_ = fh;
+    mapping_handle_ = mh;
+    mapped_data_ = addr;
+    mapped_size_ = static_cast<std::uint64_t>(size.QuadPart);
+#else
+    int fd = open(path_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        SPDLOG_ERROR("无法打开镜像: {}: {}", path_, std::strerror(errno));
+        return;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        SPDLOG_ERROR("镜像为空或无法获取大小: {}", path_);
+        close(fd);
+        return;
+    }
+    // 只读共享映射：所有会话共用这一份页表，页面直接来自页缓存
+    void *addr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        SPDLOG_ERROR("mmap 失败: {}: {}", path_, std::strerror(errno));
+        close(fd);
+        return;
+    }
+    fd_ = fd;
+    mapped_data_ = addr;
+    mapped_size_ = static_cast<std::uint64_t>(st.st_size);
+#endif
+    SPDLOG_INFO("映射共享只读镜像: {} ({} MiB)", path_, mapped_size_ / 1024 / 1024);
+}
+
+SharedImage::~SharedImage() {
+    if (!mapped_data_)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(mapped_data_);
+    CloseHandle(mapping_handle_);
+    CloseHandle(file_handle_);
+#else
+    munmap(mapped_data_, static_cast<std::size_t>(mapped_size_));
+    close(fd_);
+#endif
+    SPDLOG_INFO("释放共享只读镜像: {}", path_);
+}
+
+bool SharedImage::send_file(std::uint64_t offset, std::size_t length, intptr_t sock_fd, std::error_code &ec) const {
+#if defined(__linux__)
+    // 显式传入偏移，不改动文件位置，多个会话可同时对同一 fd 调用
+    auto sock = static_cast<int>(sock_fd);
+    off_t off = static_cast<off_t>(offset);
+    std::size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::sendfile(sock, fd_, &off, length - done);
+        if (n < 0 && errno == EAGAIN) {
+            if (!detail::wait_fd_ready(sock, true)) {
+                ec.assign(EIO, std::generic_category());
+                return false;
+            }
+            continue;
+        }
+        if (n <= 0) {
+            if (done == 0 && n < 0 && (errno == EINVAL || errno == ENOSYS))
+                return false; // 不支持 sendfile 的 socket，回退
+            ec.assign(n == 0 ? EIO : errno, std::generic_category());
+            return false;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return true;
+#elif defined(__APPLE__)
+    off_t off = static_cast<off_t>(offset);
+    off_t remaining = static_cast<off_t>(length);
+    while (remaining > 0) {
+        off_t sent = remaining;
+        if (sendfile(fd_, static_cast<int>(sock_fd), off, &sent, nullptr, 0) < 0) {
+            if (errno == EAGAIN)
+                continue;
+            ec.assign(errno, std::generic_category());
+            return false;
+        }
+        off += sent;
+        remaining -= sent;
+    }
+    return true;
+#else
+    // Windows 的 TransmitFile 依赖共享的文件指针，多会话并发时不安全，回退 asio::write 映射区
+    (void) offset;
+    (void) length;
+    (void) sock_fd;
+    (void) ec;
+    return false;
+#endif
+}
+
+// ============== SharedImageRegistry ==============
+
+SharedImageRegistry &SharedImageRegistry::instance() {
+    static SharedImageRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<const SharedImage> SharedImageRegistry::open(const std::string &path) {
+    std::error_code ec;
+    auto key = std::filesystem::weakly_canonical(path, ec).string();
+    if (ec)
+        key = std::filesystem::absolute(path).string();
+
+    std::lock_guard lock(mutex_);
+    if (auto it = images_.find(key); it != images_.end()) {
+        if (auto existing = it->second.lock())
+            return existing;
+    }
+    // 顺带清理已失效的条目
+    std::erase_if(images_, [](const auto &kv) { return kv.second.expired(); });
+
+    std::shared_ptr<const SharedImage> image(new SharedImage(key));
+    if (!image->is_valid())
+        return nullptr;
+    images_[key] = image;
+    return image;
+}
+
+std::size_t SharedImageRegistry::open_images() {
+    std::lock_guard lock(mutex_);
+    return static_cast<std::size_t>(
+            std::count_if(images_.begin(), images_.end(), [](const auto &kv) { return !kv.second.expired(); }));
+}
+
+// ============== SharedImageBackend ==============
+
+SharedImageBackend::SharedImageBackend(std::shared_ptr<const SharedImage> image, std::uint32_t block_size) :
+    image_(std::move(image)), block_size_(block_size) {
+    if (image_) {
+        block_count_ = image_->size() / block_size_;
+        if (image_->size() % block_size_ != 0) {
+            SPDLOG_WARN("镜像大小不是 {} 的整数倍，末尾 {} 字节不可见: {}", block_size_,
+                        image_->size() % block_size_, image_->path());
+        }
+    }
+}
+
+SharedImageBackend::SharedImageBackend(const std::string &path, std::uint32_t block_size) :
+    SharedImageBackend(SharedImageRegistry::instance().open(path), block_size) {
+}
+
+std::size_t SharedImageBackend::read(std::uint64_t lba, std::uint16_t count, void *buffer) {
+    if (!image_ || lba + count > block_count_)
+        return 0;
+    auto total = static_cast<std::size_t>(count) * block_size_;
+    std::memcpy(buffer, image_->data() + lba * block_size_, total);
+    return total;
+}
+
+std::size_t SharedImageBackend::write(std::uint64_t lba, std::uint16_t count, const void *) {
+    SPDLOG_WARN("只读镜像拒绝写入: LBA={} count={}", lba, count);
+    return 0;
+}
+
+void SharedImageBackend::prefetch(std::uint64_t lba, std::uint64_t count) {
+#ifndef _WIN32
+    if (!image_ || lba >= block_count_)
+        return;
+    count = std::min(count, block_count_ - lba);
+    static const auto page_size = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    auto *addr = image_->data() + lba * block_size_;
+    auto misalign = reinterpret_cast<std::uintptr_t>(addr) % page_size;
+    // WILLNEED 只把预读请求交给内核就返回，不需要 RawImageBackend 那样的后台线程
+    if (madvise(const_cast<std::uint8_t *>(addr - misalign), count * block_size_ + misalign, MADV_WILLNEED) != 0) {
+        SPDLOG_DEBUG("madvise WILLNEED 失败: LBA={} count={}", lba, count);
+    }
+#else
+    (void) lba;
+    (void) count;
+#endif
+}
+
+void *SharedImageBackend::get_direct_buffer(std::uint64_t lba) {
+    if (!image_ || lba >= block_count_)
+        return nullptr;
+    // 映射为 PROT_READ；handler 对 is_read_only() 的 LUN 不会走直写路径
+    return const_cast<std::uint8_t *>(image_->data() + lba * block_size_);
+}
+
+bool SharedImageBackend::send_direct(std::uint64_t lba, std::size_t offset, std::size_t length, intptr_t sock_fd,
+                                     std::error_code &ec) {
+    if (!image_)
+        return false;
+    return image_->send_file(lba * block_size_ + offset, length, sock_fd, ec);
+}
+
+} // namespace usbipdcpp
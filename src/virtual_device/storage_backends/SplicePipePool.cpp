@@ -0,0 +1,138 @@
+// clang-format off
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+// clang-format on
+
+#include "usbipdcpp/virtual_device/storage_backends/SplicePipePool.h"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace usbipdcpp {
+
+SplicePipePool::Lease::Lease(Lease &&other) noexcept :
+    pool_(std::exchange(other.pool_, nullptr)), pipe_(std::exchange(other.pipe_, {})),
+    discard_(other.discard_) {
+}
+
+SplicePipePool::Lease &SplicePipePool::Lease::operator=(Lease &&other) noexcept {
+    if (this != &other) {
+        if (pool_)
+            pool_->release(pipe_, discard_);
+        pool_ = std::exchange(other.pool_, nullptr);
+        pipe_ = std::exchange(other.pipe_, {});
+        discard_ = other.discard_;
+    }
+    return *this;
+}
+
+SplicePipePool::Lease::~Lease() {
+    if (pool_)
+        pool_->release(pipe_, discard_);
+}
+
+SplicePipePool::SplicePipePool(std::size_t max_pipe_size) : max_pipe_size_(max_pipe_size) {
+}
+
+SplicePipePool::~SplicePipePool() {
+    for (auto &pipe: free_)
+        release(pipe, true);
+}
+
+SplicePipePool::Lease SplicePipePool::acquire(std::size_t want) {
+#ifdef __linux__
+    SplicePipe pipe;
+    {
+        std::lock_guard lock(mutex_);
+        if (!free_.empty()) {
+            pipe = free_.back();
+            free_.pop_back();
+        }
+        else if (unsupported_) {
+            return {};
+        }
+    }
+    if (!pipe.valid()) {
+        int fds[2];
+        if (::pipe2(fds, O_CLOEXEC) < 0) {
+            SPDLOG_WARN("pipe 创建失败，splice 零拷贝不可用: {}", std::strerror(errno));
+            std::lock_guard lock(mutex_);
+            unsupported_ = true;
+            return {};
+        }
+        pipe.read_fd = fds[0];
+        pipe.write_fd = fds[1];
+        auto size = ::fcntl(fds[1], F_GETPIPE_SZ);
+        pipe.capacity = size > 0 ? static_cast<std::size_t>(size) : 65536;
+        created_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (pipe.capacity < want)
+        grow(pipe, want);
+    return Lease(this, pipe);
+#else
+    (void) want;
+    return {};
+#endif
+}
+
+void SplicePipePool::grow(SplicePipe &pipe, std::size_t want) const {
+#ifdef __linux__
+    std::size_t target = pipe.capacity;
+    while (target < want && target < max_pipe_size_)
+        target *= 2;
+    // 非特权进程超过 pipe-max-size 会 EPERM，逐级减半直到不大于当前容量
+    for (; target > pipe.capacity; target /= 2) {
+        auto size = ::fcntl(pipe.write_fd, F_SETPIPE_SZ, static_cast<int>(target));
+        if (size > 0) {
+            pipe.capacity = static_cast<std::size_t>(size);
+            return;
+        }
+    }
+#else
+    (void) pipe;
+    (void) want;
+#endif
+}
+
+void SplicePipePool::release(SplicePipe pipe, bool discard) {
+    if (!pipe.valid())
+        return;
+#ifdef __linux__
+    if (!discard) {
+        std::lock_guard lock(mutex_);
+        free_.push_back(pipe);
+        return;
+    }
+    ::close(pipe.read_fd);
+    ::close(pipe.write_fd);
+#endif
+}
+
+namespace detail {
+
+bool wait_fd_ready(int fd, bool writable) {
+#ifdef __linux__
+    pollfd pfd{fd, static_cast<short>(writable ? POLLOUT : POLLIN), 0};
+    for (;;) {
+        auto n = ::poll(&pfd, 1, -1);
+        if (n > 0)
+            return (pfd.revents & (POLLERR | POLLNVAL)) == 0;
+        if (n < 0 && errno != EINTR)
+            return false;
+    }
+#else
+    (void) fd;
+    (void) writable;
+    return false;
+#endif
+}
+
+} // namespace detail
+
+} // namespace usbipdcpp
@@ -0,0 +1,170 @@
+// clang-format off
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+// clang-format on
+
+#include "usbipdcpp/virtual_device/storage_backends/StorageFileIo.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+namespace usbipdcpp {
+namespace detail {
+
+#ifdef _WIN32
+native_fd open_file(const std::string &path, bool writable, bool create) {
+    DWORD access = GENERIC_READ | (writable ? GENERIC_WRITE : 0);
+    DWORD disposition = create ? OPEN_ALWAYS : OPEN_EXISTING;
+    return CreateFileA(path.c_str(), access, FILE_SHARE_READ, nullptr, disposition, FILE_ATTRIBUTE_NORMAL,
+                       nullptr);
+}
+
+void close_file(native_fd fd) {
+    CloseHandle(fd);
+}
+
+std::uint64_t file_size(native_fd fd) {
+    LARGE_INTEGER size{};
+    return GetFileSizeEx(fd, &size) ? static_cast<std::uint64_t>(size.QuadPart) : 0;
+}
+
+bool resize_file(native_fd fd, std::uint64_t size) {
+    // 标记为稀疏文件，扩展出来的部分不占磁盘
+    DeviceIoControl(fd, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, nullptr, nullptr);
+    LARGE_INTEGER target;
+    target.QuadPart = static_cast<LONGLONG>(size);
+    return SetFilePointerEx(fd, target, nullptr, FILE_BEGIN) && SetEndOfFile(fd);
+}
+
+bool pread_all(native_fd fd, void *buf, std::size_t len, std::uint64_t off) {
+    auto *p = static_cast<char *>(buf);
+    while (len > 0) {
+        OVERLAPPED ov{};
+        ov.Offset = static_cast<DWORD>(off);
+        ov.OffsetHigh = static_cast<DWORD>(off >> 32);
+        DWORD got = 0;
+        auto want = static_cast<DWORD>(std::min<std::size_t>(len, 1u << 30));
+        if (!ReadFile(fd, p, want, &got, &ov) || got == 0)
+            return false;
+        p += got;
+        off += got;
+        len -= got;
+    }
+    return true;
+}
+
+bool pwrite_all(native_fd fd, const void *buf, std::size_t len, std::uint64_t off) {
+    auto *p = static_cast<const char *>(buf);
+    while (len > 0) {
+        OVERLAPPED ov{};
+        ov.Offset = static_cast<DWORD>(off);
+        ov.OffsetHigh = static_cast<DWORD>(off >> 32);
+        DWORD put = 0;
+        auto want = static_cast<DWORD>(std::min<std::size_t>(len, 1u << 30));
+        if (!WriteFile(fd, p, want, &put, &ov) || put == 0)
+            return false;
+        p += put;
+        off += put;
+        len -= put;
+    }
+    return true;
+}
+
+bool sync_file(native_fd fd) {
+    return FlushFileBuffers(fd);
+}
+
+bool zero_range(native_fd fd, std::uint64_t off, std::uint64_t len) {
+    FILE_ZERO_DATA_INFORMATION zero{};
+    zero.FileOffset.QuadPart = static_cast<LONGLONG>(off);
+    zero.BeyondFinalZero.QuadPart = static_cast<LONGLONG>(off + len);
+    DWORD ret = 0;
+    return DeviceIoControl(fd, FSCTL_SET_ZERO_DATA, &zero, sizeof(zero), nullptr, 0, &ret, nullptr);
+}
+#else
+native_fd open_file(const std::string &path, bool writable, bool create) {
+    int flags = writable ? O_RDWR : O_RDONLY;
+    if (create)
+        flags |= O_CREAT;
+    return ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+}
+
+void close_file(native_fd fd) {
+    ::close(fd);
+}
+
+std::uint64_t file_size(native_fd fd) {
+    struct stat st{};
+    return fstat(fd, &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0;
+}
+
+bool resize_file(native_fd fd, std::uint64_t size) {
+    // ftruncate 扩展出来的部分是文件空洞，不占磁盘
+    return ftruncate(fd, static_cast<off_t>(size)) == 0;
+}
+
+bool pread_all(native_fd fd, void *buf, std::size_t len, std::uint64_t off) {
+    auto *p = static_cast<char *>(buf);
+    while (len > 0) {
+        ssize_t n = ::pread(fd, p, len, static_cast<off_t>(off));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        off += static_cast<std::uint64_t>(n);
+        len -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool pwrite_all(native_fd fd, const void *buf, std::size_t len, std::uint64_t off) {
+    auto *p = static_cast<const char *>(buf);
+    while (len > 0) {
+        ssize_t n = ::pwrite(fd, p, len, static_cast<off_t>(off));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        off += static_cast<std::uint64_t>(n);
+        len -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool sync_file(native_fd fd) {
+#ifdef __APPLE__
+    return ::fsync(fd) == 0;
+#else
+    return ::fdatasync(fd) == 0;
+#endif
+}
+
+bool zero_range(native_fd fd, std::uint64_t off, std::uint64_t len) {
+#ifdef __linux__
+    // 打洞：释放磁盘空间，读回为零，不支持的文件系统回退写零
+    if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(off),
+                  static_cast<off_t>(len)) == 0)
+        return true;
+#endif
+    static const std::vector<char> zeros(64 * 1024, 0);
+    while (len > 0) {
+        auto n = static_cast<std::size_t>(std::min<std::uint64_t>(len, zeros.size()));
+        if (!pwrite_all(fd, zeros.data(), n, off))
+            return false;
+        off += n;
+        len -= n;
+    }
+    return true;
+}
+#endif
+
+} // namespace detail
+} // namespace usbipdcpp
@@ -48,20 +48,39 @@ void StorageTransferOperator::set_iso_descriptor(void *, int, const UsbIpIsoPack
 void StorageTransferOperator::send_transfer_data(void *handle, asio::ip::tcp::socket &sock, std::size_t length,
                                                  std::error_code &ec) {
     auto *trx = StorageIoTransfer::from_handle(handle);
-    auto *backend = handler_->get_backend();
+    auto *backend = trx->backend;
 
     SPDLOG_DEBUG("STO::send handle={:p} len={} direct_io={} lba={} offset={} ext_buf={:p}",
                  static_cast<const void *>(handle), length, trx->direct_io, trx->file_lba, trx->file_offset,
                  static_cast<const void *>(trx->external_buf));
 
-    // 仅 mmap READ 走零拷贝 sendfile/TransmitFile，CSW 等 fallback 数据不碰文件
-    if (trx->direct_io && backend &&
-        backend->send_direct(trx->file_lba, trx->file_offset, length, static_cast<intptr_t>(sock.native_handle()),
-                             ec)) {
-        SPDLOG_DEBUG("STO::send direct OK");
+    // 仅 mmap READ 走零拷贝 sendfile/vmsplice/TransmitFile，CSW 等 fallback 数据不碰文件
+    if (trx->direct_io && backend) {
+        if (backend->send_direct(trx->file_lba, trx->file_offset, length,
+                                 static_cast<intptr_t>(sock.native_handle()), pipes_, ec)) {
+            SPDLOG_DEBUG("STO::send direct OK");
+            direct_send_.add(length);
+            return;
+        }
+        if (ec) {
+            // 已发出部分数据，不能再回退重发
+            SPDLOG_WARN("零拷贝发送失败: {}", ec.message());
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        fallback_send_.add(length);
+    }
+
+    // 后端借出的内存段：一次 gather write，不经 staging
+    if (!trx->segments.empty()) {
+        std::vector<asio::const_buffer> buffers;
+        buffers.reserve(trx->segments.size());
+        for (auto &seg: trx->segments)
+            buffers.emplace_back(seg.base, seg.length);
+        SPDLOG_DEBUG("STO::send segments n={}", buffers.size());
+        asio::write(sock, buffers, ec);
         return;
     }
-    ec.clear();
 
     // 回退：从 external_buf / fallback_data 发送
     void *buf = trx->external_buf ? trx->external_buf : trx->fallback_data.data();
@@ -72,21 +91,41 @@ void StorageTransferOperator::send_transfer_data(void *handle, asio::ip::tcp::so
 void StorageTransferOperator::recv_transfer_data(void *handle, asio::ip::tcp::socket &sock, std::size_t length,
                                                  std::error_code &ec) {
     auto *trx = StorageIoTransfer::from_handle(handle);
-    auto *backend = handler_->get_backend();
+    auto *backend = trx->backend;
 
     SPDLOG_DEBUG("STO::recv handle={:p} len={} direct_io={} lba={} offset={} ext_buf={:p}",
                  static_cast<const void *>(handle), length, trx->direct_io, trx->file_lba, trx->file_offset,
                  static_cast<const void *>(trx->external_buf));
 
     // 仅 mmap WRITE 走零拷贝 splice，CBW/staging 数据不碰文件
-    if (trx->direct_io && trx->external_buf && backend &&
-        backend->recv_direct(trx->file_lba, trx->file_offset, length, static_cast<intptr_t>(sock.native_handle()),
-                             ec)) {
-        SPDLOG_DEBUG("STO::recv direct OK");
-        handler_->on_out_data_received(trx, length);
+    if (trx->direct_io && trx->external_buf && backend) {
+        if (backend->recv_direct(trx->file_lba, trx->file_offset, length,
+                                 static_cast<intptr_t>(sock.native_handle()), pipes_, ec)) {
+            SPDLOG_DEBUG("STO::recv direct OK");
+            direct_recv_.add(length);
+            handler_->on_out_data_received(trx, length);
+            return;
+        }
+        if (ec) {
+            SPDLOG_WARN("零拷贝接收失败: {}", ec.message());
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        fallback_recv_.add(length);
+    }
+
+    // 后端借出的可写内存段：socket 直接 scatter read 进去
+    if (!trx->segments.empty()) {
+        std::vector<asio::mutable_buffer> buffers;
+        buffers.reserve(trx->segments.size());
+        for (auto &seg: trx->segments)
+            buffers.emplace_back(seg.base, seg.length);
+        SPDLOG_DEBUG("STO::recv segments n={}", buffers.size());
+        asio::read(sock, buffers, ec);
+        if (!ec)
+            handler_->on_out_data_received(trx, length);
         return;
     }
-    ec.clear();
 
     // 回退：直读到 external_buf 或 fallback_data
     void *buf = trx->external_buf;
@@ -103,3 +142,18 @@ void StorageTransferOperator::recv_transfer_data(void *handle, asio::ip::tcp::so
         handler_->on_out_data_received(trx, length);
     }
 }
+
+ZeroCopyStats StorageTransferOperator::zero_copy_stats() const {
+    ZeroCopyStats stats;
+    stats.direct_sends = direct_send_.count.load(std::memory_order_relaxed);
+    stats.direct_send_bytes = direct_send_.bytes.load(std::memory_order_relaxed);
+    stats.fallback_sends = fallback_send_.count.load(std::memory_order_relaxed);
+    stats.fallback_send_bytes = fallback_send_.bytes.load(std::memory_order_relaxed);
+    stats.direct_recvs = direct_recv_.count.load(std::memory_order_relaxed);
+    stats.direct_recv_bytes = direct_recv_.bytes.load(std::memory_order_relaxed);
+    stats.fallback_recvs = fallback_recv_.count.load(std::memory_order_relaxed);
+    stats.fallback_recv_bytes = fallback_recv_.bytes.load(std::memory_order_relaxed);
+    stats.errors = errors_.load(std::memory_order_relaxed);
+    stats.pipes_created = pipes_.pipes_created();
+    return stats;
+}
@@ -0,0 +1,193 @@
+#include "usbipdcpp/virtual_device/video_sources/AsyncVideoSource.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+namespace usbipdcpp {
+
+namespace {
+    /// 内层取帧失败后至少等这么久再重试，避免空转
+    constexpr auto MIN_RETRY_DELAY = std::chrono::milliseconds(10);
+    /// 内层交出空帧（自己也还没有新帧）时隔多久再取
+    constexpr auto EMPTY_RETRY_DELAY = std::chrono::milliseconds(1);
+} // namespace
+
+AsyncVideoSource::AsyncVideoSource(std::unique_ptr<VideoSource> inner, AsyncVideoSourceOptions options) :
+    inner_(std::move(inner)), options_(options), format_(inner_->current_format()),
+    max_frame_size_(inner_->max_frame_size()), frame_interval_(inner_->frame_interval()) {
+    // 三缓冲：生产线程在填的、最新完整的、handler 持有的各一块
+    pool_ = VideoFramePool::create(max_frame_size_, 3);
+}
+
+AsyncVideoSource::~AsyncVideoSource() {
+    stop_producer();
+}
+
+std::vector<VideoFormatInfo> AsyncVideoSource::supported_formats() const {
+    return inner_->supported_formats();
+}
+
+VideoFormatInfo AsyncVideoSource::current_format() const {
+    std::lock_guard lock(mutex_);
+    return format_;
+}
+
+std::size_t AsyncVideoSource::max_frame_size() const {
+    std::lock_guard lock(mutex_);
+    return max_frame_size_;
+}
+
+std::uint32_t AsyncVideoSource::frame_interval() const {
+    std::lock_guard lock(mutex_);
+    return frame_interval_;
+}
+
+bool AsyncVideoSource::set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                                  std::uint32_t frame_interval) {
+    // 内层不是线程安全的：等生产线程退出后才能碰它
+    stop_producer();
+    if (!inner_->set_format(fourcc, width, height, frame_interval))
+        return false;
+    std::lock_guard lock(mutex_);
+    format_ = inner_->current_format();
+    max_frame_size_ = inner_->max_frame_size();
+    frame_interval_ = inner_->frame_interval();
+    pool_->set_buffer_size(max_frame_size_);
+    return true;
+}
+
+bool AsyncVideoSource::get_frame(VideoFrame &frame) {
+    std::lock_guard lock(mutex_);
+    last_request_ = std::chrono::steady_clock::now();
+    if (!producer_.joinable() && !stop_) {
+        start_locked();
+    }
+    else if (parked_) {
+        parked_ = false;
+        cv_.notify_all();
+    }
+
+    if (fresh_) {
+        front_ = std::move(latest_);
+        latest_ = {};
+        fresh_ = false;
+        ++delivered_;
+        frame = front_;
+        return true;
+    }
+    if (front_.owner && options_.underrun == FrameUnderrunPolicy::Repeat) {
+        ++repeated_;
+        frame = front_;
+        return true;
+    }
+    ++skipped_;
+    frame = {nullptr, 0, false, nullptr};
+    return true;
+}
+
+AsyncVideoSource::Stats AsyncVideoSource::stats() const {
+    std::lock_guard lock(mutex_);
+    return {produced_, delivered_, dropped_, repeated_, skipped_, source_errors_};
+}
+
+void AsyncVideoSource::start_locked() {
+    parked_ = false;
+    producer_ = std::thread([this] { producer_loop(); });
+}
+
+void AsyncVideoSource::stop_producer() {
+    std::thread producer;
+    {
+        std::lock_guard lock(mutex_);
+        if (!producer_.joinable())
+            return;
+        stop_ = true;
+        producer = std::move(producer_);
+    }
+    cv_.notify_all();
+    producer.join();
+
+    std::lock_guard lock(mutex_);
+    stop_ = false;
+    parked_ = false;
+    // 旧格式的帧不再交出，缓冲尽早回池
+    latest_ = {};
+    fresh_ = false;
+    front_ = {};
+}
+
+bool AsyncVideoSource::capture(VideoFrame &frame) {
+    if (!inner_->get_frame(frame))
+        return false;
+    if (frame.owner || frame.size == 0)
+        return true;
+    // data 只在内层下次 get_frame 前有效，而这一帧可能要留到 handler 发完
+    if (pool_->buffer_size() < frame.size)
+        pool_->set_buffer_size(frame.size);
+    auto buffer = pool_->acquire();
+    std::memcpy(buffer->data(), frame.data, frame.size);
+    buffer->set_size(frame.size);
+    frame = make_video_frame(std::move(buffer), frame.is_keyframe);
+    return true;
+}
+
+void AsyncVideoSource::producer_loop() {
+    auto next = std::chrono::steady_clock::now();
+    bool failing = false;
+    std::unique_lock lock(mutex_);
+    while (!stop_) {
+        if (options_.idle_timeout.count() > 0 &&
+            std::chrono::steady_clock::now() - last_request_ > options_.idle_timeout) {
+            // 停流了：放掉缓冲挂起，等下一次 get_frame
+            parked_ = true;
+            latest_ = {};
+            fresh_ = false;
+            front_ = {};
+            SPDLOG_DEBUG("异步视频源: {} ms 内没有取帧，生产线程挂起", options_.idle_timeout.count());
+            cv_.wait(lock, [this] { return stop_ || !parked_; });
+            next = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (cv_.wait_until(lock, next, [this] { return stop_; }))
+            break;
+
+        auto interval = std::chrono::microseconds(frame_interval_ / 10); // 100ns → µs
+        lock.unlock();
+        VideoFrame frame{};
+        bool ok = capture(frame);
+        auto now = std::chrono::steady_clock::now();
+        lock.lock();
+
+        bool produced = ok && frame.size > 0;
+        if (produced) {
+            if (fresh_)
+                ++dropped_;
+            latest_ = std::move(frame);
+            fresh_ = true;
+            ++produced_;
+            if (failing)
+                SPDLOG_INFO("异步视频源: 内层恢复出帧");
+            failing = false;
+        }
+        else if (!ok) {
+            ++source_errors_;
+            if (!failing)
+                SPDLOG_WARN("异步视频源: 内层取帧失败，稍后重试");
+            failing = true;
+        }
+
+        if (!ok)
+            next = now + std::max<std::chrono::steady_clock::duration>(interval, MIN_RETRY_DELAY);
+        else if (!produced)
+            next = now + EMPTY_RETRY_DELAY;
+        else if (!options_.pace)
+            next = now;
+        else
+            // 内层跟不上时从现在重新计时，不连发补帧
+            next = std::max(next + interval, now);
+    }
+}
+
+} // namespace usbipdcpp
@@ -9,23 +9,29 @@ static constexpr std::uint32_t INTERVAL_100NS(int fps) {
 }
 
 ColorBarSource::ColorBarSource(std::uint16_t width, std::uint16_t height, std::uint8_t fps) :
-    width_(width), height_(height), frame_interval_(INTERVAL_100NS(fps)) {
+    ColorBarSource(std::vector<std::pair<std::uint16_t, std::uint16_t>>{{width, height}}, fps) {
+}
+
+ColorBarSource::ColorBarSource(std::vector<std::pair<std::uint16_t, std::uint16_t>> sizes, std::uint8_t fps) :
+    sizes_(std::move(sizes)), min_interval_(INTERVAL_100NS(fps)), width_(sizes_.at(0).first),
+    height_(sizes_.at(0).second), frame_interval_(min_interval_) {
     generate_color_bars();
 }
 
 std::vector<VideoFormatInfo> ColorBarSource::supported_formats() const {
-    // 仅支持单一固定帧率：min 和 default 相同，max = min * 10（可降至 1/10 帧率）
-    auto min_iv = frame_interval_;
-    auto max_iv = frame_interval_ * 10;
+    // 每种分辨率同一帧率范围：min = default，max = min * 10（可降至 1/10 帧率）
     // (max - min) % min == 0 满足 usbvideo.sys 整除检查
-    return {
-            {UvcFourCC::YUY2, width_, height_, static_cast<std::uint32_t>(width_ * height_ * 2),
-             frame_interval_, min_iv, max_iv, 16},
-    };
+    std::vector<VideoFormatInfo> formats;
+    for (auto [w, h]: sizes_) {
+        formats.push_back({UvcFourCC::YUY2, w, h, static_cast<std::uint32_t>(w * h * 2), min_interval_, min_interval_,
+                           min_interval_ * 10, 16});
+    }
+    return formats;
 }
 
 VideoFormatInfo ColorBarSource::current_format() const {
-    return supported_formats().front();
+    return {UvcFourCC::YUY2, width_, height_, static_cast<std::uint32_t>(width_ * height_ * 2), frame_interval_,
+            min_interval_, min_interval_ * 10, 16};
 }
 
 bool ColorBarSource::set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
@@ -34,20 +40,19 @@ bool ColorBarSource::set_format(std::uint32_t fourcc, std::uint16_t width, std::
         return false;
     width_ = width;
     height_ = height;
-    frame_interval_ = frame_interval;
+    if (frame_interval != 0)
+        frame_interval_ = frame_interval;
     generate_color_bars();
     return true;
 }
 
 bool ColorBarSource::get_frame(VideoFrame &frame) {
-    frame.data = buffer_.data();
-    frame.size = buffer_.size();
-    frame.is_keyframe = true;
+    frame = make_video_frame(frame_);
     return true;
 }
 
 std::size_t ColorBarSource::max_frame_size() const {
-    return buffer_.size();
+    return frame_->size();
 }
 
 std::uint32_t ColorBarSource::frame_interval() const {
@@ -57,7 +62,9 @@ std::uint32_t ColorBarSource::frame_interval() const {
 // SMPTE 彩条: 白 黄 青 绿 品 红 蓝 黑
 // YCbCr BT.601: Y=16..235, CbCr=16..240, 居中值=128
 void ColorBarSource::generate_color_bars() {
-    buffer_.resize(static_cast<std::size_t>(width_) * height_ * 2);
+    // 换一块新缓冲：handler 可能还持有旧格式的帧
+    auto buffer = std::make_shared<VideoFrameBuffer>(static_cast<std::size_t>(width_) * height_ * 2);
+    buffer->set_size(buffer->capacity());
 
     // 8 种颜色条的 Y Cb Cr 值
     static constexpr std::uint8_t colors[8][3] = {
@@ -72,7 +79,7 @@ void ColorBarSource::generate_color_bars() {
     };
 
     auto bar_width = width_ / 8;
-    auto *dst = buffer_.data();
+    auto *dst = buffer->data();
 
     for (std::uint16_t y = 0; y < height_; ++y) {
         for (std::uint16_t x = 0; x < width_; x += 2) {
@@ -90,6 +97,7 @@ void ColorBarSource::generate_color_bars() {
             *dst++ = Cr;
         }
     }
+    frame_ = std::move(buffer);
 }
 
 } // namespace usbipdcpp
@@ -0,0 +1,674 @@
+#include "usbipdcpp/virtual_device/video_sources/MjpegEncoderSource.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <future>
+
+#include <spdlog/spdlog.h>
+
+#include "usbipdcpp/virtual_device/UvcConstants.h"
+#include "usbipdcpp/virtual_device/video_sources/PixelConvert.h"
+
+#ifdef USBIPDCPP_HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+namespace usbipdcpp {
+
+namespace {
+    constexpr int MCU_WIDTH = 16; // 亮度水平 2 倍采样
+    constexpr std::uint32_t MAX_RESTART_INTERVAL = 0xFFFF; // DRI 字段 16 位
+    constexpr std::uint8_t MARKER_SOF0 = 0xC0;
+    constexpr std::uint8_t MARKER_SOS = 0xDA;
+    constexpr std::uint8_t MARKER_RST0 = 0xD0;
+    constexpr std::uint8_t MARKER_EOI = 0xD9;
+
+    bool is_raw_fourcc(std::uint32_t fourcc) {
+        return fourcc == UvcFourCC::YUY2 || fourcc == UvcFourCC::NV12 || fourcc == UvcFourCC::I420;
+    }
+
+    /// YUY2 为 4:2:2（MCU 16x8），NV12 / I420 为 4:2:0（MCU 16x16）
+    int mcu_height(std::uint32_t raw_fourcc) {
+        return raw_fourcc == UvcFourCC::YUY2 ? 8 : 16;
+    }
+
+    std::size_t mjpeg_frame_capacity(std::uint16_t width, std::uint16_t height) {
+        // 与 YUY2 帧同大：质量 95 以内的真实画面远小于此，放不下时降质量重编
+        return static_cast<std::size_t>(width) * height * 2;
+    }
+
+    /// BT.601 有限范围 → JFIF 全范围
+    struct RangeTables {
+        std::array<std::uint8_t, 256> luma{};
+        std::array<std::uint8_t, 256> chroma{};
+
+        RangeTables() {
+            for (int v = 0; v < 256; ++v) {
+                luma[v] = static_cast<std::uint8_t>(std::clamp(std::lround((v - 16) * 255.0 / 219.0), 0L, 255L));
+                chroma[v] = static_cast<std::uint8_t>(
+                        std::clamp(std::lround((v - 128) * 255.0 / 224.0 + 128.0), 0L, 255L));
+            }
+        }
+    };
+
+    const RangeTables &range_tables() {
+        static const RangeTables tables;
+        return tables;
+    }
+
+    /// 单张 JPEG 的结构：SOS 段之后即熵编码数据，到结尾 EOI 之前为止
+    struct JpegLayout {
+        std::size_t sof_offset = 0; // SOF0 标记位置
+        std::size_t scan_offset = 0; // 熵编码数据起点
+        std::size_t scan_end = 0; // EOI 位置
+    };
+} // namespace
+
+#ifdef USBIPDCPP_HAVE_LIBJPEG
+namespace {
+    std::uint16_t read_be16(const std::uint8_t *p) {
+        return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    bool parse_jpeg(const std::vector<std::uint8_t> &jpeg, JpegLayout &layout) {
+        if (jpeg.size() < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8 || jpeg[jpeg.size() - 2] != 0xFF ||
+            jpeg.back() != MARKER_EOI)
+            return false;
+        std::size_t pos = 2;
+        while (pos + 4 <= jpeg.size()) {
+            if (jpeg[pos] != 0xFF)
+                return false;
+            auto marker = jpeg[pos + 1];
+            auto length = read_be16(&jpeg[pos + 2]);
+            if (marker == MARKER_SOF0)
+                layout.sof_offset = pos;
+            pos += 2 + length;
+            if (marker == MARKER_SOS) {
+                layout.scan_offset = pos;
+                layout.scan_end = jpeg.size() - 2;
+                return pos <= layout.scan_end;
+            }
+        }
+        return false;
+    }
+
+    /// libjpeg 默认的 error_exit 会 exit()，改为记日志后 longjmp 回 encode_slice
+    struct JpegErrorManager {
+        jpeg_error_mgr pub;
+        std::jmp_buf jump;
+    };
+
+    void jpeg_error_exit(j_common_ptr cinfo) {
+        char message[JMSG_LENGTH_MAX];
+        (*cinfo->err->format_message)(cinfo, message);
+        SPDLOG_ERROR("JPEG 编码失败: {}", message);
+        std::longjmp(reinterpret_cast<JpegErrorManager *>(cinfo->err)->jump, 1);
+    }
+
+    void jpeg_output_message(j_common_ptr cinfo) {
+        char message[JMSG_LENGTH_MAX];
+        (*cinfo->err->format_message)(cinfo, message);
+        SPDLOG_DEBUG("libjpeg: {}", message);
+    }
+
+    /// 输出到可复用的 std::vector，容量跨帧保留
+    struct VectorDestination {
+        jpeg_destination_mgr pub;
+        std::vector<std::uint8_t> *out;
+    };
+
+    void vector_init_destination(j_compress_ptr cinfo) {
+        auto *dest = reinterpret_cast<VectorDestination *>(cinfo->dest);
+        dest->out->resize(std::max<std::size_t>(dest->out->capacity(), 64 * 1024));
+        dest->pub.next_output_byte = dest->out->data();
+        dest->pub.free_in_buffer = dest->out->size();
+    }
+
+    boolean vector_empty_output_buffer(j_compress_ptr cinfo) {
+        auto *dest = reinterpret_cast<VectorDestination *>(cinfo->dest);
+        auto used = dest->out->size();
+        dest->out->resize(used * 2);
+        dest->pub.next_output_byte = dest->out->data() + used;
+        dest->pub.free_in_buffer = dest->out->size() - used;
+        return TRUE;
+    }
+
+    void vector_term_destination(j_compress_ptr cinfo) {
+        auto *dest = reinterpret_cast<VectorDestination *>(cinfo->dest);
+        dest->out->resize(dest->out->size() - dest->pub.free_in_buffer);
+    }
+} // namespace
+#endif
+
+struct MjpegEncoderSource::SliceEncoder {
+    int index = 0;
+    int first_row = 0; // 条带在帧内的起始像素行
+    int rows = 0; // 条带实际行数
+    int padded_rows = 0; // 补齐到 MCU 高度
+    std::size_t y_stride = 0;
+    std::size_t c_stride = 0;
+    std::vector<std::uint8_t> y;
+    std::vector<std::uint8_t> cb;
+    std::vector<std::uint8_t> cr;
+    std::vector<std::uint8_t> output; // 条带单独编码成的 JPEG
+    JpegLayout layout;
+#ifdef USBIPDCPP_HAVE_LIBJPEG
+    jpeg_compress_struct cinfo{};
+    JpegErrorManager error{};
+    VectorDestination dest{};
+
+    SliceEncoder() {
+        cinfo.err = jpeg_std_error(&error.pub);
+        error.pub.error_exit = jpeg_error_exit;
+        error.pub.output_message = jpeg_output_message;
+        jpeg_create_compress(&cinfo);
+        dest.pub.init_destination = vector_init_destination;
+        dest.pub.empty_output_buffer = vector_empty_output_buffer;
+        dest.pub.term_destination = vector_term_destination;
+        dest.out = &output;
+        cinfo.dest = &dest.pub;
+    }
+
+    ~SliceEncoder() {
+        jpeg_destroy_compress(&cinfo);
+    }
+
+    SliceEncoder(const SliceEncoder &) = delete;
+    SliceEncoder &operator=(const SliceEncoder &) = delete;
+#endif
+
+    /// 把原始帧中本条带的行转成全范围 Y / Cb / Cr 平面，右侧与底部按边缘像素补齐到 MCU
+    void load(const VideoFrame &raw, std::uint32_t fourcc, int width, int height) {
+        const auto &lut = range_tables();
+        bool subsampled = fourcc != UvcFourCC::YUY2;
+        int chroma_width = width / 2;
+        int chroma_rows = subsampled ? (rows + 1) / 2 : rows;
+        auto *base = const_cast<std::uint8_t *>(raw.data);
+
+        for (int r = 0; r < rows; ++r) {
+            auto *y_row = y.data() + r * y_stride;
+            if (fourcc == UvcFourCC::YUY2) {
+                const auto *src = raw.data + static_cast<std::size_t>(first_row + r) * width * 2;
+                auto *cb_row = cb.data() + r * c_stride;
+                auto *cr_row = cr.data() + r * c_stride;
+                for (int x = 0; x < chroma_width; ++x, src += 4) {
+                    y_row[x * 2] = lut.luma[src[0]];
+                    cb_row[x] = lut.chroma[src[1]];
+                    y_row[x * 2 + 1] = lut.luma[src[2]];
+                    cr_row[x] = lut.chroma[src[3]];
+                }
+            }
+            else {
+                const auto *src = base + static_cast<std::size_t>(first_row + r) * width;
+                for (int x = 0; x < width; ++x)
+                    y_row[x] = lut.luma[src[x]];
+            }
+        }
+        if (subsampled) {
+            auto format = fourcc == UvcFourCC::NV12 ? PixelFormat::NV12 : PixelFormat::I420;
+            auto planes = pixel_image_planes(format, base, width, height);
+            for (int r = 0; r < chroma_rows; ++r) {
+                auto src_row = static_cast<std::size_t>(first_row / 2 + r);
+                auto *cb_row = cb.data() + r * c_stride;
+                auto *cr_row = cr.data() + r * c_stride;
+                if (format == PixelFormat::NV12) {
+                    const auto *uv = planes.data[1] + src_row * planes.stride[1];
+                    for (int x = 0; x < chroma_width; ++x) {
+                        cb_row[x] = lut.chroma[uv[x * 2]];
+                        cr_row[x] = lut.chroma[uv[x * 2 + 1]];
+                    }
+                }
+                else {
+                    const auto *u = planes.data[1] + src_row * planes.stride[1];
+                    const auto *v = planes.data[2] + src_row * planes.stride[2];
+                    for (int x = 0; x < chroma_width; ++x) {
+                        cb_row[x] = lut.chroma[u[x]];
+                        cr_row[x] = lut.chroma[v[x]];
+                    }
+                }
+            }
+        }
+
+        auto pad_plane = [](std::vector<std::uint8_t> &plane, std::size_t stride, int used_width, int used_rows,
+                            int total_rows) {
+            for (int r = 0; r < used_rows; ++r) {
+                auto *row = plane.data() + r * stride;
+                std::memset(row + used_width, row[used_width - 1], stride - used_width);
+            }
+            for (int r = used_rows; r < total_rows; ++r)
+                std::memcpy(plane.data() + r * stride, plane.data() + (used_rows - 1) * stride, stride);
+        };
+        int padded_chroma_rows = subsampled ? padded_rows / 2 : padded_rows;
+        pad_plane(y, y_stride, width, rows, padded_rows);
+        pad_plane(cb, c_stride, chroma_width, chroma_rows, padded_chroma_rows);
+        pad_plane(cr, c_stride, chroma_width, chroma_rows, padded_chroma_rows);
+    }
+
+    /// 把已载入的平面编码成一张独立的 JPEG（高度为条带行数）。第一个条带带完整的 JFIF 头与码表，
+    /// 其余条带只用到熵编码段，省掉码表
+    bool compress(std::uint32_t fourcc, int width, int quality, std::uint32_t restart_interval) {
+#ifdef USBIPDCPP_HAVE_LIBJPEG
+        // setjmp 与 longjmp 之间只有平凡析构的局部变量
+        JSAMPROW y_rows[16];
+        JSAMPROW cb_rows[16];
+        JSAMPROW cr_rows[16];
+        JSAMPARRAY planes[3] = {y_rows, cb_rows, cr_rows};
+        bool subsampled = fourcc != UvcFourCC::YUY2;
+        int lines = subsampled ? 16 : 8;
+
+        if (setjmp(error.jump)) {
+            jpeg_abort_compress(&cinfo);
+            return false;
+        }
+        cinfo.image_width = static_cast<JDIMENSION>(width);
+        cinfo.image_height = static_cast<JDIMENSION>(rows);
+        cinfo.input_components = 3;
+        cinfo.in_color_space = JCS_YCbCr;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_colorspace(&cinfo, JCS_YCbCr);
+        cinfo.raw_data_in = TRUE;
+        cinfo.comp_info[0].h_samp_factor = 2;
+        cinfo.comp_info[0].v_samp_factor = subsampled ? 2 : 1;
+        for (int c = 1; c < 3; ++c) {
+            cinfo.comp_info[c].h_samp_factor = 1;
+            cinfo.comp_info[c].v_samp_factor = 1;
+        }
+        // 定点快速 DCT：实时编码的常见取舍，质量差别在 1 dB 以内
+        cinfo.dct_method = JDCT_IFAST;
+        cinfo.restart_interval = restart_interval;
+        cinfo.write_JFIF_header = index == 0 ? TRUE : FALSE;
+        jpeg_set_quality(&cinfo, quality, TRUE);
+        if (index != 0)
+            jpeg_suppress_tables(&cinfo, TRUE);
+        jpeg_start_compress(&cinfo, index == 0 ? TRUE : FALSE);
+
+        for (int r = 0; r < padded_rows; r += lines) {
+            for (int i = 0; i < lines; ++i)
+                y_rows[i] = y.data() + (r + i) * y_stride;
+            int chroma_row = subsampled ? r / 2 : r;
+            for (int i = 0; i < 8; ++i) {
+                cb_rows[i] = cb.data() + (chroma_row + i) * c_stride;
+                cr_rows[i] = cr.data() + (chroma_row + i) * c_stride;
+            }
+            jpeg_write_raw_data(&cinfo, planes, static_cast<JDIMENSION>(lines));
+        }
+        jpeg_finish_compress(&cinfo);
+        return parse_jpeg(output, layout);
+#else
+        (void) fourcc;
+        (void) width;
+        (void) quality;
+        (void) restart_interval;
+        return false;
+#endif
+    }
+};
+
+MjpegEncoderSource::MjpegEncoderSource(std::unique_ptr<VideoSource> inner, MjpegEncoderOptions options) :
+    inner_(std::move(inner)), options_(options), frame_pool_(VideoFramePool::create(0)) {
+    options_.min_quality = std::clamp(options_.min_quality, 1, 100);
+    options_.max_quality = std::clamp(options_.max_quality, options_.min_quality, 100);
+    quality_ = std::clamp(options_.quality, 1, 100);
+    if (options_.threads == 0)
+        options_.threads = std::max(1u, std::thread::hardware_concurrency());
+    if (options_.slices == 0)
+        options_.slices = options_.threads;
+
+    if (available()) {
+        for (const auto &fmt: inner_->supported_formats()) {
+            if (!is_raw_fourcc(fmt.fourcc) || (fmt.width & 1) != 0 || find_encoded(fmt.width, fmt.height))
+                continue;
+            EncodedFormat encoded{fmt, fmt.fourcc};
+            encoded.mjpeg.fourcc = UvcFourCC::MJPEG;
+            encoded.mjpeg.max_frame_size =
+                    static_cast<std::uint32_t>(mjpeg_frame_capacity(fmt.width, fmt.height));
+            encoded.mjpeg.bits_per_pixel = 16;
+            encoded_formats_.push_back(std::move(encoded));
+        }
+    }
+    if (encoded_formats_.empty()) {
+        SPDLOG_WARN("MJPEG 编码器{}，视频源原样转发", available() ? "：内层没有可编码的原始格式" : "未编译（缺少 libjpeg）");
+        return;
+    }
+
+    // 默认格式是第一个 MJPEG：内层当前格式有对应的编码格式就从它开始编码
+    auto current = inner_->current_format();
+    if (is_raw_fourcc(current.fourcc)) {
+        if (const auto *encoded = find_encoded(current.width, current.height);
+            encoded && encoded->raw_fourcc == current.fourcc) {
+            active_ = encoded;
+            configure_slices_locked(*encoded);
+        }
+    }
+    if (options_.threads > 1)
+        pool_ = std::make_unique<ThreadPool>(options_.threads - 1);
+    pipeline_ = std::thread([this] { pipeline_loop(); });
+}
+
+MjpegEncoderSource::~MjpegEncoderSource() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    request_cv_.notify_all();
+    ready_cv_.notify_all();
+    if (pipeline_.joinable())
+        pipeline_.join();
+    pool_.reset();
+}
+
+bool MjpegEncoderSource::available() {
+#ifdef USBIPDCPP_HAVE_LIBJPEG
+    return true;
+#else
+    return false;
+#endif
+}
+
+const MjpegEncoderSource::EncodedFormat *MjpegEncoderSource::find_encoded(std::uint16_t width,
+                                                                          std::uint16_t height) const {
+    for (const auto &encoded: encoded_formats_)
+        if (encoded.mjpeg.width == width && encoded.mjpeg.height == height)
+            return &encoded;
+    return nullptr;
+}
+
+std::vector<VideoFormatInfo> MjpegEncoderSource::supported_formats() const {
+    std::vector<VideoFormatInfo> formats;
+    for (const auto &encoded: encoded_formats_)
+        formats.push_back(encoded.mjpeg);
+    for (const auto &fmt: inner_->supported_formats()) {
+        // 内层自带的同尺寸 MJPEG 与编码出的重复，不再列出
+        if (fmt.fourcc == UvcFourCC::MJPEG && find_encoded(fmt.width, fmt.height))
+            continue;
+        if (options_.keep_uncompressed || encoded_formats_.empty() || !is_raw_fourcc(fmt.fourcc) ||
+            !find_encoded(fmt.width, fmt.height))
+            formats.push_back(fmt);
+    }
+    return formats;
+}
+
+VideoFormatInfo MjpegEncoderSource::current_format() const {
+    std::lock_guard lock(mutex_);
+    auto current = inner_->current_format();
+    if (active_) {
+        auto interval = current.default_frame_interval;
+        current = active_->mjpeg;
+        current.default_frame_interval = interval;
+    }
+    return current;
+}
+
+void MjpegEncoderSource::quiesce_locked(std::unique_lock<std::mutex> &lock) {
+    requested_ = false;
+    ready_cv_.wait(lock, [this] { return !in_flight_; });
+    ready_ = false;
+    result_ = {};
+}
+
+void MjpegEncoderSource::configure_slices_locked(const EncodedFormat &format) {
+    int width = format.mjpeg.width;
+    int height = format.mjpeg.height;
+    int mcu_h = mcu_height(format.raw_fourcc);
+    auto mcus_per_row = static_cast<std::uint32_t>((width + MCU_WIDTH - 1) / MCU_WIDTH);
+    auto mcu_rows = static_cast<std::uint32_t>((height + mcu_h - 1) / mcu_h);
+
+    auto wanted = static_cast<std::uint32_t>(std::clamp<std::size_t>(options_.slices, 1, mcu_rows));
+    auto rows_per_slice = (mcu_rows + wanted - 1) / wanted;
+    // restart interval 是 16 位：条带的 MCU 数超出时切得更细
+    if (wanted > 1 && mcus_per_row * rows_per_slice > MAX_RESTART_INTERVAL)
+        rows_per_slice = std::max(1u, MAX_RESTART_INTERVAL / mcus_per_row);
+    auto count = (mcu_rows + rows_per_slice - 1) / rows_per_slice;
+    restart_interval_ = count > 1 ? mcus_per_row * rows_per_slice : 0;
+
+    slices_.resize(count);
+    auto y_stride = static_cast<std::size_t>(mcus_per_row) * MCU_WIDTH;
+    auto c_stride = y_stride / 2;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        if (!slices_[i])
+            slices_[i] = std::make_unique<SliceEncoder>();
+        auto &slice = *slices_[i];
+        slice.index = static_cast<int>(i);
+        slice.first_row = static_cast<int>(i * rows_per_slice) * mcu_h;
+        slice.rows = std::min(static_cast<int>(rows_per_slice) * mcu_h, height - slice.first_row);
+        slice.padded_rows = (slice.rows + mcu_h - 1) / mcu_h * mcu_h;
+        slice.y_stride = y_stride;
+        slice.c_stride = c_stride;
+        int chroma_rows = format.raw_fourcc == UvcFourCC::YUY2 ? slice.padded_rows : slice.padded_rows / 2;
+        slice.y.resize(y_stride * slice.padded_rows);
+        slice.cb.resize(c_stride * chroma_rows);
+        slice.cr.resize(c_stride * chroma_rows);
+    }
+    frame_pool_->set_buffer_size(format.mjpeg.max_frame_size);
+    SPDLOG_DEBUG("MJPEG 编码 {}x{}：{} 个条带，restart interval {}", width, height, count, restart_interval_);
+}
+
+bool MjpegEncoderSource::set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                                    std::uint32_t frame_interval) {
+    std::unique_lock lock(mutex_);
+    quiesce_locked(lock);
+    if (fourcc != UvcFourCC::MJPEG || encoded_formats_.empty()) {
+        if (!inner_->set_format(fourcc, width, height, frame_interval))
+            return false;
+        active_ = nullptr;
+        return true;
+    }
+    const auto *encoded = find_encoded(width, height);
+    if (!encoded) {
+        // 不是编码出的尺寸，交给内层（可能自带 MJPEG）
+        if (!inner_->set_format(fourcc, width, height, frame_interval))
+            return false;
+        active_ = nullptr;
+        return true;
+    }
+    if (!inner_->set_format(encoded->raw_fourcc, width, height, frame_interval)) {
+        SPDLOG_WARN("MJPEG 编码器：内层不接受原始格式 {}x{}", width, height);
+        return false;
+    }
+    active_ = encoded;
+    configure_slices_locked(*encoded);
+    return true;
+}
+
+void MjpegEncoderSource::pipeline_loop() {
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        request_cv_.wait(lock, [this] { return stop_ || requested_; });
+        if (stop_)
+            break;
+        requested_ = false;
+        in_flight_ = true;
+        lock.unlock();
+
+        auto encoded = produce();
+
+        lock.lock();
+        in_flight_ = false;
+        // 编码期间格式被切换过（quiesce 会等到这里），结果照样放进槽位，由 quiesce 丢弃
+        result_ = std::move(encoded);
+        ready_ = true;
+        ready_cv_.notify_all();
+    }
+}
+
+MjpegEncoderSource::Encoded MjpegEncoderSource::produce() {
+    Encoded encoded;
+    VideoFrame raw{};
+    if (!inner_->get_frame(raw))
+        return encoded;
+    encoded.captured_at = std::chrono::steady_clock::now();
+    int quality;
+    {
+        std::lock_guard lock(mutex_);
+        quality = quality_;
+    }
+
+    auto buffer = frame_pool_->acquire();
+    // 放不下（噪声画面 + 高质量）就降质量重编
+    bool too_large = false;
+    bool ok = encode(raw, quality, *buffer, too_large);
+    while (!ok && too_large && quality > options_.min_quality) {
+        quality = std::max(options_.min_quality, quality - 20);
+        SPDLOG_DEBUG("MJPEG 帧超过 {} 字节，以质量 {} 重新编码", buffer->capacity(), quality);
+        ok = encode(raw, quality, *buffer, too_large);
+    }
+    if (!ok)
+        return encoded;
+
+    auto elapsed = std::chrono::steady_clock::now() - encoded.captured_at;
+    update_quality(buffer->size());
+    encoded.input_size = raw.size;
+    encoded.encode_us =
+            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    encoded.ok = true;
+    encoded.buffer = std::move(buffer);
+    return encoded;
+}
+
+bool MjpegEncoderSource::encode(const VideoFrame &raw, int quality, VideoFrameBuffer &out, bool &too_large) {
+    out.set_size(0);
+    too_large = false;
+    const auto &format = *active_;
+    int width = format.mjpeg.width;
+    int height = format.mjpeg.height;
+    auto fourcc = format.raw_fourcc;
+    auto expected = fourcc == UvcFourCC::YUY2 ? static_cast<std::size_t>(width) * height * 2
+                                              : pixel_image_size(PixelFormat::NV12, width, height);
+    if (raw.data == nullptr || raw.size < expected) {
+        SPDLOG_WARN("MJPEG 编码器：原始帧 {} 字节，{}x{} 需要 {} 字节", raw.size, width, height, expected);
+        return false;
+    }
+
+    // 条带并行：其余条带交给线程池，第一个条带在本线程编码
+    auto run_slice = [&, quality](SliceEncoder &slice) {
+        slice.load(raw, fourcc, width, height);
+        return slice.compress(fourcc, width, quality, restart_interval_);
+    };
+    std::vector<std::future<bool>> pending;
+    for (std::size_t i = 1; i < slices_.size(); ++i) {
+        auto *slice = slices_[i].get();
+        if (pool_)
+            pending.push_back(pool_->submit([&run_slice, slice] { return run_slice(*slice); }));
+    }
+    bool ok = run_slice(*slices_[0]);
+    if (!pool_)
+        for (std::size_t i = 1; i < slices_.size(); ++i)
+            ok = run_slice(*slices_[i]) && ok;
+    for (auto &f: pending)
+        ok = f.get() && ok;
+    if (!ok)
+        return false;
+
+    // 拼接：第一个条带的头（SOF 高度改为整帧）+ 各条带熵编码段，段间插 RSTn（n 按 0..7 循环）+ EOI
+    const auto &first = *slices_[0];
+    std::size_t total = first.layout.scan_offset + 2;
+    for (const auto &slice: slices_)
+        total += slice->layout.scan_end - slice->layout.scan_offset + 2;
+    if (total > out.capacity()) {
+        too_large = true;
+        return false;
+    }
+    auto *dst = out.data();
+    std::memcpy(dst, first.output.data(), first.layout.scan_offset);
+    // SOF0：FF C0 长度(2) 精度(1) 高度(2) 宽度(2)
+    dst[first.layout.sof_offset + 5] = static_cast<std::uint8_t>(height >> 8);
+    dst[first.layout.sof_offset + 6] = static_cast<std::uint8_t>(height & 0xFF);
+    std::size_t pos = first.layout.scan_offset;
+    for (std::size_t i = 0; i < slices_.size(); ++i) {
+        const auto &slice = *slices_[i];
+        auto length = slice.layout.scan_end - slice.layout.scan_offset;
+        std::memcpy(dst + pos, slice.output.data() + slice.layout.scan_offset, length);
+        pos += length;
+        dst[pos++] = 0xFF;
+        dst[pos++] = i + 1 < slices_.size() ? static_cast<std::uint8_t>(MARKER_RST0 + i % 8) : MARKER_EOI;
+    }
+    out.set_size(pos);
+    return true;
+}
+
+void MjpegEncoderSource::update_quality(std::size_t encoded_size) {
+    std::lock_guard lock(mutex_);
+    if (options_.target_kbps == 0 || !active_)
+        return;
+    // 一帧的目标字节数 = 码率 × 帧间隔
+    auto interval = inner_->frame_interval();
+    double target = static_cast<double>(options_.target_kbps) * 1000.0 / 8.0 * interval / 1e7;
+    if (target <= 0)
+        return;
+    double ratio = static_cast<double>(encoded_size) / target;
+    if (ratio > 1.05)
+        quality_ -= std::clamp(static_cast<int>((ratio - 1.0) * 10.0) + 1, 1, 10);
+    else if (ratio < 0.85)
+        quality_ += ratio < 0.5 ? 3 : 1;
+    quality_ = std::clamp(quality_, options_.min_quality, options_.max_quality);
+}
+
+bool MjpegEncoderSource::get_frame(VideoFrame &frame) {
+    std::unique_lock lock(mutex_);
+    if (!active_) {
+        lock.unlock();
+        return inner_->get_frame(frame);
+    }
+    if (!ready_ && !in_flight_ && !requested_) {
+        requested_ = true;
+        request_cv_.notify_one();
+    }
+    ready_cv_.wait(lock, [this] { return ready_ || stop_; });
+    if (!ready_)
+        return false;
+    auto encoded = std::move(result_);
+    result_ = {};
+    ready_ = false;
+    if (options_.pipeline) {
+        requested_ = true;
+        request_cv_.notify_one();
+    }
+    if (!encoded.ok)
+        return false;
+
+    auto latency = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                      std::chrono::steady_clock::now() - encoded.captured_at)
+                                                      .count());
+    ++frames_;
+    input_bytes_ += encoded.input_size;
+    output_bytes_ += encoded.buffer->size();
+    encode_us_ += encoded.encode_us;
+    latency_us_ += latency;
+    max_latency_us_ = std::max(max_latency_us_, latency);
+    lock.unlock();
+
+    frame = make_video_frame(std::move(encoded.buffer), true);
+    return true;
+}
+
+std::size_t MjpegEncoderSource::max_frame_size() const {
+    std::lock_guard lock(mutex_);
+    return active_ ? active_->mjpeg.max_frame_size : inner_->max_frame_size();
+}
+
+std::uint32_t MjpegEncoderSource::frame_interval() const {
+    return inner_->frame_interval();
+}
+
+void MjpegEncoderSource::set_quality(int quality) {
+    std::lock_guard lock(mutex_);
+    options_.target_kbps = 0;
+    quality_ = std::clamp(quality, 1, 100);
+}
+
+void MjpegEncoderSource::set_target_bitrate(std::uint32_t kbps) {
+    std::lock_guard lock(mutex_);
+    options_.target_kbps = kbps;
+}
+
+MjpegEncoderSource::EncodeStats MjpegEncoderSource::encode_stats() const {
+    std::lock_guard lock(mutex_);
+    return {frames_,     input_bytes_,    output_bytes_, encode_us_,
+            latency_us_, max_latency_us_, quality_,      active_ ? slices_.size() : 0};
+}
+
+} // namespace usbipdcpp
@@ -0,0 +1,971 @@
+#include "usbipdcpp/virtual_device/video_sources/PixelConvert.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define USBIPDCPP_PIXEL_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define USBIPDCPP_PIXEL_NEON 1
+#endif
+
+namespace usbipdcpp {
+
+namespace {
+    // ============== 标量参考实现 ==============
+    // BT.601 有限范围定点系数（×256）。SIMD 内核按同样的运算顺序与舍入实现，输出逐字节一致：
+    //   Y = ((66R + 129G + 25B + 128) >> 8) + 16
+    //   U = ((-38R - 74G + 112B + 128) >> 8) + 128，V = ((112R - 94G - 18B + 128) >> 8) + 128
+    //   R = (298C + 409E + 128) >> 8，G = (298C - 100D - 208E + 128) >> 8，B = (298C + 516D + 128) >> 8
+    //   （C = Y - 16，D = U - 128，E = V - 128，结果钳到 0..255）
+    // 色度用的平均均为 (a + b + 1) >> 1
+
+    inline std::uint8_t rgb_to_y(int r, int g, int b) {
+        return static_cast<std::uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+
+    inline std::uint8_t rgb_to_u(int r, int g, int b) {
+        return static_cast<std::uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    }
+
+    inline std::uint8_t rgb_to_v(int r, int g, int b) {
+        return static_cast<std::uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    inline std::uint8_t clamp_u8(int v) {
+        return static_cast<std::uint8_t>(std::clamp(v, 0, 255));
+    }
+
+    inline void yuv_to_rgb(int y, int u, int v, std::uint8_t *r, std::uint8_t *g, std::uint8_t *b) {
+        int c = y - 16;
+        int d = u - 128;
+        int e = v - 128;
+        *r = clamp_u8((298 * c + 409 * e + 128) >> 8);
+        *g = clamp_u8((298 * c - 100 * d - 208 * e + 128) >> 8);
+        *b = clamp_u8((298 * c + 516 * d + 128) >> 8);
+    }
+
+    /// 打包 RGB 行 → YUY2。BPP 为每像素字节数，RI / BI 为 R、B 分量的字节序号
+    template <int BPP, int RI, int BI>
+    void rgb_row_to_yuy2_c(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        for (int x = 0; x < width; x += 2, src += 2 * BPP, dst += 4) {
+            int r0 = src[RI], g0 = src[1], b0 = src[BI];
+            int r1 = src[BPP + RI], g1 = src[BPP + 1], b1 = src[BPP + BI];
+            int ra = (r0 + r1 + 1) >> 1, ga = (g0 + g1 + 1) >> 1, ba = (b0 + b1 + 1) >> 1;
+            dst[0] = rgb_to_y(r0, g0, b0);
+            dst[1] = rgb_to_u(ra, ga, ba);
+            dst[2] = rgb_to_y(r1, g1, b1);
+            dst[3] = rgb_to_v(ra, ga, ba);
+        }
+    }
+
+    /// YUY2 行 → 打包 RGB（4 字节像素的 alpha 填 255）
+    template <int BPP, int RI, int BI>
+    void yuy2_row_to_rgb_c(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        for (int x = 0; x < width; x += 2, src += 4, dst += 2 * BPP) {
+            yuv_to_rgb(src[0], src[1], src[3], dst + RI, dst + 1, dst + BI);
+            yuv_to_rgb(src[2], src[1], src[3], dst + BPP + RI, dst + BPP + 1, dst + BPP + BI);
+            if constexpr (BPP == 4) {
+                dst[3] = 255;
+                dst[7] = 255;
+            }
+        }
+    }
+
+    void i420_row_to_yuy2_c(const std::uint8_t *y, const std::uint8_t *u, const std::uint8_t *v, std::uint8_t *dst,
+                            int width) {
+        for (int x = 0; x < width; x += 2, dst += 4) {
+            dst[0] = y[x];
+            dst[1] = u[x / 2];
+            dst[2] = y[x + 1];
+            dst[3] = v[x / 2];
+        }
+    }
+
+    void nv12_row_to_yuy2_c(const std::uint8_t *y, const std::uint8_t *uv, std::uint8_t *dst, int width) {
+        for (int x = 0; x < width; x += 2, dst += 4) {
+            dst[0] = y[x];
+            dst[1] = uv[x];
+            dst[2] = y[x + 1];
+            dst[3] = uv[x + 1];
+        }
+    }
+
+    void yuy2_row_to_y_c(const std::uint8_t *src, std::uint8_t *y, int width) {
+        for (int x = 0; x < width; ++x)
+            y[x] = src[x * 2];
+    }
+
+    void yuy2_rows_to_u_v_c(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v,
+                            int width) {
+        for (int x = 0; x < width / 2; ++x) {
+            u[x] = static_cast<std::uint8_t>((row0[x * 4 + 1] + row1[x * 4 + 1] + 1) >> 1);
+            v[x] = static_cast<std::uint8_t>((row0[x * 4 + 3] + row1[x * 4 + 3] + 1) >> 1);
+        }
+    }
+
+    void yuy2_rows_to_uv_c(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *uv, int width) {
+        for (int x = 0; x < width; x += 2) {
+            uv[x] = static_cast<std::uint8_t>((row0[x * 2 + 1] + row1[x * 2 + 1] + 1) >> 1);
+            uv[x + 1] = static_cast<std::uint8_t>((row0[x * 2 + 3] + row1[x * 2 + 3] + 1) >> 1);
+        }
+    }
+
+    /// 一档指令集的行内核。width 均为偶数；SIMD 内核处理整块，余下的像素交给标量版
+    struct RowKernels {
+        void (*rgb24_to_yuy2)(const std::uint8_t *, std::uint8_t *, int);
+        void (*rgba_to_yuy2)(const std::uint8_t *, std::uint8_t *, int);
+        void (*bgra_to_yuy2)(const std::uint8_t *, std::uint8_t *, int);
+        void (*yuy2_to_rgb24)(const std::uint8_t *, std::uint8_t *, int);
+        void (*yuy2_to_rgba)(const std::uint8_t *, std::uint8_t *, int);
+        void (*yuy2_to_bgra)(const std::uint8_t *, std::uint8_t *, int);
+        void (*i420_to_yuy2)(const std::uint8_t *, const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int);
+        void (*nv12_to_yuy2)(const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int);
+        void (*yuy2_to_y)(const std::uint8_t *, std::uint8_t *, int);
+        void (*yuy2_to_u_v)(const std::uint8_t *, const std::uint8_t *, std::uint8_t *, std::uint8_t *, int);
+        void (*yuy2_to_uv)(const std::uint8_t *, const std::uint8_t *, std::uint8_t *, int);
+    };
+
+    constexpr RowKernels SCALAR_KERNELS = {
+            rgb_row_to_yuy2_c<3, 0, 2>, rgb_row_to_yuy2_c<4, 0, 2>, rgb_row_to_yuy2_c<4, 2, 0>,
+            yuy2_row_to_rgb_c<3, 0, 2>, yuy2_row_to_rgb_c<4, 0, 2>, yuy2_row_to_rgb_c<4, 2, 0>,
+            i420_row_to_yuy2_c,         nv12_row_to_yuy2_c,         yuy2_row_to_y_c,
+            yuy2_rows_to_u_v_c,         yuy2_rows_to_uv_c,
+    };
+
+#if defined(USBIPDCPP_PIXEL_X86)
+    // ============== SSE2（x86-64 基线，无需运行时检测） ==============
+
+    /// 8 个 4 字节像素（lo / hi 各 4 个）→ 16 字节 YUY2
+    inline __m128i rgb32x8_to_yuy2_sse2(__m128i lo, __m128i hi, bool bgr) {
+        const __m128i byte_mask = _mm_set1_epi32(0xFF);
+        auto channel = [&](int shift) {
+            return _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, shift), byte_mask),
+                                   _mm_and_si128(_mm_srli_epi32(hi, shift), byte_mask));
+        };
+        __m128i r = channel(bgr ? 16 : 0);
+        __m128i g = channel(8);
+        __m128i b = channel(bgr ? 0 : 16);
+
+        // Y：和不超过 56228，按无符号 16 位计算（mullo 低 16 位与符号无关）
+        __m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+        y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+        y = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(y, _mm_set1_epi16(128)), 8), _mm_set1_epi16(16));
+
+        // 相邻两像素平均：结果在每个 32 位单元的低 16 位，高 16 位为 0
+        const __m128i low_mask = _mm_set1_epi32(0xFFFF);
+        __m128i ra = _mm_avg_epu16(_mm_and_si128(r, low_mask), _mm_srli_epi32(r, 16));
+        __m128i ga = _mm_avg_epu16(_mm_and_si128(g, low_mask), _mm_srli_epi32(g, 16));
+        __m128i ba = _mm_avg_epu16(_mm_and_si128(b, low_mask), _mm_srli_epi32(b, 16));
+        auto chroma = [&](short cr, short cg, short cb) {
+            __m128i s = _mm_add_epi16(_mm_mullo_epi16(ra, _mm_set1_epi16(cr)), _mm_mullo_epi16(ga, _mm_set1_epi16(cg)));
+            s = _mm_add_epi16(s, _mm_mullo_epi16(ba, _mm_set1_epi16(cb)));
+            return _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(s, _mm_set1_epi16(128)), 8), _mm_set1_epi16(128));
+        };
+        __m128i u = chroma(-38, -74, 112);
+        __m128i v = chroma(112, -94, -18);
+        // [u0 v0 u1 v1 u2 v2 u3 v3]（16 位）
+        __m128i uv = _mm_or_si128(_mm_and_si128(u, low_mask), _mm_slli_epi32(v, 16));
+
+        __m128i zero = _mm_setzero_si128();
+        return _mm_unpacklo_epi8(_mm_packus_epi16(y, zero), _mm_packus_epi16(uv, zero));
+    }
+
+    template <bool BGR>
+    void rgb32_row_to_yuy2_sse2(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4 + 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 2), rgb32x8_to_yuy2_sse2(lo, hi, BGR));
+        }
+        rgb_row_to_yuy2_c<4, BGR ? 2 : 0, BGR ? 0 : 2>(src + x * 4, dst + x * 2, width - x);
+    }
+
+    /// 从 p 读 4 字节（RGB24 像素加下一像素的首字节，后者会被通道掩码丢掉）
+    inline int load_rgb24_as_32(const std::uint8_t *p) {
+        int v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    void rgb24_row_to_yuy2_sse2(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        // SSE2 没有字节重排指令：逐像素按 4 字节读入拼成 32 位像素，走 RGBA 的内核。
+        // 每块最后一个像素多读 1 字节，循环条件留出下一像素
+        int x = 0;
+        for (; x + 10 <= width; x += 8) {
+            const std::uint8_t *p = src + x * 3;
+            __m128i lo = _mm_setr_epi32(load_rgb24_as_32(p), load_rgb24_as_32(p + 3), load_rgb24_as_32(p + 6),
+                                        load_rgb24_as_32(p + 9));
+            __m128i hi = _mm_setr_epi32(load_rgb24_as_32(p + 12), load_rgb24_as_32(p + 15), load_rgb24_as_32(p + 18),
+                                        load_rgb24_as_32(p + 21));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 2), rgb32x8_to_yuy2_sse2(lo, hi, false));
+        }
+        rgb_row_to_yuy2_c<3, 0, 2>(src + x * 3, dst + x * 2, width - x);
+    }
+
+    /// 16 字节 YUY2（8 像素）→ 各 8 个 16 位的 R / G / B（未钳位）
+    inline void yuy2x8_to_rgb16_sse2(__m128i src, __m128i *r, __m128i *g, __m128i *b) {
+        const __m128i low_byte = _mm_set1_epi16(0xFF);
+        const __m128i low_mask = _mm_set1_epi32(0xFFFF);
+        __m128i y = _mm_and_si128(src, low_byte);
+        __m128i uv = _mm_srli_epi16(src, 8); // [u0 v0 u1 v1 ...]
+        __m128i u = _mm_and_si128(uv, low_mask);
+        u = _mm_or_si128(u, _mm_slli_epi32(u, 16)); // 每对像素共用：[u0 u0 u1 u1 ...]
+        __m128i v = _mm_srli_epi32(uv, 16);
+        v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+
+        __m128i c = _mm_sub_epi16(y, _mm_set1_epi16(16));
+        __m128i d = _mm_sub_epi16(u, _mm_set1_epi16(128));
+        __m128i e = _mm_sub_epi16(v, _mm_set1_epi16(128));
+        const __m128i round = _mm_set1_epi32(128);
+        // madd 把相邻两个 16 位乘积相加成 32 位，系数成对交错
+        auto combine = [&](__m128i a, __m128i b2, short ca, short cb, __m128i extra_lo, __m128i extra_hi) {
+            __m128i coef = _mm_set1_epi32(static_cast<int>((static_cast<std::uint32_t>(static_cast<std::uint16_t>(cb))
+                                                            << 16) |
+                                                           static_cast<std::uint16_t>(ca)));
+            __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b2), coef), extra_lo);
+            __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b2), coef), extra_hi);
+            return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, round), 8),
+                                   _mm_srai_epi32(_mm_add_epi32(hi, round), 8));
+        };
+        __m128i zero = _mm_setzero_si128();
+        __m128i e_coef = _mm_set1_epi32(static_cast<std::uint16_t>(static_cast<short>(-208)));
+        __m128i g_extra_lo = _mm_madd_epi16(_mm_unpacklo_epi16(e, zero), e_coef);
+        __m128i g_extra_hi = _mm_madd_epi16(_mm_unpackhi_epi16(e, zero), e_coef);
+        *r = combine(c, e, 298, 409, zero, zero);
+        *g = combine(c, d, 298, -100, g_extra_lo, g_extra_hi);
+        *b = combine(c, d, 298, 516, zero, zero);
+    }
+
+    /// 8 像素 R / G / B（16 位）→ 两组各 4 个 4 字节像素
+    inline void rgb16_to_rgb32_sse2(__m128i r, __m128i g, __m128i b, bool bgr, __m128i *lo, __m128i *hi) {
+        __m128i r8 = _mm_packus_epi16(r, r);
+        __m128i g8 = _mm_packus_epi16(g, g);
+        __m128i b8 = _mm_packus_epi16(b, b);
+        __m128i first = _mm_unpacklo_epi8(bgr ? b8 : r8, g8);
+        __m128i second = _mm_unpacklo_epi8(bgr ? r8 : b8, _mm_set1_epi8(static_cast<char>(0xFF)));
+        *lo = _mm_unpacklo_epi16(first, second);
+        *hi = _mm_unpackhi_epi16(first, second);
+    }
+
+    template <bool BGR>
+    void yuy2_row_to_rgb32_sse2(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            __m128i r, g, b, lo, hi;
+            yuy2x8_to_rgb16_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2)), &r, &g, &b);
+            rgb16_to_rgb32_sse2(r, g, b, BGR, &lo, &hi);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), lo);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4 + 16), hi);
+        }
+        yuy2_row_to_rgb_c<4, BGR ? 2 : 0, BGR ? 0 : 2>(src + x * 2, dst + x * 4, width - x);
+    }
+
+    void yuy2_row_to_rgb24_sse2(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        int x = 0;
+        alignas(16) std::uint8_t expanded[32];
+        for (; x + 8 <= width; x += 8) {
+            __m128i r, g, b, lo, hi;
+            yuy2x8_to_rgb16_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2)), &r, &g, &b);
+            rgb16_to_rgb32_sse2(r, g, b, false, &lo, &hi);
+            _mm_store_si128(reinterpret_cast<__m128i *>(expanded), lo);
+            _mm_store_si128(reinterpret_cast<__m128i *>(expanded + 16), hi);
+            for (int i = 0; i < 8; ++i)
+                std::memcpy(dst + (x + i) * 3, expanded + i * 4, 3);
+        }
+        yuy2_row_to_rgb_c<3, 0, 2>(src + x * 2, dst + x * 3, width - x);
+    }
+
+    void i420_row_to_yuy2_sse2(const std::uint8_t *y, const std::uint8_t *u, const std::uint8_t *v, std::uint8_t *dst,
+                               int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i yy = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+            __m128i uu = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2));
+            __m128i vv = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2));
+            __m128i uv = _mm_unpacklo_epi8(uu, vv);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 2), _mm_unpacklo_epi8(yy, uv));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 2 + 16), _mm_unpackhi_epi8(yy, uv));
+        }
+        i420_row_to_yuy2_c(y + x, u + x / 2, v + x / 2, dst + x * 2, width - x);
+    }
+
+    void nv12_row_to_yuy2_sse2(const std::uint8_t *y, const std::uint8_t *uv, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i yy = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+            __m128i cc = _mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + x));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 2), _mm_unpacklo_epi8(yy, cc));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 2 + 16), _mm_unpackhi_epi8(yy, cc));
+        }
+        nv12_row_to_yuy2_c(y + x, uv + x, dst + x * 2, width - x);
+    }
+
+    void yuy2_row_to_y_sse2(const std::uint8_t *src, std::uint8_t *y, int width) {
+        const __m128i low_byte = _mm_set1_epi16(0xFF);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2 + 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(y + x),
+                             _mm_packus_epi16(_mm_and_si128(a, low_byte), _mm_and_si128(b, low_byte)));
+        }
+        yuy2_row_to_y_c(src + x * 2, y + x, width - x);
+    }
+
+    /// 两行各 16 像素的 YUY2 → 垂直平均后的 [u0 v0 ... u7 v7]
+    inline __m128i yuy2_rows_uv16_sse2(const std::uint8_t *row0, const std::uint8_t *row1) {
+        __m128i a = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row0)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1)));
+        __m128i b = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 16)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 16)));
+        return _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+    }
+
+    void yuy2_rows_to_uv_sse2(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *uv, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(uv + x), yuy2_rows_uv16_sse2(row0 + x * 2, row1 + x * 2));
+        yuy2_rows_to_uv_c(row0 + x * 2, row1 + x * 2, uv + x, width - x);
+    }
+
+    void yuy2_rows_to_u_v_sse2(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v,
+                               int width) {
+        const __m128i low_byte = _mm_set1_epi16(0xFF);
+        __m128i zero = _mm_setzero_si128();
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i uv = yuy2_rows_uv16_sse2(row0 + x * 2, row1 + x * 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(u + x / 2), _mm_packus_epi16(_mm_and_si128(uv, low_byte), zero));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(v + x / 2), _mm_packus_epi16(_mm_srli_epi16(uv, 8), zero));
+        }
+        yuy2_rows_to_u_v_c(row0 + x * 2, row1 + x * 2, u + x / 2, v + x / 2, width - x);
+    }
+
+    constexpr RowKernels SSE2_KERNELS = {
+            rgb24_row_to_yuy2_sse2,       rgb32_row_to_yuy2_sse2<false>, rgb32_row_to_yuy2_sse2<true>,
+            yuy2_row_to_rgb24_sse2,       yuy2_row_to_rgb32_sse2<false>, yuy2_row_to_rgb32_sse2<true>,
+            i420_row_to_yuy2_sse2,        nv12_row_to_yuy2_sse2,         yuy2_row_to_y_sse2,
+            yuy2_rows_to_u_v_sse2,        yuy2_rows_to_uv_sse2,
+    };
+
+    // ============== AVX2（运行时检测） ==============
+    // 256 位的 pack / unpack 在两个 128 位半区内各自进行，结果按 64 / 128 位块重排回像素顺序
+
+#define USBIPDCPP_AVX2 __attribute__((target("avx2")))
+
+    // lambda 不继承 target 属性，辅助运算都写成同样标注的函数
+
+    /// 两组 4 字节像素中某个分量（字节位移 shift）→ 16 位
+    USBIPDCPP_AVX2 inline __m256i rgb32_channel_avx2(__m256i lo, __m256i hi, int shift) {
+        const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+        return _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(lo, shift), byte_mask),
+                                  _mm256_and_si256(_mm256_srli_epi32(hi, shift), byte_mask));
+    }
+
+    /// ((cr·R + cg·G + cb·B + 128) >> 8) + 128，16 位有符号
+    USBIPDCPP_AVX2 inline __m256i rgb16_to_chroma_avx2(__m256i r, __m256i g, __m256i b, short cr, short cg, short cb) {
+        __m256i s = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(cr)),
+                                     _mm256_mullo_epi16(g, _mm256_set1_epi16(cg)));
+        s = _mm256_add_epi16(s, _mm256_mullo_epi16(b, _mm256_set1_epi16(cb)));
+        return _mm256_add_epi16(_mm256_srai_epi16(_mm256_add_epi16(s, _mm256_set1_epi16(128)), 8),
+                                _mm256_set1_epi16(128));
+    }
+
+    /// 16 个 4 字节像素（lo / hi 各 8 个）→ 32 字节 YUY2
+    USBIPDCPP_AVX2 inline __m256i rgb32x16_to_yuy2_avx2(__m256i lo, __m256i hi, bool bgr) {
+        // 半区 0 为像素 0-3、8-11，半区 1 为 4-7、12-15：相邻像素仍成对
+        __m256i r = rgb32_channel_avx2(lo, hi, bgr ? 16 : 0);
+        __m256i g = rgb32_channel_avx2(lo, hi, 8);
+        __m256i b = rgb32_channel_avx2(lo, hi, bgr ? 0 : 16);
+
+        __m256i y = _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(66)),
+                                     _mm256_mullo_epi16(g, _mm256_set1_epi16(129)));
+        y = _mm256_add_epi16(y, _mm256_mullo_epi16(b, _mm256_set1_epi16(25)));
+        y = _mm256_add_epi16(_mm256_srli_epi16(_mm256_add_epi16(y, _mm256_set1_epi16(128)), 8),
+                             _mm256_set1_epi16(16));
+
+        const __m256i low_mask = _mm256_set1_epi32(0xFFFF);
+        __m256i ra = _mm256_avg_epu16(_mm256_and_si256(r, low_mask), _mm256_srli_epi32(r, 16));
+        __m256i ga = _mm256_avg_epu16(_mm256_and_si256(g, low_mask), _mm256_srli_epi32(g, 16));
+        __m256i ba = _mm256_avg_epu16(_mm256_and_si256(b, low_mask), _mm256_srli_epi32(b, 16));
+        __m256i u = rgb16_to_chroma_avx2(ra, ga, ba, -38, -74, 112);
+        __m256i v = rgb16_to_chroma_avx2(ra, ga, ba, 112, -94, -18);
+        __m256i uv = _mm256_or_si256(_mm256_and_si256(u, low_mask), _mm256_slli_epi32(v, 16));
+
+        __m256i zero = _mm256_setzero_si256();
+        __m256i out = _mm256_unpacklo_epi8(_mm256_packus_epi16(y, zero), _mm256_packus_epi16(uv, zero));
+        // 64 位块顺序为像素 0-3、8-11、4-7、12-15
+        return _mm256_permute4x64_epi64(out, 0xD8);
+    }
+
+    template <bool BGR>
+    USBIPDCPP_AVX2 void rgb32_row_to_yuy2_avx2(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 4));
+            __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 4 + 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 2), rgb32x16_to_yuy2_avx2(lo, hi, BGR));
+        }
+        rgb32_row_to_yuy2_sse2<BGR>(src + x * 4, dst + x * 2, width - x);
+    }
+
+    USBIPDCPP_AVX2 void rgb24_row_to_yuy2_avx2(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        // 每 12 字节（4 像素）用 pshufb 展开成 4 个 4 字节像素；每次读 16 字节，留足 4 字节余量
+        const __m256i expand = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3,
+                                                4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        int x = 0;
+        for (; x + 18 <= width; x += 16) {
+            const std::uint8_t *p = src + x * 3;
+            __m256i lo = _mm256_loadu2_m128i(reinterpret_cast<const __m128i *>(p + 12),
+                                             reinterpret_cast<const __m128i *>(p));
+            __m256i hi = _mm256_loadu2_m128i(reinterpret_cast<const __m128i *>(p + 36),
+                                             reinterpret_cast<const __m128i *>(p + 24));
+            lo = _mm256_shuffle_epi8(lo, expand);
+            hi = _mm256_shuffle_epi8(hi, expand);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 2), rgb32x16_to_yuy2_avx2(lo, hi, false));
+        }
+        rgb24_row_to_yuy2_sse2(src + x * 3, dst + x * 2, width - x);
+    }
+
+    /// (ca·a + cb·b + extra + 128) >> 8：madd 把相邻两个 16 位乘积相加成 32 位，系数成对交错
+    USBIPDCPP_AVX2 inline __m256i madd_pair_avx2(__m256i a, __m256i b, short ca, short cb, __m256i extra_lo,
+                                                 __m256i extra_hi) {
+        const __m256i round = _mm256_set1_epi32(128);
+        __m256i coef = _mm256_set1_epi32(static_cast<int>(
+                (static_cast<std::uint32_t>(static_cast<std::uint16_t>(cb)) << 16) | static_cast<std::uint16_t>(ca)));
+        __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), coef), extra_lo);
+        __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), coef), extra_hi);
+        return _mm256_packs_epi32(_mm256_srai_epi32(_mm256_add_epi32(lo, round), 8),
+                                  _mm256_srai_epi32(_mm256_add_epi32(hi, round), 8));
+    }
+
+    /// 32 字节 YUY2（16 像素）→ 16 位 R / G / B，半区 0 为像素 0-7，半区 1 为 8-15
+    USBIPDCPP_AVX2 inline void yuy2x16_to_rgb16_avx2(__m256i src, __m256i *r, __m256i *g, __m256i *b) {
+        const __m256i low_byte = _mm256_set1_epi16(0xFF);
+        const __m256i low_mask = _mm256_set1_epi32(0xFFFF);
+        __m256i y = _mm256_and_si256(src, low_byte);
+        __m256i uv = _mm256_srli_epi16(src, 8);
+        __m256i u = _mm256_and_si256(uv, low_mask);
+        u = _mm256_or_si256(u, _mm256_slli_epi32(u, 16));
+        __m256i v = _mm256_srli_epi32(uv, 16);
+        v = _mm256_or_si256(v, _mm256_slli_epi32(v, 16));
+
+        __m256i c = _mm256_sub_epi16(y, _mm256_set1_epi16(16));
+        __m256i d = _mm256_sub_epi16(u, _mm256_set1_epi16(128));
+        __m256i e = _mm256_sub_epi16(v, _mm256_set1_epi16(128));
+        __m256i zero = _mm256_setzero_si256();
+        __m256i e_coef = _mm256_set1_epi32(static_cast<std::uint16_t>(static_cast<short>(-208)));
+        __m256i g_extra_lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(e, zero), e_coef);
+        __m256i g_extra_hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(e, zero), e_coef);
+        *r = madd_pair_avx2(c, e, 298, 409, zero, zero);
+        *g = madd_pair_avx2(c, d, 298, -100, g_extra_lo, g_extra_hi);
+        *b = madd_pair_avx2(c, d, 298, 516, zero, zero);
+    }
+
+    /// 16 像素 R / G / B → 两个 256 位各 8 个 4 字节像素（按像素顺序）
+    USBIPDCPP_AVX2 inline void rgb16_to_rgb32_avx2(__m256i r, __m256i g, __m256i b, bool bgr, __m256i *first8,
+                                                   __m256i *second8) {
+        __m256i r8 = _mm256_packus_epi16(r, r);
+        __m256i g8 = _mm256_packus_epi16(g, g);
+        __m256i b8 = _mm256_packus_epi16(b, b);
+        __m256i first = _mm256_unpacklo_epi8(bgr ? b8 : r8, g8);
+        __m256i second = _mm256_unpacklo_epi8(bgr ? r8 : b8, _mm256_set1_epi8(static_cast<char>(0xFF)));
+        __m256i lo = _mm256_unpacklo_epi16(first, second); // 像素 0-3 | 8-11
+        __m256i hi = _mm256_unpackhi_epi16(first, second); // 像素 4-7 | 12-15
+        *first8 = _mm256_permute2x128_si256(lo, hi, 0x20);
+        *second8 = _mm256_permute2x128_si256(lo, hi, 0x31);
+    }
+
+    template <bool BGR>
+    USBIPDCPP_AVX2 void yuy2_row_to_rgb32_avx2(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m256i r, g, b, first8, second8;
+            yuy2x16_to_rgb16_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2)), &r, &g, &b);
+            rgb16_to_rgb32_avx2(r, g, b, BGR, &first8, &second8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4), first8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4 + 32), second8);
+        }
+        yuy2_row_to_rgb32_sse2<BGR>(src + x * 2, dst + x * 4, width - x);
+    }
+
+    USBIPDCPP_AVX2 void yuy2_row_to_rgb24_avx2(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        // 每 4 个 4 字节像素用 pshufb 压成 12 字节，按顺序写 16 字节：多写的 4 字节由下一次覆盖，行尾留足余量
+        const __m128i compact = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        int x = 0;
+        for (; x + 18 <= width; x += 16) {
+            __m256i r, g, b, first8, second8;
+            yuy2x16_to_rgb16_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2)), &r, &g, &b);
+            rgb16_to_rgb32_avx2(r, g, b, false, &first8, &second8);
+            auto *p = reinterpret_cast<__m128i *>(dst + x * 3);
+            _mm_storeu_si128(p, _mm_shuffle_epi8(_mm256_castsi256_si128(first8), compact));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 3 + 12),
+                             _mm_shuffle_epi8(_mm256_extracti128_si256(first8, 1), compact));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 3 + 24),
+                             _mm_shuffle_epi8(_mm256_castsi256_si128(second8), compact));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 3 + 36),
+                             _mm_shuffle_epi8(_mm256_extracti128_si256(second8, 1), compact));
+        }
+        yuy2_row_to_rgb24_sse2(src + x * 2, dst + x * 3, width - x);
+    }
+
+    USBIPDCPP_AVX2 void i420_row_to_yuy2_avx2(const std::uint8_t *y, const std::uint8_t *u, const std::uint8_t *v,
+                                              std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i yy = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(y + x));
+            __m128i uu = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x / 2));
+            __m128i vv = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x / 2));
+            __m256i uv = _mm256_set_m128i(_mm_unpackhi_epi8(uu, vv), _mm_unpacklo_epi8(uu, vv));
+            __m256i a = _mm256_unpacklo_epi8(yy, uv); // 像素 0-7 | 16-23
+            __m256i b = _mm256_unpackhi_epi8(yy, uv); // 像素 8-15 | 24-31
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 2), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 2 + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+        i420_row_to_yuy2_sse2(y + x, u + x / 2, v + x / 2, dst + x * 2, width - x);
+    }
+
+    USBIPDCPP_AVX2 void nv12_row_to_yuy2_avx2(const std::uint8_t *y, const std::uint8_t *uv, std::uint8_t *dst,
+                                              int width) {
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i yy = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(y + x));
+            __m256i cc = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(uv + x));
+            __m256i a = _mm256_unpacklo_epi8(yy, cc);
+            __m256i b = _mm256_unpackhi_epi8(yy, cc);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 2), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 2 + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+        nv12_row_to_yuy2_sse2(y + x, uv + x, dst + x * 2, width - x);
+    }
+
+    USBIPDCPP_AVX2 void yuy2_row_to_y_avx2(const std::uint8_t *src, std::uint8_t *y, int width) {
+        const __m256i low_byte = _mm256_set1_epi16(0xFF);
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2 + 32));
+            __m256i packed = _mm256_packus_epi16(_mm256_and_si256(a, low_byte), _mm256_and_si256(b, low_byte));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(y + x), _mm256_permute4x64_epi64(packed, 0xD8));
+        }
+        yuy2_row_to_y_sse2(src + x * 2, y + x, width - x);
+    }
+
+    /// 两行各 32 像素的 YUY2 → 垂直平均后的 [u0 v0 ... u15 v15]
+    USBIPDCPP_AVX2 inline __m256i yuy2_rows_uv32_avx2(const std::uint8_t *row0, const std::uint8_t *row1) {
+        __m256i a = _mm256_avg_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0)),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1)));
+        __m256i b = _mm256_avg_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + 32)),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + 32)));
+        __m256i packed = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        return _mm256_permute4x64_epi64(packed, 0xD8);
+    }
+
+    USBIPDCPP_AVX2 void yuy2_rows_to_uv_avx2(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *uv,
+                                             int width) {
+        int x = 0;
+        for (; x + 32 <= width; x += 32)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(uv + x), yuy2_rows_uv32_avx2(row0 + x * 2, row1 + x * 2));
+        yuy2_rows_to_uv_sse2(row0 + x * 2, row1 + x * 2, uv + x, width - x);
+    }
+
+    USBIPDCPP_AVX2 void yuy2_rows_to_u_v_avx2(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u,
+                                              std::uint8_t *v, int width) {
+        const __m256i low_byte = _mm256_set1_epi16(0xFF);
+        int x = 0;
+        for (; x + 32 <= width; x += 32) {
+            __m256i uv = yuy2_rows_uv32_avx2(row0 + x * 2, row1 + x * 2);
+            __m256i packed = _mm256_packus_epi16(_mm256_and_si256(uv, low_byte), _mm256_srli_epi16(uv, 8));
+            // 64 位块为 U 0-7、V 0-7、U 8-15、V 8-15
+            packed = _mm256_permute4x64_epi64(packed, 0xD8);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x / 2), _mm256_castsi256_si128(packed));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(v + x / 2), _mm256_extracti128_si256(packed, 1));
+        }
+        yuy2_rows_to_u_v_sse2(row0 + x * 2, row1 + x * 2, u + x / 2, v + x / 2, width - x);
+    }
+
+#undef USBIPDCPP_AVX2
+
+    constexpr RowKernels AVX2_KERNELS = {
+            rgb24_row_to_yuy2_avx2,       rgb32_row_to_yuy2_avx2<false>, rgb32_row_to_yuy2_avx2<true>,
+            yuy2_row_to_rgb24_avx2,       yuy2_row_to_rgb32_avx2<false>, yuy2_row_to_rgb32_avx2<true>,
+            i420_row_to_yuy2_avx2,        nv12_row_to_yuy2_avx2,         yuy2_row_to_y_avx2,
+            yuy2_rows_to_u_v_avx2,        yuy2_rows_to_uv_avx2,
+    };
+
+#elif defined(USBIPDCPP_PIXEL_NEON)
+    // ============== NEON（AArch64 基线） ==============
+
+    /// 16 像素的 R / G / B 平面 → 32 字节 YUY2
+    inline void rgb_planes16_to_yuy2_neon(uint8x16_t r, uint8x16_t g, uint8x16_t b, std::uint8_t *dst) {
+        auto luma = [](uint8x8_t r8, uint8x8_t g8, uint8x8_t b8) {
+            uint16x8_t s = vmull_u8(r8, vdup_n_u8(66));
+            s = vmlal_u8(s, g8, vdup_n_u8(129));
+            s = vmlal_u8(s, b8, vdup_n_u8(25));
+            return vadd_u8(vshrn_n_u16(vaddq_u16(s, vdupq_n_u16(128)), 8), vdup_n_u8(16));
+        };
+        uint8x16_t y = vcombine_u8(luma(vget_low_u8(r), vget_low_u8(g), vget_low_u8(b)),
+                                   luma(vget_high_u8(r), vget_high_u8(g), vget_high_u8(b)));
+        // 相邻两像素和再四舍五入折半 = (a + b + 1) >> 1
+        int16x8_t ra = vreinterpretq_s16_u16(vrshrq_n_u16(vpaddlq_u8(r), 1));
+        int16x8_t ga = vreinterpretq_s16_u16(vrshrq_n_u16(vpaddlq_u8(g), 1));
+        int16x8_t ba = vreinterpretq_s16_u16(vrshrq_n_u16(vpaddlq_u8(b), 1));
+        auto chroma = [&](std::int16_t cr, std::int16_t cg, std::int16_t cb) {
+            int16x8_t s = vmulq_n_s16(ra, cr);
+            s = vmlaq_n_s16(s, ga, cg);
+            s = vmlaq_n_s16(s, ba, cb);
+            s = vaddq_s16(vshrq_n_s16(vaddq_s16(s, vdupq_n_s16(128)), 8), vdupq_n_s16(128));
+            return vqmovun_s16(s);
+        };
+        uint8x8x2_t y_split = vuzp_u8(vget_low_u8(y), vget_high_u8(y)); // 偶数 / 奇数像素
+        uint8x8x4_t out = {{y_split.val[0], chroma(-38, -74, 112), y_split.val[1], chroma(112, -94, -18)}};
+        vst4_u8(dst, out);
+    }
+
+    void rgb24_row_to_yuy2_neon(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            uint8x16x3_t px = vld3q_u8(src + x * 3);
+            rgb_planes16_to_yuy2_neon(px.val[0], px.val[1], px.val[2], dst + x * 2);
+        }
+        rgb_row_to_yuy2_c<3, 0, 2>(src + x * 3, dst + x * 2, width - x);
+    }
+
+    template <bool BGR>
+    void rgb32_row_to_yuy2_neon(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            uint8x16x4_t px = vld4q_u8(src + x * 4);
+            rgb_planes16_to_yuy2_neon(px.val[BGR ? 2 : 0], px.val[1], px.val[BGR ? 0 : 2], dst + x * 2);
+        }
+        rgb_row_to_yuy2_c<4, BGR ? 2 : 0, BGR ? 0 : 2>(src + x * 4, dst + x * 2, width - x);
+    }
+
+    /// 8 像素的 C / D / E → 钳位后的一个分量：(ca·C + cd·D + ce·E + 128) >> 8
+    inline uint8x8_t yuv_channel_neon(int16x8_t c, int16x8_t d, int16x8_t e, std::int16_t cd, std::int16_t ce) {
+        int32x4_t lo = vmull_n_s16(vget_low_s16(c), 298);
+        int32x4_t hi = vmull_n_s16(vget_high_s16(c), 298);
+        lo = vmlal_n_s16(lo, vget_low_s16(d), cd);
+        hi = vmlal_n_s16(hi, vget_high_s16(d), cd);
+        lo = vmlal_n_s16(lo, vget_low_s16(e), ce);
+        hi = vmlal_n_s16(hi, vget_high_s16(e), ce);
+        lo = vshrq_n_s32(vaddq_s32(lo, vdupq_n_s32(128)), 8);
+        hi = vshrq_n_s32(vaddq_s32(hi, vdupq_n_s32(128)), 8);
+        return vqmovun_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+
+    /// 32 字节 YUY2（16 像素）→ R / G / B 平面
+    inline void yuy2x16_to_rgb_planes_neon(const std::uint8_t *src, uint8x16_t *r, uint8x16_t *g, uint8x16_t *b) {
+        uint8x8x4_t px = vld4_u8(src); // y 偶, u, y 奇, v
+        int16x8_t d = vreinterpretq_s16_u16(vsubl_u8(px.val[1], vdup_n_u8(128)));
+        int16x8_t e = vreinterpretq_s16_u16(vsubl_u8(px.val[3], vdup_n_u8(128)));
+        int16x8_t c_even = vreinterpretq_s16_u16(vsubl_u8(px.val[0], vdup_n_u8(16)));
+        int16x8_t c_odd = vreinterpretq_s16_u16(vsubl_u8(px.val[2], vdup_n_u8(16)));
+        int16x8_t zero = vdupq_n_s16(0);
+        auto interleave = [](uint8x8_t even, uint8x8_t odd) {
+            uint8x8x2_t z = vzip_u8(even, odd);
+            return vcombine_u8(z.val[0], z.val[1]);
+        };
+        *r = interleave(yuv_channel_neon(c_even, zero, e, 0, 409), yuv_channel_neon(c_odd, zero, e, 0, 409));
+        *g = interleave(yuv_channel_neon(c_even, d, e, -100, -208), yuv_channel_neon(c_odd, d, e, -100, -208));
+        *b = interleave(yuv_channel_neon(c_even, d, zero, 516, 0), yuv_channel_neon(c_odd, d, zero, 516, 0));
+    }
+
+    void yuy2_row_to_rgb24_neon(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            uint8x16x3_t px;
+            yuy2x16_to_rgb_planes_neon(src + x * 2, &px.val[0], &px.val[1], &px.val[2]);
+            vst3q_u8(dst + x * 3, px);
+        }
+        yuy2_row_to_rgb_c<3, 0, 2>(src + x * 2, dst + x * 3, width - x);
+    }
+
+    template <bool BGR>
+    void yuy2_row_to_rgb32_neon(const std::uint8_t *src, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            uint8x16x4_t px;
+            yuy2x16_to_rgb_planes_neon(src + x * 2, &px.val[BGR ? 2 : 0], &px.val[1], &px.val[BGR ? 0 : 2]);
+            px.val[3] = vdupq_n_u8(255);
+            vst4q_u8(dst + x * 4, px);
+        }
+        yuy2_row_to_rgb_c<4, BGR ? 2 : 0, BGR ? 0 : 2>(src + x * 2, dst + x * 4, width - x);
+    }
+
+    void i420_row_to_yuy2_neon(const std::uint8_t *y, const std::uint8_t *u, const std::uint8_t *v, std::uint8_t *dst,
+                               int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            uint8x8x2_t yy = vld2_u8(y + x); // 偶数 / 奇数像素
+            uint8x8x4_t out = {{yy.val[0], vld1_u8(u + x / 2), yy.val[1], vld1_u8(v + x / 2)}};
+            vst4_u8(dst + x * 2, out);
+        }
+        i420_row_to_yuy2_c(y + x, u + x / 2, v + x / 2, dst + x * 2, width - x);
+    }
+
+    void nv12_row_to_yuy2_neon(const std::uint8_t *y, const std::uint8_t *uv, std::uint8_t *dst, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            uint8x8x2_t yy = vld2_u8(y + x);
+            uint8x8x2_t cc = vld2_u8(uv + x);
+            uint8x8x4_t out = {{yy.val[0], cc.val[0], yy.val[1], cc.val[1]}};
+            vst4_u8(dst + x * 2, out);
+        }
+        nv12_row_to_yuy2_c(y + x, uv + x, dst + x * 2, width - x);
+    }
+
+    void yuy2_row_to_y_neon(const std::uint8_t *src, std::uint8_t *y, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16)
+            vst1q_u8(y + x, vld2q_u8(src + x * 2).val[0]);
+        yuy2_row_to_y_c(src + x * 2, y + x, width - x);
+    }
+
+    void yuy2_rows_to_u_v_neon(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v,
+                               int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            uint8x8x4_t a = vld4_u8(row0 + x * 2);
+            uint8x8x4_t b = vld4_u8(row1 + x * 2);
+            vst1_u8(u + x / 2, vrhadd_u8(a.val[1], b.val[1]));
+            vst1_u8(v + x / 2, vrhadd_u8(a.val[3], b.val[3]));
+        }
+        yuy2_rows_to_u_v_c(row0 + x * 2, row1 + x * 2, u + x / 2, v + x / 2, width - x);
+    }
+
+    void yuy2_rows_to_uv_neon(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *uv, int width) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            uint8x8x4_t a = vld4_u8(row0 + x * 2);
+            uint8x8x4_t b = vld4_u8(row1 + x * 2);
+            uint8x8x2_t out = {{vrhadd_u8(a.val[1], b.val[1]), vrhadd_u8(a.val[3], b.val[3])}};
+            vst2_u8(uv + x, out);
+        }
+        yuy2_rows_to_uv_c(row0 + x * 2, row1 + x * 2, uv + x, width - x);
+    }
+
+    constexpr RowKernels NEON_KERNELS = {
+            rgb24_row_to_yuy2_neon,       rgb32_row_to_yuy2_neon<false>, rgb32_row_to_yuy2_neon<true>,
+            yuy2_row_to_rgb24_neon,       yuy2_row_to_rgb32_neon<false>, yuy2_row_to_rgb32_neon<true>,
+            i420_row_to_yuy2_neon,        nv12_row_to_yuy2_neon,         yuy2_row_to_y_neon,
+            yuy2_rows_to_u_v_neon,        yuy2_rows_to_uv_neon,
+    };
+#endif
+
+    bool level_supported(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::Scalar:
+                return true;
+#if defined(USBIPDCPP_PIXEL_X86)
+            case SimdLevel::SSE2:
+                return true;
+            case SimdLevel::AVX2: {
+                static const bool supported = __builtin_cpu_supports("avx2");
+                return supported;
+            }
+#elif defined(USBIPDCPP_PIXEL_NEON)
+            case SimdLevel::NEON:
+                return true;
+#endif
+            default:
+                return false;
+        }
+    }
+
+    std::atomic<SimdLevel> &active_level() {
+        static std::atomic<SimdLevel> level{detect_simd_level()};
+        return level;
+    }
+
+    const RowKernels &kernels_for(SimdLevel level) {
+        switch (level) {
+#if defined(USBIPDCPP_PIXEL_X86)
+            case SimdLevel::SSE2:
+                return SSE2_KERNELS;
+            case SimdLevel::AVX2:
+                return AVX2_KERNELS;
+#elif defined(USBIPDCPP_PIXEL_NEON)
+            case SimdLevel::NEON:
+                return NEON_KERNELS;
+#endif
+            default:
+                return SCALAR_KERNELS;
+        }
+    }
+
+    /// 行指针：第 row 行
+    inline const std::uint8_t *row_of(const ImagePlanes &planes, int plane, int row) {
+        return planes.data[plane] + static_cast<std::size_t>(row) * planes.stride[plane];
+    }
+
+    inline std::uint8_t *row_of(const MutableImagePlanes &planes, int plane, int row) {
+        return planes.data[plane] + static_cast<std::size_t>(row) * planes.stride[plane];
+    }
+
+    /// 打包格式每像素字节数，平面格式返回 0
+    int packed_bytes_per_pixel(PixelFormat format) {
+        switch (format) {
+            case PixelFormat::RGB24:
+                return 3;
+            case PixelFormat::RGBA:
+            case PixelFormat::BGRA:
+                return 4;
+            case PixelFormat::YUY2:
+                return 2;
+            default:
+                return 0;
+        }
+    }
+} // namespace
+
+std::size_t pixel_image_size(PixelFormat format, int width, int height) {
+    if (width <= 0 || height <= 0)
+        return 0;
+    auto w = static_cast<std::size_t>(width);
+    auto h = static_cast<std::size_t>(height);
+    if (auto bpp = packed_bytes_per_pixel(format))
+        return w * h * bpp;
+    // NV12 / I420：Y 平面 + 两个 (w/2)×(h/2) 的色度（向上取整）
+    auto cw = (w + 1) / 2;
+    auto ch = (h + 1) / 2;
+    return w * h + 2 * cw * ch;
+}
+
+MutableImagePlanes pixel_image_planes(PixelFormat format, std::uint8_t *base, int width, int height) {
+    MutableImagePlanes planes{};
+    auto w = static_cast<std::size_t>(std::max(width, 0));
+    auto h = static_cast<std::size_t>(std::max(height, 0));
+    planes.data[0] = base;
+    if (auto bpp = packed_bytes_per_pixel(format)) {
+        planes.stride[0] = w * bpp;
+        return planes;
+    }
+    auto cw = (w + 1) / 2;
+    auto ch = (h + 1) / 2;
+    planes.stride[0] = w;
+    planes.data[1] = base + w * h;
+    if (format == PixelFormat::NV12) {
+        planes.stride[1] = cw * 2;
+    }
+    else {
+        planes.stride[1] = cw;
+        planes.data[2] = planes.data[1] + cw * ch;
+        planes.stride[2] = cw;
+    }
+    return planes;
+}
+
+bool convert_pixels(PixelFormat src_format, const ImagePlanes &src, PixelFormat dst_format,
+                    const MutableImagePlanes &dst, int width, int height) {
+    if (width <= 0 || height <= 0 || (width & 1) != 0)
+        return false;
+    if (src_format != PixelFormat::YUY2 && dst_format != PixelFormat::YUY2)
+        return false;
+    const auto &k = kernels_for(active_level().load(std::memory_order_relaxed));
+
+    if (src_format == PixelFormat::YUY2 && dst_format == PixelFormat::YUY2) {
+        for (int row = 0; row < height; ++row)
+            std::memcpy(row_of(dst, 0, row), row_of(src, 0, row), static_cast<std::size_t>(width) * 2);
+        return true;
+    }
+
+    if (dst_format == PixelFormat::YUY2) {
+        for (int row = 0; row < height; ++row) {
+            auto *out = row_of(dst, 0, row);
+            switch (src_format) {
+                case PixelFormat::RGB24:
+                    k.rgb24_to_yuy2(row_of(src, 0, row), out, width);
+                    break;
+                case PixelFormat::RGBA:
+                    k.rgba_to_yuy2(row_of(src, 0, row), out, width);
+                    break;
+                case PixelFormat::BGRA:
+                    k.bgra_to_yuy2(row_of(src, 0, row), out, width);
+                    break;
+                case PixelFormat::NV12:
+                    k.nv12_to_yuy2(row_of(src, 0, row), row_of(src, 1, row / 2), out, width);
+                    break;
+                case PixelFormat::I420:
+                    k.i420_to_yuy2(row_of(src, 0, row), row_of(src, 1, row / 2), row_of(src, 2, row / 2), out, width);
+                    break;
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    switch (dst_format) {
+        case PixelFormat::RGB24:
+            for (int row = 0; row < height; ++row)
+                k.yuy2_to_rgb24(row_of(src, 0, row), row_of(dst, 0, row), width);
+            return true;
+        case PixelFormat::RGBA:
+            for (int row = 0; row < height; ++row)
+                k.yuy2_to_rgba(row_of(src, 0, row), row_of(dst, 0, row), width);
+            return true;
+        case PixelFormat::BGRA:
+            for (int row = 0; row < height; ++row)
+                k.yuy2_to_bgra(row_of(src, 0, row), row_of(dst, 0, row), width);
+            return true;
+        case PixelFormat::NV12:
+        case PixelFormat::I420:
+            for (int row = 0; row < height; row += 2) {
+                // 奇数高度的最后一行没有下一行：与自己平均
+                auto *row0 = row_of(src, 0, row);
+                auto *row1 = row + 1 < height ? row_of(src, 0, row + 1) : row0;
+                k.yuy2_to_y(row0, row_of(dst, 0, row), width);
+                if (row + 1 < height)
+                    k.yuy2_to_y(row1, row_of(dst, 0, row + 1), width);
+                if (dst_format == PixelFormat::NV12)
+                    k.yuy2_to_uv(row0, row1, row_of(dst, 1, row / 2), width);
+                else
+                    k.yuy2_to_u_v(row0, row1, row_of(dst, 1, row / 2), row_of(dst, 2, row / 2), width);
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+SimdLevel detect_simd_level() {
+#if defined(USBIPDCPP_PIXEL_X86)
+    return level_supported(SimdLevel::AVX2) ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#elif defined(USBIPDCPP_PIXEL_NEON)
+    return SimdLevel::NEON;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel pixel_convert_simd_level() {
+    return active_level().load(std::memory_order_relaxed);
+}
+
+SimdLevel set_pixel_convert_simd_level(SimdLevel level) {
+    auto effective = level_supported(level) ? level : detect_simd_level();
+    active_level().store(effective, std::memory_order_relaxed);
+    return effective;
+}
+
+const char *simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar:
+            return "scalar";
+        case SimdLevel::SSE2:
+            return "sse2";
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::NEON:
+            return "neon";
+    }
+    return "unknown";
+}
+
+} // namespace usbipdcpp
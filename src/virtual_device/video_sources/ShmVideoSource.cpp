@@ -0,0 +1,280 @@
+// clang-format off
+// Android 的 bionic 没有 shm_open，memfd_create 也要 API 30
+#if defined(__linux__) && !defined(__ANDROID__)
+#define USBIPDCPP_SHM_VIDEO_SUPPORTED 1
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+// clang-format on
+
+#include "usbipdcpp/virtual_device/video_sources/ShmVideoSource.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+#include "usbipdcpp/virtual_device/video_sources/shm_video_ring.h"
+
+namespace usbipdcpp {
+
+namespace {
+    /// latest 在钉住前后一直在换（生产者远快于取帧）时最多重读几次
+    constexpr int MAX_PIN_ATTEMPTS = 4;
+    /// 生产者不发 eventfd 通知时 wait_frame 的轮询间隔
+    constexpr auto POLL_INTERVAL = std::chrono::milliseconds(2);
+} // namespace
+
+struct ShmVideoSource::Mapping {
+    void *base = nullptr;
+    std::size_t size = 0;
+    int fd = -1;
+    int event_fd = -1;
+    std::string name;
+
+    usbipdcpp_shm_video_header *header() const {
+        return static_cast<usbipdcpp_shm_video_header *>(base);
+    }
+
+    /// 槽位的帧数据：按建环时自己的参数算，不信环头里生产者可改的 data_offset / slot_stride
+    const std::uint8_t *slot_data(std::uint32_t slot, std::size_t slot_capacity) const {
+        return static_cast<const std::uint8_t *>(base) + usbipdcpp_shm_video_align(sizeof(usbipdcpp_shm_video_header)) +
+               slot * usbipdcpp_shm_video_align(slot_capacity);
+    }
+
+    ~Mapping() {
+#ifdef USBIPDCPP_SHM_VIDEO_SUPPORTED
+        if (base)
+            ::munmap(base, size);
+        if (fd >= 0)
+            ::close(fd);
+        if (event_fd >= 0)
+            ::close(event_fd);
+        // 名字随服务端消失；已映射的生产者不受影响，下次重新 shm_open 会失败而不是写进旧环
+        if (!name.empty())
+            ::shm_unlink(name.c_str());
+#endif
+    }
+};
+
+namespace {
+    /// 钉住一个槽位：作为 VideoFrame::owner，释放时放开并可能是映射的最后一个引用
+    struct SlotPin {
+        SlotPin(std::shared_ptr<const void> mapping, std::uint32_t *readers) :
+            mapping(std::move(mapping)), readers(readers) {
+        }
+        SlotPin(const SlotPin &) = delete;
+        SlotPin &operator=(const SlotPin &) = delete;
+
+        std::shared_ptr<const void> mapping;
+        std::uint32_t *readers;
+
+        ~SlotPin() {
+            std::atomic_ref(*readers).fetch_sub(1, std::memory_order_release);
+        }
+    };
+} // namespace
+
+ShmVideoSource::ShmVideoSource(VideoFormatInfo format, ShmVideoSourceOptions options) :
+    format_(std::move(format)), options_(std::move(options)), frame_interval_(format_.default_frame_interval) {
+#ifdef USBIPDCPP_SHM_VIDEO_SUPPORTED
+    if (format_.max_frame_size == 0 || options_.slot_count < 2 ||
+        options_.slot_count > USBIPDCPP_SHM_VIDEO_MAX_SLOTS) {
+        SPDLOG_ERROR("共享内存视频源参数无效：帧容量 {}，槽位数 {}", format_.max_frame_size, options_.slot_count);
+        return;
+    }
+    auto mapping = std::make_shared<Mapping>();
+    if (options_.name.empty()) {
+        mapping->fd = ::memfd_create("usbipdcpp-video", MFD_CLOEXEC);
+    }
+    else {
+        // 同名旧环（上次没正常退出）先删掉，旧生产者不会写进新环
+        ::shm_unlink(options_.name.c_str());
+        mapping->fd = ::shm_open(options_.name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (mapping->fd >= 0)
+            mapping->name = options_.name;
+    }
+    if (mapping->fd < 0) {
+        SPDLOG_ERROR("创建共享内存失败 {}: {}", options_.name, std::strerror(errno));
+        return;
+    }
+    mapping->size = static_cast<std::size_t>(
+            usbipdcpp_shm_video_ring_size(options_.slot_count, format_.max_frame_size));
+    if (::ftruncate(mapping->fd, static_cast<off_t>(mapping->size)) != 0) {
+        SPDLOG_ERROR("设置共享内存大小 {} 失败: {}", mapping->size, std::strerror(errno));
+        return;
+    }
+    void *base = ::mmap(nullptr, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, mapping->fd, 0);
+    if (base == MAP_FAILED) {
+        SPDLOG_ERROR("映射共享内存失败: {}", std::strerror(errno));
+        return;
+    }
+    mapping->base = base;
+    mapping->event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mapping->event_fd < 0)
+        SPDLOG_WARN("创建 eventfd 失败，wait_frame 改为轮询: {}", std::strerror(errno));
+    usbipdcpp_shm_video_init(base, mapping->size, format_.fourcc, format_.width, format_.height,
+                             format_.default_frame_interval, options_.slot_count, format_.max_frame_size);
+    mapping_ = std::move(mapping);
+    SPDLOG_INFO("共享内存视频源 {}: {}x{}，{} 个槽位 × {} 字节", options_.name.empty() ? "memfd" : options_.name,
+                format_.width, format_.height, options_.slot_count, format_.max_frame_size);
+#else
+    SPDLOG_ERROR("共享内存视频源只支持 Linux");
+#endif
+}
+
+ShmVideoSource::~ShmVideoSource() = default;
+
+int ShmVideoSource::fd() const {
+    return mapping_ ? mapping_->fd : -1;
+}
+
+int ShmVideoSource::event_fd() const {
+    return mapping_ ? mapping_->event_fd : -1;
+}
+
+void *ShmVideoSource::ring() const {
+    return mapping_ ? mapping_->base : nullptr;
+}
+
+std::size_t ShmVideoSource::ring_size() const {
+    return mapping_ ? mapping_->size : 0;
+}
+
+std::vector<VideoFormatInfo> ShmVideoSource::supported_formats() const {
+    return {format_};
+}
+
+VideoFormatInfo ShmVideoSource::current_format() const {
+    std::lock_guard lock(mutex_);
+    auto current = format_;
+    current.default_frame_interval = frame_interval_;
+    return current;
+}
+
+bool ShmVideoSource::set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                                std::uint32_t frame_interval) {
+    if (fourcc != format_.fourcc || width != format_.width || height != format_.height)
+        return false;
+    std::lock_guard lock(mutex_);
+    if (frame_interval != 0)
+        frame_interval_ = frame_interval;
+    return true;
+}
+
+std::size_t ShmVideoSource::max_frame_size() const {
+    return format_.max_frame_size;
+}
+
+std::uint32_t ShmVideoSource::frame_interval() const {
+    std::lock_guard lock(mutex_);
+    return frame_interval_;
+}
+
+std::uint64_t ShmVideoSource::latest_frame_number() const {
+    return std::atomic_ref(mapping_->header()->latest).load(std::memory_order_acquire) >> 8;
+}
+
+bool ShmVideoSource::get_frame(VideoFrame &frame) {
+    if (!mapping_)
+        return false;
+    auto *header = mapping_->header();
+    for (int attempt = 0; attempt < MAX_PIN_ATTEMPTS; ++attempt) {
+        auto latest = std::atomic_ref(header->latest).load(std::memory_order_acquire);
+        if (latest == 0)
+            break;
+        auto slot = static_cast<std::uint32_t>(latest & 0xFF);
+        auto frame_number = latest >> 8;
+        if (slot >= options_.slot_count) {
+            SPDLOG_ERROR("共享内存视频源: 生产者写入了无效槽位 {}", slot);
+            return false;
+        }
+        auto &desc = header->slots[slot];
+        // 先钉住再确认：与生产者 begin 的 "置 seq 再查 readers" 配对，两边都是 seq_cst
+        std::atomic_ref(desc.readers).fetch_add(1, std::memory_order_seq_cst);
+        if (std::atomic_ref(desc.seq).load(std::memory_order_seq_cst) != frame_number * 2) {
+            std::atomic_ref(desc.readers).fetch_sub(1, std::memory_order_release);
+            std::lock_guard lock(mutex_);
+            ++retries_;
+            continue;
+        }
+        // 描述只读一次，之后只用这份拷贝：生产者随时能改共享内存，检查和使用必须是同一个值
+        auto size = std::atomic_ref(desc.size).load(std::memory_order_relaxed);
+        auto flags = std::atomic_ref(desc.flags).load(std::memory_order_relaxed);
+        // 拷贝完再确认 seq 没变（序列锁读端），否则拷到的可能是不守协议的生产者正在改写的描述
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (std::atomic_ref(desc.seq).load(std::memory_order_relaxed) != frame_number * 2) {
+            std::atomic_ref(desc.readers).fetch_sub(1, std::memory_order_release);
+            std::lock_guard lock(mutex_);
+            ++retries_;
+            continue;
+        }
+        if (size > format_.max_frame_size) {
+            std::atomic_ref(desc.readers).fetch_sub(1, std::memory_order_release);
+            SPDLOG_ERROR("共享内存视频源: 帧大小 {} 超过槽位容量 {}", size, format_.max_frame_size);
+            return false;
+        }
+        auto pin = std::make_shared<SlotPin>(mapping_, &desc.readers);
+        frame = {mapping_->slot_data(slot, format_.max_frame_size), size,
+                 (flags & USBIPDCPP_SHM_VIDEO_KEYFRAME) != 0, std::move(pin)};
+
+        std::lock_guard lock(mutex_);
+        if (frame_number == last_frame_number_) {
+            ++repeated_;
+        }
+        else {
+            if (last_frame_number_ != 0 && frame_number > last_frame_number_ + 1)
+                missed_ += frame_number - last_frame_number_ - 1;
+            last_frame_number_ = frame_number;
+            ++frames_;
+        }
+        return true;
+    }
+    // 还没有帧，或生产者换帧太快一直没钉住：这次交出空帧，handler 下个 URB 再取
+    frame = {nullptr, 0, false, nullptr};
+    return true;
+}
+
+bool ShmVideoSource::wait_frame(std::chrono::milliseconds timeout) {
+    if (!mapping_)
+        return false;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        {
+            std::lock_guard lock(mutex_);
+            if (latest_frame_number() > last_frame_number_)
+                return true;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            return false;
+        auto slice = std::min(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) +
+                                      std::chrono::milliseconds(1),
+                              POLL_INTERVAL);
+#ifdef USBIPDCPP_SHM_VIDEO_SUPPORTED
+        if (mapping_->event_fd >= 0) {
+            pollfd pfd{mapping_->event_fd, POLLIN, 0};
+            if (::poll(&pfd, 1, static_cast<int>(slice.count())) > 0) {
+                std::uint64_t count;
+                [[maybe_unused]] auto n = ::read(mapping_->event_fd, &count, sizeof(count));
+            }
+            continue;
+        }
+#endif
+        std::this_thread::sleep_for(slice);
+    }
+}
+
+ShmVideoSource::Stats ShmVideoSource::stats() const {
+    std::lock_guard lock(mutex_);
+    return {frames_, repeated_, missed_, retries_};
+}
+
+} // namespace usbipdcpp
@@ -0,0 +1,237 @@
+#include "usbipdcpp/virtual_device/video_sources/VideoBroadcaster.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+namespace usbipdcpp {
+
+namespace {
+    /// 源取帧失败后至少等这么久再重试，避免空转
+    constexpr auto MIN_RETRY_DELAY = std::chrono::milliseconds(10);
+    /// 源交出空帧（自己也还没有新帧）时隔多久再取
+    constexpr auto EMPTY_RETRY_DELAY = std::chrono::milliseconds(1);
+} // namespace
+
+std::shared_ptr<VideoBroadcaster> VideoBroadcaster::create(std::unique_ptr<VideoSource> source,
+                                                           VideoBroadcasterOptions options) {
+    return std::shared_ptr<VideoBroadcaster>(new VideoBroadcaster(std::move(source), options));
+}
+
+VideoBroadcaster::VideoBroadcaster(std::unique_ptr<VideoSource> source, VideoBroadcasterOptions options) :
+    source_(std::move(source)), options_(options), format_(source_->current_format()),
+    max_frame_size_(source_->max_frame_size()) {
+    // 只列出当前格式与分辨率（带源声明的帧间隔），其余组合订阅者切换不了
+    for (auto &f: source_->supported_formats()) {
+        if (f.fourcc == format_.fourcc && f.width == format_.width && f.height == format_.height)
+            formats_.push_back(f);
+    }
+    if (formats_.empty())
+        formats_.push_back(format_);
+    format_.default_frame_interval = source_->frame_interval();
+    // 生产线程在填的、最新的、订阅者还在发的上一帧；更多订阅者持有旧帧时池临时多分配
+    pool_ = VideoFramePool::create(max_frame_size_, 3);
+}
+
+VideoBroadcaster::~VideoBroadcaster() {
+    stop_producer();
+}
+
+std::unique_ptr<BroadcastVideoSource> VideoBroadcaster::subscribe() {
+    std::unique_ptr<BroadcastVideoSource> subscriber(new BroadcastVideoSource(shared_from_this()));
+    std::lock_guard lock(mutex_);
+    subscribers_.push_back(subscriber.get());
+    SPDLOG_DEBUG("视频广播: 新订阅者，共 {} 个", subscribers_.size());
+    return subscriber;
+}
+
+std::size_t VideoBroadcaster::subscriber_count() const {
+    std::lock_guard lock(mutex_);
+    return subscribers_.size();
+}
+
+VideoBroadcaster::Stats VideoBroadcaster::stats() const {
+    std::lock_guard lock(mutex_);
+    return {produced_, source_errors_};
+}
+
+void VideoBroadcaster::stop_producer() {
+    std::thread producer;
+    {
+        std::lock_guard lock(mutex_);
+        if (!producer_.joinable())
+            return;
+        stop_ = true;
+        producer = std::move(producer_);
+    }
+    cv_.notify_all();
+    producer.join();
+}
+
+std::uint32_t VideoBroadcaster::active_interval_locked(std::chrono::steady_clock::time_point now) const {
+    std::uint32_t interval = 0;
+    for (auto *subscriber: subscribers_) {
+        if (options_.idle_timeout.count() > 0 && now - subscriber->last_request_ > options_.idle_timeout)
+            continue;
+        if (interval == 0 || subscriber->frame_interval_ < interval)
+            interval = subscriber->frame_interval_;
+    }
+    return interval;
+}
+
+bool VideoBroadcaster::capture(VideoFrame &frame) {
+    if (!source_->get_frame(frame))
+        return false;
+    if (frame.owner || frame.size == 0)
+        return true;
+    // 订阅者各自发完才放手，data 必须活到那时：拷进池化缓冲（每帧一次，与订阅者数无关）
+    if (pool_->buffer_size() < frame.size)
+        pool_->set_buffer_size(frame.size);
+    auto buffer = pool_->acquire();
+    std::memcpy(buffer->data(), frame.data, frame.size);
+    buffer->set_size(frame.size);
+    frame = make_video_frame(std::move(buffer), frame.is_keyframe);
+    return true;
+}
+
+void VideoBroadcaster::producer_loop() {
+    auto next = std::chrono::steady_clock::now();
+    bool failing = false;
+    std::unique_lock lock(mutex_);
+    while (!stop_) {
+        auto interval_100ns = active_interval_locked(std::chrono::steady_clock::now());
+        if (interval_100ns == 0 && options_.idle_timeout.count() > 0) {
+            // 没有订阅者在播：放掉缓冲挂起，等下一次 get_frame
+            parked_ = true;
+            latest_ = {};
+            for (auto *subscriber: subscribers_)
+                subscriber->front_ = {};
+            SPDLOG_DEBUG("视频广播: 没有订阅者在播，生产线程挂起");
+            cv_.wait(lock, [this] { return stop_ || !parked_; });
+            next = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (interval_100ns == 0)
+            interval_100ns = format_.default_frame_interval;
+        if (cv_.wait_until(lock, next, [this] { return stop_; }))
+            break;
+
+        auto interval = std::chrono::microseconds(interval_100ns / 10); // 100ns → µs
+        lock.unlock();
+        VideoFrame frame{};
+        bool ok = capture(frame);
+        auto now = std::chrono::steady_clock::now();
+        lock.lock();
+
+        bool produced = ok && frame.size > 0;
+        if (produced) {
+            latest_ = std::move(frame);
+            ++generation_;
+            ++produced_;
+            if (failing)
+                SPDLOG_INFO("视频广播: 源恢复出帧");
+            failing = false;
+        }
+        else if (!ok) {
+            ++source_errors_;
+            if (!failing)
+                SPDLOG_WARN("视频广播: 源取帧失败，稍后重试");
+            failing = true;
+        }
+
+        if (!ok)
+            next = now + std::max<std::chrono::steady_clock::duration>(interval, MIN_RETRY_DELAY);
+        else if (!produced)
+            next = now + EMPTY_RETRY_DELAY;
+        else if (!options_.pace)
+            next = now;
+        else
+            // 源跟不上时从现在重新计时，不连发补帧
+            next = std::max(next + interval, now);
+    }
+}
+
+BroadcastVideoSource::BroadcastVideoSource(std::shared_ptr<VideoBroadcaster> broadcaster) :
+    broadcaster_(std::move(broadcaster)), frame_interval_(broadcaster_->format_.default_frame_interval) {
+}
+
+BroadcastVideoSource::~BroadcastVideoSource() {
+    std::lock_guard lock(broadcaster_->mutex_);
+    auto &subscribers = broadcaster_->subscribers_;
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), this), subscribers.end());
+}
+
+std::vector<VideoFormatInfo> BroadcastVideoSource::supported_formats() const {
+    return broadcaster_->formats_;
+}
+
+VideoFormatInfo BroadcastVideoSource::current_format() const {
+    auto current = broadcaster_->format_;
+    std::lock_guard lock(broadcaster_->mutex_);
+    current.default_frame_interval = frame_interval_;
+    return current;
+}
+
+bool BroadcastVideoSource::set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                                      std::uint32_t frame_interval) {
+    const auto &format = broadcaster_->format_;
+    if (fourcc != format.fourcc || width != format.width || height != format.height)
+        return false;
+    std::lock_guard lock(broadcaster_->mutex_);
+    if (frame_interval != 0)
+        frame_interval_ = frame_interval;
+    return true;
+}
+
+std::size_t BroadcastVideoSource::max_frame_size() const {
+    return broadcaster_->max_frame_size_;
+}
+
+std::uint32_t BroadcastVideoSource::frame_interval() const {
+    std::lock_guard lock(broadcaster_->mutex_);
+    return frame_interval_;
+}
+
+bool BroadcastVideoSource::get_frame(VideoFrame &frame) {
+    auto &b = *broadcaster_;
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(b.mutex_);
+    // 刚开流（或停流后重新开流）时中间没取的帧不算丢
+    bool resumed = generation_ == 0 ||
+                   (b.options_.idle_timeout.count() > 0 && now - last_request_ > b.options_.idle_timeout);
+    last_request_ = now;
+    if (!b.producer_.joinable() && !b.stop_) {
+        b.parked_ = false;
+        b.producer_ = std::thread([&b] { b.producer_loop(); });
+    }
+    else if (b.parked_) {
+        b.parked_ = false;
+        b.cv_.notify_all();
+    }
+
+    if (b.latest_.size > 0 && b.generation_ > generation_) {
+        if (!resumed)
+            dropped_ += b.generation_ - generation_ - 1;
+        generation_ = b.generation_;
+        front_ = b.latest_;
+        ++delivered_;
+        frame = front_;
+        return true;
+    }
+    if (front_.owner && b.options_.underrun == FrameUnderrunPolicy::Repeat) {
+        ++repeated_;
+        frame = front_;
+        return true;
+    }
+    ++skipped_;
+    frame = {nullptr, 0, false, nullptr};
+    return true;
+}
+
+BroadcastVideoSource::Stats BroadcastVideoSource::stats() const {
+    std::lock_guard lock(broadcaster_->mutex_);
+    return {delivered_, dropped_, repeated_, skipped_};
+}
+
+} // namespace usbipdcpp
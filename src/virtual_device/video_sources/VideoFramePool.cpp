@@ -0,0 +1,93 @@
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
+
+#include <algorithm>
+
+namespace usbipdcpp {
+
+// ============== VideoFrameBuffer ==============
+
+VideoFrameBuffer::VideoFrameBuffer(std::size_t capacity) :
+    storage_(std::make_unique_for_overwrite<std::uint8_t[]>(std::max<std::size_t>(capacity, 1))),
+    capacity_(capacity) {
+}
+
+void VideoFrameBuffer::set_size(std::size_t size) {
+    size_ = std::min(size, capacity_);
+}
+
+VideoFrame make_video_frame(std::shared_ptr<const VideoFrameBuffer> buffer, bool is_keyframe) {
+    VideoFrame frame{};
+    frame.data = buffer->data();
+    frame.size = buffer->size();
+    frame.is_keyframe = is_keyframe;
+    frame.owner = std::move(buffer);
+    return frame;
+}
+
+// ============== VideoFramePool ==============
+
+std::shared_ptr<VideoFramePool> VideoFramePool::create(std::size_t buffer_size, std::size_t max_idle) {
+    return std::shared_ptr<VideoFramePool>(new VideoFramePool(buffer_size, max_idle));
+}
+
+VideoFramePool::VideoFramePool(std::size_t buffer_size, std::size_t max_idle) :
+    buffer_size_(buffer_size), max_idle_(max_idle) {
+}
+
+std::shared_ptr<VideoFrameBuffer> VideoFramePool::acquire() {
+    std::unique_ptr<VideoFrameBuffer> buffer;
+    {
+        std::lock_guard lock(mutex_);
+        if (!idle_.empty()) {
+            buffer = std::move(idle_.back());
+            idle_.pop_back();
+            ++reuses_;
+        }
+        else {
+            ++allocations_;
+        }
+        ++in_use_;
+    }
+    if (!buffer)
+        buffer = std::make_unique<VideoFrameBuffer>(buffer_size());
+    buffer->set_size(0);
+    // 最后一个引用释放时归还；池已销毁则直接释放
+    std::weak_ptr<VideoFramePool> weak = weak_from_this();
+    return std::shared_ptr<VideoFrameBuffer>(buffer.release(), [weak](VideoFrameBuffer *b) {
+        if (auto pool = weak.lock())
+            pool->release(b);
+        else
+            delete b;
+    });
+}
+
+void VideoFramePool::release(VideoFrameBuffer *buffer) {
+    std::unique_ptr<VideoFrameBuffer> owned(buffer);
+    {
+        std::lock_guard lock(mutex_);
+        --in_use_;
+        if (owned->capacity() >= buffer_size_ && idle_.size() < max_idle_)
+            idle_.push_back(std::move(owned));
+    }
+    // 不再保留的缓冲（旧尺寸或空闲已满）在锁外释放
+}
+
+void VideoFramePool::set_buffer_size(std::size_t buffer_size) {
+    std::lock_guard lock(mutex_);
+    if (buffer_size == buffer_size_)
+        return;
+    buffer_size_ = buffer_size;
+    idle_.clear();
+}
+
+std::size_t VideoFramePool::buffer_size() const {
+    std::lock_guard lock(mutex_);
+    return buffer_size_;
+}
+
+VideoFramePool::Stats VideoFramePool::stats() const {
+    std::lock_guard lock(mutex_);
+    return {allocations_, reuses_, in_use_, idle_.size()};
+}
+
+} // namespace usbipdcpp
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "usbipdcpp/Device.h"
+#include "usbipdcpp/utils/StringPool.h"
+#include "usbipdcpp/virtual_device/SimpleVirtualDeviceHandler.h"
+#include "usbipdcpp/virtual_device/devices/MscBulkOnlyHandler.h"
+
+namespace usbipdcpp {
+namespace test {
+
+/**
+ * 构造一个 MSC Bulk-Only 虚拟设备，接口布局与 examples/mock_msc 相同：Bulk IN 0x81 / Bulk OUT 0x02。
+ * string_pool 须比返回的设备活得久（handler 保存其引用）
+ */
+inline std::shared_ptr<UsbDevice> make_msc_device(StringPool &string_pool, std::vector<MscLun> luns) {
+    std::vector<UsbInterface> interfaces = {UsbInterface{
+            .interface_class = 0x08,
+            .interface_subclass = 0x06,
+            .interface_protocol = 0x50,
+            .endpoints = {{UsbEndpoint{.address = 0x81, .attributes = 0x02, .max_packet_size = 512, .interval = 0},
+                           UsbEndpoint{.address = 0x02, .attributes = 0x02, .max_packet_size = 512, .interval = 0}}}}};
+    interfaces[0].with_handler<MscBulkOnlyHandler>(string_pool, std::move(luns));
+
+    auto device = std::make_shared<UsbDevice>(UsbDevice{
+            .path = "/test/mock_msc",
+            .busid = "1-1",
+            .bus_num = 1,
+            .dev_num = 1,
+            .speed = static_cast<std::uint32_t>(UsbSpeed::High),
+            .vendor_id = 0x1234,
+            .product_id = 0x5681,
+            .device_bcd = 0x0100,
+            .device_class = 0x00,
+            .device_subclass = 0x00,
+            .device_protocol = 0x00,
+            .configuration_value = 1,
+            .num_configurations = 1,
+            .interfaces = interfaces,
+            .ep0_in = UsbEndpoint::get_ep0_in(UsbSpeed::High),
+            .ep0_out = UsbEndpoint::get_ep0_out(UsbSpeed::High),
+    });
+    auto device_handler = device->with_handler<SimpleVirtualDeviceHandler>(string_pool);
+    device_handler->setup_interface_handlers();
+    return device;
+}
+
+} // namespace test
+} // namespace usbipdcpp
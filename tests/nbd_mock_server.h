@@ -0,0 +1,478 @@
+#pragma once
+
+#include <asio.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "usbipdcpp/virtual_device/storage_backends/NbdProtocol.h"
+
+namespace usbipdcpp {
+namespace test {
+
+/**
+ * 内存 NBD 服务器（相当于 nbdkit memory 插件），供 NbdBackend 的测试和基准使用。
+ *
+ * 每个请求收到后按 latency + [0, jitter) 的随机延迟排期回复，排期在收到时就确定，
+ * 因此多个在途请求的延迟可以重叠（模拟远端存储的并行度），jitter 非 0 时回复乱序。
+ * 结构化 READ 回复按 read_chunk 分块、逆序发送，全零块用 hole 表示。
+ */
+class NbdMockServer {
+public:
+    struct Options {
+        std::uint64_t size = 16 * 1024 * 1024;
+        std::string export_name;
+        std::chrono::microseconds latency{0};
+        std::chrono::microseconds jitter{0};
+        bool structured = true; // 接受 NBD_OPT_STRUCTURED_REPLY
+        bool support_go = true; // false 时对 NBD_OPT_GO 回 ERR_UNSUP，模拟只支持 EXPORT_NAME 的老服务器
+        bool read_only = false;
+        std::uint32_t max_block = 0; // NBD_INFO_BLOCK_SIZE 的最大负载，0 = 不回此信息
+        std::uint32_t read_chunk = 64 * 1024;
+    };
+
+    explicit NbdMockServer(Options options) : options_(std::move(options)), data_(options_.size, 0) {
+    }
+
+    ~NbdMockServer() {
+        stop();
+    }
+
+    /** 在 127.0.0.1 随机端口监听，返回 nbd:// URI */
+    std::string listen_tcp() {
+        tcp_acceptor_ = std::make_unique<asio::ip::tcp::acceptor>(
+                io_, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+        accept_tcp();
+        start_io();
+        return "nbd://127.0.0.1:" + std::to_string(tcp_acceptor_->local_endpoint().port()) + "/" +
+               options_.export_name;
+    }
+
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+    /** 在 unix socket 上监听，返回 nbd+unix URI */
+    std::string listen_unix(const std::string &path) {
+        std::remove(path.c_str());
+        unix_acceptor_ = std::make_unique<asio::local::stream_protocol::acceptor>(
+                io_, asio::local::stream_protocol::endpoint(path));
+        accept_unix();
+        start_io();
+        return "nbd+unix:///" + options_.export_name + "?socket=" + path;
+    }
+#endif
+
+    void stop() {
+        if (io_thread_.joinable()) {
+            asio::post(io_, [this] {
+                asio::error_code ec;
+                if (tcp_acceptor_)
+                    tcp_acceptor_->close(ec);
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+                if (unix_acceptor_)
+                    unix_acceptor_->close(ec);
+#endif
+            });
+            io_.stop();
+            io_thread_.join();
+        }
+        std::lock_guard lock(conns_mutex_);
+        for (auto &conn: conns_)
+            conn->close();
+        conns_.clear();
+    }
+
+    void write_data(std::uint64_t offset, const void *src, std::size_t len) {
+        std::lock_guard lock(data_mutex_);
+        std::memcpy(data_.data() + offset, src, len);
+    }
+
+    std::vector<std::uint8_t> read_data(std::uint64_t offset, std::size_t len) {
+        std::lock_guard lock(data_mutex_);
+        return {data_.begin() + offset, data_.begin() + offset + len};
+    }
+
+    /** 之后的 n 个 READ 返回 EIO */
+    void fail_next_reads(int n) {
+        fail_reads_ = n;
+    }
+
+    /** 观察到的最大同时在途请求数 */
+    std::size_t max_in_flight() const {
+        return max_in_flight_;
+    }
+
+    std::uint64_t request_count(std::uint16_t type) const {
+        return type < counts_.size() ? counts_[type].load() : 0;
+    }
+
+private:
+    struct Request {
+        std::chrono::steady_clock::time_point due;
+        std::uint64_t seq;
+        std::uint16_t type;
+        std::uint64_t cookie;
+        std::uint64_t offset;
+        std::uint32_t length;
+        std::vector<std::uint8_t> payload;
+
+        bool operator>(const Request &other) const {
+            return due != other.due ? due > other.due : seq > other.seq;
+        }
+    };
+
+    struct Connection {
+        NbdMockServer &server;
+        asio::generic::stream_protocol::socket sock;
+        std::thread reader;
+        std::thread replier;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::priority_queue<Request, std::vector<Request>, std::greater<>> queue;
+        bool closing = false;
+        bool structured = false;
+        std::mt19937_64 rng{42};
+        std::uint64_t seq = 0;
+
+        Connection(NbdMockServer &s, asio::generic::stream_protocol::socket socket) :
+            server(s), sock(std::move(socket)) {
+        }
+
+        void start() {
+            replier = std::thread([this] { reply_loop(); });
+            reader = std::thread([this] {
+                if (handshake())
+                    read_loop();
+                std::lock_guard lock(mutex);
+                closing = true;
+                cv.notify_all();
+            });
+        }
+
+        void close() {
+            asio::error_code ec;
+            sock.shutdown(asio::socket_base::shutdown_both, ec);
+            if (reader.joinable())
+                reader.join();
+            if (replier.joinable())
+                replier.join();
+            sock.close(ec);
+        }
+
+        bool read_exact(void *p, std::size_t n) {
+            asio::error_code ec;
+            asio::read(sock, asio::buffer(p, n), ec);
+            return !ec;
+        }
+
+        bool write_all(const std::vector<std::uint8_t> &buf) {
+            asio::error_code ec;
+            asio::write(sock, asio::buffer(buf), ec);
+            return !ec;
+        }
+
+        bool option_reply(std::uint32_t option, std::uint32_t type, const std::vector<std::uint8_t> &data = {}) {
+            std::vector<std::uint8_t> msg(20 + data.size());
+            nbd::put_be64(&msg[0], nbd::OPTION_REPLY_MAGIC);
+            nbd::put_be32(&msg[8], option);
+            nbd::put_be32(&msg[12], type);
+            nbd::put_be32(&msg[16], static_cast<std::uint32_t>(data.size()));
+            std::copy(data.begin(), data.end(), msg.begin() + 20);
+            return write_all(msg);
+        }
+
+        std::uint16_t transmission_flags() const {
+            const auto &o = server.options_;
+            return nbd::FLAG_HAS_FLAGS | nbd::FLAG_SEND_FLUSH | nbd::FLAG_SEND_TRIM | nbd::FLAG_SEND_CACHE |
+                   (o.read_only ? nbd::FLAG_READ_ONLY : 0);
+        }
+
+        bool handshake() {
+            std::vector<std::uint8_t> hello(18);
+            nbd::put_be64(&hello[0], nbd::NBDMAGIC);
+            nbd::put_be64(&hello[8], nbd::IHAVEOPT);
+            nbd::put_be16(&hello[16], nbd::FLAG_FIXED_NEWSTYLE | nbd::FLAG_NO_ZEROES);
+            std::array<std::uint8_t, 4> client_flags{};
+            if (!write_all(hello) || !read_exact(client_flags.data(), 4))
+                return false;
+            bool no_zeroes = nbd::get_be32(client_flags.data()) & nbd::FLAG_C_NO_ZEROES;
+
+            const auto &o = server.options_;
+            while (true) {
+                std::array<std::uint8_t, 16> head{};
+                if (!read_exact(head.data(), head.size()) || nbd::get_be64(&head[0]) != nbd::IHAVEOPT)
+                    return false;
+                auto option = nbd::get_be32(&head[8]);
+                std::vector<std::uint8_t> data(nbd::get_be32(&head[12]));
+                if (!data.empty() && !read_exact(data.data(), data.size()))
+                    return false;
+
+                if (option == nbd::Opt::StructuredReply) {
+                    structured = o.structured;
+                    if (!option_reply(option, o.structured ? nbd::Rep::Ack : nbd::Rep::ErrUnsup))
+                        return false;
+                }
+                else if (option == nbd::Opt::Go && o.support_go) {
+                    auto name_len = data.size() >= 4 ? nbd::get_be32(&data[0]) : 0;
+                    std::string name(data.begin() + 4, data.begin() + 4 + std::min<std::size_t>(name_len, data.size() - 4));
+                    if (name != o.export_name) {
+                        std::string msg = "no such export";
+                        if (!option_reply(option, nbd::Rep::ErrUnknown, {msg.begin(), msg.end()}))
+                            return false;
+                        continue;
+                    }
+                    std::vector<std::uint8_t> info(12);
+                    nbd::put_be16(&info[0], nbd::Info::Export);
+                    nbd::put_be64(&info[2], o.size);
+                    nbd::put_be16(&info[10], transmission_flags());
+                    if (!option_reply(option, nbd::Rep::Info, info))
+                        return false;
+                    if (o.max_block != 0) {
+                        std::vector<std::uint8_t> bs(14);
+                        nbd::put_be16(&bs[0], nbd::Info::BlockSize);
+                        nbd::put_be32(&bs[2], 512);
+                        nbd::put_be32(&bs[6], 4096);
+                        nbd::put_be32(&bs[10], o.max_block);
+                        if (!option_reply(option, nbd::Rep::Info, bs))
+                            return false;
+                    }
+                    return option_reply(option, nbd::Rep::Ack);
+                }
+                else if (option == nbd::Opt::ExportName) {
+                    if (std::string(data.begin(), data.end()) != o.export_name)
+                        return false; // 协议规定 EXPORT_NAME 失败直接断开
+                    std::vector<std::uint8_t> reply(no_zeroes ? 10 : 134, 0);
+                    nbd::put_be64(&reply[0], o.size);
+                    nbd::put_be16(&reply[8], transmission_flags());
+                    return write_all(reply);
+                }
+                else if (option == nbd::Opt::Abort) {
+                    option_reply(option, nbd::Rep::Ack);
+                    return false;
+                }
+                else if (!option_reply(option, nbd::Rep::ErrUnsup)) {
+                    return false;
+                }
+            }
+        }
+
+        void read_loop() {
+            const auto &o = server.options_;
+            std::array<std::uint8_t, nbd::REQUEST_HEADER_SIZE> head{};
+            while (read_exact(head.data(), head.size())) {
+                if (nbd::get_be32(&head[0]) != nbd::REQUEST_MAGIC)
+                    return;
+                Request req{};
+                req.type = nbd::get_be16(&head[6]);
+                req.cookie = nbd::get_be64(&head[8]);
+                req.offset = nbd::get_be64(&head[16]);
+                req.length = nbd::get_be32(&head[24]);
+                if (req.type == nbd::Cmd::Disc)
+                    return;
+                if (req.type == nbd::Cmd::Write) {
+                    req.payload.resize(req.length);
+                    if (!read_exact(req.payload.data(), req.length))
+                        return;
+                }
+                if (req.type < server.counts_.size())
+                    ++server.counts_[req.type];
+
+                auto delay = o.latency;
+                if (o.jitter.count() > 0)
+                    delay += std::chrono::microseconds(rng() % o.jitter.count());
+                req.due = std::chrono::steady_clock::now() + delay;
+                std::lock_guard lock(mutex);
+                req.seq = seq++;
+                queue.push(std::move(req));
+                auto in_flight = ++server.in_flight_;
+                auto prev = server.max_in_flight_.load();
+                while (in_flight > prev && !server.max_in_flight_.compare_exchange_weak(prev, in_flight)) {
+                }
+                cv.notify_all();
+            }
+        }
+
+        void reply_loop() {
+            std::unique_lock lock(mutex);
+            while (true) {
+                // 连接关闭时丢弃尚未到期的请求
+                if (closing)
+                    return;
+                if (queue.empty()) {
+                    cv.wait(lock);
+                    continue;
+                }
+                auto due = queue.top().due;
+                if (std::chrono::steady_clock::now() < due) {
+                    cv.wait_until(lock, due);
+                    continue;
+                }
+                auto req = std::move(const_cast<Request &>(queue.top()));
+                queue.pop();
+                lock.unlock();
+                // 回复发出前就减计数：客户端收到回复后立刻补发的请求不应被算作超额在途
+                --server.in_flight_;
+                bool ok = serve(req);
+                lock.lock();
+                if (!ok)
+                    return;
+            }
+        }
+
+        bool simple_reply(std::uint64_t cookie, std::uint32_t error, const std::uint8_t *data = nullptr,
+                          std::size_t len = 0) {
+            std::vector<std::uint8_t> msg(nbd::SIMPLE_REPLY_SIZE + len);
+            nbd::put_be32(&msg[0], nbd::SIMPLE_REPLY_MAGIC);
+            nbd::put_be32(&msg[4], error);
+            nbd::put_be64(&msg[8], cookie);
+            if (len > 0)
+                std::memcpy(&msg[16], data, len);
+            return write_all(msg);
+        }
+
+        bool chunk_reply(std::uint64_t cookie, std::uint16_t flags, std::uint16_t type,
+                         const std::vector<std::uint8_t> &payload) {
+            std::vector<std::uint8_t> msg(nbd::STRUCTURED_REPLY_SIZE + payload.size());
+            nbd::put_be32(&msg[0], nbd::STRUCTURED_REPLY_MAGIC);
+            nbd::put_be16(&msg[4], flags);
+            nbd::put_be16(&msg[6], type);
+            nbd::put_be64(&msg[8], cookie);
+            nbd::put_be32(&msg[16], static_cast<std::uint32_t>(payload.size()));
+            std::copy(payload.begin(), payload.end(), msg.begin() + nbd::STRUCTURED_REPLY_SIZE);
+            return write_all(msg);
+        }
+
+        bool serve(const Request &req) {
+            const auto &o = server.options_;
+            bool in_range = req.offset + req.length <= o.size;
+            switch (req.type) {
+                case nbd::Cmd::Read: {
+                    std::uint32_t error = !in_range ? nbd::Err::Inval : 0;
+                    if (error == 0 && server.fail_reads_.load() > 0 && server.fail_reads_.fetch_sub(1) > 0)
+                        error = nbd::Err::Io;
+                    if (error != 0) {
+                        if (!structured)
+                            return simple_reply(req.cookie, error);
+                        std::vector<std::uint8_t> err(6, 0);
+                        nbd::put_be32(&err[0], error);
+                        return chunk_reply(req.cookie, nbd::REPLY_FLAG_DONE, nbd::ReplyType::Error, err);
+                    }
+                    std::vector<std::uint8_t> data;
+                    {
+                        std::lock_guard lock(server.data_mutex_);
+                        data.assign(server.data_.begin() + req.offset,
+                                    server.data_.begin() + req.offset + req.length);
+                    }
+                    if (!structured)
+                        return simple_reply(req.cookie, 0, data.data(), data.size());
+                    if (req.length == 0)
+                        return chunk_reply(req.cookie, nbd::REPLY_FLAG_DONE, nbd::ReplyType::None, {});
+                    // 分块逆序发送，最后发出的块带 DONE
+                    std::uint32_t chunk = std::max<std::uint32_t>(o.read_chunk, 1);
+                    std::uint32_t pieces = (req.length + chunk - 1) / chunk;
+                    for (std::uint32_t i = pieces; i-- > 0;) {
+                        auto begin = i * chunk;
+                        auto len = std::min(chunk, req.length - begin);
+                        auto flags = i == 0 ? nbd::REPLY_FLAG_DONE : 0;
+                        bool zero = std::all_of(data.begin() + begin, data.begin() + begin + len,
+                                                [](std::uint8_t b) { return b == 0; });
+                        std::vector<std::uint8_t> payload(zero ? 12 : 8 + len);
+                        nbd::put_be64(&payload[0], req.offset + begin);
+                        if (zero)
+                            nbd::put_be32(&payload[8], len);
+                        else
+                            std::memcpy(&payload[8], data.data() + begin, len);
+                        if (!chunk_reply(req.cookie, flags,
+                                         zero ? nbd::ReplyType::OffsetHole : nbd::ReplyType::OffsetData, payload))
+                            return false;
+                    }
+                    return true;
+                }
+                case nbd::Cmd::Write:
+                    if (o.read_only)
+                        return simple_reply(req.cookie, nbd::Err::Perm);
+                    if (!in_range)
+                        return simple_reply(req.cookie, nbd::Err::NoSpc);
+                    server.write_data(req.offset, req.payload.data(), req.length);
+                    return simple_reply(req.cookie, 0);
+                case nbd::Cmd::Trim:
+                    if (in_range) {
+                        std::lock_guard lock(server.data_mutex_);
+                        std::memset(server.data_.data() + req.offset, 0, req.length);
+                    }
+                    return simple_reply(req.cookie, in_range ? 0 : nbd::Err::Inval);
+                case nbd::Cmd::Flush:
+                case nbd::Cmd::Cache:
+                    return simple_reply(req.cookie, 0);
+                default:
+                    return simple_reply(req.cookie, nbd::Err::Inval);
+            }
+        }
+    };
+
+    void start_io() {
+        if (!io_thread_.joinable())
+            io_thread_ = std::thread([this] { io_.run(); });
+    }
+
+    void add_connection(asio::generic::stream_protocol::socket sock) {
+        auto conn = std::make_unique<Connection>(*this, std::move(sock));
+        conn->start();
+        std::lock_guard lock(conns_mutex_);
+        conns_.push_back(std::move(conn));
+    }
+
+    void accept_tcp() {
+        tcp_acceptor_->async_accept([this](asio::error_code ec, asio::ip::tcp::socket sock) {
+            if (ec)
+                return;
+            sock.set_option(asio::ip::tcp::no_delay(true), ec);
+            add_connection(asio::generic::stream_protocol::socket(std::move(sock)));
+            accept_tcp();
+        });
+    }
+
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+    void accept_unix() {
+        unix_acceptor_->async_accept([this](asio::error_code ec, asio::local::stream_protocol::socket sock) {
+            if (ec)
+                return;
+            add_connection(asio::generic::stream_protocol::socket(std::move(sock)));
+            accept_unix();
+        });
+    }
+#endif
+
+    Options options_;
+    std::mutex data_mutex_;
+    std::vector<std::uint8_t> data_;
+
+    asio::io_context io_;
+    std::thread io_thread_;
+    std::unique_ptr<asio::ip::tcp::acceptor> tcp_acceptor_;
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+    std::unique_ptr<asio::local::stream_protocol::acceptor> unix_acceptor_;
+#endif
+    std::mutex conns_mutex_;
+    std::list<std::unique_ptr<Connection>> conns_;
+
+    std::atomic<int> fail_reads_{0};
+    std::atomic<std::size_t> in_flight_{0};
+    std::atomic<std::size_t> max_in_flight_{0};
+    std::array<std::atomic<std::uint64_t>, 6> counts_{};
+};
+
+} // namespace test
+} // namespace usbipdcpp
@@ -0,0 +1,742 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "msc_test_device.h"
+#include "test_utils.h"
+#include "usbip_test_client.h"
+
+#include "usbipdcpp/Server.h"
+#include "usbipdcpp/utils/StringPool.h"
+#include "usbipdcpp/virtual_device/devices/MscBulkOnlyHandler.h"
+#include "usbipdcpp/virtual_device/storage_backends/AsyncDiscardBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/CachedBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/CompressedImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/MemoryBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/RawImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/SharedImageBackend.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::test;
+
+namespace {
+
+MscLun memory_lun(std::uint64_t blocks, std::string product, bool read_only = false) {
+    MscConfig config;
+    config.product = std::move(product);
+    return MscLun{std::make_unique<MemoryBackend>(blocks), std::move(config), read_only};
+}
+
+std::uint32_t read_capacity_blocks(BotTestClient &bot, std::uint8_t lun) {
+    std::vector<std::uint8_t> cdb(10, 0);
+    cdb[0] = ScsiCmd::ReadCapacity10;
+    auto r = bot.command(lun, cdb, 8);
+    EXPECT_EQ(r.csw.bCSWStatus, 0);
+    if (r.data.size() < 8)
+        return 0;
+    return get_be32(r.data.data()) + 1;
+}
+
+/**
+ * 不提供 get_direct_buffer、改为借出写入段的内存后端：每次 WRITE 借出两段不对齐块的缓冲，
+ * 提交时走默认 commit_segments（writev）写回，模拟 NBD / io_uring 注册缓冲一类后端
+ */
+class SegmentLendingBackend : public MemoryBackend {
+public:
+    using MemoryBackend::MemoryBackend;
+
+    void *get_direct_buffer(std::uint64_t) override {
+        return nullptr;
+    }
+
+    bool write_segments(std::uint64_t lba, std::uint16_t count, StorageSegments &out) override {
+        auto total = static_cast<std::size_t>(count) * block_size();
+        auto buf = std::make_shared<std::vector<std::uint8_t>>(total);
+        auto first = std::min<std::size_t>(total, 700);
+        out.segments = {{buf->data(), first}};
+        if (total > first)
+            out.segments.push_back({buf->data() + first, total - first});
+        out.keepalive = std::move(buf);
+        ++lent;
+        return true;
+    }
+
+    int lent = 0;
+};
+
+/// 每次 punch_hole 固定耗时 DELAY，模拟大镜像上的 fallocate(PUNCH_HOLE)
+class SlowPunchBackend : public MemoryBackend {
+public:
+    static constexpr auto DELAY = std::chrono::milliseconds(300);
+
+    using MemoryBackend::MemoryBackend;
+
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override {
+        std::this_thread::sleep_for(DELAY);
+        MemoryBackend::punch_hole(lba, count);
+    }
+};
+
+/// BAD_LBA 所在的读失败（坏扇区），不提供映射区，VERIFY 只能经 read 读介质
+class BadSectorBackend : public MemoryBackend {
+public:
+    static constexpr std::uint64_t BAD_LBA = 50;
+
+    using MemoryBackend::MemoryBackend;
+
+    void *get_direct_buffer(std::uint64_t) override {
+        return nullptr;
+    }
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override {
+        if (lba <= BAD_LBA && BAD_LBA < lba + count)
+            return 0;
+        return MemoryBackend::read(lba, count, buffer);
+    }
+};
+
+/** UNMAP 参数列表：8 字节头 + 一个块描述符 */
+std::vector<std::uint8_t> unmap_parameters(std::uint64_t lba, std::uint32_t count) {
+    std::vector<std::uint8_t> data(24, 0);
+    put_be16(data.data(), 22);
+    put_be16(data.data() + 2, 16);
+    put_be64(data.data() + 8, lba);
+    put_be32(data.data() + 16, count);
+    return data;
+}
+
+class MscHandlerTest : public ::testing::Test {
+protected:
+    void start(std::vector<MscLun> luns) {
+        device_ = server_.add_device(make_msc_device(string_pool_, std::move(luns)));
+        ASSERT_FALSE(server_.start(ep_));
+        ASSERT_TRUE(connect_with_retry(client_.socket(), ep_));
+        ASSERT_TRUE(client_.import("1-1"));
+    }
+
+    void TearDown() override {
+        client_.socket().close();
+        wait_sessions_gone(server_);
+        server_.stop();
+        if (!scratch_.empty()) {
+            std::error_code ec;
+            std::filesystem::remove_all(scratch_, ec);
+        }
+    }
+
+    std::filesystem::path scratch_dir() {
+        scratch_ = std::filesystem::temp_directory_path() / "usbipdcpp_test_msc_handler";
+        std::filesystem::remove_all(scratch_);
+        std::filesystem::create_directories(scratch_);
+        return scratch_;
+    }
+
+    MscBulkOnlyHandler &msc() {
+        return *std::dynamic_pointer_cast<MscBulkOnlyHandler>(device_->interfaces[0].handler);
+    }
+
+    asio::io_context io_;
+    asio::ip::tcp::endpoint ep_{asio::ip::address_v4::loopback(), 0};
+    // string_pool 必须先于 server 声明（后于 server 析构），handler 保存其引用
+    StringPool string_pool_;
+    Server server_;
+    std::shared_ptr<UsbDevice> device_;
+    std::filesystem::path scratch_;
+    UsbIpTestClient client_{io_};
+    BotTestClient bot_{client_};
+};
+
+} // namespace
+
+TEST_F(MscHandlerTest, SingleLunReportsMaxLunZero) {
+    std::vector<MscLun> luns;
+    luns.push_back(memory_lun(2048, "Single"));
+    start(std::move(luns));
+
+    auto reply = client_.control(0xA1, BotRequest::GetMaxLun, 0, 0, 1);
+    EXPECT_EQ(reply.status, 0u);
+    ASSERT_EQ(reply.data.size(), 1u);
+    EXPECT_EQ(reply.data[0], 0);
+}
+
+TEST_F(MscHandlerTest, GetMaxLunAndPerLunInquiry) {
+    std::vector<MscLun> luns;
+    luns.push_back(memory_lun(2048, "Disk Zero"));
+    luns.push_back(memory_lun(4096, "Disk One"));
+    luns.push_back(memory_lun(8192, "Disk Two", true));
+    start(std::move(luns));
+
+    auto reply = client_.control(0xA1, BotRequest::GetMaxLun, 0, 0, 1);
+    ASSERT_EQ(reply.data.size(), 1u);
+    EXPECT_EQ(reply.data[0], 2);
+
+    const char *names[] = {"Disk Zero", "Disk One", "Disk Two"};
+    for (std::uint8_t lun = 0; lun < 3; ++lun) {
+        std::vector<std::uint8_t> cdb = {ScsiCmd::Inquiry, 0, 0, 0, 36, 0};
+        auto r = bot_.command(lun, cdb, 36);
+        EXPECT_EQ(r.csw.bCSWStatus, 0);
+        ASSERT_EQ(r.data.size(), 36u);
+        std::string product(reinterpret_cast<const char *>(&r.data[16]), 16);
+        EXPECT_EQ(product.substr(0, std::strlen(names[lun])), names[lun]);
+    }
+    EXPECT_EQ(read_capacity_blocks(bot_, 0), 2048u);
+    EXPECT_EQ(read_capacity_blocks(bot_, 1), 4096u);
+    EXPECT_EQ(read_capacity_blocks(bot_, 2), 8192u);
+}
+
+TEST_F(MscHandlerTest, InterleavedWritesStayOnTheirLun) {
+    std::vector<MscLun> luns;
+    luns.push_back(memory_lun(2048, "A"));
+    luns.push_back(memory_lun(2048, "B"));
+    start(std::move(luns));
+
+    // 两个 LUN 的相同 LBA 交替写入不同内容
+    for (std::uint32_t lba = 0; lba < 64; lba += 8) {
+        for (std::uint8_t lun = 0; lun < 2; ++lun) {
+            std::vector<std::uint8_t> data(8 * 512, static_cast<std::uint8_t>(0x10 * (lun + 1) + lba / 8));
+            auto r = bot_.command(lun, BotTestClient::write10(lba, 8), 0, data);
+            ASSERT_EQ(r.csw.bCSWStatus, 0) << "lun " << int(lun) << " lba " << lba;
+        }
+    }
+    // 交替读回，每个 LUN 只看到自己的数据
+    for (std::uint32_t lba = 0; lba < 64; lba += 8) {
+        for (std::uint8_t lun = 0; lun < 2; ++lun) {
+            auto r = bot_.command(lun, BotTestClient::read10(lba, 8), 8 * 512);
+            ASSERT_EQ(r.csw.bCSWStatus, 0);
+            ASSERT_EQ(r.data.size(), 8u * 512);
+            auto expect = static_cast<std::uint8_t>(0x10 * (lun + 1) + lba / 8);
+            EXPECT_TRUE(std::all_of(r.data.begin(), r.data.end(), [&](std::uint8_t b) { return b == expect; }))
+                    << "lun " << int(lun) << " lba " << lba;
+        }
+    }
+}
+
+TEST_F(MscHandlerTest, InterleavedZeroCopyLunsUseOwnBackend) {
+    // RawImageBackend 走 splice / sendfile 零拷贝路径，后端需随 transfer 记录
+    auto dir = scratch_dir();
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::make_unique<RawImageBackend>((dir / "a.img").string(), 2048), {}, false});
+    luns.push_back(memory_lun(2048, "Memory"));
+    luns.push_back(MscLun{std::make_unique<RawImageBackend>((dir / "b.img").string(), 2048), {}, false});
+    start(std::move(luns));
+
+    for (int round = 0; round < 4; ++round) {
+        for (std::uint8_t lun = 0; lun < 3; ++lun) {
+            std::vector<std::uint8_t> data(128 * 512, static_cast<std::uint8_t>(lun * 16 + round));
+            auto r = bot_.command(lun, BotTestClient::write10(round * 128, 128), 0, data, 16 * 1024);
+            ASSERT_EQ(r.csw.bCSWStatus, 0);
+        }
+    }
+    for (int round = 0; round < 4; ++round) {
+        for (std::uint8_t lun = 0; lun < 3; ++lun) {
+            auto r = bot_.command(lun, BotTestClient::read10(round * 128, 128), 128 * 512, {}, 16 * 1024);
+            ASSERT_EQ(r.csw.bCSWStatus, 0);
+            ASSERT_EQ(r.data.size(), 128u * 512);
+            auto expect = static_cast<std::uint8_t>(lun * 16 + round);
+            EXPECT_TRUE(std::all_of(r.data.begin(), r.data.end(), [&](std::uint8_t b) { return b == expect; }))
+                    << "lun " << int(lun) << " round " << round;
+        }
+    }
+}
+
+TEST_F(MscHandlerTest, ReadOnlyIsPerLun) {
+    std::vector<MscLun> luns;
+    luns.push_back(memory_lun(2048, "RW"));
+    luns.push_back(memory_lun(2048, "RO", true));
+    start(std::move(luns));
+
+    std::vector<std::uint8_t> data(512, 0xEE);
+    EXPECT_EQ(bot_.command(0, BotTestClient::write10(0, 1), 0, data).csw.bCSWStatus, 0);
+    EXPECT_EQ(bot_.command(1, BotTestClient::write10(0, 1), 0, data).csw.bCSWStatus, 1);
+    // 失败命令后其他 LUN 照常工作
+    auto r = bot_.command(0, BotTestClient::read10(0, 1), 512);
+    EXPECT_EQ(r.csw.bCSWStatus, 0);
+    EXPECT_EQ(r.data, data);
+}
+
+TEST_F(MscHandlerTest, NonexistentLunReportsNotSupported) {
+    std::vector<MscLun> luns;
+    luns.push_back(memory_lun(2048, "Only"));
+    luns.push_back(memory_lun(2048, "Second"));
+    start(std::move(luns));
+
+    // TEST UNIT READY 失败
+    std::vector<std::uint8_t> tur(6, 0);
+    EXPECT_EQ(bot_.command(5, tur).csw.bCSWStatus, 1);
+
+    // INQUIRY：外设限定符 011b / 类型 1Fh
+    std::vector<std::uint8_t> inquiry = {ScsiCmd::Inquiry, 0, 0, 0, 36, 0};
+    auto r = bot_.command(5, inquiry, 36);
+    EXPECT_EQ(r.csw.bCSWStatus, 0);
+    ASSERT_FALSE(r.data.empty());
+    EXPECT_EQ(r.data[0], 0x7F);
+
+    // REQUEST SENSE：ILLEGAL REQUEST / LOGICAL UNIT NOT SUPPORTED
+    std::vector<std::uint8_t> sense_cdb = {ScsiCmd::RequestSense, 0, 0, 0, 18, 0};
+    r = bot_.command(5, sense_cdb, 18);
+    ASSERT_EQ(r.data.size(), 18u);
+    EXPECT_EQ(r.data[2], SenseKey::IllegalRequest);
+    EXPECT_EQ(r.data[12], Asc::LogicalUnitNotSupported);
+
+    // 存在的 LUN 不受影响
+    EXPECT_EQ(bot_.command(1, tur).csw.bCSWStatus, 0);
+}
+
+TEST_F(MscHandlerTest, BulkOnlyResetReturnsToIdle) {
+    std::vector<MscLun> luns;
+    luns.push_back(memory_lun(2048, "Reset"));
+    start(std::move(luns));
+
+    // 发出 WRITE 的 CBW 后不送数据直接复位，下一条命令应正常执行
+    CBW cbw{};
+    cbw.dCBWSignature = CBW_SIGNATURE;
+    cbw.dCBWTag = 0x1000;
+    cbw.dCBWDataTransferLength = 512;
+    cbw.bCBWCBLength = 10;
+    auto cdb = BotTestClient::write10(0, 1);
+    std::memcpy(cbw.CBWCB, cdb.data(), cdb.size());
+    std::vector<std::uint8_t> raw(sizeof(CBW));
+    std::memcpy(raw.data(), &cbw, sizeof(CBW));
+    client_.submit(2, false, sizeof(CBW), raw);
+
+    auto reply = client_.control(0x21, BotRequest::Reset, 0, 0, 0);
+    EXPECT_EQ(reply.status, 0u);
+
+    std::vector<std::uint8_t> tur(6, 0);
+    auto r = bot_.command(0, tur);
+    EXPECT_EQ(r.csw.dCSWSignature, CSW_SIGNATURE);
+    EXPECT_EQ(r.csw.bCSWStatus, 0);
+}
+
+TEST_F(MscHandlerTest, ReadFromLentSegmentsSkipsStaging) {
+    auto dir = scratch_dir();
+    std::vector<std::uint8_t> image(1024 * 512);
+    for (std::size_t i = 0; i < image.size(); ++i)
+        image[i] = static_cast<std::uint8_t>(i * 7 + i / 512);
+    {
+        RawImageBackend raw((dir / "raw.img").string(), image.size() / 512);
+        ASSERT_EQ(raw.write(0, 1024, image.data()), image.size());
+    }
+    ASSERT_TRUE(CompressedImageBackend::convert_raw_image((dir / "raw.img").string(), (dir / "image.cimg").string(),
+                                                          ChunkCodec::None, 64 * 1024));
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::make_unique<CompressedImageBackend>((dir / "image.cimg").string()), MscConfig{},
+                          false});
+    start(std::move(luns));
+
+    // 跨 chunk 边界的 64 KiB READ：直接从解压缓存发送，没有 staging 拷贝
+    constexpr std::uint32_t lba = 64;
+    constexpr std::uint16_t count = 128;
+    auto before = msc().staged_bytes();
+    auto r = bot_.command(0, BotTestClient::read10(lba, count), count * 512u, {}, 16 * 1024);
+    ASSERT_EQ(r.csw.bCSWStatus, 0);
+    EXPECT_TRUE(std::equal(r.data.begin(), r.data.end(), image.begin() + lba * 512));
+    EXPECT_EQ(msc().staged_bytes() - before, 0u);
+
+    // 范围内有覆盖层的块后回退 staging：整条 READ 拷贝一次
+    std::vector<std::uint8_t> block(512, 0xC3);
+    ASSERT_EQ(bot_.command(0, BotTestClient::write10(lba + 5, 1), 0, block).csw.bCSWStatus, 0);
+    std::copy(block.begin(), block.end(), image.begin() + (lba + 5) * 512);
+    before = msc().staged_bytes();
+    r = bot_.command(0, BotTestClient::read10(lba, count), count * 512u, {}, 16 * 1024);
+    ASSERT_EQ(r.csw.bCSWStatus, 0);
+    EXPECT_TRUE(std::equal(r.data.begin(), r.data.end(), image.begin() + lba * 512));
+    EXPECT_EQ(msc().staged_bytes() - before, count * 512u);
+}
+
+TEST_F(MscHandlerTest, WriteIntoLentSegments) {
+    auto backend = std::make_unique<SegmentLendingBackend>(4096);
+    auto *lender = backend.get();
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::move(backend), MscConfig{}, false});
+    start(std::move(luns));
+
+    // URB 边界（16 KiB）与借出段边界（700 字节）互不对齐
+    std::vector<std::uint8_t> data(96 * 512);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<std::uint8_t>(i * 13 + 1);
+    auto before = msc().staged_bytes();
+    ASSERT_EQ(bot_.command(0, BotTestClient::write10(300, 96), 0, data, 16 * 1024).csw.bCSWStatus, 0);
+    EXPECT_EQ(lender->lent, 1);
+    EXPECT_EQ(msc().staged_bytes() - before, 0u);
+
+    auto r = bot_.command(0, BotTestClient::read10(300, 96), 96 * 512);
+    ASSERT_EQ(r.csw.bCSWStatus, 0);
+    EXPECT_EQ(r.data, data);
+}
+
+#ifdef __linux__
+TEST_F(MscHandlerTest, RawImageZeroCopyStats) {
+    auto dir = scratch_dir();
+    auto backend = std::make_unique<RawImageBackend>((dir / "disk.img").string(), 4096);
+    auto *raw = backend.get();
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::move(backend), MscConfig{}, false});
+    start(std::move(luns));
+
+    // URB 长度不是块的整数倍：零拷贝路径按字节偏移接续
+    std::vector<std::uint8_t> data(64 * 512);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<std::uint8_t>(i * 5 + 3);
+    for (int round = 0; round < 3; ++round) {
+        ASSERT_EQ(bot_.command(0, BotTestClient::write10(100, 64), 0, data, 10000).csw.bCSWStatus, 0);
+        auto r = bot_.command(0, BotTestClient::read10(100, 64), 64 * 512, {}, 10000);
+        ASSERT_EQ(r.csw.bCSWStatus, 0);
+        EXPECT_EQ(r.data, data);
+    }
+
+    // READ 走 sendfile；WRITE 默认不 splice，直接读进映射区，计为回退
+    auto stats = msc().zero_copy_stats();
+    EXPECT_EQ(stats.direct_send_bytes, 3u * data.size());
+    EXPECT_EQ(stats.fallback_sends, 0u);
+    EXPECT_EQ(stats.direct_recvs, 0u);
+    EXPECT_EQ(stats.fallback_recv_bytes, 3u * data.size());
+    EXPECT_EQ(stats.errors, 0u);
+
+    // 打开 splice 接收后 WRITE 也走零拷贝
+    raw->set_splice_receive(true);
+    std::reverse(data.begin(), data.end());
+    ASSERT_EQ(bot_.command(0, BotTestClient::write10(100, 64), 0, data, 10000).csw.bCSWStatus, 0);
+    auto r = bot_.command(0, BotTestClient::read10(100, 64), 64 * 512);
+    EXPECT_EQ(r.data, data);
+    stats = msc().zero_copy_stats();
+    EXPECT_EQ(stats.direct_recv_bytes, data.size());
+    EXPECT_EQ(stats.errors, 0u);
+    // sender 线程和接收线程各一个，传输之间复用
+    EXPECT_LE(stats.pipes_created, 2u);
+    EXPECT_EQ(msc().staged_bytes(), 0u);
+}
+#endif
+
+TEST_F(MscHandlerTest, AsyncDiscardAcknowledgesUnmapEarly) {
+    // LUN 0 同步打洞，LUN 1 经 AsyncDiscardBackend 排队
+    auto image = std::vector<std::uint8_t>(64 * 512, 0xA5);
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::make_unique<SlowPunchBackend>(4096), MscConfig{}, false});
+    luns.push_back(MscLun{std::make_unique<AsyncDiscardBackend>(std::make_unique<SlowPunchBackend>(4096)), MscConfig{},
+                          false});
+    start(std::move(luns));
+
+    std::vector<std::uint8_t> cdb(10, 0);
+    cdb[0] = ScsiCmd::Unmap;
+    put_be16(cdb.data() + 7, 24);
+    auto unmap_latency = [&](std::uint8_t lun) {
+        EXPECT_EQ(bot_.command(lun, BotTestClient::write10(100, 64), 0, image).csw.bCSWStatus, 0);
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_EQ(bot_.command(lun, cdb, 0, unmap_parameters(100, 64)).csw.bCSWStatus, 0);
+        return std::chrono::steady_clock::now() - start;
+    };
+    auto sync_latency = unmap_latency(0);
+    auto async_latency = unmap_latency(1);
+    EXPECT_GE(sync_latency, SlowPunchBackend::DELAY);
+    EXPECT_LT(async_latency, SlowPunchBackend::DELAY / 3);
+
+    // 打洞尚未执行，READ 已经看到全零
+    auto *async = dynamic_cast<AsyncDiscardBackend *>(msc().get_backend(1));
+    ASSERT_NE(async, nullptr);
+    EXPECT_GT(async->pending_blocks(), 0u);
+    auto r = bot_.command(1, BotTestClient::read10(100, 64), 64 * 512);
+    ASSERT_EQ(r.csw.bCSWStatus, 0);
+    EXPECT_TRUE(std::all_of(r.data.begin(), r.data.end(), [](std::uint8_t b) { return b == 0; }));
+
+    // SYNCHRONIZE CACHE 等后台打洞完成才回 CSW
+    std::vector<std::uint8_t> sync_cdb(10, 0);
+    sync_cdb[0] = ScsiCmd::SynchronizeCache;
+    ASSERT_EQ(bot_.command(1, sync_cdb).csw.bCSWStatus, 0);
+    EXPECT_EQ(async->pending_blocks(), 0u);
+    EXPECT_EQ(async->discard_stats().applied_blocks, 64u);
+}
+
+TEST(MscStats, HistogramBucketsAndPercentiles) {
+    LatencyHistogram h;
+    using namespace std::chrono;
+    h.record(nanoseconds(500)); // 桶 0
+    for (int i = 0; i < 98; ++i)
+        h.record(microseconds(100)); // [64, 128) us
+    h.record(seconds(10)); // 溢出桶
+    auto s = h.snapshot();
+    EXPECT_EQ(s.count, 100u);
+    EXPECT_EQ(s.buckets[0], 1u);
+    EXPECT_EQ(s.buckets[7], 98u);
+    EXPECT_EQ(s.buckets[LatencyHistogram::BUCKETS - 1], 1u);
+    EXPECT_EQ(s.max_ns, 10'000'000'000u);
+    EXPECT_DOUBLE_EQ(s.percentile_us(50), 128.0);
+    EXPECT_DOUBLE_EQ(s.percentile_us(99.5), 10'000'000.0);
+
+    MscStats stats;
+    stats.record_command(ScsiCmd::Read10, false, 4096, 0);
+    stats.record_command(0xC0, true, 0, 0); // 未单独统计的操作码
+    auto all = stats.snapshot();
+    ASSERT_EQ(all.size(), 2u);
+    EXPECT_EQ(all[0].opcode, ScsiCmd::Read10);
+    EXPECT_EQ(all[1].opcode, MscStats::OTHER_OPCODE);
+    EXPECT_EQ(all[1].failed, 1u);
+    EXPECT_STREQ(MscStats::opcode_name(ScsiCmd::Read10), "READ(10)");
+}
+
+TEST_F(MscHandlerTest, StatsPerOpcodeAndPhase) {
+    std::vector<MscLun> luns;
+    luns.push_back(memory_lun(4096, "Stats"));
+    luns.push_back(MscLun{std::make_unique<SegmentLendingBackend>(4096), MscConfig{}, false});
+    start(std::move(luns));
+    msc().stats().reset();
+
+    std::vector<std::uint8_t> data(32 * 512, 0x3C);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(bot_.command(0, BotTestClient::write10(10, 32), 0, data).csw.bCSWStatus, 0);
+        ASSERT_EQ(bot_.command(0, BotTestClient::read10(10, 32), 32 * 512).csw.bCSWStatus, 0);
+    }
+    ASSERT_EQ(bot_.command(1, BotTestClient::write10(10, 32), 0, data).csw.bCSWStatus, 0);
+    ASSERT_EQ(bot_.command(1, BotTestClient::read10(10, 32), 32 * 512).csw.bCSWStatus, 0);
+    // 越界 READ 解析时即失败，不进数据阶段
+    EXPECT_EQ(bot_.command(0, BotTestClient::read10(5000, 1)).csw.bCSWStatus, 1);
+
+    auto &stats = msc().stats();
+    auto read = stats.snapshot(ScsiCmd::Read10);
+    EXPECT_EQ(read.commands, 6u);
+    EXPECT_EQ(read.failed, 1u);
+    EXPECT_EQ(read.bytes_in, 5u * data.size());
+    // 内存盘走映射区，借段后端不借读段，READ 回退 staging
+    EXPECT_EQ(read.paths[static_cast<std::size_t>(MscDataPath::Direct)], 4u);
+    EXPECT_EQ(read.paths[static_cast<std::size_t>(MscDataPath::Staged)], 1u);
+    EXPECT_EQ(read.phase(MscPhase::CbwParse).count, 6u);
+    EXPECT_EQ(read.phase(MscPhase::DataTransfer).count, 5u);
+    EXPECT_EQ(read.phase(MscPhase::Csw).count, 6u);
+    EXPECT_EQ(read.phase(MscPhase::Total).count, 6u);
+    EXPECT_EQ(read.phase(MscPhase::BackendIo).count, 1u); // 只有 staging 回退调了 read()
+
+    auto write = stats.snapshot(ScsiCmd::Write10);
+    EXPECT_EQ(write.commands, 5u);
+    EXPECT_EQ(write.bytes_out, 5u * data.size());
+    EXPECT_EQ(write.paths[static_cast<std::size_t>(MscDataPath::Direct)], 4u);
+    EXPECT_EQ(write.paths[static_cast<std::size_t>(MscDataPath::Segments)], 1u);
+    EXPECT_EQ(write.phase(MscPhase::BackendIo).count, 5u);
+    // 各阶段之和不超过总耗时
+    for (const auto &op: {read, write}) {
+        auto parts = op.phase(MscPhase::CbwParse).total_ns + op.phase(MscPhase::BackendIo).total_ns +
+                     op.phase(MscPhase::DataTransfer).total_ns + op.phase(MscPhase::Csw).total_ns;
+        EXPECT_LE(parts, op.phase(MscPhase::Total).total_ns + 1000);
+    }
+
+    auto all = stats.snapshot();
+    ASSERT_EQ(all.size(), 2u);
+    EXPECT_EQ(all[0].opcode, ScsiCmd::Read10);
+    EXPECT_EQ(all[1].opcode, ScsiCmd::Write10);
+}
+
+TEST_F(MscHandlerTest, CdRomLunServesMmcCommands) {
+    auto path = (scratch_dir() / "disc.iso").string();
+    std::vector<std::uint8_t> image(300 * 2048);
+    for (std::size_t i = 0; i < image.size(); ++i)
+        image[i] = static_cast<std::uint8_t>(i / 2048 + i * 7);
+    {
+        std::ofstream f(path, std::ios::binary);
+        f.write(reinterpret_cast<const char *>(image.data()), static_cast<std::streamsize>(image.size()));
+    }
+    MscConfig cd;
+    cd.device_type = MscDeviceType::CdRom;
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::make_unique<SharedImageBackend>(path), cd, false});
+    luns.push_back(memory_lun(2048, "Disk"));
+    start(std::move(luns));
+
+    std::vector<std::uint8_t> inquiry = {ScsiCmd::Inquiry, 0, 0, 0, 36, 0};
+    auto r = bot_.command(0, inquiry, 36);
+    ASSERT_EQ(r.data.size(), 36u);
+    EXPECT_EQ(r.data[0], 0x05);
+    EXPECT_EQ(bot_.command(1, inquiry, 36).data[0], 0x00);
+
+    std::vector<std::uint8_t> cap_cdb(10, 0);
+    cap_cdb[0] = ScsiCmd::ReadCapacity10;
+    r = bot_.command(0, cap_cdb, 8);
+    ASSERT_EQ(r.data.size(), 8u);
+    EXPECT_EQ(get_be32(r.data.data()), 299u);
+    EXPECT_EQ(get_be32(r.data.data() + 4), 2048u);
+
+    // READ TOC 格式 0：轨道 1 在 LBA 0，引出区在介质末尾；MSF 含 150 帧偏移
+    std::vector<std::uint8_t> toc_cdb(10, 0);
+    toc_cdb[0] = ScsiCmd::ReadToc;
+    put_be16(toc_cdb.data() + 7, 20);
+    r = bot_.command(0, toc_cdb, 20);
+    ASSERT_EQ(r.csw.bCSWStatus, 0);
+    ASSERT_EQ(r.data.size(), 20u);
+    EXPECT_EQ(get_be16(r.data.data()), 18u);
+    EXPECT_EQ(r.data[5], 0x14);
+    EXPECT_EQ(r.data[6], 1);
+    EXPECT_EQ(get_be32(r.data.data() + 8), 0u);
+    EXPECT_EQ(r.data[14], 0xAA);
+    EXPECT_EQ(get_be32(r.data.data() + 16), 300u);
+    toc_cdb[1] = 0x02;
+    r = bot_.command(0, toc_cdb, 20);
+    ASSERT_EQ(r.data.size(), 20u);
+    EXPECT_EQ(r.data[17], 0); // 450 帧 = 0 分 6 秒 0 帧
+    EXPECT_EQ(r.data[18], 6);
+    EXPECT_EQ(r.data[19], 0);
+
+    // GET CONFIGURATION：当前 profile 为 CD-ROM；RT=2 只返回请求的特性
+    std::vector<std::uint8_t> config_cdb(10, 0);
+    config_cdb[0] = ScsiCmd::GetConfiguration;
+    config_cdb[1] = 0x02;
+    put_be16(config_cdb.data() + 2, 0x0010);
+    put_be16(config_cdb.data() + 7, 20);
+    r = bot_.command(0, config_cdb, 20);
+    ASSERT_EQ(r.csw.bCSWStatus, 0);
+    ASSERT_EQ(r.data.size(), 20u);
+    EXPECT_EQ(get_be32(r.data.data()), 16u);
+    EXPECT_EQ(get_be16(r.data.data() + 6), 0x0008);
+    EXPECT_EQ(get_be16(r.data.data() + 8), 0x0010);
+    EXPECT_EQ(get_be32(r.data.data() + 12), 2048u);
+
+    // GET EVENT STATUS NOTIFICATION：轮询介质类，介质在位
+    std::vector<std::uint8_t> gesn_cdb(10, 0);
+    gesn_cdb[0] = ScsiCmd::GetEventStatusNotification;
+    gesn_cdb[1] = 0x01;
+    gesn_cdb[4] = 0x10;
+    put_be16(gesn_cdb.data() + 7, 8);
+    r = bot_.command(0, gesn_cdb, 8);
+    ASSERT_EQ(r.data.size(), 8u);
+    EXPECT_EQ(r.data[2], 0x04);
+    EXPECT_EQ(r.data[5], 0x02);
+
+    // READ(12) 与 READ(10) 读到同样的镜像内容
+    std::vector<std::uint8_t> read12(12, 0);
+    read12[0] = ScsiCmd::Read12;
+    put_be32(read12.data() + 2, 37);
+    put_be32(read12.data() + 6, 5);
+    r = bot_.command(0, read12, 5 * 2048);
+    ASSERT_EQ(r.csw.bCSWStatus, 0);
+    EXPECT_TRUE(std::equal(r.data.begin(), r.data.end(), image.begin() + 37 * 2048));
+    EXPECT_EQ(r.data.size(), 5u * 2048);
+    r = bot_.command(0, BotTestClient::read10(37, 5), 5 * 2048);
+    EXPECT_TRUE(std::equal(r.data.begin(), r.data.end(), image.begin() + 37 * 2048));
+
+    // 光驱只读；MMC 命令对磁盘 LUN 不开放；GESN 不支持异步模式
+    std::vector<std::uint8_t> data(2048, 0xEE);
+    EXPECT_EQ(bot_.command(0, BotTestClient::write10(0, 1), 0, data).csw.bCSWStatus, 1);
+    EXPECT_EQ(bot_.command(1, toc_cdb).csw.bCSWStatus, 1);
+    gesn_cdb[1] = 0;
+    EXPECT_EQ(bot_.command(0, gesn_cdb).csw.bCSWStatus, 1);
+    r = bot_.command(0, BotTestClient::read10(0, 1), 2048);
+    EXPECT_TRUE(std::equal(r.data.begin(), r.data.end(), image.begin()));
+}
+
+TEST_F(MscHandlerTest, DecoratedReadOnlyBackendStaysWriteProtected) {
+    // 只读后端包在装饰器里，LUN 仍须写保护：否则 WRITE 会经 get_direct_buffer 写进只读映射
+    auto path = (scratch_dir() / "ro.img").string();
+    std::vector<std::uint8_t> image(64 * 512, 0x5A);
+    {
+        std::ofstream f(path, std::ios::binary);
+        f.write(reinterpret_cast<const char *>(image.data()), static_cast<std::streamsize>(image.size()));
+    }
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::make_unique<CachedBackend>(std::make_unique<SharedImageBackend>(path, 512)), {}, false});
+    luns.push_back(
+            MscLun{std::make_unique<AsyncDiscardBackend>(std::make_unique<SharedImageBackend>(path, 512)), {}, false});
+    start(std::move(luns));
+
+    std::vector<std::uint8_t> mode_sense = {ScsiCmd::ModeSense6, 0, 0x3F, 0, 4, 0};
+    std::vector<std::uint8_t> sense_cdb = {ScsiCmd::RequestSense, 0, 0, 0, 18, 0};
+    std::vector<std::uint8_t> data(512, 0xEE);
+    for (std::uint8_t lun = 0; lun < 2; ++lun) {
+        auto r = bot_.command(lun, mode_sense, 4);
+        ASSERT_EQ(r.data.size(), 4u);
+        EXPECT_EQ(r.data[2] & 0x80, 0x80) << "lun " << int(lun);
+
+        EXPECT_EQ(bot_.command(lun, BotTestClient::write10(0, 1), 0, data).csw.bCSWStatus, 1) << "lun " << int(lun);
+        r = bot_.command(lun, sense_cdb, 18);
+        ASSERT_EQ(r.data.size(), 18u);
+        EXPECT_EQ(r.data[2], SenseKey::DataProtect) << "lun " << int(lun);
+        EXPECT_EQ(r.data[12], Asc::WriteProtected) << "lun " << int(lun);
+        // 感测数据读出后清零
+        EXPECT_EQ(bot_.command(lun, sense_cdb, 18).data[2], 0);
+
+        r = bot_.command(lun, BotTestClient::read10(0, 1), 512);
+        ASSERT_EQ(r.csw.bCSWStatus, 0);
+        EXPECT_TRUE(std::all_of(r.data.begin(), r.data.end(), [](std::uint8_t b) { return b == 0x5A; }));
+    }
+}
+
+TEST_F(MscHandlerTest, VerifyComparesDataOutWithMedium) {
+    std::vector<MscLun> luns;
+    luns.push_back(memory_lun(256, "Disk"));
+    start(std::move(luns));
+
+    std::vector<std::uint8_t> data(8 * 512);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<std::uint8_t>(i * 13 + 1);
+    ASSERT_EQ(bot_.command(0, BotTestClient::write10(40, 8), 0, data).csw.bCSWStatus, 0);
+
+    // BYTCHK=1：逐字节比较 count 块；分片发送也要在收满后才比较
+    std::vector<std::uint8_t> verify(10, 0);
+    verify[0] = ScsiCmd::Verify10;
+    verify[1] = 0x02;
+    put_be32(verify.data() + 2, 40);
+    put_be16(verify.data() + 7, 8);
+    EXPECT_EQ(bot_.command(0, verify, 0, data, 1000).csw.bCSWStatus, 0);
+    auto bad = data;
+    bad[5 * 512 + 100] ^= 0xFF;
+    EXPECT_EQ(bot_.command(0, verify, 0, bad).csw.bCSWStatus, 1);
+    std::vector<std::uint8_t> sense_cdb = {ScsiCmd::RequestSense, 0, 0, 0, 18, 0};
+    auto sense = bot_.command(0, sense_cdb, 18);
+    ASSERT_EQ(sense.data.size(), 18u);
+    EXPECT_EQ(sense.data[2], SenseKey::Miscompare);
+    EXPECT_EQ(sense.data[12], Asc::MiscompareDuringVerify);
+
+    // BYTCHK=3：1 块数据与范围内每一块比较
+    std::vector<std::uint8_t> pattern(512, 0xC3);
+    std::vector<std::uint8_t> filled(4 * 512, 0xC3);
+    ASSERT_EQ(bot_.command(0, BotTestClient::write10(100, 4), 0, filled).csw.bCSWStatus, 0);
+    verify[1] = 0x06;
+    put_be32(verify.data() + 2, 100);
+    put_be16(verify.data() + 7, 4);
+    EXPECT_EQ(bot_.command(0, verify, 0, pattern).csw.bCSWStatus, 0);
+    put_be16(verify.data() + 7, 5); // 第 104 块仍是 0
+    EXPECT_EQ(bot_.command(0, verify, 0, pattern).csw.bCSWStatus, 1);
+
+    // BYTCHK=0 只校验可读；BYTCHK=2 保留值拒绝
+    verify[1] = 0x00;
+    EXPECT_EQ(bot_.command(0, verify).csw.bCSWStatus, 0);
+    verify[1] = 0x04;
+    EXPECT_EQ(bot_.command(0, verify).csw.bCSWStatus, 1);
+
+    // 失败后不残留 DATA-OUT 状态，普通读写照常
+    auto r = bot_.command(0, BotTestClient::read10(40, 8), 8 * 512);
+    EXPECT_EQ(r.csw.bCSWStatus, 0);
+    EXPECT_EQ(r.data, data);
+}
+
+TEST_F(MscHandlerTest, VerifyReadFailureReportsMediumError) {
+    std::vector<MscLun> luns;
+    luns.push_back(MscLun{std::make_unique<BadSectorBackend>(256), {}, false});
+    start(std::move(luns));
+
+    std::vector<std::uint8_t> data(4 * 512, 0x3C);
+    ASSERT_EQ(bot_.command(0, BotTestClient::write10(48, 4), 0, data).csw.bCSWStatus, 0);
+
+    // 读不出介质不是数据不一致：MEDIUM ERROR / UNRECOVERED READ ERROR，而不是 MISCOMPARE
+    std::vector<std::uint8_t> verify(10, 0);
+    verify[0] = ScsiCmd::Verify10;
+    verify[1] = 0x02;
+    put_be32(verify.data() + 2, 48);
+    put_be16(verify.data() + 7, 4);
+    EXPECT_EQ(bot_.command(0, verify, 0, data).csw.bCSWStatus, 1);
+    std::vector<std::uint8_t> sense_cdb = {ScsiCmd::RequestSense, 0, 0, 0, 18, 0};
+    auto sense = bot_.command(0, sense_cdb, 18);
+    ASSERT_EQ(sense.data.size(), 18u);
+    EXPECT_EQ(sense.data[2], SenseKey::MediumError);
+    EXPECT_EQ(sense.data[12], Asc::UnrecoveredReadError);
+
+    // 坏扇区之外的范围照常比较
+    put_be32(verify.data() + 2, 52);
+    EXPECT_EQ(bot_.command(0, verify, 0, std::vector<std::uint8_t>(4 * 512, 0)).csw.bCSWStatus, 0);
+    EXPECT_EQ(bot_.command(0, sense_cdb, 18).data[2], SenseKey::NoSense);
+}
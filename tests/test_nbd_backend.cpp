@@ -0,0 +1,304 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nbd_mock_server.h"
+
+#include "usbipdcpp/virtual_device/storage_backends/NbdBackend.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::test;
+
+namespace {
+
+std::vector<std::uint8_t> pattern(std::size_t bytes, std::uint32_t seed) {
+    std::vector<std::uint8_t> data(bytes);
+    std::mt19937 rng(seed);
+    std::ranges::generate(data, [&] { return static_cast<std::uint8_t>(rng()); });
+    return data;
+}
+
+NbdMockServer::Options server_options() {
+    NbdMockServer::Options options;
+    options.size = 8 * 1024 * 1024;
+    options.export_name = "disk";
+    return options;
+}
+
+} // namespace
+
+TEST(NbdBackend, ParsesUris) {
+    NbdAddress a;
+    ASSERT_TRUE(NbdBackend::parse_uri("nbd://storage.local/vm1", a));
+    EXPECT_EQ(a.host, "storage.local");
+    EXPECT_EQ(a.port, nbd::DEFAULT_PORT);
+    EXPECT_EQ(a.export_name, "vm1");
+
+    ASSERT_TRUE(NbdBackend::parse_uri("nbd://10.0.0.2:10900", a));
+    EXPECT_EQ(a.host, "10.0.0.2");
+    EXPECT_EQ(a.port, 10900);
+    EXPECT_EQ(a.export_name, "");
+
+    ASSERT_TRUE(NbdBackend::parse_uri("nbd://[::1]:10810/e", a));
+    EXPECT_EQ(a.host, "::1");
+    EXPECT_EQ(a.port, 10810);
+    EXPECT_EQ(a.export_name, "e");
+
+    ASSERT_TRUE(NbdBackend::parse_uri("nbd+unix:///exp?socket=/run/nbd.sock", a));
+    EXPECT_TRUE(a.host.empty());
+    EXPECT_EQ(a.socket_path, "/run/nbd.sock");
+    EXPECT_EQ(a.export_name, "exp");
+
+    EXPECT_FALSE(NbdBackend::parse_uri("http://host/x", a));
+    EXPECT_FALSE(NbdBackend::parse_uri("nbd://host:0/x", a));
+    EXPECT_FALSE(NbdBackend::parse_uri("nbd://host:abc/x", a));
+    EXPECT_FALSE(NbdBackend::parse_uri("nbd+unix:///exp", a));
+}
+
+TEST(NbdBackend, ReadWriteRoundTrip) {
+    NbdMockServer server(server_options());
+    NbdBackend backend(server.listen_tcp());
+    ASSERT_TRUE(backend.is_valid());
+    EXPECT_TRUE(backend.structured_replies());
+    EXPECT_EQ(backend.block_count(), 8u * 1024 * 1024 / 512);
+
+    // 1000 块跨越多个 max_request_bytes 分片
+    auto data = pattern(1000 * 512, 1);
+    ASSERT_EQ(backend.write(100, 1000, data.data()), data.size());
+    EXPECT_EQ(server.read_data(100 * 512, data.size()), data);
+
+    std::vector<std::uint8_t> out(data.size());
+    ASSERT_EQ(backend.read(100, 1000, out.data()), out.size());
+    EXPECT_EQ(out, data);
+    EXPECT_GT(server.request_count(nbd::Cmd::Write), 1u);
+}
+
+TEST(NbdBackend, LargeRequestsArePipelined) {
+    auto options = server_options();
+    options.latency = std::chrono::milliseconds(5);
+    NbdMockServer server(options);
+    NbdOptions client;
+    client.max_request_bytes = 64 * 1024;
+    client.max_in_flight = 8;
+    NbdBackend backend(server.listen_tcp(), client);
+    ASSERT_TRUE(backend.is_valid());
+
+    // 1 MiB = 16 个 64 KiB 请求，在途上限 8
+    std::vector<std::uint8_t> out(1024 * 1024);
+    ASSERT_EQ(backend.read(0, 2048, out.data()), out.size());
+    EXPECT_EQ(server.request_count(nbd::Cmd::Read), 16u);
+    EXPECT_EQ(server.max_in_flight(), 8u);
+}
+
+TEST(NbdBackend, OutOfOrderRepliesFromConcurrentCallers) {
+    auto options = server_options();
+    options.latency = std::chrono::microseconds(200);
+    options.jitter = std::chrono::microseconds(2000);
+    options.read_chunk = 4096;
+    NbdMockServer server(options);
+    NbdOptions client;
+    client.max_request_bytes = 16 * 1024;
+    NbdBackend backend(server.listen_tcp(), client);
+    ASSERT_TRUE(backend.is_valid());
+
+    // 每个线程在自己的区域里随机写后读回
+    constexpr int threads = 4;
+    std::vector<std::thread> workers;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            std::uint64_t base = t * 4096;
+            for (int i = 0; i < 20; ++i) {
+                std::uint64_t lba = base + rng() % 4000;
+                std::uint16_t count = 1 + rng() % 96;
+                auto data = pattern(count * 512u, t * 1000 + i);
+                if (backend.write(lba, count, data.data()) != data.size()) {
+                    ++mismatches;
+                    continue;
+                }
+                std::vector<std::uint8_t> out(data.size());
+                if (backend.read(lba, count, out.data()) != out.size() || out != data)
+                    ++mismatches;
+            }
+        });
+    }
+    for (auto &w: workers)
+        w.join();
+    EXPECT_EQ(mismatches.load(), 0);
+    EXPECT_GT(server.max_in_flight(), 1u);
+}
+
+TEST(NbdBackend, HolesReadAsZero) {
+    auto options = server_options();
+    options.read_chunk = 4096;
+    NbdMockServer server(options);
+    auto data = pattern(4096, 7);
+    server.write_data(8192, data.data(), data.size());
+    NbdBackend backend(server.listen_tcp());
+    ASSERT_TRUE(backend.is_valid());
+
+    std::vector<std::uint8_t> out(16384, 0xFF);
+    ASSERT_EQ(backend.read(0, 32, out.data()), out.size());
+    EXPECT_TRUE(std::all_of(out.begin(), out.begin() + 8192, [](std::uint8_t b) { return b == 0; }));
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), out.begin() + 8192));
+    EXPECT_TRUE(std::all_of(out.begin() + 12288, out.end(), [](std::uint8_t b) { return b == 0; }));
+}
+
+TEST(NbdBackend, SimpleRepliesWhenServerLacksStructured) {
+    auto options = server_options();
+    options.structured = false;
+    NbdMockServer server(options);
+    NbdBackend backend(server.listen_tcp());
+    ASSERT_TRUE(backend.is_valid());
+    EXPECT_FALSE(backend.structured_replies());
+
+    auto data = pattern(64 * 512, 3);
+    ASSERT_EQ(backend.write(10, 64, data.data()), data.size());
+    std::vector<std::uint8_t> out(data.size());
+    ASSERT_EQ(backend.read(10, 64, out.data()), out.size());
+    EXPECT_EQ(out, data);
+}
+
+TEST(NbdBackend, FallsBackToExportName) {
+    auto options = server_options();
+    options.support_go = false;
+    NbdMockServer server(options);
+    NbdBackend backend(server.listen_tcp());
+    ASSERT_TRUE(backend.is_valid());
+    EXPECT_EQ(backend.block_count(), options.size / 512);
+}
+
+TEST(NbdBackend, UnknownExportFails) {
+    NbdMockServer server(server_options());
+    auto uri = server.listen_tcp();
+    NbdBackend backend(uri.substr(0, uri.rfind('/')) + "/nope");
+    EXPECT_FALSE(backend.is_valid());
+}
+
+TEST(NbdBackend, ServerBlockSizeLimitsRequests) {
+    auto options = server_options();
+    options.max_block = 32 * 1024;
+    NbdMockServer server(options);
+    NbdOptions client;
+    client.max_request_bytes = 1024 * 1024;
+    NbdBackend backend(server.listen_tcp(), client);
+    ASSERT_TRUE(backend.is_valid());
+    EXPECT_EQ(backend.max_request_bytes(), 32u * 1024);
+
+    std::vector<std::uint8_t> out(256 * 1024);
+    ASSERT_EQ(backend.read(0, 512, out.data()), out.size());
+    EXPECT_EQ(server.request_count(nbd::Cmd::Read), 8u);
+}
+
+TEST(NbdBackend, PunchHoleSendsTrim) {
+    NbdMockServer server(server_options());
+    auto data = pattern(64 * 512, 5);
+    server.write_data(0, data.data(), data.size());
+    NbdBackend backend(server.listen_tcp());
+    ASSERT_TRUE(backend.is_valid());
+    ASSERT_TRUE(backend.can_trim());
+
+    backend.punch_hole(16, 32);
+    EXPECT_EQ(server.request_count(nbd::Cmd::Trim), 1u);
+    auto after = server.read_data(0, data.size());
+    EXPECT_TRUE(std::equal(data.begin(), data.begin() + 16 * 512, after.begin()));
+    EXPECT_TRUE(std::all_of(after.begin() + 16 * 512, after.begin() + 48 * 512, [](std::uint8_t b) { return b == 0; }));
+    EXPECT_TRUE(std::equal(data.begin() + 48 * 512, data.end(), after.begin() + 48 * 512));
+}
+
+TEST(NbdBackend, FlushAndCacheCommands) {
+    NbdMockServer server(server_options());
+    NbdBackend backend(server.listen_tcp());
+    ASSERT_TRUE(backend.is_valid());
+
+    EXPECT_TRUE(backend.flush(0, backend.block_count()));
+    EXPECT_EQ(server.request_count(nbd::Cmd::Flush), 1u);
+
+    backend.prefetch(0, 256);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (server.request_count(nbd::Cmd::Cache) == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(server.request_count(nbd::Cmd::Cache), 1u);
+}
+
+TEST(NbdBackend, ServerErrorFailsOnlyThatRequest) {
+    for (bool structured: {true, false}) {
+        auto options = server_options();
+        options.structured = structured;
+        NbdMockServer server(options);
+        NbdBackend backend(server.listen_tcp());
+        ASSERT_TRUE(backend.is_valid());
+
+        std::vector<std::uint8_t> out(4096);
+        server.fail_next_reads(1);
+        EXPECT_EQ(backend.read(0, 8, out.data()), 0u);
+        EXPECT_TRUE(backend.is_valid());
+        EXPECT_EQ(backend.read(0, 8, out.data()), out.size());
+    }
+}
+
+TEST(NbdBackend, ReadOnlyExportRejectsWrites) {
+    auto options = server_options();
+    options.read_only = true;
+    NbdMockServer server(options);
+    NbdBackend backend(server.listen_tcp());
+    ASSERT_TRUE(backend.is_valid());
+    EXPECT_TRUE(backend.is_read_only());
+
+    std::vector<std::uint8_t> data(512, 0xAA);
+    EXPECT_EQ(backend.write(0, 1, data.data()), 0u);
+    EXPECT_EQ(server.request_count(nbd::Cmd::Write), 0u);
+}
+
+TEST(NbdBackend, OutOfRangeRejected) {
+    NbdMockServer server(server_options());
+    NbdBackend backend(server.listen_tcp());
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> buf(2 * 512);
+    EXPECT_EQ(backend.read(backend.block_count() - 1, 2, buf.data()), 0u);
+    EXPECT_EQ(backend.write(backend.block_count(), 1, buf.data()), 0u);
+}
+
+TEST(NbdBackend, DisconnectFailsPendingAndLaterRequests) {
+    auto options = server_options();
+    options.latency = std::chrono::milliseconds(200);
+    NbdMockServer server(options);
+    NbdBackend backend(server.listen_tcp());
+    ASSERT_TRUE(backend.is_valid());
+
+    std::vector<std::uint8_t> out(4096);
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        server.stop();
+    });
+    EXPECT_EQ(backend.read(0, 8, out.data()), 0u);
+    stopper.join();
+    EXPECT_FALSE(backend.is_valid());
+    EXPECT_EQ(backend.read(0, 8, out.data()), 0u);
+}
+
+#ifdef ASIO_HAS_LOCAL_SOCKETS
+TEST(NbdBackend, UnixSocket) {
+    auto path = (std::filesystem::temp_directory_path() / "usbipdcpp_test_nbd.sock").string();
+    {
+        NbdMockServer server(server_options());
+        NbdBackend backend(server.listen_unix(path));
+        ASSERT_TRUE(backend.is_valid());
+        auto data = pattern(8 * 512, 9);
+        ASSERT_EQ(backend.write(0, 8, data.data()), data.size());
+        std::vector<std::uint8_t> out(data.size());
+        ASSERT_EQ(backend.read(0, 8, out.data()), out.size());
+        EXPECT_EQ(out, data);
+    }
+    std::filesystem::remove(path);
+}
+#endif
@@ -0,0 +1,1677 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "usbipdcpp/virtual_device/storage_backends/AsyncDiscardBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/CachedBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/CompressedImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/DedupBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/MemoryBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/RawImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/ReadaheadDetector.h"
+#include "usbipdcpp/virtual_device/storage_backends/ScrubBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/SharedImageBackend.h"
+#include "usbipdcpp/virtual_device/storage_backends/SplicePipePool.h"
+#include "usbipdcpp/virtual_device/storage_backends/WriteDurability.h"
+
+using namespace usbipdcpp;
+
+namespace {
+
+/// 每个测试独立的临时目录，析构时删除
+class TempDir {
+public:
+    TempDir() {
+        auto *info = ::testing::UnitTest::GetInstance()->current_test_info();
+        auto name = std::string("usbipdcpp_") + info->test_suite_name() + "_" + info->name();
+        // 参数化测试名含 '/'
+        std::replace(name.begin(), name.end(), '/', '_');
+        path_ = std::filesystem::temp_directory_path() / name;
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+    }
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+    std::string file(const std::string &name) const {
+        return (path_ / name).string();
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+/// 生成可压缩的测试镜像：文本样式重复数据 + 全零段 + 随机（不可压缩）段
+std::vector<std::uint8_t> make_image(std::size_t size) {
+    std::vector<std::uint8_t> data(size);
+    std::mt19937 rng(1234);
+    for (std::size_t i = 0; i < size; ++i) {
+        auto region = (i / 65536) % 4;
+        if (region == 0)
+            data[i] = static_cast<std::uint8_t>("usbipdcpp compressed image "[i % 27]);
+        else if (region == 1)
+            data[i] = 0;
+        else if (region == 2)
+            data[i] = static_cast<std::uint8_t>(rng());
+        else
+            data[i] = static_cast<std::uint8_t>(i / 512);
+    }
+    return data;
+}
+
+void write_file(const std::string &path, const std::vector<std::uint8_t> &data) {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+/// 对每种已编译的编解码器跑一遍
+class CompressedImageBackendTest : public ::testing::TestWithParam<ChunkCodec> {
+protected:
+    void SetUp() override {
+        if (!CompressedImageBackend::codec_supported(GetParam())) {
+            GTEST_SKIP() << "codec not compiled in";
+        }
+        image_ = make_image(1024 * 1024 + 8 * 512); // 尾部不满一个 chunk
+        write_file(dir_.file("raw.img"), image_);
+        ASSERT_TRUE(CompressedImageBackend::convert_raw_image(dir_.file("raw.img"), dir_.file("image.cimg"),
+                                                              GetParam(), 64 * 1024));
+    }
+
+    CompressedImageOptions options(std::size_t threads = 4) const {
+        CompressedImageOptions opt;
+        opt.cache_bytes = 256 * 1024;
+        opt.cache_shards = 4;
+        opt.decompress_threads = threads;
+        return opt;
+    }
+
+    TempDir dir_;
+    std::vector<std::uint8_t> image_;
+};
+
+} // namespace
+
+// ============== CompressedImageBackend ==============
+
+TEST_P(CompressedImageBackendTest, OpensConvertedImage) {
+    CompressedImageBackend backend(dir_.file("image.cimg"), options());
+    ASSERT_TRUE(backend.is_valid());
+    EXPECT_EQ(backend.block_count(), image_.size() / 512);
+    EXPECT_EQ(backend.block_size(), 512u);
+    EXPECT_EQ(backend.chunk_size(), 64u * 1024);
+    EXPECT_EQ(backend.codec(), GetParam());
+    EXPECT_EQ(backend.get_direct_buffer(0), nullptr);
+}
+
+TEST_P(CompressedImageBackendTest, CompressesCompressibleData) {
+    if (GetParam() == ChunkCodec::None) {
+        GTEST_SKIP();
+    }
+    auto compressed = std::filesystem::file_size(dir_.file("image.cimg"));
+    // 1/4 随机数据不可压缩，1/4 全零不占空间，整体应明显小于原始大小
+    EXPECT_LT(compressed, image_.size() / 2);
+}
+
+TEST_P(CompressedImageBackendTest, ReadMatchesRawSingleThread) {
+    CompressedImageBackend backend(dir_.file("image.cimg"), options(1));
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> buf(image_.size());
+    // 逐段读，跨 chunk 边界且长度不对齐 chunk
+    for (std::uint64_t lba = 0; lba < backend.block_count();) {
+        auto count = static_cast<std::uint16_t>(std::min<std::uint64_t>(37, backend.block_count() - lba));
+        ASSERT_EQ(backend.read(lba, count, buf.data() + lba * 512), count * 512u);
+        lba += count;
+    }
+    EXPECT_EQ(buf, image_);
+}
+
+TEST_P(CompressedImageBackendTest, LargeReadDecompressesInParallel) {
+    CompressedImageBackend backend(dir_.file("image.cimg"), options(4));
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> buf(image_.size());
+    auto count = static_cast<std::uint16_t>(backend.block_count());
+    ASSERT_EQ(backend.read(0, count, buf.data()), buf.size());
+    EXPECT_EQ(buf, image_);
+}
+
+TEST_P(CompressedImageBackendTest, CacheHitsOnRepeatedRead) {
+    CompressedImageBackend backend(dir_.file("image.cimg"), options());
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> buf(4096);
+    // chunk 0 为文本数据，不是全零 chunk
+    backend.read(0, 8, buf.data());
+    auto first = backend.cache_stats();
+    backend.read(0, 8, buf.data());
+    backend.read(8, 8, buf.data());
+    auto second = backend.cache_stats();
+    EXPECT_EQ(second.misses, first.misses);
+    EXPECT_EQ(second.hits, first.hits + 2);
+}
+
+TEST_P(CompressedImageBackendTest, ReadSegmentsLendCachedChunks) {
+    CompressedImageBackend backend(dir_.file("image.cimg"), options());
+    ASSERT_TRUE(backend.is_valid());
+    // 从 chunk 中间开始，跨两个 chunk 边界
+    constexpr std::uint64_t lba = 100;
+    constexpr std::uint16_t count = 300;
+    StorageSegments segs;
+    ASSERT_TRUE(backend.read_segments(lba, count, segs));
+    EXPECT_EQ(segs.total_length(), count * 512u);
+    EXPECT_GE(segs.segments.size(), 3u);
+    std::vector<std::uint8_t> joined;
+    for (auto &seg: segs.segments) {
+        auto *p = static_cast<const std::uint8_t *>(seg.base);
+        joined.insert(joined.end(), p, p + seg.length);
+    }
+    EXPECT_TRUE(std::equal(joined.begin(), joined.end(), image_.begin() + lba * 512));
+
+    // 有覆盖块的范围不能借出，回退 read()
+    std::vector<std::uint8_t> block(512, 0x5A);
+    ASSERT_EQ(backend.write(lba + 10, 1, block.data()), 512u);
+    StorageSegments after;
+    EXPECT_FALSE(backend.read_segments(lba, count, after));
+    EXPECT_TRUE(after.segments.empty());
+    // 按 chunk 判断：其他没有覆盖块的 chunk 仍可借出
+    EXPECT_TRUE(backend.read_segments(256, 16, after));
+}
+
+TEST_P(CompressedImageBackendTest, CacheRespectsBudget) {
+    auto opt = options();
+    CompressedImageBackend backend(dir_.file("image.cimg"), opt);
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> buf(image_.size());
+    backend.read(0, static_cast<std::uint16_t>(backend.block_count()), buf.data());
+    EXPECT_LE(backend.cache_stats().cached_bytes, opt.cache_bytes);
+}
+
+TEST_P(CompressedImageBackendTest, WritesGoToOverlay) {
+    std::vector<std::uint8_t> pattern(3 * 512, 0xAB);
+    {
+        CompressedImageBackend backend(dir_.file("image.cimg"), options());
+        ASSERT_TRUE(backend.is_valid());
+        // 跨 chunk 边界写（chunk = 128 块）
+        ASSERT_EQ(backend.write(127, 3, pattern.data()), pattern.size());
+        EXPECT_TRUE(backend.flush(127, 3));
+
+        std::vector<std::uint8_t> buf(256 * 512);
+        ASSERT_EQ(backend.read(0, 256, buf.data()), buf.size());
+        auto expected = std::vector<std::uint8_t>(image_.begin(), image_.begin() + 256 * 512);
+        std::memset(expected.data() + 127 * 512, 0xAB, 3 * 512);
+        EXPECT_EQ(buf, expected);
+    }
+    // 压缩镜像本身不变，覆盖层重新打开后仍生效
+    CompressedImageBackend reopened(dir_.file("image.cimg"), options());
+    ASSERT_TRUE(reopened.is_valid());
+    std::vector<std::uint8_t> buf(3 * 512);
+    reopened.read(127, 3, buf.data());
+    EXPECT_EQ(buf, pattern);
+    reopened.read(130, 1, buf.data());
+    EXPECT_EQ(0, std::memcmp(buf.data(), image_.data() + 130 * 512, 512));
+}
+
+TEST_P(CompressedImageBackendTest, FullyOverlaidChunk) {
+    CompressedImageBackend backend(dir_.file("image.cimg"), options());
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> pattern(128 * 512, 0x5A);
+    ASSERT_EQ(backend.write(256, 128, pattern.data()), pattern.size());
+    std::vector<std::uint8_t> buf(pattern.size());
+    ASSERT_EQ(backend.read(256, 128, buf.data()), buf.size());
+    EXPECT_EQ(buf, pattern);
+}
+
+TEST_P(CompressedImageBackendTest, PunchHoleReadsZero) {
+    CompressedImageBackend backend(dir_.file("image.cimg"), options());
+    ASSERT_TRUE(backend.is_valid());
+    backend.punch_hole(10, 20);
+    std::vector<std::uint8_t> buf(40 * 512);
+    ASSERT_EQ(backend.read(0, 40, buf.data()), buf.size());
+    EXPECT_EQ(0, std::memcmp(buf.data(), image_.data(), 10 * 512));
+    for (std::size_t i = 10 * 512; i < 30 * 512; ++i) {
+        ASSERT_EQ(buf[i], 0) << "offset " << i;
+    }
+    EXPECT_EQ(0, std::memcmp(buf.data() + 30 * 512, image_.data() + 30 * 512, 10 * 512));
+}
+
+TEST_P(CompressedImageBackendTest, OutOfRangeRejected) {
+    CompressedImageBackend backend(dir_.file("image.cimg"), options());
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> buf(512);
+    EXPECT_EQ(backend.read(backend.block_count(), 1, buf.data()), 0u);
+    EXPECT_EQ(backend.write(backend.block_count(), 1, buf.data()), 0u);
+}
+
+TEST_P(CompressedImageBackendTest, RejectsIndexEntryPastEndOfFile) {
+    // 头部 index_offset 在偏移 40；把 chunk 0（文本段，非全零）的 offset 改到文件尾之后
+    auto path = dir_.file("image.cimg");
+    std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+    std::uint64_t index_offset = 0;
+    f.seekg(40);
+    f.read(reinterpret_cast<char *>(&index_offset), sizeof(index_offset));
+    f.seekg(0, std::ios::end);
+    std::uint64_t past_end = static_cast<std::uint64_t>(f.tellg());
+    f.seekp(static_cast<std::streamoff>(index_offset));
+    f.write(reinterpret_cast<const char *>(&past_end), sizeof(past_end));
+    f.close();
+
+    CompressedImageBackend backend(path, options());
+    EXPECT_FALSE(backend.is_valid());
+}
+
+INSTANTIATE_TEST_SUITE_P(Codecs, CompressedImageBackendTest,
+                         ::testing::Values(ChunkCodec::None, ChunkCodec::Lz4, ChunkCodec::Zstd),
+                         [](const auto &info) {
+                             switch (info.param) {
+                                 case ChunkCodec::Lz4:
+                                     return std::string("Lz4");
+                                 case ChunkCodec::Zstd:
+                                     return std::string("Zstd");
+                                 default:
+                                     return std::string("None");
+                             }
+                         });
+
+TEST_P(CompressedImageBackendTest, PrefetchFillsCache) {
+    CompressedImageBackend backend(dir_.file("image.cimg"), options(2));
+    ASSERT_TRUE(backend.is_valid());
+    // chunk 0 文本、chunk 2 随机（chunk 1 全零不入缓存）。
+    // 每个分片只放得下一个 chunk，两个 chunk 须落在不同分片，否则后解压的会挤掉先解压的
+    backend.prefetch(0, 128);
+    backend.prefetch(2 * 128, 128);
+    // 预读在线程池上异步完成，轮询等待两个 chunk 都解压入缓存（misses 在解压前就已计数）
+    for (int i = 0; i < 200 && backend.cache_stats().cached_bytes < 2 * backend.chunk_size(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    auto before = backend.cache_stats();
+    EXPECT_EQ(before.misses, 2u);
+    std::vector<std::uint8_t> buf(128 * 512);
+    ASSERT_EQ(backend.read(2 * 128, 128, buf.data()), buf.size());
+    EXPECT_EQ(0, std::memcmp(buf.data(), image_.data() + 2 * 128 * 512, buf.size()));
+    EXPECT_EQ(backend.cache_stats().misses, before.misses);
+    // 超出范围的预读被忽略
+    backend.prefetch(backend.block_count(), 128);
+}
+
+TEST(CompressedImageBackend, RejectsNonImageFile) {
+    TempDir dir;
+    write_file(dir.file("garbage.img"), std::vector<std::uint8_t>(4096, 0x11));
+    CompressedImageBackend backend(dir.file("garbage.img"));
+    EXPECT_FALSE(backend.is_valid());
+}
+
+TEST(CompressedImageBackend, RejectsMissingFile) {
+    TempDir dir;
+    CompressedImageBackend backend(dir.file("missing.cimg"));
+    EXPECT_FALSE(backend.is_valid());
+}
+
+TEST(CompressedImageBackend, ConvertRejectsBadChunkSize) {
+    TempDir dir;
+    write_file(dir.file("raw.img"), std::vector<std::uint8_t>(4096, 0));
+    EXPECT_FALSE(CompressedImageBackend::convert_raw_image(dir.file("raw.img"), dir.file("out.cimg"),
+                                                           ChunkCodec::None, 1000));
+}
+
+// ============== MemoryBackend ==============
+
+namespace {
+
+/// 当前进程 RSS（字节），非 Linux 返回 0
+std::size_t current_rss() {
+#ifdef __linux__
+    std::ifstream f("/proc/self/statm");
+    std::size_t size = 0, resident = 0;
+    f >> size >> resident;
+    return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+TEST(MemoryBackend, UnwrittenBlocksReadZero) {
+    MemoryBackend backend(4096);
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> buf(16 * 512, 0xFF);
+    ASSERT_EQ(backend.read(100, 16, buf.data()), buf.size());
+    EXPECT_TRUE(std::all_of(buf.begin(), buf.end(), [](std::uint8_t b) { return b == 0; }));
+}
+
+TEST(MemoryBackend, WriteReadRoundTrip) {
+    MemoryBackend backend(4096);
+    auto image = make_image(64 * 512);
+    ASSERT_EQ(backend.write(1000, 64, image.data()), image.size());
+    std::vector<std::uint8_t> buf(image.size());
+    ASSERT_EQ(backend.read(1000, 64, buf.data()), buf.size());
+    EXPECT_EQ(buf, image);
+    EXPECT_EQ(0, std::memcmp(backend.get_direct_buffer(1000), image.data(), image.size()));
+}
+
+TEST(MemoryBackend, VectoredIoRoundTripAcrossUnalignedSegments) {
+    MemoryBackend backend(4096);
+    auto image = make_image(10 * 512);
+    // 段边界不对齐块：块跨段时经中转缓冲
+    auto write_copy = image;
+    std::vector<StorageIoVec> wv;
+    std::size_t off = 0;
+    for (std::size_t len: {100u, 700u, 1000u, 3320u}) {
+        wv.push_back({write_copy.data() + off, len});
+        off += len;
+    }
+    ASSERT_EQ(backend.writev(200, 10, wv.data(), wv.size()), image.size());
+
+    std::vector<std::uint8_t> buf(image.size());
+    std::vector<StorageIoVec> rv = {{buf.data(), 512 * 3}, {buf.data() + 512 * 3, 1},
+                                    {buf.data() + 512 * 3 + 1, 2000}, {buf.data() + 512 * 3 + 2001, 1583}};
+    ASSERT_EQ(backend.readv(200, 10, rv.data(), rv.size()), buf.size());
+    EXPECT_EQ(buf, image);
+
+    // 段长之和不足时失败
+    std::vector<StorageIoVec> short_iov = {{buf.data(), 512 * 9}};
+    EXPECT_EQ(backend.readv(200, 10, short_iov.data(), short_iov.size()), 0u);
+}
+
+TEST(MemoryBackend, PunchHoleZeroesPartialAndWholePages) {
+    MemoryBackend backend(4096);
+    std::vector<std::uint8_t> ones(4096 * 512, 1);
+    backend.write(0, 4095, ones.data());
+    // 起止都不对齐页，中间包含若干整页
+    backend.punch_hole(3, 50);
+    std::vector<std::uint8_t> buf(60 * 512);
+    backend.read(0, 60, buf.data());
+    for (std::size_t i = 0; i < buf.size(); ++i) {
+        auto block = i / 512;
+        ASSERT_EQ(buf[i], (block >= 3 && block < 53) ? 0 : 1) << "offset " << i;
+    }
+    // 小于一页的打洞
+    backend.punch_hole(100, 1);
+    backend.read(99, 3, buf.data());
+    EXPECT_EQ(buf[0], 1);
+    EXPECT_EQ(buf[512], 0);
+    EXPECT_EQ(buf[1024], 1);
+}
+
+TEST(MemoryBackend, HugePageModesWork) {
+    for (auto mode: {MemoryBackend::HugePages::Transparent, MemoryBackend::HugePages::Explicit}) {
+        // Explicit 在未配置 hugetlb 的机器上回退为普通页，仍须可用
+        MemoryBackend backend(8192, 512, mode);
+        ASSERT_TRUE(backend.is_valid());
+        auto image = make_image(128 * 512);
+        backend.write(4000, 128, image.data());
+        backend.punch_hole(0, 4000);
+        std::vector<std::uint8_t> buf(image.size());
+        backend.read(4000, 128, buf.data());
+        EXPECT_EQ(buf, image);
+    }
+}
+
+TEST(MemoryBackend, MappingFailureLeavesEmptyInvalidDisk) {
+    // 2^62 字节超出任何平台的用户地址空间，映射必然失败
+    MemoryBackend backend(1ull << 53, 512);
+    EXPECT_FALSE(backend.is_valid());
+    EXPECT_EQ(backend.block_count(), 0u);
+    EXPECT_EQ(backend.get_direct_buffer(0), nullptr);
+    std::vector<std::uint8_t> buf(512, 0x5A);
+    EXPECT_EQ(backend.read(0, 1, buf.data()), 0u);
+    EXPECT_EQ(backend.write(0, 1, buf.data()), 0u);
+    backend.punch_hole(0, 1);
+}
+
+#ifdef __linux__
+TEST(MemoryBackend, LargeDiskDoesNotCommitUpFront) {
+    auto before = current_rss();
+    // 16 GiB：旧实现（std::vector）会在构造时清零并占用全部内存
+    MemoryBackend backend(32ull * 1024 * 1024, 512);
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> buf(1024 * 1024);
+    backend.read(16ull * 1024 * 1024, 2048, buf.data());
+    auto after_read = current_rss();
+    EXPECT_LT(after_read - before, 64u * 1024 * 1024);
+
+    std::vector<std::uint8_t> data(1024 * 1024, 0x42);
+    for (int i = 0; i < 32; ++i) {
+        backend.write(static_cast<std::uint64_t>(i) * 2048, 2048, data.data());
+    }
+    auto after_write = current_rss();
+    EXPECT_GE(after_write - before, 24u * 1024 * 1024);
+
+    // 释放写入的 32 MiB
+    backend.punch_hole(0, 32 * 2048);
+    EXPECT_LT(current_rss(), after_write - 16u * 1024 * 1024);
+}
+#endif
+
+// ============== RawImageBackend ==============
+
+TEST(RawImageBackend, PrefetchKeepsDataIntact) {
+    TempDir dir;
+    auto image = make_image(256 * 1024);
+    write_file(dir.file("raw.img"), image);
+    RawImageBackend backend(dir.file("raw.img"), 0);
+    ASSERT_TRUE(backend.is_valid());
+    // 非页对齐起点、越过末尾的范围都应安全
+    backend.prefetch(3, 100);
+    backend.prefetch(backend.block_count() - 4, 1000);
+    backend.prefetch(backend.block_count(), 8);
+    std::vector<std::uint8_t> buf(image.size());
+    ASSERT_EQ(backend.read(0, static_cast<std::uint16_t>(backend.block_count()), buf.data()), buf.size());
+    EXPECT_EQ(buf, image);
+}
+
+namespace {
+
+std::vector<std::uint8_t> read_file(const std::string &path) {
+    std::ifstream f(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+}
+
+} // namespace
+
+TEST(RawImageBackend, WriteThroughWritesFileImmediately) {
+    TempDir dir;
+    RawImageBackend backend(dir.file("wt.img"), 64, 512, {WriteDurability::WriteThrough});
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> data(4 * 512, 0xAB);
+    ASSERT_EQ(backend.write(8, 4, data.data()), data.size());
+    EXPECT_EQ(backend.dirty_blocks(), 0u);
+    // 文件接口与映射区读到的都是新数据
+    auto file = read_file(dir.file("wt.img"));
+    ASSERT_EQ(file.size(), 64u * 512);
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), file.begin() + 8 * 512));
+    std::vector<std::uint8_t> buf(data.size());
+    backend.read(8, 4, buf.data());
+    EXPECT_EQ(buf, data);
+}
+
+TEST(RawImageBackend, WriteBackFlushOnlyCoveredRanges) {
+    TempDir dir;
+    DurabilityConfig cfg;
+    cfg.flush_interval_ms = 60 * 60 * 1000; // 测试期间后台不刷
+    RawImageBackend backend(dir.file("wb.img"), 1024, 512, cfg);
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> data(8 * 512, 0x11);
+    backend.write(0, 8, data.data());
+    backend.write(512, 8, data.data());
+    EXPECT_EQ(backend.dirty_blocks(), 16u);
+
+    EXPECT_TRUE(backend.flush(0, 256));
+    EXPECT_EQ(backend.dirty_blocks(), 8u);
+    EXPECT_TRUE(backend.flush(0, backend.block_count()));
+    EXPECT_EQ(backend.dirty_blocks(), 0u);
+}
+
+TEST(RawImageBackend, WriteBackTracksDirectWrites) {
+    TempDir dir;
+    DurabilityConfig cfg;
+    cfg.flush_interval_ms = 60 * 60 * 1000;
+    RawImageBackend backend(dir.file("direct.img"), 128, 512, cfg);
+    auto *p = static_cast<std::uint8_t *>(backend.get_direct_buffer(16));
+    ASSERT_NE(p, nullptr);
+    std::memset(p, 0x5A, 4 * 512);
+    EXPECT_TRUE(backend.commit_direct_write(16, 4));
+    EXPECT_EQ(backend.dirty_blocks(), 4u);
+    EXPECT_FALSE(backend.commit_direct_write(126, 4));
+    EXPECT_TRUE(backend.flush(16, 4));
+    EXPECT_EQ(backend.dirty_blocks(), 0u);
+}
+
+TEST(RawImageBackend, WriteBackBackgroundFlusherDrains) {
+    TempDir dir;
+    DurabilityConfig cfg;
+    cfg.flush_interval_ms = 10;
+    RawImageBackend backend(dir.file("bg.img"), 256, 512, cfg);
+    std::vector<std::uint8_t> data(512, 0x22);
+    for (std::uint64_t lba = 0; lba < 256; lba += 2) {
+        backend.write(lba, 1, data.data());
+    }
+    EXPECT_GT(backend.dirty_blocks(), 0u);
+    for (int i = 0; i < 200 && backend.dirty_blocks() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(backend.dirty_blocks(), 0u);
+}
+
+TEST(RawImageBackend, UnsafeTracksNothing) {
+    TempDir dir;
+    RawImageBackend backend(dir.file("unsafe.img"), 64, 512, {WriteDurability::Unsafe});
+    std::vector<std::uint8_t> data(512, 0x33);
+    backend.write(3, 1, data.data());
+    EXPECT_EQ(backend.dirty_blocks(), 0u);
+    EXPECT_TRUE(backend.flush(0, 64));
+}
+
+// ============== 零拷贝 send_direct / recv_direct ==============
+
+#ifdef __linux__
+namespace {
+
+/// 连接好的一对流式 socket，析构时关闭
+struct SocketPair {
+    int fds[2] = {-1, -1};
+    SocketPair() {
+        EXPECT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    }
+    ~SocketPair() {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+};
+
+std::vector<std::uint8_t> read_exact(int fd, std::size_t n) {
+    std::vector<std::uint8_t> buf(n);
+    for (std::size_t got = 0; got < n;) {
+        auto r = ::read(fd, buf.data() + got, n - got);
+        if (r <= 0)
+            break;
+        got += static_cast<std::size_t>(r);
+    }
+    return buf;
+}
+
+} // namespace
+
+TEST(SplicePipePool, ReusesReleasedPipesAndGrows) {
+    SplicePipePool pool(256 * 1024);
+    {
+        auto a = pool.acquire(4096);
+        auto b = pool.acquire(4096);
+        ASSERT_TRUE(a.pipe().valid());
+        ASSERT_TRUE(b.pipe().valid());
+        EXPECT_NE(a.pipe().read_fd, b.pipe().read_fd);
+    }
+    // 两个都归还后再租不新建；按需扩容到传输大小
+    auto c = pool.acquire(200 * 1024);
+    EXPECT_EQ(pool.pipes_created(), 2u);
+    EXPECT_GE(c.pipe().capacity, 200u * 1024);
+    EXPECT_LE(c.pipe().capacity, 256u * 1024);
+    c.discard();
+    c = SplicePipePool::Lease{};
+    // discard 的管道被关闭，池里只剩一个
+    auto d = pool.acquire(0);
+    auto e = pool.acquire(0);
+    EXPECT_EQ(pool.pipes_created(), 3u);
+}
+
+TEST(RawImageBackend, DirectIoAtUnalignedOffsets) {
+    TempDir dir;
+    RawImageBackend backend(dir.file("disk.img"), 1024);
+    ASSERT_TRUE(backend.is_valid());
+    auto image = make_image(1024 * 512);
+    ASSERT_EQ(backend.write(0, 1024, image.data()), image.size());
+    backend.set_splice_receive(true);
+    SplicePipePool pool;
+    SocketPair sp;
+
+    // 发送：LBA 内偏移和长度都不是块的整数倍
+    {
+        std::error_code ec;
+        ASSERT_TRUE(backend.send_direct(3, 100, 5007, sp.fds[0], pool, ec));
+        EXPECT_FALSE(ec);
+        auto got = read_exact(sp.fds[1], 5007);
+        EXPECT_TRUE(std::equal(got.begin(), got.end(), image.begin() + 3 * 512 + 100));
+    }
+
+    // 接收：大于管道初始容量，跨多次 splice
+    std::vector<std::uint8_t> incoming(70001);
+    for (std::size_t i = 0; i < incoming.size(); ++i)
+        incoming[i] = static_cast<std::uint8_t>(i * 31 + 7);
+    std::thread writer([&] {
+        for (std::size_t sent = 0; sent < incoming.size();) {
+            auto n = ::write(sp.fds[1], incoming.data() + sent, incoming.size() - sent);
+            if (n <= 0)
+                break;
+            sent += static_cast<std::size_t>(n);
+        }
+    });
+    SplicePipePool small_pool(64 * 1024);
+    {
+        std::error_code ec;
+        EXPECT_TRUE(backend.recv_direct(10, 37, incoming.size(), sp.fds[0], small_pool, ec));
+        EXPECT_FALSE(ec);
+    }
+    // 用完的管道归还池中
+    EXPECT_EQ(small_pool.pipes_created(), 1u);
+    writer.join();
+    std::vector<std::uint8_t> buf(200 * 512);
+    ASSERT_EQ(backend.read(10, 200, buf.data()), buf.size());
+    EXPECT_TRUE(std::equal(incoming.begin(), incoming.end(), buf.begin() + 37));
+    // 前后未覆盖的字节不受影响
+    EXPECT_TRUE(std::equal(buf.begin(), buf.begin() + 37, image.begin() + 10 * 512));
+    EXPECT_TRUE(std::equal(buf.begin() + 37 + incoming.size(), buf.end(),
+                           image.begin() + 10 * 512 + 37 + incoming.size()));
+}
+
+TEST(MemoryBackend, VmspliceSendDirect) {
+    MemoryBackend backend(4096);
+    auto image = make_image(512 * 512);
+    ASSERT_EQ(backend.write(0, 512, image.data()), image.size());
+    SplicePipePool pool;
+    SocketPair sp;
+
+    // 短传输不走 vmsplice，未发任何数据，调用者回退
+    {
+        std::error_code ec;
+        EXPECT_FALSE(backend.send_direct(0, 0, 4096, sp.fds[0], pool, ec));
+        EXPECT_FALSE(ec);
+        EXPECT_EQ(pool.pipes_created(), 0u);
+    }
+
+    constexpr std::size_t length = 96 * 1024 + 300;
+    std::vector<std::uint8_t> got;
+    std::thread reader([&] { got = read_exact(sp.fds[1], length); });
+    {
+        std::error_code ec;
+        EXPECT_TRUE(backend.send_direct(7, 11, length, sp.fds[0], pool, ec));
+        EXPECT_FALSE(ec);
+    }
+    reader.join();
+    EXPECT_TRUE(std::equal(got.begin(), got.end(), image.begin() + 7 * 512 + 11));
+}
+#endif
+
+// ============== DedupStore / DedupBackend ==============
+
+namespace {
+
+std::vector<std::uint8_t> random_bytes(std::size_t size, std::uint32_t seed) {
+    std::vector<std::uint8_t> data(size);
+    std::mt19937 rng(seed);
+    for (auto &b: data)
+        b = static_cast<std::uint8_t>(rng());
+    return data;
+}
+
+} // namespace
+
+TEST(DedupStore, IdenticalChunksStoredOnce) {
+    TempDir dir;
+    DedupStore store(dir.file("store"), 4096);
+    ASSERT_TRUE(store.is_valid());
+    auto a = random_bytes(4096, 1);
+    auto b = random_bytes(4096, 2);
+    auto id_a = store.put(a.data());
+    auto id_b = store.put(b.data());
+    EXPECT_NE(id_a, id_b);
+    EXPECT_EQ(store.put(a.data()), id_a);
+    std::vector<std::uint8_t> zero(4096, 0);
+    EXPECT_EQ(store.put(zero.data()), DedupStore::ZERO_CHUNK);
+
+    auto stats = store.stats();
+    EXPECT_EQ(stats.live_chunks, 2u);
+    EXPECT_EQ(stats.references, 3u);
+    EXPECT_EQ(stats.dedup_hits, 1u);
+
+    std::vector<std::uint8_t> out(4096);
+    ASSERT_TRUE(store.read(id_a, out.data()));
+    EXPECT_EQ(out, a);
+}
+
+TEST(DedupStore, LastUnrefFreesAndReusesId) {
+    TempDir dir;
+    DedupStore store(dir.file("store"), 4096);
+    auto a = random_bytes(4096, 1);
+    auto id = store.put(a.data());
+    store.put(a.data());
+    store.unref(id);
+    EXPECT_EQ(store.stats().live_chunks, 1u);
+    store.unref(id);
+    EXPECT_EQ(store.stats().live_chunks, 0u);
+    EXPECT_EQ(store.stats().free_chunks, 1u);
+
+    // 释放后索引里已没有旧内容，同样的内容重新写入并复用空闲 id
+    auto b = random_bytes(4096, 2);
+    EXPECT_EQ(store.put(b.data()), id);
+    EXPECT_EQ(store.put(a.data()), id + 1);
+    EXPECT_EQ(store.stats().dedup_hits, 1u);
+}
+
+TEST(DedupStore, ReopenRebuildsIndex) {
+    TempDir dir;
+    auto a = random_bytes(4096, 1);
+    std::uint64_t id;
+    {
+        DedupStore store(dir.file("store"), 4096);
+        id = store.put(a.data());
+        ASSERT_TRUE(store.sync());
+    }
+    DedupStore store(dir.file("store"), 4096);
+    ASSERT_TRUE(store.is_valid());
+    EXPECT_EQ(store.stats().live_chunks, 1u);
+    EXPECT_EQ(store.put(a.data()), id);
+    EXPECT_EQ(store.stats().references, 2u);
+}
+
+TEST(DedupStore, RejectsChunkSizeMismatch) {
+    TempDir dir;
+    { DedupStore store(dir.file("store"), 4096); }
+    DedupStore store(dir.file("store"), 8192);
+    EXPECT_FALSE(store.is_valid());
+}
+
+TEST(DedupBackend, UnalignedWritesRoundTrip) {
+    TempDir dir;
+    auto store = std::make_shared<DedupStore>(dir.file("store"), 4096);
+    DedupBackend backend(store, dir.file("a.map"), 256);
+    ASSERT_TRUE(backend.is_valid());
+    std::vector<std::uint8_t> expect(256 * 512, 0);
+
+    // 跨 chunk 边界、不满 chunk 的写
+    auto data = random_bytes(11 * 512, 7);
+    ASSERT_EQ(backend.write(5, 11, data.data()), data.size());
+    std::copy(data.begin(), data.end(), expect.begin() + 5 * 512);
+    auto big = random_bytes(64 * 512, 8);
+    ASSERT_EQ(backend.write(64, 64, big.data()), big.size());
+    std::copy(big.begin(), big.end(), expect.begin() + 64 * 512);
+
+    std::vector<std::uint8_t> buf(expect.size());
+    ASSERT_EQ(backend.read(0, 256, buf.data()), buf.size());
+    EXPECT_EQ(buf, expect);
+    std::vector<std::uint8_t> part(3 * 512);
+    ASSERT_EQ(backend.read(7, 3, part.data()), part.size());
+    EXPECT_TRUE(std::equal(part.begin(), part.end(), expect.begin() + 7 * 512));
+    EXPECT_EQ(backend.read(255, 2, buf.data()), 0u);
+}
+
+TEST(DedupBackend, DuplicateContentSharesChunks) {
+    TempDir dir;
+    auto store = std::make_shared<DedupStore>(dir.file("store"), 4096);
+    DedupBackend backend(store, dir.file("a.map"), 1024);
+    auto chunk = random_bytes(4096, 3);
+    for (std::uint64_t lba = 0; lba < 1024; lba += 8)
+        ASSERT_EQ(backend.write(lba, 8, chunk.data()), chunk.size());
+    EXPECT_EQ(backend.mapped_chunks(), 128u);
+    EXPECT_EQ(store->stats().live_chunks, 1u);
+}
+
+TEST(DedupBackend, CloneIsCopyOnWrite) {
+    TempDir dir;
+    auto store = std::make_shared<DedupStore>(dir.file("store"), 4096);
+    auto image = random_bytes(512 * 512, 4);
+    DedupBackend base(store, dir.file("base.map"), 512);
+    ASSERT_EQ(base.write(0, 512, image.data()), image.size());
+    ASSERT_TRUE(base.clone_to(dir.file("clone.map")));
+    EXPECT_FALSE(base.clone_to(dir.file("clone.map")));
+    EXPECT_EQ(store->stats().live_chunks, 64u);
+
+    DedupBackend clone(store, dir.file("clone.map"));
+    ASSERT_TRUE(clone.is_valid());
+    EXPECT_EQ(clone.block_count(), 512u);
+    auto patch = random_bytes(512, 5);
+    ASSERT_EQ(clone.write(100, 1, patch.data()), patch.size());
+    // 只多出被改动的那一个 chunk
+    EXPECT_EQ(store->stats().live_chunks, 65u);
+
+    std::vector<std::uint8_t> buf(image.size());
+    ASSERT_EQ(base.read(0, 512, buf.data()), buf.size());
+    EXPECT_EQ(buf, image);
+    ASSERT_EQ(clone.read(0, 512, buf.data()), buf.size());
+    std::copy(patch.begin(), patch.end(), image.begin() + 100 * 512);
+    EXPECT_EQ(buf, image);
+}
+
+TEST(DedupBackend, PunchHoleReleasesChunks) {
+    TempDir dir;
+    auto store = std::make_shared<DedupStore>(dir.file("store"), 4096);
+    DedupBackend backend(store, dir.file("a.map"), 64);
+    auto data = random_bytes(64 * 512, 6);
+    ASSERT_EQ(backend.write(0, 64, data.data()), data.size());
+    EXPECT_EQ(store->stats().live_chunks, 8u);
+    // [4, 28)：头尾各半个 chunk 清零，中间两个整 chunk 释放
+    backend.punch_hole(4, 24);
+    std::fill(data.begin() + 4 * 512, data.begin() + 28 * 512, 0);
+    EXPECT_EQ(backend.mapped_chunks(), 6u);
+    std::vector<std::uint8_t> buf(data.size());
+    ASSERT_EQ(backend.read(0, 64, buf.data()), buf.size());
+    EXPECT_EQ(buf, data);
+    EXPECT_EQ(store->stats().live_chunks, 6u);
+}
+
+TEST(DedupBackend, PersistsAcrossReopen) {
+    TempDir dir;
+    auto data = random_bytes(128 * 512, 9);
+    {
+        auto store = std::make_shared<DedupStore>(dir.file("store"), 4096);
+        DedupBackend backend(store, dir.file("a.map"), 128);
+        ASSERT_EQ(backend.write(0, 128, data.data()), data.size());
+        ASSERT_TRUE(backend.flush(0, 128));
+    }
+    auto store = std::make_shared<DedupStore>(dir.file("store"), 4096);
+    DedupBackend backend(store, dir.file("a.map"));
+    ASSERT_TRUE(backend.is_valid());
+    EXPECT_EQ(backend.block_count(), 128u);
+    std::vector<std::uint8_t> buf(data.size());
+    ASSERT_EQ(backend.read(0, 128, buf.data()), buf.size());
+    EXPECT_EQ(buf, data);
+    EXPECT_EQ(store->stats().references, 16u);
+}
+
+TEST(DedupBackend, RejectsMapWithChunkIdsOutsideStore) {
+    TempDir dir;
+    auto data = random_bytes(16 * 512, 11);
+    {
+        auto store = std::make_shared<DedupStore>(dir.file("store"), 4096);
+        DedupBackend backend(store, dir.file("a.map"), 16);
+        ASSERT_EQ(backend.write(0, 16, data.data()), data.size());
+        ASSERT_TRUE(backend.flush(0, 16));
+    }
+    // 映射配上另一个（空的）存储：id 全部越界
+    {
+        auto other = std::make_shared<DedupStore>(dir.file("other"), 4096);
+        DedupBackend backend(other, dir.file("a.map"));
+        EXPECT_FALSE(backend.is_valid());
+    }
+    // 映射里第二个 chunk 的 id 被改坏（映射头 32 字节，之后每个 chunk 8 字节）
+    {
+        std::fstream f(dir.file("a.map"), std::ios::binary | std::ios::in | std::ios::out);
+        std::uint64_t bad = 1u << 20;
+        f.seekp(32 + 8);
+        f.write(reinterpret_cast<const char *>(&bad), sizeof(bad));
+    }
+    auto store = std::make_shared<DedupStore>(dir.file("store"), 4096);
+    DedupBackend backend(store, dir.file("a.map"));
+    EXPECT_FALSE(backend.is_valid());
+}
+
+TEST(DedupBackend, ImportRawImage) {
+    TempDir dir;
+    auto image = make_image(1024 * 1024);
+    write_file(dir.file("raw.img"), image);
+    auto store = std::make_shared<DedupStore>(dir.file("store"), 4096);
+    ASSERT_TRUE(DedupBackend::import_raw_image(store, dir.file("raw.img"), dir.file("raw.map")));
+    EXPECT_FALSE(DedupBackend::import_raw_image(store, dir.file("raw.img"), dir.file("raw.map")));
+
+    DedupBackend backend(store, dir.file("raw.map"));
+    ASSERT_EQ(backend.block_count(), image.size() / 512);
+    std::vector<std::uint8_t> buf(image.size());
+    for (std::uint64_t lba = 0; lba < backend.block_count(); lba += 256)
+        ASSERT_EQ(backend.read(lba, 256, buf.data() + lba * 512), 256u * 512);
+    EXPECT_EQ(buf, image);
+    // 全零段不占存储，重复的文本段被去重
+    EXPECT_LT(store->stats().stored_bytes, image.size() * 3 / 4);
+}
+
+// ============== CachedBackend ==============
+
+namespace {
+
+/// 统计底层 read 次数的内存盘
+class CountingBackend : public MemoryBackend {
+public:
+    using MemoryBackend::MemoryBackend;
+
+    std::size_t read(std::uint64_t lba, std::uint16_t count, void *buffer) override {
+        ++reads;
+        return MemoryBackend::read(lba, count, buffer);
+    }
+
+    int reads = 0;
+};
+
+/// 缓存页 4 KiB（8 块），单分片，便于计算容量
+CachedBackendOptions small_cache(std::size_t pages, CacheWriteMode mode = CacheWriteMode::WriteThrough) {
+    CachedBackendOptions options;
+    options.cache_bytes = pages * 4096;
+    options.page_size = 4096;
+    options.shards = 1;
+    options.write_mode = mode;
+    return options;
+}
+
+} // namespace
+
+TEST(CachedBackend, MissReadsWholePagesThenHits) {
+    auto inner = std::make_unique<CountingBackend>(1024);
+    auto *raw = inner.get();
+    auto image = make_image(1024 * 512);
+    raw->write(0, 1024, image.data());
+    CachedBackend backend(std::move(inner), small_cache(64));
+
+    // 跨三页的未对齐读：一次合并的底层读
+    std::vector<std::uint8_t> buf(40 * 512);
+    ASSERT_EQ(backend.read(5, 18, buf.data()), 18u * 512);
+    EXPECT_EQ(0, std::memcmp(buf.data(), image.data() + 5 * 512, 18 * 512));
+    EXPECT_EQ(raw->reads, 1);
+    auto stats = backend.cache_stats();
+    EXPECT_EQ(stats.misses, 3u);
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_EQ(stats.cached_bytes, 3u * 4096);
+
+    // 同一页内的其它块直接命中
+    ASSERT_EQ(backend.read(16, 8, buf.data()), 8u * 512);
+    EXPECT_EQ(0, std::memcmp(buf.data(), image.data() + 16 * 512, 8 * 512));
+    EXPECT_EQ(raw->reads, 1);
+    EXPECT_EQ(backend.cache_stats().hits, 1u);
+
+    // 页 2..6 中 2、5 已缓存：3-4 和 6 各一次底层读
+    ASSERT_EQ(backend.read(40, 8, buf.data()), 8u * 512);
+    ASSERT_EQ(raw->reads, 2);
+    ASSERT_EQ(backend.read(16, 40, buf.data()), 40u * 512);
+    EXPECT_EQ(0, std::memcmp(buf.data(), image.data() + 16 * 512, 40 * 512));
+    EXPECT_EQ(raw->reads, 4);
+}
+
+TEST(CachedBackend, ScanDoesNotFlushHotPages) {
+    auto inner = std::make_unique<CountingBackend>(8192);
+    auto *raw = inner.get();
+    CachedBackend backend(std::move(inner), small_cache(16));
+    std::vector<std::uint8_t> buf(4096);
+
+    // 热点页 0..3：首次进 A1in，被后续访问挤到 A1out，再次访问时晋升 Am
+    auto touch_hot = [&] {
+        for (std::uint64_t page = 0; page < 4; ++page)
+            backend.read(page * 8, 8, buf.data());
+    };
+    auto scan = [&](std::uint64_t from, std::uint64_t pages) {
+        for (std::uint64_t page = from; page < from + pages; ++page)
+            backend.read(page * 8, 8, buf.data());
+    };
+    touch_hot();
+    scan(100, 16);
+    touch_hot();
+    EXPECT_EQ(backend.cache_stats().ghost_hits, 4u);
+
+    // 大范围顺序扫描只流经 A1in
+    scan(200, 500);
+    auto before = raw->reads;
+    touch_hot();
+    EXPECT_EQ(raw->reads, before);
+    EXPECT_LE(backend.cache_stats().cached_bytes, 16u * 4096);
+    EXPECT_GT(backend.cache_stats().evictions, 0u);
+}
+
+TEST(CachedBackend, WriteThroughUpdatesCachedPages) {
+    auto inner = std::make_unique<CountingBackend>(1024);
+    auto *raw = inner.get();
+    CachedBackend backend(std::move(inner), small_cache(64));
+    std::vector<std::uint8_t> buf(16 * 512);
+    backend.read(0, 16, buf.data());
+    ASSERT_EQ(raw->reads, 1);
+
+    // 部分页写入：缓存副本合并新数据；整页写入：未缓存的页直接放入
+    auto data = make_image(3 * 512);
+    ASSERT_EQ(backend.write(3, 3, data.data()), data.size());
+    auto whole = make_image(8 * 512);
+    std::reverse(whole.begin(), whole.end());
+    ASSERT_EQ(backend.write(64, 8, whole.data()), whole.size());
+
+    ASSERT_EQ(backend.read(0, 16, buf.data()), buf.size());
+    EXPECT_EQ(0, std::memcmp(buf.data() + 3 * 512, data.data(), data.size()));
+    std::vector<std::uint8_t> page(8 * 512);
+    ASSERT_EQ(backend.read(64, 8, page.data()), page.size());
+    EXPECT_EQ(page, whole);
+    EXPECT_EQ(raw->reads, 1);
+
+    // 底层同样写入了
+    raw->read(3, 3, buf.data());
+    EXPECT_EQ(0, std::memcmp(buf.data(), data.data(), data.size()));
+}
+
+TEST(CachedBackend, WriteAroundInvalidates) {
+    auto inner = std::make_unique<CountingBackend>(1024);
+    auto *raw = inner.get();
+    CachedBackend backend(std::move(inner), small_cache(64, CacheWriteMode::WriteAround));
+    std::vector<std::uint8_t> buf(8 * 512);
+    backend.read(0, 8, buf.data());
+
+    auto data = make_image(8 * 512);
+    ASSERT_EQ(backend.write(0, 8, data.data()), data.size());
+    ASSERT_EQ(backend.write(64, 8, data.data()), data.size());
+    EXPECT_EQ(backend.cache_stats().cached_bytes, 0u);
+
+    ASSERT_EQ(backend.read(0, 8, buf.data()), buf.size());
+    EXPECT_EQ(buf, data);
+    EXPECT_EQ(raw->reads, 2);
+}
+
+TEST(CachedBackend, PunchHoleInvalidates) {
+    auto inner = std::make_unique<CountingBackend>(1u << 20);
+    auto image = make_image(64 * 512);
+    CachedBackend backend(std::move(inner), small_cache(64));
+    ASSERT_EQ(backend.write(0, 64, image.data()), image.size());
+    std::vector<std::uint8_t> buf(64 * 512);
+    backend.read(0, 64, buf.data());
+
+    backend.punch_hole(4, 8);
+    ASSERT_EQ(backend.read(0, 64, buf.data()), buf.size());
+    EXPECT_EQ(0, std::memcmp(buf.data(), image.data(), 4 * 512));
+    EXPECT_TRUE(std::all_of(buf.begin() + 4 * 512, buf.begin() + 12 * 512, [](std::uint8_t b) { return b == 0; }));
+    EXPECT_EQ(0, std::memcmp(buf.data() + 12 * 512, image.data() + 12 * 512, 52 * 512));
+
+    // 大范围 TRIM 走分片扫描
+    backend.punch_hole(0, 1u << 20);
+    EXPECT_EQ(backend.cache_stats().cached_bytes, 0u);
+    ASSERT_EQ(backend.read(0, 64, buf.data()), buf.size());
+    EXPECT_TRUE(std::all_of(buf.begin(), buf.end(), [](std::uint8_t b) { return b == 0; }));
+}
+
+TEST(CachedBackend, ReadSegmentsLendOnlyWhenFullyCached) {
+    auto inner = std::make_unique<MemoryBackend>(1024);
+    auto image = make_image(1024 * 512);
+    inner->write(0, 1024, image.data());
+    CachedBackend backend(std::move(inner), small_cache(64));
+
+    StorageSegments segments;
+    EXPECT_FALSE(backend.read_segments(4, 12, segments));
+    std::vector<std::uint8_t> buf(12 * 512);
+    backend.read(4, 12, buf.data());
+    ASSERT_TRUE(backend.read_segments(4, 12, segments));
+    ASSERT_EQ(segments.segments.size(), 2u);
+    EXPECT_EQ(segments.total_length(), buf.size());
+
+    // 借出后写入不影响已借出的数据
+    auto data = make_image(12 * 512);
+    std::reverse(data.begin(), data.end());
+    backend.write(4, 12, data.data());
+    std::size_t off = 0;
+    for (auto &seg: segments.segments) {
+        EXPECT_EQ(0, std::memcmp(static_cast<std::uint8_t *>(seg.base), image.data() + 4 * 512 + off, seg.length));
+        off += seg.length;
+    }
+    ASSERT_TRUE(backend.read_segments(4, 12, segments));
+    EXPECT_EQ(0, std::memcmp(segments.segments[0].base, data.data(), segments.segments[0].length));
+}
+
+// ============== AsyncDiscardBackend ==============
+
+namespace {
+
+/// punch_hole 在 release() 之前一直阻塞的内存盘，模拟大范围 fallocate 耗时
+class GatedPunchBackend : public MemoryBackend {
+public:
+    using MemoryBackend::MemoryBackend;
+
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override {
+        std::unique_lock lock(mutex_);
+        ++entered_;
+        cv_.notify_all();
+        cv_.wait(lock, [this] { return released_; });
+        lock.unlock();
+        MemoryBackend::punch_hole(lba, count);
+    }
+
+    void release() {
+        std::lock_guard lock(mutex_);
+        released_ = true;
+        cv_.notify_all();
+    }
+
+    void wait_entered(int n) {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [&] { return entered_ >= n; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int entered_ = 0;
+    bool released_ = false;
+};
+
+/// 每次 punch_hole 固定耗时 DELAY
+class SlowPunchBackend : public MemoryBackend {
+public:
+    static constexpr auto DELAY = std::chrono::milliseconds(200);
+
+    using MemoryBackend::MemoryBackend;
+
+    void punch_hole(std::uint64_t lba, std::uint64_t count) override {
+        std::this_thread::sleep_for(DELAY);
+        MemoryBackend::punch_hole(lba, count);
+    }
+};
+
+bool all_zero(const std::uint8_t *p, std::size_t n) {
+    return std::all_of(p, p + n, [](std::uint8_t b) { return b == 0; });
+}
+
+} // namespace
+
+TEST(AsyncDiscardBackend, AcknowledgesBeforePunchCompletes) {
+    constexpr auto delay = SlowPunchBackend::DELAY;
+
+    // 同步：调用方等满整个打洞耗时
+    SlowPunchBackend sync_backend(4096);
+    auto start = std::chrono::steady_clock::now();
+    sync_backend.punch_hole(0, 4096);
+    auto sync_latency = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(sync_latency, delay);
+
+    // 异步：记录范围即返回，读到的已是全零
+    auto inner = std::make_unique<SlowPunchBackend>(4096);
+    auto image = make_image(4096 * 512);
+    inner->write(0, 4096, image.data());
+    AsyncDiscardBackend backend(std::move(inner));
+    start = std::chrono::steady_clock::now();
+    backend.punch_hole(0, 4096);
+    auto async_latency = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(async_latency, delay / 4);
+    EXPECT_EQ(backend.pending_blocks(), 4096u);
+
+    std::vector<std::uint8_t> buf(64 * 512);
+    ASSERT_EQ(backend.read(100, 64, buf.data()), buf.size());
+    EXPECT_TRUE(all_zero(buf.data(), buf.size()));
+    EXPECT_EQ(backend.get_direct_buffer(100), nullptr);
+
+    // SYNCHRONIZE CACHE 是屏障：返回时底层已打洞
+    EXPECT_TRUE(backend.flush(0, 4096));
+    EXPECT_EQ(backend.pending_blocks(), 0u);
+    ASSERT_EQ(backend.inner().read(100, 64, buf.data()), buf.size());
+    EXPECT_TRUE(all_zero(buf.data(), buf.size()));
+    EXPECT_NE(backend.get_direct_buffer(100), nullptr);
+}
+
+TEST(AsyncDiscardBackend, CoalescesQueuedRanges) {
+    auto inner = std::make_unique<GatedPunchBackend>(8192);
+    auto *gate = inner.get();
+    AsyncDiscardBackend backend(std::move(inner));
+
+    // 第一批被后台线程取走并卡住，其后的相邻 / 重叠范围在队列里合并成一批
+    backend.punch_hole(0, 8);
+    gate->wait_entered(1);
+    backend.punch_hole(100, 50);
+    backend.punch_hole(150, 50);
+    backend.punch_hole(120, 200);
+    backend.punch_hole(1000, 10);
+    EXPECT_EQ(backend.pending_blocks(), 8u + 220 + 10);
+    gate->release();
+    backend.drain();
+
+    auto stats = backend.discard_stats();
+    EXPECT_EQ(stats.queued_ranges, 5u);
+    EXPECT_EQ(stats.applied_batches, 3u);
+    EXPECT_EQ(stats.applied_blocks, 8u + 220 + 10);
+}
+
+TEST(AsyncDiscardBackend, WritesAfterDiscardSurvive) {
+    auto inner = std::make_unique<GatedPunchBackend>(4096);
+    auto *gate = inner.get();
+    auto image = make_image(4096 * 512);
+    inner->write(0, 4096, image.data());
+    AsyncDiscardBackend backend(std::move(inner), 64);
+
+    backend.punch_hole(2000, 8);
+    gate->wait_entered(1);
+    // 排队中的范围被随后的写入覆盖一部分：写入的块不能再被打洞
+    backend.punch_hole(0, 256);
+    auto data = make_image(16 * 512);
+    std::reverse(data.begin(), data.end());
+    ASSERT_EQ(backend.write(40, 16, data.data()), data.size());
+
+    std::vector<std::uint8_t> buf(256 * 512);
+    ASSERT_EQ(backend.read(0, 256, buf.data()), buf.size());
+    EXPECT_TRUE(all_zero(buf.data(), 40 * 512));
+    EXPECT_EQ(0, std::memcmp(buf.data() + 40 * 512, data.data(), data.size()));
+    EXPECT_TRUE(all_zero(buf.data() + 56 * 512, 200 * 512));
+
+    gate->release();
+    backend.drain();
+    ASSERT_EQ(backend.inner().read(0, 256, buf.data()), buf.size());
+    EXPECT_TRUE(all_zero(buf.data(), 40 * 512));
+    EXPECT_EQ(0, std::memcmp(buf.data() + 40 * 512, data.data(), data.size()));
+    EXPECT_TRUE(all_zero(buf.data() + 56 * 512, 200 * 512));
+    // 范围外的数据不受影响；按 64 块一批分批执行
+    ASSERT_EQ(backend.read(256, 64, buf.data()), 64u * 512);
+    EXPECT_EQ(0, std::memcmp(buf.data(), image.data() + 256 * 512, 64 * 512));
+    EXPECT_EQ(backend.discard_stats().applied_blocks, 8u + 240);
+}
+
+TEST(AsyncDiscardBackend, DestructorAppliesPendingRanges) {
+    // 底层随装饰器一起析构，打洞量记在外部计数里
+    class CountingPunch : public MemoryBackend {
+    public:
+        CountingPunch(std::uint64_t blocks, std::atomic<std::uint64_t> &punched) :
+            MemoryBackend(blocks), punched_(punched) {
+        }
+        void punch_hole(std::uint64_t lba, std::uint64_t count) override {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            punched_ += count;
+            MemoryBackend::punch_hole(lba, count);
+        }
+
+    private:
+        std::atomic<std::uint64_t> &punched_;
+    };
+    std::atomic<std::uint64_t> punched{0};
+    {
+        AsyncDiscardBackend backend(std::make_unique<CountingPunch>(4096, punched), 100);
+        backend.punch_hole(0, 1000);
+    }
+    EXPECT_EQ(punched.load(), 1000u);
+}
+
+// ============== SharedImageRegistry / SharedImageBackend ==============
+
+TEST(SharedImageRegistry, SamePathSharesOneMapping) {
+    TempDir dir;
+    auto path = dir.file("disc.iso");
+    write_file(path, make_image(64 * 2048));
+    auto &registry = SharedImageRegistry::instance();
+    auto before = registry.open_images();
+    {
+        // 不同写法的同一路径归一到同一个映射
+        SharedImageBackend a(path);
+        SharedImageBackend b(dir.file("./disc.iso"));
+        ASSERT_TRUE(a.is_valid());
+        ASSERT_TRUE(b.is_valid());
+        EXPECT_EQ(a.image(), b.image());
+        EXPECT_EQ(a.image().use_count(), 2);
+        EXPECT_EQ(registry.open_images(), before + 1);
+        EXPECT_EQ(a.get_direct_buffer(5), b.get_direct_buffer(5));
+    }
+    // 最后一个使用者释放后映射解除，再打开是新的映射
+    EXPECT_EQ(registry.open_images(), before);
+    auto again = registry.open(path);
+    ASSERT_NE(again, nullptr);
+    EXPECT_EQ(again.use_count(), 1);
+}
+
+TEST(SharedImageRegistry, MissingFileFails) {
+    TempDir dir;
+    EXPECT_EQ(SharedImageRegistry::instance().open(dir.file("missing.iso")), nullptr);
+    SharedImageBackend backend(dir.file("missing.iso"));
+    EXPECT_FALSE(backend.is_valid());
+    EXPECT_EQ(backend.block_count(), 0u);
+}
+
+TEST(SharedImageBackend, ConcurrentReadersSeeImage) {
+    TempDir dir;
+    auto path = dir.file("disc.iso");
+    // 末尾不足一个扇区的字节不可见
+    auto image = make_image(256 * 2048 + 100);
+    write_file(path, image);
+    auto shared = SharedImageRegistry::instance().open(path);
+    ASSERT_NE(shared, nullptr);
+
+    constexpr int THREADS = 8;
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < THREADS; ++t) {
+        readers.emplace_back([&, t] {
+            SharedImageBackend backend(shared);
+            EXPECT_EQ(backend.block_count(), 256u);
+            EXPECT_EQ(backend.block_size(), 2048u);
+            std::mt19937 rng(t);
+            std::vector<std::uint8_t> buf(16 * 2048);
+            for (int i = 0; i < 500; ++i) {
+                auto lba = rng() % 241;
+                auto count = static_cast<std::uint16_t>(1 + rng() % 16);
+                if (backend.read(lba, count, buf.data()) != count * 2048u ||
+                    !std::equal(buf.begin(), buf.begin() + count * 2048, image.begin() + lba * 2048))
+                    ++mismatches;
+            }
+        });
+    }
+    for (auto &r: readers)
+        r.join();
+    EXPECT_EQ(mismatches.load(), 0);
+}
+
+TEST(SharedImageBackend, RejectsWritesAndOutOfRange) {
+    TempDir dir;
+    auto path = dir.file("disc.iso");
+    auto image = make_image(32 * 2048);
+    write_file(path, image);
+    SharedImageBackend backend(path);
+    ASSERT_TRUE(backend.is_valid());
+    EXPECT_TRUE(backend.is_read_only());
+
+    std::vector<std::uint8_t> buf(2 * 2048, 0xAB);
+    EXPECT_EQ(backend.write(0, 2, buf.data()), 0u);
+    EXPECT_EQ(backend.read(31, 2, buf.data()), 0u);
+    EXPECT_EQ(backend.get_direct_buffer(32), nullptr);
+    backend.prefetch(30, 100); // 越过末尾的预读提示被截断，不出错
+    ASSERT_EQ(backend.read(0, 2, buf.data()), buf.size());
+    EXPECT_TRUE(std::equal(buf.begin(), buf.end(), image.begin()));
+}
+
+#ifdef __linux__
+TEST(SharedImageBackend, SendDirectUsesExplicitOffsets) {
+    TempDir dir;
+    auto path = dir.file("disc.iso");
+    auto image = make_image(64 * 2048);
+    write_file(path, image);
+    SharedImageBackend a(path);
+    SharedImageBackend b(path);
+    ASSERT_TRUE(a.is_valid());
+    SplicePipePool pool;
+    SocketPair sp1;
+    SocketPair sp2;
+
+    // 两个会话交替发送同一个 fd 的不同位置，互不影响
+    std::error_code ec;
+    ASSERT_TRUE(a.send_direct(10, 0, 4096, sp1.fds[0], pool, ec));
+    ASSERT_TRUE(b.send_direct(3, 77, 3000, sp2.fds[0], pool, ec));
+    ASSERT_TRUE(a.send_direct(12, 0, 2048, sp1.fds[0], ec));
+    EXPECT_FALSE(ec);
+    auto got1 = read_exact(sp1.fds[1], 6144);
+    auto got2 = read_exact(sp2.fds[1], 3000);
+    EXPECT_TRUE(std::equal(got1.begin(), got1.end(), image.begin() + 10 * 2048));
+    EXPECT_TRUE(std::equal(got2.begin(), got2.end(), image.begin() + 3 * 2048 + 77));
+}
+#endif
+
+// ============== ScrubBackend ==============
+
+namespace {
+
+/// 轮询等待条件成立，最多 5 秒
+template<typename Pred>
+bool eventually(Pred pred) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/// 不限速、不让路、几乎连续扫描的参数，64 块镜像分成 4 个 chunk
+ScrubOptions fast_scrub(std::chrono::milliseconds pass_interval = std::chrono::milliseconds(2)) {
+    ScrubOptions options;
+    options.chunk_blocks = 16;
+    options.bytes_per_second = 0;
+    options.idle_after_io = std::chrono::milliseconds(0);
+    options.pass_interval = pass_interval;
+    options.confirm_delay = std::chrono::milliseconds(5);
+    return options;
+}
+
+} // namespace
+
+TEST(ScrubBackend, ChecksumMatchesReference) {
+    std::string name = ScrubBackend::checksum_name();
+    const char text[] = "123456789";
+    if (name.rfind("crc32c", 0) == 0) {
+        // CRC-32C 标准校验值，硬件与软件实现必须一致
+        EXPECT_EQ(ScrubBackend::checksum(text, 9), 0xE3069283u);
+    }
+    EXPECT_EQ(ScrubBackend::checksum(text, 9), ScrubBackend::checksum(text, 9));
+    EXPECT_NE(ScrubBackend::checksum(text, 9), ScrubBackend::checksum(text, 8));
+}
+
+TEST(ScrubBackend, RecordsThenVerifies) {
+    TempDir dir;
+    ScrubBackend scrub(std::make_unique<MemoryBackend>(64), dir.file("mem.scrub"), fast_scrub());
+    ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().passes >= 3; }));
+    auto stats = scrub.scrub_stats();
+    EXPECT_EQ(stats.recorded_chunks, 4u); // 只有首轮记录
+    EXPECT_GE(stats.verified_chunks, 8u);
+    EXPECT_EQ(stats.mismatches, 0u);
+    EXPECT_GE(stats.bytes_read, 3u * 64 * 512);
+    EXPECT_TRUE(scrub.mismatched_ranges().empty());
+}
+
+TEST(ScrubBackend, DetectsOutOfBandCorruption) {
+    TempDir dir;
+    std::mutex mutex;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> reported;
+    auto options = fast_scrub();
+    options.on_mismatch = [&](std::uint64_t lba, std::uint64_t count) {
+        std::lock_guard lock(mutex);
+        reported.emplace_back(lba, count);
+    };
+    ScrubBackend scrub(std::make_unique<MemoryBackend>(64), dir.file("mem.scrub"), options);
+    ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().passes >= 1; }));
+
+    // 绕过装饰器直接改底层，模拟介质损坏
+    std::vector<std::uint8_t> garbage(512, 0x5A);
+    ASSERT_EQ(scrub.inner().write(20, 1, garbage.data()), garbage.size());
+    ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().mismatches >= 1; }));
+    auto ranges = scrub.mismatched_ranges();
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].lba, 16u);
+    EXPECT_EQ(ranges[0].count, 16u);
+    {
+        std::lock_guard lock(mutex);
+        ASSERT_EQ(reported.size(), 1u);
+        EXPECT_EQ(reported[0].first, 16u);
+    }
+
+    // 同一 chunk 之后的轮次不重复报告
+    auto passes = scrub.scrub_stats().passes;
+    ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().passes >= passes + 2; }));
+    EXPECT_EQ(scrub.scrub_stats().mismatches, 1u);
+
+    // 经装饰器重写后重新记录，不再算损坏
+    ASSERT_EQ(scrub.write(16, 1, garbage.data()), garbage.size());
+    ASSERT_TRUE(eventually([&] { return scrub.mismatched_ranges().empty(); }));
+    EXPECT_EQ(scrub.scrub_stats().mismatches, 1u);
+}
+
+TEST(ScrubBackend, ForegroundWritesAreNotReported) {
+    TempDir dir;
+    auto options = fast_scrub(std::chrono::milliseconds(0));
+    options.chunk_blocks = 4;
+    ScrubBackend scrub(std::make_unique<MemoryBackend>(64), dir.file("mem.scrub"), options);
+
+    std::mt19937 rng(5);
+    std::vector<std::uint8_t> buf(4 * 512);
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(300)) {
+        for (auto &b: buf)
+            b = static_cast<std::uint8_t>(rng());
+        auto count = static_cast<std::uint16_t>(rng() % 4 + 1);
+        ASSERT_EQ(scrub.write(rng() % (64 - count), count, buf.data()), count * 512u);
+    }
+    auto passes = scrub.scrub_stats().passes;
+    ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().passes >= passes + 2; }));
+    auto stats = scrub.scrub_stats();
+    EXPECT_EQ(stats.mismatches, 0u);
+    EXPECT_GT(stats.recorded_chunks, 16u); // 被写过的 chunk 重新记录
+}
+
+TEST(ScrubBackend, SidecarSurvivesRestart) {
+    TempDir dir;
+    auto image = dir.file("disk.img");
+    auto sidecar = dir.file("disk.img.scrub");
+    write_file(image, make_image(64 * 512));
+    auto open = [&] {
+        return std::make_unique<RawImageBackend>(image, 0, 512);
+    };
+    {
+        ScrubBackend scrub(open(), sidecar, fast_scrub(std::chrono::hours(1)));
+        ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().passes >= 1; }));
+    }
+    {
+        // 重启后直接按已保存的校验和验证
+        ScrubBackend scrub(open(), sidecar, fast_scrub(std::chrono::hours(1)));
+        ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().passes >= 1; }));
+        EXPECT_EQ(scrub.scrub_stats().recorded_chunks, 0u);
+        EXPECT_EQ(scrub.scrub_stats().verified_chunks, 4u);
+    }
+
+    // 进程不在时镜像被改
+    {
+        std::fstream f(image, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(50 * 512);
+        f.write("corrupt", 7);
+    }
+    ScrubBackend scrub(open(), sidecar, fast_scrub());
+    ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().mismatches >= 1; }));
+    auto ranges = scrub.mismatched_ranges();
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].lba, 48u);
+}
+
+TEST(ScrubBackend, UncleanSidecarIsRebuilt) {
+    TempDir dir;
+    auto image = dir.file("disk.img");
+    auto sidecar = dir.file("disk.img.scrub");
+    auto crashed = dir.file("crashed.scrub");
+    write_file(image, make_image(64 * 512));
+    auto open = [&] {
+        return std::make_unique<RawImageBackend>(image, 0, 512);
+    };
+    {
+        ScrubBackend scrub(open(), sidecar, fast_scrub(std::chrono::hours(1)));
+        ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().passes >= 1; }));
+        // 写入后文件头被标记为未同步；此刻的文件就是"崩溃"时留下的样子
+        std::vector<std::uint8_t> data(512, 0x11);
+        ASSERT_EQ(scrub.write(3, 1, data.data()), data.size());
+        std::filesystem::copy_file(sidecar, crashed);
+    }
+    std::filesystem::copy_file(crashed, sidecar, std::filesystem::copy_options::overwrite_existing);
+
+    ScrubBackend scrub(open(), sidecar, fast_scrub(std::chrono::hours(1)));
+    ASSERT_TRUE(eventually([&] { return scrub.scrub_stats().passes >= 1; }));
+    EXPECT_EQ(scrub.scrub_stats().recorded_chunks, 4u);
+    EXPECT_EQ(scrub.scrub_stats().mismatches, 0u);
+}
+
+// ============== DirtyRangeTracker ==============
+
+TEST(DirtyRangeTracker, MergesAdjacentAndOverlapping) {
+    DirtyRangeTracker t;
+    t.mark(0, 8);
+    t.mark(8, 8); // 相邻
+    t.mark(4, 2); // 被包含
+    t.mark(100, 4);
+    t.mark(14, 10); // 与第一段重叠
+    auto r = t.collect();
+    ASSERT_EQ(r.size(), 2u);
+    EXPECT_EQ(r[0].lba, 0u);
+    EXPECT_EQ(r[0].count, 24u);
+    EXPECT_EQ(r[1].lba, 100u);
+    EXPECT_EQ(r[1].count, 4u);
+    EXPECT_EQ(t.dirty_blocks(), 28u);
+}
+
+TEST(DirtyRangeTracker, CollectClipsToRequest) {
+    DirtyRangeTracker t;
+    t.mark(10, 20);
+    t.mark(50, 10);
+    auto r = t.collect(20, 35);
+    ASSERT_EQ(r.size(), 2u);
+    EXPECT_EQ(r[0].lba, 20u);
+    EXPECT_EQ(r[0].count, 10u);
+    EXPECT_EQ(r[1].lba, 50u);
+    EXPECT_EQ(r[1].count, 5u);
+    EXPECT_TRUE(t.collect(30, 20).empty());
+}
+
+TEST(DirtyRangeTracker, ClearSplitsPartialRanges) {
+    DirtyRangeTracker t;
+    t.mark(0, 100);
+    t.clear(t.collect(40, 20));
+    auto r = t.collect();
+    ASSERT_EQ(r.size(), 2u);
+    EXPECT_EQ(r[0].lba, 0u);
+    EXPECT_EQ(r[0].count, 40u);
+    EXPECT_EQ(r[1].lba, 60u);
+    EXPECT_EQ(r[1].count, 40u);
+    EXPECT_EQ(t.dirty_blocks(), 80u);
+    t.clear(t.collect());
+    EXPECT_TRUE(t.empty());
+    EXPECT_EQ(t.dirty_blocks(), 0u);
+}
+
+TEST(DirtyRangeTracker, RedirtiedDuringSyncIsKept) {
+    DirtyRangeTracker t;
+    t.mark(0, 8);
+    auto snapshot = t.collect();
+    // 同步期间同一区间又被写
+    t.mark(4, 8);
+    t.clear(snapshot);
+    auto r = t.collect();
+    ASSERT_EQ(r.size(), 1u);
+    EXPECT_EQ(r[0].lba, 0u);
+    EXPECT_EQ(r[0].count, 12u);
+}
+
+// ============== ReadaheadDetector ==============
+
+TEST(ReadaheadDetector, SequentialStreamTriggersAfterStreak) {
+    ReadaheadDetector ra;
+    EXPECT_FALSE(ra.on_read(0, 128, 1 << 20));
+    EXPECT_FALSE(ra.on_read(128, 128, 1 << 20));
+    auto r = ra.on_read(256, 128, 1 << 20);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->lba, 384u);
+    EXPECT_EQ(r->count, 128u);
+}
+
+TEST(ReadaheadDetector, WindowGrowsUpToMax) {
+    ReadaheadDetector::Config cfg;
+    cfg.initial_window = 64;
+    cfg.max_window = 256;
+    ReadaheadDetector ra(cfg);
+    std::uint64_t lba = 0;
+    std::uint64_t prefetched_end = 0;
+    std::uint32_t last_window = 0;
+    for (int i = 0; i < 200; ++i) {
+        if (auto r = ra.on_read(lba, 32, 1 << 20)) {
+            // 预读范围紧接上一次预读末尾（或当前读末尾），不重复
+            EXPECT_EQ(r->lba, std::max(prefetched_end, lba + 32));
+            EXPECT_GE(ra.window(), last_window);
+            prefetched_end = r->lba + r->count;
+            last_window = ra.window();
+        }
+        lba += 32;
+        // 预读始终领先读者
+        if (i > 4) {
+            EXPECT_GT(prefetched_end, lba);
+        }
+    }
+    EXPECT_EQ(ra.window(), 256u);
+}
+
+TEST(ReadaheadDetector, RandomAccessNeverPrefetches) {
+    ReadaheadDetector ra;
+    std::mt19937_64 rng(99);
+    for (int i = 0; i < 10000; ++i) {
+        auto lba = (rng() % 100000) * 8;
+        EXPECT_FALSE(ra.on_read(lba, 8, 1 << 20));
+    }
+    EXPECT_EQ(ra.issued(), 0u);
+}
+
+TEST(ReadaheadDetector, JumpResetsStream) {
+    ReadaheadDetector ra;
+    ra.on_read(0, 8, 1 << 20);
+    ra.on_read(8, 8, 1 << 20);
+    ASSERT_TRUE(ra.on_read(16, 8, 1 << 20));
+    EXPECT_GT(ra.window(), 0u);
+    EXPECT_FALSE(ra.on_read(5000, 8, 1 << 20));
+    EXPECT_EQ(ra.window(), 0u);
+    // 新位置需要重新积累连续次数
+    EXPECT_FALSE(ra.on_read(5008, 8, 1 << 20));
+    EXPECT_TRUE(ra.on_read(5016, 8, 1 << 20));
+}
+
+TEST(ReadaheadDetector, ClampedToMediumEnd) {
+    ReadaheadDetector ra;
+    ra.on_read(900, 8, 1000);
+    ra.on_read(908, 8, 1000);
+    auto r = ra.on_read(916, 8, 1000);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->lba + r->count, 1000u);
+    // 已读到介质末尾，没有可预读的范围
+    EXPECT_FALSE(ra.on_read(924, 76, 1000));
+}
+
+TEST(ReadaheadDetector, DisabledNeverPrefetches) {
+    ReadaheadDetector::Config cfg;
+    cfg.enabled = false;
+    ReadaheadDetector ra(cfg);
+    for (std::uint64_t lba = 0; lba < 10000; lba += 8) {
+        EXPECT_FALSE(ra.on_read(lba, 8, 1 << 20));
+    }
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "usbipdcpp/utils/ThreadPool.h"
+
+using namespace usbipdcpp;
+
+TEST(ThreadPool, SubmitReturnsResult) {
+    ThreadPool pool(2);
+    EXPECT_EQ(pool.size(), 2u);
+    auto fut = pool.submit([] { return 42; });
+    EXPECT_EQ(fut.get(), 42);
+}
+
+TEST(ThreadPool, DefaultThreadCountNonZero) {
+    ThreadPool pool;
+    EXPECT_GE(pool.size(), 1u);
+}
+
+TEST(ThreadPool, ManyTasksAllRun) {
+    ThreadPool pool(4);
+    std::atomic<int> counter{0};
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 1000; ++i) {
+        futures.push_back(pool.submit([&counter] { counter.fetch_add(1); }));
+    }
+    for (auto &f: futures) {
+        f.get();
+    }
+    EXPECT_EQ(counter.load(), 1000);
+}
+
+TEST(ThreadPool, ExceptionPropagatesToFuture) {
+    ThreadPool pool(1);
+    auto fut = pool.submit([]() -> int { throw std::runtime_error("boom"); });
+    EXPECT_THROW(fut.get(), std::runtime_error);
+    // 抛异常后工作线程仍可用
+    EXPECT_EQ(pool.submit([] { return 1; }).get(), 1);
+}
+
+TEST(ThreadPool, DestructorDrainsQueue) {
+    std::atomic<int> counter{0};
+    {
+        ThreadPool pool(1);
+        for (int i = 0; i < 50; ++i) {
+            pool.submit([&counter] {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                counter.fetch_add(1);
+            });
+        }
+    }
+    EXPECT_EQ(counter.load(), 50);
+}
+
+TEST(ThreadPool, RunsInParallel) {
+    ThreadPool pool(4);
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 4; ++i) {
+        futures.push_back(pool.submit([&] {
+            int now = running.fetch_add(1) + 1;
+            int prev = peak.load();
+            while (now > prev && !peak.compare_exchange_weak(prev, now)) {
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            running.fetch_sub(1);
+        }));
+    }
+    for (auto &f: futures) {
+        f.get();
+    }
+    EXPECT_GT(peak.load(), 1);
+}
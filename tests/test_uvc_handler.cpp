@@ -0,0 +1,566 @@
+// UVC 处理器走网络的端到端测试：PROBE/COMMIT 协商、等时 / 批量两种流的 payload 头与帧重组
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "test_utils.h"
+#include "usbip_test_client.h"
+#include "uvc_test_device.h"
+
+#include "usbipdcpp/Server.h"
+#include "usbipdcpp/utils/StringPool.h"
+#include "usbipdcpp/virtual_device/UvcConstants.h"
+#include "usbipdcpp/virtual_device/video_sources/AsyncVideoSource.h"
+#include "usbipdcpp/virtual_device/video_sources/ColorBarSource.h"
+
+using namespace usbipdcpp;
+using namespace usbipdcpp::test;
+
+namespace {
+
+constexpr std::uint16_t WIDTH = 64;
+constexpr std::uint16_t HEIGHT = 48;
+constexpr std::uint8_t FPS = 100; // 帧间隔 10ms，测试等下一帧不至于太久
+
+/// 只走旧接口的源：帧不带 owner，handler 必须自己拷贝
+class LegacyColorBars : public ColorBarSource {
+public:
+    LegacyColorBars() : ColorBarSource(WIDTH, HEIGHT, FPS) {
+    }
+
+    bool get_frame(VideoFrame &frame) override {
+        if (!ColorBarSource::get_frame(frame))
+            return false;
+        frame.owner.reset();
+        return true;
+    }
+};
+
+/// 每帧要 30ms 的源（比 100 fps 的帧间隔慢得多），模拟解码跟不上
+class SlowColorBars : public ColorBarSource {
+public:
+    SlowColorBars() : ColorBarSource(WIDTH, HEIGHT, FPS) {
+    }
+
+    bool get_frame(VideoFrame &frame) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        return ColorBarSource::get_frame(frame);
+    }
+};
+
+/**
+ * 多格式源：YUY2 64x48（连续帧间隔 10ms–100ms）、YUY2 32x24（离散 10ms / 20ms / 33.3ms，默认 20ms）、
+ * MJPEG 32x24（连续）。帧内容只取决于格式与分辨率，便于核对切换是否生效
+ */
+class MultiModeSource : public VideoSource {
+public:
+    std::vector<VideoFormatInfo> supported_formats() const override {
+        return {
+                {UvcFourCC::YUY2, 64, 48, 64 * 48 * 2, 100000, 100000, 1000000, 16},
+                {UvcFourCC::YUY2, 32, 24, 32 * 24 * 2, 200000, 100000, 333333, 16, {100000, 200000, 333333}},
+                {UvcFourCC::MJPEG, 32, 24, 4096, 100000, 100000, 1000000, 0},
+        };
+    }
+
+    VideoFormatInfo current_format() const override {
+        for (auto &f: supported_formats()) {
+            if (f.fourcc == fourcc_ && f.width == width_ && f.height == height_)
+                return f;
+        }
+        return supported_formats().front();
+    }
+
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                    std::uint32_t frame_interval) override {
+        ++set_format_calls;
+        if (reject)
+            return false;
+        fourcc_ = fourcc;
+        width_ = width;
+        height_ = height;
+        interval_ = frame_interval;
+        return true;
+    }
+
+    bool get_frame(VideoFrame &frame) override {
+        frame_ = frame_for(fourcc_, width_, height_);
+        frame = {frame_.data(), frame_.size(), true, nullptr};
+        return true;
+    }
+
+    std::size_t max_frame_size() const override {
+        return current_format().max_frame_size;
+    }
+
+    std::uint32_t frame_interval() const override {
+        return interval_;
+    }
+
+    static std::vector<std::uint8_t> frame_for(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height) {
+        if (fourcc == UvcFourCC::MJPEG) {
+            // SOI + 填充 + EOI，长度不到 max_frame_size：MJPEG 帧是变长的
+            std::vector<std::uint8_t> jpeg(300, 0x5A);
+            jpeg[0] = 0xFF;
+            jpeg[1] = 0xD8;
+            jpeg[298] = 0xFF;
+            jpeg[299] = 0xD9;
+            return jpeg;
+        }
+        return std::vector<std::uint8_t>(static_cast<std::size_t>(width) * height * 2,
+                                         static_cast<std::uint8_t>(width));
+    }
+
+    bool reject = false;
+    int set_format_calls = 0;
+
+private:
+    std::uint32_t fourcc_ = UvcFourCC::YUY2;
+    std::uint16_t width_ = 64;
+    std::uint16_t height_ = 48;
+    std::uint32_t interval_ = 100000;
+    std::vector<std::uint8_t> frame_;
+};
+
+/// VS 类描述符中的一个子描述符
+struct ClassDescriptor {
+    std::uint8_t subtype;
+    std::vector<std::uint8_t> bytes;
+};
+
+std::vector<ClassDescriptor> split_class_descriptor(const data_type &desc) {
+    std::vector<ClassDescriptor> result;
+    for (std::size_t pos = 0; pos + 2 < desc.size() && desc[pos] != 0; pos += desc[pos])
+        result.push_back({desc[pos + 2], {desc.begin() + pos, desc.begin() + pos + desc[pos]}});
+    return result;
+}
+
+std::uint32_t le32(const std::vector<std::uint8_t> &d, std::size_t offset) {
+    return d[offset] | (d[offset + 1] << 8) | (d[offset + 2] << 16) | (static_cast<std::uint32_t>(d[offset + 3]) << 24);
+}
+
+std::vector<std::uint8_t> expected_frame() {
+    ColorBarSource source(WIDTH, HEIGHT, FPS);
+    VideoFrame frame{};
+    source.get_frame(frame);
+    return {frame.data, frame.data + frame.size};
+}
+
+class UvcHandlerTest : public ::testing::Test {
+protected:
+    void start(bool bulk, std::uint32_t bulk_payload_size = 0, std::unique_ptr<VideoSource> source = nullptr,
+               const std::vector<std::uint16_t> &iso_packet_sizes = {512}) {
+        if (!source)
+            source = std::make_unique<ColorBarSource>(WIDTH, HEIGHT, FPS);
+        device_ = server_.add_device(make_uvc_device(string_pool_, std::move(source), bulk, iso_packet_sizes));
+        if (bulk_payload_size != 0)
+            uvc_streaming_handler(*device_).set_bulk_payload_size(bulk_payload_size);
+        ASSERT_FALSE(server_.start(ep_));
+        ASSERT_TRUE(connect_with_retry(client_.socket(), ep_));
+        ASSERT_TRUE(client_.import("1-1"));
+    }
+
+    /// 以多格式源开一个批量设备，返回源（归 handler 所有）
+    MultiModeSource *start_multi_mode() {
+        auto source = std::make_unique<MultiModeSource>();
+        auto *raw = source.get();
+        start(true, 0, std::move(source));
+        return raw;
+    }
+
+    void TearDown() override {
+        client_.socket().close();
+        wait_sessions_gone(server_);
+        server_.stop();
+    }
+
+    /** 批量 IN 一直拉到完成 frames 帧（或超时），记录零长度包个数 */
+    void pull_bulk_frames(UvcFrameAssembler &assembler, std::uint32_t urb_length, std::uint64_t frames) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (assembler.frames() < frames && std::chrono::steady_clock::now() < deadline) {
+            auto reply = client_.submit(UVC_STREAM_EP, true, urb_length);
+            ASSERT_EQ(reply.status, 0u);
+            if (reply.actual_length == 0)
+                ++zero_length_replies_;
+            assembler.push_bulk(reply.data.data(), reply.actual_length, urb_length);
+        }
+    }
+
+    asio::io_context io_;
+    asio::ip::tcp::endpoint ep_{asio::ip::address_v4::loopback(), 0};
+    // string_pool 必须先于 server 声明（后于 server 析构），handler 保存其引用
+    StringPool string_pool_;
+    Server server_;
+    std::shared_ptr<UsbDevice> device_;
+    UsbIpTestClient client_{io_};
+    std::uint64_t zero_length_replies_ = 0;
+};
+
+} // namespace
+
+TEST_F(UvcHandlerTest, IsoStreamDeliversFramesWithTogglingFid) {
+    start(false);
+    auto ctrl = uvc_negotiate(client_);
+    EXPECT_EQ(ctrl.dwMaxPayloadTransferSize, 512u);
+    EXPECT_FALSE(uvc_streaming_handler(*device_).is_bulk_mode());
+    ASSERT_EQ(client_.control(0x01, static_cast<std::uint8_t>(StandardRequest::SetInterface), 1, UVC_VS_INTERFACE, 0)
+                      .status,
+              0u);
+
+    UvcFrameAssembler assembler;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    std::vector<bool> fids;
+    while (assembler.frames() < 2 && std::chrono::steady_clock::now() < deadline) {
+        auto reply = client_.submit_iso_in(UVC_STREAM_EP, 32, 512);
+        ASSERT_EQ(reply.status, 0u);
+        std::size_t offset = 0;
+        for (auto len: reply.iso_actual_lengths) {
+            if (assembler.push_iso_packet(reply.data.data() + offset, len))
+                fids.push_back(assembler.last_fid());
+            offset += len;
+        }
+    }
+    ASSERT_EQ(assembler.frames(), 2u);
+    EXPECT_EQ(assembler.errors(), 0u);
+    EXPECT_EQ(assembler.last_frame(), expected_frame());
+    EXPECT_NE(fids[0], fids[1]);
+}
+
+TEST_F(UvcHandlerTest, BulkProbeReportsDevicePayloadSize) {
+    start(true, 4000);
+    EXPECT_TRUE(uvc_streaming_handler(*device_).is_bulk_mode());
+    EXPECT_EQ(uvc_get_control(client_, GET_DEF, VS_PROBE_CONTROL).dwMaxPayloadTransferSize, 4000u);
+    EXPECT_EQ(uvc_get_control(client_, GET_MAX, VS_PROBE_CONTROL).dwMaxPayloadTransferSize, 4000u);
+
+    // 主机提议的 payload 大小被忽略：该字段由设备决定
+    auto ctrl = uvc_get_control(client_, GET_DEF, VS_PROBE_CONTROL);
+    ctrl.dwMaxPayloadTransferSize = 123;
+    ASSERT_EQ(uvc_set_control(client_, VS_PROBE_CONTROL, ctrl), 0u);
+    EXPECT_EQ(uvc_get_control(client_, GET_CUR, VS_PROBE_CONTROL).dwMaxPayloadTransferSize, 4000u);
+}
+
+TEST_F(UvcHandlerTest, BulkNotStreamingBeforeCommit) {
+    start(true);
+    auto reply = client_.submit(UVC_STREAM_EP, true, 16384);
+    EXPECT_NE(reply.status, 0u);
+}
+
+TEST_F(UvcHandlerTest, BulkPayloadsSpanUrbsAndEndWithShortUrb) {
+    // 帧 6144 字节，payload 上限 4000：第一个 payload 4000 字节（跨多个 URB），第二个 2148 字节
+    start(true, 4000);
+    auto ctrl = uvc_negotiate(client_);
+    ASSERT_EQ(ctrl.dwMaxPayloadTransferSize, 4000u);
+
+    UvcFrameAssembler assembler(ctrl.dwMaxPayloadTransferSize);
+    pull_bulk_frames(assembler, 512, 3);
+    ASSERT_EQ(assembler.frames(), 3u);
+    EXPECT_EQ(assembler.errors(), 0u);
+    EXPECT_EQ(assembler.payloads(), 6u);
+    EXPECT_EQ(assembler.last_frame(), expected_frame());
+}
+
+TEST_F(UvcHandlerTest, BulkPayloadEndingOnUrbBoundaryIsTerminatedByZlp) {
+    // 第二个 payload 2148 = 4 × 537：恰好填满 URB 又短于上限，必须补零长度包
+    start(true, 4000);
+    auto ctrl = uvc_negotiate(client_);
+
+    std::vector<std::uint32_t> lengths;
+    for (int i = 0; i < 13; ++i)
+        lengths.push_back(client_.submit(UVC_STREAM_EP, true, 537).actual_length);
+    // payload 1：7 × 537 + 241；payload 2：4 × 537；然后零长度包
+    std::vector<std::uint32_t> expected = {537, 537, 537, 537, 537, 537, 537, 241, 537, 537, 537, 537, 0};
+    EXPECT_EQ(lengths, expected);
+
+    UvcFrameAssembler assembler(ctrl.dwMaxPayloadTransferSize);
+    pull_bulk_frames(assembler, 537, 2);
+    ASSERT_EQ(assembler.frames(), 2u);
+    EXPECT_EQ(assembler.errors(), 0u);
+    EXPECT_EQ(assembler.last_frame(), expected_frame());
+}
+
+TEST_F(UvcHandlerTest, BulkClearHaltStopsStream) {
+    start(true);
+    uvc_negotiate(client_);
+    EXPECT_EQ(client_.submit(UVC_STREAM_EP, true, 16384).status, 0u);
+
+    auto reply = client_.control(0x02, static_cast<std::uint8_t>(StandardRequest::ClearFeature),
+                                 SetupPacket::USB_ENDPOINT_HALT, 0x80 | UVC_STREAM_EP, 0);
+    EXPECT_EQ(reply.status, 0u);
+    EXPECT_NE(client_.submit(UVC_STREAM_EP, true, 16384).status, 0u);
+
+    // 重新 COMMIT 再次开流，从新帧开始
+    uvc_negotiate(client_);
+    UvcFrameAssembler assembler(UvcVideoStreamingHandler::DEFAULT_BULK_PAYLOAD_SIZE);
+    pull_bulk_frames(assembler, 16384, 1);
+    ASSERT_EQ(assembler.frames(), 1u);
+    EXPECT_EQ(assembler.errors(), 0u);
+    EXPECT_EQ(assembler.last_frame(), expected_frame());
+}
+
+TEST_F(UvcHandlerTest, FramesWithOwnerAreNotCopied) {
+    start(true);
+    auto ctrl = uvc_negotiate(client_);
+    UvcFrameAssembler assembler(ctrl.dwMaxPayloadTransferSize);
+    pull_bulk_frames(assembler, 16384, 2);
+    ASSERT_EQ(assembler.frames(), 2u);
+    EXPECT_EQ(assembler.last_frame(), expected_frame());
+
+    auto stats = uvc_streaming_handler(*device_).stream_stats();
+    EXPECT_GE(stats.frames, 2u);
+    EXPECT_EQ(stats.frame_bytes, stats.frames * WIDTH * HEIGHT * 2);
+    EXPECT_EQ(stats.frame_copy_bytes, 0u);
+    // URB 从帧内存直接 gather write，也不拷进 URB 缓冲
+    EXPECT_EQ(stats.payload_copy_bytes, 0u);
+    EXPECT_GE(stats.gathered_bytes, 2u * WIDTH * HEIGHT * 2);
+}
+
+TEST_F(UvcHandlerTest, LegacySourceFramesAreCopied) {
+    start(true, 0, std::make_unique<LegacyColorBars>());
+    auto ctrl = uvc_negotiate(client_);
+    UvcFrameAssembler assembler(ctrl.dwMaxPayloadTransferSize);
+    pull_bulk_frames(assembler, 16384, 2);
+    ASSERT_EQ(assembler.frames(), 2u);
+    EXPECT_EQ(assembler.errors(), 0u);
+    EXPECT_EQ(assembler.last_frame(), expected_frame());
+
+    auto stats = uvc_streaming_handler(*device_).stream_stats();
+    EXPECT_EQ(stats.frame_copy_bytes, stats.frame_bytes);
+    EXPECT_GT(stats.frame_copy_bytes, 0u);
+}
+
+TEST_F(UvcHandlerTest, AsyncSourceEmptyFramesKeepStreamAlive) {
+    // 首帧就绪前 AsyncVideoSource 交出空帧，handler 回空 URB 而不是 STALL；之后慢源的帧被重发
+    AsyncVideoSourceOptions options;
+    options.underrun = FrameUnderrunPolicy::Repeat;
+    auto source = std::make_unique<AsyncVideoSource>(std::make_unique<SlowColorBars>(), options);
+    auto *async = source.get();
+    start(true, 0, std::move(source));
+    auto ctrl = uvc_negotiate(client_);
+    UvcFrameAssembler assembler(ctrl.dwMaxPayloadTransferSize);
+    pull_bulk_frames(assembler, 16384, 5);
+    ASSERT_EQ(assembler.frames(), 5u);
+    EXPECT_EQ(assembler.errors(), 0u);
+    EXPECT_EQ(assembler.last_frame(), expected_frame());
+
+    auto stats = async->stats();
+    EXPECT_GE(stats.skipped, 1u);
+    EXPECT_GE(stats.delivered + stats.repeated, 5u);
+}
+
+TEST_F(UvcHandlerTest, CopySendMatchesGatherSend) {
+    // 关闭 gather 发送后线上字节不变，只是多一次拷贝
+    start(true, 4000);
+    uvc_streaming_handler(*device_).set_gather_send(false);
+    auto ctrl = uvc_negotiate(client_);
+    UvcFrameAssembler assembler(ctrl.dwMaxPayloadTransferSize);
+    pull_bulk_frames(assembler, 512, 2);
+    ASSERT_EQ(assembler.frames(), 2u);
+    EXPECT_EQ(assembler.errors(), 0u);
+    EXPECT_EQ(assembler.last_frame(), expected_frame());
+
+    auto stats = uvc_streaming_handler(*device_).stream_stats();
+    EXPECT_EQ(stats.gathered_bytes, 0u);
+    EXPECT_GE(stats.payload_copy_bytes, 2u * WIDTH * HEIGHT * 2);
+}
+
+TEST_F(UvcHandlerTest, DescriptorListsEveryFormatAndFrame) {
+    start_multi_mode();
+    auto desc = uvc_streaming_handler(*device_).get_class_specific_descriptor();
+    auto parts = split_class_descriptor(desc);
+    // 头 + YUY2 格式 + 2 帧 + 色彩匹配 + MJPEG 格式 + 1 帧 + 色彩匹配
+    ASSERT_EQ(parts.size(), 8u);
+    EXPECT_EQ(parts[0].subtype, VS_DESC_INPUT_HEADER);
+    EXPECT_EQ(parts[0].bytes[3], 2u); // bNumFormats
+    EXPECT_EQ(parts[0].bytes[4] | (parts[0].bytes[5] << 8), desc.size()); // wTotalLength
+
+    EXPECT_EQ(parts[1].subtype, VS_DESC_FORMAT_UNCOMPRESSED);
+    EXPECT_EQ(parts[1].bytes[3], 1u); // bFormatIndex
+    EXPECT_EQ(parts[1].bytes[4], 2u); // bNumFrameDescriptors
+    EXPECT_EQ(parts[1].bytes[22], 1u); // bDefaultFrameIndex：源当前为 64x48
+
+    // 帧 1：64x48，连续帧间隔
+    EXPECT_EQ(parts[2].subtype, VS_DESC_FRAME_UNCOMPRESSED);
+    EXPECT_EQ(parts[2].bytes[3], 1u);
+    EXPECT_EQ(parts[2].bytes[5] | (parts[2].bytes[6] << 8), 64);
+    EXPECT_EQ(parts[2].bytes[25], 0u);
+    EXPECT_EQ(le32(parts[2].bytes, 26), 100000u);
+    EXPECT_EQ(le32(parts[2].bytes, 30), 1000000u);
+    EXPECT_EQ(le32(parts[2].bytes, 34), 100000u);
+
+    // 帧 2：32x24，三个离散帧间隔
+    EXPECT_EQ(parts[3].subtype, VS_DESC_FRAME_UNCOMPRESSED);
+    EXPECT_EQ(parts[3].bytes[3], 2u);
+    EXPECT_EQ(parts[3].bytes[7] | (parts[3].bytes[8] << 8), 24);
+    EXPECT_EQ(le32(parts[3].bytes, 21), 200000u); // dwDefaultFrameInterval
+    ASSERT_EQ(parts[3].bytes[25], 3u);
+    ASSERT_EQ(parts[3].bytes.size(), 26u + 3 * 4);
+    EXPECT_EQ(le32(parts[3].bytes, 26), 100000u);
+    EXPECT_EQ(le32(parts[3].bytes, 30), 200000u);
+    EXPECT_EQ(le32(parts[3].bytes, 34), 333333u);
+
+    EXPECT_EQ(parts[4].subtype, VS_DESC_COLORFORMAT);
+    EXPECT_EQ(parts[5].subtype, VS_DESC_FORMAT_MJPEG);
+    EXPECT_EQ(parts[5].bytes[3], 2u);
+    EXPECT_EQ(parts[5].bytes[4], 1u);
+    EXPECT_EQ(parts[6].subtype, VS_DESC_FRAME_MJPEG);
+    EXPECT_EQ(le32(parts[6].bytes, 17), 4096u); // dwMaxVideoFrameBufferSize
+    EXPECT_EQ(parts[7].subtype, VS_DESC_COLORFORMAT);
+}
+
+TEST_F(UvcHandlerTest, ProbeSelectsFrameAndReportsItsLimits) {
+    start_multi_mode();
+    auto ctrl = uvc_get_control(client_, GET_DEF, VS_PROBE_CONTROL);
+    EXPECT_EQ(ctrl.bFormatIndex, 1u);
+    EXPECT_EQ(ctrl.bFrameIndex, 1u);
+    EXPECT_EQ(ctrl.dwMaxVideoFrameSize, 64u * 48 * 2);
+
+    // 离散帧间隔取最近的一个
+    ctrl.bFrameIndex = 2;
+    ctrl.dwFrameInterval = 250000;
+    ASSERT_EQ(uvc_set_control(client_, VS_PROBE_CONTROL, ctrl), 0u);
+    auto cur = uvc_get_control(client_, GET_CUR, VS_PROBE_CONTROL);
+    EXPECT_EQ(cur.bFormatIndex, 1u);
+    EXPECT_EQ(cur.bFrameIndex, 2u);
+    EXPECT_EQ(cur.dwFrameInterval, 200000u);
+    EXPECT_EQ(cur.dwMaxVideoFrameSize, 32u * 24 * 2);
+
+    // GET_MIN / GET_MAX 针对选中的帧
+    EXPECT_EQ(uvc_get_control(client_, GET_MIN, VS_PROBE_CONTROL).dwFrameInterval, 333333u);
+    auto max = uvc_get_control(client_, GET_MAX, VS_PROBE_CONTROL);
+    EXPECT_EQ(max.dwFrameInterval, 100000u);
+    EXPECT_EQ(max.dwMaxVideoFrameSize, 32u * 24 * 2);
+    // GET_DEF 不随 PROBE 改变
+    EXPECT_EQ(uvc_get_control(client_, GET_DEF, VS_PROBE_CONTROL).bFrameIndex, 1u);
+}
+
+TEST_F(UvcHandlerTest, ContinuousIntervalIsClampedAndSnapped) {
+    start_multi_mode();
+    auto probe = [&](std::uint32_t interval) {
+        auto ctrl = uvc_get_control(client_, GET_DEF, VS_PROBE_CONTROL);
+        ctrl.dwFrameInterval = interval;
+        uvc_set_control(client_, VS_PROBE_CONTROL, ctrl);
+        return uvc_get_control(client_, GET_CUR, VS_PROBE_CONTROL).dwFrameInterval;
+    };
+    EXPECT_EQ(probe(5), 100000u); // 快于上限 → min
+    EXPECT_EQ(probe(10000000), 1000000u); // 慢于下限 → max
+    EXPECT_EQ(probe(260000), 300000u); // 对齐到 min + k*step
+    EXPECT_EQ(probe(500000), 500000u);
+}
+
+TEST_F(UvcHandlerTest, InvalidIndicesFallBackToDefaults) {
+    start_multi_mode();
+    auto ctrl = uvc_get_control(client_, GET_DEF, VS_PROBE_CONTROL);
+    ctrl.bFormatIndex = 9;
+    ctrl.bFrameIndex = 2;
+    ASSERT_EQ(uvc_set_control(client_, VS_PROBE_CONTROL, ctrl), 0u);
+    auto cur = uvc_get_control(client_, GET_CUR, VS_PROBE_CONTROL);
+    EXPECT_EQ(cur.bFormatIndex, 1u);
+    EXPECT_EQ(cur.bFrameIndex, 2u);
+
+    ctrl.bFormatIndex = 2;
+    ctrl.bFrameIndex = 7; // MJPEG 只有一帧
+    ASSERT_EQ(uvc_set_control(client_, VS_PROBE_CONTROL, ctrl), 0u);
+    cur = uvc_get_control(client_, GET_CUR, VS_PROBE_CONTROL);
+    EXPECT_EQ(cur.bFormatIndex, 2u);
+    EXPECT_EQ(cur.bFrameIndex, 1u);
+    EXPECT_EQ(cur.dwMaxVideoFrameSize, 4096u);
+}
+
+TEST_F(UvcHandlerTest, CommitSwitchesSourceFormat) {
+    start_multi_mode();
+    // YUY2 32x24 @ 33.3ms
+    auto ctrl = uvc_negotiate(client_, 1, 2, 333333);
+    EXPECT_EQ(ctrl.dwFrameInterval, 333333u);
+    auto commit = uvc_get_control(client_, GET_CUR, VS_COMMIT_CONTROL);
+    EXPECT_EQ(commit.bFrameIndex, 2u);
+    EXPECT_EQ(commit.dwFrameInterval, 333333u);
+
+    UvcFrameAssembler assembler(ctrl.dwMaxPayloadTransferSize);
+    pull_bulk_frames(assembler, 16384, 1);
+    ASSERT_EQ(assembler.frames(), 1u);
+    EXPECT_EQ(assembler.last_frame(), MultiModeSource::frame_for(UvcFourCC::YUY2, 32, 24));
+
+    // 再切到 MJPEG：帧变长，payload 以 EOF 结束
+    ctrl = uvc_negotiate(client_, 2, 1);
+    EXPECT_EQ(ctrl.dwMaxVideoFrameSize, 4096u);
+    UvcFrameAssembler mjpeg(ctrl.dwMaxPayloadTransferSize);
+    pull_bulk_frames(mjpeg, 16384, 2);
+    ASSERT_EQ(mjpeg.frames(), 2u);
+    EXPECT_EQ(mjpeg.errors(), 0u);
+    EXPECT_EQ(mjpeg.last_frame(), MultiModeSource::frame_for(UvcFourCC::MJPEG, 32, 24));
+}
+
+TEST_F(UvcHandlerTest, RejectedCommitStalls) {
+    auto *source = start_multi_mode();
+    source->reject = true;
+    auto ctrl = uvc_get_control(client_, GET_DEF, VS_PROBE_CONTROL);
+    ctrl.bFrameIndex = 2;
+    EXPECT_NE(uvc_set_control(client_, VS_COMMIT_CONTROL, ctrl), 0u);
+    EXPECT_EQ(source->set_format_calls, 1);
+    // 没有提交成功就不开流
+    EXPECT_NE(client_.submit(UVC_STREAM_EP, true, 16384).status, 0u);
+}
+
+/// 128 B 到 3×1024 B 六档带宽（alt 1..6）
+const std::vector<std::uint16_t> GRADED_ISO_SIZES = {128, 256, 512, 1024, 0x0C00, 0x1400};
+
+TEST_F(UvcHandlerTest, IsoProbeReportsSmallestAltThatFits) {
+    start(false, 0, std::make_unique<ColorBarSource>(
+                            std::vector<std::pair<std::uint16_t, std::uint16_t>>{{64, 48}, {320, 240}, {640, 480},
+                                                                                 {1920, 1080}},
+                            30),
+          GRADED_ISO_SIZES);
+    // 30 fps 一帧间隔 266 个微帧：每微帧须带 ceil(帧大小 / 266) + 2 字节
+    auto payload = [&](std::uint8_t frame_index, std::uint32_t interval = 0) {
+        auto ctrl = uvc_get_control(client_, GET_DEF, VS_PROBE_CONTROL);
+        ctrl.bFrameIndex = frame_index;
+        ctrl.dwFrameInterval = interval;
+        uvc_set_control(client_, VS_PROBE_CONTROL, ctrl);
+        return uvc_get_control(client_, GET_CUR, VS_PROBE_CONTROL).dwMaxPayloadTransferSize;
+    };
+    EXPECT_EQ(payload(1), 128u); // 26 B
+    EXPECT_EQ(payload(2), 1024u); // 580 B
+    EXPECT_EQ(payload(3), 3072u); // 2312 B，需要 3 事务
+    EXPECT_EQ(payload(4), 3072u); // 装不下任何一档：报告最大档，帧率由帧时钟降下来
+    // 帧率降到 1/10：320x240 每微帧只要 60 B
+    EXPECT_EQ(payload(2, 3333330), 128u);
+    EXPECT_EQ(uvc_get_control(client_, GET_MAX, VS_PROBE_CONTROL).dwMaxPayloadTransferSize, 3072u);
+}
+
+TEST_F(UvcHandlerTest, IsoStreamsOnSmallestAlt) {
+    start(false, 0, nullptr, GRADED_ISO_SIZES);
+    auto ctrl = uvc_negotiate(client_);
+    ASSERT_EQ(ctrl.dwMaxPayloadTransferSize, 128u);
+    // 主机选 wMaxPacketSize 不小于 dwMaxPayloadTransferSize 的最小 alt：alt 1
+    ASSERT_EQ(client_.control(0x01, static_cast<std::uint8_t>(StandardRequest::SetInterface), 1, UVC_VS_INTERFACE, 0)
+                      .status,
+              0u);
+    auto alt = client_.control(0x81, static_cast<std::uint8_t>(StandardRequest::GetInterface), 0, UVC_VS_INTERFACE, 1);
+    ASSERT_EQ(alt.data.size(), 1u);
+    EXPECT_EQ(alt.data[0], 1u);
+    EXPECT_EQ(uvc_streaming_handler(*device_).alt_setting(), 1u);
+
+    UvcFrameAssembler assembler;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (assembler.frames() < 2 && std::chrono::steady_clock::now() < deadline) {
+        auto reply = client_.submit_iso_in(UVC_STREAM_EP, 32, 128);
+        ASSERT_EQ(reply.status, 0u);
+        std::size_t offset = 0;
+        for (auto len: reply.iso_actual_lengths) {
+            EXPECT_LE(len, 128u);
+            assembler.push_iso_packet(reply.data.data() + offset, len);
+            offset += len;
+        }
+    }
+    ASSERT_EQ(assembler.frames(), 2u);
+    EXPECT_EQ(assembler.errors(), 0u);
+    EXPECT_EQ(assembler.last_frame(), expected_frame());
+
+    // 不存在的 alt
+    EXPECT_NE(client_.control(0x01, static_cast<std::uint8_t>(StandardRequest::SetInterface), 7, UVC_VS_INTERFACE, 0)
+                      .status,
+              0u);
+}
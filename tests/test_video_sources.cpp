@@ -0,0 +1,1090 @@
+// 视频源测试：VideoFramePool 借还与复用、ColorBarSource 交出的帧缓冲生命周期、像素格式转换各指令集档位与标量一致、
+// MjpegEncoderSource 条带并行编码的正确性、AsyncVideoSource 对慢源 / 快源的重发与丢帧、
+// ShmVideoSource 与外部生产者的共享内存帧环协议、VideoBroadcaster 一源多订阅的共享与慢订阅者丢帧
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef USBIPDCPP_HAVE_LIBJPEG
+#include <cstdio>
+
+#include <jpeglib.h>
+#endif
+
+#include "usbipdcpp/virtual_device/UvcConstants.h"
+#include "usbipdcpp/virtual_device/video_sources/AsyncVideoSource.h"
+#include "usbipdcpp/virtual_device/video_sources/ColorBarSource.h"
+#include "usbipdcpp/virtual_device/video_sources/MjpegEncoderSource.h"
+#include "usbipdcpp/virtual_device/video_sources/PixelConvert.h"
+#include "usbipdcpp/virtual_device/video_sources/ShmVideoSource.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoBroadcaster.h"
+#include "usbipdcpp/virtual_device/video_sources/VideoFramePool.h"
+#include "usbipdcpp/virtual_device/video_sources/shm_video_ring.h"
+
+using namespace usbipdcpp;
+
+// ==================== VideoFramePool ====================
+
+TEST(VideoFramePool, ReleasedBufferIsReused) {
+    auto pool = VideoFramePool::create(1024);
+    const std::uint8_t *first_data = nullptr;
+    {
+        auto buffer = pool->acquire();
+        ASSERT_GE(buffer->capacity(), 1024u);
+        first_data = buffer->data();
+        auto stats = pool->stats();
+        EXPECT_EQ(stats.allocations, 1u);
+        EXPECT_EQ(stats.in_use, 1u);
+        EXPECT_EQ(stats.idle, 0u);
+    }
+    EXPECT_EQ(pool->stats().idle, 1u);
+
+    auto again = pool->acquire();
+    EXPECT_EQ(again->data(), first_data);
+    EXPECT_EQ(again->size(), 0u); // 借出时有效长度清零
+    auto stats = pool->stats();
+    EXPECT_EQ(stats.allocations, 1u);
+    EXPECT_EQ(stats.reuses, 1u);
+}
+
+TEST(VideoFramePool, FrameOwnerKeepsBufferOutOfPool) {
+    auto pool = VideoFramePool::create(16);
+    auto buffer = pool->acquire();
+    buffer->data()[0] = 0x5A;
+    buffer->set_size(16);
+    auto frame = make_video_frame(std::move(buffer), false);
+    EXPECT_EQ(frame.size, 16u);
+    EXPECT_FALSE(frame.is_keyframe);
+    EXPECT_EQ(frame.data[0], 0x5A);
+
+    // 帧还被持有：再借只能新分配，不会拿到正在发送的缓冲
+    auto other = pool->acquire();
+    EXPECT_NE(other->data(), frame.data);
+    EXPECT_EQ(pool->stats().allocations, 2u);
+
+    frame.owner.reset();
+    EXPECT_EQ(pool->stats().in_use, 1u);
+    EXPECT_EQ(pool->stats().idle, 1u);
+}
+
+TEST(VideoFramePool, IdleListIsBounded) {
+    auto pool = VideoFramePool::create(16, 2);
+    {
+        std::vector<std::shared_ptr<VideoFrameBuffer>> held;
+        for (int i = 0; i < 5; ++i)
+            held.push_back(pool->acquire());
+    }
+    auto stats = pool->stats();
+    EXPECT_EQ(stats.in_use, 0u);
+    EXPECT_EQ(stats.idle, 2u);
+}
+
+TEST(VideoFramePool, ResizeDropsStaleBuffers) {
+    auto pool = VideoFramePool::create(16);
+    auto old_buffer = pool->acquire();
+    pool->acquire(); // 借出即归还，留一块空闲
+    ASSERT_EQ(pool->stats().idle, 1u);
+
+    pool->set_buffer_size(64);
+    EXPECT_EQ(pool->buffer_size(), 64u);
+    EXPECT_EQ(pool->stats().idle, 0u);
+    // 旧尺寸缓冲归还时直接释放
+    old_buffer.reset();
+    EXPECT_EQ(pool->stats().idle, 0u);
+    EXPECT_EQ(pool->stats().in_use, 0u);
+    EXPECT_GE(pool->acquire()->capacity(), 64u);
+}
+
+TEST(VideoFramePool, BufferOutlivesPool) {
+    auto pool = VideoFramePool::create(16);
+    auto buffer = pool->acquire();
+    buffer->data()[15] = 7;
+    pool.reset();
+    // 池已销毁，缓冲仍可用，释放时直接 delete
+    EXPECT_EQ(buffer->data()[15], 7);
+    buffer.reset();
+}
+
+// ==================== ColorBarSource ====================
+
+TEST(ColorBarSource, FramesShareReadOnlyBuffer) {
+    ColorBarSource source(64, 48, 30);
+    VideoFrame a{}, b{};
+    ASSERT_TRUE(source.get_frame(a));
+    ASSERT_TRUE(source.get_frame(b));
+    ASSERT_NE(a.owner, nullptr);
+    EXPECT_EQ(a.data, b.data);
+    EXPECT_EQ(a.size, 64u * 48 * 2);
+    EXPECT_EQ(source.max_frame_size(), a.size);
+}
+
+TEST(ColorBarSource, HeldFrameSurvivesFormatChange) {
+    ColorBarSource source(64, 48, 30);
+    VideoFrame held{};
+    ASSERT_TRUE(source.get_frame(held));
+    std::vector<std::uint8_t> before(held.data, held.data + held.size);
+
+    // 切格式后旧帧仍由 owner 保活且内容不变（handler 可能正发到一半）
+    ASSERT_TRUE(source.set_format(UvcFourCC::YUY2, 32, 16, 333333));
+    VideoFrame next{};
+    ASSERT_TRUE(source.get_frame(next));
+    EXPECT_EQ(next.size, 32u * 16 * 2);
+    EXPECT_NE(next.data, held.data);
+    EXPECT_EQ(std::vector<std::uint8_t>(held.data, held.data + held.size), before);
+}
+
+TEST(ColorBarSource, ListsEverySizeAndSwitchesOnSetFormat) {
+    ColorBarSource source({{64, 48}, {32, 16}}, 30);
+    auto formats = source.supported_formats();
+    ASSERT_EQ(formats.size(), 2u);
+    EXPECT_EQ(formats[1].width, 32u);
+    EXPECT_EQ(formats[1].max_frame_size, 32u * 16 * 2);
+    EXPECT_EQ(source.current_format().width, 64u);
+
+    // 帧率范围固定为构造时的值，切换只改当前分辨率与帧间隔
+    ASSERT_TRUE(source.set_format(UvcFourCC::YUY2, 32, 16, formats[1].min_frame_interval * 2));
+    EXPECT_EQ(source.current_format().width, 32u);
+    EXPECT_EQ(source.frame_interval(), formats[1].min_frame_interval * 2);
+    EXPECT_EQ(source.supported_formats()[1].min_frame_interval, formats[1].min_frame_interval);
+    EXPECT_EQ(source.max_frame_size(), 32u * 16 * 2);
+}
+
+// ==================== PixelConvert ====================
+
+namespace {
+
+/// 带行填充的图像缓冲：每行多出 pad 字节，填充区写哨兵值用来检查越界写
+struct PaddedImage {
+    PixelFormat format;
+    int width;
+    int height;
+    std::vector<std::uint8_t> bytes;
+    MutableImagePlanes planes{};
+
+    PaddedImage(PixelFormat f, int w, int h, std::size_t pad = 13) : format(f), width(w), height(h) {
+        std::vector<std::uint8_t> tight_bytes(pixel_image_size(f, w, h));
+        auto tight = pixel_image_planes(f, tight_bytes.data(), w, h);
+        std::array<std::size_t, 3> rows{static_cast<std::size_t>(h), static_cast<std::size_t>((h + 1) / 2),
+                                        static_cast<std::size_t>((h + 1) / 2)};
+        std::array<std::size_t, 3> offsets{};
+        std::size_t total = 0;
+        for (int i = 0; i < 3; ++i) {
+            if (tight.stride[i] == 0)
+                continue;
+            planes.stride[i] = tight.stride[i] + pad;
+            offsets[i] = total;
+            total += planes.stride[i] * rows[i];
+        }
+        bytes.assign(total, 0xA5);
+        for (int i = 0; i < 3; ++i)
+            if (planes.stride[i] != 0)
+                planes.data[i] = bytes.data() + offsets[i];
+    }
+
+    void randomize(std::mt19937 &rng) {
+        for (auto &b: bytes)
+            b = static_cast<std::uint8_t>(rng());
+    }
+};
+
+/// 依次用每个可用档位转换，与 Scalar 的结果逐字节比较（含行填充区，越界写会被发现）
+void expect_levels_match_scalar(PixelFormat from, PixelFormat to, int width, int height) {
+    std::mt19937 rng(width * 131 + height);
+    PaddedImage src(from, width, height);
+    src.randomize(rng);
+
+    auto previous = pixel_convert_simd_level();
+    set_pixel_convert_simd_level(SimdLevel::Scalar);
+    PaddedImage expected(to, width, height);
+    ASSERT_TRUE(convert_pixels(from, src.planes, to, expected.planes, width, height));
+
+    for (auto level: {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON}) {
+        if (set_pixel_convert_simd_level(level) != level)
+            continue;
+        PaddedImage actual(to, width, height);
+        ASSERT_TRUE(convert_pixels(from, src.planes, to, actual.planes, width, height));
+        EXPECT_EQ(actual.bytes, expected.bytes) << simd_level_name(level) << " " << static_cast<int>(from) << "->" << static_cast<int>(to) << " "
+                                              << width << "x" << height;
+    }
+    set_pixel_convert_simd_level(previous);
+}
+
+} // namespace
+
+TEST(PixelConvert, EveryLevelMatchesScalar) {
+    const PixelFormat others[] = {PixelFormat::RGB24, PixelFormat::RGBA, PixelFormat::BGRA, PixelFormat::NV12,
+                                  PixelFormat::I420};
+    // 宽度覆盖整块、块尾与行尾余量不足 SIMD 读写的情况；奇数高度覆盖色度单独成行
+    for (int width: {2, 18, 70, 130})
+        for (int height: {1, 5}) {
+            for (auto format: others) {
+                expect_levels_match_scalar(format, PixelFormat::YUY2, width, height);
+                expect_levels_match_scalar(PixelFormat::YUY2, format, width, height);
+            }
+            expect_levels_match_scalar(PixelFormat::YUY2, PixelFormat::YUY2, width, height);
+        }
+}
+
+TEST(PixelConvert, KnownColorsMatchBt601) {
+    // 白、黑、纯红、纯蓝 → 有限范围 YUV
+    const std::uint8_t rgb[] = {255, 255, 255, 0, 0, 0, 255, 0, 0, 255, 0, 0, 0, 0, 255, 0, 0, 255};
+    std::uint8_t yuy2[12]{};
+    MutableImagePlanes dst = pixel_image_planes(PixelFormat::YUY2, yuy2, 6, 1);
+    ImagePlanes src{{rgb}, {sizeof(rgb)}};
+    ASSERT_TRUE(convert_pixels(PixelFormat::RGB24, src, PixelFormat::YUY2, dst, 6, 1));
+    EXPECT_EQ(yuy2[0], 235); // Y 白
+    EXPECT_EQ(yuy2[2], 16); // Y 黑
+    EXPECT_EQ(yuy2[1], 128); // 灰阶平均无色度
+    EXPECT_EQ(yuy2[4], 82); // Y 红
+    EXPECT_EQ(yuy2[7], 240); // V 红
+    EXPECT_EQ(yuy2[8], 41); // Y 蓝
+    EXPECT_EQ(yuy2[9], 240); // U 蓝
+}
+
+TEST(PixelConvert, RoundTripStaysClose) {
+    std::mt19937 rng(7);
+    const int width = 64, height = 4;
+    // 每对像素颜色相同，色度下采样不损失信息，只剩量化误差
+    std::vector<std::uint8_t> rgba(pixel_image_size(PixelFormat::RGBA, width, height));
+    for (std::size_t i = 0; i < rgba.size(); i += 8)
+        for (int c = 0; c < 4; ++c)
+            rgba[i + c] = rgba[i + 4 + c] = static_cast<std::uint8_t>(rng());
+    std::vector<std::uint8_t> yuy2(pixel_image_size(PixelFormat::YUY2, width, height));
+    std::vector<std::uint8_t> back(rgba.size());
+    auto rgba_planes = pixel_image_planes(PixelFormat::RGBA, rgba.data(), width, height);
+    ASSERT_TRUE(convert_pixels(PixelFormat::RGBA, rgba_planes, PixelFormat::YUY2,
+                               pixel_image_planes(PixelFormat::YUY2, yuy2.data(), width, height), width, height));
+    auto yuy2_planes = pixel_image_planes(PixelFormat::YUY2, yuy2.data(), width, height);
+    ASSERT_TRUE(convert_pixels(PixelFormat::YUY2, yuy2_planes, PixelFormat::RGBA,
+                               pixel_image_planes(PixelFormat::RGBA, back.data(), width, height), width, height));
+    for (std::size_t i = 0; i < rgba.size(); ++i) {
+        if (i % 4 == 3)
+            EXPECT_EQ(back[i], 255);
+        else
+            EXPECT_LE(std::abs(back[i] - rgba[i]), 3) << "byte " << i;
+    }
+}
+
+TEST(PixelConvert, RejectsOddWidthAndUnsupportedPairs) {
+    std::vector<std::uint8_t> a(pixel_image_size(PixelFormat::RGBA, 8, 2));
+    std::vector<std::uint8_t> b(pixel_image_size(PixelFormat::I420, 8, 2));
+    auto rgba = pixel_image_planes(PixelFormat::RGBA, a.data(), 8, 2);
+    auto i420 = pixel_image_planes(PixelFormat::I420, b.data(), 8, 2);
+    EXPECT_FALSE(convert_pixels(PixelFormat::RGBA, rgba, PixelFormat::I420, i420, 8, 2));
+    EXPECT_FALSE(convert_pixels(PixelFormat::YUY2, rgba, PixelFormat::I420, i420, 7, 2));
+    EXPECT_FALSE(convert_pixels(PixelFormat::YUY2, rgba, PixelFormat::I420, i420, 8, 0));
+    EXPECT_EQ(pixel_image_size(PixelFormat::I420, 8, 3), 8u * 3 + 2 * 4 * 2);
+}
+
+TEST(PixelConvert, UnsupportedLevelFallsBackToDetected) {
+    auto previous = pixel_convert_simd_level();
+    EXPECT_EQ(set_pixel_convert_simd_level(SimdLevel::Scalar), SimdLevel::Scalar);
+    EXPECT_EQ(pixel_convert_simd_level(), SimdLevel::Scalar);
+    // CPU 不支持的档位（如 x86 上的 NEON）退回检测到的档位
+    for (auto level: {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::NEON}) {
+        auto effective = set_pixel_convert_simd_level(level);
+        EXPECT_TRUE(effective == level || effective == detect_simd_level()) << simd_level_name(level);
+        EXPECT_EQ(pixel_convert_simd_level(), effective);
+    }
+    set_pixel_convert_simd_level(previous);
+}
+
+// ==================== MjpegEncoderSource ====================
+
+namespace {
+
+/// 渐变 + 帧号的原始帧源（YUY2 或 NV12），data 由源管理、不设 owner
+class GradientSource : public VideoSource {
+public:
+    GradientSource(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height) :
+        fourcc_(fourcc), width_(width), height_(height) {
+    }
+
+    std::vector<VideoFormatInfo> supported_formats() const override {
+        return {info()};
+    }
+
+    VideoFormatInfo current_format() const override {
+        return info();
+    }
+
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height, std::uint32_t) override {
+        return fourcc == fourcc_ && width == width_ && height == height_;
+    }
+
+    bool get_frame(VideoFrame &frame) override {
+        if (delay_.count() > 0)
+            std::this_thread::sleep_for(delay_);
+        auto format = fourcc_ == UvcFourCC::YUY2 ? PixelFormat::YUY2 : PixelFormat::NV12;
+        frame_.resize(pixel_image_size(format, width_, height_));
+        auto planes = pixel_image_planes(format, frame_.data(), width_, height_);
+        for (int y = 0; y < height_; ++y)
+            for (int x = 0; x < width_; ++x) {
+                auto luma = static_cast<std::uint8_t>(16 + (x * 3 + y * 2 + counter_) % 220);
+                auto chroma = static_cast<std::uint8_t>(64 + (x + y * 3) % 128);
+                if (format == PixelFormat::YUY2) {
+                    planes.data[0][y * planes.stride[0] + x * 2] = luma;
+                    planes.data[0][y * planes.stride[0] + x * 2 + 1] = chroma;
+                }
+                else {
+                    planes.data[0][y * planes.stride[0] + x] = luma;
+                    if (y % 2 == 0)
+                        planes.data[1][y / 2 * planes.stride[1] + x] = chroma;
+                }
+            }
+        ++counter_;
+        ++frames_;
+        frame = {frame_.data(), frame_.size(), true, nullptr};
+        return true;
+    }
+
+    std::size_t max_frame_size() const override {
+        return info().max_frame_size;
+    }
+
+    std::uint32_t frame_interval() const override {
+        return 333333;
+    }
+
+    int frames() const {
+        return frames_.load();
+    }
+
+    std::chrono::milliseconds delay_{0};
+
+private:
+    VideoFormatInfo info() const {
+        auto format = fourcc_ == UvcFourCC::YUY2 ? PixelFormat::YUY2 : PixelFormat::NV12;
+        return {fourcc_, width_, height_, static_cast<std::uint32_t>(pixel_image_size(format, width_, height_)),
+                333333,  333333, 333333,  16};
+    }
+
+    std::uint32_t fourcc_;
+    std::uint16_t width_;
+    std::uint16_t height_;
+    int counter_ = 0;
+    std::atomic<int> frames_{0}; // 流水线线程里递增，测试线程读取
+    std::vector<std::uint8_t> frame_;
+};
+
+MjpegEncoderOptions encoder_options(std::size_t slices, bool pipeline = false) {
+    MjpegEncoderOptions options;
+    options.quality = 90;
+    options.threads = slices;
+    options.slices = slices;
+    options.pipeline = pipeline;
+    return options;
+}
+
+std::vector<std::uint8_t> take_frame(VideoSource &source) {
+    VideoFrame frame{};
+    if (!source.get_frame(frame))
+        return {};
+    return {frame.data, frame.data + frame.size};
+}
+
+/// 统计熵编码段中的 RSTn 标记
+int count_restart_markers(const std::vector<std::uint8_t> &jpeg) {
+    int count = 0;
+    for (std::size_t i = 0; i + 1 < jpeg.size(); ++i)
+        if (jpeg[i] == 0xFF && jpeg[i + 1] >= 0xD0 && jpeg[i + 1] <= 0xD7)
+            ++count;
+    return count;
+}
+
+#ifdef USBIPDCPP_HAVE_LIBJPEG
+/// 解码为 YCbCr 交错像素（不做颜色转换，直接比较 DCT 结果）
+bool decode_jpeg(const std::vector<std::uint8_t> &jpeg, int &width, int &height, std::vector<std::uint8_t> &pixels) {
+    jpeg_decompress_struct cinfo{};
+    jpeg_error_mgr err{};
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, jpeg.data(), static_cast<unsigned long>(jpeg.size()));
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    cinfo.out_color_space = JCS_YCbCr;
+    jpeg_start_decompress(&cinfo);
+    width = static_cast<int>(cinfo.output_width);
+    height = static_cast<int>(cinfo.output_height);
+    pixels.resize(static_cast<std::size_t>(width) * height * 3);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = pixels.data() + static_cast<std::size_t>(cinfo.output_scanline) * width * 3;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    bool clean = err.num_warnings == 0;
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return clean;
+}
+#endif
+
+} // namespace
+
+TEST(MjpegEncoderSource, ListsMjpegBeforeRawFormats) {
+    if (!MjpegEncoderSource::available())
+        GTEST_SKIP() << "libjpeg not compiled in";
+    MjpegEncoderSource source(std::make_unique<GradientSource>(UvcFourCC::YUY2, 64, 48), encoder_options(1));
+    auto formats = source.supported_formats();
+    ASSERT_EQ(formats.size(), 2u);
+    EXPECT_EQ(formats[0].fourcc, UvcFourCC::MJPEG);
+    EXPECT_EQ(formats[0].width, 64u);
+    EXPECT_EQ(formats[1].fourcc, UvcFourCC::YUY2);
+    EXPECT_EQ(source.current_format().fourcc, UvcFourCC::MJPEG);
+
+    auto options = encoder_options(1);
+    options.keep_uncompressed = false;
+    MjpegEncoderSource only_mjpeg(std::make_unique<GradientSource>(UvcFourCC::YUY2, 64, 48), options);
+    EXPECT_EQ(only_mjpeg.supported_formats().size(), 1u);
+}
+
+TEST(MjpegEncoderSource, SlicesAreStitchedWithRestartMarkers) {
+    if (!MjpegEncoderSource::available())
+        GTEST_SKIP() << "libjpeg not compiled in";
+    // 120 行 = 15 个 MCU 行，4 个条带为 4 + 4 + 4 + 3
+    MjpegEncoderSource source(std::make_unique<GradientSource>(UvcFourCC::YUY2, 160, 120), encoder_options(4));
+    auto jpeg = take_frame(source);
+    ASSERT_GT(jpeg.size(), 4u);
+    EXPECT_EQ(jpeg[0], 0xFF);
+    EXPECT_EQ(jpeg[1], 0xD8);
+    EXPECT_EQ(jpeg[jpeg.size() - 2], 0xFF);
+    EXPECT_EQ(jpeg.back(), 0xD9);
+    EXPECT_EQ(count_restart_markers(jpeg), 3);
+    EXPECT_EQ(source.encode_stats().slices, 4u);
+    EXPECT_LE(jpeg.size(), source.max_frame_size());
+}
+
+#ifdef USBIPDCPP_HAVE_LIBJPEG
+TEST(MjpegEncoderSource, SlicedFrameDecodesLikeSingleSlice) {
+    // 条带各自编码只重置 DC 预测，解码结果与整帧编码逐像素相同
+    for (auto fourcc: {UvcFourCC::YUY2, UvcFourCC::NV12}) {
+        MjpegEncoderSource whole(std::make_unique<GradientSource>(fourcc, 160, 72), encoder_options(1));
+        MjpegEncoderSource sliced(std::make_unique<GradientSource>(fourcc, 160, 72), encoder_options(3));
+        auto a = take_frame(whole);
+        auto b = take_frame(sliced);
+        EXPECT_EQ(count_restart_markers(a), 0);
+        EXPECT_GT(count_restart_markers(b), 0);
+
+        int wa = 0, ha = 0, wb = 0, hb = 0;
+        std::vector<std::uint8_t> pa, pb;
+        ASSERT_TRUE(decode_jpeg(a, wa, ha, pa));
+        ASSERT_TRUE(decode_jpeg(b, wb, hb, pb));
+        EXPECT_EQ(wb, 160);
+        EXPECT_EQ(hb, 72);
+        EXPECT_EQ(pa, pb);
+    }
+}
+
+TEST(MjpegEncoderSource, DecodedLumaMatchesSource) {
+    auto inner = std::make_unique<GradientSource>(UvcFourCC::YUY2, 64, 48);
+    VideoFrame raw{};
+    GradientSource reference(UvcFourCC::YUY2, 64, 48);
+    ASSERT_TRUE(reference.get_frame(raw));
+    MjpegEncoderSource source(std::move(inner), encoder_options(2));
+    auto jpeg = take_frame(source);
+
+    int width = 0, height = 0;
+    std::vector<std::uint8_t> pixels;
+    ASSERT_TRUE(decode_jpeg(jpeg, width, height, pixels));
+    // 有限范围 Y 扩展到全范围后比较，质量 90 下平均误差应很小
+    double total = 0;
+    for (int i = 0; i < width * height; ++i) {
+        double expected = (raw.data[i * 2] - 16) * 255.0 / 219.0;
+        total += std::abs(pixels[i * 3] - expected);
+    }
+    EXPECT_LT(total / (width * height), 3.0);
+}
+#endif
+
+TEST(MjpegEncoderSource, PipelinePrefetchesNextFrame) {
+    if (!MjpegEncoderSource::available())
+        GTEST_SKIP() << "libjpeg not compiled in";
+    auto inner = std::make_unique<GradientSource>(UvcFourCC::YUY2, 64, 48);
+    auto *gradient = inner.get();
+    MjpegEncoderSource source(std::move(inner), encoder_options(2, true));
+    EXPECT_FALSE(take_frame(source).empty());
+    // 交出第一帧后流水线马上开始取第二帧
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (gradient->frames() < 2 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_EQ(gradient->frames(), 2);
+    EXPECT_FALSE(take_frame(source).empty());
+    auto stats = source.encode_stats();
+    EXPECT_EQ(stats.frames, 2u);
+    EXPECT_GT(stats.output_bytes, 0u);
+    EXPECT_EQ(stats.input_bytes, 64u * 48 * 2 * 2);
+}
+
+TEST(MjpegEncoderSource, RawFormatIsPassedThrough) {
+    auto inner = std::make_unique<GradientSource>(UvcFourCC::YUY2, 64, 48);
+    MjpegEncoderSource source(std::move(inner), encoder_options(2, true));
+    ASSERT_TRUE(source.set_format(UvcFourCC::YUY2, 64, 48, 333333));
+    EXPECT_EQ(source.current_format().fourcc, UvcFourCC::YUY2);
+    EXPECT_EQ(source.max_frame_size(), 64u * 48 * 2);
+    EXPECT_EQ(take_frame(source).size(), 64u * 48 * 2);
+    EXPECT_EQ(source.encode_stats().frames, 0u);
+}
+
+TEST(MjpegEncoderSource, BitrateTargetLowersQuality) {
+    if (!MjpegEncoderSource::available())
+        GTEST_SKIP() << "libjpeg not compiled in";
+    auto options = encoder_options(1);
+    options.quality = 95;
+    options.target_kbps = 8; // 30 fps 下每帧约 33 字节，远小于任何 JPEG
+    MjpegEncoderSource source(std::make_unique<GradientSource>(UvcFourCC::YUY2, 64, 48), options);
+    for (int i = 0; i < 20; ++i)
+        ASSERT_FALSE(take_frame(source).empty());
+    EXPECT_EQ(source.encode_stats().quality, options.min_quality);
+
+    source.set_quality(70);
+    ASSERT_FALSE(take_frame(source).empty());
+    EXPECT_EQ(source.encode_stats().quality, 70);
+}
+
+// ==================== AsyncVideoSource ====================
+
+namespace {
+
+/// 每帧整帧填同一个字节（帧序号），可设取帧耗时与失败；帧不带 owner
+class CountingSource : public VideoSource {
+public:
+    explicit CountingSource(std::uint32_t interval = 100000) : interval_(interval) {
+    }
+
+    std::vector<VideoFormatInfo> supported_formats() const override {
+        return {current_format()};
+    }
+
+    VideoFormatInfo current_format() const override {
+        return {UvcFourCC::YUY2, 16, 8, 16 * 8 * 2, interval_, interval_, interval_, 16};
+    }
+
+    bool set_format(std::uint32_t fourcc, std::uint16_t width, std::uint16_t height,
+                    std::uint32_t frame_interval) override {
+        if (fourcc != UvcFourCC::YUY2 || width != 16 || height != 8)
+            return false;
+        interval_ = frame_interval;
+        return true;
+    }
+
+    bool get_frame(VideoFrame &frame) override {
+        auto d = delay.load();
+        if (d.count() > 0)
+            std::this_thread::sleep_for(d);
+        if (fail)
+            return false;
+        auto n = ++frames_;
+        frame_.assign(16 * 8 * 2, static_cast<std::uint8_t>(n));
+        frame = {frame_.data(), frame_.size(), true, nullptr};
+        return true;
+    }
+
+    std::size_t max_frame_size() const override {
+        return 16 * 8 * 2;
+    }
+
+    std::uint32_t frame_interval() const override {
+        return interval_;
+    }
+
+    int frames() const {
+        return frames_.load();
+    }
+
+    std::atomic<std::chrono::milliseconds> delay{std::chrono::milliseconds(0)};
+    std::atomic<bool> fail{false};
+
+private:
+    std::uint32_t interval_; // 100ns 单位
+    std::atomic<int> frames_{0};
+    std::vector<std::uint8_t> frame_;
+};
+
+template<typename Pred>
+bool wait_until(Pred pred) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(AsyncVideoSource, SlowSourceDoesNotBlockGetFrame) {
+    // 内层每帧 50ms，帧间隔 10ms：get_frame 不等内层，重发上一帧
+    auto inner = std::make_unique<CountingSource>();
+    inner->delay = std::chrono::milliseconds(50);
+    AsyncVideoSource source(std::move(inner));
+
+    VideoFrame frame{};
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(frame) && frame.size > 0; }));
+    std::uint8_t first = frame.data[0];
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; ++i)
+        ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(40));
+
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(frame) && frame.data[0] != first; }));
+    EXPECT_EQ(frame.data[0], first + 1);
+    auto stats = source.stats();
+    EXPECT_GE(stats.repeated, 10u);
+    EXPECT_GE(stats.delivered, 2u);
+    EXPECT_EQ(stats.dropped, 0u);
+}
+
+TEST(AsyncVideoSource, SkipPolicyHandsOutEmptyFrames) {
+    auto inner = std::make_unique<CountingSource>();
+    inner->delay = std::chrono::milliseconds(50);
+    AsyncVideoSourceOptions options;
+    options.underrun = FrameUnderrunPolicy::Skip;
+    AsyncVideoSource source(std::move(inner), options);
+
+    VideoFrame frame{};
+    ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_EQ(frame.size, 0u); // 首帧还没出来
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(frame) && frame.size > 0; }));
+    ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_EQ(frame.size, 0u);
+    EXPECT_EQ(frame.owner, nullptr);
+
+    auto stats = source.stats();
+    EXPECT_GE(stats.skipped, 2u);
+    EXPECT_EQ(stats.repeated, 0u);
+}
+
+TEST(AsyncVideoSource, FastSourceDropsUndeliveredFrames) {
+    // 内层 200 fps，handler 每 30ms 取一次：总拿到最新一帧，中间的被顶掉
+    auto counting = std::make_unique<CountingSource>(50000);
+    auto *inner = counting.get();
+    AsyncVideoSource source(std::move(counting));
+
+    VideoFrame frame{};
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(frame) && frame.size > 0; }));
+    for (int i = 0; i < 5; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        // 内层已经开始第 n 帧时，第 n - 1 帧必然已经交出
+        auto started = inner->frames();
+        ASSERT_TRUE(source.get_frame(frame));
+        ASSERT_GT(frame.size, 0u);
+        EXPECT_GE(frame.data[0] + 1, started);
+    }
+    auto stats = source.stats();
+    EXPECT_GT(stats.dropped, 0u);
+    EXPECT_LE(stats.delivered + stats.dropped, stats.produced);
+}
+
+TEST(AsyncVideoSource, HeldFrameIsNotOverwritten) {
+    // 内层不带 owner 的帧被拷进池化缓冲：handler 持有期间内容不变
+    AsyncVideoSource source(std::make_unique<CountingSource>(50000));
+    VideoFrame held{};
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(held) && held.size > 0; }));
+    ASSERT_NE(held.owner, nullptr);
+    std::vector<std::uint8_t> copy(held.data, held.data + held.size);
+
+    VideoFrame next{};
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(next) && next.data[0] != copy[0]; }));
+    EXPECT_EQ(std::vector<std::uint8_t>(held.data, held.data + held.size), copy);
+}
+
+TEST(AsyncVideoSource, SetFormatRestartsWithNewInterval) {
+    AsyncVideoSource source(std::make_unique<CountingSource>());
+    VideoFrame frame{};
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(frame) && frame.size > 0; }));
+
+    EXPECT_FALSE(source.set_format(UvcFourCC::MJPEG, 16, 8, 200000));
+    ASSERT_TRUE(source.set_format(UvcFourCC::YUY2, 16, 8, 200000));
+    EXPECT_EQ(source.frame_interval(), 200000u);
+    EXPECT_EQ(source.current_format().default_frame_interval, 200000u);
+    // 切换后旧帧不再交出
+    ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_EQ(frame.size, 0u);
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(frame) && frame.size > 0; }));
+}
+
+TEST(AsyncVideoSource, FailingSourceIsRetried) {
+    auto counting = std::make_unique<CountingSource>();
+    auto *inner = counting.get();
+    inner->fail = true;
+    AsyncVideoSource source(std::move(counting));
+    VideoFrame frame{};
+    ASSERT_TRUE(source.get_frame(frame));
+    ASSERT_TRUE(wait_until([&] { return source.stats().source_errors >= 2; }));
+    ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_EQ(frame.size, 0u);
+
+    inner->fail = false;
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(frame) && frame.size > 0; }));
+}
+
+TEST(AsyncVideoSource, ProducerParksWhenNobodyPulls) {
+    auto counting = std::make_unique<CountingSource>(50000);
+    auto *inner = counting.get();
+    AsyncVideoSourceOptions options;
+    options.idle_timeout = std::chrono::milliseconds(30);
+    AsyncVideoSource source(std::move(counting), options);
+    VideoFrame frame{};
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(frame) && frame.size > 0; }));
+    frame = {};
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto parked_at = inner->frames();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(inner->frames(), parked_at);
+
+    // 再次取帧唤醒生产线程
+    ASSERT_TRUE(wait_until([&] { return source.get_frame(frame) && frame.size > 0; }));
+    EXPECT_GT(inner->frames(), parked_at);
+}
+
+// ==================== ShmVideoSource ====================
+
+#if defined(__linux__) && !defined(__ANDROID__)
+namespace {
+
+VideoFormatInfo shm_format() {
+    return {UvcFourCC::YUY2, 32, 16, 32 * 16 * 2, 333333, 333333, 333333, 16};
+}
+
+/// 同进程内按 shm_video_ring.h 写一帧，整帧填 value；槽位都被钉住时返回 false
+bool publish(void *ring, std::uint8_t value, std::uint32_t size = 32 * 16 * 2) {
+    std::uint32_t slot = 0;
+    auto *data = usbipdcpp_shm_video_begin(ring, &slot);
+    if (!data)
+        return false;
+    std::memset(data, value, size);
+    return usbipdcpp_shm_video_commit(ring, slot, size, USBIPDCPP_SHM_VIDEO_KEYFRAME, 0) != 0;
+}
+
+bool points_into(const ShmVideoSource &source, const VideoFrame &frame) {
+    auto *base = static_cast<const std::uint8_t *>(source.ring());
+    return frame.data >= base && frame.data + frame.size <= base + source.ring_size();
+}
+
+} // namespace
+
+TEST(ShmVideoSource, ForkedProducerFramesAreStreamedInPlace) {
+    ShmVideoSource source(shm_format());
+    ASSERT_TRUE(source.is_valid());
+    auto fd = source.fd();
+    auto event_fd = source.event_fd();
+    auto size = source.ring_size();
+
+    // 子进程只继承 fd，自己映射：与外部生产者进程的做法相同
+    pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        void *ring = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ring == MAP_FAILED || usbipdcpp_shm_video_check(ring, size) != 0)
+            ::_exit(1);
+        for (std::uint8_t value = 1; value <= 3; ++value) {
+            if (!publish(ring, value))
+                ::_exit(2);
+            usbipdcpp_shm_video_notify(event_fd);
+            ::usleep(20000);
+        }
+        ::_exit(0);
+    }
+
+    std::vector<std::uint8_t> seen;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((seen.empty() || seen.back() != 3) && std::chrono::steady_clock::now() < deadline) {
+        if (!source.wait_frame(std::chrono::milliseconds(100)))
+            continue;
+        VideoFrame frame{};
+        ASSERT_TRUE(source.get_frame(frame));
+        ASSERT_EQ(frame.size, 32u * 16 * 2);
+        EXPECT_TRUE(points_into(source, frame));
+        EXPECT_EQ(frame.data[frame.size - 1], frame.data[0]);
+        seen.push_back(frame.data[0]);
+    }
+    int status = 0;
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    // 取帧慢于生产者时可能跳过中间帧，但每次都是更新的一帧
+    ASSERT_FALSE(seen.empty());
+    EXPECT_EQ(seen.back(), 3);
+    EXPECT_TRUE(std::is_sorted(seen.begin(), seen.end()));
+    EXPECT_EQ(std::adjacent_find(seen.begin(), seen.end()), seen.end());
+    EXPECT_EQ(source.stats().frames, seen.size());
+    EXPECT_EQ(source.stats().repeated, 0u);
+}
+
+TEST(ShmVideoSource, EmptyUntilFirstFrameThenRepeats) {
+    ShmVideoSource source(shm_format());
+    ASSERT_TRUE(source.is_valid());
+    VideoFrame frame{};
+    ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_EQ(frame.size, 0u);
+    EXPECT_FALSE(source.wait_frame(std::chrono::milliseconds(5)));
+
+    ASSERT_TRUE(publish(source.ring(), 7));
+    EXPECT_TRUE(source.wait_frame(std::chrono::milliseconds(5)));
+    ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_EQ(frame.data[0], 7);
+    ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_EQ(frame.data[0], 7);
+
+    for (std::uint8_t value = 8; value <= 10; ++value)
+        ASSERT_TRUE(publish(source.ring(), value));
+    ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_EQ(frame.data[0], 10);
+
+    auto stats = source.stats();
+    EXPECT_EQ(stats.frames, 2u);
+    EXPECT_EQ(stats.repeated, 1u);
+    EXPECT_EQ(stats.missed, 2u);
+}
+
+TEST(ShmVideoSource, PinnedSlotsAreNeverOverwritten) {
+    ShmVideoSource source(shm_format(), {"", 4});
+    ASSERT_TRUE(source.is_valid());
+    std::vector<VideoFrame> held;
+    for (std::uint8_t value = 1; value <= 3; ++value) {
+        ASSERT_TRUE(publish(source.ring(), value));
+        VideoFrame frame{};
+        ASSERT_TRUE(source.get_frame(frame));
+        held.push_back(frame);
+    }
+    // 三个槽位被钉住，第四个是最新帧：生产者没有可写的槽位，只能丢帧
+    ASSERT_TRUE(publish(source.ring(), 4));
+    EXPECT_FALSE(publish(source.ring(), 5));
+    for (std::uint8_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(held[i].data[0], i + 1);
+        EXPECT_EQ(held[i].data[held[i].size - 1], i + 1);
+    }
+
+    // 放开一帧，生产者接着写，被钉住的其余帧不受影响
+    held.erase(held.begin());
+    for (std::uint8_t value = 5; value < 20; ++value)
+        ASSERT_TRUE(publish(source.ring(), value));
+    EXPECT_EQ(held[0].data[0], 2);
+    EXPECT_EQ(held[1].data[0], 3);
+}
+
+TEST(ShmVideoSource, ProducerCannotRedirectOrOversizeFrames) {
+    ShmVideoSource source(shm_format());
+    ASSERT_TRUE(source.is_valid());
+    auto *header = static_cast<usbipdcpp_shm_video_header *>(source.ring());
+    ASSERT_TRUE(publish(source.ring(), 5));
+
+    // 环头里的布局字段生产者可写，服务端按自己的参数算槽位地址，帧仍在映射内
+    header->data_offset = std::uint64_t{1} << 40;
+    header->slot_stride = std::uint64_t{1} << 40;
+    VideoFrame frame{};
+    ASSERT_TRUE(source.get_frame(frame));
+    ASSERT_EQ(frame.size, 32u * 16 * 2);
+    EXPECT_TRUE(points_into(source, frame));
+    EXPECT_EQ(frame.data[0], 5);
+    frame = {};
+
+    // 发布后再改大 size：拒绝这一帧，不会越过槽位
+    auto slot = static_cast<std::uint32_t>(header->latest & 0xFF);
+    header->slots[slot].size = 1u << 30;
+    EXPECT_FALSE(source.get_frame(frame));
+
+    // 不守协议地改写最新槽位（seq 置奇数）：不交出这一帧
+    header->slots[slot].size = 32 * 16 * 2;
+    header->slots[slot].seq |= 1;
+    auto retries = source.stats().retries;
+    ASSERT_TRUE(source.get_frame(frame));
+    EXPECT_EQ(frame.size, 0u);
+    EXPECT_GT(source.stats().retries, retries);
+    EXPECT_EQ(header->slots[slot].readers, 0u);
+}
+
+TEST(ShmVideoSource, FramesOutliveSource) {
+    VideoFrame frame{};
+    {
+        ShmVideoSource source(shm_format());
+        ASSERT_TRUE(publish(source.ring(), 9));
+        ASSERT_TRUE(source.get_frame(frame));
+    }
+    // 映射随最后一个帧 owner 释放
+    EXPECT_EQ(frame.data[0], 9);
+    EXPECT_EQ(frame.data[frame.size - 1], 9);
+}
+
+TEST(ShmVideoSource, NamedRingIsOpenedByNameAndRemovedWithSource) {
+    auto name = "/usbipdcpp-test-" + std::to_string(::getpid());
+    {
+        ShmVideoSource source(shm_format(), {name, 3});
+        ASSERT_TRUE(source.is_valid());
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        ASSERT_GE(fd, 0);
+        void *ring = ::mmap(nullptr, source.ring_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        ASSERT_NE(ring, MAP_FAILED);
+        ASSERT_EQ(usbipdcpp_shm_video_check(ring, source.ring_size()), 0);
+        auto *header = static_cast<usbipdcpp_shm_video_header *>(ring);
+        EXPECT_EQ(header->width, 32u);
+        EXPECT_EQ(header->slot_count, 3u);
+        ASSERT_TRUE(publish(ring, 5));
+        ::munmap(ring, source.ring_size());
+
+        VideoFrame frame{};
+        ASSERT_TRUE(source.get_frame(frame));
+        EXPECT_EQ(frame.data[0], 5);
+        EXPECT_FALSE(source.set_format(UvcFourCC::YUY2, 64, 16, 333333));
+        EXPECT_TRUE(source.set_format(UvcFourCC::YUY2, 32, 16, 666666));
+        EXPECT_EQ(source.frame_interval(), 666666u);
+    }
+    EXPECT_LT(::shm_open(name.c_str(), O_RDWR, 0), 0);
+}
+#endif
+
+// ==================== VideoBroadcaster ====================
+
+TEST(VideoBroadcaster, FramesAreProducedOnceAndShared) {
+    // 源 10 fps：三个订阅者拿到的是同一块缓冲，源的取帧次数与订阅者数无关
+    auto counting = std::make_unique<CountingSource>(1000000);
+    auto *inner = counting.get();
+    auto broadcaster = VideoBroadcaster::create(std::move(counting));
+    auto a = broadcaster->subscribe();
+    auto b = broadcaster->subscribe();
+    auto c = broadcaster->subscribe();
+    EXPECT_EQ(broadcaster->subscriber_count(), 3u);
+
+    VideoFrame fa{}, fb{}, fc{};
+    ASSERT_TRUE(wait_until([&] { return a->get_frame(fa) && fa.size > 0; }));
+    ASSERT_TRUE(b->get_frame(fb));
+    ASSERT_TRUE(c->get_frame(fc));
+    ASSERT_NE(fa.owner, nullptr);
+    EXPECT_EQ(fb.owner, fa.owner);
+    EXPECT_EQ(fc.data, fa.data);
+    EXPECT_EQ(fa.data[0], 1);
+    EXPECT_EQ(inner->frames(), 1);
+    EXPECT_EQ(broadcaster->stats().produced, 1u);
+
+    // 没有新帧时各自重发
+    ASSERT_TRUE(a->get_frame(fa));
+    EXPECT_EQ(fa.owner, fb.owner);
+    EXPECT_EQ(a->stats().delivered, 1u);
+    EXPECT_EQ(a->stats().repeated, 1u);
+}
+
+TEST(VideoBroadcaster, SlowSubscriberDropsWithoutStallingOthers) {
+    // 源 100 fps；快订阅者每 5ms 取一次，慢订阅者每 60ms 取一次并一直持有帧
+    auto broadcaster = VideoBroadcaster::create(std::make_unique<CountingSource>(100000));
+    auto fast = broadcaster->subscribe();
+    auto slow = broadcaster->subscribe();
+
+    std::atomic<bool> done{false};
+    std::thread slow_thread([&] {
+        VideoFrame held{};
+        while (!done) {
+            slow->get_frame(held);
+            std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        }
+    });
+    VideoFrame frame{};
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(400)) {
+        ASSERT_TRUE(fast->get_frame(frame));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    done = true;
+    slow_thread.join();
+
+    auto produced = broadcaster->stats().produced;
+    auto fast_stats = fast->stats();
+    auto slow_stats = slow->stats();
+    EXPECT_GE(produced, 20u);
+    EXPECT_GT(fast_stats.delivered, produced / 2);
+    EXPECT_LT(slow_stats.delivered, 10u);
+    EXPECT_GT(slow_stats.dropped, fast_stats.dropped);
+}
+
+TEST(VideoBroadcaster, FormatIsFixedAndIntervalIsPerSubscriber) {
+    auto broadcaster = VideoBroadcaster::create(std::make_unique<CountingSource>());
+    auto a = broadcaster->subscribe();
+    auto b = broadcaster->subscribe();
+    ASSERT_EQ(a->supported_formats().size(), 1u);
+    EXPECT_EQ(a->supported_formats()[0].width, 16);
+
+    EXPECT_FALSE(a->set_format(UvcFourCC::YUY2, 32, 8, 100000));
+    EXPECT_FALSE(a->set_format(UvcFourCC::MJPEG, 16, 8, 100000));
+    EXPECT_TRUE(a->set_format(UvcFourCC::YUY2, 16, 8, 333333));
+    EXPECT_EQ(a->frame_interval(), 333333u);
+    EXPECT_EQ(a->current_format().default_frame_interval, 333333u);
+    EXPECT_EQ(b->frame_interval(), 100000u);
+    EXPECT_EQ(b->max_frame_size(), 16u * 8 * 2);
+}
+
+TEST(VideoBroadcaster, SkipPolicyHandsOutEmptyFrames) {
+    auto counting = std::make_unique<CountingSource>(1000000);
+    counting->delay = std::chrono::milliseconds(30);
+    VideoBroadcasterOptions options;
+    options.underrun = FrameUnderrunPolicy::Skip;
+    auto broadcaster = VideoBroadcaster::create(std::move(counting), options);
+    auto subscriber = broadcaster->subscribe();
+
+    VideoFrame frame{};
+    ASSERT_TRUE(subscriber->get_frame(frame));
+    EXPECT_EQ(frame.size, 0u); // 首帧还没出来
+    ASSERT_TRUE(wait_until([&] { return subscriber->get_frame(frame) && frame.size > 0; }));
+    ASSERT_TRUE(subscriber->get_frame(frame));
+    EXPECT_EQ(frame.size, 0u);
+    EXPECT_GE(subscriber->stats().skipped, 2u);
+}
+
+TEST(VideoBroadcaster, ProducerParksWhenNoSubscriberPulls) {
+    auto counting = std::make_unique<CountingSource>(50000);
+    auto *inner = counting.get();
+    VideoBroadcasterOptions options;
+    options.idle_timeout = std::chrono::milliseconds(30);
+    auto broadcaster = VideoBroadcaster::create(std::move(counting), options);
+    auto a = broadcaster->subscribe();
+    auto b = broadcaster->subscribe();
+
+    VideoFrame frame{};
+    ASSERT_TRUE(wait_until([&] { return a->get_frame(frame) && frame.size > 0; }));
+    frame = {};
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto parked_at = inner->frames();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(inner->frames(), parked_at);
+
+    // 另一个订阅者开流同样唤醒生产线程；停流期间错过的帧不算丢
+    ASSERT_TRUE(wait_until([&] { return b->get_frame(frame) && frame.size > 0; }));
+    EXPECT_GT(inner->frames(), parked_at);
+    EXPECT_EQ(b->stats().dropped, 0u);
+}
+
+TEST(VideoBroadcaster, SubscribersOutliveBroadcasterHandle) {
+    auto broadcaster = VideoBroadcaster::create(std::make_unique<CountingSource>(50000));
+    auto a = broadcaster->subscribe();
+    {
+        auto b = broadcaster->subscribe();
+        EXPECT_EQ(broadcaster->subscriber_count(), 2u);
+    }
+    EXPECT_EQ(broadcaster->subscriber_count(), 1u);
+    broadcaster.reset();
+
+    VideoFrame frame{};
+    ASSERT_TRUE(wait_until([&] { return a->get_frame(frame) && frame.size > 0; }));
+    a.reset();
+    // 订阅者与广播器都已销毁，帧缓冲仍可读
+    EXPECT_EQ(frame.data[frame.size - 1], frame.data[0]);
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <asio.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "usbipdcpp/constant.h"
+#include "usbipdcpp/protocol.h"
+#include "usbipdcpp/virtual_device/MscConstants.h"
+
+namespace usbipdcpp {
+namespace test {
+
+/**
+ * 最小 USB/IP 客户端（相当于 vhci 一侧）：import 设备后逐个提交 URB 并同步等待 RET_SUBMIT。
+ * 报文直接按线格式手工拼装，不经过服务器侧的 protocol 实现，测试的是真实的线上行为。
+ * 非线程安全，同一时刻只有一个 URB 在途。
+ */
+class UsbIpTestClient {
+public:
+    struct Reply {
+        std::uint32_t status = 0;
+        std::uint32_t actual_length = 0;
+        std::vector<std::uint8_t> data; // IN 方向的返回数据
+        std::vector<std::uint32_t> iso_actual_lengths; // 等时传输各包实际长度（data 按包紧凑拼接）
+    };
+
+    explicit UsbIpTestClient(asio::io_context &io) : sock_(io) {
+    }
+
+    asio::ip::tcp::socket &socket() {
+        return sock_;
+    }
+
+    /** import busid 对应的设备，成功返回 true（读掉回复中的设备信息） */
+    bool import(const std::string &busid) {
+        UsbIpCommand::OpReqImport req{.status = 0, .busid = {}};
+        std::copy(busid.begin(), busid.end(), req.busid.begin());
+        usbipdcpp::error_code ec;
+        req.to_socket(sock_, ec);
+        if (ec)
+            return false;
+        std::array<std::uint8_t, 8> head{};
+        asio::read(sock_, asio::buffer(head), ec);
+        if (ec || be16(&head[2]) != OP_REP_IMPORT || be32(&head[4]) != 0)
+            return false;
+        std::array<std::uint8_t, 312> device{}; // usbip_usb_device
+        asio::read(sock_, asio::buffer(device), ec);
+        if (ec)
+            return false;
+        devid_ = (be32(&device[288]) << 16) | be32(&device[292]);
+        return true;
+    }
+
+    /**
+     * 提交一个 URB 并等待回复
+     * @param ep     端点号（不带方向位）
+     * @param in     true = IN 方向
+     * @param length transfer_buffer_length
+     * @param out    OUT 方向数据（长度须等于 length）
+     * @param setup  控制传输的 setup 包（8 字节），其他传输为全零
+     */
+    Reply submit(std::uint8_t ep, bool in, std::uint32_t length, const std::vector<std::uint8_t> &out = {},
+                 const std::array<std::uint8_t, 8> &setup = {}) {
+        std::vector<std::uint8_t> pkt;
+        append_submit(pkt, ++seqnum_, devid_, ep, in, length, out.data(), setup);
+        asio::write(sock_, asio::buffer(pkt));
+
+        std::array<std::uint8_t, 48> head{};
+        asio::read(sock_, asio::buffer(head));
+        Reply reply;
+        reply.status = be32(&head[20]);
+        reply.actual_length = be32(&head[24]);
+        if (in && reply.actual_length > 0) {
+            reply.data.resize(reply.actual_length);
+            asio::read(sock_, asio::buffer(reply.data));
+        }
+        return reply;
+    }
+
+    /**
+     * 提交一个等时 IN URB（packets 个包，每包 packet_size 字节）并等待回复。
+     * 回复的数据按包紧凑拼接，各包实际长度见 iso_actual_lengths
+     */
+    Reply submit_iso_in(std::uint8_t ep, std::uint32_t packets, std::uint32_t packet_size) {
+        std::vector<std::uint8_t> pkt;
+        append_submit(pkt, ++seqnum_, devid_, ep, true, packets * packet_size, nullptr, {}, packets);
+        for (std::uint32_t i = 0; i < packets; ++i) {
+            put(pkt, i * packet_size); // offset
+            put(pkt, packet_size); // length
+            put(pkt, 0u); // actual_length
+            put(pkt, 0u); // status
+        }
+        asio::write(sock_, asio::buffer(pkt));
+
+        std::array<std::uint8_t, 48> head{};
+        asio::read(sock_, asio::buffer(head));
+        Reply reply;
+        reply.status = be32(&head[20]);
+        reply.actual_length = be32(&head[24]);
+        auto number_of_packets = be32(&head[32]);
+        if (reply.actual_length > 0) {
+            reply.data.resize(reply.actual_length);
+            asio::read(sock_, asio::buffer(reply.data));
+        }
+        if (number_of_packets != 0 && number_of_packets != 0xFFFFFFFF) {
+            std::vector<std::uint8_t> descs(number_of_packets * 16);
+            asio::read(sock_, asio::buffer(descs));
+            for (std::uint32_t i = 0; i < number_of_packets; ++i)
+                reply.iso_actual_lengths.push_back(be32(&descs[i * 16 + 8]));
+        }
+        return reply;
+    }
+
+    /** 控制传输（端点 0） */
+    Reply control(std::uint8_t request_type, std::uint8_t request, std::uint16_t value, std::uint16_t index,
+                  std::uint16_t length, const std::vector<std::uint8_t> &out = {}) {
+        std::array<std::uint8_t, 8> setup = {request_type,
+                                             request,
+                                             static_cast<std::uint8_t>(value),
+                                             static_cast<std::uint8_t>(value >> 8),
+                                             static_cast<std::uint8_t>(index),
+                                             static_cast<std::uint8_t>(index >> 8),
+                                             static_cast<std::uint8_t>(length),
+                                             static_cast<std::uint8_t>(length >> 8)};
+        return submit(0, (request_type & 0x80) != 0, length, out, setup);
+    }
+
+    /**
+     * 在 pkt 末尾追加一个 USBIP_CMD_SUBMIT 报文（OUT 方向附带 length 字节的 out 数据），
+     * 供需要多个 URB 同时在途的调用方自行拼装批量报文。
+     * 等时传输的包描述符由调用方紧随其后追加
+     */
+    static void append_submit(std::vector<std::uint8_t> &pkt, std::uint32_t seqnum, std::uint32_t devid,
+                              std::uint8_t ep, bool in, std::uint32_t length, const std::uint8_t *out = nullptr,
+                              const std::array<std::uint8_t, 8> &setup = {},
+                              std::uint32_t number_of_packets = 0xFFFFFFFF) {
+        put(pkt, USBIP_CMD_SUBMIT);
+        put(pkt, seqnum);
+        put(pkt, devid);
+        put(pkt, in ? 1u : 0u);
+        put(pkt, static_cast<std::uint32_t>(ep));
+        put(pkt, 0u); // transfer_flags
+        put(pkt, length);
+        put(pkt, 0u); // start_frame
+        put(pkt, number_of_packets); // 0xFFFFFFFF：非等时
+        put(pkt, 0u); // interval
+        pkt.insert(pkt.end(), setup.begin(), setup.end());
+        if (!in && out)
+            pkt.insert(pkt.end(), out, out + length);
+    }
+
+    /** import 得到的 devid（busnum << 16 | devnum） */
+    std::uint32_t devid() const {
+        return devid_;
+    }
+
+    static std::uint16_t be16(const std::uint8_t *p) {
+        return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    static std::uint32_t be32(const std::uint8_t *p) {
+        return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+    }
+
+private:
+    static void put(std::vector<std::uint8_t> &v, std::uint32_t x) {
+        v.push_back(static_cast<std::uint8_t>(x >> 24));
+        v.push_back(static_cast<std::uint8_t>(x >> 16));
+        v.push_back(static_cast<std::uint8_t>(x >> 8));
+        v.push_back(static_cast<std::uint8_t>(x));
+    }
+
+    asio::ip::tcp::socket sock_;
+    std::uint32_t seqnum_ = 0;
+    std::uint32_t devid_ = 0;
+};
+
+/**
+ * 在 UsbIpTestClient 上跑 Bulk-Only Transport：CBW → 数据阶段 → CSW
+ */
+class BotTestClient {
+public:
+    struct Result {
+        CSW csw{};
+        std::vector<std::uint8_t> data; // DATA-IN 收到的数据
+    };
+
+    BotTestClient(UsbIpTestClient &client, std::uint8_t ep_in = 1, std::uint8_t ep_out = 2) :
+        client_(client), ep_in_(ep_in), ep_out_(ep_out) {
+    }
+
+    /**
+     * 执行一条 SCSI 命令
+     * @param data_in_length DATA-IN 期望字节数（与 data_out 互斥）
+     * @param data_out       DATA-OUT 数据
+     * @param chunk          数据阶段每个 URB 的最大字节数
+     */
+    Result command(std::uint8_t lun, const std::vector<std::uint8_t> &cdb, std::uint32_t data_in_length = 0,
+                   const std::vector<std::uint8_t> &data_out = {}, std::uint32_t chunk = 64 * 1024) {
+        auto raw = make_cbw(++tag_, lun, cdb,
+                            data_out.empty() ? data_in_length : static_cast<std::uint32_t>(data_out.size()),
+                            data_out.empty());
+        client_.submit(ep_out_, false, sizeof(CBW), raw);
+
+        Result result;
+        for (std::size_t off = 0; off < data_out.size();) {
+            auto n = std::min<std::size_t>(chunk, data_out.size() - off);
+            std::vector<std::uint8_t> part(data_out.begin() + off, data_out.begin() + off + n);
+            client_.submit(ep_out_, false, static_cast<std::uint32_t>(n), part);
+            off += n;
+        }
+        for (std::uint32_t got = 0; got < data_in_length;) {
+            auto n = std::min(chunk, data_in_length - got);
+            auto reply = client_.submit(ep_in_, true, n);
+            result.data.insert(result.data.end(), reply.data.begin(), reply.data.end());
+            got += n;
+            if (reply.actual_length < n)
+                break; // 短包：设备数据已发完
+        }
+        auto csw = client_.submit(ep_in_, true, sizeof(CSW));
+        if (csw.data.size() == sizeof(CSW))
+            std::memcpy(&result.csw, csw.data.data(), sizeof(CSW));
+        return result;
+    }
+
+    /** 按线格式编码 CBW（31 字节） */
+    static std::vector<std::uint8_t> make_cbw(std::uint32_t tag, std::uint8_t lun, const std::vector<std::uint8_t> &cdb,
+                                              std::uint32_t data_length, bool data_in) {
+        CBW cbw{};
+        cbw.dCBWSignature = CBW_SIGNATURE;
+        cbw.dCBWTag = tag;
+        cbw.dCBWDataTransferLength = data_length;
+        cbw.bmCBWFlags = data_in ? 0x80 : 0x00;
+        cbw.bCBWLUN = lun;
+        cbw.bCBWCBLength = static_cast<std::uint8_t>(cdb.size());
+        std::memcpy(cbw.CBWCB, cdb.data(), std::min(cdb.size(), sizeof(cbw.CBWCB)));
+        std::vector<std::uint8_t> raw(sizeof(CBW));
+        std::memcpy(raw.data(), &cbw, sizeof(CBW));
+        return raw;
+    }
+
+    static std::vector<std::uint8_t> read10(std::uint32_t lba, std::uint16_t count) {
+        std::vector<std::uint8_t> cdb(10, 0);
+        cdb[0] = ScsiCmd::Read10;
+        put_be32(&cdb[2], lba);
+        put_be16(&cdb[7], count);
+        return cdb;
+    }
+
+    static std::vector<std::uint8_t> write10(std::uint32_t lba, std::uint16_t count) {
+        auto cdb = read10(lba, count);
+        cdb[0] = ScsiCmd::Write10;
+        return cdb;
+    }
+
+private:
+    UsbIpTestClient &client_;
+    std::uint8_t ep_in_;
+    std::uint8_t ep_out_;
+    std::uint32_t tag_ = 0;
+};
+
+} // namespace test
+} // namespace usbipdcpp
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "usbip_test_client.h"
+
+#include "usbipdcpp/Device.h"
+#include "usbipdcpp/utils/StringPool.h"
+#include "usbipdcpp/virtual_device/UvcConstants.h"
+#include "usbipdcpp/virtual_device/UvcVirtualInterfaceHandler.h"
+
+namespace usbipdcpp {
+namespace test {
+
+/// VS 接口号与流端点（与 examples/mock_uvc 相同）
+constexpr std::uint16_t UVC_VS_INTERFACE = 1;
+constexpr std::uint8_t UVC_STREAM_EP = 1;
+
+/**
+ * 构造一个 UVC 虚拟设备，接口布局与 examples/mock_uvc 相同：
+ * VC 接口（中断 IN 0x87）+ VS 接口，等时模式 alt 1..N 依次为 iso_max_packet_sizes 各档的 ISO IN 0x81，
+ * 批量模式 alt 0 为 Bulk IN 0x81。
+ * string_pool 须比返回的设备活得久（handler 保存其引用）
+ */
+inline std::shared_ptr<UsbDevice> make_uvc_device(StringPool &string_pool, std::unique_ptr<VideoSource> source,
+                                                  bool bulk = false,
+                                                  const std::vector<std::uint16_t> &iso_max_packet_sizes = {512}) {
+    std::vector<std::vector<UsbEndpoint>> vs_endpoints;
+    if (bulk) {
+        vs_endpoints = {{UsbEndpoint{.address = 0x81,
+                                     .attributes = static_cast<std::uint8_t>(EndpointAttributes::Bulk),
+                                     .max_packet_size = 512,
+                                     .interval = 0}}};
+    }
+    else {
+        vs_endpoints = UvcDeviceHelper::iso_alt_settings(0x81, iso_max_packet_sizes);
+    }
+    std::vector<UsbInterface> interfaces = {
+            UsbInterface{
+                    .interface_class = CC_VIDEO,
+                    .interface_subclass = SC_VIDEOCONTROL,
+                    .interface_protocol = PC_PROTOCOL_15,
+                    .endpoints = {{UsbEndpoint{.address = 0x87, .attributes = 0x03, .max_packet_size = 16,
+                                               .interval = 8}}},
+            },
+            UsbInterface{
+                    .interface_class = CC_VIDEO,
+                    .interface_subclass = SC_VIDEOSTREAMING,
+                    .interface_protocol = PC_PROTOCOL_15,
+                    .endpoints = std::move(vs_endpoints),
+            },
+    };
+
+    auto device = std::make_shared<UsbDevice>(UsbDevice{
+            .path = "/test/mock_uvc",
+            .busid = "1-1",
+            .bus_num = 1,
+            .dev_num = 1,
+            .speed = static_cast<std::uint32_t>(UsbSpeed::High),
+            .vendor_id = 0x1234,
+            .product_id = 0x5682,
+            .device_bcd = 0x0100,
+            .device_class = 0xEF,
+            .device_subclass = 0x02,
+            .device_protocol = 0x01,
+            .configuration_value = 1,
+            .num_configurations = 1,
+            .interfaces = interfaces,
+            .ep0_in = UsbEndpoint::get_ep0_in(UsbSpeed::High),
+            .ep0_out = UsbEndpoint::get_ep0_out(UsbSpeed::High),
+    });
+    UvcDeviceHelper::setup(device, string_pool, std::move(source));
+    return device;
+}
+
+/// VS 接口的 handler（须已经 make_uvc_device）
+inline UvcVideoStreamingHandler &uvc_streaming_handler(UsbDevice &device) {
+    return *std::dynamic_pointer_cast<UvcVideoStreamingHandler>(device.interfaces[UVC_VS_INTERFACE].handler);
+}
+
+/// 对 VS 接口发 PROBE / COMMIT 的类请求（GET_* 返回 48 字节结构）
+inline UvcStreamingControl uvc_get_control(UsbIpTestClient &client, std::uint8_t request, std::uint8_t selector) {
+    auto reply = client.control(0xA1, request, static_cast<std::uint16_t>(selector << 8), UVC_VS_INTERFACE,
+                                UvcStreamingControl::SIZE);
+    UvcStreamingControl ctrl;
+    ctrl.deserialize(reply.data.data(), reply.data.size());
+    return ctrl;
+}
+
+inline std::uint32_t uvc_set_control(UsbIpTestClient &client, std::uint8_t selector, const UvcStreamingControl &ctrl) {
+    auto bytes = ctrl.serialize();
+    return client
+            .control(0x21, SET_CUR, static_cast<std::uint16_t>(selector << 8), UVC_VS_INTERFACE,
+                     static_cast<std::uint16_t>(bytes.size()), std::vector<std::uint8_t>(bytes.begin(), bytes.end()))
+            .status;
+}
+
+/// 主机驱动的标准开流协商：GET_DEF → SET_CUR(PROBE) → GET_CUR(PROBE) → SET_CUR(COMMIT)，返回提交的结构。
+/// format_index / frame_index / interval 非 0 时覆盖默认值提议给设备
+inline UvcStreamingControl uvc_negotiate(UsbIpTestClient &client, std::uint8_t format_index = 0,
+                                         std::uint8_t frame_index = 0, std::uint32_t interval = 0) {
+    auto ctrl = uvc_get_control(client, GET_DEF, VS_PROBE_CONTROL);
+    if (format_index != 0)
+        ctrl.bFormatIndex = format_index;
+    if (frame_index != 0)
+        ctrl.bFrameIndex = frame_index;
+    if (interval != 0)
+        ctrl.dwFrameInterval = interval;
+    uvc_set_control(client, VS_PROBE_CONTROL, ctrl);
+    ctrl = uvc_get_control(client, GET_CUR, VS_PROBE_CONTROL);
+    uvc_set_control(client, VS_COMMIT_CONTROL, ctrl);
+    return ctrl;
+}
+
+/**
+ * 主机侧 UVC payload 重组，规则与 Linux uvcvideo 相同：
+ * 等时每个包是一个 payload；批量 payload 的头只在开头，遇到短 URB（含零长度包）
+ * 或累计达到 dwMaxPayloadTransferSize 即结束。EOF 结束一帧
+ */
+class UvcFrameAssembler {
+public:
+    explicit UvcFrameAssembler(std::uint32_t max_payload = 0) : max_payload_(max_payload) {
+    }
+
+    /** 喂入一个批量 URB（requested 为 URB 请求长度），返回 true 表示完成了一帧 */
+    bool push_bulk(const std::uint8_t *data, std::size_t len, std::size_t requested) {
+        if (!in_payload_) {
+            if (len == 0)
+                return false; // 帧间空闲
+            if (!begin_payload(data, len))
+                return false;
+            append(data + data[0], len - data[0]);
+        }
+        else {
+            append(data, len);
+        }
+        payload_size_ += len;
+        if (len < requested || (max_payload_ != 0 && payload_size_ >= max_payload_)) {
+            in_payload_ = false;
+            return end_payload();
+        }
+        return false;
+    }
+
+    /** 喂入一个等时包，返回 true 表示完成了一帧 */
+    bool push_iso_packet(const std::uint8_t *data, std::size_t len) {
+        if (len == 0 || !begin_payload(data, len))
+            return false;
+        append(data + data[0], len - data[0]);
+        return end_payload();
+    }
+
+    const std::vector<std::uint8_t> &last_frame() const {
+        return last_frame_;
+    }
+
+    bool last_fid() const {
+        return last_fid_;
+    }
+
+    std::uint64_t frames() const {
+        return frames_;
+    }
+
+    std::uint64_t payloads() const {
+        return payloads_;
+    }
+
+    /** 头部不合法、同一帧内 FID 变化、payload 超过上限等协议错误的次数 */
+    std::uint64_t errors() const {
+        return errors_;
+    }
+
+private:
+    bool begin_payload(const std::uint8_t *data, std::size_t len) {
+        if (len < 2 || data[0] < 2 || data[0] > len) {
+            ++errors_;
+            return false;
+        }
+        bool fid = (data[1] & UVC_PAYLOAD_HEADER_FID) != 0;
+        if (!current_.empty() && fid != fid_)
+            ++errors_; // 上一帧没等到 EOF 就换了 FID
+        fid_ = fid;
+        header_info_ = data[1];
+        in_payload_ = true;
+        payload_size_ = 0;
+        ++payloads_;
+        return true;
+    }
+
+    void append(const std::uint8_t *data, std::size_t len) {
+        current_.insert(current_.end(), data, data + len);
+    }
+
+    bool end_payload() {
+        in_payload_ = false;
+        if (max_payload_ != 0 && payload_size_ > max_payload_)
+            ++errors_;
+        if ((header_info_ & UVC_PAYLOAD_HEADER_EOF) == 0)
+            return false;
+        last_frame_.swap(current_);
+        current_.clear();
+        last_fid_ = fid_;
+        ++frames_;
+        return true;
+    }
+
+    std::uint32_t max_payload_;
+    bool in_payload_ = false;
+    std::size_t payload_size_ = 0;
+    std::uint8_t header_info_ = 0;
+    bool fid_ = false;
+    std::vector<std::uint8_t> current_;
+    std::vector<std::uint8_t> last_frame_;
+    bool last_fid_ = false;
+    std::uint64_t frames_ = 0;
+    std::uint64_t payloads_ = 0;
+    std::uint64_t errors_ = 0;
+};
+
+} // namespace test
+} // namespace usbipdcpp